@@ -0,0 +1,68 @@
+#include "bench_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Provided by the linker for symbols wrapped with -Wl,--wrap=<name>
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static __thread bench_alloc_stats_t counters;
+
+void* __wrap_malloc(size_t size) {
+    counters.allocs++;
+    counters.bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    counters.allocs++;
+    counters.bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (ptr) {
+        counters.reallocs++;
+    } else {
+        counters.allocs++;
+    }
+    counters.bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr) counters.frees++;
+    __real_free(ptr);
+}
+
+// libc's own strdup allocates internally where the wrap cannot see it
+char* __wrap_strdup(const char* s) {
+    size_t len = strlen(s) + 1;
+    char* copy = __wrap_malloc(len);
+    if (copy) memcpy(copy, s, len);
+    return copy;
+}
+
+char* __wrap_strndup(const char* s, size_t n) {
+    size_t len = strnlen(s, n);
+    char* copy = __wrap_malloc(len + 1);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+void bench_alloc_stats(bench_alloc_stats_t* out) {
+    *out = counters;
+}
+
+void bench_alloc_diff(const bench_alloc_stats_t* before, const bench_alloc_stats_t* after,
+                      bench_alloc_stats_t* out) {
+    out->allocs = after->allocs - before->allocs;
+    out->reallocs = after->reallocs - before->reallocs;
+    out->frees = after->frees - before->frees;
+    out->bytes = after->bytes - before->bytes;
+}
@@ -0,0 +1,28 @@
+#ifndef BENCH_ALLOC_H
+#define BENCH_ALLOC_H
+
+#include <stdint.h>
+
+// Counting allocator hook for benchmarks.
+//
+// Binaries linked with BENCH_ALLOC_WRAP (see the Makefile) route every
+// malloc, calloc, realloc, strdup, strndup and free made from the repo's
+// own objects through bench_alloc.c, which counts them per thread before
+// calling the real allocator. Allocations made inside shared libraries
+// (OpenSSL, libc internals) are not seen.
+
+typedef struct {
+    uint64_t allocs;                // malloc, calloc, strdup, strndup, and realloc of NULL
+    uint64_t reallocs;              // realloc of an existing block
+    uint64_t frees;
+    uint64_t bytes;                 // Requested, including realloc growth targets
+} bench_alloc_stats_t;
+
+// Counts for the calling thread since it started
+void bench_alloc_stats(bench_alloc_stats_t* out);
+
+// after - before, field by field
+void bench_alloc_diff(const bench_alloc_stats_t* before, const bench_alloc_stats_t* after,
+                      bench_alloc_stats_t* out);
+
+#endif // BENCH_ALLOC_H
@@ -0,0 +1,370 @@
+// Packet codec benchmarks: the NEXUS packet framing, DNS query/response
+// payloads and single DNS records, each encoded and decoded across a range
+// of record counts and rdata sizes.
+//
+// Every case runs single-threaded in batches until --time-ms has passed
+// and reports ns/op, encoded bytes/op and throughput, plus allocations per
+// op counted by the bench_alloc.c hook this binary is linked with.
+
+#include "bench_common.h"
+#include "bench_alloc.h"
+#include "../include/packet_protocol.h"
+#include "../include/debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define CODEC_BATCH 1024
+#define CODEC_WARMUP 1000
+
+typedef int (*codec_op_fn)(void* ctx);
+
+typedef struct {
+    uint8_t* buf;                   // Encoded form, input to decoders
+    size_t buf_len;
+    size_t encoded_len;
+    uint8_t* out;                   // Scratch output for encoders
+    size_t out_len;
+    nexus_packet_t packet;
+    payload_dns_query_t query;
+    payload_dns_response_t response;
+    dns_record_t record;
+} codec_case_t;
+
+static uint64_t time_budget_ns = 300ULL * 1000000ULL;
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --time-ms <n>      Minimum run time per case (default: 300)\n");
+    printf("  --bench <list>     Comma-separated: packet,query,record,response (default: all)\n");
+    printf("  --json <file>      Also write results as JSON for bench_compare\n");
+}
+
+static char* make_string(size_t len, char fill) {
+    char* s = malloc(len + 1);
+    if (!s) return NULL;
+    memset(s, fill, len);
+    s[len] = '\0';
+    return s;
+}
+
+// --- Operations ---
+
+static int op_packet_encode(void* arg) {
+    codec_case_t* c = (codec_case_t*)arg;
+    return serialize_nexus_packet(&c->packet, c->out, c->out_len) > 0 ? 0 : -1;
+}
+
+static int op_packet_decode(void* arg) {
+    codec_case_t* c = (codec_case_t*)arg;
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    ssize_t n = deserialize_nexus_packet(c->buf, c->encoded_len, &packet);
+    free(packet.data);
+    return n > 0 ? 0 : -1;
+}
+
+static int op_query_encode(void* arg) {
+    codec_case_t* c = (codec_case_t*)arg;
+    return serialize_payload_dns_query(&c->query, c->out, c->out_len) > 0 ? 0 : -1;
+}
+
+static int op_query_decode(void* arg) {
+    codec_case_t* c = (codec_case_t*)arg;
+    payload_dns_query_t query;
+    return deserialize_payload_dns_query(c->buf, c->encoded_len, &query) > 0 ? 0 : -1;
+}
+
+static int op_record_encode(void* arg) {
+    codec_case_t* c = (codec_case_t*)arg;
+    size_t written = 0;
+    return serialize_dns_record(&c->record, c->out, c->out_len, &written);
+}
+
+static int op_record_decode(void* arg) {
+    codec_case_t* c = (codec_case_t*)arg;
+    dns_record_t record;
+    size_t read = 0;
+    int rv = (int)deserialize_dns_record(c->buf, c->encoded_len, &record, &read);
+    if (rv == 0) {
+        free(record.name);
+        free(record.rdata);
+    }
+    return rv;
+}
+
+static int op_response_encode(void* arg) {
+    codec_case_t* c = (codec_case_t*)arg;
+    return serialize_payload_dns_response(&c->response, c->out, c->out_len) > 0 ? 0 : -1;
+}
+
+static int op_response_decode(void* arg) {
+    codec_case_t* c = (codec_case_t*)arg;
+    payload_dns_response_t response;
+    memset(&response, 0, sizeof(response));
+    ssize_t n = deserialize_payload_dns_response(c->buf, c->encoded_len, &response);
+    for (int i = 0; i < response.record_count; i++) {
+        free(response.records[i].name);
+        free(response.records[i].rdata);
+    }
+    free(response.records);
+    return n > 0 ? 0 : -1;
+}
+
+// --- Runner ---
+
+static int run_case(const char* name, const char* params, codec_op_fn op, codec_case_t* c) {
+    for (int i = 0; i < CODEC_WARMUP; i++) {
+        if (op(c) != 0) {
+            fprintf(stderr, "%s (%s): operation failed\n", name, params);
+            return -1;
+        }
+    }
+
+    bench_alloc_stats_t before, after, allocs;
+    bench_alloc_stats(&before);
+    uint64_t iterations = 0;
+    uint64_t start = bench_now_ns();
+    uint64_t elapsed = 0;
+    while (elapsed < time_budget_ns) {
+        for (int i = 0; i < CODEC_BATCH; i++) op(c);
+        iterations += CODEC_BATCH;
+        elapsed = bench_now_ns() - start;
+    }
+    bench_alloc_stats(&after);
+    bench_alloc_diff(&before, &after, &allocs);
+
+    double ns_per_op = (double)elapsed / (double)iterations;
+    double mb_per_sec = (double)c->encoded_len / ns_per_op * 1e9 / (1024.0 * 1024.0);
+    double allocs_per_op = (double)(allocs.allocs + allocs.reallocs) / (double)iterations;
+    double alloc_bytes_per_op = (double)allocs.bytes / (double)iterations;
+    printf("%-16s %-24s %10.1f %10.1f %10zu %10.2f %12.1f\n",
+           name, params, ns_per_op, mb_per_sec, c->encoded_len, allocs_per_op, alloc_bytes_per_op);
+    fflush(stdout);
+
+    bench_metric_t metrics[] = {
+        { "ns_per_op", ns_per_op },
+        { "bytes", (double)c->encoded_len },
+        { "allocs_per_op", allocs_per_op },
+        { "alloc_bytes_per_op", alloc_bytes_per_op },
+    };
+    bench_json_record(name, params, metrics, sizeof(metrics) / sizeof(metrics[0]));
+    return 0;
+}
+
+static int prepare_buffers(codec_case_t* c, size_t size) {
+    c->buf_len = size;
+    c->out_len = size;
+    c->buf = malloc(size);
+    c->out = malloc(size);
+    return c->buf && c->out ? 0 : -1;
+}
+
+static void release_case(codec_case_t* c) {
+    free(c->buf);
+    free(c->out);
+    free(c->packet.data);
+    for (int i = 0; i < c->response.record_count; i++) {
+        free(c->response.records[i].name);
+        free(c->response.records[i].rdata);
+    }
+    free(c->response.records);
+    free(c->record.name);
+    free(c->record.rdata);
+    memset(c, 0, sizeof(*c));
+}
+
+static int bench_packet(void) {
+    static const size_t payload_sizes[] = { 32, 256, 1024, 4096 };
+    int status = 0;
+    for (size_t i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); i++) {
+        codec_case_t c;
+        memset(&c, 0, sizeof(c));
+        c.packet.version = 1;
+        c.packet.type = PACKET_TYPE_DNS_RESPONSE;
+        c.packet.session_id = 0x0123456789ABCDEFULL;
+        c.packet.data_len = (uint32_t)payload_sizes[i];
+        c.packet.data = (uint8_t*)make_string(payload_sizes[i], 'p');
+        ssize_t size = get_serialized_nexus_packet_size(&c.packet);
+        if (!c.packet.data || size < 0 || prepare_buffers(&c, (size_t)size) != 0) {
+            release_case(&c);
+            return -1;
+        }
+        ssize_t n = serialize_nexus_packet(&c.packet, c.buf, c.buf_len);
+        if (n < 0) {
+            release_case(&c);
+            return -1;
+        }
+        c.encoded_len = (size_t)n;
+
+        char params[32];
+        snprintf(params, sizeof(params), "payload=%zu", payload_sizes[i]);
+        if (run_case("packet_encode", params, op_packet_encode, &c) != 0) status = -1;
+        if (run_case("packet_decode", params, op_packet_decode, &c) != 0) status = -1;
+        release_case(&c);
+    }
+    return status;
+}
+
+static int bench_query(void) {
+    codec_case_t c;
+    memset(&c, 0, sizeof(c));
+    strncpy(c.query.query_name, "www.example.nexus", sizeof(c.query.query_name) - 1);
+    c.query.type = DNS_RECORD_TYPE_AAAA;
+    ssize_t size = get_serialized_payload_dns_query_size(&c.query);
+    if (size < 0 || prepare_buffers(&c, (size_t)size) != 0) {
+        release_case(&c);
+        return -1;
+    }
+    ssize_t n = serialize_payload_dns_query(&c.query, c.buf, c.buf_len);
+    if (n < 0) {
+        release_case(&c);
+        return -1;
+    }
+    c.encoded_len = (size_t)n;
+
+    int status = 0;
+    if (run_case("query_encode", "name=17", op_query_encode, &c) != 0) status = -1;
+    if (run_case("query_decode", "name=17", op_query_decode, &c) != 0) status = -1;
+    release_case(&c);
+    return status;
+}
+
+static int bench_record(void) {
+    static const size_t rdata_sizes[] = { 16, 128, 512 };
+    int status = 0;
+    for (size_t i = 0; i < sizeof(rdata_sizes) / sizeof(rdata_sizes[0]); i++) {
+        codec_case_t c;
+        memset(&c, 0, sizeof(c));
+        c.record.name = make_string(12, 'n');
+        c.record.rdata = make_string(rdata_sizes[i], 'r');
+        c.record.type = DNS_RECORD_TYPE_TXT;
+        c.record.ttl = 3600;
+        if (!c.record.name || !c.record.rdata) {
+            release_case(&c);
+            return -1;
+        }
+        ssize_t size = get_serialized_dns_record_size(&c.record);
+        size_t written = 0;
+        if (size < 0 || prepare_buffers(&c, (size_t)size) != 0 ||
+            serialize_dns_record(&c.record, c.buf, c.buf_len, &written) != 0) {
+            release_case(&c);
+            return -1;
+        }
+        c.encoded_len = written;
+
+        char params[32];
+        snprintf(params, sizeof(params), "rdata=%zu", rdata_sizes[i]);
+        if (run_case("record_encode", params, op_record_encode, &c) != 0) status = -1;
+        if (run_case("record_decode", params, op_record_decode, &c) != 0) status = -1;
+        release_case(&c);
+    }
+    return status;
+}
+
+static int bench_response(void) {
+    static const int record_counts[] = { 1, 4, 16, 64 };
+    static const size_t rdata_sizes[] = { 16, 128 };
+    int status = 0;
+    for (size_t r = 0; r < sizeof(record_counts) / sizeof(record_counts[0]); r++) {
+        for (size_t s = 0; s < sizeof(rdata_sizes) / sizeof(rdata_sizes[0]); s++) {
+            codec_case_t c;
+            memset(&c, 0, sizeof(c));
+            c.response.status = DNS_STATUS_SUCCESS;
+            c.response.records = calloc((size_t)record_counts[r], sizeof(dns_record_t));
+            if (!c.response.records) return -1;
+            c.response.record_count = record_counts[r];
+            int ok = 1;
+            for (int i = 0; i < record_counts[r]; i++) {
+                c.response.records[i].name = make_string(12, 'n');
+                c.response.records[i].rdata = make_string(rdata_sizes[s], 'r');
+                c.response.records[i].type = DNS_RECORD_TYPE_AAAA;
+                c.response.records[i].ttl = 300;
+                if (!c.response.records[i].name || !c.response.records[i].rdata) ok = 0;
+            }
+            ssize_t size = ok ? get_serialized_payload_dns_response_size(&c.response) : -1;
+            if (size < 0 || prepare_buffers(&c, (size_t)size) != 0) {
+                release_case(&c);
+                return -1;
+            }
+            ssize_t n = serialize_payload_dns_response(&c.response, c.buf, c.buf_len);
+            if (n < 0) {
+                release_case(&c);
+                return -1;
+            }
+            c.encoded_len = (size_t)n;
+
+            char params[32];
+            snprintf(params, sizeof(params), "records=%d rdata=%zu", record_counts[r], rdata_sizes[s]);
+            if (run_case("response_encode", params, op_response_encode, &c) != 0) status = -1;
+            if (run_case("response_decode", params, op_response_decode, &c) != 0) status = -1;
+            release_case(&c);
+        }
+    }
+    return status;
+}
+
+int main(int argc, char** argv) {
+    const char* selected = NULL;
+    const char* json_path = NULL;
+
+    static struct option long_options[] = {
+        {"time-ms", required_argument, 0, 't'},
+        {"bench",   required_argument, 0, 'b'},
+        {"json",    required_argument, 0, 'J'},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:b:J:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't': {
+                long ms = atol(optarg);
+                if (ms <= 0) {
+                    fprintf(stderr, "Invalid time: %s\n", optarg);
+                    return 1;
+                }
+                time_budget_ns = (uint64_t)ms * 1000000ULL;
+                break;
+            }
+            case 'b': selected = optarg; break;
+            case 'J': json_path = optarg; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    // Codec errors are logged; keep the log out of the measurements
+    set_log_level(LOG_LEVEL_OFF);
+
+    static const struct {
+        const char* name;
+        int (*run)(void);
+    } groups[] = {
+        { "packet", bench_packet },
+        { "query", bench_query },
+        { "record", bench_record },
+        { "response", bench_response },
+    };
+
+    if (json_path && bench_json_open(json_path, "codec") != 0) return 1;
+
+    printf("%-16s %-24s %10s %10s %10s %10s %12s\n",
+           "benchmark", "parameters", "ns/op", "MB/s", "bytes/op", "allocs/op", "alloc B/op");
+    int status = 0;
+    for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+        if (!bench_selected(selected, groups[i].name)) continue;
+        if (groups[i].run() != 0) {
+            fprintf(stderr, "Benchmark group %s failed\n", groups[i].name);
+            status = 1;
+        }
+    }
+    bench_json_close();
+    return status;
+}
@@ -0,0 +1,330 @@
+#include "bench_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HIST_SUB_COUNT (1 << BENCH_HIST_SUB_BITS)
+#define HIST_MAX_VALUE ((1ULL << (BENCH_HIST_MAX_EXPONENT + 1)) - 1)
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// splitmix64 to spread the seed, xorshift64* afterwards
+void bench_rng_seed(bench_rng_t* rng, uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    rng->state = (z ^ (z >> 31)) | 1;
+}
+
+uint64_t bench_rng_next(bench_rng_t* rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+double bench_rng_double(bench_rng_t* rng) {
+    return (double)(bench_rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int bench_selected(const char* list, const char* name) {
+    if (!list) return 1;
+    size_t len = strlen(name);
+    for (const char* p = list; (p = strstr(p, name)) != NULL; p += len) {
+        int starts = p == list || p[-1] == ',';
+        int ends = p[len] == '\0' || p[len] == ',';
+        if (starts && ends) return 1;
+    }
+    return 0;
+}
+
+int bench_parse_dist(const char* name, bench_dist_t* dist_out) {
+    if (!name || !dist_out) return -1;
+    if (strcmp(name, "uniform") == 0) {
+        *dist_out = BENCH_DIST_UNIFORM;
+    } else if (strcmp(name, "zipf") == 0 || strcmp(name, "zipfian") == 0) {
+        *dist_out = BENCH_DIST_ZIPF;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char* bench_dist_name(bench_dist_t dist) {
+    return dist == BENCH_DIST_ZIPF ? "zipf" : "uniform";
+}
+
+// Rejection-inversion sampling (Hörmann and Derflinger): constant time and
+// no table, so it works for key spaces of any size.
+static double zipf_helper1(double x) {
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+static double zipf_helper2(double x) {
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+}
+
+static double zipf_h(const bench_keygen_t* gen, double x) {
+    return exp(-gen->exponent * log(x));
+}
+
+static double zipf_h_integral(const bench_keygen_t* gen, double x) {
+    double log_x = log(x);
+    return zipf_helper2((1.0 - gen->exponent) * log_x) * log_x;
+}
+
+static double zipf_h_integral_inverse(const bench_keygen_t* gen, double x) {
+    double t = x * (1.0 - gen->exponent);
+    if (t < -1.0) t = -1.0;
+    return exp(zipf_helper1(t) * x);
+}
+
+int bench_keygen_init(bench_keygen_t* gen, bench_dist_t dist, uint64_t n, double exponent) {
+    if (!gen || n == 0) return -1;
+    if (dist == BENCH_DIST_ZIPF && exponent <= 0.0) return -1;
+
+    memset(gen, 0, sizeof(*gen));
+    gen->dist = dist;
+    gen->n = n;
+    gen->exponent = exponent;
+    if (dist == BENCH_DIST_ZIPF) {
+        gen->h_integral_x1 = zipf_h_integral(gen, 1.5) - 1.0;
+        gen->h_integral_n = zipf_h_integral(gen, (double)n + 0.5);
+        gen->s = 2.0 - zipf_h_integral_inverse(gen, zipf_h_integral(gen, 2.5) - zipf_h(gen, 2.0));
+    }
+    return 0;
+}
+
+uint64_t bench_keygen_next(const bench_keygen_t* gen, bench_rng_t* rng) {
+    if (gen->dist == BENCH_DIST_UNIFORM) {
+        return bench_rng_next(rng) % gen->n;
+    }
+
+    uint64_t rank;
+    for (;;) {
+        double u = gen->h_integral_n + bench_rng_double(rng) * (gen->h_integral_x1 - gen->h_integral_n);
+        double x = zipf_h_integral_inverse(gen, u);
+        double k = floor(x + 0.5);
+        if (k < 1.0) k = 1.0;
+        if (k > (double)gen->n) k = (double)gen->n;
+        if (k - x <= gen->s || u >= zipf_h_integral(gen, k + 0.5) - zipf_h(gen, k)) {
+            rank = (uint64_t)k - 1;
+            break;
+        }
+    }
+    // 2654435761 is prime, so this permutes the key space for any n it does not divide
+    return (uint64_t)(((unsigned __int128)rank * 2654435761ULL) % gen->n);
+}
+
+static size_t bucket_index(uint64_t value) {
+    if (value > HIST_MAX_VALUE) value = HIST_MAX_VALUE;
+    if (value < HIST_SUB_COUNT) return (size_t)value;
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - BENCH_HIST_SUB_BITS;
+    return HIST_SUB_COUNT + (size_t)shift * HIST_SUB_COUNT +
+           (size_t)((value >> shift) & (HIST_SUB_COUNT - 1));
+}
+
+// Largest value that falls in the bucket
+static uint64_t bucket_upper(size_t index) {
+    if (index < HIST_SUB_COUNT) return index;
+    size_t shift = (index - HIST_SUB_COUNT) / HIST_SUB_COUNT;
+    uint64_t sub = (index - HIST_SUB_COUNT) % HIST_SUB_COUNT;
+    return ((HIST_SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+void bench_hist_init(bench_hist_t* hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void bench_hist_record(bench_hist_t* hist, uint64_t value_ns) {
+    hist->buckets[bucket_index(value_ns)]++;
+    hist->count++;
+    hist->sum += value_ns;
+    if (value_ns < hist->min) hist->min = value_ns;
+    if (value_ns > hist->max) hist->max = value_ns;
+}
+
+void bench_hist_merge(bench_hist_t* dst, const bench_hist_t* src) {
+    for (size_t b = 0; b < BENCH_HIST_BUCKETS; b++) dst->buckets[b] += src->buckets[b];
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+uint64_t bench_hist_percentile(const bench_hist_t* hist, double q) {
+    if (hist->count == 0) return 0;
+    if (q >= 1.0) return hist->max;
+
+    uint64_t rank = (uint64_t)ceil(q * (double)hist->count);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BENCH_HIST_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(b);
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+typedef struct {
+    bench_worker_fn fn;
+    void* ctx;
+    int index;
+    pthread_barrier_t* start;
+    bench_hist_t hist;
+    uint64_t ops;
+    uint64_t busy_ns;
+} bench_thread_t;
+
+static void* bench_thread_main(void* arg) {
+    bench_thread_t* t = (bench_thread_t*)arg;
+    pthread_barrier_wait(t->start);
+    t->ops = t->fn(t->ctx, t->index, &t->hist, &t->busy_ns);
+    return NULL;
+}
+
+int bench_run(int threads, bench_worker_fn fn, void* ctx, bench_result_t* result) {
+    if (threads < 1 || threads > BENCH_MAX_THREADS || !fn || !result) return -1;
+
+    bench_thread_t* workers = calloc((size_t)threads, sizeof(bench_thread_t));
+    pthread_t* handles = calloc((size_t)threads, sizeof(pthread_t));
+    if (!workers || !handles) {
+        free(workers);
+        free(handles);
+        return -1;
+    }
+
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, (unsigned)threads);
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        workers[i].fn = fn;
+        workers[i].ctx = ctx;
+        workers[i].index = i;
+        workers[i].start = &start;
+        bench_hist_init(&workers[i].hist);
+        // The last worker runs on this thread
+        if (i == threads - 1) break;
+        if (pthread_create(&handles[i], NULL, bench_thread_main, &workers[i]) != 0) {
+            fprintf(stderr, "Failed to start benchmark thread %d\n", i);
+            // Nobody else can reach the barrier now
+            exit(1);
+        }
+        started++;
+    }
+    bench_thread_main(&workers[threads - 1]);
+    for (int i = 0; i < started; i++) {
+        pthread_join(handles[i], NULL);
+    }
+    pthread_barrier_destroy(&start);
+
+    memset(result, 0, sizeof(*result));
+    bench_hist_init(&result->hist);
+    for (int i = 0; i < threads; i++) {
+        result->ops += workers[i].ops;
+        if (workers[i].busy_ns > 0) {
+            result->ops_per_sec += (double)workers[i].ops * 1e9 / (double)workers[i].busy_ns;
+        }
+        bench_hist_merge(&result->hist, &workers[i].hist);
+    }
+
+    free(workers);
+    free(handles);
+    return 0;
+}
+
+static FILE* json_file = NULL;
+static const char* json_suite = NULL;
+static int json_records = 0;
+
+int bench_json_open(const char* path, const char* suite) {
+    if (!path || !suite || json_file) return -1;
+    json_file = fopen(path, "w");
+    if (!json_file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return -1;
+    }
+    json_suite = suite;
+    json_records = 0;
+    fputs("[\n", json_file);
+    return 0;
+}
+
+void bench_json_close(void) {
+    if (!json_file) return;
+    fputs(json_records > 0 ? "\n]\n" : "]\n", json_file);
+    fclose(json_file);
+    json_file = NULL;
+}
+
+static void json_write_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; s && *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+            fputc(*s, f);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(f, "\\u%04x", (unsigned char)*s);
+        } else {
+            fputc(*s, f);
+        }
+    }
+    fputc('"', f);
+}
+
+void bench_json_record(const char* name, const char* params, const bench_metric_t* metrics, size_t count) {
+    if (!json_file) return;
+    fputs(json_records++ > 0 ? ",\n{\"suite\":" : "{\"suite\":", json_file);
+    json_write_string(json_file, json_suite);
+    fputs(",\"name\":", json_file);
+    json_write_string(json_file, name);
+    fputs(",\"params\":", json_file);
+    json_write_string(json_file, params ? params : "");
+    fputs(",\"metrics\":{", json_file);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(json_file, "%s\"%s\":%.17g", i > 0 ? "," : "", metrics[i].key, metrics[i].value);
+    }
+    fputs("}}", json_file);
+    fflush(json_file);
+}
+
+void bench_print_header(void) {
+    printf("%-20s %-36s %12s %14s %9s %9s %9s %9s %10s\n",
+           "benchmark", "parameters", "ops", "ops/s", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns");
+}
+
+void bench_print_result(const char* name, const char* params, const bench_result_t* result) {
+    const bench_hist_t* h = &result->hist;
+    printf("%-20s %-36s %12llu %14.0f %9llu %9llu %9llu %9llu %10llu\n",
+           name, params ? params : "",
+           (unsigned long long)result->ops, result->ops_per_sec,
+           (unsigned long long)bench_hist_percentile(h, 0.50),
+           (unsigned long long)bench_hist_percentile(h, 0.90),
+           (unsigned long long)bench_hist_percentile(h, 0.99),
+           (unsigned long long)bench_hist_percentile(h, 0.999),
+           (unsigned long long)h->max);
+    fflush(stdout);
+
+    bench_metric_t metrics[] = {
+        { "ops", (double)result->ops },
+        { "ops_per_sec", result->ops_per_sec },
+        { "p50_ns", (double)bench_hist_percentile(h, 0.50) },
+        { "p90_ns", (double)bench_hist_percentile(h, 0.90) },
+        { "p99_ns", (double)bench_hist_percentile(h, 0.99) },
+    };
+    bench_json_record(name, params, metrics, sizeof(metrics) / sizeof(metrics[0]));
+}
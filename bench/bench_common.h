@@ -0,0 +1,99 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Shared pieces of the benchmark binaries in bench/: a fast per-thread
+// RNG, uniform and Zipfian key generators, a latency histogram and a
+// runner that starts worker threads together and merges their results.
+//
+// Latencies are recorded in nanoseconds in log-linear buckets (16 per
+// power of two, at most 6.25% relative error), the same scheme as the
+// service's metrics histograms.
+
+#define BENCH_HIST_SUB_BITS 4
+#define BENCH_HIST_MAX_EXPONENT 40      // Larger values are clamped (~18 minutes)
+#define BENCH_HIST_BUCKETS \
+    ((1 << BENCH_HIST_SUB_BITS) * (BENCH_HIST_MAX_EXPONENT - BENCH_HIST_SUB_BITS + 2))
+#define BENCH_MAX_THREADS 256
+
+typedef struct {
+    uint64_t state;
+} bench_rng_t;
+
+typedef enum {
+    BENCH_DIST_UNIFORM = 0,
+    BENCH_DIST_ZIPF
+} bench_dist_t;
+
+// Draws key indexes in [0, n). Zipfian ranks are scattered over the key
+// space so popular keys are not also neighbours in memory.
+typedef struct {
+    bench_dist_t dist;
+    uint64_t n;
+    double exponent;
+    double h_integral_x1;
+    double h_integral_n;
+    double s;
+} bench_keygen_t;
+
+typedef struct {
+    uint64_t buckets[BENCH_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} bench_hist_t;
+
+// Runs one thread's share of a benchmark. Returns the operations done and
+// sets *busy_ns to the time spent on them, excluding untimed setup.
+typedef uint64_t (*bench_worker_fn)(void* ctx, int thread_index, bench_hist_t* hist, uint64_t* busy_ns);
+
+typedef struct {
+    uint64_t ops;
+    double ops_per_sec;             // Sum of each thread's ops / busy time
+    bench_hist_t hist;              // Merged across threads
+} bench_result_t;
+
+uint64_t bench_now_ns(void);
+
+// Whether `name` appears in a comma-separated --bench list; NULL selects all
+int bench_selected(const char* list, const char* name);
+
+void bench_rng_seed(bench_rng_t* rng, uint64_t seed);
+uint64_t bench_rng_next(bench_rng_t* rng);
+double bench_rng_double(bench_rng_t* rng);      // [0, 1)
+
+int bench_parse_dist(const char* name, bench_dist_t* dist_out);
+const char* bench_dist_name(bench_dist_t dist);
+int bench_keygen_init(bench_keygen_t* gen, bench_dist_t dist, uint64_t n, double exponent);
+uint64_t bench_keygen_next(const bench_keygen_t* gen, bench_rng_t* rng);
+
+void bench_hist_init(bench_hist_t* hist);
+void bench_hist_record(bench_hist_t* hist, uint64_t value_ns);
+void bench_hist_merge(bench_hist_t* dst, const bench_hist_t* src);
+uint64_t bench_hist_percentile(const bench_hist_t* hist, double q);     // q in 0..1
+
+// Start `threads` workers at the same instant and merge their results
+int bench_run(int threads, bench_worker_fn fn, void* ctx, bench_result_t* result);
+
+// One aligned line per result, after bench_print_header()
+void bench_print_header(void);
+void bench_print_result(const char* name, const char* params, const bench_result_t* result);
+
+// Machine-readable results for bench/bench_compare. While a file is open
+// every result is also written to it as one JSON object per line:
+//   {"suite":"...","name":"...","params":"...","metrics":{"key":value,...}}
+// Metric names carry their direction: *_per_sec is better higher, *_ns
+// and *_per_op better lower, anything else is informational.
+typedef struct {
+    const char* key;
+    double value;
+} bench_metric_t;
+
+int bench_json_open(const char* path, const char* suite);
+void bench_json_close(void);
+void bench_json_record(const char* name, const char* params, const bench_metric_t* metrics, size_t count);
+
+#endif // BENCH_COMMON_H
@@ -0,0 +1,450 @@
+// Compares benchmark results written with --json against a stored
+// baseline and fails when a metric regressed by more than the threshold.
+//
+// Rows are matched on suite, name and params; a row given more than once,
+// e.g. by repeated runs, keeps the best value of each metric. Metrics
+// named *_per_sec are better higher; *_ns and *_per_op better lower;
+// other metrics are carried along but never compared. Exits 0 when nothing regressed, 1 on
+// a regression, a baseline row that is missing from the results or a result
+// without a baseline row (the baseline needs refreshing), 2 on usage or
+// input errors.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define COMPARE_MAX_FIELD 128
+#define COMPARE_MAX_METRICS 16
+
+typedef struct {
+    char key[COMPARE_MAX_FIELD];
+    double value;
+} compare_metric_t;
+
+typedef struct {
+    char suite[COMPARE_MAX_FIELD];
+    char name[COMPARE_MAX_FIELD];
+    char params[COMPARE_MAX_FIELD];
+    compare_metric_t metrics[COMPARE_MAX_METRICS];
+    int metric_count;
+    int matched;
+} compare_row_t;
+
+typedef struct {
+    compare_row_t* rows;
+    int count;
+    int capacity;
+} compare_set_t;
+
+typedef enum {
+    DIRECTION_NONE = 0,
+    DIRECTION_HIGHER,
+    DIRECTION_LOWER
+} metric_direction_t;
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s --baseline <file> [options] <results.json>...\n", prog);
+    printf("  --baseline <file>          Stored baseline to compare against\n");
+    printf("  --threshold <pct>          Allowed throughput and per-op regression (default: 10)\n");
+    printf("  --latency-threshold <pct>  Allowed latency (*_ns) regression (default: --threshold)\n");
+    printf("  --output <file>            Write the merged results, e.g. to refresh the baseline\n");
+    printf("  --skip-suite <suite>       Do not require the baseline rows of a suite that was not run\n");
+    printf("  --verbose                  Also list metrics within the threshold\n");
+    printf("Without --baseline the results are only merged into --output.\n");
+}
+
+static int ends_with(const char* s, const char* suffix) {
+    size_t len = strlen(s);
+    size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(s + len - suffix_len, suffix) == 0;
+}
+
+static metric_direction_t metric_direction(const char* key) {
+    if (ends_with(key, "_per_sec")) return DIRECTION_HIGHER;
+    if (ends_with(key, "_ns") || ends_with(key, "_per_op")) return DIRECTION_LOWER;
+    return DIRECTION_NONE;
+}
+
+static const char* skip_space(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    return p;
+}
+
+// Parses a JSON string at p into out; returns the position after it
+static const char* parse_string(const char* p, char* out, size_t out_len) {
+    p = skip_space(p);
+    if (*p != '"') return NULL;
+    p++;
+    size_t n = 0;
+    while (*p && *p != '"') {
+        char c = *p++;
+        if (c == '\\') {
+            c = *p++;
+            if (c == 'u') {
+                // Only control characters are written this way
+                unsigned int code = 0;
+                if (sscanf(p, "%4x", &code) != 1) return NULL;
+                p += 4;
+                c = (char)code;
+            } else if (c == 'n') {
+                c = '\n';
+            } else if (c == 't') {
+                c = '\t';
+            } else if (c == '\0') {
+                return NULL;
+            }
+        }
+        if (n + 1 >= out_len) return NULL;
+        out[n++] = c;
+    }
+    if (*p != '"') return NULL;
+    out[n] = '\0';
+    return p + 1;
+}
+
+static const char* expect_char(const char* p, char c) {
+    p = skip_space(p);
+    return *p == c ? p + 1 : NULL;
+}
+
+// One {"suite":..,"name":..,"params":..,"metrics":{..}} object
+static const char* parse_row(const char* p, compare_row_t* row) {
+    char key[COMPARE_MAX_FIELD];
+    memset(row, 0, sizeof(*row));
+    if (!(p = expect_char(p, '{'))) return NULL;
+    for (;;) {
+        if (!(p = parse_string(p, key, sizeof(key)))) return NULL;
+        if (!(p = expect_char(p, ':'))) return NULL;
+        if (strcmp(key, "metrics") == 0) {
+            if (!(p = expect_char(p, '{'))) return NULL;
+            p = skip_space(p);
+            if (*p == '}') {
+                p++;
+            } else {
+                for (;;) {
+                    if (row->metric_count >= COMPARE_MAX_METRICS) return NULL;
+                    compare_metric_t* m = &row->metrics[row->metric_count++];
+                    if (!(p = parse_string(p, m->key, sizeof(m->key)))) return NULL;
+                    if (!(p = expect_char(p, ':'))) return NULL;
+                    char* end;
+                    m->value = strtod(skip_space(p), &end);
+                    if (end == skip_space(p)) return NULL;
+                    p = skip_space(end);
+                    if (*p == ',') { p++; continue; }
+                    if (*p == '}') { p++; break; }
+                    return NULL;
+                }
+            }
+        } else {
+            char* dst = strcmp(key, "suite") == 0 ? row->suite :
+                        strcmp(key, "name") == 0 ? row->name :
+                        strcmp(key, "params") == 0 ? row->params : NULL;
+            char ignored[COMPARE_MAX_FIELD];
+            if (!(p = parse_string(p, dst ? dst : ignored, COMPARE_MAX_FIELD))) return NULL;
+        }
+        p = skip_space(p);
+        if (*p == ',') { p++; continue; }
+        if (*p == '}') return p + 1;
+        return NULL;
+    }
+}
+
+static int add_row(compare_set_t* set, const compare_row_t* row) {
+    if (set->count == set->capacity) {
+        int capacity = set->capacity ? set->capacity * 2 : 64;
+        compare_row_t* rows = realloc(set->rows, (size_t)capacity * sizeof(compare_row_t));
+        if (!rows) return -1;
+        set->rows = rows;
+        set->capacity = capacity;
+    }
+    set->rows[set->count++] = *row;
+    return 0;
+}
+
+static compare_row_t* find_row(compare_set_t* set, const compare_row_t* key) {
+    for (int i = 0; i < set->count; i++) {
+        compare_row_t* row = &set->rows[i];
+        if (strcmp(row->suite, key->suite) == 0 && strcmp(row->name, key->name) == 0 &&
+            strcmp(row->params, key->params) == 0) {
+            return row;
+        }
+    }
+    return NULL;
+}
+
+static compare_metric_t* find_metric(compare_row_t* row, const char* key) {
+    for (int i = 0; i < row->metric_count; i++) {
+        if (strcmp(row->metrics[i].key, key) == 0) return &row->metrics[i];
+    }
+    return NULL;
+}
+
+// Repeated runs of a row keep the best value of each metric, which is
+// far less noisy than any single run
+static void merge_row(compare_row_t* dst, const compare_row_t* src) {
+    for (int i = 0; i < src->metric_count; i++) {
+        const compare_metric_t* metric = &src->metrics[i];
+        compare_metric_t* existing = find_metric(dst, metric->key);
+        if (!existing) {
+            if (dst->metric_count < COMPARE_MAX_METRICS) dst->metrics[dst->metric_count++] = *metric;
+            continue;
+        }
+        switch (metric_direction(metric->key)) {
+            case DIRECTION_HIGHER:
+                if (metric->value > existing->value) existing->value = metric->value;
+                break;
+            case DIRECTION_LOWER:
+                if (metric->value < existing->value) existing->value = metric->value;
+                break;
+            default:
+                existing->value = metric->value;
+                break;
+        }
+    }
+}
+
+static int load_file(const char* path, compare_set_t* set) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return -1;
+    }
+    if (fseek(f, 0, SEEK_END) != 0) {
+        fclose(f);
+        return -1;
+    }
+    long size = ftell(f);
+    rewind(f);
+    char* text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        free(text);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    text[size] = '\0';
+
+    int status = 0;
+    const char* p = expect_char(text, '[');
+    if (!p) status = -1;
+    while (status == 0) {
+        p = skip_space(p);
+        if (*p == ']') break;
+        compare_row_t row;
+        const char* next = parse_row(p, &row);
+        if (!next || row.suite[0] == '\0' || row.name[0] == '\0') {
+            status = -1;
+            break;
+        }
+        compare_row_t* existing = find_row(set, &row);
+        if (existing) {
+            merge_row(existing, &row);
+        } else if (add_row(set, &row) != 0) {
+            status = -1;
+            break;
+        }
+        p = skip_space(next);
+        if (*p == ',') p++;
+    }
+    if (status != 0) {
+        fprintf(stderr, "%s: malformed benchmark results near offset %ld\n", path, p ? (long)(p - text) : 0L);
+    }
+    free(text);
+    return status;
+}
+
+static void write_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+            fputc(*s, f);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(f, "\\u%04x", (unsigned char)*s);
+        } else {
+            fputc(*s, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static int write_file(const char* path, const compare_set_t* set) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return -1;
+    }
+    fputs("[\n", f);
+    for (int i = 0; i < set->count; i++) {
+        const compare_row_t* row = &set->rows[i];
+        fputs("{\"suite\":", f);
+        write_string(f, row->suite);
+        fputs(",\"name\":", f);
+        write_string(f, row->name);
+        fputs(",\"params\":", f);
+        write_string(f, row->params);
+        fputs(",\"metrics\":{", f);
+        for (int m = 0; m < row->metric_count; m++) {
+            fprintf(f, "%s\"%s\":%.17g", m > 0 ? "," : "", row->metrics[m].key, row->metrics[m].value);
+        }
+        fputs(i + 1 < set->count ? "}},\n" : "}}\n", f);
+    }
+    fputs("]\n", f);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static void print_line(const compare_row_t* row, const char* metric, const char* baseline,
+                       const char* current, const char* change, const char* verdict) {
+    printf("%-8s %-20s %-24s %-18s %14s %14s %9s  %s\n",
+           row ? row->suite : "suite", row ? row->name : "benchmark", row ? row->params : "parameters",
+           metric, baseline, current, change, verdict);
+}
+
+int main(int argc, char** argv) {
+    const char* baseline_path = NULL;
+    const char* output_path = NULL;
+    double threshold = 10.0;
+    double latency_threshold = -1.0;
+    int verbose = 0;
+    const char* skipped_suites[8];
+    int skipped_count = 0;
+
+    static struct option long_options[] = {
+        {"baseline",          required_argument, 0, 'b'},
+        {"threshold",         required_argument, 0, 't'},
+        {"latency-threshold", required_argument, 0, 'l'},
+        {"output",            required_argument, 0, 'o'},
+        {"skip-suite",        required_argument, 0, 's'},
+        {"verbose",           no_argument,       0, 'v'},
+        {"help",              no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:t:l:o:s:vh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'b': baseline_path = optarg; break;
+            case 't': threshold = atof(optarg); break;
+            case 'l': latency_threshold = atof(optarg); break;
+            case 'o': output_path = optarg; break;
+            case 's':
+                if (skipped_count >= (int)(sizeof(skipped_suites) / sizeof(skipped_suites[0]))) {
+                    print_usage(argv[0]);
+                    return 2;
+                }
+                skipped_suites[skipped_count++] = optarg;
+                break;
+            case 'v': verbose = 1; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 2;
+        }
+    }
+    if (latency_threshold < 0.0) latency_threshold = threshold;
+    if (optind >= argc || threshold <= 0.0 || latency_threshold <= 0.0 || (!baseline_path && !output_path)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    compare_set_t current = {0};
+    for (int i = optind; i < argc; i++) {
+        if (load_file(argv[i], &current) != 0) return 2;
+    }
+    if (output_path && write_file(output_path, &current) != 0) return 2;
+    if (!baseline_path) {
+        printf("Wrote %d results to %s\n", current.count, output_path);
+        free(current.rows);
+        return 0;
+    }
+
+    compare_set_t baseline = {0};
+    if (load_file(baseline_path, &baseline) != 0) return 2;
+
+    int regressions = 0, improvements = 0, unchanged = 0, added = 0, missing = 0;
+    char base_buf[32], cur_buf[32], change_buf[32];
+
+    printf("Threshold: %.1f%% (latency %.1f%%), baseline %s\n\n", threshold, latency_threshold, baseline_path);
+    print_line(NULL, "metric", "baseline", "current", "change", "");
+    for (int i = 0; i < current.count; i++) {
+        compare_row_t* row = &current.rows[i];
+        compare_row_t* base = find_row(&baseline, row);
+        if (!base) {
+            added++;
+            print_line(row, "-", "-", "-", "-", "NEW, no baseline row");
+            continue;
+        }
+        base->matched = 1;
+        for (int m = 0; m < row->metric_count; m++) {
+            const compare_metric_t* metric = &row->metrics[m];
+            metric_direction_t direction = metric_direction(metric->key);
+            const compare_metric_t* base_metric = find_metric(base, metric->key);
+            if (direction == DIRECTION_NONE || !base_metric) continue;
+            if (base_metric->value <= 0.0) {
+                // No relative change from zero, but allocations appearing
+                // where there were none is exactly what the codec rows guard
+                if (direction == DIRECTION_LOWER && metric->value > 0.0) {
+                    snprintf(cur_buf, sizeof(cur_buf), "%.1f", metric->value);
+                    print_line(row, metric->key, "0.0", cur_buf, "new", "REGRESSION");
+                    regressions++;
+                } else {
+                    unchanged++;
+                }
+                continue;
+            }
+
+            // Positive change is always the worse direction
+            double change = (metric->value - base_metric->value) / base_metric->value * 100.0;
+            if (direction == DIRECTION_HIGHER) change = -change;
+            double limit = ends_with(metric->key, "_ns") ? latency_threshold : threshold;
+            const char* verdict;
+            if (change > limit) {
+                verdict = "REGRESSION";
+                regressions++;
+            } else if (change < -limit) {
+                verdict = "improved";
+                improvements++;
+            } else {
+                unchanged++;
+                if (!verbose) continue;
+                verdict = "ok";
+            }
+            snprintf(base_buf, sizeof(base_buf), "%.1f", base_metric->value);
+            snprintf(cur_buf, sizeof(cur_buf), "%.1f", metric->value);
+            // Shown as the raw change, so faster throughput reads as +
+            snprintf(change_buf, sizeof(change_buf), "%+.1f%%",
+                     (metric->value - base_metric->value) / base_metric->value * 100.0);
+            print_line(row, metric->key, base_buf, cur_buf, change_buf, verdict);
+        }
+    }
+    for (int i = 0; i < baseline.count; i++) {
+        if (baseline.rows[i].matched) continue;
+        int skipped = 0;
+        for (int j = 0; j < skipped_count; j++) {
+            if (strcmp(baseline.rows[i].suite, skipped_suites[j]) == 0) skipped = 1;
+        }
+        if (skipped) continue;
+        missing++;
+        print_line(&baseline.rows[i], "-", "-", "-", "-", "MISSING from results");
+    }
+
+    printf("\n%d regressed, %d improved, %d within threshold, %d new, %d missing\n",
+           regressions, improvements, unchanged, added, missing);
+    int failed = regressions > 0 || missing > 0 || added > 0;
+    if (regressions > 0 || missing > 0) {
+        printf("FAIL: performance regressed against the baseline\n");
+    } else if (added > 0) {
+        // Otherwise a suite missing from the baseline is never gated
+        printf("FAIL: results without a baseline row; refresh it with 'make bench_baseline'\n");
+    } else {
+        printf("PASS\n");
+    }
+
+    free(current.rows);
+    free(baseline.rows);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,473 @@
+// Certificate authority and Falcon benchmarks: the Falcon-1024 primitives,
+// the RSA/X.509 work done for compatibility, and the CA calls built from
+// them, each single-threaded and again across --threads.
+//
+// Issuing a certificate costs a Falcon keypair and signature plus an RSA
+// keypair and an X.509 signature, so after the single-threaded runs the
+// mean latencies are combined into the Falcon versus RSA/X.509 split.
+//
+// The CA reports every issuance and verification on stdout; that output is
+// sent to /dev/null while a benchmark runs.
+
+#include "bench_common.h"
+#include "../include/certificate_authority.h"
+#include "../include/keygen_pool.h"
+#include "../include/debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <openssl/x509.h>
+
+#define CRYPTO_MESSAGE_LEN 128
+
+typedef struct {
+    int threads;
+    uint64_t time_budget_ns;        // Per benchmark and thread count
+    uint64_t max_ops;               // Per thread, 0 for no limit
+    int pool_size;
+    int pool_workers;
+} crypto_bench_config_t;
+
+typedef enum {
+    OP_FALCON_KEYGEN,
+    OP_FALCON_SIGN,
+    OP_FALCON_SIGN_EXPANDED,
+    OP_FALCON_VERIFY,
+    OP_RSA_KEYGEN,
+    OP_X509_SIGN,
+    OP_X509_VERIFY,
+    OP_CA_ISSUE,
+    OP_CA_ISSUE_POOLED,
+    OP_CA_ISSUE_BATCH,
+    OP_VERIFY_CERT,
+    OP_VERIFY_CERT_CACHED,
+    OP_COUNT
+} crypto_op_t;
+
+typedef struct {
+    const crypto_bench_config_t* config;
+    ca_context_t* ca;
+    uint8_t public_key[FALCON_PUBKEY_SIZE_1024];
+    uint8_t private_key[FALCON_PRIVKEY_SIZE_1024];
+    uint8_t* expanded_key;
+    uint8_t message[CRYPTO_MESSAGE_LEN];
+    uint8_t signature[FALCON_SIG_LEN];  // Falcon signature over message
+    EVP_PKEY* subject_key;              // Public key put into X.509 certificates
+    EVP_PKEY* ca_public_key;
+    nexus_cert_t* cert;                 // Issued by ca, for the verify benchmarks
+    uint64_t failures;                  // Updated with atomics by workers
+} crypto_bench_ctx_t;
+
+typedef struct {
+    crypto_bench_ctx_t* ctx;
+    crypto_op_t op;
+    uint64_t max_ops;
+} crypto_job_t;
+
+static int saved_stdout = -1;
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --threads <n>       Also run every benchmark across n threads (default: 1)\n");
+    printf("  --time-ms <n>       Run time per benchmark and thread count (default: 2000)\n");
+    printf("  --max-ops <n>       Stop each thread after n operations, 0 for no limit (default: 0)\n");
+    printf("  --pool-size <n>     Keys pre-generated for ca_issue_pooled (default: 64)\n");
+    printf("  --pool-workers <n>  Keygen pool threads (default: 2)\n");
+    printf("  --bench <list>      Comma-separated: falcon_keygen,falcon_sign,falcon_sign_expanded,\n");
+    printf("                      falcon_verify,rsa_keygen,x509_sign,x509_verify,ca_issue,\n");
+    printf("                      ca_issue_pooled,ca_issue_batch,verify_cert,verify_cert_cached\n");
+    printf("                      (default: all)\n");
+    printf("  --json <file>       Also write results as JSON for bench_compare\n");
+}
+
+static void quiet_stdout(int quiet) {
+    fflush(stdout);
+    if (quiet && saved_stdout < 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd < 0) return;
+        saved_stdout = dup(STDOUT_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    } else if (!quiet && saved_stdout >= 0) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        saved_stdout = -1;
+    }
+}
+
+// The X.509 half of ca_issue_certificate, with a key that already exists
+static int x509_sign_once(crypto_bench_ctx_t* ctx) {
+    X509* x509 = X509_new();
+    if (!x509) return -1;
+
+    X509_set_version(x509, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1000);
+    X509_gmtime_adj(X509_get_notBefore(x509), 0);
+    X509_gmtime_adj(X509_get_notAfter(x509), 90 * 24 * 60 * 60);
+    X509_set_pubkey(x509, ctx->subject_key);
+    X509_NAME* name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"bench.nexus.local", -1, -1, 0);
+    X509_set_issuer_name(x509, X509_get_subject_name(ctx->ca->ca_cert->x509));
+
+    int rv = X509_sign(x509, ctx->ca->falcon_pkey, EVP_sha256()) > 0 ? 0 : -1;
+    X509_free(x509);
+    return rv;
+}
+
+static int run_op(crypto_bench_ctx_t* ctx, crypto_op_t op, uint8_t* public_key, uint8_t* private_key,
+                  uint8_t* signature, char* common_name, size_t name_len, uint64_t seq) {
+    switch (op) {
+        case OP_FALCON_KEYGEN:
+            return generate_falcon_keypair(public_key, private_key);
+        case OP_FALCON_SIGN:
+            return falcon_sign(ctx->private_key, ctx->message, sizeof(ctx->message), signature);
+        case OP_FALCON_SIGN_EXPANDED:
+            return falcon_sign_expanded(ctx->expanded_key, ctx->message, sizeof(ctx->message), signature);
+        case OP_FALCON_VERIFY:
+            return falcon_verify_sig(ctx->public_key, ctx->message, sizeof(ctx->message), ctx->signature);
+        case OP_RSA_KEYGEN: {
+            EVP_PKEY* key = keygen_pool_take_rsa(NULL);
+            EVP_PKEY_free(key);
+            return key ? 0 : -1;
+        }
+        case OP_X509_SIGN:
+            return x509_sign_once(ctx);
+        case OP_X509_VERIFY:
+            return X509_verify(ctx->cert->x509, ctx->ca_public_key) == 1 ? 0 : -1;
+        case OP_CA_ISSUE:
+        case OP_CA_ISSUE_POOLED: {
+            nexus_cert_t* cert = NULL;
+            snprintf(common_name, name_len, "node%llu.bench.local", (unsigned long long)seq);
+            int rv = ca_issue_certificate(ctx->ca, common_name, &cert);
+            free_certificate(cert);
+            return rv;
+        }
+        case OP_VERIFY_CERT:
+            // Drop the cached result so every call checks the signature
+            ca_invalidate_verification_cache(ctx->ca);
+            return verify_certificate(ctx->cert, ctx->ca);
+        case OP_VERIFY_CERT_CACHED:
+            return verify_certificate(ctx->cert, ctx->ca);
+        case OP_CA_ISSUE_BATCH:
+        case OP_COUNT:
+            break;
+    }
+    return -1;
+}
+
+static uint64_t crypto_worker(void* arg, int thread_index, bench_hist_t* hist, uint64_t* busy_ns) {
+    crypto_job_t* job = (crypto_job_t*)arg;
+    crypto_bench_ctx_t* ctx = job->ctx;
+
+    uint8_t public_key[FALCON_PUBKEY_SIZE_1024];
+    uint8_t private_key[FALCON_PRIVKEY_SIZE_1024];
+    uint8_t signature[FALCON_SIG_LEN];
+    char common_name[64];
+    uint64_t failures = 0;
+    uint64_t done = 0;
+    uint64_t start = bench_now_ns();
+    uint64_t before = start;
+
+    while (job->max_ops == 0 || done < job->max_ops) {
+        uint64_t seq = ((uint64_t)thread_index << 40) | done;
+        if (run_op(ctx, job->op, public_key, private_key, signature, common_name, sizeof(common_name), seq) != 0) {
+            failures++;
+        }
+        uint64_t after = bench_now_ns();
+        bench_hist_record(hist, after - before);
+        before = after;
+        done++;
+        if (after - start >= ctx->config->time_budget_ns) break;
+    }
+    *busy_ns = before - start;
+
+    __atomic_fetch_add(&ctx->failures, failures, __ATOMIC_RELAXED);
+    return done;
+}
+
+// One ca_issue_certificates_batch call sized to fill the time budget from
+// a single-threaded estimate. Latency columns show the mean per certificate.
+static int run_batch(crypto_bench_ctx_t* ctx, int threads, bench_result_t* result) {
+    const crypto_bench_config_t* config = ctx->config;
+
+    uint64_t probe_start = bench_now_ns();
+    nexus_cert_t* probe = NULL;
+    if (ca_issue_certificate(ctx->ca, "probe.bench.local", &probe) != 0) return -1;
+    free_certificate(probe);
+    uint64_t per_cert = bench_now_ns() - probe_start;
+
+    size_t count = (size_t)(config->time_budget_ns * (uint64_t)threads / (per_cert ? per_cert : 1));
+    if (count < (size_t)threads) count = (size_t)threads;
+    if (config->max_ops > 0 && count > config->max_ops * (uint64_t)threads) {
+        count = (size_t)(config->max_ops * (uint64_t)threads);
+    }
+
+    char** names = calloc(count, sizeof(char*));
+    nexus_cert_t** certs = calloc(count, sizeof(nexus_cert_t*));
+    int rv = names && certs ? 0 : -1;
+    for (size_t i = 0; rv == 0 && i < count; i++) {
+        names[i] = malloc(48);
+        if (!names[i]) {
+            rv = -1;
+            break;
+        }
+        snprintf(names[i], 48, "batch%zu.bench.local", i);
+    }
+
+    uint64_t start = bench_now_ns();
+    if (rv == 0) {
+        rv = ca_issue_certificates_batch(ctx->ca, (const char**)names, count, threads, certs);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    memset(result, 0, sizeof(*result));
+    bench_hist_init(&result->hist);
+    if (rv == 0) {
+        result->ops = count;
+        result->ops_per_sec = (double)count * 1e9 / (double)elapsed;
+        for (size_t i = 0; i < count; i++) {
+            bench_hist_record(&result->hist, elapsed / count);
+            free_certificate(certs[i]);
+        }
+    }
+    for (size_t i = 0; names && i < count; i++) free(names[i]);
+    free(names);
+    free(certs);
+    return rv;
+}
+
+static int run_benchmark(crypto_bench_ctx_t* ctx, const char* name, crypto_op_t op, int threads,
+                         double* mean_ns_out) {
+    const crypto_bench_config_t* config = ctx->config;
+    keygen_pool_t* pool = NULL;
+    bench_result_t result;
+    int rv;
+
+    crypto_job_t job = { .ctx = ctx, .op = op, .max_ops = config->max_ops };
+    ctx->failures = 0;
+
+    if (op == OP_CA_ISSUE_POOLED) {
+        // Warm pool sized for the run, so this measures issuance with key
+        // generation off the request path
+        fprintf(stderr, "  Filling keygen pool with %d key pairs...\n", config->pool_size);
+        quiet_stdout(1);
+        if (init_keygen_pool((size_t)config->pool_size, (size_t)config->pool_size, config->pool_workers, &pool) != 0) {
+            quiet_stdout(0);
+            return -1;
+        }
+        if (keygen_pool_wait_ready(pool, 600000) != 0) {
+            cleanup_keygen_pool(pool);
+            quiet_stdout(0);
+            return -1;
+        }
+        set_default_keygen_pool(pool);
+        uint64_t share = (uint64_t)config->pool_size / (uint64_t)threads;
+        if (job.max_ops == 0 || job.max_ops > share) job.max_ops = share > 0 ? share : 1;
+    }
+
+    quiet_stdout(1);
+    if (op == OP_CA_ISSUE_BATCH) {
+        rv = run_batch(ctx, threads, &result);
+    } else {
+        rv = bench_run(threads, crypto_worker, &job, &result);
+    }
+
+    // Kept stable across runs so bench_compare can match the baseline row
+    char params[32];
+    snprintf(params, sizeof(params), "threads=%d", threads);
+    uint64_t hits = 0, misses = 0;
+    if (pool) {
+        keygen_pool_stats(pool, NULL, NULL, &hits, &misses);
+        set_default_keygen_pool(NULL);
+        // Refills may still be running until the pool stops
+        cleanup_keygen_pool(pool);
+    }
+    quiet_stdout(0);
+    if (rv != 0) return -1;
+
+    bench_print_result(name, params, &result);
+    if (pool) {
+        printf("  %s: pool hits %llu, misses %llu\n", name,
+               (unsigned long long)hits, (unsigned long long)misses);
+    }
+    if (ctx->failures > 0) {
+        fprintf(stderr, "  %s: %llu operations failed\n", name, (unsigned long long)ctx->failures);
+    }
+    if (mean_ns_out && result.hist.count > 0) {
+        *mean_ns_out = (double)result.hist.sum / (double)result.hist.count;
+    }
+    return 0;
+}
+
+static int setup_context(crypto_bench_ctx_t* ctx) {
+    quiet_stdout(1);
+    int rv = init_certificate_authority(NULL, &ctx->ca);
+    quiet_stdout(0);
+    if (rv != 0) return -1;
+
+    for (size_t i = 0; i < sizeof(ctx->message); i++) {
+        ctx->message[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    quiet_stdout(1);
+    rv = generate_falcon_keypair(ctx->public_key, ctx->private_key);
+    if (rv == 0) rv = falcon_sign(ctx->private_key, ctx->message, sizeof(ctx->message), ctx->signature);
+    if (rv == 0) rv = ca_issue_certificate(ctx->ca, "verify.bench.local", &ctx->cert);
+    quiet_stdout(0);
+    if (rv != 0) return -1;
+
+    ctx->expanded_key = falcon_expand_private_key(ctx->private_key);
+    ctx->subject_key = keygen_pool_take_rsa(NULL);
+    ctx->ca_public_key = X509_get_pubkey(ctx->ca->ca_cert->x509);
+    return ctx->expanded_key && ctx->subject_key && ctx->ca_public_key ? 0 : -1;
+}
+
+static void cleanup_context(crypto_bench_ctx_t* ctx) {
+    free_certificate(ctx->cert);
+    EVP_PKEY_free(ctx->ca_public_key);
+    EVP_PKEY_free(ctx->subject_key);
+    free_falcon_expanded_key(ctx->expanded_key);
+    if (ctx->ca) {
+        quiet_stdout(1);
+        cleanup_certificate_authority(ctx->ca);
+        quiet_stdout(0);
+    }
+}
+
+static void print_split(const double* mean_ns) {
+    double falcon_keygen = mean_ns[OP_FALCON_KEYGEN];
+    double falcon_sign_ns = mean_ns[OP_FALCON_SIGN_EXPANDED];
+    double rsa_keygen = mean_ns[OP_RSA_KEYGEN];
+    double x509_sign = mean_ns[OP_X509_SIGN];
+
+    if (falcon_keygen > 0 && falcon_sign_ns > 0 && rsa_keygen > 0 && x509_sign > 0) {
+        double falcon = falcon_keygen + falcon_sign_ns;
+        double rsa = rsa_keygen + x509_sign;
+        printf("\nIssuance, single thread (mean):\n");
+        printf("  Falcon:     keygen %10.1f us + sign %8.1f us = %10.1f us (%4.1f%%)\n",
+               falcon_keygen / 1e3, falcon_sign_ns / 1e3, falcon / 1e3, 100.0 * falcon / (falcon + rsa));
+        printf("  RSA/X.509:  keygen %10.1f us + sign %8.1f us = %10.1f us (%4.1f%%)\n",
+               rsa_keygen / 1e3, x509_sign / 1e3, rsa / 1e3, 100.0 * rsa / (falcon + rsa));
+        if (mean_ns[OP_CA_ISSUE] > 0) {
+            printf("  ca_issue:   %10.1f us measured against %.1f us for the primitives\n",
+                   mean_ns[OP_CA_ISSUE] / 1e3, (falcon + rsa) / 1e3);
+        }
+    }
+    if (mean_ns[OP_FALCON_VERIFY] > 0 && mean_ns[OP_X509_VERIFY] > 0) {
+        printf("\nVerification, single thread (mean):\n");
+        printf("  Falcon verify %.1f us, X.509 verify %.1f us", mean_ns[OP_FALCON_VERIFY] / 1e3,
+               mean_ns[OP_X509_VERIFY] / 1e3);
+        if (mean_ns[OP_VERIFY_CERT] > 0) {
+            printf(", verify_certificate %.1f us", mean_ns[OP_VERIFY_CERT] / 1e3);
+        }
+        if (mean_ns[OP_VERIFY_CERT_CACHED] > 0) {
+            printf(" (%.2f us cached)", mean_ns[OP_VERIFY_CERT_CACHED] / 1e3);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    crypto_bench_config_t config = {
+        .threads = 1,
+        .time_budget_ns = 2000ULL * 1000000ULL,
+        .max_ops = 0,
+        .pool_size = 64,
+        .pool_workers = KEYGEN_POOL_DEFAULT_WORKERS,
+    };
+    const char* selected = NULL;
+    const char* json_path = NULL;
+
+    static struct option long_options[] = {
+        {"threads",      required_argument, 0, 't'},
+        {"time-ms",      required_argument, 0, 'm'},
+        {"max-ops",      required_argument, 0, 'o'},
+        {"pool-size",    required_argument, 0, 'p'},
+        {"pool-workers", required_argument, 0, 'w'},
+        {"bench",        required_argument, 0, 'b'},
+        {"json",         required_argument, 0, 'J'},
+        {"help",         no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:m:o:p:w:b:J:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't': config.threads = atoi(optarg); break;
+            case 'm': config.time_budget_ns = strtoull(optarg, NULL, 10) * 1000000ULL; break;
+            case 'o': config.max_ops = strtoull(optarg, NULL, 10); break;
+            case 'p': config.pool_size = atoi(optarg); break;
+            case 'w': config.pool_workers = atoi(optarg); break;
+            case 'b': selected = optarg; break;
+            case 'J': json_path = optarg; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (config.threads < 1 || config.threads > BENCH_MAX_THREADS || config.time_budget_ns == 0 ||
+        config.pool_size < 1 || config.pool_workers < 1) {
+        fprintf(stderr, "Invalid benchmark parameters\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (json_path && bench_json_open(json_path, "crypto") != 0) return 1;
+
+    set_log_level(LOG_LEVEL_ERROR);
+
+    crypto_bench_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.config = &config;
+    if (setup_context(&ctx) != 0) {
+        fprintf(stderr, "Failed to set up the certificate authority\n");
+        cleanup_context(&ctx);
+        bench_json_close();
+        return 1;
+    }
+
+    static const struct {
+        const char* name;
+        crypto_op_t op;
+    } benchmarks[] = {
+        { "falcon_keygen", OP_FALCON_KEYGEN },
+        { "falcon_sign", OP_FALCON_SIGN },
+        { "falcon_sign_expanded", OP_FALCON_SIGN_EXPANDED },
+        { "falcon_verify", OP_FALCON_VERIFY },
+        { "rsa_keygen", OP_RSA_KEYGEN },
+        { "x509_sign", OP_X509_SIGN },
+        { "x509_verify", OP_X509_VERIFY },
+        { "ca_issue", OP_CA_ISSUE },
+        { "ca_issue_pooled", OP_CA_ISSUE_POOLED },
+        { "ca_issue_batch", OP_CA_ISSUE_BATCH },
+        { "verify_cert", OP_VERIFY_CERT },
+        { "verify_cert_cached", OP_VERIFY_CERT_CACHED },
+    };
+
+    double mean_ns[OP_COUNT] = {0};
+    int status = 0;
+    bench_print_header();
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if (!bench_selected(selected, benchmarks[i].name)) continue;
+        int runs[2] = { 1, config.threads };
+        for (int r = 0; r < (config.threads > 1 ? 2 : 1); r++) {
+            if (run_benchmark(&ctx, benchmarks[i].name, benchmarks[i].op, runs[r],
+                              r == 0 ? &mean_ns[benchmarks[i].op] : NULL) != 0) {
+                fprintf(stderr, "Benchmark %s failed to run\n", benchmarks[i].name);
+                status = 1;
+                break;
+            }
+        }
+    }
+    print_split(mean_ns);
+
+    cleanup_context(&ctx);
+    bench_json_close();
+    return status;
+}
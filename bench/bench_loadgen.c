@@ -0,0 +1,721 @@
+// Loopback QUIC load generator: opens many client connections to a running
+// nexus server, sends a mix of DNS_QUERY and TLD_REGISTER_REQ packets, one
+// request per bidirectional stream, and reports QPS, latency percentiles,
+// handshake rate and errors.
+//
+// Closed-loop mode keeps --streams requests in flight on every connection.
+// With --rate the requests are issued on a fixed schedule instead and
+// latency is measured from the scheduled send time, so time spent waiting
+// for a free stream is included rather than hidden.
+//
+// Query names follow bench_resolver's zone ("h<i>.t<i % tlds>"); registered
+// TLDs are "lg<pid>-<n>" and so always new to the server.
+
+#include "bench_common.h"
+#include "../include/nexus_client.h"
+#include "../include/packet_protocol.h"
+#include "../include/network_context.h"
+#include "../include/debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define LOADGEN_READ_BURST 64           // Datagrams read per connection per loop
+#define LOADGEN_RETRY_NS 100000000ULL   // Wait before reconnecting after a failure
+
+typedef struct {
+    const char* server;
+    uint16_t port;
+    int connections;
+    int streams;                    // Requests in flight per connection
+    double rate;                    // Requests per second, 0 for closed loop
+    double duration_s;
+    double register_ratio;          // Share of requests that are TLD_REGISTER_REQ
+    uint64_t records;
+    int tlds;
+    bench_dist_t dist;
+    double zipf_exponent;
+    uint64_t requests_per_conn;     // Reconnect after this many, 0 to keep connections
+    int timeout_ms;
+    int handshake_timeout_ms;
+    int interval_s;                 // Progress line period, 0 to disable
+    uint64_t seed;
+} loadgen_config_t;
+
+typedef enum {
+    CONN_IDLE = 0,
+    CONN_HANDSHAKE,
+    CONN_READY
+} loadgen_conn_state_t;
+
+typedef struct {
+    int64_t stream_id;              // -1 when the slot is free
+    uint8_t type;
+    uint64_t start_ns;
+} loadgen_request_t;
+
+typedef struct loadgen_s loadgen_t;
+
+typedef struct {
+    loadgen_t* lg;
+    nexus_client_config_t client;
+    loadgen_conn_state_t state;
+    uint64_t handshake_start_ns;
+    uint64_t retry_at_ns;
+    uint64_t issued;                // Requests sent on the current connection
+    int inflight;
+    loadgen_request_t* slots;       // config->streams entries
+} loadgen_conn_t;
+
+typedef struct {
+    bench_hist_t hist;
+    uint64_t sent;
+    uint64_t answered;
+    uint64_t ok;                    // SUCCESS, or ALREADY_EXISTS for registrations
+    uint64_t nxdomain;
+    uint64_t failed;                // Any other response status
+    uint64_t timeouts;
+} loadgen_type_stats_t;
+
+struct loadgen_s {
+    const loadgen_config_t* config;
+    network_context_t net_ctx;
+    loadgen_conn_t* conns;
+    bench_rng_t rng;
+    bench_keygen_t keys;
+    uint64_t register_seq;
+
+    loadgen_type_stats_t query;
+    loadgen_type_stats_t reg;
+    bench_hist_t handshake_hist;
+    bench_hist_t interval_hist;
+    uint64_t interval_answered;
+    uint64_t handshakes;
+    uint64_t handshake_failures;
+    uint64_t connect_failures;
+    uint64_t connections_lost;
+    uint64_t reconnects;
+    uint64_t bad_responses;
+    uint64_t late_responses;        // Arrived after the request timed out
+    uint64_t send_failures;
+    uint64_t send_blocked;          // Congestion window or stream credit exhausted
+    uint64_t dropped;               // Rate mode: no connection had a free stream
+    uint64_t aborted;               // In flight when a connection failed
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --server <addr>            Server address (default: ::1)\n");
+    printf("  --port <n>                 Server port (default: 10053)\n");
+    printf("  --connections <n>          Concurrent QUIC connections (default: 1)\n");
+    printf("  --streams <n>              Requests in flight per connection (default: 8)\n");
+    printf("  --rate <qps>               Issue requests at a fixed rate instead of closed loop\n");
+    printf("  --duration <s>             Run time in seconds (default: 10)\n");
+    printf("  --register-ratio <f>       Share of TLD_REGISTER_REQ requests (default: 0.05)\n");
+    printf("  --records <n>              Query names drawn from h0..h<n-1> (default: 100000)\n");
+    printf("  --tlds <n>                 TLDs the query names are spread over (default: 16)\n");
+    printf("  --dist <uniform|zipf>      Query name distribution (default: uniform)\n");
+    printf("  --zipf-exponent <s>        Zipfian exponent (default: 0.99)\n");
+    printf("  --requests-per-conn <n>    Reconnect after n requests, 0 to keep connections (default: 0)\n");
+    printf("  --timeout-ms <n>           Request timeout (default: 2000)\n");
+    printf("  --handshake-timeout-ms <n> Handshake timeout (default: 5000)\n");
+    printf("  --interval <s>             Seconds between progress lines, 0 for none (default: 1)\n");
+    printf("  --seed <n>                 RNG seed (default: 1)\n");
+    printf("  --json <file>              Also write the summary as JSON for bench_compare\n");
+}
+
+static void init_type_stats(loadgen_type_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    bench_hist_init(&stats->hist);
+}
+
+static loadgen_type_stats_t* stats_for(loadgen_t* lg, uint8_t type) {
+    return type == PACKET_TYPE_TLD_REGISTER_REQ ? &lg->reg : &lg->query;
+}
+
+static void release_slot(loadgen_conn_t* c, loadgen_request_t* slot) {
+    slot->stream_id = -1;
+    c->inflight--;
+}
+
+static void record_answer(loadgen_t* lg, loadgen_request_t* slot, const nexus_packet_t* packet) {
+    loadgen_type_stats_t* stats = stats_for(lg, slot->type);
+    uint64_t latency = bench_now_ns() - slot->start_ns;
+
+    if (slot->type == PACKET_TYPE_DNS_QUERY) {
+        payload_dns_response_t resp;
+        if (packet->type != PACKET_TYPE_DNS_RESPONSE ||
+            deserialize_payload_dns_response(packet->data, packet->data_len, &resp) < 0) {
+            lg->bad_responses++;
+            return;
+        }
+        if (resp.status == DNS_STATUS_SUCCESS) {
+            stats->ok++;
+        } else if (resp.status == DNS_STATUS_NXDOMAIN) {
+            stats->nxdomain++;
+        } else {
+            stats->failed++;
+        }
+        for (int i = 0; i < resp.record_count; i++) {
+            free(resp.records[i].name);
+            free(resp.records[i].rdata);
+        }
+        free(resp.records);
+    } else {
+        payload_tld_register_resp_t resp;
+        if (packet->type != PACKET_TYPE_TLD_REGISTER_RESP ||
+            deserialize_payload_tld_register_resp(packet->data, packet->data_len, &resp) < 0) {
+            lg->bad_responses++;
+            return;
+        }
+        if (resp.status == TLD_REG_RESP_SUCCESS || resp.status == TLD_REG_RESP_ERROR_ALREADY_EXISTS) {
+            stats->ok++;
+        } else {
+            stats->failed++;
+        }
+    }
+
+    stats->answered++;
+    bench_hist_record(&stats->hist, latency);
+    bench_hist_record(&lg->interval_hist, latency);
+    lg->interval_answered++;
+}
+
+// nexus_client response hook; user_data is the loadgen_conn_t
+static void on_response(void* user_data, int64_t stream_id, const nexus_packet_t* packet) {
+    loadgen_conn_t* c = (loadgen_conn_t*)user_data;
+    loadgen_t* lg = c->lg;
+
+    loadgen_request_t* slot = NULL;
+    for (int i = 0; i < lg->config->streams; i++) {
+        if (c->slots[i].stream_id == stream_id) {
+            slot = &c->slots[i];
+            break;
+        }
+    }
+    if (!slot) {
+        lg->late_responses++;
+        return;
+    }
+
+    if (packet) {
+        record_answer(lg, slot, packet);
+    } else {
+        lg->bad_responses++;
+    }
+    release_slot(c, slot);
+}
+
+static int conn_start(loadgen_conn_t* c, uint64_t now) {
+    loadgen_t* lg = c->lg;
+
+    memset(&c->client, 0, sizeof(c->client));
+    c->client.sock = -1;
+    if (init_nexus_client(&lg->net_ctx, lg->config->server, lg->config->port, &c->client) != 0) {
+        lg->connect_failures++;
+        // init_nexus_client does not undo everything on every failure path
+        nexus_client_cleanup(&c->client);
+        c->state = CONN_IDLE;
+        c->retry_at_ns = now + LOADGEN_RETRY_NS;
+        return -1;
+    }
+    c->client.on_response = on_response;
+    c->client.response_user_data = c;
+
+    c->state = CONN_HANDSHAKE;
+    c->handshake_start_ns = now;
+    c->issued = 0;
+    c->inflight = 0;
+    for (int i = 0; i < lg->config->streams; i++) {
+        c->slots[i].stream_id = -1;
+    }
+    return 0;
+}
+
+// Requests still in flight are counted as aborted unless the close is orderly
+static void conn_stop(loadgen_conn_t* c, int failed, uint64_t now) {
+    loadgen_t* lg = c->lg;
+
+    if (c->state == CONN_IDLE) return;
+    if (failed) {
+        lg->aborted += (uint64_t)c->inflight;
+        c->retry_at_ns = now + LOADGEN_RETRY_NS;
+    } else {
+        nexus_client_close(&c->client);
+        c->retry_at_ns = now;
+    }
+    nexus_client_cleanup(&c->client);
+    for (int i = 0; i < lg->config->streams; i++) {
+        c->slots[i].stream_id = -1;
+    }
+    c->inflight = 0;
+    c->state = CONN_IDLE;
+}
+
+static void expire_requests(loadgen_conn_t* c, uint64_t now) {
+    loadgen_t* lg = c->lg;
+    uint64_t timeout_ns = (uint64_t)lg->config->timeout_ms * 1000000ULL;
+
+    for (int i = 0; i < lg->config->streams && c->inflight > 0; i++) {
+        loadgen_request_t* slot = &c->slots[i];
+        if (slot->stream_id >= 0 && now - slot->start_ns > timeout_ns) {
+            stats_for(lg, slot->type)->timeouts++;
+            release_slot(c, slot);
+        }
+    }
+}
+
+static void service_conn(loadgen_conn_t* c, uint64_t now) {
+    loadgen_t* lg = c->lg;
+    const loadgen_config_t* config = lg->config;
+
+    if (c->state == CONN_IDLE) {
+        if (now >= c->retry_at_ns) conn_start(c, now);
+        return;
+    }
+
+    if (nexus_client_flush(&c->client) != 0) {
+        lg->connections_lost++;
+        conn_stop(c, 1, now);
+        return;
+    }
+
+    if (c->state == CONN_HANDSHAKE) {
+        if (ngtcp2_conn_get_handshake_completed(c->client.conn)) {
+            bench_hist_record(&lg->handshake_hist, now - c->handshake_start_ns);
+            lg->handshakes++;
+            c->state = CONN_READY;
+        } else if (now - c->handshake_start_ns > (uint64_t)config->handshake_timeout_ms * 1000000ULL) {
+            lg->handshake_failures++;
+            conn_stop(c, 1, now);
+        }
+        return;
+    }
+
+    expire_requests(c, now);
+
+    // Replace the connection once it has done its share, or once the server
+    // stops granting streams on it
+    if (c->inflight == 0 &&
+        ((config->requests_per_conn > 0 && c->issued >= config->requests_per_conn) ||
+         ngtcp2_conn_get_streams_bidi_left(c->client.conn) == 0)) {
+        lg->reconnects++;
+        conn_stop(c, 0, now);
+    }
+}
+
+static int conn_can_send(const loadgen_conn_t* c, const loadgen_config_t* config) {
+    return c->state == CONN_READY && c->inflight < config->streams &&
+           (config->requests_per_conn == 0 || c->issued < config->requests_per_conn);
+}
+
+// Returns 0 when sent, 1 when the connection cannot take it yet and -1 on error
+static int send_request(loadgen_conn_t* c, uint64_t start_ns) {
+    loadgen_t* lg = c->lg;
+    const loadgen_config_t* config = lg->config;
+
+    uint8_t payload_buf[512];
+    ssize_t payload_len;
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.version = 1;
+
+    if (config->register_ratio > 0.0 && bench_rng_double(&lg->rng) < config->register_ratio) {
+        payload_tld_register_req_t req;
+        memset(&req, 0, sizeof(req));
+        snprintf(req.tld_name, sizeof(req.tld_name), "lg%d-%llu",
+                 (int)getpid(), (unsigned long long)lg->register_seq++);
+        payload_len = serialize_payload_tld_register_req(&req, payload_buf, sizeof(payload_buf));
+        packet.type = PACKET_TYPE_TLD_REGISTER_REQ;
+    } else {
+        payload_dns_query_t query;
+        memset(&query, 0, sizeof(query));
+        uint64_t key = bench_keygen_next(&lg->keys, &lg->rng);
+        snprintf(query.query_name, sizeof(query.query_name), "h%llu.t%llu",
+                 (unsigned long long)key, (unsigned long long)(key % (uint64_t)config->tlds));
+        query.type = DNS_RECORD_TYPE_A;
+        payload_len = serialize_payload_dns_query(&query, payload_buf, sizeof(payload_buf));
+        packet.type = PACKET_TYPE_DNS_QUERY;
+    }
+    if (payload_len < 0) {
+        lg->send_failures++;
+        return -1;
+    }
+    packet.data = payload_buf;
+    packet.data_len = (uint32_t)payload_len;
+
+    int64_t stream_id = nexus_client_send_packet(&c->client, &packet);
+    if (stream_id == -4 || stream_id == -5) {
+        lg->send_blocked++;
+        return 1;
+    }
+    if (stream_id < 0) {
+        lg->send_failures++;
+        return -1;
+    }
+
+    for (int i = 0; i < config->streams; i++) {
+        if (c->slots[i].stream_id < 0) {
+            c->slots[i].stream_id = stream_id;
+            c->slots[i].type = packet.type;
+            c->slots[i].start_ns = start_ns;
+            break;
+        }
+    }
+    c->inflight++;
+    c->issued++;
+    stats_for(lg, packet.type)->sent++;
+    return 0;
+}
+
+static void issue_closed_loop(loadgen_t* lg, uint64_t now) {
+    for (int i = 0; i < lg->config->connections; i++) {
+        loadgen_conn_t* c = &lg->conns[i];
+        while (conn_can_send(c, lg->config)) {
+            if (send_request(c, now) != 0) break;
+        }
+    }
+}
+
+// Sends everything scheduled up to now, spreading requests over connections
+static void issue_open_loop(loadgen_t* lg, uint64_t now, uint64_t* next_send_ns, uint64_t interval_ns,
+                            int* next_conn) {
+    const loadgen_config_t* config = lg->config;
+
+    while (*next_send_ns <= now) {
+        loadgen_conn_t* c = NULL;
+        for (int tries = 0; tries < config->connections; tries++) {
+            loadgen_conn_t* candidate = &lg->conns[*next_conn];
+            *next_conn = (*next_conn + 1) % config->connections;
+            if (conn_can_send(candidate, config)) {
+                c = candidate;
+                break;
+            }
+        }
+        if (!c) {
+            lg->dropped++;
+        } else if (send_request(c, *next_send_ns) > 0) {
+            // Keep the scheduled time and try again on the next pass
+            break;
+        }
+        *next_send_ns += interval_ns;
+    }
+}
+
+static int count_ready(const loadgen_t* lg) {
+    int ready = 0;
+    for (int i = 0; i < lg->config->connections; i++) {
+        if (lg->conns[i].state == CONN_READY) ready++;
+    }
+    return ready;
+}
+
+static int count_inflight(const loadgen_t* lg) {
+    int inflight = 0;
+    for (int i = 0; i < lg->config->connections; i++) {
+        inflight += lg->conns[i].inflight;
+    }
+    return inflight;
+}
+
+static void print_progress(loadgen_t* lg, uint64_t elapsed_ns, uint64_t period_ns) {
+    uint64_t errors = lg->query.timeouts + lg->reg.timeouts + lg->bad_responses + lg->send_failures +
+                      lg->aborted + lg->handshake_failures + lg->connect_failures;
+    printf("[%6.1fs] qps=%-9.0f p50=%-8.1fus p99=%-8.1fus inflight=%-5d conns=%d/%d errors=%llu\n",
+           (double)elapsed_ns / 1e9,
+           (double)lg->interval_answered * 1e9 / (double)period_ns,
+           (double)bench_hist_percentile(&lg->interval_hist, 0.50) / 1000.0,
+           (double)bench_hist_percentile(&lg->interval_hist, 0.99) / 1000.0,
+           count_inflight(lg), count_ready(lg), lg->config->connections,
+           (unsigned long long)errors);
+    fflush(stdout);
+    bench_hist_init(&lg->interval_hist);
+    lg->interval_answered = 0;
+}
+
+static void print_summary(loadgen_t* lg, uint64_t elapsed_ns) {
+    double secs = (double)elapsed_ns / 1e9;
+    bench_result_t result;
+    char params[64];
+
+    printf("\n");
+    bench_print_header();
+
+    struct {
+        const char* name;
+        loadgen_type_stats_t* stats;
+    } rows[] = {
+        { "dns_query", &lg->query },
+        { "tld_register", &lg->reg },
+    };
+    bench_hist_t all;
+    bench_hist_init(&all);
+    uint64_t all_answered = 0;
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        loadgen_type_stats_t* stats = rows[i].stats;
+        if (stats->sent == 0) continue;
+        result.ops = stats->answered;
+        result.ops_per_sec = (double)stats->answered / secs;
+        result.hist = stats->hist;
+        snprintf(params, sizeof(params), "conns=%d streams=%d", lg->config->connections, lg->config->streams);
+        bench_print_result(rows[i].name, params, &result);
+        bench_hist_merge(&all, &stats->hist);
+        all_answered += stats->answered;
+    }
+    result.ops = all_answered;
+    result.ops_per_sec = (double)all_answered / secs;
+    result.hist = all;
+    snprintf(params, sizeof(params), "conns=%d streams=%d", lg->config->connections, lg->config->streams);
+    bench_print_result("all", params, &result);
+
+    result.ops = lg->handshakes;
+    result.ops_per_sec = (double)lg->handshakes / secs;
+    result.hist = lg->handshake_hist;
+    bench_print_result("handshake", "", &result);
+
+    printf("\nDNS queries:   %llu ok, %llu nxdomain, %llu other status, %llu timed out\n",
+           (unsigned long long)lg->query.ok, (unsigned long long)lg->query.nxdomain,
+           (unsigned long long)lg->query.failed, (unsigned long long)lg->query.timeouts);
+    printf("Registrations: %llu ok, %llu rejected, %llu timed out\n",
+           (unsigned long long)lg->reg.ok, (unsigned long long)lg->reg.failed,
+           (unsigned long long)lg->reg.timeouts);
+    printf("Connections:   %llu handshakes, %llu handshake timeouts, %llu connect failures, "
+           "%llu lost, %llu recycled\n",
+           (unsigned long long)lg->handshakes, (unsigned long long)lg->handshake_failures,
+           (unsigned long long)lg->connect_failures, (unsigned long long)lg->connections_lost,
+           (unsigned long long)lg->reconnects);
+    printf("Errors:        %llu bad responses, %llu late responses, %llu send failures, %llu aborted\n",
+           (unsigned long long)lg->bad_responses, (unsigned long long)lg->late_responses,
+           (unsigned long long)lg->send_failures, (unsigned long long)lg->aborted);
+    printf("Generator:     %llu sends deferred (no stream or congestion window), %llu dropped\n",
+           (unsigned long long)lg->send_blocked, (unsigned long long)lg->dropped);
+}
+
+static int run_loadgen(loadgen_t* lg) {
+    const loadgen_config_t* config = lg->config;
+    struct pollfd* fds = calloc((size_t)config->connections, sizeof(struct pollfd));
+    int* fd_conn = calloc((size_t)config->connections, sizeof(int));
+    if (!fds || !fd_conn) {
+        free(fds);
+        free(fd_conn);
+        return -1;
+    }
+
+    uint64_t start = bench_now_ns();
+    uint64_t end = start + (uint64_t)(config->duration_s * 1e9);
+    uint64_t period_ns = (uint64_t)config->interval_s * 1000000000ULL;
+    uint64_t next_report = start + period_ns;
+    uint64_t last_report = start;
+    uint64_t interval_ns = config->rate > 0.0 ? (uint64_t)(1e9 / config->rate) : 0;
+    uint64_t next_send_ns = start;
+    int next_conn = 0;
+    if (interval_ns == 0 && config->rate > 0.0) interval_ns = 1;
+
+    uint64_t now = start;
+    while (running && now < end) {
+        int nfds = 0;
+        for (int i = 0; i < config->connections; i++) {
+            if (lg->conns[i].state == CONN_IDLE) continue;
+            fds[nfds].fd = lg->conns[i].client.sock;
+            fds[nfds].events = POLLIN;
+            fds[nfds].revents = 0;
+            fd_conn[nfds] = i;
+            nfds++;
+        }
+        if (nfds > 0) {
+            poll(fds, (nfds_t)nfds, 1);
+        } else {
+            usleep(1000);
+        }
+
+        for (int f = 0; f < nfds; f++) {
+            if (!(fds[f].revents & POLLIN)) continue;
+            loadgen_conn_t* c = &lg->conns[fd_conn[f]];
+            for (int n = 0; n < LOADGEN_READ_BURST; n++) {
+                if (nexus_client_process_events(&c->client) <= 0) break;
+            }
+        }
+
+        now = bench_now_ns();
+        for (int i = 0; i < config->connections; i++) {
+            service_conn(&lg->conns[i], now);
+        }
+
+        if (interval_ns > 0) {
+            issue_open_loop(lg, now, &next_send_ns, interval_ns, &next_conn);
+        } else {
+            issue_closed_loop(lg, now);
+        }
+
+        if (period_ns > 0 && now >= next_report) {
+            print_progress(lg, now - start, now - last_report);
+            last_report = now;
+            next_report += period_ns;
+        }
+    }
+
+    // Anything still outstanding at the end is neither answered nor an error
+    now = bench_now_ns();
+    print_summary(lg, now - start);
+
+    free(fds);
+    free(fd_conn);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    loadgen_config_t config = {
+        .server = "::1",
+        .port = 10053,
+        .connections = 1,
+        .streams = 8,
+        .rate = 0.0,
+        .duration_s = 10.0,
+        .register_ratio = 0.05,
+        .records = 100000,
+        .tlds = 16,
+        .dist = BENCH_DIST_UNIFORM,
+        .zipf_exponent = 0.99,
+        .requests_per_conn = 0,
+        .timeout_ms = 2000,
+        .handshake_timeout_ms = 5000,
+        .interval_s = 1,
+        .seed = 1
+    };
+    const char* json_path = NULL;
+
+    static struct option long_options[] = {
+        {"server",               required_argument, 0, 'S'},
+        {"port",                 required_argument, 0, 'p'},
+        {"connections",          required_argument, 0, 'c'},
+        {"streams",              required_argument, 0, 'n'},
+        {"rate",                 required_argument, 0, 'R'},
+        {"duration",             required_argument, 0, 'D'},
+        {"register-ratio",       required_argument, 0, 'g'},
+        {"records",              required_argument, 0, 'r'},
+        {"tlds",                 required_argument, 0, 'T'},
+        {"dist",                 required_argument, 0, 'd'},
+        {"zipf-exponent",        required_argument, 0, 'z'},
+        {"requests-per-conn",    required_argument, 0, 'k'},
+        {"timeout-ms",           required_argument, 0, 'o'},
+        {"handshake-timeout-ms", required_argument, 0, 'H'},
+        {"interval",             required_argument, 0, 'i'},
+        {"seed",                 required_argument, 0, 's'},
+        {"json",                 required_argument, 0, 'J'},
+        {"help",                 no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "S:p:c:n:R:D:g:r:T:d:z:k:o:H:i:s:J:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'S': config.server = optarg; break;
+            case 'p': config.port = (uint16_t)atoi(optarg); break;
+            case 'c': config.connections = atoi(optarg); break;
+            case 'n': config.streams = atoi(optarg); break;
+            case 'R': config.rate = atof(optarg); break;
+            case 'D': config.duration_s = atof(optarg); break;
+            case 'g': config.register_ratio = atof(optarg); break;
+            case 'r': config.records = strtoull(optarg, NULL, 10); break;
+            case 'T': config.tlds = atoi(optarg); break;
+            case 'd':
+                if (bench_parse_dist(optarg, &config.dist) != 0) {
+                    fprintf(stderr, "Invalid distribution: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'z': config.zipf_exponent = atof(optarg); break;
+            case 'k': config.requests_per_conn = strtoull(optarg, NULL, 10); break;
+            case 'o': config.timeout_ms = atoi(optarg); break;
+            case 'H': config.handshake_timeout_ms = atoi(optarg); break;
+            case 'i': config.interval_s = atoi(optarg); break;
+            case 's': config.seed = strtoull(optarg, NULL, 10); break;
+            case 'J': json_path = optarg; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    // The server grants 100 bidirectional streams per connection
+    if (config.connections < 1 || config.streams < 1 || config.streams > 100 || config.duration_s <= 0.0 ||
+        config.rate < 0.0 || config.register_ratio < 0.0 || config.register_ratio > 1.0 ||
+        config.records == 0 || config.tlds < 1 || config.timeout_ms < 1 || config.handshake_timeout_ms < 1 ||
+        config.interval_s < 0) {
+        fprintf(stderr, "Invalid options\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    set_log_level(LOG_LEVEL_ERROR);
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    loadgen_t lg;
+    memset(&lg, 0, sizeof(lg));
+    lg.config = &config;
+    bench_rng_seed(&lg.rng, config.seed);
+    if (bench_keygen_init(&lg.keys, config.dist, config.records, config.zipf_exponent) != 0) {
+        fprintf(stderr, "Invalid key distribution parameters\n");
+        return 1;
+    }
+    init_type_stats(&lg.query);
+    init_type_stats(&lg.reg);
+    bench_hist_init(&lg.handshake_hist);
+    bench_hist_init(&lg.interval_hist);
+
+    // Only client_port is read by init_nexus_client; 0 gives each
+    // connection its own ephemeral port
+    lg.net_ctx.client_port = 0;
+
+    lg.conns = calloc((size_t)config.connections, sizeof(loadgen_conn_t));
+    if (!lg.conns) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < config.connections; i++) {
+        lg.conns[i].lg = &lg;
+        lg.conns[i].state = CONN_IDLE;
+        lg.conns[i].slots = calloc((size_t)config.streams, sizeof(loadgen_request_t));
+        if (!lg.conns[i].slots) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    printf("Load: [%s]:%u, %d connections x %d streams, %s, %.0f%% TLD_REGISTER_REQ, %s names, %.1fs\n",
+           config.server, config.port, config.connections, config.streams,
+           config.rate > 0.0 ? "open loop" : "closed loop", config.register_ratio * 100.0,
+           bench_dist_name(config.dist), config.duration_s);
+    if (config.rate > 0.0) {
+        printf("Target rate: %.0f requests/s\n", config.rate);
+    }
+
+    if (json_path && bench_json_open(json_path, "loadgen") != 0) return 1;
+    int rc = run_loadgen(&lg);
+    bench_json_close();
+
+    uint64_t now = bench_now_ns();
+    for (int i = 0; i < config.connections; i++) {
+        conn_stop(&lg.conns[i], 0, now);
+        free(lg.conns[i].slots);
+    }
+    free(lg.conns);
+
+    if (rc != 0) return 1;
+    // Nothing answered usually means no server was listening
+    return lg.query.answered + lg.reg.answered > 0 ? 0 : 1;
+}
@@ -0,0 +1,413 @@
+// Resolver micro-benchmarks: resolve_dns_query, the DNS cache, parse_fqdn
+// and find_tld_by_name over a synthetic zone.
+//
+// Record i is an A record "h<i>" in TLD "t<i % tlds>", so the query name
+// is "h<i>.t<i % tlds>". Keys are drawn uniformly or from a Zipfian
+// distribution; names for a batch are formatted before its operations are
+// timed.
+
+#include "bench_common.h"
+#include "../include/dns_resolver.h"
+#include "../include/tld_manager.h"
+#include "../include/tld_snapshot.h"
+#include "../include/debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define BENCH_BATCH 256
+#define BENCH_NAME_MAX 64
+
+typedef struct {
+    uint64_t records;
+    int tlds;
+    int threads;
+    uint64_t ops;                   // Per thread
+    bench_dist_t dist;
+    double zipf_exponent;
+    int cache_size;
+    int use_snapshot;
+    uint64_t seed;
+} resolver_bench_config_t;
+
+typedef struct {
+    const resolver_bench_config_t* config;
+    tld_manager_t* tld_manager;
+    dns_resolver_t* resolver;
+    bench_keygen_t keys;
+    uint64_t failures;              // Updated with atomics by workers
+} resolver_bench_ctx_t;
+
+typedef enum {
+    OP_RESOLVE,
+    OP_CACHE_LOOKUP,
+    OP_CACHE_INSERT,
+    OP_PARSE_FQDN,
+    OP_FIND_TLD
+} resolver_op_t;
+
+typedef struct {
+    resolver_bench_ctx_t* ctx;
+    resolver_op_t op;
+} resolver_job_t;
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --records <n>          Records in the synthetic zone (default: 100000)\n");
+    printf("  --tlds <n>             TLDs the records are spread over (default: 16)\n");
+    printf("  --threads <n>          Worker threads (default: 1)\n");
+    printf("  --ops <n>              Operations per thread and benchmark (default: 200000)\n");
+    printf("  --dist <uniform|zipf>  Key distribution (default: uniform)\n");
+    printf("  --zipf-exponent <s>    Zipfian exponent (default: 0.99)\n");
+    printf("  --cache-size <n>       DNS cache capacity (default: 10000)\n");
+    printf("  --no-snapshot          Serve the zone from in-memory arrays, not a loaded snapshot\n");
+    printf("  --bench <list>         Comma-separated: resolve,cache_lookup,cache_insert,parse_fqdn,find_tld (default: all)\n");
+    printf("  --seed <n>             RNG seed (default: 1)\n");
+    printf("  --json <file>          Also write results as JSON for bench_compare\n");
+}
+
+static void format_name(char* buf, size_t len, uint64_t key, int tlds) {
+    snprintf(buf, len, "h%llu.t%llu", (unsigned long long)key, (unsigned long long)(key % (uint64_t)tlds));
+}
+
+static void free_records(dns_record_t* records, int count) {
+    for (int i = 0; i < count; i++) {
+        free(records[i].name);
+        free(records[i].rdata);
+    }
+    free(records);
+}
+
+static int build_zone(const resolver_bench_config_t* config, tld_manager_t** manager_out) {
+    tld_manager_t* manager = NULL;
+    if (init_tld_manager(&manager) != 0) return -1;
+
+    tld_t** tlds = calloc((size_t)config->tlds, sizeof(tld_t*));
+    if (!tlds) {
+        cleanup_tld_manager(manager);
+        return -1;
+    }
+    char name[BENCH_NAME_MAX];
+    for (int t = 0; t < config->tlds; t++) {
+        snprintf(name, sizeof(name), "t%d", t);
+        tlds[t] = register_new_tld(manager, name);
+        if (!tlds[t]) goto fail;
+    }
+
+    char rdata[32];
+    dns_record_t record = { .name = name, .rdata = rdata, .type = DNS_RECORD_TYPE_A, .ttl = 3600 };
+    for (uint64_t i = 0; i < config->records; i++) {
+        snprintf(name, sizeof(name), "h%llu", (unsigned long long)i);
+        snprintf(rdata, sizeof(rdata), "10.%u.%u.%u",
+                 (unsigned)((i >> 16) & 0xFF), (unsigned)((i >> 8) & 0xFF), (unsigned)(i & 0xFF));
+        if (add_dns_record_to_tld(tlds[i % (uint64_t)config->tlds], &record) != 0) goto fail;
+    }
+    free(tlds);
+
+    if (config->use_snapshot) {
+        // Serve the zone the way a restarted node does: from a mapped snapshot
+        char path[] = "/tmp/nexus_bench_zone_XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+            cleanup_tld_manager(manager);
+            return -1;
+        }
+        close(fd);
+        tld_snapshot_t* snapshot = NULL;
+        tld_manager_t* loaded = NULL;
+        int rv = write_tld_snapshot(manager, path, 0);
+        cleanup_tld_manager(manager);
+        manager = NULL;
+        if (rv == 0) rv = open_tld_snapshot(path, &snapshot);
+        unlink(path);
+        if (rv == 0) rv = init_tld_manager(&loaded);
+        if (rv == 0) rv = load_tld_snapshot_into_manager(snapshot, loaded);
+        if (rv != 0) {
+            if (loaded) cleanup_tld_manager(loaded);
+            else if (snapshot) close_tld_snapshot(snapshot);
+            return -1;
+        }
+        manager = loaded;
+    }
+
+    *manager_out = manager;
+    return 0;
+
+fail:
+    free(tlds);
+    cleanup_tld_manager(manager);
+    return -1;
+}
+
+static dns_cache_t* create_cache(int max_size) {
+    dns_cache_t* cache = calloc(1, sizeof(dns_cache_t));
+    if (!cache) return NULL;
+    cache->max_size = (size_t)max_size;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+static void destroy_cache(dns_cache_t* cache) {
+    if (!cache) return;
+    while (cache->head) {
+        dns_cache_node_t* node = cache->head;
+        cache->head = node->next;
+        free(node->entry.fqdn);
+        free(node->entry.record.name);
+        free(node->entry.record.rdata);
+        free(node);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+// Fresh cache for each benchmark so one does not warm the next
+static int reset_resolver(resolver_bench_ctx_t* ctx) {
+    dns_cache_t* cache = create_cache(ctx->config->cache_size);
+    if (!cache) return -1;
+    if (ctx->resolver) {
+        destroy_cache(ctx->resolver->cache);
+        cleanup_dns_resolver(ctx->resolver);
+        ctx->resolver = NULL;
+    }
+    if (init_dns_resolver(&ctx->resolver, ctx->tld_manager, cache) != 0) {
+        destroy_cache(cache);
+        return -1;
+    }
+    ctx->resolver->config.cache_size_max = ctx->config->cache_size;
+    // Keep lookups local; the synthetic TLDs are all registered
+    ctx->resolver->config.enable_recursive_resolution = 0;
+    return 0;
+}
+
+// Fill the cache with the keys lookups will ask for
+static int prefill_cache(resolver_bench_ctx_t* ctx, uint64_t entries) {
+    char fqdn[BENCH_NAME_MAX];
+    char name[BENCH_NAME_MAX];
+    dns_record_t record = { .name = name, .rdata = "10.0.0.1", .type = DNS_RECORD_TYPE_A, .ttl = 3600 };
+    for (uint64_t i = 0; i < entries; i++) {
+        format_name(fqdn, sizeof(fqdn), i, ctx->config->tlds);
+        snprintf(name, sizeof(name), "h%llu", (unsigned long long)i);
+        if (add_to_dns_cache(ctx->resolver, fqdn, &record) != 0) return -1;
+    }
+    return 0;
+}
+
+static int run_op(resolver_bench_ctx_t* ctx, resolver_op_t op, const char* fqdn, uint64_t key) {
+    switch (op) {
+        case OP_RESOLVE: {
+            dns_record_t* records = NULL;
+            int count = 0;
+            dns_response_status_t status = resolve_dns_query(ctx->resolver, fqdn, DNS_RECORD_TYPE_A,
+                                                             &records, &count);
+            free_records(records, count);
+            return status == DNS_STATUS_SUCCESS ? 0 : -1;
+        }
+        case OP_CACHE_LOOKUP: {
+            dns_record_t* record = NULL;
+            int found = lookup_in_dns_cache(ctx->resolver, fqdn, DNS_RECORD_TYPE_A, &record);
+            if (record) free_records(record, 1);
+            return found > 0 ? 0 : -1;
+        }
+        case OP_CACHE_INSERT: {
+            char name[BENCH_NAME_MAX];
+            snprintf(name, sizeof(name), "h%llu", (unsigned long long)key);
+            dns_record_t record = { .name = name, .rdata = "10.0.0.1", .type = DNS_RECORD_TYPE_A, .ttl = 3600 };
+            return add_to_dns_cache(ctx->resolver, fqdn, &record);
+        }
+        case OP_PARSE_FQDN: {
+            char hostname[MAX_DOMAIN_NAME_LEN];
+            char domain[MAX_DOMAIN_NAME_LEN];
+            char tld[MAX_DOMAIN_NAME_LEN];
+            return parse_fqdn(fqdn, hostname, sizeof(hostname), domain, sizeof(domain), tld, sizeof(tld));
+        }
+        case OP_FIND_TLD:
+            // fqdn holds just the TLD label for this benchmark
+            return find_tld_by_name(ctx->tld_manager, fqdn) ? 0 : -1;
+    }
+    return -1;
+}
+
+static uint64_t resolver_worker(void* arg, int thread_index, bench_hist_t* hist, uint64_t* busy_ns) {
+    resolver_job_t* job = (resolver_job_t*)arg;
+    resolver_bench_ctx_t* ctx = job->ctx;
+    const resolver_bench_config_t* config = ctx->config;
+
+    bench_rng_t rng;
+    bench_rng_seed(&rng, config->seed * 1000003ULL + (uint64_t)thread_index);
+
+    char names[BENCH_BATCH][BENCH_NAME_MAX];
+    uint64_t keys[BENCH_BATCH];
+    uint64_t done = 0;
+    uint64_t failures = 0;
+    *busy_ns = 0;
+
+    while (done < config->ops) {
+        size_t batch = config->ops - done < BENCH_BATCH ? (size_t)(config->ops - done) : BENCH_BATCH;
+        for (size_t i = 0; i < batch; i++) {
+            keys[i] = bench_keygen_next(&ctx->keys, &rng);
+            if (job->op == OP_FIND_TLD) {
+                snprintf(names[i], BENCH_NAME_MAX, "t%llu", (unsigned long long)(keys[i] % (uint64_t)config->tlds));
+            } else {
+                format_name(names[i], BENCH_NAME_MAX, keys[i], config->tlds);
+            }
+        }
+
+        uint64_t batch_start = bench_now_ns();
+        uint64_t before = batch_start;
+        for (size_t i = 0; i < batch; i++) {
+            if (run_op(ctx, job->op, names[i], keys[i]) != 0) failures++;
+            uint64_t after = bench_now_ns();
+            bench_hist_record(hist, after - before);
+            before = after;
+        }
+        *busy_ns += before - batch_start;
+        done += batch;
+    }
+
+    __atomic_fetch_add(&ctx->failures, failures, __ATOMIC_RELAXED);
+    return done;
+}
+
+static int run_benchmark(resolver_bench_ctx_t* ctx, const char* name, resolver_op_t op) {
+    const resolver_bench_config_t* config = ctx->config;
+    uint64_t key_space = config->records;
+
+    if (op == OP_RESOLVE || op == OP_CACHE_LOOKUP || op == OP_CACHE_INSERT) {
+        if (reset_resolver(ctx) != 0) return -1;
+    }
+    if (op == OP_CACHE_LOOKUP) {
+        // Only keys that fit in the cache, so every lookup can hit
+        if ((uint64_t)config->cache_size < key_space) key_space = (uint64_t)config->cache_size;
+        if (prefill_cache(ctx, key_space) != 0) return -1;
+    }
+    if (bench_keygen_init(&ctx->keys, config->dist, key_space, config->zipf_exponent) != 0) return -1;
+
+    resolver_job_t job = { .ctx = ctx, .op = op };
+    bench_result_t result;
+    ctx->failures = 0;
+    if (bench_run(config->threads, resolver_worker, &job, &result) != 0) return -1;
+
+    char params[96];
+    snprintf(params, sizeof(params), "%s records=%llu threads=%d",
+             bench_dist_name(config->dist), (unsigned long long)config->records, config->threads);
+    bench_print_result(name, params, &result);
+    if (ctx->failures > 0) {
+        fprintf(stderr, "  %s: %llu operations failed\n", name, (unsigned long long)ctx->failures);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    resolver_bench_config_t config = {
+        .records = 100000,
+        .tlds = 16,
+        .threads = 1,
+        .ops = 200000,
+        .dist = BENCH_DIST_UNIFORM,
+        .zipf_exponent = 0.99,
+        .cache_size = 10000,
+        .use_snapshot = 1,
+        .seed = 1,
+    };
+    const char* selected = NULL;
+    const char* json_path = NULL;
+
+    static struct option long_options[] = {
+        {"records",       required_argument, 0, 'r'},
+        {"tlds",          required_argument, 0, 'T'},
+        {"threads",       required_argument, 0, 't'},
+        {"ops",           required_argument, 0, 'o'},
+        {"dist",          required_argument, 0, 'd'},
+        {"zipf-exponent", required_argument, 0, 'z'},
+        {"cache-size",    required_argument, 0, 'c'},
+        {"no-snapshot",   no_argument,       0, 'n'},
+        {"bench",         required_argument, 0, 'b'},
+        {"seed",          required_argument, 0, 's'},
+        {"json",          required_argument, 0, 'J'},
+        {"help",          no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:T:t:o:d:z:c:nb:s:J:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'r': config.records = strtoull(optarg, NULL, 10); break;
+            case 'T': config.tlds = atoi(optarg); break;
+            case 't': config.threads = atoi(optarg); break;
+            case 'o': config.ops = strtoull(optarg, NULL, 10); break;
+            case 'd':
+                if (bench_parse_dist(optarg, &config.dist) != 0) {
+                    fprintf(stderr, "Invalid distribution: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'z': config.zipf_exponent = atof(optarg); break;
+            case 'c': config.cache_size = atoi(optarg); break;
+            case 'n': config.use_snapshot = 0; break;
+            case 'b': selected = optarg; break;
+            case 's': config.seed = strtoull(optarg, NULL, 10); break;
+            case 'J': json_path = optarg; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (config.records == 0 || config.tlds < 1 || config.threads < 1 || config.threads > BENCH_MAX_THREADS ||
+        config.ops == 0 || config.cache_size < 1 || config.zipf_exponent <= 0.0) {
+        fprintf(stderr, "Invalid benchmark parameters\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (json_path && bench_json_open(json_path, "resolver") != 0) return 1;
+
+    // Logging would dominate the numbers
+    set_log_level(LOG_LEVEL_ERROR);
+
+    resolver_bench_ctx_t ctx = { .config = &config };
+    printf("Building zone: %llu records over %d TLDs (%s)...\n",
+           (unsigned long long)config.records, config.tlds, config.use_snapshot ? "snapshot" : "in-memory");
+    uint64_t build_start = bench_now_ns();
+    if (build_zone(&config, &ctx.tld_manager) != 0) {
+        fprintf(stderr, "Failed to build the synthetic zone\n");
+        bench_json_close();
+        return 1;
+    }
+    printf("Zone ready in %.2f s\n\n", (double)(bench_now_ns() - build_start) / 1e9);
+
+    static const struct {
+        const char* name;
+        resolver_op_t op;
+    } benchmarks[] = {
+        { "resolve", OP_RESOLVE },
+        { "cache_lookup", OP_CACHE_LOOKUP },
+        { "cache_insert", OP_CACHE_INSERT },
+        { "parse_fqdn", OP_PARSE_FQDN },
+        { "find_tld", OP_FIND_TLD },
+    };
+
+    int status = 0;
+    bench_print_header();
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if (!bench_selected(selected, benchmarks[i].name)) continue;
+        if (run_benchmark(&ctx, benchmarks[i].name, benchmarks[i].op) != 0) {
+            fprintf(stderr, "Benchmark %s failed to run\n", benchmarks[i].name);
+            status = 1;
+        }
+    }
+
+    if (ctx.resolver) {
+        destroy_cache(ctx.resolver->cache);
+        cleanup_dns_resolver(ctx.resolver);
+    }
+    cleanup_tld_manager(ctx.tld_manager);
+    bench_json_close();
+    return status;
+}
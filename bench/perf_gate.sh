@@ -0,0 +1,119 @@
+#!/bin/bash
+
+# NEXUS performance regression gate
+# Runs the resolver, codec, crypto and loopback QUIC benchmarks with fixed
+# parameters, writes their results as JSON and compares them against the
+# committed baseline with bench_compare. Needs no network: the load
+# generator talks to a nexus server started here on [::1]:10053.
+#
+# Usage: bench/perf_gate.sh [--update]
+#   --update   Write the results to the baseline instead of comparing
+#
+# Environment:
+#   PERF_BASELINE           Baseline file (default: bench/baseline.json)
+#   PERF_THRESHOLD          Allowed throughput/per-op regression in % (default: 15)
+#   PERF_LATENCY_THRESHOLD  Allowed latency regression in % (default: 40, tails are noisy)
+#   PERF_RUNS               Runs per benchmark, best value kept (default: 3)
+#   PERF_SKIP_LOADGEN       Set to skip the loopback QUIC run; its baseline
+#                           rows are then not required
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+ROOT_DIR="$(dirname "$SCRIPT_DIR")"
+BUILD_DIR="$ROOT_DIR/build"
+
+BASELINE="${PERF_BASELINE:-$SCRIPT_DIR/baseline.json}"
+THRESHOLD="${PERF_THRESHOLD:-15}"
+LATENCY_THRESHOLD="${PERF_LATENCY_THRESHOLD:-40}"
+RUNS="${PERF_RUNS:-3}"
+
+UPDATE=0
+if [ "$1" = "--update" ]; then
+    UPDATE=1
+elif [ -n "$1" ]; then
+    echo "Usage: $0 [--update]"
+    exit 2
+fi
+
+RESULTS_DIR="$(mktemp -d)"
+SERVER_PID=""
+cleanup() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null
+        wait "$SERVER_PID" 2>/dev/null
+    fi
+    rm -rf "$RESULTS_DIR"
+}
+trap cleanup EXIT
+
+BINS="bench_resolver bench_codec bench_crypto bench_compare"
+if [ -z "$PERF_SKIP_LOADGEN" ]; then
+    BINS="$BINS nexus bench_loadgen"
+fi
+for bin in $BINS; do
+    if [ ! -x "$BUILD_DIR/$bin" ]; then
+        echo "Missing $BUILD_DIR/$bin; run 'make bench' first"
+        exit 2
+    fi
+done
+
+# run_suite <name> <binary> <args...>: RUNS runs, one JSON file each
+run_suite() {
+    local name="$1" bin="$2"
+    shift 2
+    for run in $(seq 1 "$RUNS"); do
+        echo "Running $name benchmarks ($run/$RUNS)..."
+        if ! "$BUILD_DIR/$bin" "$@" --json "$RESULTS_DIR/$name-$run.json" > "$RESULTS_DIR/$name-$run.log" 2>&1; then
+            echo "$name benchmarks failed:"
+            tail -n 20 "$RESULTS_DIR/$name-$run.log"
+            return 1
+        fi
+    done
+}
+
+status=0
+run_suite resolver bench_resolver --records 20000 --ops 100000 || status=1
+run_suite codec bench_codec --time-ms 200 || status=1
+# RSA key generation searches for primes, so its cost (and that of plain
+# issuance) varies too much run to run to gate on
+run_suite crypto bench_crypto --time-ms 500 \
+    --bench falcon_keygen,falcon_sign,falcon_sign_expanded,falcon_verify,x509_sign,x509_verify,verify_cert,verify_cert_cached ||
+    status=1
+
+COMPARE_ARGS=()
+if [ -z "$PERF_SKIP_LOADGEN" ]; then
+    echo "Starting nexus server for the loopback QUIC run..."
+    (cd "$RESULTS_DIR" && exec "$BUILD_DIR/nexus" --mode private --hostname bench.local \
+        > "$RESULTS_DIR/nexus.log" 2>&1) &
+    SERVER_PID=$!
+    sleep 2
+    if ! run_suite loadgen bench_loadgen --duration 5 --connections 2 --streams 8 --interval 0; then
+        echo "Loopback QUIC run failed; server log:"
+        tail -n 20 "$RESULTS_DIR/nexus.log"
+        status=1
+    fi
+    kill "$SERVER_PID" 2>/dev/null
+    wait "$SERVER_PID" 2>/dev/null
+    SERVER_PID=""
+else
+    echo "Skipping the loopback QUIC run (PERF_SKIP_LOADGEN)"
+    COMPARE_ARGS+=(--skip-suite loadgen)
+fi
+
+if [ $status -ne 0 ]; then
+    echo "Benchmarks failed; not comparing"
+    exit 1
+fi
+
+if [ $UPDATE -eq 1 ]; then
+    "$BUILD_DIR/bench_compare" --output "$BASELINE" "$RESULTS_DIR"/*.json
+    exit $?
+fi
+
+if [ ! -f "$BASELINE" ]; then
+    echo "No baseline at $BASELINE; create one with 'make bench_baseline'"
+    exit 2
+fi
+
+echo
+"$BUILD_DIR/bench_compare" --baseline "$BASELINE" --threshold "$THRESHOLD" \
+    --latency-threshold "$LATENCY_THRESHOLD" "${COMPARE_ARGS[@]}" "$RESULTS_DIR"/*.json
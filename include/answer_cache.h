@@ -0,0 +1,55 @@
+#ifndef ANSWER_CACHE_H
+#define ANSWER_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "tld_manager.h"
+
+// Cache of serialized DNS_RESPONSE packets for the QUIC server.
+//
+// An entry holds the complete nexus_packet_t bytes answering a (name,
+// type, protocol version) query, so a hit skips resolving, copying records
+// and both serialization passes: the packet is copied out, the session ID
+// patched in and each record's TTL lowered by the entry's age. Entries
+// expire with their shortest TTL. Only successful answers are cached.
+//
+// The table is set-associative like the certificate verification cache.
+// Any record or TLD change bumps a generation counter, dropping every
+// entry: a record can feed answers for other names through CNAMEs, and
+// changes are rare next to queries.
+
+#define ANSWER_CACHE_DEFAULT_CAPACITY 4096
+#define ANSWER_CACHE_WAYS 4                 // Entries per set
+#define ANSWER_CACHE_MAX_PACKET 2048        // The server's response buffer size
+#define ANSWER_CACHE_MAX_RECORDS 16         // Larger answers are not cached
+
+typedef struct answer_cache_s answer_cache_t;
+
+int init_answer_cache(size_t capacity, answer_cache_t** cache_out);
+void cleanup_answer_cache(answer_cache_t* cache);
+
+// Invalidate on every TLD or record change made through the manager
+int attach_answer_cache(answer_cache_t* cache, tld_manager_t* manager);
+void detach_answer_cache(answer_cache_t* cache);
+
+// Copies the cached answer into out, ready to send. Returns its length, 0
+// on a miss, or -1 when out is too small.
+ssize_t answer_cache_lookup(answer_cache_t* cache, const char* name, uint16_t type, uint8_t version,
+                            uint64_t session_id, uint8_t* out, size_t out_len);
+
+// Read before resolving and passed to answer_cache_insert(), so an answer
+// resolved before a change cannot be cached after it
+uint64_t answer_cache_generation(answer_cache_t* cache);
+
+// Stores a serialized DNS_RESPONSE packet. Returns 0 when stored, -1 when
+// the answer is not cacheable (not a success, a zero TTL, too large) or
+// the cache was invalidated since `generation` was read.
+int answer_cache_insert(answer_cache_t* cache, uint64_t generation, const char* name, uint16_t type,
+                        uint8_t version, const uint8_t* packet, size_t packet_len);
+
+void answer_cache_invalidate(answer_cache_t* cache);
+
+void answer_cache_stats(answer_cache_t* cache, uint64_t* hits, uint64_t* misses);
+
+#endif // ANSWER_CACHE_H
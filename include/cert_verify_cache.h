@@ -0,0 +1,48 @@
+#ifndef CERT_VERIFY_CACHE_H
+#define CERT_VERIFY_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+// Cache of successful certificate verifications.
+//
+// Entries are keyed by the certificate's SHA-256 fingerprint together with
+// the verifying CA's fingerprint, so a result never carries over to another
+// CA. The table is set-associative with a fixed capacity; a full set evicts
+// its entry closest to expiry. Entries expire after the TTL or when the
+// certificate does, whichever comes first.
+//
+// Revoked fingerprints are kept in a separate, unbounded set so a
+// revocation cannot be evicted. Invalidating the cache (e.g. on CA key
+// rotation) bumps a generation counter instead of walking the table.
+
+#define CERT_VERIFY_CACHE_DEFAULT_CAPACITY 4096
+#define CERT_VERIFY_CACHE_DEFAULT_TTL 300       // Seconds
+#define CERT_VERIFY_CACHE_WAYS 4                // Entries per set
+
+typedef enum {
+    CERT_VERIFY_CACHE_MISS = 0,
+    CERT_VERIFY_CACHE_VALID,
+    CERT_VERIFY_CACHE_REVOKED
+} cert_verify_cache_result_t;
+
+typedef struct cert_verify_cache_s cert_verify_cache_t;
+
+int init_cert_verify_cache(size_t capacity, int ttl_seconds, cert_verify_cache_t** cache_out);
+void cleanup_cert_verify_cache(cert_verify_cache_t* cache);
+
+cert_verify_cache_result_t cert_verify_cache_lookup(cert_verify_cache_t* cache, const uint8_t cert_fp[32], const uint8_t ca_fp[32]);
+
+// Record a successful verification; not_after of 0 means no expiry of its own
+void cert_verify_cache_insert(cert_verify_cache_t* cache, const uint8_t cert_fp[32], const uint8_t ca_fp[32], time_t not_after);
+
+// Drop every entry for the certificate and reject it from now on
+int cert_verify_cache_revoke(cert_verify_cache_t* cache, const uint8_t cert_fp[32]);
+
+// Drop every cached verification (revocations are kept)
+void cert_verify_cache_invalidate(cert_verify_cache_t* cache);
+
+void cert_verify_cache_stats(cert_verify_cache_t* cache, uint64_t* hits, uint64_t* misses);
+
+#endif // CERT_VERIFY_CACHE_H
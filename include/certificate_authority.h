@@ -3,10 +3,12 @@
 
 #include <stdint.h>
 #include <time.h>
+#include <stdatomic.h>
 #include <openssl/x509.h>
 #include <openssl/evp.h>
 #include "network_context.h"
 #include "extern/falcon/falcon.h"
+#include "cert_verify_cache.h"
 
 /**
  * @file certificate_authority.h
@@ -27,6 +29,8 @@
 #define FALCON_PRIVKEY_SIZE_1024 FALCON_PRIVKEY_SIZE(FALCON_LOGN)
 #define FALCON_PUBKEY_SIZE_1024 FALCON_PUBKEY_SIZE(FALCON_LOGN)
 #define FALCON_SIG_LEN FALCON_SIG_PADDED_SIZE(FALCON_LOGN)
+#define FALCON_RESEED_INTERVAL 4096     // Signatures per thread between PRNG reseeds
+#define CA_BATCH_DEFAULT_WORKERS 4      // Batch issuance threads when the CPU count is unknown
 
 // Certificate types
 typedef enum {
@@ -58,12 +62,24 @@ typedef struct ca_context_s {
     // Falcon post-quantum keys
     uint8_t falcon_private_key[FALCON_PRIVKEY_SIZE_1024];
     uint8_t falcon_public_key[FALCON_PUBKEY_SIZE_1024];
+    uint8_t *falcon_expanded_key;   // Precomputed signing tree (NULL if expansion failed)
+    cert_verify_cache_t *verify_cache; // Successful verifications (NULL disables caching)
+    uint8_t ca_fingerprint[32];     // SHA-256 of the CA certificate, part of every cache key
+    atomic_long next_serial;        // Next certificate serial number
 } ca_context_t;
 
 // Function declarations
 int init_certificate_authority(network_context_t* net_ctx, ca_context_t** ca_ctx);
 int ca_issue_certificate(ca_context_t* ca_ctx, const char* common_name, nexus_cert_t** cert_out);
+
+// Issue count certificates across workers threads (<= 0: one per CPU).
+// certs_out[i] gets serial first + i for one contiguous block of serials.
+// All or nothing: on failure every issued certificate is freed.
+int ca_issue_certificates_batch(ca_context_t* ca_ctx, const char** common_names, size_t count,
+                                int workers, nexus_cert_t** certs_out);
 int verify_certificate(nexus_cert_t* cert, ca_context_t* ca);
+int ca_revoke_certificate(ca_context_t* ca, nexus_cert_t* cert);
+void ca_invalidate_verification_cache(ca_context_t* ca);   // Call after rotating the CA key
 void free_certificate(nexus_cert_t* cert);
 void cleanup_certificate_authority(ca_context_t* ca_ctx);
 
@@ -72,4 +88,13 @@ int generate_falcon_keypair(uint8_t *public_key, uint8_t *private_key);
 int falcon_sign(const uint8_t *private_key, const void *data, size_t data_len, uint8_t *signature);
 int falcon_verify_sig(const uint8_t *public_key, const void *data, size_t data_len, const uint8_t *signature);
 
+// Signing with a pre-expanded private key (falcon_sign_tree). The PRNG and
+// scratch buffers behind all Falcon calls are per-thread and reused.
+uint8_t *falcon_expand_private_key(const uint8_t *private_key);
+void free_falcon_expanded_key(uint8_t *expanded_key);
+int falcon_sign_expanded(const uint8_t *expanded_key, const void *data, size_t data_len, uint8_t *signature);
+
+// Sign with the CA key, using the expanded form when available
+int ca_falcon_sign(ca_context_t *ca_ctx, const void *data, size_t data_len, uint8_t *signature);
+
 #endif
\ No newline at end of file
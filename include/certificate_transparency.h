@@ -7,42 +7,81 @@
 #include "certificate_authority.h"
 #include "network_context.h"
 
-// Maximum number of entries in the CT log
-#define CT_LOG_MAX_ENTRIES 10000
+// Recent entries kept in memory by a store-backed log (see open_ct_log)
+#define CT_LOG_RECENT_ENTRIES 1024
+
+struct ct_log_store_s;
 
 // CT log entry structure (simplified)
 typedef struct {
     uint64_t timestamp;
     nexus_cert_t *cert;
-    uint8_t signature[256];   // Simplified signature
+    uint8_t signature[256];   // SCT signature by the log key over the leaf
+    size_t signature_len;
     uint8_t log_id[32];       // Log identifier
     int log_entry_type;       // Type of log entry
+    uint8_t leaf_hash[32];    // RFC 6962 leaf hash, SHA-256(0x00 || leaf)
+    uint64_t index;           // Position in the log
 } ct_entry_t;
 
+// Append-only Merkle tree (RFC 6962). levels[k][i] caches the hash of the
+// complete subtree of 2^k leaves starting at leaf i << k, so appends touch
+// O(log n) hashes and proofs are assembled without rehashing the log.
+#define CT_MERKLE_MAX_LEVELS 48
+
+typedef struct {
+    uint8_t (*levels[CT_MERKLE_MAX_LEVELS])[32];
+    size_t level_capacity[CT_MERKLE_MAX_LEVELS];
+    uint64_t leaf_count;
+} merkle_tree_t;
+
+// Signed tree head
+typedef struct {
+    uint64_t tree_size;
+    uint64_t timestamp;
+    uint8_t root_hash[32];
+    uint8_t signature[512];
+    size_t signature_len;
+} ct_signed_tree_head_t;
+
+// Batched submission: entries queue until max_batch are waiting or the
+// oldest has waited max_delay_ms, then share one store sync and one STH.
+#define CT_BATCH_DEFAULT_DELAY_MS 20
+#define CT_BATCH_DEFAULT_SIZE 256
+
+typedef struct {
+    int max_delay_ms;
+    size_t max_batch;
+} ct_batch_config_t;
+
+// SCT-style inclusion promise: instead of a signature per entry, the batch
+// tree head is signed once and each entry gets its path to that head.
+typedef struct {
+    uint64_t leaf_index;
+    uint64_t timestamp;
+    uint8_t leaf_hash[32];
+    ct_signed_tree_head_t sth;              // Tree head of the batch, covers leaf_index
+    uint8_t path[CT_MERKLE_MAX_LEVELS][32]; // Inclusion path to sth.root_hash
+    size_t path_len;
+} ct_sct_t;
+
+struct ct_batcher_s;
+
 // CT log structure (simplified)
 typedef struct ct_log_s {
     char *log_id;
     char *log_url;
     void *signing_key;        // EVP_PKEY pointer (opaque)
-    ct_entry_t *entries;
+    ct_entry_t *entries;      // All entries, or a ring of recent ones when store is set
     size_t entry_count;
-    size_t max_entries;
+    size_t max_entries;       // Allocated capacity, grows on demand without a store
+    struct ct_log_store_s *store; // On-disk segments + index (NULL for in-memory logs)
+    struct ct_batcher_s *batcher; // Submission queue (NULL unless batching is started)
+    merkle_tree_t tree;
+    ct_signed_tree_head_t sth; // Latest signed tree head (tree_size 0 until first request)
     pthread_mutex_t lock;
 } ct_log_t;
 
-// Merkle tree node structure
-typedef struct merkle_node {
-    uint8_t hash[32];          // SHA-256 hash
-    struct merkle_node *left;
-    struct merkle_node *right;
-} merkle_node_t;
-
-// Merkle tree structure
-typedef struct {
-    merkle_node_t *root;
-    int leaf_count;
-} merkle_tree_t;
-
 // Proof structure for certificate inclusion (simplified)
 typedef struct {
     nexus_cert_t *cert;        // Certificate for which the proof is generated
@@ -53,25 +92,79 @@ typedef struct {
     int path_len;              // Length of the path
     uint8_t root_hash[32];     // Root hash of the Merkle tree
     uint64_t timestamp;        // Timestamp of the proof
+    uint64_t leaf_index;       // Position of the entry in the log
+    uint64_t tree_size;        // Size of the tree root_hash belongs to
 } merkle_proof_t;
 
+// Consistency proof between two tree sizes of the same log
+typedef struct {
+    uint64_t first_size;
+    uint64_t second_size;
+    uint8_t (*path)[32];
+    size_t path_len;
+} ct_consistency_proof_t;
+
 // Function declarations
 ct_log_t* init_certificate_transparency(network_context_t *net_ctx);
 void cleanup_certificate_transparency(ct_log_t *ct_log);
 
 // CT log operations (simplified signatures)
 ct_log_t* create_ct_log(const char* log_id, const char* log_url);
+ct_log_t* open_ct_log(const char* log_id, const char* log_url, const char* dir);
 int add_certificate_to_ct_log(ct_log_t* log, nexus_cert_t* cert);
 int verify_certificate_signature(nexus_cert_t* cert, ca_context_t* ca_ctx);
-int ct_sign_certificate(ct_log_t* log, nexus_cert_t* cert);
 void cleanup_ct_log(ct_log_t* log);
 
-// Merkle tree operations (simplified)
+// Batched submission. ct_log_submit_batch returns how many certificates,
+// from the front, were logged (-1 on bad input); a zero sth.tree_size in
+// their SCTs means the tree head could not be signed. ct_sign_certificate
+// blocks until the batch holding cert is durable and its tree head signed,
+// then fills sct_out (optional).
+int ct_log_submit_batch(ct_log_t* log, nexus_cert_t** certs, size_t count, ct_sct_t* scts_out);
+int start_ct_log_batching(ct_log_t* log, const ct_batch_config_t* config);
+void stop_ct_log_batching(ct_log_t* log);
+int ct_sign_certificate(ct_log_t* log, nexus_cert_t* cert, ct_sct_t* sct_out);
+int verify_ct_sct(ct_log_t* log, const nexus_cert_t* cert, const ct_sct_t* sct);
+
+// ca_issue_certificates_batch followed by one ct_log_submit_batch. Returns
+// how many certificates were logged and handed out in certs_out; the rest
+// are freed and set to NULL. -1 if issuance itself failed.
+int ct_issue_certificates_batch(ca_context_t* ca_ctx, ct_log_t* log, const char** common_names, size_t count,
+                                int workers, nexus_cert_t** certs_out, ct_sct_t* scts_out);
+
+// Entry access: out receives a deep copy, release it with ct_free_entry()
+int ct_log_get_entry(ct_log_t* log, uint64_t index, ct_entry_t* out);
+void ct_free_entry(ct_entry_t* entry);
+
+// Merkle tree operations
 int verify_merkle_proof(ct_entry_t* entry_to_verify, merkle_proof_t* proof);
 merkle_proof_t* generate_merkle_proof(ct_log_t* log, size_t entry_index);
 void free_merkle_proof(merkle_proof_t* proof);
 
-// Network operations (stubs for now)
+uint64_t ct_log_size(ct_log_t* log);
+int ct_log_root_hash(ct_log_t* log, uint64_t tree_size, uint8_t root_out[32]);
+ct_consistency_proof_t* generate_ct_consistency_proof(ct_log_t* log, uint64_t first_size, uint64_t second_size);
+int verify_ct_consistency_proof(const ct_consistency_proof_t* proof, const uint8_t first_root[32], const uint8_t second_root[32]);
+void free_ct_consistency_proof(ct_consistency_proof_t* proof);
+
+// Signed tree heads: signed with the log key over the RFC 6962 TreeHeadSignature
+int ct_log_get_sth(ct_log_t* log, ct_signed_tree_head_t* sth_out);
+int verify_ct_sth(ct_log_t* log, const ct_signed_tree_head_t* sth);
+int verify_ct_sth_with_key(const uint8_t* pubkey_der, size_t pubkey_len, const ct_signed_tree_head_t* sth);
+int ct_log_public_key(ct_log_t* log, uint8_t** der_out, size_t* len_out);
+
+// RFC 6962 leaf hash of cert logged at timestamp (covers the DER if any)
+int ct_leaf_hash(const nexus_cert_t* cert, uint64_t timestamp, uint8_t hash_out[32]);
+
+// Replication: append another log's entries (leaf hashes as given) only if
+// the resulting root is consistent with target_root via proof, which runs
+// from the new size to the peer's tree size. Takes ownership of the certs;
+// callers check the leaf hashes against the certs with ct_leaf_hash().
+int ct_log_append_replicated(ct_log_t* log, ct_entry_t* entries, size_t count,
+                             const ct_consistency_proof_t* proof, const uint8_t target_root[32]);
+
+// Gossip one round with the peers registered in net_ctx->ct_gossip
+// (implemented in ct_gossip.c)
 int sync_ct_log_with_peers(ct_log_t *ct_log, network_context_t *net_ctx);
 
 #endif // CERTIFICATE_TRANSPARENCY_H 
\ No newline at end of file
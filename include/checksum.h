@@ -0,0 +1,11 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-32 (IEEE 802.3, reflected). Pass 0 to start, or a previous result to
+// continue a running checksum over several buffers.
+uint32_t crc32_update(uint32_t crc, const void* data, size_t len);
+
+#endif // CHECKSUM_H
@@ -24,7 +24,9 @@ typedef enum {
     CLI_CMD_VERIFY_CERT,
     CLI_CMD_SEND_DATA,
     CLI_CMD_LOOKUP,
-    CLI_CMD_CONFIGURE
+    CLI_CMD_CONFIGURE,
+    CLI_CMD_METRICS,
+    CLI_CMD_TRACES
 } cli_command_type_t;
 
 // CLI command structure
@@ -66,6 +68,8 @@ int cmd_verify_cert(const char *hostname);
 int cmd_send_data(const char *target_hostname, const char *data);
 int cmd_lookup(const char *hostname);
 int cmd_configure(void);
+int cmd_metrics(void);
+int cmd_traces(int binary);
 
 // IPC communication with service
 int connect_to_service(void);
@@ -31,6 +31,7 @@ typedef struct {
     int enable_ct;             // Enable Certificate Transparency
     char *ct_log_path;         // Path to CT log
     char *tld_list_path;       // Path to TLD list
+    char *db_path;             // TLD database (SQLite), NULL keeps TLDs in memory only
 } network_profile_t;
 
 // Configuration structure
@@ -39,7 +40,7 @@ typedef struct {
     char *default_profile;     // Default profile name
     int auto_detect_network;   // Auto-detect network settings
     int run_as_service;        // Run as a service
-    int log_level;             // Logging level
+    int log_level;             // Minimum LOG_LEVEL_* logged (debug.h)
     char *log_file;            // Log file path
     network_profile_t **profiles; // Array of network profiles
     int profile_count;         // Number of profiles
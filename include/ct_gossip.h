@@ -0,0 +1,79 @@
+#ifndef CT_GOSSIP_H
+#define CT_GOSSIP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include "certificate_transparency.h"
+#include "packet_protocol.h"
+
+// Gossip-based CT log synchronization.
+//
+// Each round a node sends its signed tree head to a peer (CT_STH_REQ) and
+// gets the peer's head back with a consistency proof from the sender's size
+// (CT_STH_RESP). If the peer is ahead, the missing leaf range is fetched in
+// chunks (CT_ENTRIES_REQ/RESP), several requests pipelined per exchange on
+// one stream. Every chunk carries a proof from its end to the peer's head,
+// so leaves are only committed once they provably extend to that head, and
+// every leaf carries its certificate (with DER), whose hash must match.
+//
+// A split view is any pair of heads that cannot both be honest: equal sizes
+// with different roots, a failed consistency proof, a head that shrinks, or
+// a signing key that changes after first contact.
+
+#define CT_GOSSIP_MAX_PEERS 16
+#define CT_GOSSIP_PIPELINE_DEPTH 8          // Entry requests per exchange
+#define CT_GOSSIP_DEFAULT_INTERVAL_MS 30000
+
+typedef enum {
+    CT_GOSSIP_IN_SYNC = 0,
+    CT_GOSSIP_CAUGHT_UP,            // Fetched and committed missing entries
+    CT_GOSSIP_PEER_BEHIND,          // Peer is a consistent prefix of us
+    CT_GOSSIP_SPLIT_VIEW,
+    CT_GOSSIP_BAD_SIGNATURE,
+    CT_GOSSIP_UNREACHABLE
+} ct_gossip_status_t;
+
+// Transport hook: send request bytes (one or more concatenated NEXUS
+// packets) on one stream and return the concatenated responses in a
+// malloc'd buffer. Returns the response length or < 0 on error.
+typedef ssize_t (*ct_gossip_exchange_fn)(void* ctx, const uint8_t* request, size_t request_len, uint8_t** response_out);
+
+typedef struct {
+    char name[64];
+    ct_gossip_exchange_fn exchange;
+    void* ctx;
+    uint8_t pubkey[NEXUS_CT_MAX_PUBKEY_LEN];    // Pinned on first contact
+    size_t pubkey_len;
+    ct_signed_tree_head_t last_sth;             // Latest verified head from this peer
+    ct_gossip_status_t last_status;
+    int split_view;                             // Sticky once detected
+} ct_gossip_peer_t;
+
+typedef struct ct_gossip_s {
+    ct_log_t* log;
+    ct_gossip_peer_t peers[CT_GOSSIP_MAX_PEERS];
+    size_t peer_count;
+    int interval_ms;
+    uint64_t last_round_ms;
+    pthread_mutex_t lock;                       // Serializes rounds and the peer table
+} ct_gossip_t;
+
+// Lifecycle
+int init_ct_gossip(ct_log_t* log, int interval_ms, ct_gossip_t** gossip_out);
+void cleanup_ct_gossip(ct_gossip_t* gossip);
+int ct_gossip_add_peer(ct_gossip_t* gossip, const char* name, ct_gossip_exchange_fn exchange, void* ctx);
+
+// Client side: one round with one peer or all of them. ct_gossip_round
+// returns -1 if any peer presented a split view. ct_gossip_tick only runs a
+// round once interval_ms has passed since the last one.
+ct_gossip_status_t ct_gossip_sync_peer(ct_gossip_t* gossip, size_t peer_index);
+int ct_gossip_round(ct_gossip_t* gossip);
+int ct_gossip_tick(ct_gossip_t* gossip);
+
+// Server side: answer a CT_STH_REQ or CT_ENTRIES_REQ packet. Returns a
+// malloc'd serialized response packet, or -1 for other packet types.
+int ct_gossip_handle_packet(ct_log_t* log, const nexus_packet_t* request, uint8_t** response_out, size_t* response_len_out);
+
+#endif // CT_GOSSIP_H
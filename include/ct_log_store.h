@@ -0,0 +1,43 @@
+#ifndef CT_LOG_STORE_H
+#define CT_LOG_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "certificate_transparency.h"
+
+// Append-only on-disk storage for CT log entries.
+//
+// <dir>/segment-NNNNNNNN.dat  serialized entries, rolled at CT_SEGMENT_MAX_BYTES
+// <dir>/index.dat             mmap'd header + one fixed-size record per entry
+//                             (segment, offset, length, leaf hash)
+// <dir>/log.key               the log's signing key (PEM, 0600)
+//
+// The index count in the header is the commit point: an entry exists once
+// its segment bytes and index record are written and the count covers it.
+// Reopening maps the index, checks every record's CRC and rebuilds nothing
+// but the Merkle levels. Records keep the certificate DER, if any, so a
+// reloaded entry hashes to the same leaf.
+
+#define CT_SEGMENT_MAX_BYTES (64u * 1024 * 1024)
+
+typedef struct ct_log_store_s ct_log_store_t;
+
+int open_ct_log_store(const char* dir, ct_log_store_t** store_out);
+void close_ct_log_store(ct_log_store_t* store);
+
+uint64_t ct_log_store_count(const ct_log_store_t* store);
+const char* ct_log_store_dir(const ct_log_store_t* store);
+
+// Appends are not durable until ct_log_store_sync() returns
+int ct_log_store_append(ct_log_store_t* store, const ct_entry_t* entry);
+int ct_log_store_sync(ct_log_store_t* store);
+
+// Forget every record from count on, e.g. appends whose sync failed
+int ct_log_store_truncate(ct_log_store_t* store, uint64_t count);
+
+// Random access by index. ct_log_store_read allocates out->cert; release it
+// with ct_free_entry().
+int ct_log_store_read(ct_log_store_t* store, uint64_t index, ct_entry_t* out);
+int ct_log_store_leaf_hash(const ct_log_store_t* store, uint64_t index, uint8_t hash_out[32]);
+
+#endif // CT_LOG_STORE_H
@@ -3,8 +3,82 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
 
-// Debug logging function
-void dlog(const char *format, ...);
+// Levelled logging.
+//
+// A message below the compile-time floor (LOG_COMPILE_LEVEL) is removed by
+// the compiler; one below the runtime level costs a relaxed load and a
+// compare, and its arguments are never evaluated.
+//
+// Until init_logging() starts the writer thread, messages are written to
+// stdout as they are logged. Afterwards each thread formats into its own
+// ring buffer and the writer drains all rings in batches, so logging never
+// takes a lock or touches stdio on the calling thread. A full ring drops
+// the message and counts it rather than block.
+//
+// Each thread allows LOG_RATE_BURST messages per call site every
+// LOG_RATE_WINDOW seconds; the rest are counted and summarised the next
+// time that call site logs.
 
-#endif /* DEBUG_H */
\ No newline at end of file
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+#ifndef LOG_COMPILE_LEVEL
+#ifdef DEBUG
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+#define LOG_RING_SLOTS 256              // Messages buffered per thread
+#define LOG_MESSAGE_MAX 240             // Longer messages are truncated
+#define LOG_FLUSH_INTERVAL_MS 50
+#define LOG_RATE_WINDOW 1               // Seconds
+#define LOG_RATE_BURST 50
+
+extern atomic_int dlog_level;
+
+#define dlog_enabled(level) \
+    ((level) >= LOG_COMPILE_LEVEL && (level) >= atomic_load_explicit(&dlog_level, memory_order_relaxed))
+
+#define log_at(level, ...) \
+    do { if (dlog_enabled(level)) dlog_write((level), __VA_ARGS__); } while (0)
+
+#define log_debug(...) log_at(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define log_info(...)  log_at(LOG_LEVEL_INFO, __VA_ARGS__)
+#define log_warn(...)  log_at(LOG_LEVEL_WARN, __VA_ARGS__)
+#define log_error(...) log_at(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// General progress messages
+#define dlog(...) log_info(__VA_ARGS__)
+
+// Hex dump of up to the first 32 bytes of a buffer
+#define log_hex(level, label, data, len) \
+    do { if (dlog_enabled(level)) dlog_write_hex((level), (label), (data), (len)); } while (0)
+
+void dlog_write(int level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void dlog_write_hex(int level, const char *label, const void *data, size_t len);
+
+// Start the writer thread; path NULL logs to stdout
+int init_logging(int level, const char *path);
+void cleanup_logging(void);
+
+void set_log_level(int level);
+int get_log_level(void);
+
+// "debug", "info", "warn" or "error"; -1 if unknown
+int parse_log_level(const char *name);
+
+// Write out everything buffered so far
+void dlog_flush(void);
+
+void dlog_stats(uint64_t *written, uint64_t *dropped, uint64_t *suppressed);
+
+#endif /* DEBUG_H */
@@ -0,0 +1,57 @@
+#ifndef DNS_FRONTEND_H
+#define DNS_FRONTEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "dns_resolver.h"
+
+// Classic DNS listener (RFC 1035 over UDP and TCP) in front of the NEXUS
+// resolver, so ordinary stub resolvers can use a node directly and share
+// its cache and TLD manager with QUIC clients.
+//
+// UDP is served by udp_workers threads, each with its own socket bound to
+// the same port (SO_REUSEPORT), reading and answering datagrams in batches
+// with recvmmsg/sendmmsg. Answers that exceed the client's EDNS0 buffer
+// size (512 bytes without EDNS0) are truncated with TC set, and the
+// client retries on the TCP listener. One poll() thread does TCP I/O and
+// hands complete requests to tcp_workers threads, so a slow upstream
+// lookup holds up only its own connection. Both worker counts default to
+// the number of CPUs, at most DNS_FRONTEND_MAX_WORKERS.
+
+#define DNS_FRONTEND_DEFAULT_PORT 53
+#define DNS_FRONTEND_DEFAULT_TCP_CLIENTS 64
+#define DNS_FRONTEND_DEFAULT_TCP_IDLE_MS 10000   // RFC 7766 section 6.2.3
+#define DNS_FRONTEND_MAX_WORKERS 32
+#define DNS_FRONTEND_MAX_EDNS_SIZE 4096
+
+typedef struct {
+    const char* bind_address;       // Numeric address; NULL or "::" for every address
+    uint16_t port;                  // 0 picks a free port, see dns_frontend_port()
+    int udp_workers;
+    int tcp_workers;                // Threads resolving TCP requests
+    int tcp_max_clients;
+    int tcp_idle_timeout_ms;
+    uint16_t edns_udp_size;         // Largest UDP answer sent to EDNS0 clients
+} dns_frontend_config_t;
+
+typedef struct dns_frontend_s dns_frontend_t;
+
+void dns_frontend_default_config(dns_frontend_config_t* config);
+
+// Binds both listeners and starts their threads. The resolver must outlive
+// the frontend.
+int init_dns_frontend(const dns_frontend_config_t* config, dns_resolver_t* resolver, dns_frontend_t** frontend_out);
+void cleanup_dns_frontend(dns_frontend_t* frontend);
+
+// The bound port, useful after asking for port 0
+uint16_t dns_frontend_port(const dns_frontend_t* frontend);
+
+// Answers one DNS request message. udp_limit is the server's EDNS0 UDP
+// size for datagram transports, or 0 for stream transports, where the
+// answer may fill response_cap. Returns the answer length, or -1 when the
+// request gets no answer.
+ssize_t dns_frontend_answer(dns_resolver_t* resolver, const uint8_t* request, size_t request_len,
+                            uint16_t udp_limit, uint8_t* response, size_t response_cap);
+
+#endif // DNS_FRONTEND_H
@@ -5,13 +5,14 @@
 #include <stddef.h>
 #include "dns_types.h"
 #include "tld_manager.h"
+#include "query_arena.h"
 
 /**
  * @brief DNS Resolver Configuration
  * Contains settings for the DNS resolver behavior
  */
 typedef struct {
-    int max_recursion_depth;      // Maximum recursion depth for CNAME resolution
+    int max_recursion_depth;      // Maximum CNAMEs followed for one query
     int cache_ttl_min;            // Minimum TTL to cache records (seconds)
     int cache_ttl_max;            // Maximum TTL to cache records (seconds)
     int cache_size_max;           // Maximum number of entries in cache
@@ -29,6 +30,7 @@ typedef struct {
     dns_resolver_config_t config;  // Configuration
     dns_cache_t* cache;            // Pointer to the DNS cache
     tld_manager_t* tld_manager;    // Pointer to the TLD manager
+    struct dns_chain_cache_s* chain_cache; // Flattened CNAME chains (NULL when unavailable)
     pthread_mutex_t lock;          // Lock for the resolver state
 } dns_resolver_t;
 
@@ -74,6 +76,28 @@ dns_response_status_t resolve_dns_query(dns_resolver_t* resolver,
                                        dns_record_t** records,
                                        int* record_count);
 
+/**
+ * @brief Resolve a DNS query without heap allocations
+ * 
+ * Like resolve_dns_query(), but the record array and its strings come from
+ * the arena. They must not be freed and stay valid until the arena is
+ * reset. Records stored in the DNS cache are still copied with malloc.
+ * 
+ * @param resolver Pointer to the resolver
+ * @param query_name Name to resolve
+ * @param query_type Type of record to resolve
+ * @param arena The current request's arena
+ * @param records Pointer to store the resulting records (arena memory)
+ * @param record_count Pointer to store the number of records
+ * @return dns_response_status_t Status code of the resolution
+ */
+dns_response_status_t resolve_dns_query_in_arena(dns_resolver_t* resolver,
+                                                const char* query_name,
+                                                dns_record_type_t query_type,
+                                                query_arena_t* arena,
+                                                dns_record_t** records,
+                                                int* record_count);
+
 /**
  * @brief Parse a fully qualified domain name into components
  * 
@@ -116,14 +140,17 @@ int lookup_in_dns_cache(dns_resolver_t* resolver,
                        dns_record_t** record);
 
 /**
- * @brief Resolve CNAME records recursively
+ * @brief Resolve the chain of names starting at a CNAME target
+ * 
+ * Aliases are followed one hop at a time, at most max_recursion_depth
+ * hops in all. A CNAME loop or a longer chain is a SERVFAIL.
  * 
  * @param resolver Pointer to the resolver
  * @param cname_target The target of the CNAME record
  * @param target_type The type of record to resolve at the CNAME target
  * @param records Pointer to store the resulting records (will be allocated)
  * @param record_count Pointer to store the number of records
- * @param recursion_depth Current recursion depth (for limiting)
+ * @param recursion_depth CNAMEs already followed to reach cname_target
  * @return dns_response_status_t Status code of the resolution
  */
 dns_response_status_t resolve_cname(dns_resolver_t* resolver,
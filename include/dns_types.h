@@ -9,6 +9,10 @@
 
 // Forward declaration for tld_t to resolve circular dependency if any future struct needs it
 struct tld_s;
+struct tld_merkle_s;
+struct tld_manager_s;
+struct tld_snapshot_s;
+struct tld_snapshot_view_s;
 
 // DNS Record Types
 typedef enum {
@@ -50,6 +54,13 @@ typedef struct tld_s {
     size_t mirror_node_count;
     time_t created_at;
     time_t last_modified;
+    struct tld_merkle_s* merkle;    // Incremental record summary for mirror reconciliation
+    struct tld_manager_s* manager;  // Owning manager, used to publish mutations
+    // Records loaded from an mmap'd snapshot. `records` above then only holds
+    // the delta added since; removed base records are marked in the bitmap.
+    const struct tld_snapshot_view_s* base;
+    uint8_t* base_tombstones;
+    size_t base_removed_count;
     // char* admin_contact; // (Optional)
     // Other TLD specific metadata (e.g., policies)
 } tld_t;
@@ -75,12 +86,45 @@ typedef struct {
     pthread_mutex_t lock;
 } dns_cache_t;
 
-// TLD Manager Structure
+// TLD mutation notifications (persistence, journaling, cache invalidation)
+typedef enum {
+    TLD_MUTATION_REGISTER = 1,
+    TLD_MUTATION_ADD_RECORD,
+    TLD_MUTATION_REMOVE_RECORD,
+    TLD_MUTATION_ADD_AUTHORITATIVE_NODE,
+    TLD_MUTATION_ADD_MIRROR_NODE,
+    TLD_MUTATION_PRUNE_STALE_NODES
+} tld_mutation_type_t;
+
 typedef struct {
+    tld_mutation_type_t type;
+    const tld_t* tld;
+    const dns_record_t* record; // ADD_RECORD / REMOVE_RECORD
+    const tld_node_t* node;     // ADD_*_NODE
+    time_t stale_threshold;     // PRUNE_STALE_NODES
+} tld_mutation_t;
+
+// Called synchronously on the mutating thread, possibly with the manager
+// lock held. Listeners must copy what they need and must not call back
+// into the TLD manager.
+typedef void (*tld_mutation_listener_fn)(void* ctx, const tld_mutation_t* mutation);
+
+#define TLD_MAX_MUTATION_LISTENERS 4
+
+typedef struct {
+    tld_mutation_listener_fn fn;
+    void* ctx;
+} tld_mutation_listener_t;
+
+// TLD Manager Structure
+typedef struct tld_manager_s {
     tld_t** tlds;           // Dynamic array of pointers to TLDs
     size_t tld_count;       // Number of TLDs currently managed/known
     size_t tld_capacity;    // Current capacity of the tlds array
     pthread_rwlock_t lock;  // Read-write lock for concurrent access to TLD list
+    tld_mutation_listener_t listeners[TLD_MAX_MUTATION_LISTENERS];
+    size_t listener_count;
+    struct tld_snapshot_s* snapshot; // Backing mapping for tld_t.base, if loaded
 } tld_manager_t;
 
 // Functions for managing these types will be declared in other headers (e.g., dns_cache.h, tld_manager.h)
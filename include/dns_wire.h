@@ -0,0 +1,69 @@
+#ifndef DNS_WIRE_H
+#define DNS_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "dns_types.h"
+
+// RFC 1035 wire format for the classic DNS frontend.
+//
+// Requests are parsed in place and answers built straight into the
+// caller's buffer; nothing here allocates. The question is echoed back
+// byte for byte (keeping the requestor's letter case), owner names equal
+// to an earlier name in the message are written as compression pointers,
+// and EDNS0 (RFC 6891) OPT records are read and answered.
+
+#define DNS_WIRE_HEADER_LEN 12
+#define DNS_WIRE_MAX_MESSAGE 65535
+#define DNS_WIRE_CLASSIC_UDP_SIZE 512       // Without EDNS0
+#define DNS_WIRE_DEFAULT_EDNS_SIZE 1232     // Avoids IP fragmentation on common paths
+#define DNS_WIRE_OPT_RR_LEN 11
+
+#define DNS_WIRE_TYPE_OPT 41
+#define DNS_WIRE_CLASS_IN 1
+#define DNS_WIRE_RCODE_BADVERS 16           // Extended RCODE, carried partly in the OPT record
+
+// Header flag bits
+#define DNS_WIRE_FLAG_QR 0x8000
+#define DNS_WIRE_FLAG_AA 0x0400
+#define DNS_WIRE_FLAG_TC 0x0200
+#define DNS_WIRE_FLAG_RD 0x0100
+#define DNS_WIRE_FLAG_RA 0x0080
+#define DNS_WIRE_OPCODE(flags) (((flags) >> 11) & 0x0F)
+
+typedef struct {
+    uint16_t id;
+    uint16_t flags;                     // As received
+    char qname[MAX_DOMAIN_NAME_LEN];    // Lower case, no trailing dot; "" for the root
+    uint16_t qtype;
+    uint16_t qclass;
+    const uint8_t* question;            // The question section inside the request
+    size_t question_len;
+    int has_edns;
+    uint16_t edns_udp_size;             // Requestor's UDP payload size, at least 512
+    uint8_t edns_version;
+} dns_wire_query_t;
+
+// Parses a request. Returns 0 for a well-formed query, a DNS RCODE
+// (FORMERR, NOTIMP) when the request deserves an error answer, or -1 when
+// it must be dropped without one (too short to carry an ID, or a response).
+// After an RCODE, only the fields parsed so far are set; question_len is 0
+// when the question itself could not be read.
+int dns_wire_parse_query(const uint8_t* msg, size_t len, dns_wire_query_t* query);
+
+// Whether qtype is one of dns_record_type_t, i.e. answerable by the resolver
+int dns_wire_type_supported(uint16_t qtype);
+
+// Builds the answer to `query` in buf, never longer than max_len. Records
+// are the resolver's answer in order: the first is owned by the query
+// name and each CNAME moves ownership of the records after it to its
+// target. When the records do not fit, the answer is cut to the header,
+// question and OPT record with TC set, so the client retries over TCP.
+// Returns the message length, or -1 when a record cannot be encoded or
+// max_len cannot even hold the header and question.
+ssize_t dns_wire_build_response(const dns_wire_query_t* query, int rcode, int recursion_available,
+                                const dns_record_t* records, int record_count,
+                                uint16_t edns_udp_size, uint8_t* buf, size_t max_len);
+
+#endif // DNS_WIRE_H
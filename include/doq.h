@@ -0,0 +1,60 @@
+#ifndef DOQ_H
+#define DOQ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "dns_resolver.h"
+
+// DNS over QUIC (RFC 9250) on the NEXUS QUIC server.
+//
+// Clients that negotiate ALPN "doq" instead of "h3" send standard DNS
+// messages instead of nexus_packet_t framing: one query per client-opened
+// bidirectional stream, prefixed with its 2-byte length, answered the same
+// way on that stream before the server closes its side. Answers come from
+// the node's resolver through dns_frontend_answer().
+
+#define DOQ_ALPN "doq"
+#define DOQ_ALPN_LEN 3
+
+// Application error codes (RFC 9250 section 4.3)
+#define DOQ_NO_ERROR 0x0
+#define DOQ_INTERNAL_ERROR 0x1
+#define DOQ_PROTOCOL_ERROR 0x2
+#define DOQ_REQUEST_CANCELLED 0x3
+#define DOQ_EXCESSIVE_LOAD 0x4
+
+// doq_stream_receive() results
+#define DOQ_STREAM_INCOMPLETE 0
+#define DOQ_STREAM_READY 1
+
+// One DoQ request stream, kept as the stream's user data. The answer stays
+// here until the stream closes, as QUIC may need to retransmit it.
+typedef struct {
+    uint8_t length_prefix[2];       // Until the request buffer exists
+    uint8_t* request;               // Length prefix and query
+    size_t request_len;
+    size_t request_size;            // Whole request, once the prefix is known
+    uint8_t* response;              // Length prefix and answer
+    size_t response_len;
+    int answered;
+} doq_stream_t;
+
+int init_doq_stream(doq_stream_t** stream_out);
+void cleanup_doq_stream(doq_stream_t* stream);
+
+// Whether the negotiated ALPN selects DoQ
+int doq_alpn_selected(const unsigned char* alpn, unsigned int alpn_len);
+
+// Appends stream data; fin marks the client's end of the stream. Returns
+// DOQ_STREAM_READY once the whole query is in, DOQ_STREAM_INCOMPLETE while
+// more is expected, or -1 when the stream breaks RFC 9250 (an empty
+// message, a second message, or FIN before the query is complete).
+int doq_stream_receive(doq_stream_t* stream, const uint8_t* data, size_t len, int fin);
+
+// Answers a complete query. On success the length-prefixed answer is left
+// in stream->response and 0 returned; otherwise a DoQ error code to reset
+// the stream with.
+int doq_stream_answer(doq_stream_t* stream, dns_resolver_t* resolver);
+
+#endif // DOQ_H
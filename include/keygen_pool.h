@@ -0,0 +1,42 @@
+#ifndef KEYGEN_POOL_H
+#define KEYGEN_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <openssl/evp.h>
+
+// Pool of pre-generated key pairs for certificate issuance and CT logs.
+//
+// Worker threads run at idle priority (SCHED_IDLE where available) and keep
+// up to falcon_target Falcon-1024 pairs and rsa_target RSA-2048 keys ready.
+// Taking a key is a pop under a mutex; when the pool is empty, or when no
+// pool is installed, the caller generates the key inline as before.
+//
+// One pool can be installed process-wide with set_default_keygen_pool();
+// the CA and CT code draw from it.
+
+#define KEYGEN_POOL_DEFAULT_SIZE 16
+#define KEYGEN_POOL_DEFAULT_WORKERS 2
+#define KEYGEN_RSA_BITS 2048
+
+typedef struct keygen_pool_s keygen_pool_t;
+
+int init_keygen_pool(size_t falcon_target, size_t rsa_target, int workers, keygen_pool_t** pool_out);
+void cleanup_keygen_pool(keygen_pool_t* pool);
+
+// Fill public_key/private_key (FALCON_PUBKEY_SIZE_1024/FALCON_PRIVKEY_SIZE_1024)
+int keygen_pool_take_falcon(keygen_pool_t* pool, uint8_t* public_key, uint8_t* private_key);
+
+// Returns a new RSA key owned by the caller, or NULL
+EVP_PKEY* keygen_pool_take_rsa(keygen_pool_t* pool);
+
+// Block until both reserves are full or timeout_ms passes; 0 when full
+int keygen_pool_wait_ready(keygen_pool_t* pool, int timeout_ms);
+
+void keygen_pool_stats(keygen_pool_t* pool, size_t* falcon_ready, size_t* rsa_ready,
+                       uint64_t* hits, uint64_t* misses);
+
+void set_default_keygen_pool(keygen_pool_t* pool);
+keygen_pool_t* get_default_keygen_pool(void);
+
+#endif // KEYGEN_POOL_H
@@ -0,0 +1,95 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Process-wide counters and latency histograms.
+//
+// Every metric is known at compile time and lives in static storage, so
+// nothing needs initialising before the first update. Updates go to one of
+// METRICS_SHARDS shards picked per thread: a relaxed atomic add on a cache
+// line other threads rarely touch. Readers sum the shards.
+//
+// Histograms record microseconds in log-linear buckets (16 per power of
+// two, at most 6.25% relative error) and are rendered for Prometheus with
+// power-of-two bucket bounds in seconds.
+
+#define METRICS_SHARDS 16
+#define METRICS_PACKET_TYPE_SLOTS 32        // The last slot counts unknown types
+#define METRICS_HISTOGRAM_SUB_BITS 4
+#define METRICS_HISTOGRAM_MAX_EXPONENT 40   // Larger values are clamped (~25 days)
+#define METRICS_HISTOGRAM_BUCKETS \
+    ((1 << METRICS_HISTOGRAM_SUB_BITS) * (METRICS_HISTOGRAM_MAX_EXPONENT - METRICS_HISTOGRAM_SUB_BITS + 2))
+
+#define NEXUS_METRICS_SOCKET_ENV "NEXUS_METRICS_SOCKET"
+#define NEXUS_METRICS_SOCKET_NAME "nexus_metrics.sock"
+
+typedef enum {
+    METRIC_DNS_QUERIES = 0,
+    METRIC_DNS_NXDOMAIN,
+    METRIC_DNS_FAILURES,                // Any status other than success or NXDOMAIN
+    METRIC_DNS_CACHE_HITS,
+    METRIC_DNS_CACHE_MISSES,
+    METRIC_DNS_CACHE_INSERTS,
+    METRIC_DNS_CACHE_EXPIRED,
+    METRIC_UPSTREAM_QUERIES,
+    METRIC_UPSTREAM_FAILURES,
+    METRIC_STREAM_BYTES_RECEIVED,
+    METRIC_CONNECTIONS_ACCEPTED,
+    METRIC_CONNECTIONS_CLOSED,
+    METRIC_HANDSHAKES_COMPLETED,
+    METRIC_DNS_UDP_QUERIES,             // Classic DNS frontend
+    METRIC_DNS_TCP_QUERIES,
+    METRIC_DNS_TRUNCATED,
+    METRIC_DOQ_QUERIES,                 // DNS over QUIC (ALPN "doq")
+    METRIC_ANSWER_CACHE_HITS,           // QUIC DNS answers sent pre-serialized
+    METRIC_ANSWER_CACHE_MISSES,
+    METRIC_DNS_CNAME_CHAIN_HITS,        // Aliases answered from a flattened chain
+    METRIC_PACKETS_RECEIVED,            // Followed by one slot per packet type
+    METRIC_COUNTER_SLOTS = METRIC_PACKETS_RECEIVED + METRICS_PACKET_TYPE_SLOTS
+} metric_counter_t;
+
+typedef enum {
+    METRIC_RESOLVE_LATENCY = 0,
+    METRIC_UPSTREAM_RTT,
+    METRIC_HISTOGRAM_COUNT
+} metric_histogram_t;
+
+void metrics_add(metric_counter_t counter, uint64_t n);
+static inline void metrics_inc(metric_counter_t counter) { metrics_add(counter, 1); }
+void metrics_count_packet(int packet_type);
+void metrics_observe_us(metric_histogram_t histogram, uint64_t value_us);
+
+// Monotonic clock for latency measurements
+uint64_t metrics_now_us(void);
+
+uint64_t metrics_counter_value(metric_counter_t counter);
+uint64_t metrics_packet_count(int packet_type);
+void metrics_histogram_summary(metric_histogram_t histogram, uint64_t* count, uint64_t* sum_us);
+
+// Upper bound of the bucket holding quantile q (0..1); 0 when empty
+uint64_t metrics_histogram_quantile(metric_histogram_t histogram, double q);
+
+// Zero every metric; updates racing with the reset may survive it
+void metrics_reset(void);
+
+// Prometheus text exposition format; *out is malloc'd and owned by the caller
+int metrics_render_prometheus(char** out, size_t* out_len);
+
+// Serves the rendered metrics on a Unix socket: plain text to "METRICS"
+// requests (nexus_cli metrics), an HTTP response to "GET" requests. A
+// "TRACES" request gets the sampled query traces as Chrome trace JSON,
+// "TRACES BINARY" the compact binary dump (nexus_cli traces)
+typedef struct metrics_server_s metrics_server_t;
+
+// Socket shared by the service and nexus_cli unless --metrics-socket says
+// otherwise: $NEXUS_METRICS_SOCKET, else nexus_metrics.sock in
+// $XDG_RUNTIME_DIR, else /tmp/nexus_metrics-<uid>.sock
+int metrics_default_socket_path(char* buf, size_t len);
+
+// Fails rather than replace a socket another process is still serving
+int init_metrics_server(const char* socket_path, metrics_server_t** server_out);
+void cleanup_metrics_server(metrics_server_t* server);
+
+#endif // METRICS_H
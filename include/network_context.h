@@ -7,10 +7,15 @@
 #include "dns_types.h"
 #include "tld_manager.h"
 #include "dns_resolver.h"
+#include "persistence.h"
+#include "answer_cache.h"
 
 // Forward declarations to avoid circular dependencies
 typedef struct nexus_cert_s nexus_cert_t;
 typedef struct ca_context_s ca_context_t;
+struct ct_log_s;
+struct ct_gossip_s;
+struct tld_sync_s;
 
 // Main network context structure
 typedef struct {
@@ -25,6 +30,11 @@ typedef struct {
     ca_context_t *ca_ctx;       // Certificate authority context
     pthread_mutex_t lock;       // Lock for the context
     dns_cache_t *dns_cache;     // DNS cache
+    persistence_context_t *persistence; // Durable TLD storage (NULL when disabled)
+    struct ct_log_s *ct_log;    // Certificate transparency log (NULL when disabled)
+    struct ct_gossip_s *ct_gossip; // CT peer sync state (NULL when disabled)
+    answer_cache_t *answer_cache; // Serialized QUIC DNS answers (NULL when unavailable)
+    struct tld_sync_s *tld_sync; // TLD mirror anti-entropy (NULL when unavailable)
 } network_context_t;
 
 // Function to initialize the network context
@@ -39,4 +49,10 @@ int init_network_context_components(network_context_t* net_ctx);
 // Function to cleanup network context components
 void cleanup_network_context_components(network_context_t* net_ctx);
 
+// Restore TLDs from db_path and keep it updated via write-behind
+int enable_network_context_persistence(network_context_t* net_ctx, const char* db_path);
+
+// Open the CT log stored under dir and gossip its tree heads with peers
+int enable_network_context_ct_log(network_context_t* net_ctx, const char* dir);
+
 #endif // NETWORK_CONTEXT_H
\ No newline at end of file
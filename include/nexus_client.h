@@ -3,6 +3,7 @@
 
 #include "network_context.h"
 #include "certificate_authority.h"
+#include "packet_protocol.h"
 #include <ngtcp2/ngtcp2.h>
 #include <ngtcp2/ngtcp2_crypto.h>
 #include <stdint.h>
@@ -28,6 +29,10 @@ typedef struct nexus_crypto_ctx {
     ngtcp2_crypto_conn_ref conn_ref;
 } nexus_crypto_ctx;
 
+// Called for each packet read from a stream; packet is NULL when the data
+// did not decode. The packet is only valid for the duration of the call.
+typedef void (*nexus_client_response_fn)(void *user_data, int64_t stream_id, const nexus_packet_t *packet);
+
 typedef struct {
     ngtcp2_conn *conn;
     int sock;
@@ -43,6 +48,11 @@ typedef struct {
     // Added fields for new crypto and connection management logic
     ngtcp2_callbacks callbacks;       // Store ngtcp2 callbacks
     ngtcp2_settings settings;         // Store ngtcp2 settings
+
+    // Optional response hook, replaces the default logging. Cleared by
+    // init_nexus_client(), so set it afterwards.
+    nexus_client_response_fn on_response;
+    void *response_user_data;
 } nexus_client_config_t;
 
 // Update function declaration to match implementation
@@ -50,8 +60,24 @@ int init_nexus_client(network_context_t *net_ctx, const char *remote_addr,
                     uint16_t port, nexus_client_config_t *config);
 
 int nexus_client_connect(nexus_client_config_t *config);
+// Reads at most one datagram. Returns 1 if one was processed, 0 if none was
+// waiting and -1 on socket errors.
 int nexus_client_process_events(nexus_client_config_t *config);
 
+// Handles expired QUIC timers and sends whatever the connection has queued
+// (ACKs, retransmissions, flow control updates)
+int nexus_client_flush(nexus_client_config_t *config);
+
+// Sends CONNECTION_CLOSE so the server can drop the connection straight away
+void nexus_client_close(nexus_client_config_t *config);
+
+void nexus_client_cleanup(nexus_client_config_t *config);
+
+// Sends a packet as the whole of a new bidirectional stream. Returns the
+// stream ID, or < 0 on error: -4 when no stream can be opened and -5 when
+// the congestion window has no room for it yet.
+int64_t nexus_client_send_packet(nexus_client_config_t *config, const nexus_packet_t *packet);
+
 // New function to send a TLD registration request
 // Returns the stream ID used for the request, or < 0 on error.
 int64_t nexus_client_send_tld_register_request(nexus_client_config_t* client_config, const char* tld_name);
@@ -6,6 +6,7 @@
 #include <openssl/ssl.h>
 #include "certificate_authority.h"
 #include "network_context.h"
+#include "query_arena.h"
 #include <pthread.h>
 
 // Forward declaration of connection reference struct
@@ -33,6 +34,7 @@ typedef struct {
     nexus_server_crypto_ctx *crypto_ctx;
     int handshake_completed; // Flag to track if QUIC handshake has completed
     int cert_verified;       // Flag to track if Falcon certificate verification succeeded
+    query_arena_t *query_arena; // Per-request allocations, reset after each stream packet
     
     // Added fields for new crypto and connection management logic
     pthread_mutex_t lock;             // Mutex for synchronizing access to shared server resources
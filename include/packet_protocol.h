@@ -5,6 +5,7 @@
 #include <stddef.h> // For size_t
 #include <sys/types.h> // For ssize_t
 #include "dns_types.h" // Include for payload_dns_query_t, payload_dns_response_t
+#include "query_arena.h" // For deserializing into a request arena
 
 // NEXUS packet types
 typedef enum {
@@ -20,7 +21,17 @@ typedef enum {
     PACKET_TYPE_TLD_SYNC_UPDATE,
     PACKET_TYPE_TLD_SYNC_ACK,
     PACKET_TYPE_PEER_DISCOVERY,
-    PACKET_TYPE_HEARTBEAT
+    PACKET_TYPE_HEARTBEAT,
+    PACKET_TYPE_CT_STH_REQ,         // Sender's signed tree head
+    PACKET_TYPE_CT_STH_RESP,        // Receiver's head + consistency proof from the sender's size
+    PACKET_TYPE_CT_ENTRIES_REQ,     // Leaf range; several may be pipelined on one stream
+    PACKET_TYPE_CT_ENTRIES_RESP,
+    PACKET_TYPE_TLD_MERKLE_REQ,     // Hashes of some nodes on one level of a TLD's Merkle tree
+    PACKET_TYPE_TLD_MERKLE_RESP,
+    PACKET_TYPE_TLD_BUCKET_REQ,     // Records of some Merkle leaf buckets
+    PACKET_TYPE_TLD_BUCKET_RESP,
+    PACKET_TYPE_TLD_JOURNAL_REQ,    // Journal entries after a sequence (mirror deltas)
+    PACKET_TYPE_TLD_JOURNAL_RESP
 } nexus_packet_type_t;
 
 // NEXUS packet structure
@@ -43,9 +54,121 @@ typedef struct {
     char message[256];
 } payload_tld_register_resp_t;
 
+// CT gossip payloads. Hashes are raw 32-byte SHA-256 values.
+#define NEXUS_CT_MAX_PROOF_LEN 64
+#define NEXUS_CT_MAX_SIGNATURE_LEN 512
+#define NEXUS_CT_MAX_PUBKEY_LEN 1024
+#define NEXUS_CT_MAX_ENTRIES_PER_REQ 256
+
+typedef struct {
+    char log_id[64];
+    uint64_t tree_size;
+    uint64_t timestamp;
+    uint8_t root_hash[32];
+    uint16_t signature_len;
+    uint8_t signature[NEXUS_CT_MAX_SIGNATURE_LEN];
+    uint16_t pubkey_len;                            // DER SubjectPublicKeyInfo of the signer
+    uint8_t pubkey[NEXUS_CT_MAX_PUBKEY_LEN];
+} payload_ct_sth_t;
+
+typedef struct {
+    payload_ct_sth_t sth;
+    uint64_t proof_first_size;                      // 0 when no proof is included
+    uint16_t proof_len;
+    uint8_t proof[NEXUS_CT_MAX_PROOF_LEN][32];
+} payload_ct_sth_resp_t;
+
+typedef struct {
+    char log_id[64];
+    uint64_t start;
+    uint32_t count;
+    uint64_t tree_size;                             // Head the requester is syncing to
+} payload_ct_entries_req_t;
+
+typedef struct {
+    uint64_t timestamp;
+    uint8_t leaf_hash[32];
+    char *common_name;                              // u16 length-prefixed on the wire
+    int64_t not_before;
+    int64_t not_after;
+    uint8_t cert_type;
+    uint32_t signature_len;
+    uint8_t *signature;
+    uint32_t der_len;                               // Certificate DER, 0 without an X.509
+    uint8_t *der;
+} payload_ct_leaf_t;
+
+typedef struct {
+    uint64_t start;
+    uint32_t count;
+    uint64_t tree_size;
+    uint16_t proof_len;                             // Consistency proof (start + count) -> tree_size
+    uint8_t proof[NEXUS_CT_MAX_PROOF_LEN][32];
+    payload_ct_leaf_t *leaves;
+} payload_ct_entries_resp_t;
+
+// TLD anti-entropy payloads. Merkle levels count down from the root
+// (level 0, index 0); one level holds at most NEXUS_TLD_SYNC_MAX_NODES nodes.
+#define NEXUS_TLD_SYNC_MAX_NODES 1024
+#define NEXUS_TLD_SYNC_STATUS_OK 0
+#define NEXUS_TLD_SYNC_STATUS_UNKNOWN_TLD 1
+#define NEXUS_TLD_SYNC_STATUS_COMPACTED 2           // Deltas unavailable, walk the Merkle trees
+#define NEXUS_TLD_JOURNAL_MAX_ENTRIES 1024
+#define NEXUS_TLD_JOURNAL_MAX_BYTES (16u << 20)
+
+typedef struct {
+    char tld_name[64];
+    uint8_t level;
+    uint16_t count;
+    uint32_t *indices;
+} payload_tld_merkle_req_t;
+
+typedef struct {
+    char tld_name[64];
+    uint8_t status;
+    uint8_t level;
+    uint16_t count;
+    uint8_t (*hashes)[32];                          // One per requested index, in order
+} payload_tld_merkle_resp_t;
+
+typedef struct {
+    char tld_name[64];
+    uint16_t count;
+    uint32_t *buckets;
+} payload_tld_bucket_req_t;
+
+typedef struct {
+    char tld_name[64];
+    uint8_t status;
+    uint16_t bucket_count;
+    uint32_t *buckets;                              // Buckets the records below cover
+    uint32_t record_count;
+    dns_record_t *records;
+} payload_tld_bucket_resp_t;
+
+typedef struct {
+    uint64_t since_sequence;
+    uint32_t max_entries;
+} payload_tld_journal_req_t;
+
+typedef struct {
+    uint8_t status;
+    uint64_t last_sequence;                         // Newest durable entry on the sender
+    uint32_t entry_count;
+    uint32_t data_len;
+    uint8_t *data;                                  // Entries in the journal file format (tld_journal.h)
+} payload_tld_journal_resp_t;
+
+// Lower-case name for logs and metrics, "unknown" for unlisted types
+const char* get_packet_type_name(int type);
+
 // Serialization functions
+ssize_t get_serialized_nexus_packet_size(const nexus_packet_t *packet);
 ssize_t serialize_nexus_packet(const nexus_packet_t *packet, uint8_t *buffer, size_t buffer_len);
 ssize_t deserialize_nexus_packet(const uint8_t *buffer, size_t buffer_len, nexus_packet_t *packet);
+// Same, but packet->data comes from the arena and is not freed by the caller
+ssize_t deserialize_nexus_packet_in_arena(const uint8_t *buffer, size_t buffer_len, nexus_packet_t *packet,
+                                          query_arena_t *arena);
 
 ssize_t serialize_payload_tld_register_req(const payload_tld_register_req_t *payload, uint8_t *buffer, size_t buffer_len);
 ssize_t deserialize_payload_tld_register_req(const uint8_t *buffer, size_t buffer_len, payload_tld_register_req_t *payload);
@@ -62,9 +185,57 @@ ssize_t get_serialized_payload_dns_response_size(const payload_dns_response_t* p
 ssize_t serialize_payload_dns_response(const payload_dns_response_t* payload, uint8_t* out_buf, size_t out_buf_len);
 ssize_t deserialize_payload_dns_response(const uint8_t* data, size_t data_len, payload_dns_response_t* payload);
 
-// DNS Record Serialization/Deserialization (if they become standalone)
-// ssize_t get_serialized_dns_record_size(const dns_record_t* record);
-// ssize_t serialize_dns_record(const dns_record_t* record, uint8_t* out_buf, size_t out_buf_len);
-// ssize_t deserialize_dns_record(const uint8_t* data, size_t data_len, dns_record_t* record, size_t* rdata_len_out);
+// CT gossip payloads. deserialize_payload_ct_entries_resp allocates leaves;
+// release them with free_payload_ct_entries_resp().
+ssize_t serialize_payload_ct_sth(const payload_ct_sth_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_ct_sth(const uint8_t* data, size_t data_len, payload_ct_sth_t* payload);
+
+ssize_t serialize_payload_ct_sth_resp(const payload_ct_sth_resp_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_ct_sth_resp(const uint8_t* data, size_t data_len, payload_ct_sth_resp_t* payload);
+
+ssize_t serialize_payload_ct_entries_req(const payload_ct_entries_req_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_ct_entries_req(const uint8_t* data, size_t data_len, payload_ct_entries_req_t* payload);
+
+ssize_t get_serialized_payload_ct_entries_resp_size(const payload_ct_entries_resp_t* payload);
+ssize_t serialize_payload_ct_entries_resp(const payload_ct_entries_resp_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_ct_entries_resp(const uint8_t* data, size_t data_len, payload_ct_entries_resp_t* payload);
+void free_payload_ct_entries_resp(payload_ct_entries_resp_t* payload);
+
+// TLD anti-entropy payloads. Deserializing allocates the arrays; release
+// them with the matching free_payload_tld_*() (the struct itself is not freed).
+ssize_t get_serialized_payload_tld_merkle_req_size(const payload_tld_merkle_req_t* payload);
+ssize_t serialize_payload_tld_merkle_req(const payload_tld_merkle_req_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_tld_merkle_req(const uint8_t* data, size_t data_len, payload_tld_merkle_req_t* payload);
+void free_payload_tld_merkle_req(payload_tld_merkle_req_t* payload);
+
+ssize_t get_serialized_payload_tld_merkle_resp_size(const payload_tld_merkle_resp_t* payload);
+ssize_t serialize_payload_tld_merkle_resp(const payload_tld_merkle_resp_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_tld_merkle_resp(const uint8_t* data, size_t data_len, payload_tld_merkle_resp_t* payload);
+void free_payload_tld_merkle_resp(payload_tld_merkle_resp_t* payload);
+
+ssize_t get_serialized_payload_tld_bucket_req_size(const payload_tld_bucket_req_t* payload);
+ssize_t serialize_payload_tld_bucket_req(const payload_tld_bucket_req_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_tld_bucket_req(const uint8_t* data, size_t data_len, payload_tld_bucket_req_t* payload);
+void free_payload_tld_bucket_req(payload_tld_bucket_req_t* payload);
+
+// Records must carry a NUL-terminated name and rdata to deserialize
+ssize_t get_serialized_payload_tld_bucket_resp_size(const payload_tld_bucket_resp_t* payload);
+ssize_t serialize_payload_tld_bucket_resp(const payload_tld_bucket_resp_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_tld_bucket_resp(const uint8_t* data, size_t data_len, payload_tld_bucket_resp_t* payload);
+void free_payload_tld_bucket_resp(payload_tld_bucket_resp_t* payload);
+
+ssize_t serialize_payload_tld_journal_req(const payload_tld_journal_req_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_tld_journal_req(const uint8_t* data, size_t data_len, payload_tld_journal_req_t* payload);
+
+ssize_t get_serialized_payload_tld_journal_resp_size(const payload_tld_journal_resp_t* payload);
+ssize_t serialize_payload_tld_journal_resp(const payload_tld_journal_resp_t* payload, uint8_t* out_buf, size_t out_buf_len);
+ssize_t deserialize_payload_tld_journal_resp(const uint8_t* data, size_t data_len, payload_tld_journal_resp_t* payload);
+void free_payload_tld_journal_resp(payload_tld_journal_resp_t* payload);
+
+// DNS Record Serialization/Deserialization (one record of a DNS response
+// payload); deserialize_dns_record allocates name and rdata
+ssize_t get_serialized_dns_record_size(const dns_record_t* record);
+ssize_t serialize_dns_record(const dns_record_t* record, uint8_t* out_buf, size_t out_buf_len, size_t* bytes_written);
+ssize_t deserialize_dns_record(const uint8_t* data, size_t data_len, dns_record_t* record, size_t* bytes_read);
 
 #endif // PACKET_PROTOCOL_H 
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <time.h>
 #include "dns_types.h"
+#include "tld_manager.h"
+#include "tld_journal.h"
 
 // Forward declarations
 typedef struct persistence_context_s persistence_context_t;
@@ -14,6 +16,9 @@ typedef struct {
     int enable_wal_mode;        // Enable WAL mode for better concurrency
     int cache_size_kb;          // SQLite cache size in KB
     int sync_mode;              // SQLite synchronous mode (0=OFF, 1=NORMAL, 2=FULL)
+    int flush_interval_ms;      // Write-behind group commit window
+    int max_batch_size;         // Commit early once this many mutations are queued
+    int enable_journal;         // Journal mutations to <db_path>.journal first
 } persistence_config_t;
 
 // Database schema version for migrations
@@ -21,15 +26,17 @@ typedef struct {
 
 // Function declarations
 
-// Initialization and cleanup
+// Initialization and cleanup. cleanup_persistence drains the write-behind
+// queue and returns -1 if any queued mutation could not be committed.
 int init_persistence(persistence_context_t** ctx, const persistence_config_t* config);
-void cleanup_persistence(persistence_context_t* ctx);
+int cleanup_persistence(persistence_context_t* ctx);
 
 // TLD persistence
 int persist_tld(persistence_context_t* ctx, const tld_t* tld);
 int load_tld(persistence_context_t* ctx, const char* tld_name, tld_t** tld_out);
 int delete_tld(persistence_context_t* ctx, const char* tld_name);
 int list_tlds(persistence_context_t* ctx, char*** tld_names, size_t* count);
+void free_loaded_tld(tld_t* tld);
 
 // DNS record persistence
 int persist_dns_record(persistence_context_t* ctx, const char* tld_name, const dns_record_t* record);
@@ -54,6 +61,30 @@ int begin_transaction(persistence_context_t* ctx);
 int commit_transaction(persistence_context_t* ctx);
 int rollback_transaction(persistence_context_t* ctx);
 
+// Write-behind: TLD manager mutations are queued and group-committed by a
+// background writer thread, so the mutating thread never waits on disk.
+// A batch that keeps failing to commit is retried with backoff, then
+// dropped; from then on persistence_flush returns -1.
+int attach_persistence_to_tld_manager(persistence_context_t* ctx, tld_manager_t* manager);
+void detach_persistence_from_tld_manager(persistence_context_t* ctx);
+int persistence_flush(persistence_context_t* ctx);
+size_t persistence_pending_count(persistence_context_t* ctx);
+
+// Rebuild a TLD manager from the database. Call before attaching. When
+// <db_path>.snap matches the database it is mapped instead of reloading
+// every record. Journal entries the database never committed are then
+// replayed into the manager and committed.
+int restore_tlds_from_persistence(persistence_context_t* ctx, tld_manager_t* manager);
+
+// Snapshots: flush, then write <db_path>.snap tagged with the database's
+// mutation sequence (bumped by every committed change), and compact the
+// journal up to what the database holds.
+int persistence_write_snapshot(persistence_context_t* ctx, tld_manager_t* manager);
+uint64_t persistence_mutation_sequence(persistence_context_t* ctx);
+
+// The journal mirrors read deltas from, NULL unless enable_journal is set
+tld_journal_t* persistence_journal(persistence_context_t* ctx);
+
 // Default configuration helper
 persistence_config_t* create_default_persistence_config(const char* db_path);
 void free_persistence_config(persistence_config_t* config);
@@ -0,0 +1,41 @@
+#ifndef QUERY_ARENA_H
+#define QUERY_ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for the transient allocations of one request.
+//
+// Allocations are carved from a chunk in order and never freed one by one;
+// query_arena_reset() releases all of them at once when the request is
+// done. A request that outgrows the retained chunk gets overflow chunks,
+// and the next reset replaces the retained chunk with one big enough for
+// that request, so steady-state traffic does not touch malloc at all.
+//
+// An arena belongs to one thread. Anything that outlives the request, such
+// as cache entries, must be copied out with malloc.
+
+#define QUERY_ARENA_DEFAULT_SIZE (16 * 1024)
+#define QUERY_ARENA_MAX_RETAINED (1024 * 1024)  // Larger requests still work, but their chunks are freed
+#define QUERY_ARENA_ALIGN 16
+
+typedef struct query_arena_s query_arena_t;
+
+int init_query_arena(size_t size, query_arena_t** arena_out);
+void cleanup_query_arena(query_arena_t* arena);
+
+// Returns NULL only when malloc fails. A zero size returns a unique pointer.
+void* query_arena_alloc(query_arena_t* arena, size_t size);
+
+// Grows the most recent allocation in place when there is room, otherwise
+// copies it. ptr may be NULL.
+void* query_arena_realloc(query_arena_t* arena, void* ptr, size_t old_size, size_t new_size);
+
+char* query_arena_strdup(query_arena_t* arena, const char* s);
+
+// Invalidates every pointer handed out since the last reset
+void query_arena_reset(query_arena_t* arena);
+
+// Bytes handed out since the last reset, alignment included
+size_t query_arena_used(const query_arena_t* arena);
+
+#endif // QUERY_ARENA_H
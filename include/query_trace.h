@@ -0,0 +1,90 @@
+#ifndef QUERY_TRACE_H
+#define QUERY_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Sampled per-query tracing.
+//
+// One query in every sample_rate handled by a thread is traced: each stage
+// it passes through is timed on CLOCK_MONOTONIC (the clock behind
+// get_timestamp) and the finished trace goes into a fixed-size ring that
+// keeps the most recent ones. While tracing is off, or for a query that
+// was not sampled, every call below returns after one thread-local check.
+//
+// A query is handled start to finish on one thread, so the trace being
+// built lives in thread-local storage and stages can be marked from any
+// layer without passing a handle around. Stages may nest (a CNAME
+// follow-up contains its own cache and TLD lookups).
+
+#define QUERY_TRACE_DEFAULT_CAPACITY 1024
+#define QUERY_TRACE_MAX_SPANS 32
+#define QUERY_TRACE_NAME_MAX 64
+
+typedef enum {
+    TRACE_STAGE_RECEIVE = 0,        // Datagram read until the stream callback
+    TRACE_STAGE_DESERIALIZE,
+    TRACE_STAGE_CACHE_LOOKUP,
+    TRACE_STAGE_TLD_LOOKUP,
+    TRACE_STAGE_CNAME_FOLLOW,
+    TRACE_STAGE_UPSTREAM_WAIT,
+    TRACE_STAGE_SERIALIZE,
+    TRACE_STAGE_STREAM_WRITE,
+    TRACE_STAGE_COUNT
+} trace_stage_t;
+
+typedef struct {
+    uint8_t stage;
+    uint8_t depth;                  // Nesting level, 0 for top-level stages
+    uint64_t start_ns;
+    uint64_t end_ns;
+} query_trace_span_t;
+
+typedef struct {
+    uint64_t id;
+    uint32_t thread_id;
+    int32_t packet_type;
+    int32_t status;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    char name[QUERY_TRACE_NAME_MAX];
+    uint32_t span_count;
+    uint32_t spans_dropped;         // Stages beyond QUERY_TRACE_MAX_SPANS
+    query_trace_span_t spans[QUERY_TRACE_MAX_SPANS];
+} query_trace_t;
+
+// sample_rate N traces one query in N per thread; 0 turns tracing off.
+// Calling again changes the rate and, if capacity differs, clears the ring.
+int init_query_tracing(unsigned sample_rate, size_t capacity);
+void cleanup_query_tracing(void);
+
+uint64_t query_trace_now(void);
+
+// Called when a datagram is read; the next trace on this thread starts here
+void query_trace_note_receive(void);
+
+// Returns 1 when this query is sampled
+int query_trace_begin(int packet_type);
+void query_trace_set_name(const char* name);
+void query_trace_end(int status);
+
+// start is query_trace_stage_start()'s result; 0 means not tracing
+uint64_t query_trace_stage_start(void);
+void query_trace_stage_end(trace_stage_t stage, uint64_t start);
+
+const char* get_trace_stage_name(trace_stage_t stage);
+
+// Copy up to max traces, oldest first; returns how many were copied
+size_t query_trace_snapshot(query_trace_t* out, size_t max);
+
+// Chrome trace event JSON (chrome://tracing, Perfetto)
+int query_trace_dump_chrome(FILE* f);
+
+// "NXQT", u32 version, u32 count, then per trace: id u64, thread u32,
+// packet type i32, status i32, start u64, end u64, name u8 length + bytes,
+// span count u8, then per span: stage u8, depth u8, start delta u32 (ns from
+// trace start), duration u32 (ns). All little-endian.
+int query_trace_dump_binary(FILE* f);
+
+#endif // QUERY_TRACE_H
@@ -0,0 +1,81 @@
+#ifndef TLD_JOURNAL_H
+#define TLD_JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include "dns_types.h"
+
+// Append-only write-ahead journal of TLD mutations.
+//
+// File layout (little-endian):
+//   header: "NXJRNL01", u64 base_sequence (entries up to it were compacted)
+//   entry:  u32 payload_len, u32 crc32(seq..payload), u64 seq, u16 type,
+//           u16 reserved, payload
+//
+// Payload fields are u16-length-prefixed strings and fixed-width integers.
+// A torn or corrupt tail is truncated on open. Persistence appends every
+// mutation here before queueing it for SQLite, replays what SQLite missed
+// on restore and compacts the journal when it writes a snapshot. Mirrors
+// pull the same entries as deltas (TLD_JOURNAL_REQ, see tld_sync.h).
+
+#define TLD_JOURNAL_MAGIC "NXJRNL01"
+
+typedef struct tld_journal_s tld_journal_t;
+
+typedef struct {
+    int fsync_interval_ms;          // Group commit window for the writer thread
+    size_t max_pending_bytes;       // Flush early once this much is buffered
+} tld_journal_config_t;
+
+// One decoded entry. Strings point into a buffer owned by the reader and are
+// only valid for the duration of the visitor call.
+typedef struct {
+    uint64_t sequence;
+    tld_mutation_type_t type;
+    const char* tld_name;
+    dns_record_t record;            // ADD_RECORD / REMOVE_RECORD
+    tld_node_t node;                // ADD_*_NODE
+    time_t timestamp;               // REGISTER: created_at, PRUNE: stale threshold
+} tld_journal_entry_t;
+
+typedef int (*tld_journal_visitor_fn)(void* ctx, const tld_journal_entry_t* entry);
+
+// Lifecycle
+int open_tld_journal(tld_journal_t** journal_out, const char* path, const tld_journal_config_t* config);
+void close_tld_journal(tld_journal_t* journal);
+
+// Appending: mutations are encoded on the mutating thread, then written and
+// fsync'd in batches by a writer thread. attach_tld_journal appends every
+// mutation of a manager; persistence calls tld_journal_append itself.
+int attach_tld_journal(tld_journal_t* journal, tld_manager_t* manager);
+void detach_tld_journal(tld_journal_t* journal);
+int tld_journal_append(tld_journal_t* journal, const tld_mutation_t* mutation, uint64_t* sequence_out);
+int tld_journal_sync(tld_journal_t* journal);   // Wait until everything appended is durable
+
+uint64_t tld_journal_last_sequence(tld_journal_t* journal);
+uint64_t tld_journal_durable_sequence(tld_journal_t* journal);
+uint64_t tld_journal_base_sequence(tld_journal_t* journal);
+
+// Visit durable entries with sequence > since_sequence, in order. Returns -1
+// if those entries were compacted away (caller must resync another way).
+int tld_journal_read_since(tld_journal_t* journal, uint64_t since_sequence,
+                           tld_journal_visitor_fn visit, void* ctx);
+
+// Copy up to max_entries durable entries after since_sequence, in the file's
+// entry format, into a malloc'd buffer for a mirror. Returns -1 if they were
+// compacted away; tld_journal_decode_entries checks and visits them.
+int tld_journal_export_since(tld_journal_t* journal, uint64_t since_sequence, size_t max_entries,
+                             uint8_t** data_out, size_t* len_out, size_t* count_out);
+int tld_journal_decode_entries(const uint8_t* data, size_t len, tld_journal_visitor_fn visit, void* ctx);
+
+// Apply a decoded entry to a manager, taking the manager lock. Re-applying
+// an entry is a no-op (returns 1), so replaying entries a snapshot or a
+// Merkle walk already covered is harmless.
+int apply_tld_journal_entry(tld_manager_t* manager, const tld_journal_entry_t* entry);
+
+// Drop every entry up to covered_sequence, which the caller has made durable
+// elsewhere (snapshot or database). Sequences continue past it.
+int compact_tld_journal(tld_journal_t* journal, uint64_t covered_sequence);
+
+#endif // TLD_JOURNAL_H
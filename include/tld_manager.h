@@ -8,15 +8,46 @@
 // Function declarations
 int init_tld_manager(tld_manager_t** manager_ptr);
 void cleanup_tld_manager(tld_manager_t* manager);
+// Drop every TLD and the snapshot mapping, leaving an empty, usable manager.
+// Listeners are not notified.
+void clear_tld_manager(tld_manager_t* manager);
 tld_t* register_new_tld(tld_manager_t* manager, const char* tld_name);
 tld_t* find_tld_by_name(tld_manager_t* manager, const char* tld_name);
 int add_dns_record_to_tld(tld_t* tld, const dns_record_t* record_in);
+int remove_dns_record_from_tld(tld_t* tld, const char* record_name, dns_record_type_t type);
+// Same, but only a record whose rdata also matches (one of several A records)
+int remove_exact_dns_record_from_tld(tld_t* tld, const dns_record_t* record);
+int add_authoritative_node_to_tld(tld_t* tld, const tld_node_t* node_info);
+int add_mirror_node_to_tld(tld_t* tld, const tld_node_t* node_info);
+
+// Record access across the snapshot base and the in-memory delta. Records
+// handed out are borrowed views, valid while the caller holds the manager
+// lock (or otherwise keeps the TLD from being mutated).
+typedef int (*tld_record_visitor_fn)(void* ctx, const dns_record_t* record);
+size_t tld_record_count(const tld_t* tld);
+int tld_for_each_record(const tld_t* tld, tld_record_visitor_fn visit, void* ctx);
+// Returns the total number of matches, filling at most `max` entries of `out`
+size_t tld_lookup_records(const tld_t* tld, const char* name, dns_record_t* out, size_t max);
+
+// Mutation listeners. Register before the manager is shared between threads.
+int add_tld_mutation_listener(tld_manager_t* manager, tld_mutation_listener_fn fn, void* ctx);
+int remove_tld_mutation_listener(tld_manager_t* manager, tld_mutation_listener_fn fn, void* ctx);
 
 // TLD Mirroring and Synchronization Functions
 int request_tld_mirror(tld_manager_t* manager, const char* tld_name, const char* peer_hostname, const char* peer_ip);
 int sync_tld_update(tld_manager_t* manager, const char* tld_name, const dns_record_t* updated_record);
 int discover_tld_peers(tld_manager_t* manager, const char* tld_name, tld_node_t** discovered_peers, size_t* peer_count);
 int cleanup_stale_peers(tld_manager_t* manager, time_t stale_threshold);
+int prune_stale_tld_nodes(tld_t* tld, time_t stale_threshold);
 int get_tld_sync_status(tld_manager_t* manager, const char* tld_name, time_t* last_sync, size_t* peer_count);
 
+// Merkle anti-entropy: compare roots, walk divergent subtrees with
+// tld_merkle_find_divergent_buckets(), then exchange only those buckets.
+int get_tld_merkle_root(tld_manager_t* manager, const char* tld_name, uint8_t root_out[32]);
+// tld_sync.c drives the exchange between nodes. Callers hold the manager lock
+// (write lock for reconcile_tld_bucket).
+int collect_tld_bucket_records(tld_t* tld, uint32_t bucket, dns_record_t** records_out, size_t* count_out);
+void free_tld_bucket_records(dns_record_t* records, size_t count);
+int reconcile_tld_bucket(tld_t* tld, uint32_t bucket, const dns_record_t* remote_records, size_t remote_count);
+
 #endif // TLD_MANAGER_H 
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef TLD_MERKLE_H
+#define TLD_MERKLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "dns_types.h"
+
+// Fixed-shape Merkle summary over a TLD's records.
+//
+// Records are hashed into TLD_MERKLE_LEAVES buckets by record name. Each
+// leaf holds the modular sum of the digests of the records in its bucket, so
+// adding or removing a record only touches one leaf and the TLD_MERKLE_DEPTH
+// internal hashes above it. Two nodes with the same record set always have
+// the same tree, independent of insertion order, which lets mirrors compare
+// roots and then descend only into subtrees whose hashes differ.
+
+#define TLD_MERKLE_DEPTH 10
+#define TLD_MERKLE_LEAVES (1u << TLD_MERKLE_DEPTH)
+#define TLD_MERKLE_HASH_LEN 32
+
+typedef struct tld_merkle_s {
+    // Heap layout: node 1 is the root, children of i are 2i and 2i+1,
+    // leaves occupy [TLD_MERKLE_LEAVES, 2 * TLD_MERKLE_LEAVES).
+    uint8_t nodes[2 * TLD_MERKLE_LEAVES][TLD_MERKLE_HASH_LEN];
+    uint32_t bucket_sizes[TLD_MERKLE_LEAVES];
+    size_t record_count;
+} tld_merkle_t;
+
+// Callback used by the divergence walk to ask a peer for its hashes of the
+// given nodes at `level` (0 = root, TLD_MERKLE_DEPTH = leaves). Must fill
+// `hashes_out[i]` for every `indices[i]` and return 0, or -1 on failure.
+// Each call corresponds to one round trip, so a full walk costs at most
+// TLD_MERKLE_DEPTH + 1 of them.
+typedef int (*tld_merkle_fetch_fn)(void* ctx, uint32_t level,
+                                   const uint32_t* indices, size_t count,
+                                   uint8_t (*hashes_out)[TLD_MERKLE_HASH_LEN]);
+
+// Lifecycle
+int init_tld_merkle(tld_merkle_t** tree_ptr);
+void cleanup_tld_merkle(tld_merkle_t* tree);
+void reset_tld_merkle(tld_merkle_t* tree);
+
+// Incremental maintenance
+uint32_t tld_merkle_bucket_for_name(const char* record_name);
+int tld_merkle_add_record(tld_merkle_t* tree, const dns_record_t* record);
+int tld_merkle_remove_record(tld_merkle_t* tree, const dns_record_t* record);
+
+// Queries
+int tld_merkle_get_root(const tld_merkle_t* tree, uint8_t root_out[TLD_MERKLE_HASH_LEN]);
+int tld_merkle_get_node(const tld_merkle_t* tree, uint32_t level, uint32_t index,
+                        uint8_t hash_out[TLD_MERKLE_HASH_LEN]);
+
+// Walk the tree against a remote summary and return the leaf buckets whose
+// contents differ. `*buckets` is malloc'd (NULL when the trees agree).
+int tld_merkle_find_divergent_buckets(const tld_merkle_t* local,
+                                      tld_merkle_fetch_fn fetch, void* fetch_ctx,
+                                      uint32_t** buckets, size_t* bucket_count);
+
+#endif // TLD_MERKLE_H
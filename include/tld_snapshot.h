@@ -0,0 +1,93 @@
+#ifndef TLD_SNAPSHOT_H
+#define TLD_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "dns_types.h"
+
+// Read-optimized, mmap-able snapshot of every TLD.
+//
+// Layout (host byte order, all sections 8-byte aligned):
+//   tld_snapshot_header_t
+//   tld_snapshot_tld_t      [tld_count]
+//   tld_snapshot_record_t   [record_count]  grouped by TLD, sorted by (name, type)
+//   uint32_t                name index slots, one open-addressed table per TLD
+//   tld_merkle_t            [tld_count]     prebuilt Merkle summaries
+//   char                    string table    NUL-terminated names and rdata
+//
+// Opening a snapshot checks the header and body checksums, the section
+// bounds and that every string offset and index slot stays inside its
+// section; records are then served straight from the mapping and the
+// in-memory TLD arrays hold only what changed since (see tld_lookup_records
+// in tld_manager.h). Merkle trees are copied as stored, not rehashed.
+
+#define TLD_SNAPSHOT_MAGIC "NXSNAP01"
+#define TLD_SNAPSHOT_VERSION 2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t tld_count;
+    uint64_t record_count;
+    uint64_t sequence;          // Caller-defined position of the snapshot (e.g. persistence sequence)
+    uint64_t tld_table_offset;
+    uint64_t record_table_offset;
+    uint64_t index_offset;
+    uint64_t index_slot_count;
+    uint64_t merkle_offset;
+    uint64_t string_table_offset;
+    uint64_t string_table_size;
+    uint64_t file_size;
+    uint32_t header_checksum;   // CRC32 of the header with this field zeroed
+    uint32_t body_checksum;     // CRC32 of everything after the header
+} tld_snapshot_header_t;
+
+typedef struct {
+    uint32_t name_offset;       // Into the string table
+    uint32_t index_slots;       // Power of two, 0 when the TLD has no records
+    int64_t created_at;
+    int64_t last_modified;
+    uint64_t first_record;
+    uint64_t record_count;
+    uint64_t first_index_slot;
+} tld_snapshot_tld_t;
+
+typedef struct {
+    uint32_t name_offset;
+    uint32_t rdata_offset;
+    uint32_t type;
+    uint32_t ttl;
+    int64_t last_updated;
+} tld_snapshot_record_t;
+
+// Per-TLD window into a mapped snapshot, referenced from tld_t.base
+typedef struct tld_snapshot_view_s {
+    const char* strings;
+    const tld_snapshot_record_t* records;
+    const uint32_t* index;      // Slot holds record position + 1, 0 = empty
+    uint32_t index_slots;
+    size_t record_count;
+} tld_snapshot_view_t;
+
+typedef struct tld_snapshot_s tld_snapshot_t;
+
+// Writing: serializes base + delta of every TLD, then atomically renames
+// the result over `path`.
+int write_tld_snapshot(tld_manager_t* manager, const char* path, uint64_t sequence);
+
+// Reading
+int open_tld_snapshot(const char* path, tld_snapshot_t** snapshot_out);
+void close_tld_snapshot(tld_snapshot_t* snapshot);
+uint64_t tld_snapshot_sequence(const tld_snapshot_t* snapshot);
+
+// Register every TLD from the snapshot in an empty manager without copying
+// records. The manager takes ownership of the snapshot and unmaps it in
+// cleanup_tld_manager(). If loading fails part way, the TLDs registered so
+// far are dropped and the snapshot is closed.
+int load_tld_snapshot_into_manager(tld_snapshot_t* snapshot, tld_manager_t* manager);
+
+// View helpers
+void tld_snapshot_record_view(const tld_snapshot_view_t* view, size_t position, dns_record_t* out);
+size_t tld_snapshot_find_name(const tld_snapshot_view_t* view, const char* name, size_t* first_position);
+
+#endif // TLD_SNAPSHOT_H
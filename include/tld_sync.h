@@ -0,0 +1,84 @@
+#ifndef TLD_SYNC_H
+#define TLD_SYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include "dns_types.h"
+#include "packet_protocol.h"
+#include "tld_journal.h"
+
+// Mirror sync between a TLD mirror and its upstream.
+//
+// Steady state is journal deltas: the mirror keeps the sequence of the last
+// upstream journal entry it applied and asks for the entries after it
+// (TLD_JOURNAL_REQ/RESP), one round trip for all TLDs.
+//
+// When there is no such cursor yet, or the upstream compacted those entries
+// away or has no journal, the mirror falls back to Merkle anti-entropy. For
+// each local TLD it walks the peer's Merkle tree level by level
+// (TLD_MERKLE_REQ/RESP), descending only into subtrees whose hashes differ
+// from its own, so a walk costs at most TLD_MERKLE_DEPTH + 1 round trips.
+// The records of the divergent leaf buckets are then fetched in pipelined
+// TLD_BUCKET_REQ/RESP packets and each bucket is reconciled to the peer's
+// contents with reconcile_tld_bucket(). Only the difference is applied, so
+// mutation listeners (persistence, answer cache) see the real changes.
+
+#define TLD_SYNC_MAX_PEERS 16
+#define TLD_SYNC_BUCKETS_PER_REQ 64         // 16 requests cover every bucket
+#define TLD_SYNC_DEFAULT_INTERVAL_MS 30000
+#define TLD_SYNC_JOURNAL_ENTRIES_PER_REQ NEXUS_TLD_JOURNAL_MAX_ENTRIES
+
+typedef enum {
+    TLD_SYNC_IN_SYNC = 0,
+    TLD_SYNC_RECONCILED,            // Divergent buckets were fetched and applied
+    TLD_SYNC_UNKNOWN_TLD,           // Peer (or we) do not serve this TLD
+    TLD_SYNC_UNREACHABLE,
+    TLD_SYNC_FAILED                 // Bad response or a local apply error
+} tld_sync_status_t;
+
+// Transport hook, same contract as ct_gossip_exchange_fn: send one or more
+// concatenated NEXUS packets on one stream and return the concatenated
+// responses in a malloc'd buffer. Returns the response length or < 0.
+typedef ssize_t (*tld_sync_exchange_fn)(void* ctx, const uint8_t* request, size_t request_len, uint8_t** response_out);
+
+typedef struct {
+    char name[64];
+    tld_sync_exchange_fn exchange;
+    void* ctx;
+    tld_sync_status_t last_status;              // Worst status of the last round
+    int has_journal_cursor;                     // Else the next round walks the trees
+    uint64_t journal_seq;                       // Last peer journal entry applied
+} tld_sync_peer_t;
+
+typedef struct tld_sync_s {
+    tld_manager_t* manager;
+    tld_sync_peer_t peers[TLD_SYNC_MAX_PEERS];
+    size_t peer_count;
+    int interval_ms;
+    uint64_t last_round_ms;
+    pthread_mutex_t lock;                       // Serializes rounds and the peer table
+} tld_sync_t;
+
+// Lifecycle
+int init_tld_sync(tld_manager_t* manager, int interval_ms, tld_sync_t** sync_out);
+void cleanup_tld_sync(tld_sync_t* sync);
+int tld_sync_add_peer(tld_sync_t* sync, const char* name, tld_sync_exchange_fn exchange, void* ctx);
+
+// Client side. tld_sync_pull_tld brings one local TLD in line with a peer
+// by the Merkle walk and reports how many buckets were reconciled.
+// tld_sync_round pulls journal deltas from every peer, or walks every local
+// TLD for a peer without a cursor, and returns -1 if any pull failed;
+// tld_sync_tick only runs a round once interval_ms has passed since the last.
+tld_sync_status_t tld_sync_pull_tld(tld_sync_t* sync, size_t peer_index, const char* tld_name, size_t* buckets_reconciled);
+int tld_sync_round(tld_sync_t* sync);
+int tld_sync_tick(tld_sync_t* sync);
+
+// Server side: answer a TLD_MERKLE_REQ, TLD_BUCKET_REQ or TLD_JOURNAL_REQ
+// packet (journal may be NULL). Returns a malloc'd serialized response
+// packet, or -1 for other packet types.
+int tld_sync_handle_packet(tld_manager_t* manager, tld_journal_t* journal, const nexus_packet_t* request,
+                           uint8_t** response_out, size_t* response_len_out);
+
+#endif // TLD_SYNC_H
@@ -0,0 +1,285 @@
+#include "../include/answer_cache.h"
+#include "../include/packet_protocol.h"
+#include "../include/metrics.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+// nexus_packet_t header: version, type, session ID, data length
+#define PACKET_TYPE_OFFSET 1
+#define PACKET_SESSION_OFFSET 2
+#define PACKET_HEADER_LEN 14
+// DNS_RESPONSE payload: status, record count, then the records
+#define RESPONSE_RECORDS_OFFSET (PACKET_HEADER_LEN + 5)
+
+typedef struct {
+    uint64_t hash;
+    uint64_t generation;                    // Valid only while equal to the cache's
+    time_t stored;
+    time_t expires;
+    uint16_t type;
+    uint8_t version;
+    uint16_t ttl_count;
+    uint16_t ttl_offsets[ANSWER_CACHE_MAX_RECORDS];
+    uint8_t* packet;
+    size_t packet_len;
+    char name[MAX_DOMAIN_NAME_LEN];
+} answer_cache_entry_t;
+
+struct answer_cache_s {
+    answer_cache_entry_t* entries;          // set_count * ANSWER_CACHE_WAYS
+    size_t set_count;                       // Power of two
+    uint64_t generation;                    // Starts at 1; 0 marks an empty slot
+    uint64_t hits;
+    uint64_t misses;
+    tld_manager_t* attached_manager;
+    pthread_mutex_t lock;
+};
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint64_t key_hash(const char* name, uint16_t type, uint8_t version) {
+    uint64_t h = 1469598103934665603ULL;    // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+    h = (h ^ type) * 1099511628211ULL;
+    return (h ^ version) * 1099511628211ULL;
+}
+
+static answer_cache_entry_t* cache_set(answer_cache_t* cache, uint64_t hash) {
+    return &cache->entries[(hash & (cache->set_count - 1)) * ANSWER_CACHE_WAYS];
+}
+
+static int entry_live(const answer_cache_t* cache, const answer_cache_entry_t* entry, time_t now) {
+    return entry->generation == cache->generation && entry->expires > now;
+}
+
+static int entry_matches(const answer_cache_entry_t* entry, uint64_t hash, const char* name,
+                         uint16_t type, uint8_t version) {
+    return entry->hash == hash && entry->type == type && entry->version == version &&
+           strcmp(entry->name, name) == 0;
+}
+
+int init_answer_cache(size_t capacity, answer_cache_t** cache_out) {
+    if (!cache_out) return -1;
+
+    answer_cache_t* cache = calloc(1, sizeof(answer_cache_t));
+    if (!cache) return -1;
+
+    size_t sets = 1;
+    size_t wanted = (capacity ? capacity : ANSWER_CACHE_DEFAULT_CAPACITY) / ANSWER_CACHE_WAYS;
+    while (sets < wanted) sets <<= 1;
+
+    cache->entries = calloc(sets * ANSWER_CACHE_WAYS, sizeof(answer_cache_entry_t));
+    if (!cache->entries || pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache->entries);
+        free(cache);
+        return -1;
+    }
+    cache->set_count = sets;
+    cache->generation = 1;
+
+    *cache_out = cache;
+    return 0;
+}
+
+void cleanup_answer_cache(answer_cache_t* cache) {
+    if (!cache) return;
+    detach_answer_cache(cache);
+    for (size_t i = 0; i < cache->set_count * ANSWER_CACHE_WAYS; i++) {
+        free(cache->entries[i].packet);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache);
+}
+
+static void on_tld_mutation(void* ctx, const tld_mutation_t* mutation) {
+    switch (mutation->type) {
+        case TLD_MUTATION_REGISTER:
+        case TLD_MUTATION_ADD_RECORD:
+        case TLD_MUTATION_REMOVE_RECORD:
+            answer_cache_invalidate((answer_cache_t*)ctx);
+            break;
+        default:
+            // Node lists do not change answers
+            break;
+    }
+}
+
+int attach_answer_cache(answer_cache_t* cache, tld_manager_t* manager) {
+    if (!cache || !manager || cache->attached_manager) return -1;
+    if (add_tld_mutation_listener(manager, on_tld_mutation, cache) != 0) return -1;
+    cache->attached_manager = manager;
+    return 0;
+}
+
+void detach_answer_cache(answer_cache_t* cache) {
+    if (!cache || !cache->attached_manager) return;
+    remove_tld_mutation_listener(cache->attached_manager, on_tld_mutation, cache);
+    cache->attached_manager = NULL;
+}
+
+ssize_t answer_cache_lookup(answer_cache_t* cache, const char* name, uint16_t type, uint8_t version,
+                            uint64_t session_id, uint8_t* out, size_t out_len) {
+    if (!cache || !name || !out) return 0;
+    uint64_t hash = key_hash(name, type, version);
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&cache->lock);
+    answer_cache_entry_t* set = cache_set(cache, hash);
+    answer_cache_entry_t* entry = NULL;
+    for (int i = 0; i < ANSWER_CACHE_WAYS; i++) {
+        if (entry_live(cache, &set[i], now) && entry_matches(&set[i], hash, name, type, version)) {
+            entry = &set[i];
+            break;
+        }
+    }
+    if (!entry) {
+        cache->misses++;
+        pthread_mutex_unlock(&cache->lock);
+        metrics_inc(METRIC_ANSWER_CACHE_MISSES);
+        return 0;
+    }
+    if (entry->packet_len > out_len) {
+        pthread_mutex_unlock(&cache->lock);
+        return -1;
+    }
+
+    memcpy(out, entry->packet, entry->packet_len);
+    // Live entries are younger than their shortest TTL, so no TTL wraps
+    uint32_t age = (uint32_t)(now - entry->stored);
+    if (age > 0) {
+        for (uint16_t i = 0; i < entry->ttl_count; i++) {
+            uint8_t* ttl = out + entry->ttl_offsets[i];
+            put32(ttl, get32(ttl) - age);
+        }
+    }
+    ssize_t len = (ssize_t)entry->packet_len;
+    cache->hits++;
+    pthread_mutex_unlock(&cache->lock);
+
+    for (int i = 0; i < 8; i++) {
+        out[PACKET_SESSION_OFFSET + i] = (uint8_t)(session_id >> (56 - 8 * i));
+    }
+    metrics_inc(METRIC_ANSWER_CACHE_HITS);
+    return len;
+}
+
+uint64_t answer_cache_generation(answer_cache_t* cache) {
+    if (!cache) return 0;
+    pthread_mutex_lock(&cache->lock);
+    uint64_t generation = cache->generation;
+    pthread_mutex_unlock(&cache->lock);
+    return generation;
+}
+
+// Finds each record's TTL field and the shortest TTL. Returns the record
+// count, or -1 for a packet that is not a cacheable answer.
+static int find_ttls(const uint8_t* packet, size_t len, uint16_t* offsets, uint32_t* min_ttl) {
+    if (len < RESPONSE_RECORDS_OFFSET || packet[PACKET_TYPE_OFFSET] != PACKET_TYPE_DNS_RESPONSE) return -1;
+    if (get32(packet + PACKET_HEADER_LEN - 4) != len - PACKET_HEADER_LEN) return -1;
+    if (packet[PACKET_HEADER_LEN] != DNS_STATUS_SUCCESS) return -1;
+    uint32_t count = get32(packet + PACKET_HEADER_LEN + 1);
+    if (count == 0 || count > ANSWER_CACHE_MAX_RECORDS) return -1;
+
+    // Each record: name length and name, type, TTL, last_updated, rdata length and rdata
+    size_t off = RESPONSE_RECORDS_OFFSET;
+    *min_ttl = UINT32_MAX;
+    for (uint32_t i = 0; i < count; i++) {
+        if (off + 4 > len) return -1;
+        off += 4 + (size_t)get32(packet + off);
+        if (off + 4 + 4 + 8 + 4 > len) return -1;
+        offsets[i] = (uint16_t)(off + 4);
+        uint32_t ttl = get32(packet + off + 4);
+        if (ttl < *min_ttl) *min_ttl = ttl;
+        off += 4 + 4 + 8;
+        off += 4 + (size_t)get32(packet + off);
+        if (off > len) return -1;
+    }
+    return off == len ? (int)count : -1;
+}
+
+int answer_cache_insert(answer_cache_t* cache, uint64_t generation, const char* name, uint16_t type,
+                        uint8_t version, const uint8_t* packet, size_t packet_len) {
+    if (!cache || !name || !packet || packet_len > ANSWER_CACHE_MAX_PACKET) return -1;
+    if (strlen(name) >= MAX_DOMAIN_NAME_LEN) return -1;
+
+    uint16_t offsets[ANSWER_CACHE_MAX_RECORDS];
+    uint32_t min_ttl = 0;
+    int count = find_ttls(packet, packet_len, offsets, &min_ttl);
+    if (count <= 0 || min_ttl == 0) return -1;
+
+    uint8_t* copy = malloc(packet_len);
+    if (!copy) return -1;
+    memcpy(copy, packet, packet_len);
+
+    uint64_t hash = key_hash(name, type, version);
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&cache->lock);
+    if (generation != cache->generation) {
+        pthread_mutex_unlock(&cache->lock);
+        free(copy);
+        return -1;
+    }
+
+    // The same key, else a free or dead slot, else the one closest to expiry
+    answer_cache_entry_t* set = cache_set(cache, hash);
+    answer_cache_entry_t* slot = NULL;
+    for (int i = 0; i < ANSWER_CACHE_WAYS && !slot; i++) {
+        if (entry_live(cache, &set[i], now) && entry_matches(&set[i], hash, name, type, version)) slot = &set[i];
+    }
+    for (int i = 0; i < ANSWER_CACHE_WAYS && !slot; i++) {
+        if (!entry_live(cache, &set[i], now)) slot = &set[i];
+    }
+    if (!slot) {
+        slot = &set[0];
+        for (int i = 1; i < ANSWER_CACHE_WAYS; i++) {
+            if (set[i].expires < slot->expires) slot = &set[i];
+        }
+    }
+
+    free(slot->packet);
+    slot->hash = hash;
+    slot->generation = cache->generation;
+    slot->stored = now;
+    slot->expires = now + (time_t)min_ttl;
+    slot->type = type;
+    slot->version = version;
+    slot->ttl_count = (uint16_t)count;
+    memcpy(slot->ttl_offsets, offsets, sizeof(uint16_t) * (size_t)count);
+    slot->packet = copy;
+    slot->packet_len = packet_len;
+    strcpy(slot->name, name);
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+void answer_cache_invalidate(answer_cache_t* cache) {
+    if (!cache) return;
+    pthread_mutex_lock(&cache->lock);
+    cache->generation++;
+    pthread_mutex_unlock(&cache->lock);
+    dlog("Answer cache invalidated");
+}
+
+void answer_cache_stats(answer_cache_t* cache, uint64_t* hits, uint64_t* misses) {
+    if (!cache) return;
+    pthread_mutex_lock(&cache->lock);
+    if (hits) *hits = cache->hits;
+    if (misses) *misses = cache->misses;
+    pthread_mutex_unlock(&cache->lock);
+}
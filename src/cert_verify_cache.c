@@ -0,0 +1,193 @@
+#include "../include/cert_verify_cache.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct {
+    uint8_t cert_fp[32];
+    uint8_t ca_fp[32];
+    time_t expires;
+    uint64_t generation;        // Valid only while equal to the cache's
+} cert_verify_cache_entry_t;
+
+struct cert_verify_cache_s {
+    cert_verify_cache_entry_t* entries;     // set_count * CERT_VERIFY_CACHE_WAYS
+    size_t set_count;                       // Power of two
+    int ttl_seconds;
+    uint64_t generation;                    // Starts at 1; 0 marks an empty slot
+    uint8_t (*revoked)[32];                 // Sorted fingerprints
+    size_t revoked_count;
+    size_t revoked_capacity;
+    uint64_t hits;
+    uint64_t misses;
+    pthread_mutex_t lock;
+};
+
+static cert_verify_cache_entry_t* cache_set(cert_verify_cache_t* cache, const uint8_t cert_fp[32]) {
+    uint64_t h;
+    memcpy(&h, cert_fp, sizeof(h));
+    return &cache->entries[(h & (cache->set_count - 1)) * CERT_VERIFY_CACHE_WAYS];
+}
+
+static int entry_live(const cert_verify_cache_t* cache, const cert_verify_cache_entry_t* entry, time_t now) {
+    return entry->generation == cache->generation && entry->expires > now;
+}
+
+// Binary search the revoked set; returns the insertion point in *pos
+static int find_revoked(const cert_verify_cache_t* cache, const uint8_t cert_fp[32], size_t* pos) {
+    size_t lo = 0, hi = cache->revoked_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(cache->revoked[mid], cert_fp, 32);
+        if (cmp == 0) {
+            if (pos) *pos = mid;
+            return 1;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (pos) *pos = lo;
+    return 0;
+}
+
+int init_cert_verify_cache(size_t capacity, int ttl_seconds, cert_verify_cache_t** cache_out) {
+    if (!cache_out) return -1;
+
+    cert_verify_cache_t* cache = calloc(1, sizeof(cert_verify_cache_t));
+    if (!cache) return -1;
+
+    size_t sets = 1;
+    size_t wanted = (capacity ? capacity : CERT_VERIFY_CACHE_DEFAULT_CAPACITY) / CERT_VERIFY_CACHE_WAYS;
+    while (sets < wanted) sets <<= 1;
+
+    cache->entries = calloc(sets * CERT_VERIFY_CACHE_WAYS, sizeof(cert_verify_cache_entry_t));
+    if (!cache->entries || pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache->entries);
+        free(cache);
+        return -1;
+    }
+    cache->set_count = sets;
+    cache->ttl_seconds = ttl_seconds > 0 ? ttl_seconds : CERT_VERIFY_CACHE_DEFAULT_TTL;
+    cache->generation = 1;
+
+    *cache_out = cache;
+    return 0;
+}
+
+void cleanup_cert_verify_cache(cert_verify_cache_t* cache) {
+    if (!cache) return;
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->revoked);
+    free(cache->entries);
+    free(cache);
+}
+
+cert_verify_cache_result_t cert_verify_cache_lookup(cert_verify_cache_t* cache, const uint8_t cert_fp[32], const uint8_t ca_fp[32]) {
+    if (!cache || !cert_fp || !ca_fp) return CERT_VERIFY_CACHE_MISS;
+
+    time_t now = time(NULL);
+    cert_verify_cache_result_t result = CERT_VERIFY_CACHE_MISS;
+
+    pthread_mutex_lock(&cache->lock);
+    if (cache->revoked_count && find_revoked(cache, cert_fp, NULL)) {
+        result = CERT_VERIFY_CACHE_REVOKED;
+    } else {
+        cert_verify_cache_entry_t* set = cache_set(cache, cert_fp);
+        for (int i = 0; i < CERT_VERIFY_CACHE_WAYS; i++) {
+            if (entry_live(cache, &set[i], now) &&
+                memcmp(set[i].cert_fp, cert_fp, 32) == 0 && memcmp(set[i].ca_fp, ca_fp, 32) == 0) {
+                result = CERT_VERIFY_CACHE_VALID;
+                break;
+            }
+        }
+    }
+    if (result == CERT_VERIFY_CACHE_VALID) cache->hits++;
+    else if (result == CERT_VERIFY_CACHE_MISS) cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+    return result;
+}
+
+void cert_verify_cache_insert(cert_verify_cache_t* cache, const uint8_t cert_fp[32], const uint8_t ca_fp[32], time_t not_after) {
+    if (!cache || !cert_fp || !ca_fp) return;
+
+    time_t now = time(NULL);
+    time_t expires = now + cache->ttl_seconds;
+    if (not_after > 0 && not_after < expires) expires = not_after;
+    if (expires <= now) return;
+
+    pthread_mutex_lock(&cache->lock);
+    if (cache->revoked_count && find_revoked(cache, cert_fp, NULL)) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    // Reuse the same key's slot, then a dead slot, then the one expiring first
+    cert_verify_cache_entry_t* set = cache_set(cache, cert_fp);
+    cert_verify_cache_entry_t* victim = NULL;
+    for (int i = 0; i < CERT_VERIFY_CACHE_WAYS; i++) {
+        cert_verify_cache_entry_t* entry = &set[i];
+        if (!entry_live(cache, entry, now)) {
+            if (!victim || entry_live(cache, victim, now)) victim = entry;
+            continue;
+        }
+        if (memcmp(entry->cert_fp, cert_fp, 32) == 0 && memcmp(entry->ca_fp, ca_fp, 32) == 0) {
+            victim = entry;
+            break;
+        }
+        if (!victim || (entry_live(cache, victim, now) && entry->expires < victim->expires)) victim = entry;
+    }
+
+    memcpy(victim->cert_fp, cert_fp, 32);
+    memcpy(victim->ca_fp, ca_fp, 32);
+    victim->expires = expires;
+    victim->generation = cache->generation;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+int cert_verify_cache_revoke(cert_verify_cache_t* cache, const uint8_t cert_fp[32]) {
+    if (!cache || !cert_fp) return -1;
+
+    pthread_mutex_lock(&cache->lock);
+    size_t pos;
+    if (!find_revoked(cache, cert_fp, &pos)) {
+        if (cache->revoked_count == cache->revoked_capacity) {
+            size_t capacity = cache->revoked_capacity ? cache->revoked_capacity * 2 : 16;
+            uint8_t (*grown)[32] = realloc(cache->revoked, capacity * 32);
+            if (!grown) {
+                pthread_mutex_unlock(&cache->lock);
+                return -1;
+            }
+            cache->revoked = grown;
+            cache->revoked_capacity = capacity;
+        }
+        memmove(cache->revoked[pos + 1], cache->revoked[pos], (cache->revoked_count - pos) * 32);
+        memcpy(cache->revoked[pos], cert_fp, 32);
+        cache->revoked_count++;
+    }
+
+    // The same certificate may be cached under several CAs
+    cert_verify_cache_entry_t* set = cache_set(cache, cert_fp);
+    for (int i = 0; i < CERT_VERIFY_CACHE_WAYS; i++) {
+        if (memcmp(set[i].cert_fp, cert_fp, 32) == 0) set[i].generation = 0;
+    }
+    size_t revoked_count = cache->revoked_count;
+    pthread_mutex_unlock(&cache->lock);
+    dlog("Certificate revoked, %zu revocations on record", revoked_count);
+    return 0;
+}
+
+void cert_verify_cache_invalidate(cert_verify_cache_t* cache) {
+    if (!cache) return;
+    pthread_mutex_lock(&cache->lock);
+    cache->generation++;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void cert_verify_cache_stats(cert_verify_cache_t* cache, uint64_t* hits, uint64_t* misses) {
+    if (!cache) return;
+    pthread_mutex_lock(&cache->lock);
+    if (hits) *hits = cache->hits;
+    if (misses) *misses = cache->misses;
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -1,6 +1,7 @@
 #include "../include/certificate_authority.h"
 #include "../include/network_context.h"
 #include "../include/extern/falcon/falcon.h"
+#include "../include/keygen_pool.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -11,11 +12,14 @@
 #include <openssl/x509v3.h>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
+#include <pthread.h>
+#include <unistd.h>
 
 // Falcon configuration - using Falcon-1024 for maximum security
 #define FALCON_LOGN 10  // Falcon-1024
 #define FALCON_PRIVKEY_LEN FALCON_PRIVKEY_SIZE(FALCON_LOGN)
 #define FALCON_PUBKEY_LEN FALCON_PUBKEY_SIZE(FALCON_LOGN)
+#define FALCON_EXPANDED_KEY_LEN FALCON_EXPANDEDKEY_SIZE(FALCON_LOGN)
 
 // Initialize certificate authority with RSA keys (simplified version)
 int init_certificate_authority(network_context_t *net_ctx, ca_context_t **ca_ctx) {
@@ -27,6 +31,7 @@ int init_certificate_authority(network_context_t *net_ctx, ca_context_t **ca_ctx
     }
     
     memset(*ca_ctx, 0, sizeof(ca_context_t));
+    atomic_init(&(*ca_ctx)->next_serial, 2);   // Serial 1 is the CA certificate
     
     // Generate Falcon keypair for CA
     if (generate_falcon_keypair((*ca_ctx)->falcon_public_key, (*ca_ctx)->falcon_private_key) != 0) {
@@ -35,33 +40,13 @@ int init_certificate_authority(network_context_t *net_ctx, ca_context_t **ca_ctx
         return -1;
     }
     
-    // Generate RSA key pair for X509 compatibility
-    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
-    if (!ctx) {
+    // RSA key pair for X509 compatibility
+    (*ca_ctx)->falcon_pkey = keygen_pool_take_rsa(get_default_keygen_pool());
+    if (!(*ca_ctx)->falcon_pkey) {
         free(*ca_ctx);
         return -1;
     }
     
-    if (EVP_PKEY_keygen_init(ctx) <= 0) {
-        EVP_PKEY_CTX_free(ctx);
-        free(*ca_ctx);
-        return -1;
-    }
-    
-    if (EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) <= 0) {
-        EVP_PKEY_CTX_free(ctx);
-        free(*ca_ctx);
-        return -1;
-    }
-    
-    if (EVP_PKEY_keygen(ctx, &(*ca_ctx)->falcon_pkey) <= 0) {
-        EVP_PKEY_CTX_free(ctx);
-        free(*ca_ctx);
-        return -1;
-    }
-    
-    EVP_PKEY_CTX_free(ctx);
-    
     // Create CA certificate
     (*ca_ctx)->ca_cert = malloc(sizeof(nexus_cert_t));
     if (!(*ca_ctx)->ca_cert) {
@@ -81,7 +66,7 @@ int init_certificate_authority(network_context_t *net_ctx, ca_context_t **ca_ctx
     
     // Create Falcon signature for the CA certificate (self-signed)
     const char *cert_data = (*ca_ctx)->ca_cert->common_name;
-    if (falcon_sign((*ca_ctx)->falcon_private_key, cert_data, strlen(cert_data), 
+    if (ca_falcon_sign(*ca_ctx, cert_data, strlen(cert_data), 
                    (*ca_ctx)->ca_cert->falcon_signature) != 0) {
         printf("ERROR: Failed to create Falcon signature for CA certificate\n");
         free((*ca_ctx)->ca_cert->common_name);
@@ -135,16 +120,27 @@ int init_certificate_authority(network_context_t *net_ctx, ca_context_t **ca_ctx
     (*ca_ctx)->ca_cert->x509 = x509;
     (*ca_ctx)->authority_name = strdup("NEXUS CA");
     
+    // Expand the signing key once so each issued signature skips the
+    // expansion. Signing falls back to the compact key if this fails.
+    (*ca_ctx)->falcon_expanded_key = falcon_expand_private_key((*ca_ctx)->falcon_private_key);
+    
+    // Verification results are cached per CA; without a cache every
+    // verification runs in full
+    unsigned int fp_len = 0;
+    if (X509_digest(x509, EVP_sha256(), (*ca_ctx)->ca_fingerprint, &fp_len) != 1 ||
+        init_cert_verify_cache(CERT_VERIFY_CACHE_DEFAULT_CAPACITY, CERT_VERIFY_CACHE_DEFAULT_TTL,
+                               &(*ca_ctx)->verify_cache) != 0) {
+        printf("WARNING: Certificate verification cache disabled\n");
+        (*ca_ctx)->verify_cache = NULL;
+    }
+    
     printf("Certificate Authority initialized successfully with Falcon-1024 post-quantum cryptography\n");
     return 0;
 }
 
-// Issue a certificate for a given common name
-int ca_issue_certificate(ca_context_t* ca_ctx, const char* common_name, nexus_cert_t** cert_out) {
-    if (!ca_ctx || !common_name || !cert_out) {
-        return -1;
-    }
-    
+// Issue one certificate under a serial the caller has reserved
+static int issue_certificate_with_serial(ca_context_t* ca_ctx, const char* common_name, long serial,
+                                         nexus_cert_t** cert_out) {
     *cert_out = malloc(sizeof(nexus_cert_t));
     if (!*cert_out) {
         return -1;
@@ -156,9 +152,10 @@ int ca_issue_certificate(ca_context_t* ca_ctx, const char* common_name, nexus_ce
     (*cert_out)->not_after = (*cert_out)->not_before + (90 * 24 * 60 * 60); // Valid for 90 days
     (*cert_out)->cert_type = CERT_TYPE_FEDERATED;
     
-    // Generate Falcon keypair for the certificate
+    // Take a Falcon keypair for the certificate (pre-generated when a pool runs)
+    keygen_pool_t *keygen_pool = get_default_keygen_pool();
     uint8_t cert_private_key[FALCON_PRIVKEY_SIZE_1024];
-    if (generate_falcon_keypair((*cert_out)->falcon_pubkey, cert_private_key) != 0) {
+    if (keygen_pool_take_falcon(keygen_pool, (*cert_out)->falcon_pubkey, cert_private_key) != 0) {
         printf("ERROR: Failed to generate Falcon keypair for certificate\n");
         free((*cert_out)->common_name);
         free(*cert_out);
@@ -171,7 +168,7 @@ int ca_issue_certificate(ca_context_t* ca_ctx, const char* common_name, nexus_ce
              common_name, (*cert_out)->not_before, (*cert_out)->not_after);
     
     // Sign the certificate data with CA's Falcon private key
-    if (falcon_sign(ca_ctx->falcon_private_key, cert_data, strlen(cert_data), 
+    if (ca_falcon_sign(ca_ctx, cert_data, strlen(cert_data), 
                    (*cert_out)->falcon_signature) != 0) {
         printf("ERROR: Failed to create Falcon signature for certificate\n");
         free((*cert_out)->common_name);
@@ -181,28 +178,15 @@ int ca_issue_certificate(ca_context_t* ca_ctx, const char* common_name, nexus_ce
         return -1;
     }
     
-    // Generate RSA key pair for X509 compatibility
-    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
-    if (!ctx) {
-        free((*cert_out)->common_name);
-        free(*cert_out);
-        memset(cert_private_key, 0, sizeof(cert_private_key));
-        return -1;
-    }
-    
-    EVP_PKEY *pkey = NULL;
-    if (EVP_PKEY_keygen_init(ctx) <= 0 ||
-        EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) <= 0 ||
-        EVP_PKEY_keygen(ctx, &pkey) <= 0) {
-        EVP_PKEY_CTX_free(ctx);
+    // RSA key pair for X509 compatibility
+    EVP_PKEY *pkey = keygen_pool_take_rsa(keygen_pool);
+    if (!pkey) {
         free((*cert_out)->common_name);
         free(*cert_out);
         memset(cert_private_key, 0, sizeof(cert_private_key));
         return -1;
     }
     
-    EVP_PKEY_CTX_free(ctx);
-    
     // Create X509 certificate for compatibility
     X509 *x509 = X509_new();
     if (!x509) {
@@ -216,9 +200,8 @@ int ca_issue_certificate(ca_context_t* ca_ctx, const char* common_name, nexus_ce
     // Set version
     X509_set_version(x509, 2);
     
-    // Set serial number (use a simple counter for now)
-    static long serial = 2;
-    ASN1_INTEGER_set(X509_get_serialNumber(x509), serial++);
+    // Set serial number
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), serial);
     
     // Set validity period
     X509_gmtime_adj(X509_get_notBefore(x509), 0);
@@ -255,6 +238,107 @@ int ca_issue_certificate(ca_context_t* ca_ctx, const char* common_name, nexus_ce
     return 0;
 }
 
+// Issue a certificate for a given common name
+int ca_issue_certificate(ca_context_t* ca_ctx, const char* common_name, nexus_cert_t** cert_out) {
+    if (!ca_ctx || !common_name || !cert_out) {
+        return -1;
+    }
+    
+    long serial = atomic_fetch_add(&ca_ctx->next_serial, 1);
+    return issue_certificate_with_serial(ca_ctx, common_name, serial, cert_out);
+}
+
+typedef struct {
+    ca_context_t *ca_ctx;
+    const char **common_names;
+    nexus_cert_t **certs;
+    size_t count;
+    long first_serial;
+    atomic_size_t next;         // Next unclaimed name
+    atomic_int failed;
+} batch_issue_t;
+
+static void *batch_issue_worker(void *arg) {
+    batch_issue_t *batch = (batch_issue_t *)arg;
+    
+    for (;;) {
+        size_t i = atomic_fetch_add(&batch->next, 1);
+        if (i >= batch->count || atomic_load(&batch->failed)) {
+            break;
+        }
+        if (issue_certificate_with_serial(batch->ca_ctx, batch->common_names[i],
+                                          batch->first_serial + (long)i, &batch->certs[i]) != 0) {
+            batch->certs[i] = NULL;
+            atomic_store(&batch->failed, 1);
+        }
+    }
+    return NULL;
+}
+
+int ca_issue_certificates_batch(ca_context_t* ca_ctx, const char** common_names, size_t count,
+                                int workers, nexus_cert_t** certs_out) {
+    if (!ca_ctx || !common_names || !certs_out || count == 0) {
+        return -1;
+    }
+    memset(certs_out, 0, count * sizeof(nexus_cert_t*));
+    for (size_t i = 0; i < count; i++) {
+        if (!common_names[i]) {
+            return -1;
+        }
+    }
+    
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : CA_BATCH_DEFAULT_WORKERS;
+    }
+    if ((size_t)workers > count) {
+        workers = (int)count;
+    }
+    
+    // Serials follow input order: certs_out[i] gets first_serial + i
+    batch_issue_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.ca_ctx = ca_ctx;
+    batch.common_names = common_names;
+    batch.certs = certs_out;
+    batch.count = count;
+    batch.first_serial = atomic_fetch_add(&ca_ctx->next_serial, (long)count);
+    atomic_init(&batch.next, 0);
+    atomic_init(&batch.failed, 0);
+    
+    pthread_t *threads = calloc((size_t)workers, sizeof(pthread_t));
+    if (!threads) {
+        return -1;
+    }
+    
+    // The calling thread works too, so a thread creation failure only
+    // costs parallelism
+    int started = 0;
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, batch_issue_worker, &batch) != 0) {
+            break;
+        }
+        started++;
+    }
+    batch_issue_worker(&batch);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    
+    if (atomic_load(&batch.failed)) {
+        printf("ERROR: Batch issuance failed, discarding %zu certificates\n", count);
+        for (size_t i = 0; i < count; i++) {
+            free_certificate(certs_out[i]);
+            certs_out[i] = NULL;
+        }
+        return -1;
+    }
+    
+    printf("Issued %zu certificates with %d workers\n", count, started + 1);
+    return 0;
+}
+
 // Verify certificate using CA's public key
 int verify_certificate(nexus_cert_t* cert, ca_context_t* ca) {
     if (!cert || !ca || !cert->x509 || !ca->ca_cert || !ca->ca_cert->x509) {
@@ -262,6 +346,22 @@ int verify_certificate(nexus_cert_t* cert, ca_context_t* ca) {
         return -1;
     }
     
+    // Known certificates skip signature verification
+    uint8_t fingerprint[32];
+    unsigned int fp_len = 0;
+    int have_fingerprint = ca->verify_cache &&
+                           X509_digest(cert->x509, EVP_sha256(), fingerprint, &fp_len) == 1;
+    if (have_fingerprint) {
+        cert_verify_cache_result_t cached = cert_verify_cache_lookup(ca->verify_cache, fingerprint, ca->ca_fingerprint);
+        if (cached == CERT_VERIFY_CACHE_REVOKED) {
+            printf("Certificate for '%s' has been revoked\n", cert->common_name);
+            return -1;
+        }
+        if (cached == CERT_VERIFY_CACHE_VALID) {
+            return 0;
+        }
+    }
+    
     // Get CA's public key
     EVP_PKEY *ca_pubkey = X509_get_pubkey(ca->ca_cert->x509);
     if (!ca_pubkey) {
@@ -275,6 +375,9 @@ int verify_certificate(nexus_cert_t* cert, ca_context_t* ca) {
     
     if (result == 1) {
         printf("Certificate for '%s' successfully verified\n", cert->common_name);
+        if (have_fingerprint) {
+            cert_verify_cache_insert(ca->verify_cache, fingerprint, ca->ca_fingerprint, cert->not_after);
+        }
         return 0;
     } else {
         printf("Certificate verification failed for '%s'\n", cert->common_name);
@@ -282,6 +385,25 @@ int verify_certificate(nexus_cert_t* cert, ca_context_t* ca) {
     }
 }
 
+int ca_revoke_certificate(ca_context_t* ca, nexus_cert_t* cert) {
+    if (!ca || !cert || !cert->x509 || !ca->verify_cache) {
+        return -1;
+    }
+    
+    uint8_t fingerprint[32];
+    unsigned int fp_len = 0;
+    if (X509_digest(cert->x509, EVP_sha256(), fingerprint, &fp_len) != 1) {
+        return -1;
+    }
+    return cert_verify_cache_revoke(ca->verify_cache, fingerprint);
+}
+
+void ca_invalidate_verification_cache(ca_context_t* ca) {
+    if (ca && ca->verify_cache) {
+        cert_verify_cache_invalidate(ca->verify_cache);
+    }
+}
+
 // Free certificate
 void free_certificate(nexus_cert_t* cert) {
     if (!cert) {
@@ -311,6 +433,8 @@ void cleanup_certificate_authority(ca_context_t *ca_ctx) {
         EVP_PKEY_free(ca_ctx->falcon_pkey);
     }
     
+    free_falcon_expanded_key(ca_ctx->falcon_expanded_key);
+    cleanup_cert_verify_cache(ca_ctx->verify_cache);
     free(ca_ctx->authority_name);
     free(ca_ctx);
 }
@@ -355,36 +479,142 @@ int generate_falcon_keypair(uint8_t *public_key, uint8_t *private_key) {
     return 0;
 }
 
+// Per-thread Falcon state: a PRNG seeded once and reseeded every
+// FALCON_RESEED_INTERVAL signatures (or after fork), plus one scratch buffer
+// sized for the largest operation. Freed, zeroed, when the thread exits.
+typedef struct {
+    shake256_context rng;
+    pid_t seeded_pid;
+    unsigned long uses_since_seed;
+    void *tmp;
+} falcon_thread_ctx_t;
+
+#define FALCON_THREAD_TMP_LEN FALCON_TMPSIZE_SIGNDYN(FALCON_LOGN)
+
+static pthread_key_t falcon_thread_key;
+static pthread_once_t falcon_thread_key_once = PTHREAD_ONCE_INIT;
+
+static void free_falcon_thread_ctx(void *arg) {
+    falcon_thread_ctx_t *tctx = (falcon_thread_ctx_t *)arg;
+    if (!tctx) return;
+    if (tctx->tmp) {
+        memset(tctx->tmp, 0, FALCON_THREAD_TMP_LEN);
+        free(tctx->tmp);
+    }
+    memset(tctx, 0, sizeof(*tctx));
+    free(tctx);
+}
+
+static void create_falcon_thread_key(void) {
+    pthread_key_create(&falcon_thread_key, free_falcon_thread_ctx);
+}
+
+static falcon_thread_ctx_t *get_falcon_thread_ctx(int need_rng) {
+    pthread_once(&falcon_thread_key_once, create_falcon_thread_key);
+
+    falcon_thread_ctx_t *tctx = pthread_getspecific(falcon_thread_key);
+    if (!tctx) {
+        tctx = calloc(1, sizeof(falcon_thread_ctx_t));
+        if (!tctx) return NULL;
+        tctx->tmp = malloc(FALCON_THREAD_TMP_LEN);
+        if (!tctx->tmp || pthread_setspecific(falcon_thread_key, tctx) != 0) {
+            free(tctx->tmp);
+            free(tctx);
+            return NULL;
+        }
+    }
+
+    if (need_rng && (tctx->seeded_pid != getpid() || tctx->uses_since_seed >= FALCON_RESEED_INTERVAL)) {
+        if (shake256_init_prng_from_system(&tctx->rng) != 0) {
+            printf("ERROR: Failed to initialize PRNG for Falcon signing\n");
+            tctx->seeded_pid = 0;
+            return NULL;
+        }
+        tctx->seeded_pid = getpid();
+        tctx->uses_since_seed = 0;
+    }
+    return tctx;
+}
+
 int falcon_sign(const uint8_t *private_key, const void *data, size_t data_len, uint8_t *signature) {
     if (!private_key || !data || !signature) {
         return -1;
     }
     
-    // Initialize SHAKE256 PRNG from system entropy
-    shake256_context rng;
-    if (shake256_init_prng_from_system(&rng) != 0) {
-        printf("ERROR: Failed to initialize PRNG for Falcon signing\n");
-        return -1;
-    }
-    
-    // Allocate temporary buffer for signing
-    size_t tmp_len = FALCON_TMPSIZE_SIGNDYN(FALCON_LOGN);
-    void *tmp = malloc(tmp_len);
-    if (!tmp) {
-        printf("ERROR: Failed to allocate temporary buffer for Falcon signing\n");
+    falcon_thread_ctx_t *tctx = get_falcon_thread_ctx(1);
+    if (!tctx) {
         return -1;
     }
     
     // Sign the data
     size_t sig_len = FALCON_SIG_LEN;
-    int result = falcon_sign_dyn(&rng, signature, &sig_len, FALCON_SIG_PADDED,
+    int result = falcon_sign_dyn(&tctx->rng, signature, &sig_len, FALCON_SIG_PADDED,
                                 private_key, FALCON_PRIVKEY_LEN,
                                 data, data_len,
-                                tmp, tmp_len);
+                                tctx->tmp, FALCON_THREAD_TMP_LEN);
+    tctx->uses_since_seed++;
     
-    // Clear and free temporary buffer
-    memset(tmp, 0, tmp_len);
-    free(tmp);
+    if (result != 0) {
+        printf("ERROR: Falcon signing failed with code %d\n", result);
+        return -1;
+    }
+    
+    if (sig_len != FALCON_SIG_LEN) {
+        printf("ERROR: Falcon signature length mismatch: expected %d, got %zu\n", 
+               FALCON_SIG_LEN, sig_len);
+        return -1;
+    }
+    
+    return 0;
+}
+
+uint8_t *falcon_expand_private_key(const uint8_t *private_key) {
+    if (!private_key) {
+        return NULL;
+    }
+    
+    falcon_thread_ctx_t *tctx = get_falcon_thread_ctx(0);
+    uint8_t *expanded_key = NULL;
+    if (!tctx || posix_memalign((void **)&expanded_key, 8, FALCON_EXPANDED_KEY_LEN) != 0) {
+        printf("ERROR: Failed to allocate expanded Falcon key\n");
+        return NULL;
+    }
+    
+    int result = falcon_expand_privkey(expanded_key, FALCON_EXPANDED_KEY_LEN,
+                                       private_key, FALCON_PRIVKEY_LEN,
+                                       tctx->tmp, FALCON_THREAD_TMP_LEN);
+    if (result != 0) {
+        printf("ERROR: Falcon key expansion failed with code %d\n", result);
+        free_falcon_expanded_key(expanded_key);
+        return NULL;
+    }
+    
+    return expanded_key;
+}
+
+void free_falcon_expanded_key(uint8_t *expanded_key) {
+    if (!expanded_key) {
+        return;
+    }
+    memset(expanded_key, 0, FALCON_EXPANDED_KEY_LEN);
+    free(expanded_key);
+}
+
+int falcon_sign_expanded(const uint8_t *expanded_key, const void *data, size_t data_len, uint8_t *signature) {
+    if (!expanded_key || !data || !signature) {
+        return -1;
+    }
+    
+    falcon_thread_ctx_t *tctx = get_falcon_thread_ctx(1);
+    if (!tctx) {
+        return -1;
+    }
+    
+    size_t sig_len = FALCON_SIG_LEN;
+    int result = falcon_sign_tree(&tctx->rng, signature, &sig_len, FALCON_SIG_PADDED,
+                                  expanded_key, data, data_len,
+                                  tctx->tmp, FALCON_THREAD_TMP_LEN);
+    tctx->uses_since_seed++;
     
     if (result != 0) {
         printf("ERROR: Falcon signing failed with code %d\n", result);
@@ -400,15 +630,23 @@ int falcon_sign(const uint8_t *private_key, const void *data, size_t data_len, u
     return 0;
 }
 
+int ca_falcon_sign(ca_context_t *ca_ctx, const void *data, size_t data_len, uint8_t *signature) {
+    if (!ca_ctx) {
+        return -1;
+    }
+    if (ca_ctx->falcon_expanded_key) {
+        return falcon_sign_expanded(ca_ctx->falcon_expanded_key, data, data_len, signature);
+    }
+    return falcon_sign(ca_ctx->falcon_private_key, data, data_len, signature);
+}
+
 int falcon_verify_sig(const uint8_t *public_key, const void *data, size_t data_len, const uint8_t *signature) {
     if (!public_key || !data || !signature) {
         return -1;
     }
     
-    // Allocate temporary buffer for verification
-    size_t tmp_len = FALCON_TMPSIZE_VERIFY(FALCON_LOGN);
-    void *tmp = malloc(tmp_len);
-    if (!tmp) {
+    falcon_thread_ctx_t *tctx = get_falcon_thread_ctx(0);
+    if (!tctx) {
         printf("ERROR: Failed to allocate temporary buffer for Falcon verification\n");
         return -1;
     }
@@ -417,11 +655,7 @@ int falcon_verify_sig(const uint8_t *public_key, const void *data, size_t data_l
     int result = falcon_verify(signature, FALCON_SIG_LEN, FALCON_SIG_PADDED,
                               public_key, FALCON_PUBKEY_LEN,
                               data, data_len,
-                              tmp, tmp_len);
-    
-    // Clear and free temporary buffer
-    memset(tmp, 0, tmp_len);
-    free(tmp);
+                              tctx->tmp, FALCON_THREAD_TMP_LEN);
     
     if (result != 0) {
         printf("ERROR: Falcon signature verification failed with code %d\n", result);
@@ -429,4 +663,4 @@ int falcon_verify_sig(const uint8_t *public_key, const void *data, size_t data_l
     }
     
     return 0;
-} 
\ No newline at end of file
+}
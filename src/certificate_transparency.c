@@ -1,12 +1,261 @@
 #include "../include/certificate_transparency.h"
 #include "../include/certificate_authority.h"
+#include "../include/ct_log_store.h"
+#include "../include/keygen_pool.h"
 #include "../include/debug.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <openssl/evp.h>
+#include <openssl/pem.h>
 #include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <openssl/x509.h>
+
+// --- RFC 6962 Merkle tree ---
+
+static void hash_children(const uint8_t* left, const uint8_t* right, uint8_t out[32]) {
+    uint8_t buf[1 + 64];
+    buf[0] = 0x01;
+    memcpy(buf + 1, left, 32);
+    memcpy(buf + 33, right, 32);
+    SHA256(buf, sizeof(buf), out);
+}
+
+static uint64_t largest_power_of_two_below(uint64_t n) {
+    return 1ULL << (63 - __builtin_clzll(n - 1));
+}
+
+static int is_power_of_two(uint64_t n) {
+    return n && (n & (n - 1)) == 0;
+}
+
+static int tree_store(merkle_tree_t* tree, int level, uint64_t index, const uint8_t hash[32]) {
+    if (level >= CT_MERKLE_MAX_LEVELS) return -1;
+    if (index >= tree->level_capacity[level]) {
+        size_t capacity = tree->level_capacity[level] ? tree->level_capacity[level] * 2 : 64;
+        while (capacity <= index) capacity *= 2;
+        uint8_t (*grown)[32] = realloc(tree->levels[level], capacity * 32);
+        if (!grown) return -1;
+        tree->levels[level] = grown;
+        tree->level_capacity[level] = capacity;
+    }
+    memcpy(tree->levels[level][index], hash, 32);
+    return 0;
+}
+
+// Append a leaf and fold every subtree it completes: O(log n) worst case,
+// O(1) amortized.
+static int tree_append(merkle_tree_t* tree, const uint8_t leaf_hash[32]) {
+    uint64_t index = tree->leaf_count;
+    if (tree_store(tree, 0, index, leaf_hash) != 0) return -1;
+
+    uint8_t parent[32];
+    for (int level = 0; index & 1; ++level, index >>= 1) {
+        hash_children(tree->levels[level][index - 1], tree->levels[level][index], parent);
+        if (tree_store(tree, level + 1, index >> 1, parent) != 0) return -1;
+    }
+    tree->leaf_count++;
+    return 0;
+}
+
+static void free_tree(merkle_tree_t* tree) {
+    for (int i = 0; i < CT_MERKLE_MAX_LEVELS; ++i) {
+        free(tree->levels[i]);
+        tree->levels[i] = NULL;
+        tree->level_capacity[i] = 0;
+    }
+    tree->leaf_count = 0;
+}
+
+// MTH(D[start:start+size]). Complete aligned subtrees come straight from the
+// cache; only the ragged right edge is hashed, at most log n levels of it.
+static void subtree_hash(const merkle_tree_t* tree, uint64_t start, uint64_t size, uint8_t out[32]) {
+    if (is_power_of_two(size) && start % size == 0) {
+        int level = __builtin_ctzll(size);
+        memcpy(out, tree->levels[level][start >> level], 32);
+        return;
+    }
+    uint64_t k = largest_power_of_two_below(size);
+    uint8_t left[32], right[32];
+    subtree_hash(tree, start, k, left);
+    subtree_hash(tree, start + k, size - k, right);
+    hash_children(left, right, out);
+}
+
+// Proof paths never exceed the tree height
+#define CT_MAX_PROOF_LEN 64
+
+static void inclusion_path(const merkle_tree_t* tree, uint64_t m, uint64_t start, uint64_t n,
+                           uint8_t (*path)[32], size_t* len) {
+    if (n <= 1) return;
+    uint64_t k = largest_power_of_two_below(n);
+    if (m < k) {
+        inclusion_path(tree, m, start, k, path, len);
+        subtree_hash(tree, start + k, n - k, path[(*len)++]);
+    } else {
+        inclusion_path(tree, m - k, start + k, n - k, path, len);
+        subtree_hash(tree, start, k, path[(*len)++]);
+    }
+}
+
+static void consistency_subproof(const merkle_tree_t* tree, uint64_t m, uint64_t start, uint64_t n,
+                                 int complete, uint8_t (*path)[32], size_t* len) {
+    if (m == n) {
+        if (!complete) subtree_hash(tree, start, n, path[(*len)++]);
+        return;
+    }
+    uint64_t k = largest_power_of_two_below(n);
+    if (m <= k) {
+        consistency_subproof(tree, m, start, k, complete, path, len);
+        subtree_hash(tree, start + k, n - k, path[(*len)++]);
+    } else {
+        consistency_subproof(tree, m - k, start + k, n - k, 0, path, len);
+        subtree_hash(tree, start, k, path[(*len)++]);
+    }
+}
+
+static void tree_root(const merkle_tree_t* tree, uint64_t size, uint8_t out[32]) {
+    if (size == 0) {
+        SHA256((const unsigned char*)"", 0, out);
+    } else {
+        subtree_hash(tree, 0, size, out);
+    }
+}
+
+// --- Leaf encoding and signing ---
+
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t capacity;
+} ct_buffer_t;
+
+static int ct_buffer_put(ct_buffer_t* buf, const void* data, size_t len) {
+    if (buf->len + len > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 256;
+        while (capacity < buf->len + len) capacity *= 2;
+        uint8_t* grown = realloc(buf->data, capacity);
+        if (!grown) return -1;
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+static int ct_buffer_put_be(ct_buffer_t* buf, uint64_t value, int bytes) {
+    uint8_t tmp[8];
+    for (int i = 0; i < bytes; ++i) tmp[i] = (uint8_t)(value >> (8 * (bytes - 1 - i)));
+    return ct_buffer_put(buf, tmp, (size_t)bytes);
+}
+
+// Certificate bytes: DER when an X509 is attached, else a canonical
+// encoding of the NEXUS certificate fields.
+static int encode_certificate(const nexus_cert_t* cert, ct_buffer_t* buf) {
+    if (cert->x509) {
+        unsigned char* der = NULL;
+        int der_len = i2d_X509(cert->x509, &der);
+        if (der_len <= 0) return -1;
+        int rc = ct_buffer_put(buf, der, (size_t)der_len);
+        OPENSSL_free(der);
+        return rc;
+    }
+
+    size_t name_len = cert->common_name ? strlen(cert->common_name) : 0;
+    if (name_len > 0xFFFF || cert->signature_len > 0xFFFF) return -1;
+    return ct_buffer_put_be(buf, name_len, 2) |
+           ct_buffer_put(buf, cert->common_name ? cert->common_name : "", name_len) |
+           ct_buffer_put_be(buf, (uint64_t)cert->not_before, 8) |
+           ct_buffer_put_be(buf, (uint64_t)cert->not_after, 8) |
+           ct_buffer_put_be(buf, (uint64_t)cert->cert_type, 1) |
+           ct_buffer_put_be(buf, cert->signature_len, 2) |
+           (cert->signature_len ? ct_buffer_put(buf, cert->signature, cert->signature_len) : 0);
+}
+
+// MerkleTreeLeaf: version, leaf_type, TimestampedEntry{timestamp,
+// entry_type, cert<1..2^24-1>, extensions<0..2^16-1>}. With version and
+// leaf_type both 0 these bytes are also the SCT's signed data.
+static int encode_leaf(const nexus_cert_t* cert, uint64_t timestamp, ct_buffer_t* leaf) {
+    ct_buffer_t cert_bytes = {0};
+    int rc = encode_certificate(cert, &cert_bytes);
+    if (rc == 0 && (cert_bytes.len == 0 || cert_bytes.len > 0xFFFFFF)) rc = -1;
+    if (rc == 0) {
+        rc = ct_buffer_put_be(leaf, 0, 1) |            // version v1
+             ct_buffer_put_be(leaf, 0, 1) |            // timestamped_entry
+             ct_buffer_put_be(leaf, timestamp, 8) |
+             ct_buffer_put_be(leaf, 0, 2) |            // x509_entry
+             ct_buffer_put_be(leaf, cert_bytes.len, 3) |
+             ct_buffer_put(leaf, cert_bytes.data, cert_bytes.len) |
+             ct_buffer_put_be(leaf, 0, 2);             // no extensions
+    }
+    free(cert_bytes.data);
+    return rc;
+}
+
+static void hash_leaf(const uint8_t* leaf, size_t len, uint8_t out[32]) {
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
+    static const uint8_t prefix = 0x00;
+    unsigned int out_len = 0;
+    if (!mdctx ||
+        EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) != 1 ||
+        EVP_DigestUpdate(mdctx, &prefix, 1) != 1 ||
+        EVP_DigestUpdate(mdctx, leaf, len) != 1 ||
+        EVP_DigestFinal_ex(mdctx, out, &out_len) != 1) {
+        memset(out, 0, 32);
+    }
+    EVP_MD_CTX_free(mdctx);
+}
+
+static int log_sign(ct_log_t* log, const uint8_t* data, size_t len, uint8_t* sig, size_t capacity, size_t* sig_len) {
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
+    if (!mdctx) return -1;
+
+    size_t needed = 0;
+    int ok = EVP_DigestSignInit(mdctx, NULL, EVP_sha256(), NULL, (EVP_PKEY*)log->signing_key) == 1 &&
+             EVP_DigestSign(mdctx, NULL, &needed, data, len) == 1 &&
+             needed <= capacity &&
+             EVP_DigestSign(mdctx, sig, &needed, data, len) == 1;
+    EVP_MD_CTX_free(mdctx);
+    if (!ok) return -1;
+    *sig_len = needed;
+    return 0;
+}
+
+static int key_verify(EVP_PKEY* key, const uint8_t* data, size_t len, const uint8_t* sig, size_t sig_len) {
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
+    if (!mdctx) return -1;
+    int ok = EVP_DigestVerifyInit(mdctx, NULL, EVP_sha256(), NULL, key) == 1 &&
+             EVP_DigestVerify(mdctx, sig, sig_len, data, len) == 1;
+    EVP_MD_CTX_free(mdctx);
+    return ok ? 0 : -1;
+}
+
+static int log_verify(ct_log_t* log, const uint8_t* data, size_t len, const uint8_t* sig, size_t sig_len) {
+    return key_verify((EVP_PKEY*)log->signing_key, data, len, sig, sig_len);
+}
+
+// Shrink the tree back to size. Cached nodes past it are stale but are
+// never read for sizes <= size and get overwritten by later appends.
+static void tree_truncate(merkle_tree_t* tree, uint64_t size) {
+    if (size < tree->leaf_count) tree->leaf_count = size;
+}
+
+// TreeHeadSignature: version, signature_type tree_hash, timestamp, tree_size, root
+static void encode_tree_head(const ct_signed_tree_head_t* sth, uint8_t out[50]) {
+    out[0] = 0;
+    out[1] = 1;
+    for (int i = 0; i < 8; ++i) {
+        out[2 + i] = (uint8_t)(sth->timestamp >> (8 * (7 - i)));
+        out[10 + i] = (uint8_t)(sth->tree_size >> (8 * (7 - i)));
+    }
+    memcpy(out + 18, sth->root_hash, 32);
+}
 
 // Initialize certificate transparency for a network context
 ct_log_t* init_certificate_transparency(network_context_t *net_ctx) {
@@ -25,152 +274,641 @@ void cleanup_certificate_transparency(ct_log_t *ct_log) {
     cleanup_ct_log(ct_log);
 }
 
-// Create a new CT log
-ct_log_t* create_ct_log(const char* log_id, const char* log_url) {
-    if (!log_id || !log_url) {
+// --- Entries ---
+
+static void free_entry_cert(nexus_cert_t* cert) {
+    if (!cert) return;
+    X509_free(cert->x509);
+    free(cert->common_name);
+    free(cert->signature);
+    free(cert);
+}
+
+// Copy of the fields the log keeps. The X509 is shared, not copied: the
+// leaf hash covers its DER, so the entry cannot be re-hashed without it.
+static nexus_cert_t* copy_entry_cert(const nexus_cert_t* cert) {
+    nexus_cert_t* copy = calloc(1, sizeof(nexus_cert_t));
+    if (!copy) return NULL;
+    if (cert->x509 && X509_up_ref(cert->x509) == 1) copy->x509 = cert->x509;
+    copy->common_name = strdup(cert->common_name ? cert->common_name : "");
+    copy->not_before = cert->not_before;
+    copy->not_after = cert->not_after;
+    copy->cert_type = cert->cert_type;
+    if (cert->signature && cert->signature_len) {
+        copy->signature = malloc(cert->signature_len);
+        if (copy->signature) {
+            memcpy(copy->signature, cert->signature, cert->signature_len);
+            copy->signature_len = cert->signature_len;
+        }
+    }
+    if (!copy->common_name || (cert->signature_len && !copy->signature) ||
+        (cert->x509 && !copy->x509)) {
+        free_entry_cert(copy);
         return NULL;
     }
+    return copy;
+}
+
+// In-memory entry for index, or NULL if only the store has it. Caller holds
+// the log lock. Store-backed logs keep entries as a ring of recent leaves.
+static ct_entry_t* cached_entry(ct_log_t* log, uint64_t index) {
+    if (index >= log->entry_count) return NULL;
+    if (!log->store) return &log->entries[index];
+    ct_entry_t* slot = &log->entries[index % log->max_entries];
+    return (slot->cert && slot->index == index) ? slot : NULL;
+}
+
+// Deep copy of entry index into out. Caller holds the log lock.
+static int read_entry_locked(ct_log_t* log, uint64_t index, ct_entry_t* out) {
+    ct_entry_t* entry = cached_entry(log, index);
+    if (entry) {
+        *out = *entry;
+        out->cert = copy_entry_cert(entry->cert);
+        return out->cert ? 0 : -1;
+    }
+    if (log->store && index < log->entry_count) {
+        return ct_log_store_read(log->store, index, out);
+    }
+    return -1;
+}
+
+// --- Log lifecycle ---
+
+static EVP_PKEY* generate_log_key(void) {
+    return keygen_pool_take_rsa(get_default_keygen_pool());
+}
+
+// The log key has to survive restarts or old SCTs and STHs stop verifying
+static EVP_PKEY* load_or_generate_log_key(const char* dir) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/log.key", dir);
+    
+    FILE* fp = fopen(path, "r");
+    if (fp) {
+        EVP_PKEY* key = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
+        fclose(fp);
+        if (!key) dlog("CT log: unreadable key in %s", path);
+        return key;
+    }
+    
+    EVP_PKEY* key = generate_log_key();
+    if (!key) return NULL;
     
-    ct_log_t *log = malloc(sizeof(ct_log_t));
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    int ok = fp && PEM_write_PrivateKey(fp, key, NULL, NULL, 0, NULL, NULL) == 1 &&
+             fflush(fp) == 0 && fsync(fd) == 0;
+    if (fp) {
+        fclose(fp);
+    } else if (fd >= 0) {
+        close(fd);
+    }
+    if (!ok) {
+        dlog("CT log: failed to write key %s", path);
+        unlink(path);
+        EVP_PKEY_free(key);
+        return NULL;
+    }
+    return key;
+}
+
+static ct_log_t* new_ct_log(const char* log_id, const char* log_url, EVP_PKEY* signing_key, size_t capacity) {
+    ct_log_t *log = calloc(1, sizeof(ct_log_t));
     if (!log) {
         return NULL;
     }
     
-    memset(log, 0, sizeof(ct_log_t));
-    
     log->log_id = strdup(log_id);
     log->log_url = strdup(log_url);
+    log->max_entries = capacity;
+    log->entries = calloc(log->max_entries, sizeof(ct_entry_t));
     
-    if (!log->log_id || !log->log_url) {
+    if (!log->log_id || !log->log_url || !log->entries ||
+        pthread_mutex_init(&log->lock, NULL) != 0) {
+        free(log->entries);
         free(log->log_id);
         free(log->log_url);
         free(log);
         return NULL;
     }
     
+    log->signing_key = signing_key;
+    return log;
+}
+
+// Create a new in-memory CT log
+ct_log_t* create_ct_log(const char* log_id, const char* log_url) {
+    if (!log_id || !log_url) {
+        return NULL;
+    }
+    
     // Generate RSA key for CT log signing
-    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
-    if (!ctx) {
-        free(log->log_id);
-        free(log->log_url);
-        free(log);
+    EVP_PKEY *signing_key = generate_log_key();
+    if (!signing_key) {
         return NULL;
     }
     
-    EVP_PKEY *signing_key = NULL;
-    if (EVP_PKEY_keygen_init(ctx) <= 0 ||
-        EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) <= 0 ||
-        EVP_PKEY_keygen(ctx, &signing_key) <= 0) {
-        EVP_PKEY_CTX_free(ctx);
-        free(log->log_id);
-        free(log->log_url);
-        free(log);
+    ct_log_t *log = new_ct_log(log_id, log_url, signing_key, 1000);
+    if (!log) {
+        EVP_PKEY_free(signing_key);
         return NULL;
     }
     
-    EVP_PKEY_CTX_free(ctx);
-    log->signing_key = signing_key;
+    printf("CT log '%s' created successfully\n", log_id);
+    return log;
+}
+
+// Open (or create) a CT log stored under dir. Entries live in append-only
+// segments; only the Merkle levels and the most recent entries stay in RAM.
+ct_log_t* open_ct_log(const char* log_id, const char* log_url, const char* dir) {
+    if (!log_id || !log_url || !dir) {
+        return NULL;
+    }
     
-    log->max_entries = 1000;
-    log->entries = malloc(log->max_entries * sizeof(ct_entry_t));
-    if (!log->entries) {
-        EVP_PKEY_free((EVP_PKEY*)log->signing_key);
-        free(log->log_id);
-        free(log->log_url);
-        free(log);
+    ct_log_store_t *store = NULL;
+    if (open_ct_log_store(dir, &store) != 0) {
         return NULL;
     }
     
-    if (pthread_mutex_init(&log->lock, NULL) != 0) {
-        free(log->entries);
-        EVP_PKEY_free((EVP_PKEY*)log->signing_key);
-        free(log->log_id);
-        free(log->log_url);
-        free(log);
+    EVP_PKEY *signing_key = load_or_generate_log_key(dir);
+    ct_log_t *log = signing_key ? new_ct_log(log_id, log_url, signing_key, CT_LOG_RECENT_ENTRIES) : NULL;
+    if (!log) {
+        EVP_PKEY_free(signing_key);
+        close_ct_log_store(store);
         return NULL;
     }
+    log->store = store;
     
-    printf("CT log '%s' created successfully\n", log_id);
+    // Rebuild the tree from the leaf hashes in the index
+    uint64_t count = ct_log_store_count(store);
+    uint8_t leaf_hash[32];
+    for (uint64_t i = 0; i < count; i++) {
+        if (ct_log_store_leaf_hash(store, i, leaf_hash) != 0 ||
+            tree_append(&log->tree, leaf_hash) != 0) {
+            dlog("CT log '%s': failed to rebuild tree at entry %llu", log_id, (unsigned long long)i);
+            cleanup_ct_log(log);
+            return NULL;
+        }
+    }
+    log->entry_count = (size_t)count;
+    
+    dlog("CT log '%s' opened from %s with %llu entries", log_id, dir, (unsigned long long)count);
     return log;
 }
 
+// Encode and hash a leaf, optionally sign it, and copy the certificate.
+// Runs outside the log lock.
+static int prepare_entry(ct_log_t* log, const nexus_cert_t* cert, uint64_t timestamp, int sign, ct_entry_t* entry) {
+    memset(entry, 0, sizeof(*entry));
+    ct_buffer_t leaf = {0};
+    if (encode_leaf(cert, timestamp, &leaf) != 0) {
+        free(leaf.data);
+        return -1;
+    }
+    
+    entry->timestamp = timestamp;
+    entry->log_entry_type = 0; // X.509 certificate
+    hash_leaf(leaf.data, leaf.len, entry->leaf_hash);
+    int signed_ok = !sign || log_sign(log, leaf.data, leaf.len, entry->signature,
+                                      sizeof(entry->signature), &entry->signature_len) == 0;
+    free(leaf.data);
+    if (!signed_ok) {
+        dlog("CT log '%s': failed to sign entry for '%s'", log->log_id, cert->common_name);
+        return -1;
+    }
+    
+    // Generate log ID (simplified - use first 32 bytes of log_id string)
+    strncpy((char*)entry->log_id, log->log_id, sizeof(entry->log_id) - 1);
+    
+    // Copy certificate data
+    entry->cert = copy_entry_cert(cert);
+    return entry->cert ? 0 : -1;
+}
+
+// Make entries durable (store) or reserve room for them (in-memory); returns
+// how many may be added to the tree. With a store they are synced once,
+// before any of them can appear in a tree head. Caller holds the log lock.
+static size_t persist_entries_locked(ct_log_t* log, ct_entry_t* entries, size_t count) {
+    size_t n = 0;
+    if (log->store) {
+        uint64_t committed = ct_log_store_count(log->store);
+        while (n < count) {
+            entries[n].index = log->entry_count + n;
+            if (ct_log_store_append(log->store, &entries[n]) != 0) break;
+            n++;
+        }
+        if (n > 0 && ct_log_store_sync(log->store) != 0) {
+            dlog("CT log '%s': store sync failed", log->log_id);
+            ct_log_store_truncate(log->store, committed);
+            return 0;
+        }
+    } else {
+        if (log->entry_count + count > log->max_entries) {
+            size_t capacity = log->max_entries ? log->max_entries * 2 : 1024;
+            while (capacity < log->entry_count + count) capacity *= 2;
+            ct_entry_t *grown = realloc(log->entries, capacity * sizeof(ct_entry_t));
+            if (!grown) return 0;
+            log->entries = grown;
+            log->max_entries = capacity;
+        }
+        n = count;
+    }
+    return n;
+}
+
+// Hand an entry whose leaf is already in the tree to the log
+static void cache_entry_locked(ct_log_t* log, ct_entry_t* entry) {
+    entry->index = log->entry_count;
+    ct_entry_t *slot = &log->entries[log->store ? entry->index % log->max_entries : entry->index];
+    if (log->store) free_entry_cert(slot->cert);
+    *slot = *entry;
+    log->entry_count++;
+}
+
+// Append prepared entries in order; returns how many became part of the
+// tree. Caller holds the log lock.
+static size_t append_entries_locked(ct_log_t* log, ct_entry_t* entries, size_t count) {
+    size_t n = persist_entries_locked(log, entries, count);
+    size_t appended = 0;
+    for (; appended < n; appended++) {
+        if (tree_append(&log->tree, entries[appended].leaf_hash) != 0) break;
+        cache_entry_locked(log, &entries[appended]);
+    }
+    // Stored entries the tree could not take must not reappear on reopen
+    if (appended < n && log->store) ct_log_store_truncate(log->store, log->entry_count);
+    return appended;
+}
+
 // Add certificate to CT log
 int add_certificate_to_ct_log(ct_log_t* log, nexus_cert_t* cert) {
-    if (!log || !cert) {
+    if (!log || !cert || !cert->common_name) {
+        return -1;
+    }
+    
+    // Encode, hash and sign outside the lock; only the append is serialized
+    ct_entry_t new_entry;
+    if (prepare_entry(log, cert, (uint64_t)time(NULL), 1, &new_entry) != 0) {
+        free_entry_cert(new_entry.cert);
         return -1;
     }
     
     pthread_mutex_lock(&log->lock);
+    int ok = append_entries_locked(log, &new_entry, 1) == 1;
+    pthread_mutex_unlock(&log->lock);
     
-    if (log->entry_count >= log->max_entries) {
-        pthread_mutex_unlock(&log->lock);
-        return -1; // Log is full
+    if (!ok) {
+        dlog("CT log '%s': failed to append entry for '%s'", log->log_id, cert->common_name);
+        free_entry_cert(new_entry.cert);
+        return -1;
     }
     
-    ct_entry_t *entry = &log->entries[log->entry_count];
-    memset(entry, 0, sizeof(ct_entry_t));
+    printf("Certificate for '%s' added to CT log\n", cert->common_name);
+    return 0;
+}
+
+// --- Batched submission ---
+
+// Sign and publish a tree head for the tree as of tree_size/root
+static int issue_sth(ct_log_t* log, uint64_t tree_size, const uint8_t root[32], ct_signed_tree_head_t* sth_out) {
+    ct_signed_tree_head_t sth;
+    memset(&sth, 0, sizeof(sth));
+    sth.tree_size = tree_size;
+    sth.timestamp = (uint64_t)time(NULL);
+    memcpy(sth.root_hash, root, 32);
     
-    // Copy certificate data
-    entry->cert = malloc(sizeof(nexus_cert_t));
-    if (!entry->cert) {
-        pthread_mutex_unlock(&log->lock);
+    uint8_t tbs[50];
+    encode_tree_head(&sth, tbs);
+    if (log_sign(log, tbs, sizeof(tbs), sth.signature, sizeof(sth.signature), &sth.signature_len) != 0) {
         return -1;
     }
     
-    memset(entry->cert, 0, sizeof(nexus_cert_t));
-    entry->cert->common_name = strdup(cert->common_name);
-    entry->cert->not_before = cert->not_before;
-    entry->cert->not_after = cert->not_after;
-    entry->cert->cert_type = cert->cert_type;
+    pthread_mutex_lock(&log->lock);
+    if (sth.tree_size >= log->sth.tree_size) {
+        log->sth = sth;
+    }
+    pthread_mutex_unlock(&log->lock);
     
-    // Copy signature (simplified - just copy the pointer for now)
-    entry->cert->signature = cert->signature;
-    entry->cert->signature_len = cert->signature_len;
+    *sth_out = sth;
+    return 0;
+}
+
+// Append certificates as one batch: a single store sync and a single signed
+// tree head, with each promise carrying its inclusion path to that head.
+// Returns how many certificates, from the front, are now in the log.
+int ct_log_submit_batch(ct_log_t* log, nexus_cert_t** certs, size_t count, ct_sct_t* scts_out) {
+    if (!log || !certs || !scts_out || count > INT_MAX) return -1;
+    if (count == 0) return 0;
+    memset(scts_out, 0, count * sizeof(ct_sct_t));
     
-    // Set entry metadata
-    entry->timestamp = time(NULL);
-    entry->log_entry_type = 0; // X.509 certificate
+    ct_entry_t *entries = calloc(count, sizeof(ct_entry_t));
+    if (!entries) return -1;
     
-    // Generate log ID (simplified - use first 32 bytes of log_id string)
-    strncpy((char*)entry->log_id, log->log_id, sizeof(entry->log_id) - 1);
+    uint64_t timestamp = (uint64_t)time(NULL);
+    for (size_t i = 0; i < count; i++) {
+        if (!certs[i] || !certs[i]->common_name ||
+            prepare_entry(log, certs[i], timestamp, 0, &entries[i]) != 0) {
+            for (size_t j = 0; j <= i && j < count; j++) free_entry_cert(entries[j].cert);
+            free(entries);
+            return -1;
+        }
+    }
     
-    // Sign the entry (simplified - just set a dummy signature for now)
-    memset(entry->signature, 0x42, sizeof(entry->signature)); // Dummy signature
+    uint64_t tree_size = 0;
+    uint8_t root[32];
+    pthread_mutex_lock(&log->lock);
+    size_t appended = append_entries_locked(log, entries, count);
+    if (appended > 0) {
+        tree_size = log->tree.leaf_count;
+        tree_root(&log->tree, tree_size, root);
+        for (size_t i = 0; i < appended; i++) {
+            ct_sct_t *sct = &scts_out[i];
+            sct->leaf_index = entries[i].index;
+            sct->timestamp = timestamp;
+            memcpy(sct->leaf_hash, entries[i].leaf_hash, 32);
+            inclusion_path(&log->tree, sct->leaf_index, 0, tree_size, sct->path, &sct->path_len);
+        }
+    }
+    pthread_mutex_unlock(&log->lock);
     
-    log->entry_count++;
+    for (size_t i = appended; i < count; i++) {
+        free_entry_cert(entries[i].cert);
+    }
+    free(entries);
     
-    pthread_mutex_unlock(&log->lock);
+    if (appended < count) {
+        dlog("CT log '%s': %zu of a batch of %zu could not be appended", log->log_id,
+             count - appended, count);
+    }
+    if (appended == 0) return 0;
     
-    printf("Certificate for '%s' added to CT log\n", cert->common_name);
-    return 0;
+    // One signature for the whole batch. Without it the entries are still
+    // logged, and the next tree head covers them.
+    ct_signed_tree_head_t sth;
+    if (issue_sth(log, tree_size, root, &sth) != 0) {
+        dlog("CT log '%s': failed to sign tree head %llu", log->log_id, (unsigned long long)tree_size);
+        return (int)appended;
+    }
+    for (size_t i = 0; i < appended; i++) {
+        scts_out[i].sth = sth;
+    }
+    
+    dlog("CT log '%s': appended batch of %zu, tree size %llu", log->log_id, appended, (unsigned long long)tree_size);
+    return (int)appended;
 }
 
-// Verify certificate signature (simplified version)
-int verify_certificate_signature(nexus_cert_t* cert, ca_context_t* ca_ctx) {
-    if (!cert || !ca_ctx) {
+// Issue certificates in parallel and log them under one tree head. Only
+// logged certificates are handed out; the rest are freed and set to NULL.
+int ct_issue_certificates_batch(ca_context_t* ca_ctx, ct_log_t* log, const char** common_names, size_t count,
+                                int workers, nexus_cert_t** certs_out, ct_sct_t* scts_out) {
+    if (!ca_ctx || !log || !certs_out) return -1;
+
+    if (ca_issue_certificates_batch(ca_ctx, common_names, count, workers, certs_out) != 0) {
         return -1;
     }
+    int rc = ct_log_submit_batch(log, certs_out, count, scts_out);
+    size_t logged = rc > 0 ? (size_t)rc : 0;
+    if (logged < count) {
+        log_error("CT log rejected %zu of a batch of %zu issued certificates", count - logged, count);
+        for (size_t i = logged; i < count; i++) {
+            free_certificate(certs_out[i]);
+            certs_out[i] = NULL;
+        }
+    }
+    return (int)logged;
+}
+
+typedef struct ct_batch_request_s {
+    nexus_cert_t *cert;
+    ct_sct_t *sct;
+    int status;
+    int done;
+    struct ct_batch_request_s *next;
+} ct_batch_request_t;
+
+struct ct_batcher_s {
+    ct_log_t *log;
+    ct_batch_config_t config;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    ct_batch_request_t *head;
+    ct_batch_request_t *tail;
+    size_t pending;
+    struct timespec oldest;     // Enqueue time of head
+    int running;
+};
+
+static void run_batch(struct ct_batcher_s* batcher, ct_batch_request_t* requests, size_t count) {
+    nexus_cert_t **certs = malloc(count * sizeof(nexus_cert_t*));
+    ct_sct_t *scts = malloc(count * sizeof(ct_sct_t));
+    if (certs && scts) {
+        size_t i = 0;
+        for (ct_batch_request_t *r = requests; r; r = r->next) certs[i++] = r->cert;
+        ct_log_submit_batch(batcher->log, certs, count, scts);
+    }
     
-    // Use the existing certificate verification function
-    return verify_certificate(cert, ca_ctx);
+    pthread_mutex_lock(&batcher->lock);
+    size_t i = 0;
+    for (ct_batch_request_t *r = requests; r; r = r->next, i++) {
+        // A zero tree size marks entries that did not make it into the batch
+        r->status = (certs && scts && scts[i].sth.tree_size > 0) ? 0 : -1;
+        if (r->status == 0 && r->sct) *r->sct = scts[i];
+        r->done = 1;
+    }
+    pthread_cond_broadcast(&batcher->done_cond);
+    pthread_mutex_unlock(&batcher->lock);
+    
+    free(certs);
+    free(scts);
+}
+
+static void* ct_batch_thread(void* arg) {
+    struct ct_batcher_s *batcher = arg;
+    
+    pthread_mutex_lock(&batcher->lock);
+    while (batcher->running || batcher->pending > 0) {
+        if (batcher->pending == 0) {
+            pthread_cond_wait(&batcher->work_cond, &batcher->lock);
+            continue;
+        }
+        
+        // Hold the batch open until it is full or its oldest entry is due
+        if (batcher->running && batcher->pending < batcher->config.max_batch) {
+            struct timespec deadline = batcher->oldest;
+            deadline.tv_sec += batcher->config.max_delay_ms / 1000;
+            deadline.tv_nsec += (long)(batcher->config.max_delay_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            if (pthread_cond_timedwait(&batcher->work_cond, &batcher->lock, &deadline) == 0) {
+                continue;
+            }
+        }
+        
+        ct_batch_request_t *requests = batcher->head;
+        size_t count = batcher->pending;
+        batcher->head = batcher->tail = NULL;
+        batcher->pending = 0;
+        pthread_mutex_unlock(&batcher->lock);
+        
+        run_batch(batcher, requests, count);
+        
+        pthread_mutex_lock(&batcher->lock);
+    }
+    pthread_mutex_unlock(&batcher->lock);
+    return NULL;
 }
 
-// Sign certificate with CT log (simplified version)
-int ct_sign_certificate(ct_log_t* log, nexus_cert_t* cert) {
-    if (!log || !cert) {
+int start_ct_log_batching(ct_log_t* log, const ct_batch_config_t* config) {
+    if (!log || log->batcher) return -1;
+    
+    struct ct_batcher_s *batcher = calloc(1, sizeof(struct ct_batcher_s));
+    if (!batcher) return -1;
+    batcher->log = log;
+    batcher->config.max_delay_ms = config && config->max_delay_ms > 0 ? config->max_delay_ms : CT_BATCH_DEFAULT_DELAY_MS;
+    batcher->config.max_batch = config && config->max_batch > 0 ? config->max_batch : CT_BATCH_DEFAULT_SIZE;
+    batcher->running = 1;
+    
+    pthread_mutex_init(&batcher->lock, NULL);
+    pthread_cond_init(&batcher->work_cond, NULL);
+    pthread_cond_init(&batcher->done_cond, NULL);
+    if (pthread_create(&batcher->thread, NULL, ct_batch_thread, batcher) != 0) {
+        pthread_cond_destroy(&batcher->done_cond);
+        pthread_cond_destroy(&batcher->work_cond);
+        pthread_mutex_destroy(&batcher->lock);
+        free(batcher);
         return -1;
     }
     
-    // For now, just set a dummy signature
-    if (!cert->signature) {
-        cert->signature = malloc(256);
-        cert->signature_len = 256;
+    log->batcher = batcher;
+    dlog("CT log '%s': batching up to %zu entries every %d ms", log->log_id,
+         batcher->config.max_batch, batcher->config.max_delay_ms);
+    return 0;
+}
+
+// Flushes queued submissions. Call once submitters have stopped.
+void stop_ct_log_batching(ct_log_t* log) {
+    if (!log || !log->batcher) return;
+    struct ct_batcher_s *batcher = log->batcher;
+    
+    pthread_mutex_lock(&batcher->lock);
+    batcher->running = 0;
+    pthread_cond_signal(&batcher->work_cond);
+    pthread_mutex_unlock(&batcher->lock);
+    pthread_join(batcher->thread, NULL);
+    
+    log->batcher = NULL;
+    pthread_cond_destroy(&batcher->done_cond);
+    pthread_cond_destroy(&batcher->work_cond);
+    pthread_mutex_destroy(&batcher->lock);
+    free(batcher);
+}
+
+// Submit a certificate and wait for its inclusion promise. With batching
+// started the entry rides along with concurrent submissions; otherwise it
+// is a batch of one.
+int ct_sign_certificate(ct_log_t* log, nexus_cert_t* cert, ct_sct_t* sct_out) {
+    if (!log || !cert || !cert->common_name) {
+        return -1;
     }
     
-    memset(cert->signature, 0x43, cert->signature_len); // Dummy CT signature
+    struct ct_batcher_s *batcher = log->batcher;
+    if (!batcher) {
+        ct_sct_t sct;
+        ct_sct_t *out = sct_out ? sct_out : &sct;
+        return ct_log_submit_batch(log, &cert, 1, out) == 1 && out->sth.tree_size > 0 ? 0 : -1;
+    }
     
-    printf("Certificate for '%s' signed by CT log\n", cert->common_name);
-    return 0;
+    ct_batch_request_t request = { cert, sct_out, -1, 0, NULL };
+    pthread_mutex_lock(&batcher->lock);
+    if (!batcher->running) {
+        pthread_mutex_unlock(&batcher->lock);
+        return -1;
+    }
+    if (batcher->tail) {
+        batcher->tail->next = &request;
+    } else {
+        batcher->head = &request;
+        clock_gettime(CLOCK_REALTIME, &batcher->oldest);
+    }
+    batcher->tail = &request;
+    batcher->pending++;
+    if (batcher->pending == 1 || batcher->pending >= batcher->config.max_batch) {
+        pthread_cond_signal(&batcher->work_cond);
+    }
+    while (!request.done) {
+        pthread_cond_wait(&batcher->done_cond, &batcher->lock);
+    }
+    pthread_mutex_unlock(&batcher->lock);
+    
+    return request.status;
+}
+
+// Append entries copied from another log. The leaves go into the tree
+// first and are kept only if the new root is consistent with target_root,
+// the peer's signed head, at proof->second_size.
+int ct_log_append_replicated(ct_log_t* log, ct_entry_t* entries, size_t count,
+                             const ct_consistency_proof_t* proof, const uint8_t target_root[32]) {
+    if (!log || !entries || count == 0 || !proof || !target_root) return -1;
+    
+    pthread_mutex_lock(&log->lock);
+    uint64_t old_size = log->tree.leaf_count;
+    int ok = proof->first_size == old_size + count;
+    size_t n = 0;
+    for (; ok && n < count; n++) {
+        if (tree_append(&log->tree, entries[n].leaf_hash) != 0) ok = 0;
+    }
+    if (ok) {
+        uint8_t root[32];
+        tree_root(&log->tree, log->tree.leaf_count, root);
+        ok = verify_ct_consistency_proof(proof, root, target_root) == 0;
+        if (!ok) {
+            dlog("CT log '%s': replicated entries %llu..%llu do not match the peer's tree head",
+                 log->log_id, (unsigned long long)old_size, (unsigned long long)(old_size + count));
+        }
+    }
+    
+    // Entries that could not be persisted are dropped from the tree again;
+    // whatever prefix was persisted is part of a verified tree.
+    n = ok ? persist_entries_locked(log, entries, count) : 0;
+    tree_truncate(&log->tree, old_size + n);
+    for (size_t i = 0; i < n; i++) {
+        cache_entry_locked(log, &entries[i]);
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    for (size_t i = n; i < count; i++) {
+        free_entry_cert(entries[i].cert);
+        entries[i].cert = NULL;
+    }
+    return n == count ? 0 : -1;
+}
+
+int ct_log_public_key(ct_log_t* log, uint8_t** der_out, size_t* len_out) {
+    if (!log || !der_out || !len_out) return -1;
+    
+    unsigned char* der = NULL;
+    int der_len = i2d_PUBKEY((EVP_PKEY*)log->signing_key, &der);
+    if (der_len <= 0) return -1;
+    *der_out = malloc((size_t)der_len);
+    if (*der_out) {
+        memcpy(*der_out, der, (size_t)der_len);
+        *len_out = (size_t)der_len;
+    }
+    OPENSSL_free(der);
+    return *der_out ? 0 : -1;
+}
+
+// Verify certificate signature (simplified version)
+int verify_certificate_signature(nexus_cert_t* cert, ca_context_t* ca_ctx) {
+    if (!cert || !ca_ctx) {
+        return -1;
+    }
+    
+    // Use the existing certificate verification function
+    return verify_certificate(cert, ca_ctx);
 }
 
 // Cleanup CT log
@@ -179,16 +917,17 @@ void cleanup_ct_log(ct_log_t* log) {
         return;
     }
     
+    stop_ct_log_batching(log);
     pthread_mutex_lock(&log->lock);
     
-    for (size_t i = 0; i < log->entry_count; i++) {
-        if (log->entries[i].cert) {
-            free(log->entries[i].cert->common_name);
-            free(log->entries[i].cert);
-        }
+    size_t cached = log->store ? log->max_entries : log->entry_count;
+    for (size_t i = 0; i < cached; i++) {
+        free_entry_cert(log->entries[i].cert);
     }
     
     free(log->entries);
+    close_ct_log_store(log->store);
+    free_tree(&log->tree);
     if (log->signing_key) {
         EVP_PKEY_free((EVP_PKEY*)log->signing_key);
     }
@@ -201,30 +940,326 @@ void cleanup_ct_log(ct_log_t* log) {
     free(log);
 }
 
-// Stub implementations for other functions to satisfy linker
+int ct_log_get_entry(ct_log_t* log, uint64_t index, ct_entry_t* out) {
+    if (!log || !out) return -1;
+    
+    pthread_mutex_lock(&log->lock);
+    int rc = read_entry_locked(log, index, out);
+    pthread_mutex_unlock(&log->lock);
+    return rc;
+}
+
+void ct_free_entry(ct_entry_t* entry) {
+    if (!entry) return;
+    free_entry_cert(entry->cert);
+    entry->cert = NULL;
+}
+
+// Root implied by an inclusion path (RFC 9162 2.1.3.2)
+static int inclusion_root(const uint8_t leaf_hash[32], uint64_t leaf_index, uint64_t tree_size,
+                          const uint8_t* const* path, size_t path_len, uint8_t out[32]) {
+    if (tree_size == 0 || leaf_index >= tree_size) return -1;
+    
+    uint64_t fn = leaf_index;
+    uint64_t sn = tree_size - 1;
+    uint8_t r[32];
+    memcpy(r, leaf_hash, 32);
+    
+    for (size_t i = 0; i < path_len; i++) {
+        if (sn == 0) return -1;
+        if ((fn & 1) || fn == sn) {
+            hash_children(path[i], r, r);
+            if (!(fn & 1)) {
+                while (!(fn & 1) && fn != 0) {
+                    fn >>= 1;
+                    sn >>= 1;
+                }
+            }
+        } else {
+            hash_children(r, path[i], r);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+    if (sn != 0) return -1;
+    memcpy(out, r, 32);
+    return 0;
+}
+
+// Inclusion proof verification. Returns 0 when the entry's leaf hash is
+// included in the tree described by the proof.
 int verify_merkle_proof(ct_entry_t* entry_to_verify, merkle_proof_t* proof) {
-    (void)entry_to_verify;
-    (void)proof;
-    printf("WARNING: Merkle proof verification not implemented\n");
-    return 0; // Stub implementation
+    if (!entry_to_verify || !proof || proof->path_len < 0) {
+        return -1;
+    }
+    if (proof->path_len > 0 && !proof->path) {
+        return -1;
+    }
+    
+    uint8_t r[32];
+    if (inclusion_root(entry_to_verify->leaf_hash, proof->leaf_index, proof->tree_size,
+                       (const uint8_t* const*)proof->path, (size_t)proof->path_len, r) != 0) {
+        return -1;
+    }
+    return memcmp(r, proof->root_hash, 32) == 0 ? 0 : -1;
+}
+
+// A promise holds if the tree head is the log's, the leaf matches the
+// certificate as logged, and the path leads from the leaf to that head.
+int ct_leaf_hash(const nexus_cert_t* cert, uint64_t timestamp, uint8_t hash_out[32]) {
+    if (!cert || !hash_out) return -1;
+    ct_buffer_t leaf = {0};
+    int rc = encode_leaf(cert, timestamp, &leaf);
+    if (rc == 0) hash_leaf(leaf.data, leaf.len, hash_out);
+    free(leaf.data);
+    return rc;
+}
+
+int verify_ct_sct(ct_log_t* log, const nexus_cert_t* cert, const ct_sct_t* sct) {
+    if (!log || !cert || !sct || sct->path_len > CT_MERKLE_MAX_LEVELS) return -1;
+    if (verify_ct_sth(log, &sct->sth) != 0) return -1;
+    
+    uint8_t leaf_hash[32];
+    if (ct_leaf_hash(cert, sct->timestamp, leaf_hash) != 0 || memcmp(leaf_hash, sct->leaf_hash, 32) != 0) {
+        return -1;
+    }
+    
+    const uint8_t* path[CT_MERKLE_MAX_LEVELS];
+    for (size_t i = 0; i < sct->path_len; i++) path[i] = sct->path[i];
+    
+    uint8_t root[32];
+    if (inclusion_root(leaf_hash, sct->leaf_index, sct->sth.tree_size, path, sct->path_len, root) != 0) {
+        return -1;
+    }
+    return memcmp(root, sct->sth.root_hash, 32) == 0 ? 0 : -1;
 }
 
 merkle_proof_t* generate_merkle_proof(ct_log_t* log, size_t entry_index) {
-    (void)log;
-    (void)entry_index;
-    printf("WARNING: Merkle proof generation not implemented\n");
-    return NULL; // Stub implementation
+    if (!log) return NULL;
+    
+    merkle_proof_t* proof = calloc(1, sizeof(merkle_proof_t));
+    uint8_t (*hashes)[32] = malloc(CT_MAX_PROOF_LEN * 32);
+    if (!proof || !hashes) {
+        free(proof);
+        free(hashes);
+        return NULL;
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    ct_entry_t entry;
+    if (read_entry_locked(log, entry_index, &entry) != 0) {
+        pthread_mutex_unlock(&log->lock);
+        free(proof);
+        free(hashes);
+        return NULL;
+    }
+    
+    size_t len = 0;
+    proof->tree_size = log->tree.leaf_count;
+    proof->leaf_index = entry_index;
+    inclusion_path(&log->tree, entry_index, 0, proof->tree_size, hashes, &len);
+    tree_root(&log->tree, proof->tree_size, proof->root_hash);
+    pthread_mutex_unlock(&log->lock);
+    
+    proof->cert = entry.cert;
+    proof->timestamp = entry.timestamp;
+    proof->log_id = malloc(sizeof(entry.log_id));
+    if (proof->log_id) {
+        memcpy(proof->log_id, entry.log_id, sizeof(entry.log_id));
+    }
+    
+    // One allocation: the pointer table followed by the hashes it points at
+    proof->path = malloc(len * (sizeof(uint8_t*) + 32) + 1);
+    if (!proof->path) {
+        free(hashes);
+        free_merkle_proof(proof);
+        return NULL;
+    }
+    uint8_t* storage = (uint8_t*)(proof->path + len);
+    for (size_t i = 0; i < len; i++) {
+        proof->path[i] = storage + i * 32;
+        memcpy(proof->path[i], hashes[i], 32);
+    }
+    proof->path_len = (int)len;
+    free(hashes);
+    
+    unsigned char* pubkey = NULL;
+    int pubkey_len = i2d_PUBKEY((EVP_PKEY*)log->signing_key, &pubkey);
+    if (pubkey_len > 0) {
+        proof->log_pubkey = malloc((size_t)pubkey_len);
+        if (proof->log_pubkey) {
+            memcpy(proof->log_pubkey, pubkey, (size_t)pubkey_len);
+            proof->log_pubkey_len = (size_t)pubkey_len;
+        }
+        OPENSSL_free(pubkey);
+    }
+    
+    return proof;
 }
 
 void free_merkle_proof(merkle_proof_t* proof) {
-    (void)proof;
-    // Stub implementation
+    if (!proof) return;
+    free_entry_cert(proof->cert);
+    free(proof->path);
+    free(proof->log_id);
+    free(proof->log_pubkey);
+    free(proof);
 }
 
-// Network operations (stubs)
-int sync_ct_log_with_peers(ct_log_t *ct_log, network_context_t *net_ctx) {
-    (void)ct_log;
-    (void)net_ctx;
-    printf("WARNING: CT log peer sync not implemented\n");
-    return 0; // Stub implementation
-} 
\ No newline at end of file
+uint64_t ct_log_size(ct_log_t* log) {
+    if (!log) return 0;
+    pthread_mutex_lock(&log->lock);
+    uint64_t size = log->tree.leaf_count;
+    pthread_mutex_unlock(&log->lock);
+    return size;
+}
+
+int ct_log_root_hash(ct_log_t* log, uint64_t tree_size, uint8_t root_out[32]) {
+    if (!log || !root_out) return -1;
+    
+    pthread_mutex_lock(&log->lock);
+    int ok = tree_size <= log->tree.leaf_count;
+    if (ok) tree_root(&log->tree, tree_size, root_out);
+    pthread_mutex_unlock(&log->lock);
+    return ok ? 0 : -1;
+}
+
+ct_consistency_proof_t* generate_ct_consistency_proof(ct_log_t* log, uint64_t first_size, uint64_t second_size) {
+    if (!log || first_size == 0 || first_size > second_size) return NULL;
+    
+    ct_consistency_proof_t* proof = calloc(1, sizeof(ct_consistency_proof_t));
+    if (!proof) return NULL;
+    proof->path = malloc(CT_MAX_PROOF_LEN * 32);
+    if (!proof->path) {
+        free(proof);
+        return NULL;
+    }
+    proof->first_size = first_size;
+    proof->second_size = second_size;
+    
+    pthread_mutex_lock(&log->lock);
+    int ok = second_size <= log->tree.leaf_count;
+    if (ok && first_size < second_size) {
+        consistency_subproof(&log->tree, first_size, 0, second_size, 1, proof->path, &proof->path_len);
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    if (!ok) {
+        free_ct_consistency_proof(proof);
+        return NULL;
+    }
+    return proof;
+}
+
+// Consistency proof verification (RFC 9162 2.1.4.2)
+int verify_ct_consistency_proof(const ct_consistency_proof_t* proof, const uint8_t first_root[32], const uint8_t second_root[32]) {
+    if (!proof || !first_root || !second_root || proof->first_size == 0 || proof->first_size > proof->second_size) {
+        return -1;
+    }
+    if (proof->first_size == proof->second_size) {
+        return (proof->path_len == 0 && memcmp(first_root, second_root, 32) == 0) ? 0 : -1;
+    }
+    
+    // When the old tree is a complete subtree its root is the first node
+    const uint8_t (*path)[32] = (const uint8_t (*)[32])proof->path;
+    size_t path_len = proof->path_len;
+    uint8_t seed[32];
+    size_t next = 0;
+    if (is_power_of_two(proof->first_size)) {
+        memcpy(seed, first_root, 32);
+    } else {
+        if (path_len == 0) return -1;
+        memcpy(seed, path[0], 32);
+        next = 1;
+    }
+    
+    uint64_t fn = proof->first_size - 1;
+    uint64_t sn = proof->second_size - 1;
+    while (fn & 1) {
+        fn >>= 1;
+        sn >>= 1;
+    }
+    
+    uint8_t fr[32], sr[32];
+    memcpy(fr, seed, 32);
+    memcpy(sr, seed, 32);
+    for (size_t i = next; i < path_len; i++) {
+        if (sn == 0) return -1;
+        if ((fn & 1) || fn == sn) {
+            hash_children(path[i], fr, fr);
+            hash_children(path[i], sr, sr);
+            if (!(fn & 1)) {
+                while (!(fn & 1) && fn != 0) {
+                    fn >>= 1;
+                    sn >>= 1;
+                }
+            }
+        } else {
+            hash_children(sr, path[i], sr);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+    
+    return (sn == 0 && memcmp(fr, first_root, 32) == 0 && memcmp(sr, second_root, 32) == 0) ? 0 : -1;
+}
+
+void free_ct_consistency_proof(ct_consistency_proof_t* proof) {
+    if (!proof) return;
+    free(proof->path);
+    free(proof);
+}
+
+int ct_log_get_sth(ct_log_t* log, ct_signed_tree_head_t* sth_out) {
+    if (!log || !sth_out) return -1;
+    
+    pthread_mutex_lock(&log->lock);
+    if (log->sth.signature_len > 0 && log->sth.tree_size == log->tree.leaf_count) {
+        *sth_out = log->sth;
+        pthread_mutex_unlock(&log->lock);
+        return 0;
+    }
+    ct_signed_tree_head_t sth;
+    memset(&sth, 0, sizeof(sth));
+    sth.tree_size = log->tree.leaf_count;
+    tree_root(&log->tree, sth.tree_size, sth.root_hash);
+    pthread_mutex_unlock(&log->lock);
+    
+    // Sign without holding the lock so appends are not stalled
+    uint8_t tbs[50];
+    sth.timestamp = (uint64_t)time(NULL);
+    encode_tree_head(&sth, tbs);
+    if (log_sign(log, tbs, sizeof(tbs), sth.signature, sizeof(sth.signature), &sth.signature_len) != 0) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    if (sth.tree_size >= log->sth.tree_size) {
+        log->sth = sth;
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    *sth_out = sth;
+    return 0;
+}
+
+int verify_ct_sth(ct_log_t* log, const ct_signed_tree_head_t* sth) {
+    if (!log || !sth || sth->signature_len == 0) return -1;
+    uint8_t tbs[50];
+    encode_tree_head(sth, tbs);
+    return log_verify(log, tbs, sizeof(tbs), sth->signature, sth->signature_len);
+}
+
+// Verify a tree head signed by another log, given its DER public key
+int verify_ct_sth_with_key(const uint8_t* pubkey_der, size_t pubkey_len, const ct_signed_tree_head_t* sth) {
+    if (!pubkey_der || pubkey_len == 0 || !sth || sth->signature_len == 0) return -1;
+    
+    const unsigned char* p = pubkey_der;
+    EVP_PKEY* key = d2i_PUBKEY(NULL, &p, (long)pubkey_len);
+    if (!key) return -1;
+    uint8_t tbs[50];
+    encode_tree_head(sth, tbs);
+    int rc = key_verify(key, tbs, sizeof(tbs), sth->signature, sth->signature_len);
+    EVP_PKEY_free(key);
+    return rc;
+}
@@ -10,6 +10,7 @@
 #include "../include/packet_protocol.h"
 #include "../include/dns_types.h"
 #include "../include/nexus_client_api.h"
+#include "../include/metrics.h"
 
 // Socket path for IPC
 #define NEXUS_SOCKET_PATH "/tmp/nexus_service.sock"
@@ -54,6 +55,12 @@ int process_cli_command(const cli_command_t *cmd) {
         case CLI_CMD_CONFIGURE:
             return cmd_configure();
             
+        case CLI_CMD_METRICS:
+            return cmd_metrics();
+            
+        case CLI_CMD_TRACES:
+            return cmd_traces(cmd->flag1);
+            
         case CLI_CMD_REGISTER_DOMAIN:
             return cmd_register_domain(cmd->profile_name, cmd->param2, cmd->param3);
             
@@ -342,6 +349,18 @@ int parse_cli_args(int argc, char **argv, cli_command_t *cmd, char **socket_path
         }
     } else if (strcmp(argv[arg_index], "configure") == 0) {
         cmd->type = CLI_CMD_CONFIGURE;
+    } else if (strcmp(argv[arg_index], "metrics") == 0) {
+        cmd->type = CLI_CMD_METRICS;
+    } else if (strcmp(argv[arg_index], "traces") == 0) {
+        cmd->type = CLI_CMD_TRACES;
+        if (arg_index + 1 < argc) {
+            if (strcmp(argv[arg_index + 1], "binary") == 0) {
+                cmd->flag1 = 1;
+            } else if (strcmp(argv[arg_index + 1], "chrome") != 0) {
+                fprintf(stderr, "Trace format must be 'chrome' or 'binary'\n");
+                return -1;
+            }
+        }
     } else {
         fprintf(stderr, "Error: Unknown command '%s'\n", argv[arg_index]);
         dlog("parse_cli_args: Failed to match command '%s'", argv[arg_index]);
@@ -480,12 +499,66 @@ int cmd_help(void) {
     printf("  send-data <host> <data>   Send data to a specific host\n");
     printf("  lookup <hostname>         Look up a hostname\n");
     printf("  configure                 Start the configuration wizard\n");
+    printf("  metrics                   Print the service's metrics (Prometheus text format)\n");
+    printf("  traces [chrome|binary]    Dump sampled query traces (default: Chrome trace JSON)\n");
     printf("\n");
     printf("Global options:\n");
     printf("  --server <address>        Specify the server address (default: localhost)\n");
+    printf("\n");
+    printf("metrics and traces use the socket in $" NEXUS_METRICS_SOCKET_ENV " when the service\n");
+    printf("was started with --metrics-socket.\n");
     return 0;
 }
 
+// Send a request to the service's metrics socket and copy the reply to stdout
+static int fetch_from_metrics_socket(const char *request, const char *what) {
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        fprintf(stderr, "Failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (metrics_default_socket_path(addr.sun_path, sizeof(addr.sun_path)) != 0) {
+        fprintf(stderr, "NEXUS metrics socket path is too long\n");
+        close(sock);
+        return -1;
+    }
+    
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to connect to NEXUS metrics socket: %s\n", strerror(errno));
+        close(sock);
+        return -1;
+    }
+    
+    if (send(sock, request, strlen(request), 0) < 0) {
+        fprintf(stderr, "Failed to request %s: %s\n", what, strerror(errno));
+        close(sock);
+        return -1;
+    }
+    
+    // The service closes the connection after the last line
+    char buffer[4096];
+    ssize_t received;
+    while ((received = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        fwrite(buffer, 1, (size_t)received, stdout);
+    }
+    close(sock);
+    return received < 0 ? -1 : 0;
+}
+
+// Dump the running service's metrics
+int cmd_metrics(void) {
+    return fetch_from_metrics_socket("METRICS\n", "metrics");
+}
+
+// Dump the queries the service has traced (see --trace-sample)
+int cmd_traces(int binary) {
+    return fetch_from_metrics_socket(binary ? "TRACES BINARY\n" : "TRACES\n", "traces");
+}
+
 // Show the status of the NEXUS service
 int cmd_status(void) {
     if (connect_to_service() == 0) {
@@ -565,6 +565,7 @@ void free_network_profile(network_profile_t *profile) {
     free(profile->private_key_path);
     free(profile->ct_log_path);
     free(profile->tld_list_path);
+    free(profile->db_path);
     
     free(profile);
 }
@@ -0,0 +1,571 @@
+#include "../include/ct_gossip.h"
+#include "../include/network_context.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <openssl/x509.h>
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// --- Packet framing ---
+
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t capacity;
+} gossip_buffer_t;
+
+// Wrap payload in a NEXUS packet and append it to buf
+static int append_packet(gossip_buffer_t* buf, nexus_packet_type_t type, uint8_t* payload, size_t payload_len) {
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.version = 1;
+    packet.type = type;
+    packet.data = payload;
+    packet.data_len = (uint32_t)payload_len;
+
+    ssize_t size = get_serialized_nexus_packet_size(&packet);
+    if (size < 0) return -1;
+    size_t needed = (size_t)size;
+    if (buf->len + needed > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (capacity < buf->len + needed) capacity *= 2;
+        uint8_t* grown = realloc(buf->data, capacity);
+        if (!grown) return -1;
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    ssize_t written = serialize_nexus_packet(&packet, buf->data + buf->len, buf->capacity - buf->len);
+    if (written < 0) return -1;
+    buf->len += (size_t)written;
+    return 0;
+}
+
+// --- Tree heads ---
+
+static int build_sth_payload(ct_log_t* log, payload_ct_sth_t* out) {
+    ct_signed_tree_head_t sth;
+    uint8_t* pubkey = NULL;
+    size_t pubkey_len = 0;
+    if (ct_log_get_sth(log, &sth) != 0 || ct_log_public_key(log, &pubkey, &pubkey_len) != 0) {
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    int ok = pubkey_len <= sizeof(out->pubkey) && sth.signature_len <= sizeof(out->signature);
+    if (ok) {
+        strncpy(out->log_id, log->log_id, sizeof(out->log_id) - 1);
+        out->tree_size = sth.tree_size;
+        out->timestamp = sth.timestamp;
+        memcpy(out->root_hash, sth.root_hash, 32);
+        out->signature_len = (uint16_t)sth.signature_len;
+        memcpy(out->signature, sth.signature, sth.signature_len);
+        out->pubkey_len = (uint16_t)pubkey_len;
+        memcpy(out->pubkey, pubkey, pubkey_len);
+    }
+    free(pubkey);
+    return ok ? 0 : -1;
+}
+
+static void sth_from_payload(const payload_ct_sth_t* payload, ct_signed_tree_head_t* sth) {
+    memset(sth, 0, sizeof(*sth));
+    sth->tree_size = payload->tree_size;
+    sth->timestamp = payload->timestamp;
+    memcpy(sth->root_hash, payload->root_hash, 32);
+    sth->signature_len = payload->signature_len;
+    memcpy(sth->signature, payload->signature, payload->signature_len);
+}
+
+// --- Leaves ---
+
+static int copy_der(X509* x509, uint8_t** der_out, uint32_t* len_out) {
+    int len = i2d_X509(x509, NULL);
+    if (len <= 0) return -1;
+    uint8_t* der = malloc((size_t)len);
+    unsigned char* p = der;
+    if (!der || i2d_X509(x509, &p) != len) {
+        free(der);
+        return -1;
+    }
+    *der_out = der;
+    *len_out = (uint32_t)len;
+    return 0;
+}
+
+// Certificate carried by a leaf; on failure the caller frees entry->cert
+static int cert_from_leaf(const payload_ct_leaf_t* leaf, ct_entry_t* entry) {
+    nexus_cert_t* cert = calloc(1, sizeof(nexus_cert_t));
+    entry->cert = cert;
+    if (!cert || !leaf->common_name) return -1;
+    cert->common_name = strdup(leaf->common_name);
+    cert->not_before = (time_t)leaf->not_before;
+    cert->not_after = (time_t)leaf->not_after;
+    cert->cert_type = (cert_type_t)leaf->cert_type;
+    if (!cert->common_name) return -1;
+    if (leaf->signature_len) {
+        cert->signature = malloc(leaf->signature_len);
+        if (!cert->signature) return -1;
+        memcpy(cert->signature, leaf->signature, leaf->signature_len);
+        cert->signature_len = leaf->signature_len;
+    }
+    if (leaf->der_len) {
+        const unsigned char* p = leaf->der;
+        cert->x509 = d2i_X509(NULL, &p, (long)leaf->der_len);
+        if (!cert->x509 || p != leaf->der + leaf->der_len) return -1;
+    }
+    return 0;
+}
+
+// --- Server side ---
+
+static int handle_sth_request(ct_log_t* log, const nexus_packet_t* request, gossip_buffer_t* out) {
+    payload_ct_sth_t peer;
+    if (deserialize_payload_ct_sth(request->data, request->data_len, &peer) < 0) return -1;
+
+    payload_ct_sth_resp_t* resp = calloc(1, sizeof(payload_ct_sth_resp_t));
+    if (!resp) return -1;
+    if (build_sth_payload(log, &resp->sth) != 0) {
+        free(resp);
+        return -1;
+    }
+
+    // The requester's head must be a prefix of ours when it is not ahead
+    uint64_t our_size = resp->sth.tree_size;
+    if (peer.tree_size > 0 && peer.tree_size <= our_size) {
+        uint8_t root[32];
+        if (ct_log_root_hash(log, peer.tree_size, root) == 0 && memcmp(root, peer.root_hash, 32) != 0) {
+            log_error("CT gossip: split view, peer head at size %llu does not match ours",
+                 (unsigned long long)peer.tree_size);
+        }
+    }
+    if (peer.tree_size > 0 && peer.tree_size < our_size) {
+        ct_consistency_proof_t* proof = generate_ct_consistency_proof(log, peer.tree_size, our_size);
+        if (proof && proof->path_len <= NEXUS_CT_MAX_PROOF_LEN) {
+            resp->proof_first_size = peer.tree_size;
+            resp->proof_len = (uint16_t)proof->path_len;
+            memcpy(resp->proof, proof->path, proof->path_len * 32);
+        }
+        free_ct_consistency_proof(proof);
+    }
+
+    uint8_t* payload = malloc(sizeof(payload_ct_sth_resp_t) + 64);
+    ssize_t payload_len = payload ? serialize_payload_ct_sth_resp(resp, payload, sizeof(payload_ct_sth_resp_t) + 64) : -1;
+    int rc = payload_len < 0 ? -1 : append_packet(out, PACKET_TYPE_CT_STH_RESP, payload, (size_t)payload_len);
+    free(payload);
+    free(resp);
+    return rc;
+}
+
+static int handle_entries_request(ct_log_t* log, const nexus_packet_t* request, gossip_buffer_t* out) {
+    payload_ct_entries_req_t req;
+    if (deserialize_payload_ct_entries_req(request->data, request->data_len, &req) < 0) return -1;
+
+    uint64_t end = req.start + req.count;
+    if (req.count == 0 || req.count > NEXUS_CT_MAX_ENTRIES_PER_REQ || end > req.tree_size ||
+        req.tree_size > ct_log_size(log)) {
+        dlog("CT gossip: rejecting entry request %llu+%u at size %llu", (unsigned long long)req.start,
+             req.count, (unsigned long long)req.tree_size);
+        return -1;
+    }
+
+    payload_ct_entries_resp_t* resp = calloc(1, sizeof(payload_ct_entries_resp_t));
+    if (!resp) return -1;
+    resp->start = req.start;
+    resp->tree_size = req.tree_size;
+    resp->leaves = calloc(req.count, sizeof(payload_ct_leaf_t));
+
+    int ok = resp->leaves != NULL;
+    if (ok && end < req.tree_size) {
+        ct_consistency_proof_t* proof = generate_ct_consistency_proof(log, end, req.tree_size);
+        ok = proof && proof->path_len <= NEXUS_CT_MAX_PROOF_LEN;
+        if (ok) {
+            resp->proof_len = (uint16_t)proof->path_len;
+            memcpy(resp->proof, proof->path, proof->path_len * 32);
+        }
+        free_ct_consistency_proof(proof);
+    }
+    for (uint32_t i = 0; ok && i < req.count; i++) {
+        ct_entry_t entry;
+        if (ct_log_get_entry(log, req.start + i, &entry) != 0) {
+            ok = 0;
+            break;
+        }
+        payload_ct_leaf_t* leaf = &resp->leaves[i];
+        resp->count = i + 1;
+        leaf->timestamp = entry.timestamp;
+        memcpy(leaf->leaf_hash, entry.leaf_hash, 32);
+        leaf->not_before = (int64_t)entry.cert->not_before;
+        leaf->not_after = (int64_t)entry.cert->not_after;
+        leaf->cert_type = (uint8_t)entry.cert->cert_type;
+        // Take the name and signature buffers instead of copying them
+        leaf->common_name = entry.cert->common_name;
+        leaf->signature = entry.cert->signature;
+        leaf->signature_len = (uint32_t)entry.cert->signature_len;
+        entry.cert->common_name = NULL;
+        entry.cert->signature = NULL;
+        if (entry.cert->x509 && copy_der(entry.cert->x509, &leaf->der, &leaf->der_len) != 0) ok = 0;
+        ct_free_entry(&entry);
+    }
+
+    int rc = -1;
+    if (ok) {
+        ssize_t size = get_serialized_payload_ct_entries_resp_size(resp);
+        uint8_t* payload = size > 0 ? malloc((size_t)size) : NULL;
+        ssize_t payload_len = payload ? serialize_payload_ct_entries_resp(resp, payload, (size_t)size) : -1;
+        rc = payload_len < 0 ? -1 : append_packet(out, PACKET_TYPE_CT_ENTRIES_RESP, payload, (size_t)payload_len);
+        free(payload);
+    }
+    free_payload_ct_entries_resp(resp);
+    free(resp);
+    return rc;
+}
+
+int ct_gossip_handle_packet(ct_log_t* log, const nexus_packet_t* request, uint8_t** response_out, size_t* response_len_out) {
+    if (!log || !request || !response_out || !response_len_out) return -1;
+
+    gossip_buffer_t out = {0};
+    int rc;
+    switch (request->type) {
+        case PACKET_TYPE_CT_STH_REQ:
+            rc = handle_sth_request(log, request, &out);
+            break;
+        case PACKET_TYPE_CT_ENTRIES_REQ:
+            rc = handle_entries_request(log, request, &out);
+            break;
+        default:
+            rc = -1;
+            break;
+    }
+    if (rc != 0) {
+        free(out.data);
+        return -1;
+    }
+    *response_out = out.data;
+    *response_len_out = out.len;
+    return 0;
+}
+
+// --- Client side ---
+
+static ct_gossip_status_t split_view(ct_gossip_peer_t* peer, const char* reason) {
+    log_error("CT gossip: split view with peer '%s': %s", peer->name, reason);
+    peer->split_view = 1;
+    return CT_GOSSIP_SPLIT_VIEW;
+}
+
+// Exchange request and return the first packet of the response
+static int exchange_one(ct_gossip_peer_t* peer, gossip_buffer_t* request, nexus_packet_type_t expected, nexus_packet_t* packet) {
+    uint8_t* response = NULL;
+    ssize_t response_len = peer->exchange(peer->ctx, request->data, request->len, &response);
+    memset(packet, 0, sizeof(*packet));
+    int rc = (response_len > 0 && deserialize_nexus_packet(response, (size_t)response_len, packet) > 0 &&
+              packet->type == expected) ? 0 : -1;
+    free(response);
+    if (rc != 0) {
+        free(packet->data);
+        packet->data = NULL;
+    }
+    return rc;
+}
+
+// Apply one entries response; returns 0 when its leaves were committed.
+// Each leaf hash is recomputed from the certificate sent with it, so a peer
+// cannot serve other contents behind a hash in its tree.
+static int apply_entries(ct_log_t* log, const payload_ct_entries_resp_t* resp, const ct_signed_tree_head_t* target) {
+    ct_entry_t* entries = calloc(resp->count, sizeof(ct_entry_t));
+    if (!entries) return -1;
+
+    int ok = 1;
+    for (uint32_t i = 0; ok && i < resp->count; i++) {
+        const payload_ct_leaf_t* leaf = &resp->leaves[i];
+        ct_entry_t* entry = &entries[i];
+        entry->timestamp = leaf->timestamp;
+        memcpy(entry->leaf_hash, leaf->leaf_hash, 32);
+        strncpy((char*)entry->log_id, log->log_id, sizeof(entry->log_id) - 1);
+
+        uint8_t leaf_hash[32];
+        if (cert_from_leaf(leaf, entry) != 0) {
+            ok = 0;
+        } else if (ct_leaf_hash(entry->cert, leaf->timestamp, leaf_hash) != 0 ||
+                   memcmp(leaf_hash, leaf->leaf_hash, 32) != 0) {
+            log_error("CT gossip: entry %llu does not match its leaf hash",
+                      (unsigned long long)(resp->start + i));
+            ok = 0;
+        }
+    }
+
+    ct_consistency_proof_t proof;
+    proof.first_size = resp->start + resp->count;
+    proof.second_size = target->tree_size;
+    proof.path = (uint8_t (*)[32])resp->proof;
+    proof.path_len = resp->proof_len;
+
+    int rc = -1;
+    if (ok) {
+        rc = ct_log_append_replicated(log, entries, resp->count, &proof, target->root_hash);
+    } else {
+        for (uint32_t i = 0; i < resp->count; i++) ct_free_entry(&entries[i]);
+    }
+    free(entries);
+    return rc;
+}
+
+// Fetch [from, target->tree_size) with pipelined entry requests
+static ct_gossip_status_t fetch_missing(ct_gossip_t* gossip, ct_gossip_peer_t* peer, uint64_t from,
+                                        const ct_signed_tree_head_t* target) {
+    ct_log_t* log = gossip->log;
+    uint64_t next = from;
+
+    while (next < target->tree_size) {
+        if (ct_log_size(log) != next) {
+            return split_view(peer, "local log grew independently of the peer");
+        }
+
+        // Queue up to CT_GOSSIP_PIPELINE_DEPTH requests on one stream
+        gossip_buffer_t request = {0};
+        uint64_t cursor = next;
+        for (int i = 0; i < CT_GOSSIP_PIPELINE_DEPTH && cursor < target->tree_size; i++) {
+            payload_ct_entries_req_t req;
+            memset(&req, 0, sizeof(req));
+            strncpy(req.log_id, log->log_id, sizeof(req.log_id) - 1);
+            req.start = cursor;
+            req.count = (uint32_t)(target->tree_size - cursor < NEXUS_CT_MAX_ENTRIES_PER_REQ
+                                   ? target->tree_size - cursor : NEXUS_CT_MAX_ENTRIES_PER_REQ);
+            req.tree_size = target->tree_size;
+
+            uint8_t payload[128];
+            ssize_t payload_len = serialize_payload_ct_entries_req(&req, payload, sizeof(payload));
+            if (payload_len < 0 || append_packet(&request, PACKET_TYPE_CT_ENTRIES_REQ, payload, (size_t)payload_len) != 0) {
+                free(request.data);
+                return CT_GOSSIP_UNREACHABLE;
+            }
+            cursor += req.count;
+        }
+
+        uint8_t* response = NULL;
+        ssize_t response_len = peer->exchange(peer->ctx, request.data, request.len, &response);
+        free(request.data);
+        if (response_len <= 0) {
+            free(response);
+            return CT_GOSSIP_UNREACHABLE;
+        }
+
+        // Responses arrive in request order
+        uint64_t progress_from = next;
+        size_t offset = 0;
+        ct_gossip_status_t status = CT_GOSSIP_CAUGHT_UP;
+        while (offset < (size_t)response_len && status == CT_GOSSIP_CAUGHT_UP) {
+            nexus_packet_t packet;
+            memset(&packet, 0, sizeof(packet));
+            ssize_t consumed = deserialize_nexus_packet(response + offset, (size_t)response_len - offset, &packet);
+            if (consumed <= 0) break;
+            offset += (size_t)consumed;
+
+            payload_ct_entries_resp_t resp;
+            if (packet.type != PACKET_TYPE_CT_ENTRIES_RESP ||
+                deserialize_payload_ct_entries_resp(packet.data, packet.data_len, &resp) < 0) {
+                free(packet.data);
+                break;
+            }
+            free(packet.data);
+
+            if (resp.start != next || resp.count == 0 || resp.tree_size != target->tree_size ||
+                resp.start + resp.count > target->tree_size) {
+                status = split_view(peer, "entry range does not match the request");
+            } else if (apply_entries(log, &resp, target) != 0) {
+                status = split_view(peer, "entries do not match the peer's signed head");
+            } else {
+                next += resp.count;
+            }
+            free_payload_ct_entries_resp(&resp);
+        }
+        free(response);
+
+        if (status != CT_GOSSIP_CAUGHT_UP) return status;
+        if (next == progress_from) return CT_GOSSIP_UNREACHABLE;
+    }
+
+    dlog("CT gossip: fetched %llu entries from '%s', now at size %llu", (unsigned long long)(next - from),
+         peer->name, (unsigned long long)next);
+    return CT_GOSSIP_CAUGHT_UP;
+}
+
+static ct_gossip_status_t sync_peer_locked(ct_gossip_t* gossip, ct_gossip_peer_t* peer) {
+    ct_log_t* log = gossip->log;
+
+    payload_ct_sth_t* ours = calloc(1, sizeof(payload_ct_sth_t));
+    payload_ct_sth_resp_t* resp = calloc(1, sizeof(payload_ct_sth_resp_t));
+    uint8_t* payload = malloc(sizeof(payload_ct_sth_t) + 64);
+    gossip_buffer_t request = {0};
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    ct_gossip_status_t status = CT_GOSSIP_UNREACHABLE;
+
+    ssize_t payload_len = -1;
+    if (ours && resp && payload && build_sth_payload(log, ours) == 0) {
+        payload_len = serialize_payload_ct_sth(ours, payload, sizeof(payload_ct_sth_t) + 64);
+    }
+    if (payload_len < 0 ||
+        append_packet(&request, PACKET_TYPE_CT_STH_REQ, payload, (size_t)payload_len) != 0 ||
+        exchange_one(peer, &request, PACKET_TYPE_CT_STH_RESP, &packet) != 0 ||
+        deserialize_payload_ct_sth_resp(packet.data, packet.data_len, resp) < 0) {
+        goto done;
+    }
+
+    // Pin the peer's key on first verified contact
+    const payload_ct_sth_t* theirs = &resp->sth;
+    if (peer->pubkey_len != 0 &&
+        (peer->pubkey_len != theirs->pubkey_len || memcmp(peer->pubkey, theirs->pubkey, peer->pubkey_len) != 0)) {
+        status = split_view(peer, "signing key changed");
+        goto done;
+    }
+
+    ct_signed_tree_head_t sth;
+    sth_from_payload(theirs, &sth);
+    if (verify_ct_sth_with_key(theirs->pubkey, theirs->pubkey_len, &sth) != 0) {
+        log_error("CT gossip: bad tree head signature from peer '%s'", peer->name);
+        status = CT_GOSSIP_BAD_SIGNATURE;
+        goto done;
+    }
+    if (peer->pubkey_len == 0) {
+        memcpy(peer->pubkey, theirs->pubkey, theirs->pubkey_len);
+        peer->pubkey_len = theirs->pubkey_len;
+    }
+
+    // The peer's own history must only grow
+    if (sth.tree_size < peer->last_sth.tree_size ||
+        (sth.tree_size == peer->last_sth.tree_size && peer->last_sth.tree_size > 0 &&
+         memcmp(sth.root_hash, peer->last_sth.root_hash, 32) != 0)) {
+        status = split_view(peer, "tree head went backwards or forked");
+        goto done;
+    }
+
+    uint64_t our_size = ours->tree_size;
+    if (sth.tree_size <= our_size) {
+        // Peer is a prefix of us (or equal): its root must match ours at its size
+        uint8_t root[32];
+        if (sth.tree_size > 0 &&
+            (ct_log_root_hash(log, sth.tree_size, root) != 0 || memcmp(root, sth.root_hash, 32) != 0)) {
+            status = split_view(peer, "different root at the same tree size");
+            goto done;
+        }
+        status = sth.tree_size == our_size ? CT_GOSSIP_IN_SYNC : CT_GOSSIP_PEER_BEHIND;
+    } else {
+        // Peer is ahead: our head must be consistent with theirs
+        if (our_size > 0) {
+            ct_consistency_proof_t proof;
+            proof.first_size = resp->proof_first_size;
+            proof.second_size = sth.tree_size;
+            proof.path = resp->proof;
+            proof.path_len = resp->proof_len;
+            if (resp->proof_first_size != our_size ||
+                verify_ct_consistency_proof(&proof, ours->root_hash, sth.root_hash) != 0) {
+                status = split_view(peer, "consistency proof does not verify");
+                goto done;
+            }
+        }
+        status = fetch_missing(gossip, peer, our_size, &sth);
+    }
+    // A head we could not catch up to is not remembered as the peer's
+    if (status != CT_GOSSIP_UNREACHABLE && status != CT_GOSSIP_SPLIT_VIEW) {
+        peer->last_sth = sth;
+    }
+
+done:
+    peer->last_status = status;
+    free(packet.data);
+    free(request.data);
+    free(payload);
+    free(resp);
+    free(ours);
+    return status;
+}
+
+// --- Lifecycle ---
+
+int init_ct_gossip(ct_log_t* log, int interval_ms, ct_gossip_t** gossip_out) {
+    if (!log || !gossip_out) return -1;
+
+    ct_gossip_t* gossip = calloc(1, sizeof(ct_gossip_t));
+    if (!gossip) return -1;
+    gossip->log = log;
+    gossip->interval_ms = interval_ms > 0 ? interval_ms : CT_GOSSIP_DEFAULT_INTERVAL_MS;
+    if (pthread_mutex_init(&gossip->lock, NULL) != 0) {
+        free(gossip);
+        return -1;
+    }
+    *gossip_out = gossip;
+    return 0;
+}
+
+void cleanup_ct_gossip(ct_gossip_t* gossip) {
+    if (!gossip) return;
+    pthread_mutex_destroy(&gossip->lock);
+    free(gossip);
+}
+
+int ct_gossip_add_peer(ct_gossip_t* gossip, const char* name, ct_gossip_exchange_fn exchange, void* ctx) {
+    if (!gossip || !name || !exchange) return -1;
+
+    pthread_mutex_lock(&gossip->lock);
+    int rc = -1;
+    if (gossip->peer_count < CT_GOSSIP_MAX_PEERS) {
+        ct_gossip_peer_t* peer = &gossip->peers[gossip->peer_count++];
+        memset(peer, 0, sizeof(*peer));
+        strncpy(peer->name, name, sizeof(peer->name) - 1);
+        peer->exchange = exchange;
+        peer->ctx = ctx;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&gossip->lock);
+    return rc;
+}
+
+ct_gossip_status_t ct_gossip_sync_peer(ct_gossip_t* gossip, size_t peer_index) {
+    if (!gossip) return CT_GOSSIP_UNREACHABLE;
+
+    pthread_mutex_lock(&gossip->lock);
+    ct_gossip_status_t status = CT_GOSSIP_UNREACHABLE;
+    if (peer_index < gossip->peer_count) {
+        status = sync_peer_locked(gossip, &gossip->peers[peer_index]);
+    }
+    pthread_mutex_unlock(&gossip->lock);
+    return status;
+}
+
+int ct_gossip_round(ct_gossip_t* gossip) {
+    if (!gossip) return -1;
+
+    int split = 0;
+    pthread_mutex_lock(&gossip->lock);
+    for (size_t i = 0; i < gossip->peer_count; i++) {
+        if (sync_peer_locked(gossip, &gossip->peers[i]) == CT_GOSSIP_SPLIT_VIEW) split = 1;
+    }
+    gossip->last_round_ms = now_ms();
+    pthread_mutex_unlock(&gossip->lock);
+    return split ? -1 : 0;
+}
+
+int ct_gossip_tick(ct_gossip_t* gossip) {
+    if (!gossip) return -1;
+    pthread_mutex_lock(&gossip->lock);
+    int due = gossip->last_round_ms == 0 || now_ms() - gossip->last_round_ms >= (uint64_t)gossip->interval_ms;
+    pthread_mutex_unlock(&gossip->lock);
+    return due ? ct_gossip_round(gossip) : 0;
+}
+
+int sync_ct_log_with_peers(ct_log_t *ct_log, network_context_t *net_ctx) {
+    if (!ct_log || !net_ctx) return -1;
+    if (!net_ctx->ct_gossip) {
+        dlog("CT gossip: no peers configured");
+        return 0;
+    }
+    if (net_ctx->ct_gossip->log != ct_log) return -1;
+    return ct_gossip_round(net_ctx->ct_gossip);
+}
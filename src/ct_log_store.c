@@ -0,0 +1,492 @@
+#include "../include/ct_log_store.h"
+#include "../include/checksum.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/x509.h>
+
+#define INDEX_MAGIC "NXCTIDX1"
+#define INDEX_VERSION 2            // 2: entries carry the certificate DER
+#define INDEX_INITIAL_CAPACITY 4096
+#define RECORD_HEADER_SIZE 8        // u32 length, u32 crc32 of the payload
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;                 // Commit point, see ct_log_store.h
+    uint8_t reserved[40];
+} ct_index_header_t;
+
+typedef struct {
+    uint32_t segment;
+    uint32_t length;
+    uint64_t offset;
+    uint8_t leaf_hash[32];
+} ct_index_record_t;
+
+struct ct_log_store_s {
+    char* dir;
+    int index_fd;
+    uint8_t* index_map;
+    size_t index_map_size;
+    uint64_t capacity;              // Records the current mapping can hold
+    ct_index_header_t* header;
+    ct_index_record_t* records;
+
+    int* segment_fds;               // Lazily opened; the last one is active
+    uint32_t segment_count;
+    uint64_t active_size;
+};
+
+// --- Serialization (little-endian) ---
+
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t capacity;
+} store_buffer_t;
+
+static int put_bytes(store_buffer_t* buf, const void* data, size_t len) {
+    if (buf->len + len > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 512;
+        while (capacity < buf->len + len) capacity *= 2;
+        uint8_t* grown = realloc(buf->data, capacity);
+        if (!grown) return -1;
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    if (len) memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+static int put_le(store_buffer_t* buf, uint64_t value, int bytes) {
+    uint8_t tmp[8];
+    for (int i = 0; i < bytes; ++i) tmp[i] = (uint8_t)(value >> (8 * i));
+    return put_bytes(buf, tmp, (size_t)bytes);
+}
+
+static uint64_t get_le(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+static int serialize_entry(const ct_entry_t* entry, store_buffer_t* buf) {
+    const nexus_cert_t* cert = entry->cert;
+    if (!cert || !cert->common_name) return -1;
+
+    size_t name_len = strlen(cert->common_name);
+    if (name_len > 0xFFFF || entry->signature_len > sizeof(entry->signature)) return -1;
+
+    // The leaf hash covers the DER when there is one, so it is kept verbatim
+    unsigned char* der = NULL;
+    int der_len = cert->x509 ? i2d_X509(cert->x509, &der) : 0;
+    if (der_len < 0) return -1;
+
+    int rc = put_le(buf, 0, RECORD_HEADER_SIZE) |
+             put_le(buf, entry->timestamp, 8) |
+             put_le(buf, (uint32_t)entry->log_entry_type, 4) |
+             put_bytes(buf, entry->log_id, sizeof(entry->log_id)) |
+             put_bytes(buf, entry->leaf_hash, sizeof(entry->leaf_hash)) |
+             put_le(buf, entry->signature_len, 2) |
+             put_bytes(buf, entry->signature, entry->signature_len) |
+             put_le(buf, name_len, 2) |
+             put_bytes(buf, cert->common_name, name_len) |
+             put_le(buf, (uint64_t)cert->not_before, 8) |
+             put_le(buf, (uint64_t)cert->not_after, 8) |
+             put_le(buf, (uint32_t)cert->cert_type, 4) |
+             put_le(buf, cert->signature_len, 4) |
+             put_bytes(buf, cert->signature, cert->signature ? cert->signature_len : 0) |
+             put_le(buf, (uint32_t)der_len, 4) |
+             put_bytes(buf, der, (size_t)der_len);
+    OPENSSL_free(der);
+    if (rc != 0 || buf->len > UINT32_MAX) return -1;
+
+    uint32_t payload_len = (uint32_t)(buf->len - RECORD_HEADER_SIZE);
+    uint32_t crc = crc32_update(0, buf->data + RECORD_HEADER_SIZE, payload_len);
+    for (int i = 0; i < 4; ++i) {
+        buf->data[i] = (uint8_t)(payload_len >> (8 * i));
+        buf->data[4 + i] = (uint8_t)(crc >> (8 * i));
+    }
+    return 0;
+}
+
+typedef struct {
+    const uint8_t* p;
+    size_t remaining;
+} store_reader_t;
+
+static int take(store_reader_t* r, void* out, size_t len) {
+    if (r->remaining < len) return -1;
+    if (out) memcpy(out, r->p, len);
+    r->p += len;
+    r->remaining -= len;
+    return 0;
+}
+
+static int take_le(store_reader_t* r, uint64_t* out, int bytes) {
+    if (r->remaining < (size_t)bytes) return -1;
+    *out = get_le(r->p, bytes);
+    r->p += bytes;
+    r->remaining -= (size_t)bytes;
+    return 0;
+}
+
+static int deserialize_entry(const uint8_t* payload, size_t len, ct_entry_t* out) {
+    store_reader_t r = { payload, len };
+    uint64_t v = 0, sig_len = 0, name_len = 0, cert_sig_len = 0, der_len = 0;
+
+    memset(out, 0, sizeof(*out));
+    if (take_le(&r, &out->timestamp, 8) != 0 || take_le(&r, &v, 4) != 0) return -1;
+    out->log_entry_type = (int)v;
+    if (take(&r, out->log_id, sizeof(out->log_id)) != 0 ||
+        take(&r, out->leaf_hash, sizeof(out->leaf_hash)) != 0 ||
+        take_le(&r, &sig_len, 2) != 0 || sig_len > sizeof(out->signature) ||
+        take(&r, out->signature, (size_t)sig_len) != 0 ||
+        take_le(&r, &name_len, 2) != 0 || r.remaining < name_len) {
+        return -1;
+    }
+    out->signature_len = (size_t)sig_len;
+
+    nexus_cert_t* cert = calloc(1, sizeof(nexus_cert_t));
+    if (!cert) return -1;
+    cert->common_name = strndup((const char*)r.p, (size_t)name_len);
+    take(&r, NULL, (size_t)name_len);
+
+    uint64_t not_before = 0, not_after = 0, cert_type = 0;
+    int ok = cert->common_name &&
+             take_le(&r, &not_before, 8) == 0 &&
+             take_le(&r, &not_after, 8) == 0 &&
+             take_le(&r, &cert_type, 4) == 0 &&
+             take_le(&r, &cert_sig_len, 4) == 0 &&
+             r.remaining >= cert_sig_len;
+    if (ok && cert_sig_len) {
+        cert->signature = malloc((size_t)cert_sig_len);
+        ok = cert->signature != NULL && take(&r, cert->signature, (size_t)cert_sig_len) == 0;
+        cert->signature_len = (size_t)cert_sig_len;
+    }
+    ok = ok && take_le(&r, &der_len, 4) == 0 && r.remaining >= der_len;
+    if (ok && der_len) {
+        const unsigned char* der = r.p;
+        cert->x509 = d2i_X509(NULL, &der, (long)der_len);
+        ok = cert->x509 != NULL && der == r.p + der_len;
+    }
+    if (!ok) {
+        X509_free(cert->x509);
+        free(cert->common_name);
+        free(cert->signature);
+        free(cert);
+        return -1;
+    }
+    cert->not_before = (time_t)not_before;
+    cert->not_after = (time_t)not_after;
+    cert->cert_type = (cert_type_t)cert_type;
+    out->cert = cert;
+    return 0;
+}
+
+// --- Files ---
+
+static int pread_full(int fd, void* buf, size_t len, uint64_t offset) {
+    uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int pwrite_full(int fd, const void* buf, size_t len, uint64_t offset) {
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+static void segment_path(const ct_log_store_t* store, uint32_t segment, char* buf, size_t len) {
+    snprintf(buf, len, "%s/segment-%08u.dat", store->dir, segment);
+}
+
+static int segment_fd(ct_log_store_t* store, uint32_t segment) {
+    if (segment >= store->segment_count) return -1;
+    if (store->segment_fds[segment] < 0) {
+        char path[1024];
+        segment_path(store, segment, path, sizeof(path));
+        store->segment_fds[segment] = open(path, O_RDWR | O_CREAT, 0644);
+    }
+    return store->segment_fds[segment];
+}
+
+static int add_segment(ct_log_store_t* store) {
+    int* fds = realloc(store->segment_fds, (store->segment_count + 1) * sizeof(int));
+    if (!fds) return -1;
+    store->segment_fds = fds;
+    store->segment_fds[store->segment_count++] = -1;
+    return segment_fd(store, store->segment_count - 1) < 0 ? -1 : 0;
+}
+
+static int map_index(ct_log_store_t* store, uint64_t capacity) {
+    size_t size = sizeof(ct_index_header_t) + capacity * sizeof(ct_index_record_t);
+    if (ftruncate(store->index_fd, (off_t)size) != 0) return -1;
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, store->index_fd, 0);
+    if (map == MAP_FAILED) return -1;
+
+    if (store->index_map) munmap(store->index_map, store->index_map_size);
+    store->index_map = map;
+    store->index_map_size = size;
+    store->capacity = capacity;
+    store->header = (ct_index_header_t*)map;
+    store->records = (ct_index_record_t*)((uint8_t*)map + sizeof(ct_index_header_t));
+    return 0;
+}
+
+static int read_payload(ct_log_store_t* store, const ct_index_record_t* rec, uint8_t** payload_out) {
+    int fd = segment_fd(store, rec->segment);
+    if (fd < 0 || rec->length < RECORD_HEADER_SIZE) return -1;
+
+    uint8_t* buf = malloc(rec->length);
+    if (!buf) return -1;
+    if (pread_full(fd, buf, rec->length, rec->offset) != 0 ||
+        get_le(buf, 4) != rec->length - RECORD_HEADER_SIZE ||
+        crc32_update(0, buf + RECORD_HEADER_SIZE, rec->length - RECORD_HEADER_SIZE) != (uint32_t)get_le(buf + 4, 4)) {
+        free(buf);
+        return -1;
+    }
+    *payload_out = buf;
+    return 0;
+}
+
+// Drop records from count on: the active segment is cut back to the end of
+// the last kept record and later segments are removed.
+static int trim_to(ct_log_store_t* store, uint64_t count) {
+    store->header->count = count;
+    store->active_size = 0;
+    uint32_t last_segment = 0;
+    if (count) {
+        const ct_index_record_t* last = &store->records[count - 1];
+        store->active_size = last->offset + last->length;
+        last_segment = last->segment;
+    }
+    while (store->segment_count - 1 > last_segment) {
+        char path[1024];
+        uint32_t segment = --store->segment_count;
+        if (store->segment_fds[segment] >= 0) close(store->segment_fds[segment]);
+        segment_path(store, segment, path, sizeof(path));
+        unlink(path);
+    }
+    return ftruncate(segment_fd(store, last_segment), (off_t)store->active_size) == 0 ? 0 : -1;
+}
+
+// --- Lifecycle ---
+
+int open_ct_log_store(const char* dir, ct_log_store_t** store_out) {
+    if (!dir || !store_out) return -1;
+    *store_out = NULL;
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        dlog("CT store: cannot create %s: %s", dir, strerror(errno));
+        return -1;
+    }
+
+    ct_log_store_t* store = calloc(1, sizeof(ct_log_store_t));
+    if (!store) return -1;
+    store->dir = strdup(dir);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/index.dat", dir);
+    store->index_fd = store->dir ? open(path, O_RDWR | O_CREAT, 0644) : -1;
+    if (store->index_fd < 0) {
+        dlog("CT store: cannot open %s", path);
+        free(store->dir);
+        free(store);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(store->index_fd, &st) != 0) goto fail;
+
+    if ((size_t)st.st_size < sizeof(ct_index_header_t)) {
+        if (map_index(store, INDEX_INITIAL_CAPACITY) != 0) goto fail;
+        memset(store->header, 0, sizeof(ct_index_header_t));
+        memcpy(store->header->magic, INDEX_MAGIC, sizeof(store->header->magic));
+        store->header->version = INDEX_VERSION;
+        store->header->record_size = sizeof(ct_index_record_t);
+    } else {
+        uint64_t capacity = ((uint64_t)st.st_size - sizeof(ct_index_header_t)) / sizeof(ct_index_record_t);
+        if (map_index(store, capacity ? capacity : INDEX_INITIAL_CAPACITY) != 0) goto fail;
+        if (memcmp(store->header->magic, INDEX_MAGIC, sizeof(store->header->magic)) != 0 ||
+            store->header->version != INDEX_VERSION ||
+            store->header->record_size != sizeof(ct_index_record_t) ||
+            store->header->count > store->capacity) {
+            dlog("CT store: %s has an invalid index", path);
+            goto fail;
+        }
+    }
+
+    // Segments up to the last committed record
+    uint64_t count = store->header->count;
+    uint32_t last_segment = count ? store->records[count - 1].segment : 0;
+    for (uint32_t i = 0; i <= last_segment; ++i) {
+        if (add_segment(store) != 0) goto fail;
+    }
+
+    // The index may have reached disk ahead of segment data, so a torn
+    // tail of committed records is dropped. A bad record followed by good
+    // ones is corruption, not a torn write, and the store is refused.
+    uint64_t valid = count;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint8_t* payload = NULL;
+        if (read_payload(store, &store->records[i], &payload) == 0) {
+            free(payload);
+            if (valid < i) {
+                log_error("CT store: %s entry %llu is corrupt", dir, (unsigned long long)valid);
+                goto fail;
+            }
+        } else if (valid == count) {
+            valid = i;
+        }
+    }
+    if (valid < count) {
+        dlog("CT store: dropping %llu unreadable entries from %llu",
+             (unsigned long long)(count - valid), (unsigned long long)valid);
+    }
+    if (trim_to(store, valid) != 0) goto fail;
+    count = valid;
+
+    dlog("CT store opened: %s (%llu entries, %u segments)", dir,
+         (unsigned long long)count, store->segment_count);
+    *store_out = store;
+    return 0;
+
+fail:
+    close_ct_log_store(store);
+    return -1;
+}
+
+void close_ct_log_store(ct_log_store_t* store) {
+    if (!store) return;
+    if (store->index_map) {
+        msync(store->index_map, store->index_map_size, MS_SYNC);
+        munmap(store->index_map, store->index_map_size);
+    }
+    if (store->index_fd >= 0) close(store->index_fd);
+    for (uint32_t i = 0; i < store->segment_count; ++i) {
+        if (store->segment_fds[i] >= 0) close(store->segment_fds[i]);
+    }
+    free(store->segment_fds);
+    free(store->dir);
+    free(store);
+}
+
+uint64_t ct_log_store_count(const ct_log_store_t* store) {
+    return store ? store->header->count : 0;
+}
+
+const char* ct_log_store_dir(const ct_log_store_t* store) {
+    return store ? store->dir : NULL;
+}
+
+// --- Appending ---
+
+int ct_log_store_append(ct_log_store_t* store, const ct_entry_t* entry) {
+    if (!store || !entry) return -1;
+
+    store_buffer_t buf = {0};
+    if (serialize_entry(entry, &buf) != 0) {
+        free(buf.data);
+        return -1;
+    }
+
+    // Roll to a new segment; the old one is synced so only the active
+    // segment can ever hold a torn tail.
+    if (store->active_size > 0 && store->active_size + buf.len > CT_SEGMENT_MAX_BYTES) {
+        int old_fd = segment_fd(store, store->segment_count - 1);
+        if (fdatasync(old_fd) != 0 || add_segment(store) != 0) {
+            free(buf.data);
+            return -1;
+        }
+        store->active_size = 0;
+    }
+
+    uint64_t count = store->header->count;
+    if (count == store->capacity && map_index(store, store->capacity * 2) != 0) {
+        free(buf.data);
+        return -1;
+    }
+
+    uint32_t segment = store->segment_count - 1;
+    if (pwrite_full(segment_fd(store, segment), buf.data, buf.len, store->active_size) != 0) {
+        dlog("CT store: segment write failed: %s", strerror(errno));
+        free(buf.data);
+        return -1;
+    }
+
+    ct_index_record_t* rec = &store->records[count];
+    rec->segment = segment;
+    rec->length = (uint32_t)buf.len;
+    rec->offset = store->active_size;
+    memcpy(rec->leaf_hash, entry->leaf_hash, sizeof(rec->leaf_hash));
+    store->active_size += buf.len;
+    store->header->count = count + 1;
+
+    free(buf.data);
+    return 0;
+}
+
+int ct_log_store_sync(ct_log_store_t* store) {
+    if (!store) return -1;
+    // Data before index, so a durable count never points at missing bytes
+    if (fdatasync(segment_fd(store, store->segment_count - 1)) != 0) return -1;
+    return msync(store->index_map, store->index_map_size, MS_SYNC) == 0 ? 0 : -1;
+}
+
+int ct_log_store_truncate(ct_log_store_t* store, uint64_t count) {
+    if (!store || count > store->header->count) return -1;
+    if (trim_to(store, count) != 0) {
+        dlog("CT store: truncate to %llu failed: %s", (unsigned long long)count, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// --- Reading ---
+
+int ct_log_store_read(ct_log_store_t* store, uint64_t index, ct_entry_t* out) {
+    if (!store || !out || index >= store->header->count) return -1;
+
+    uint8_t* payload = NULL;
+    const ct_index_record_t* rec = &store->records[index];
+    if (read_payload(store, rec, &payload) != 0) {
+        dlog("CT store: entry %llu is unreadable", (unsigned long long)index);
+        return -1;
+    }
+    int rc = deserialize_entry(payload + RECORD_HEADER_SIZE, rec->length - RECORD_HEADER_SIZE, out);
+    free(payload);
+    if (rc == 0) out->index = index;
+    return rc;
+}
+
+int ct_log_store_leaf_hash(const ct_log_store_t* store, uint64_t index, uint8_t hash_out[32]) {
+    if (!store || !hash_out || index >= store->header->count) return -1;
+    memcpy(hash_out, store->records[index].leaf_hash, 32);
+    return 0;
+}
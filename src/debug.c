@@ -1,13 +1,366 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
 #include "../include/debug.h"
 
-// Simple debug logging function
-void dlog(const char *format, ...) {
+#define LOG_RATE_SLOTS 64
+#define LOG_DRAIN_BUFFER (64 * 1024)
+
+typedef struct {
+    int level;
+    int len;
+    struct timespec when;
+    char text[LOG_MESSAGE_MAX];
+} log_record_t;
+
+typedef struct {
+    const char *site;           // The format string identifies the call site
+    time_t window;
+    uint32_t count;
+    uint32_t suppressed;
+} log_rate_t;
+
+// Single producer (the owning thread), single consumer (whoever holds
+// drain_lock). Rings outlive their threads and are reused by new ones.
+typedef struct log_ring_s {
+    log_record_t records[LOG_RING_SLOTS];
+    atomic_size_t head;         // Next slot the owner writes
+    atomic_size_t tail;         // Next slot the drainer reads
+    atomic_uint_fast64_t dropped;
+    uint64_t dropped_reported;  // Drainer only
+    atomic_int in_use;
+    log_rate_t rate[LOG_RATE_SLOTS];
+    struct log_ring_s *next;
+} log_ring_t;
+
+atomic_int dlog_level = LOG_LEVEL_INFO;
+
+static _Atomic(log_ring_t *) rings = NULL;
+static __thread log_ring_t *thread_ring = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static atomic_int writer_running = 0;
+static pthread_t writer_thread;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_wake = PTHREAD_COND_INITIALIZER;
+static int writer_stop = 0;
+
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static char drain_buffer[LOG_DRAIN_BUFFER];
+static FILE *log_file = NULL;           // NULL means stdout
+
+static atomic_uint_fast64_t total_written = 0;
+static atomic_uint_fast64_t total_suppressed = 0;
+
+static const char *level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+static const char *level_name(int level) {
+    if (level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_ERROR) return "LOG";
+    return level_names[level];
+}
+
+static void release_ring(void *arg) {
+    log_ring_t *ring = (log_ring_t *)arg;
+    atomic_store_explicit(&ring->in_use, 0, memory_order_release);
+}
+
+static void create_ring_key(void) {
+    pthread_key_create(&ring_key, release_ring);
+}
+
+static log_ring_t *get_thread_ring(void) {
+    if (thread_ring) return thread_ring;
+    pthread_once(&ring_key_once, create_ring_key);
+
+    // Take over a ring left behind by an exited thread before allocating
+    log_ring_t *ring = NULL;
+    for (log_ring_t *r = atomic_load(&rings); r; r = r->next) {
+        int unused = 0;
+        if (atomic_compare_exchange_strong(&r->in_use, &unused, 1)) {
+            ring = r;
+            memset(ring->rate, 0, sizeof(ring->rate));
+            break;
+        }
+    }
+    if (!ring) {
+        ring = calloc(1, sizeof(log_ring_t));
+        if (!ring) return NULL;
+        atomic_init(&ring->in_use, 1);
+        ring->next = atomic_load(&rings);
+        while (!atomic_compare_exchange_weak(&rings, &ring->next, ring)) {
+        }
+    }
+
+    pthread_setspecific(ring_key, ring);
+    thread_ring = ring;
+    return ring;
+}
+
+// Returns 0 when the message is over its call site's budget. A summary of
+// what the previous window suppressed is reported through *summary_site.
+static int rate_allow(log_ring_t *ring, const char *site, time_t now,
+                      const char **summary_site, uint32_t *summary_count) {
+    log_rate_t *slot = &ring->rate[((uintptr_t)site >> 4) % LOG_RATE_SLOTS];
+    if (slot->site != site || now - slot->window >= LOG_RATE_WINDOW) {
+        if (slot->suppressed) {
+            *summary_site = slot->site;
+            *summary_count = slot->suppressed;
+        }
+        slot->site = site;
+        slot->window = now;
+        slot->count = 0;
+        slot->suppressed = 0;
+    }
+    if (slot->count < LOG_RATE_BURST) {
+        slot->count++;
+        return 1;
+    }
+    slot->suppressed++;
+    atomic_fetch_add_explicit(&total_suppressed, 1, memory_order_relaxed);
+    return 0;
+}
+
+static void push_record(log_ring_t *ring, int level, const struct timespec *when,
+                        const char *format, va_list args) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail >= LOG_RING_SLOTS) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    log_record_t *record = &ring->records[head % LOG_RING_SLOTS];
+    int len = vsnprintf(record->text, sizeof(record->text), format, args);
+    if (len < 0) len = 0;
+    if (len >= (int)sizeof(record->text)) len = sizeof(record->text) - 1;
+    record->len = len;
+    record->level = level;
+    record->when = *when;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static void write_now(int level, const char *format, va_list args) {
+    char text[LOG_MESSAGE_MAX];
+    vsnprintf(text, sizeof(text), format, args);
+    printf("[%s] %s\n", level_name(level), text);
+    atomic_fetch_add_explicit(&total_written, 1, memory_order_relaxed);
+}
+
+static void emit_record(log_ring_t *ring, int level, const struct timespec *when, const char *format, ...) {
     va_list args;
     va_start(args, format);
-    printf("[DEBUG] ");
-    vprintf(format, args);
-    printf("\n");
+    if (ring && atomic_load_explicit(&writer_running, memory_order_acquire)) {
+        push_record(ring, level, when, format, args);
+    } else {
+        write_now(level, format, args);
+    }
     va_end(args);
-}
\ No newline at end of file
+}
+
+static void emit(int level, const char *site, const char *format, va_list args) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    log_ring_t *ring = get_thread_ring();
+    if (ring) {
+        const char *summary_site = NULL;
+        uint32_t summary_count = 0;
+        int allowed = rate_allow(ring, site, now.tv_sec, &summary_site, &summary_count);
+        if (summary_site) {
+            emit_record(ring, LOG_LEVEL_WARN, &now, "Suppressed %u repeats of \"%.80s\"", summary_count, summary_site);
+        }
+        if (!allowed) return;
+    }
+
+    if (ring && atomic_load_explicit(&writer_running, memory_order_acquire)) {
+        push_record(ring, level, &now, format, args);
+    } else {
+        write_now(level, format, args);
+    }
+}
+
+void dlog_write(int level, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    emit(level, format, format, args);
+    va_end(args);
+}
+
+static void emit_hex(int level, const char *label, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    emit(level, label, format, args);
+    va_end(args);
+}
+
+void dlog_write_hex(int level, const char *label, const void *data, size_t len) {
+    static const char digits[] = "0123456789ABCDEF";
+    const uint8_t *bytes = (const uint8_t *)data;
+    char hex[32 * 3 + 1];
+    size_t shown = len < 32 ? len : 32;
+    size_t pos = 0;
+    for (size_t i = 0; i < shown; i++) {
+        hex[pos++] = digits[bytes[i] >> 4];
+        hex[pos++] = digits[bytes[i] & 0x0f];
+        hex[pos++] = ' ';
+    }
+    if (pos) pos--;
+    hex[pos] = '\0';
+    emit_hex(level, label, "%s (%zu bytes): %s%s", label, len, hex, shown < len ? " ..." : "");
+}
+
+// Caller holds drain_lock
+static void drain_rings(void) {
+    FILE *out = log_file ? log_file : stdout;
+    size_t used = 0;
+
+    for (log_ring_t *ring = atomic_load(&rings); ring; ring = ring->next) {
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for (; tail != head; tail++) {
+            log_record_t *record = &ring->records[tail % LOG_RING_SLOTS];
+            if (used + LOG_MESSAGE_MAX + 64 > sizeof(drain_buffer)) {
+                fwrite(drain_buffer, 1, used, out);
+                used = 0;
+            }
+            if (log_file) {
+                struct tm tm;
+                gmtime_r(&record->when.tv_sec, &tm);
+                used += strftime(drain_buffer + used, 32, "%Y-%m-%dT%H:%M:%S", &tm);
+                used += (size_t)snprintf(drain_buffer + used, 16, ".%03ldZ ", record->when.tv_nsec / 1000000L);
+            }
+            used += (size_t)snprintf(drain_buffer + used, sizeof(drain_buffer) - used, "[%s] %.*s\n",
+                                     level_name(record->level), record->len, record->text);
+            atomic_fetch_add_explicit(&total_written, 1, memory_order_relaxed);
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+        uint64_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        if (dropped != ring->dropped_reported) {
+            if (used + 64 > sizeof(drain_buffer)) {
+                fwrite(drain_buffer, 1, used, out);
+                used = 0;
+            }
+            used += (size_t)snprintf(drain_buffer + used, 64, "[WARN] Dropped %llu log messages\n",
+                                     (unsigned long long)(dropped - ring->dropped_reported));
+            ring->dropped_reported = dropped;
+        }
+    }
+
+    if (used) {
+        fwrite(drain_buffer, 1, used, out);
+        fflush(out);
+    }
+}
+
+static void *log_writer(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&writer_lock);
+        if (!writer_stop) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += LOG_FLUSH_INTERVAL_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&writer_wake, &writer_lock, &deadline);
+        }
+        int stop = writer_stop;
+        pthread_mutex_unlock(&writer_lock);
+
+        pthread_mutex_lock(&drain_lock);
+        drain_rings();
+        pthread_mutex_unlock(&drain_lock);
+        if (stop) break;
+    }
+    return NULL;
+}
+
+int init_logging(int level, const char *path) {
+    set_log_level(level);
+    if (atomic_load(&writer_running)) return 0;
+
+    if (path) {
+        FILE *f = fopen(path, "a");
+        if (!f) {
+            fprintf(stderr, "Failed to open log file %s, logging to stdout\n", path);
+        }
+        pthread_mutex_lock(&drain_lock);
+        log_file = f;
+        pthread_mutex_unlock(&drain_lock);
+    }
+
+    writer_stop = 0;
+    if (pthread_create(&writer_thread, NULL, log_writer, NULL) != 0) {
+        fprintf(stderr, "Failed to start log writer, logging synchronously\n");
+        return -1;
+    }
+    atomic_store_explicit(&writer_running, 1, memory_order_release);
+    return 0;
+}
+
+void cleanup_logging(void) {
+    if (!atomic_load(&writer_running)) return;
+
+    // New messages go straight out; the writer drains what is buffered
+    atomic_store_explicit(&writer_running, 0, memory_order_release);
+    pthread_mutex_lock(&writer_lock);
+    writer_stop = 1;
+    pthread_cond_signal(&writer_wake);
+    pthread_mutex_unlock(&writer_lock);
+    pthread_join(writer_thread, NULL);
+
+    pthread_mutex_lock(&drain_lock);
+    drain_rings();
+    if (log_file) {
+        fclose(log_file);
+        log_file = NULL;
+    }
+    pthread_mutex_unlock(&drain_lock);
+}
+
+void set_log_level(int level) {
+    if (level < LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+    if (level > LOG_LEVEL_OFF) level = LOG_LEVEL_OFF;
+    atomic_store_explicit(&dlog_level, level, memory_order_relaxed);
+}
+
+int get_log_level(void) {
+    return atomic_load_explicit(&dlog_level, memory_order_relaxed);
+}
+
+int parse_log_level(const char *name) {
+    if (!name) return -1;
+    for (int level = LOG_LEVEL_DEBUG; level <= LOG_LEVEL_ERROR; level++) {
+        if (strcasecmp(name, level_names[level]) == 0) return level;
+    }
+    if (strcasecmp(name, "warning") == 0) return LOG_LEVEL_WARN;
+    if (strcasecmp(name, "off") == 0) return LOG_LEVEL_OFF;
+    return -1;
+}
+
+void dlog_flush(void) {
+    pthread_mutex_lock(&drain_lock);
+    drain_rings();
+    pthread_mutex_unlock(&drain_lock);
+    fflush(stdout);
+}
+
+void dlog_stats(uint64_t *written, uint64_t *dropped, uint64_t *suppressed) {
+    if (written) *written = atomic_load(&total_written);
+    if (dropped) {
+        uint64_t total = 0;
+        for (log_ring_t *ring = atomic_load(&rings); ring; ring = ring->next) {
+            total += atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        }
+        *dropped = total;
+    }
+    if (suppressed) *suppressed = atomic_load(&total_suppressed);
+}
@@ -0,0 +1,564 @@
+#include "../include/dns_frontend.h"
+#include "../include/dns_wire.h"
+#include "../include/metrics.h"
+#include "../include/debug.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define FRONTEND_POLL_MS 200
+#define FRONTEND_UDP_BATCH 32
+#define FRONTEND_UDP_REQUEST_MAX 4096      // Larger datagrams are not queries
+#define FRONTEND_UDP_RCVBUF (1 << 20)
+#define FRONTEND_TCP_BACKLOG 128
+#define FRONTEND_TCP_FRAME (2 + DNS_WIRE_MAX_MESSAGE)
+
+typedef struct {
+    struct dns_frontend_s* frontend;
+    int fd;
+    pthread_t thread;
+    int started;
+    uint8_t* requests;              // FRONTEND_UDP_BATCH slots of FRONTEND_UDP_REQUEST_MAX
+    uint8_t* responses;             // FRONTEND_UDP_BATCH slots of edns_udp_size
+} udp_worker_t;
+
+// One TCP connection; requests and answers carry a 2-byte length prefix.
+// While busy, a TCP worker owns in and out and the poll thread leaves the
+// connection alone.
+typedef struct tcp_client_s {
+    int fd;
+    uint8_t* in;
+    size_t in_len;
+    uint8_t* out;
+    size_t out_len;
+    size_t out_off;
+    uint64_t last_active_ms;
+    atomic_int busy;
+    int answered;                   // Set by the worker before busy is cleared
+    struct tcp_client_s* next;      // Work queue link
+} tcp_client_t;
+
+struct dns_frontend_s {
+    dns_frontend_config_t config;
+    dns_resolver_t* resolver;
+    uint16_t port;
+    udp_worker_t udp[DNS_FRONTEND_MAX_WORKERS];
+    int udp_count;
+    int tcp_fd;
+    pthread_t tcp_thread;           // Polls connections, never resolves
+    int tcp_started;
+    tcp_client_t** tcp_clients;
+    int tcp_client_count;
+
+    // TCP requests are resolved by workers, so a slow upstream lookup
+    // holds up only its own connection
+    pthread_t tcp_workers[DNS_FRONTEND_MAX_WORKERS];
+    int tcp_worker_count;
+    pthread_mutex_t tcp_lock;
+    pthread_cond_t tcp_cond;
+    tcp_client_t* tcp_queue_head;
+    tcp_client_t* tcp_queue_tail;
+    int wake_fds[2];                // Workers wake the poll thread with a byte
+    atomic_int running;
+};
+
+static int default_workers(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    return cpus > DNS_FRONTEND_MAX_WORKERS ? DNS_FRONTEND_MAX_WORKERS : (int)cpus;
+}
+
+void dns_frontend_default_config(dns_frontend_config_t* config) {
+    if (!config) return;
+    memset(config, 0, sizeof(*config));
+    config->bind_address = NULL;
+    config->port = DNS_FRONTEND_DEFAULT_PORT;
+    config->udp_workers = default_workers();
+    config->tcp_workers = default_workers();
+    config->tcp_max_clients = DNS_FRONTEND_DEFAULT_TCP_CLIENTS;
+    config->tcp_idle_timeout_ms = DNS_FRONTEND_DEFAULT_TCP_IDLE_MS;
+    config->edns_udp_size = DNS_WIRE_DEFAULT_EDNS_SIZE;
+}
+
+static void free_records(dns_record_t* records, int count) {
+    if (!records) return;
+    for (int i = 0; i < count; i++) {
+        free(records[i].name);
+        free(records[i].rdata);
+    }
+    free(records);
+}
+
+ssize_t dns_frontend_answer(dns_resolver_t* resolver, const uint8_t* request, size_t request_len,
+                            uint16_t udp_limit, uint8_t* response, size_t response_cap) {
+    if (!request || !response) return -1;
+
+    dns_wire_query_t query;
+    int rcode = dns_wire_parse_query(request, request_len, &query);
+    if (rcode < 0) return -1;
+
+    // Over UDP the answer must fit the smaller of both sides' buffers
+    size_t max_len = response_cap;
+    if (udp_limit > 0) {
+        size_t limit = query.has_edns ? query.edns_udp_size : DNS_WIRE_CLASSIC_UDP_SIZE;
+        if (limit > udp_limit) limit = udp_limit < DNS_WIRE_CLASSIC_UDP_SIZE ? DNS_WIRE_CLASSIC_UDP_SIZE : udp_limit;
+        if (max_len > limit) max_len = limit;
+    }
+    uint16_t advertised = udp_limit > 0 ? udp_limit : DNS_WIRE_DEFAULT_EDNS_SIZE;
+
+    dns_record_t* records = NULL;
+    int record_count = 0;
+    if (rcode == 0) {
+        if (!resolver) {
+            rcode = DNS_STATUS_SERVFAIL;
+        } else if (query.qclass != DNS_WIRE_CLASS_IN) {
+            rcode = DNS_STATUS_REFUSED;
+        } else if (dns_wire_type_supported(query.qtype)) {
+            rcode = resolve_dns_query(resolver, query.qname, (dns_record_type_t)query.qtype,
+                                      &records, &record_count);
+        }
+        // Types outside dns_record_type_t get an empty NOERROR answer:
+        // no record of theirs can exist here
+    }
+
+    int recursion_available = resolver && resolver->config.enable_recursive_resolution;
+    ssize_t len = dns_wire_build_response(&query, rcode, recursion_available, records, record_count,
+                                          advertised, response, max_len);
+    if (len < 0 && rcode == 0 && record_count > 0) {
+        log_warn("DNS frontend: cannot encode the answer for %s", query.qname);
+        len = dns_wire_build_response(&query, DNS_STATUS_SERVFAIL, recursion_available, NULL, 0,
+                                      advertised, response, max_len);
+    }
+    free_records(records, record_count);
+
+    if (len > 0 && ((response[2] << 8) & DNS_WIRE_FLAG_TC)) metrics_inc(METRIC_DNS_TRUNCATED);
+    return len;
+}
+
+static void* udp_worker_loop(void* arg) {
+    udp_worker_t* worker = (udp_worker_t*)arg;
+    dns_frontend_t* frontend = worker->frontend;
+    size_t response_cap = frontend->config.edns_udp_size;
+
+    struct mmsghdr requests[FRONTEND_UDP_BATCH];
+    struct iovec request_iov[FRONTEND_UDP_BATCH];
+    struct sockaddr_storage peers[FRONTEND_UDP_BATCH];
+    struct mmsghdr replies[FRONTEND_UDP_BATCH];
+    struct iovec reply_iov[FRONTEND_UDP_BATCH];
+    struct pollfd pfd = { .fd = worker->fd, .events = POLLIN };
+
+    while (atomic_load(&frontend->running)) {
+        if (poll(&pfd, 1, FRONTEND_POLL_MS) <= 0) continue;
+
+        for (int i = 0; i < FRONTEND_UDP_BATCH; i++) {
+            request_iov[i].iov_base = worker->requests + (size_t)i * FRONTEND_UDP_REQUEST_MAX;
+            request_iov[i].iov_len = FRONTEND_UDP_REQUEST_MAX;
+            memset(&requests[i].msg_hdr, 0, sizeof(requests[i].msg_hdr));
+            requests[i].msg_hdr.msg_name = &peers[i];
+            requests[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+            requests[i].msg_hdr.msg_iov = &request_iov[i];
+            requests[i].msg_hdr.msg_iovlen = 1;
+        }
+        int received = recvmmsg(worker->fd, requests, FRONTEND_UDP_BATCH, MSG_DONTWAIT, NULL);
+        if (received <= 0) continue;
+
+        int reply_count = 0;
+        for (int i = 0; i < received; i++) {
+            if (requests[i].msg_hdr.msg_flags & MSG_TRUNC) continue;
+            uint8_t* response = worker->responses + (size_t)reply_count * response_cap;
+            ssize_t len = dns_frontend_answer(frontend->resolver, request_iov[i].iov_base, requests[i].msg_len,
+                                              frontend->config.edns_udp_size, response, response_cap);
+            if (len < 0) continue;
+            metrics_inc(METRIC_DNS_UDP_QUERIES);
+
+            reply_iov[reply_count].iov_base = response;
+            reply_iov[reply_count].iov_len = (size_t)len;
+            memset(&replies[reply_count].msg_hdr, 0, sizeof(replies[reply_count].msg_hdr));
+            replies[reply_count].msg_hdr.msg_name = &peers[i];
+            replies[reply_count].msg_hdr.msg_namelen = requests[i].msg_hdr.msg_namelen;
+            replies[reply_count].msg_hdr.msg_iov = &reply_iov[reply_count];
+            replies[reply_count].msg_hdr.msg_iovlen = 1;
+            reply_count++;
+        }
+
+        int sent = 0;
+        while (sent < reply_count) {
+            int n = sendmmsg(worker->fd, replies + sent, (unsigned)(reply_count - sent), 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                // Skip the datagram the kernel refused and carry on with the rest
+                log_debug("DNS frontend: UDP send failed: %s", strerror(errno));
+                n = 1;
+            }
+            sent += n;
+        }
+    }
+    return NULL;
+}
+
+static void close_tcp_client(tcp_client_t* client) {
+    close(client->fd);
+    free(client->in);
+    free(client);
+}
+
+// Sends what is pending, then hands the next buffered request to a worker
+// (RFC 7766 pipelining, answered in order). Returns -1 when the connection
+// must be closed.
+static int serve_tcp_client(dns_frontend_t* frontend, tcp_client_t* client) {
+    while (client->out_off < client->out_len) {
+        ssize_t n = send(client->fd, client->out + client->out_off, client->out_len - client->out_off,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        client->out_off += (size_t)n;
+    }
+    client->out_len = client->out_off = 0;
+
+    if (client->in_len < 2) return 0;
+    size_t message_len = (size_t)client->in[0] << 8 | client->in[1];
+    if (message_len == 0) return -1;
+    if (client->in_len < 2 + message_len) return 0;
+
+    atomic_store(&client->busy, 1);
+    pthread_mutex_lock(&frontend->tcp_lock);
+    client->next = NULL;
+    if (frontend->tcp_queue_tail) {
+        frontend->tcp_queue_tail->next = client;
+    } else {
+        frontend->tcp_queue_head = client;
+    }
+    frontend->tcp_queue_tail = client;
+    pthread_cond_signal(&frontend->tcp_cond);
+    pthread_mutex_unlock(&frontend->tcp_lock);
+    return 0;
+}
+
+// Answers the first buffered request into out and drops it from in
+static void answer_tcp_request(dns_frontend_t* frontend, tcp_client_t* client) {
+    size_t message_len = (size_t)client->in[0] << 8 | client->in[1];
+    ssize_t len = dns_frontend_answer(frontend->resolver, client->in + 2, message_len, 0,
+                                      client->out + 2, DNS_WIRE_MAX_MESSAGE);
+    if (len > 0) {
+        metrics_inc(METRIC_DNS_TCP_QUERIES);
+        client->out[0] = (uint8_t)(len >> 8);
+        client->out[1] = (uint8_t)len;
+        client->out_len = (size_t)len + 2;
+    }
+    client->in_len -= 2 + message_len;
+    memmove(client->in, client->in + 2 + message_len, client->in_len);
+}
+
+static void* tcp_worker_loop(void* arg) {
+    dns_frontend_t* frontend = (dns_frontend_t*)arg;
+
+    pthread_mutex_lock(&frontend->tcp_lock);
+    for (;;) {
+        while (atomic_load(&frontend->running) && !frontend->tcp_queue_head) {
+            pthread_cond_wait(&frontend->tcp_cond, &frontend->tcp_lock);
+        }
+        tcp_client_t* client = frontend->tcp_queue_head;
+        if (!client) break;
+        frontend->tcp_queue_head = client->next;
+        if (!frontend->tcp_queue_head) frontend->tcp_queue_tail = NULL;
+        pthread_mutex_unlock(&frontend->tcp_lock);
+
+        answer_tcp_request(frontend, client);
+        client->answered = 1;
+        atomic_store(&client->busy, 0);
+        // A full pipe already has a wakeup pending
+        uint8_t byte = 1;
+        if (write(frontend->wake_fds[1], &byte, 1) < 0 && errno != EAGAIN) {
+            log_debug("DNS frontend: cannot wake the TCP listener: %s", strerror(errno));
+        }
+
+        pthread_mutex_lock(&frontend->tcp_lock);
+    }
+    pthread_mutex_unlock(&frontend->tcp_lock);
+    return NULL;
+}
+
+static int read_tcp_client(tcp_client_t* client) {
+    for (;;) {
+        ssize_t n = recv(client->fd, client->in + client->in_len, FRONTEND_TCP_FRAME - client->in_len, MSG_DONTWAIT);
+        if (n > 0) {
+            client->in_len += (size_t)n;
+            if (client->in_len == FRONTEND_TCP_FRAME) return 0;
+            continue;
+        }
+        if (n == 0) return -1;
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+}
+
+static void accept_tcp_client(dns_frontend_t* frontend) {
+    int fd = accept4(frontend->tcp_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    if (frontend->tcp_client_count >= frontend->config.tcp_max_clients) {
+        log_debug("DNS frontend: TCP client limit reached, closing new connection");
+        close(fd);
+        return;
+    }
+    // One block holds the request and the answer frame
+    tcp_client_t* client = calloc(1, sizeof(tcp_client_t));
+    uint8_t* buffers = malloc(2 * FRONTEND_TCP_FRAME);
+    if (!client || !buffers) {
+        free(client);
+        free(buffers);
+        close(fd);
+        return;
+    }
+    frontend->tcp_clients[frontend->tcp_client_count++] = client;
+    client->fd = fd;
+    client->in = buffers;
+    client->out = buffers + FRONTEND_TCP_FRAME;
+    client->last_active_ms = metrics_now_us() / 1000;
+}
+
+static void* tcp_loop(void* arg) {
+    dns_frontend_t* frontend = (dns_frontend_t*)arg;
+    tcp_client_t** clients = frontend->tcp_clients;
+    struct pollfd* pfds = calloc((size_t)frontend->config.tcp_max_clients + 2, sizeof(struct pollfd));
+    if (!pfds) {
+        log_error("DNS frontend: out of memory, TCP listener stopped");
+        return NULL;
+    }
+
+    while (atomic_load(&frontend->running)) {
+        int client_count = frontend->tcp_client_count;
+        pfds[0].fd = frontend->tcp_fd;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = frontend->wake_fds[0];
+        pfds[1].events = POLLIN;
+        for (int i = 0; i < client_count; i++) {
+            // Connections a worker is answering are not polled
+            pfds[i + 2].fd = atomic_load(&clients[i]->busy) ? -1 : clients[i]->fd;
+            pfds[i + 2].events = clients[i]->out_len > 0 ? POLLOUT : POLLIN;
+            pfds[i + 2].revents = 0;
+        }
+        int ready = poll(pfds, (nfds_t)client_count + 2, FRONTEND_POLL_MS);
+        uint64_t now_ms = metrics_now_us() / 1000;
+
+        if (ready > 0 && (pfds[1].revents & POLLIN)) {
+            uint8_t drain[64];
+            while (read(frontend->wake_fds[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        for (int i = 0; i < client_count; i++) {
+            tcp_client_t* client = clients[i];
+            if (atomic_load(&client->busy)) continue;
+            short revents = ready > 0 && pfds[i + 2].fd >= 0 ? pfds[i + 2].revents : 0;
+            int keep = 1;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                keep = read_tcp_client(client) == 0 && !(revents & POLLERR);
+            }
+            if (keep && (revents || client->answered)) {
+                client->answered = 0;
+                keep = serve_tcp_client(frontend, client) == 0;
+                client->last_active_ms = now_ms;
+            }
+            if (keep && now_ms - client->last_active_ms > (uint64_t)frontend->config.tcp_idle_timeout_ms) {
+                keep = 0;
+            }
+            if (!keep) {
+                close_tcp_client(client);
+                clients[i] = NULL;
+            }
+        }
+
+        // Drop closed clients, keeping the rest in order
+        int kept = 0;
+        for (int i = 0; i < client_count; i++) {
+            if (clients[i]) clients[kept++] = clients[i];
+        }
+        frontend->tcp_client_count = kept;
+
+        if (ready > 0 && (pfds[0].revents & POLLIN)) {
+            accept_tcp_client(frontend);
+        }
+    }
+
+    // Connections are closed by cleanup_dns_frontend once the workers stop
+    free(pfds);
+    return NULL;
+}
+
+static int open_socket(const char* address, uint16_t port, int type, int reuse_port) {
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = type;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+
+    struct addrinfo* res = NULL;
+    int rv = getaddrinfo(address, port_str, &hints, &res);
+    if (rv != 0) {
+        log_error("DNS frontend: invalid bind address %s: %s", address, gai_strerror(rv));
+        return -1;
+    }
+
+    int fd = socket(res->ai_family, type | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        freeaddrinfo(res);
+        return -1;
+    }
+    int one = 1, zero = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (reuse_port) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    // "::" serves IPv4 clients too
+    if (res->ai_family == AF_INET6) setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+    if (type == SOCK_DGRAM) {
+        int rcvbuf = FRONTEND_UDP_RCVBUF;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+
+    if (bind(fd, res->ai_addr, res->ai_addrlen) != 0 ||
+        (type == SOCK_STREAM && listen(fd, FRONTEND_TCP_BACKLOG) != 0)) {
+        log_error("DNS frontend: cannot listen on [%s]:%u/%s: %s", address, port,
+                  type == SOCK_STREAM ? "tcp" : "udp", strerror(errno));
+        close(fd);
+        freeaddrinfo(res);
+        return -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static uint16_t socket_port(int fd) {
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr*)&addr, &len) != 0) return 0;
+    if (addr.ss_family == AF_INET6) return ntohs(((struct sockaddr_in6*)&addr)->sin6_port);
+    return ntohs(((struct sockaddr_in*)&addr)->sin_port);
+}
+
+void cleanup_dns_frontend(dns_frontend_t* frontend) {
+    if (!frontend) return;
+    atomic_store(&frontend->running, 0);
+    for (int i = 0; i < frontend->udp_count; i++) {
+        udp_worker_t* worker = &frontend->udp[i];
+        if (worker->started) pthread_join(worker->thread, NULL);
+        if (worker->fd >= 0) close(worker->fd);
+        free(worker->requests);
+        free(worker->responses);
+    }
+    if (frontend->tcp_started) pthread_join(frontend->tcp_thread, NULL);
+    pthread_mutex_lock(&frontend->tcp_lock);
+    pthread_cond_broadcast(&frontend->tcp_cond);
+    pthread_mutex_unlock(&frontend->tcp_lock);
+    for (int i = 0; i < frontend->tcp_worker_count; i++) {
+        pthread_join(frontend->tcp_workers[i], NULL);
+    }
+    for (int i = 0; i < frontend->tcp_client_count; i++) {
+        close_tcp_client(frontend->tcp_clients[i]);
+    }
+    free(frontend->tcp_clients);
+    if (frontend->tcp_fd >= 0) close(frontend->tcp_fd);
+    for (int i = 0; i < 2; i++) {
+        if (frontend->wake_fds[i] >= 0) close(frontend->wake_fds[i]);
+    }
+    pthread_cond_destroy(&frontend->tcp_cond);
+    pthread_mutex_destroy(&frontend->tcp_lock);
+    free(frontend);
+}
+
+int init_dns_frontend(const dns_frontend_config_t* config, dns_resolver_t* resolver, dns_frontend_t** frontend_out) {
+    if (!config || !resolver || !frontend_out) return -1;
+    if (config->udp_workers < 1 || config->udp_workers > DNS_FRONTEND_MAX_WORKERS ||
+        config->tcp_workers < 1 || config->tcp_workers > DNS_FRONTEND_MAX_WORKERS ||
+        config->tcp_max_clients < 1 || config->tcp_idle_timeout_ms < 1 ||
+        config->edns_udp_size < DNS_WIRE_CLASSIC_UDP_SIZE || config->edns_udp_size > DNS_FRONTEND_MAX_EDNS_SIZE) {
+        log_error("DNS frontend: invalid configuration");
+        return -1;
+    }
+
+    dns_frontend_t* frontend = calloc(1, sizeof(dns_frontend_t));
+    if (!frontend) return -1;
+    frontend->config = *config;
+    frontend->config.bind_address = NULL;   // Not kept; only used to bind below
+    frontend->resolver = resolver;
+    frontend->tcp_fd = -1;
+    frontend->wake_fds[0] = frontend->wake_fds[1] = -1;
+    atomic_init(&frontend->running, 1);
+    pthread_mutex_init(&frontend->tcp_lock, NULL);
+    pthread_cond_init(&frontend->tcp_cond, NULL);
+    frontend->tcp_clients = calloc((size_t)config->tcp_max_clients, sizeof(tcp_client_t*));
+    if (!frontend->tcp_clients || pipe2(frontend->wake_fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        cleanup_dns_frontend(frontend);
+        return -1;
+    }
+
+    const char* address = config->bind_address ? config->bind_address : "::";
+    uint16_t port = config->port;
+    for (int i = 0; i < config->udp_workers; i++) {
+        udp_worker_t* worker = &frontend->udp[i];
+        worker->frontend = frontend;
+        worker->fd = open_socket(address, port, SOCK_DGRAM, config->udp_workers > 1);
+        frontend->udp_count++;
+        if (worker->fd < 0) {
+            cleanup_dns_frontend(frontend);
+            return -1;
+        }
+        // Later sockets join the port the first one got
+        if (port == 0) port = socket_port(worker->fd);
+        worker->requests = malloc((size_t)FRONTEND_UDP_BATCH * FRONTEND_UDP_REQUEST_MAX);
+        worker->responses = malloc((size_t)FRONTEND_UDP_BATCH * config->edns_udp_size);
+        if (!worker->requests || !worker->responses) {
+            cleanup_dns_frontend(frontend);
+            return -1;
+        }
+    }
+    frontend->port = port;
+
+    frontend->tcp_fd = open_socket(address, port, SOCK_STREAM, 0);
+    if (frontend->tcp_fd < 0) {
+        cleanup_dns_frontend(frontend);
+        return -1;
+    }
+
+    for (int i = 0; i < frontend->udp_count; i++) {
+        udp_worker_t* worker = &frontend->udp[i];
+        if (pthread_create(&worker->thread, NULL, udp_worker_loop, worker) != 0) {
+            log_error("DNS frontend: failed to start UDP worker");
+            cleanup_dns_frontend(frontend);
+            return -1;
+        }
+        worker->started = 1;
+    }
+    for (int i = 0; i < config->tcp_workers; i++) {
+        if (pthread_create(&frontend->tcp_workers[i], NULL, tcp_worker_loop, frontend) != 0) {
+            log_error("DNS frontend: failed to start TCP worker");
+            cleanup_dns_frontend(frontend);
+            return -1;
+        }
+        frontend->tcp_worker_count++;
+    }
+    if (pthread_create(&frontend->tcp_thread, NULL, tcp_loop, frontend) != 0) {
+        log_error("DNS frontend: failed to start TCP listener");
+        cleanup_dns_frontend(frontend);
+        return -1;
+    }
+    frontend->tcp_started = 1;
+
+    log_info("Serving DNS on [%s]:%u (UDP x%d, TCP x%d)", address, port, config->udp_workers, config->tcp_workers);
+    *frontend_out = frontend;
+    return 0;
+}
+
+uint16_t dns_frontend_port(const dns_frontend_t* frontend) {
+    return frontend ? frontend->port : 0;
+}
@@ -1,9 +1,13 @@
 #include "../include/dns_resolver.h"
 #include "../include/debug.h"
+#include "../include/metrics.h"
+#include "../include/query_trace.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <limits.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -38,7 +42,6 @@ static dns_response_status_t resolve_external_dns(const char* query_name,
                                                  int* record_count,
                                                  const external_dns_config_t* config);
 
-static int is_external_domain(const char* query_name, tld_manager_t* tld_manager);
 
 // Enhanced error handling and logging
 static void log_dns_error(const char* operation, const char* domain, dns_response_status_t status) {
@@ -153,35 +156,6 @@ static dns_response_status_t resolve_external_dns_with_fallback(const char* quer
     return DNS_STATUS_SERVFAIL;
 }
 
-// Helper function to duplicate a DNS record
-static dns_record_t* duplicate_dns_record(const dns_record_t* src) {
-    if (!src) return NULL;
-    
-    dns_record_t* dup = malloc(sizeof(dns_record_t));
-    if (!dup) return NULL;
-    
-    memset(dup, 0, sizeof(dns_record_t));
-    
-    dup->name = strdup(src->name);
-    if (!dup->name) {
-        free(dup);
-        return NULL;
-    }
-    
-    dup->rdata = strdup(src->rdata);
-    if (!dup->rdata) {
-        free(dup->name);
-        free(dup);
-        return NULL;
-    }
-    
-    dup->type = src->type;
-    dup->ttl = src->ttl;
-    dup->last_updated = src->last_updated;
-    
-    return dup;
-}
-
 // Free a DNS record
 static void free_dns_record(dns_record_t* record) {
     if (!record) return;
@@ -191,6 +165,243 @@ static void free_dns_record(dns_record_t* record) {
     free(record);
 }
 
+// Result records come from the request's arena when there is one, so the
+// query path itself makes no malloc calls; otherwise the caller frees them
+static void* result_alloc(query_arena_t* arena, size_t size) {
+    return arena ? query_arena_alloc(arena, size) : malloc(size);
+}
+
+static void* result_realloc(query_arena_t* arena, void* ptr, size_t old_size, size_t new_size) {
+    return arena ? query_arena_realloc(arena, ptr, old_size, new_size) : realloc(ptr, new_size);
+}
+
+static void result_free(query_arena_t* arena, void* ptr) {
+    if (!arena) free(ptr);
+}
+
+static void release_result_record(query_arena_t* arena, dns_record_t* record) {
+    result_free(arena, record->name);
+    result_free(arena, record->rdata);
+}
+
+static void free_result_records(query_arena_t* arena, dns_record_t* records, int count) {
+    if (arena || !records) return;
+    for (int i = 0; i < count; i++) {
+        release_result_record(arena, &records[i]);
+    }
+    free(records);
+}
+
+// Copy a record into a result slot, strings included
+static int copy_result_record(query_arena_t* arena, dns_record_t* dst, const dns_record_t* src) {
+    dst->name = arena ? query_arena_strdup(arena, src->name) : strdup(src->name);
+    dst->rdata = arena ? query_arena_strdup(arena, src->rdata) : strdup(src->rdata);
+    if (!dst->name || !dst->rdata) {
+        release_result_record(arena, dst);
+        return -1;
+    }
+    dst->type = src->type;
+    dst->ttl = src->ttl;
+    dst->last_updated = src->last_updated;
+    return 0;
+}
+
+// Records gathered along a CNAME chain
+typedef struct {
+    query_arena_t* arena;
+    dns_record_t* records;
+    int count;
+    int capacity;
+} result_list_t;
+
+static int result_reserve(result_list_t* list, size_t extra) {
+    if ((size_t)(list->capacity - list->count) >= extra) return 0;
+    size_t capacity = list->capacity ? (size_t)list->capacity : 4;
+    while (capacity < (size_t)list->count + extra) capacity *= 2;
+    if (capacity > INT_MAX) return -1;
+    dns_record_t* grown = result_realloc(list->arena, list->records,
+                                         (size_t)list->capacity * sizeof(dns_record_t),
+                                         capacity * sizeof(dns_record_t));
+    if (!grown) return -1;
+    list->records = grown;
+    list->capacity = (int)capacity;
+    return 0;
+}
+
+static int result_append(result_list_t* list, const dns_record_t* record) {
+    if (result_reserve(list, 1) != 0) return -1;
+    if (copy_result_record(list->arena, &list->records[list->count], record) != 0) return -1;
+    list->count++;
+    return 0;
+}
+
+// Flattened CNAME chains: the alias's CNAMEs and final records in one
+// entry, expiring with the shortest TTL along the chain. Direct-mapped by
+// (name, type); any TLD or record change drops every entry.
+#define DNS_CHAIN_CACHE_SLOTS 1024
+
+typedef struct {
+    char* name;                             // The alias queried, NULL for a free slot
+    dns_record_type_t type;
+    dns_record_t* records;
+    int record_count;
+    time_t stored_at;
+    time_t expires_at;
+    uint64_t generation;
+} dns_chain_entry_t;
+
+struct dns_chain_cache_s {
+    dns_chain_entry_t slots[DNS_CHAIN_CACHE_SLOTS];
+    uint64_t generation;
+    pthread_mutex_t lock;
+};
+
+static size_t chain_slot(const char* name, dns_record_type_t type) {
+    uint64_t h = 1469598103934665603ULL;    // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+    h = (h ^ (uint64_t)type) * 1099511628211ULL;
+    return (size_t)(h & (DNS_CHAIN_CACHE_SLOTS - 1));
+}
+
+static void free_chain_entry(dns_chain_entry_t* entry) {
+    free_result_records(NULL, entry->records, entry->record_count);
+    free(entry->name);
+    memset(entry, 0, sizeof(dns_chain_entry_t));
+}
+
+static void chain_cache_invalidate(struct dns_chain_cache_s* chains) {
+    if (!chains) return;
+    pthread_mutex_lock(&chains->lock);
+    chains->generation++;
+    pthread_mutex_unlock(&chains->lock);
+}
+
+static void on_tld_mutation(void* ctx, const tld_mutation_t* mutation) {
+    switch (mutation->type) {
+        case TLD_MUTATION_REGISTER:
+        case TLD_MUTATION_ADD_RECORD:
+        case TLD_MUTATION_REMOVE_RECORD:
+            chain_cache_invalidate((struct dns_chain_cache_s*)ctx);
+            break;
+        default:
+            break;
+    }
+}
+
+// Without change notifications local chains could go stale, so the cache
+// is only used when the listener is registered
+static int init_chain_cache(dns_resolver_t* resolver) {
+    struct dns_chain_cache_s* chains = calloc(1, sizeof(struct dns_chain_cache_s));
+    if (!chains) return -1;
+    chains->generation = 1;
+    if (pthread_mutex_init(&chains->lock, NULL) != 0) {
+        free(chains);
+        return -1;
+    }
+    if (add_tld_mutation_listener(resolver->tld_manager, on_tld_mutation, chains) != 0) {
+        pthread_mutex_destroy(&chains->lock);
+        free(chains);
+        return -1;
+    }
+    resolver->chain_cache = chains;
+    return 0;
+}
+
+static void cleanup_chain_cache(dns_resolver_t* resolver) {
+    struct dns_chain_cache_s* chains = resolver->chain_cache;
+    if (!chains) return;
+    remove_tld_mutation_listener(resolver->tld_manager, on_tld_mutation, chains);
+    for (size_t i = 0; i < DNS_CHAIN_CACHE_SLOTS; i++) {
+        free_chain_entry(&chains->slots[i]);
+    }
+    pthread_mutex_destroy(&chains->lock);
+    free(chains);
+    resolver->chain_cache = NULL;
+}
+
+static uint64_t chain_cache_generation(dns_resolver_t* resolver) {
+    struct dns_chain_cache_s* chains = resolver->chain_cache;
+    if (!chains) return 0;
+    pthread_mutex_lock(&chains->lock);
+    uint64_t generation = chains->generation;
+    pthread_mutex_unlock(&chains->lock);
+    return generation;
+}
+
+// Appends a cached chain with its TTLs aged; 1 = found, 0 = not found
+static int chain_cache_lookup(dns_resolver_t* resolver, const char* name,
+                              dns_record_type_t type, result_list_t* list) {
+    struct dns_chain_cache_s* chains = resolver->chain_cache;
+    if (!chains) return 0;
+
+    time_t now = time(NULL);
+    int found = 0;
+    pthread_mutex_lock(&chains->lock);
+    dns_chain_entry_t* entry = &chains->slots[chain_slot(name, type)];
+    if (entry->name && entry->generation == chains->generation && entry->expires_at > now &&
+        entry->type == type && strcmp(entry->name, name) == 0 &&
+        result_reserve(list, (size_t)entry->record_count) == 0) {
+        // Every TTL is above the entry's age until it expires
+        uint32_t age = (uint32_t)(now - entry->stored_at);
+        found = 1;
+        for (int i = 0; i < entry->record_count && found; i++) {
+            found = result_append(list, &entry->records[i]) == 0;
+            if (found) list->records[list->count - 1].ttl -= age;
+        }
+    }
+    pthread_mutex_unlock(&chains->lock);
+
+    if (found) metrics_inc(METRIC_DNS_CNAME_CHAIN_HITS);
+    return found;
+}
+
+static void chain_cache_insert(dns_resolver_t* resolver, uint64_t generation, const char* name,
+                               dns_record_type_t type, const dns_record_t* records, int count) {
+    struct dns_chain_cache_s* chains = resolver->chain_cache;
+    if (!chains || count <= 0) return;
+
+    uint32_t min_ttl = UINT32_MAX;
+    for (int i = 0; i < count; i++) {
+        if (records[i].ttl < min_ttl) min_ttl = records[i].ttl;
+    }
+    if (resolver->config.cache_ttl_max > 0 && min_ttl > (uint32_t)resolver->config.cache_ttl_max) {
+        min_ttl = (uint32_t)resolver->config.cache_ttl_max;
+    }
+    if (min_ttl == 0) return;
+
+    // Entries outlive the request, so they are copied with malloc; the
+    // chain is one answer, every record carrying its shortest TTL
+    dns_chain_entry_t fresh = { .type = type, .record_count = count, .generation = generation };
+    fresh.name = strdup(name);
+    fresh.records = calloc((size_t)count, sizeof(dns_record_t));
+    int rv = fresh.name && fresh.records ? 0 : -1;
+    for (int i = 0; i < count && rv == 0; i++) {
+        rv = copy_result_record(NULL, &fresh.records[i], &records[i]);
+        fresh.records[i].ttl = min_ttl;
+    }
+    if (rv != 0) {
+        free_chain_entry(&fresh);
+        return;
+    }
+    fresh.stored_at = time(NULL);
+    fresh.expires_at = fresh.stored_at + (time_t)min_ttl;
+
+    pthread_mutex_lock(&chains->lock);
+    if (generation != chains->generation) {
+        // Resolved before a change
+        pthread_mutex_unlock(&chains->lock);
+        free_chain_entry(&fresh);
+        return;
+    }
+    dns_chain_entry_t* slot = &chains->slots[chain_slot(name, type)];
+    dns_chain_entry_t old = *slot;
+    *slot = fresh;
+    pthread_mutex_unlock(&chains->lock);
+    free_chain_entry(&old);
+}
+
 int init_dns_resolver(dns_resolver_t** resolver, tld_manager_t* tld_manager, dns_cache_t* cache) {
     if (!resolver || !tld_manager || !cache) return -1;
     
@@ -218,6 +429,10 @@ int init_dns_resolver(dns_resolver_t** resolver, tld_manager_t* tld_manager, dns
         return -1;
     }
     
+    if (init_chain_cache(*resolver) != 0) {
+        log_warn("CNAME chain cache unavailable, aliases resolve hop by hop");
+    }
+    
     dlog("DNS resolver initialized");
     return 0;
 }
@@ -225,6 +440,7 @@ int init_dns_resolver(dns_resolver_t** resolver, tld_manager_t* tld_manager, dns
 void cleanup_dns_resolver(dns_resolver_t* resolver) {
     if (!resolver) return;
     
+    cleanup_chain_cache(resolver);
     pthread_mutex_destroy(&resolver->lock);
     free(resolver);
     
@@ -264,6 +480,9 @@ int configure_dns_resolver(dns_resolver_t* resolver, const dns_resolver_config_t
     
     pthread_mutex_unlock(&resolver->lock);
     
+    // Cached chains were walked under the old depth limit and TTL bounds
+    chain_cache_invalidate(resolver->chain_cache);
+    
     dlog("DNS resolver configured: max_recursion=%d, cache_ttl_min=%d, cache_ttl_max=%d",
          resolver->config.max_recursion_depth,
          resolver->config.cache_ttl_min,
@@ -286,9 +505,10 @@ int parse_fqdn(const char* fqdn,
     size_t fqdn_len = strlen(fqdn);
     if (fqdn_len == 0) return -1;
     
-    // Make a copy of the FQDN to work with
-    char* fqdn_copy = strdup(fqdn);
-    if (!fqdn_copy) return -1;
+    // Work on a copy; no valid name is longer than this
+    if (fqdn_len >= MAX_DOMAIN_NAME_LEN) return -1;
+    char fqdn_copy[MAX_DOMAIN_NAME_LEN];
+    memcpy(fqdn_copy, fqdn, fqdn_len + 1);
     
     // Count the number of parts separated by dots
     int dot_count = 0;
@@ -350,7 +570,6 @@ int parse_fqdn(const char* fqdn,
         }
     }
     
-    free(fqdn_copy);
     return 0;
 }
 
@@ -434,24 +653,23 @@ int add_to_dns_cache(dns_resolver_t* resolver, const char* fqdn, const dns_recor
     resolver->cache->count++;
     
     pthread_mutex_unlock(&resolver->cache->lock);
+    metrics_inc(METRIC_DNS_CACHE_INSERTS);
     
-    dlog("Added to DNS cache: %s (type %d), expires in %ld seconds",
+    log_debug("Added to DNS cache: %s (type %d), expires in %ld seconds",
          fqdn, record->type, new_node->entry.expires_at - new_node->entry.fetched_at);
     
     return 0;
 }
 
-int lookup_in_dns_cache(dns_resolver_t* resolver, 
-                      const char* fqdn, 
-                      dns_record_type_t query_type,
-                      dns_record_t** record) {
-    if (!resolver || !fqdn || !record) return -1;
-    
+// Copies a live cache entry into *record; 1 = found, 0 = not found
+static int cache_lookup(dns_resolver_t* resolver, 
+                        const char* fqdn, 
+                        dns_record_type_t query_type,
+                        query_arena_t* arena,
+                        dns_record_t* record) {
     // Check if the cache exists
     if (!resolver->cache) return -1;
     
-    *record = NULL;
-    
     pthread_mutex_lock(&resolver->cache->lock);
     
     time_t now = time(NULL);
@@ -482,18 +700,21 @@ int lookup_in_dns_cache(dns_resolver_t* resolver,
                 free(to_remove);
                 
                 resolver->cache->count--;
+                metrics_inc(METRIC_DNS_CACHE_EXPIRED);
                 continue;
             }
             
             // Found a valid entry, duplicate it
-            *record = duplicate_dns_record(&current->entry.record);
+            int rv = copy_result_record(arena, record, &current->entry.record);
+            time_t remaining = current->entry.expires_at - now;
             
             pthread_mutex_unlock(&resolver->cache->lock);
+            metrics_inc(METRIC_DNS_CACHE_HITS);
             
-            dlog("Cache hit for %s (type %d), TTL remaining: %ld seconds",
-                 fqdn, query_type, current->entry.expires_at - now);
+            log_debug("Cache hit for %s (type %d), TTL remaining: %ld seconds",
+                 fqdn, query_type, remaining);
             
-            return *record ? 1 : -1;  // 1 = found, -1 = error duplicating
+            return rv == 0 ? 1 : -1;  // 1 = found, -1 = error duplicating
         }
         
         prev = current;
@@ -503,133 +724,105 @@ int lookup_in_dns_cache(dns_resolver_t* resolver,
     pthread_mutex_unlock(&resolver->cache->lock);
     
     // Not found in cache
+    metrics_inc(METRIC_DNS_CACHE_MISSES);
     return 0;
 }
 
-dns_response_status_t resolve_cname(dns_resolver_t* resolver,
-                                 const char* cname_target,
-                                 dns_record_type_t target_type,
-                                 dns_record_t** records,
-                                 int* record_count,
-                                 int recursion_depth) {
-    if (!resolver || !cname_target || !records || !record_count) 
-        return DNS_STATUS_SERVFAIL;
+int lookup_in_dns_cache(dns_resolver_t* resolver, 
+                      const char* fqdn, 
+                      dns_record_type_t query_type,
+                      dns_record_t** record) {
+    if (!resolver || !fqdn || !record) return -1;
     
-    // Check recursion depth
-    if (recursion_depth >= resolver->config.max_recursion_depth) {
-        dlog("Maximum CNAME recursion depth reached (%d)", recursion_depth);
-        return DNS_STATUS_SERVFAIL;
-    }
+    *record = NULL;
     
-    // Initialize output parameters
-    *records = NULL;
-    *record_count = 0;
+    dns_record_t found;
+    int rv = cache_lookup(resolver, fqdn, query_type, NULL, &found);
+    if (rv <= 0) return rv;
     
-    // Resolve the CNAME target
-    return resolve_dns_query(resolver, cname_target, target_type, records, record_count);
+    *record = malloc(sizeof(dns_record_t));
+    if (!*record) {
+        release_result_record(NULL, &found);
+        return -1;
+    }
+    **record = found;
+    return 1;
 }
 
-dns_response_status_t resolve_dns_query(dns_resolver_t* resolver, 
-                                     const char* query_name, 
-                                     dns_record_type_t query_type,
-                                     dns_record_t** records,
-                                     int* record_count) {
-    if (!resolver || !query_name || !records || !record_count) 
-        return DNS_STATUS_SERVFAIL;
-    
-    // Initialize output parameters
-    *records = NULL;
-    *record_count = 0;
-    
-    // Check cache first
-    dns_record_t* cached_record = NULL;
-    int cache_result = lookup_in_dns_cache(resolver, query_name, query_type, &cached_record);
-    
-    if (cache_result > 0 && cached_record) {
-        // Cache hit
-        *records = malloc(sizeof(dns_record_t));
-        if (!*records) {
-            free_dns_record(cached_record);
-            return DNS_STATUS_SERVFAIL;
+// Resolves a name upstream, appending what comes back
+static dns_response_status_t resolve_upstream(dns_resolver_t* resolver, const char* name,
+                                              dns_record_type_t query_type, result_list_t* list) {
+    if (!resolver->config.enable_recursive_resolution) {
+        dlog("External domain %s requested but recursive resolution disabled", name);
+        log_dns_error("recursive resolution disabled", name, DNS_STATUS_REFUSED);
+        return DNS_STATUS_REFUSED;
+    }
+    dlog("Resolving external domain: %s", name);
+    
+    // Use enhanced external DNS resolution with fallback
+    dns_record_t* records = NULL;
+    int record_count = 0;
+    uint64_t trace_start = query_trace_stage_start();
+    dns_response_status_t ext_status = resolve_external_dns_with_fallback(name, query_type, &records, &record_count);
+    query_trace_stage_end(TRACE_STAGE_UPSTREAM_WAIT, trace_start);
+    
+    if (ext_status == DNS_STATUS_SUCCESS) {
+        // Cache successful external results
+        int rv = 0;
+        for (int i = 0; i < record_count && rv == 0; i++) {
+            add_to_dns_cache(resolver, name, &records[i]);
+            rv = result_append(list, &records[i]);
         }
-        
-        // Copy the record
-        memcpy(*records, cached_record, sizeof(dns_record_t));
-        *record_count = 1;
-        
-        // Don't free the copied strings, as they're now owned by *records
-        free(cached_record);
-        
-        return DNS_STATUS_SUCCESS;
+        free_result_records(NULL, records, record_count);
+        return rv == 0 ? DNS_STATUS_SUCCESS : DNS_STATUS_SERVFAIL;
     }
+    log_dns_error("external resolution with fallback", name, ext_status);
     
-    if (cached_record) {
-        free_dns_record(cached_record);
+    // Attempt cache recovery if external resolution fails
+    if (ext_status == DNS_STATUS_SERVFAIL) {
+        dlog("External DNS failed, attempting cache recovery");
+        recover_dns_cache(resolver);
+        
+        // Try cache lookup again after recovery
+        if (result_reserve(list, 1) == 0 &&
+            cache_lookup(resolver, name, query_type, list->arena, &list->records[list->count]) > 0) {
+            dlog("Found cached record after cache recovery for %s", name);
+            list->count++;
+            return DNS_STATUS_SUCCESS;
+        }
     }
+    return ext_status;
+}
+
+// Resolves one name of a chain: appends its records of query_type or, for
+// an alias, its CNAME, setting *cname_target when the alias is to be followed
+static dns_response_status_t resolve_hop(dns_resolver_t* resolver, const char* name,
+                                         dns_record_type_t query_type, result_list_t* list,
+                                         const char** cname_target) {
+    *cname_target = NULL;
     
-    // Check if this is an external domain
-    if (is_external_domain(query_name, resolver->tld_manager)) {
-        // Handle external DNS resolution
-        if (resolver->config.enable_recursive_resolution) {
-            dlog("Resolving external domain: %s", query_name);
-            
-            // Use enhanced external DNS resolution with fallback
-            dns_response_status_t ext_status = resolve_external_dns_with_fallback(
-                query_name, query_type, records, record_count);
-            
-            if (ext_status != DNS_STATUS_SUCCESS) {
-                log_dns_error("external resolution with fallback", query_name, ext_status);
-                
-                // Attempt cache recovery if external resolution fails
-                if (ext_status == DNS_STATUS_SERVFAIL) {
-                    dlog("External DNS failed, attempting cache recovery");
-                    recover_dns_cache(resolver);
-                    
-                    // Try cache lookup again after recovery
-                    dns_record_t* recovered_record = NULL;
-                    int cache_recovery_result = lookup_in_dns_cache(resolver, query_name, query_type, &recovered_record);
-                    
-                    if (cache_recovery_result > 0 && recovered_record) {
-                        dlog("Found cached record after cache recovery for %s", query_name);
-                        *records = malloc(sizeof(dns_record_t));
-                        if (*records) {
-                            memcpy(*records, recovered_record, sizeof(dns_record_t));
-                            *record_count = 1;
-                            free(recovered_record);
-                            return DNS_STATUS_SUCCESS;
-                        }
-                        free_dns_record(recovered_record);
-                    }
-                }
-            } else {
-                // Cache successful external results
-                if (*records && *record_count > 0) {
-                    for (int i = 0; i < *record_count; i++) {
-                        add_to_dns_cache(resolver, query_name, &(*records)[i]);
-                    }
-                }
-            }
-            
-            return ext_status;
-        } else {
-            dlog("External domain %s requested but recursive resolution disabled", query_name);
-            log_dns_error("recursive resolution disabled", query_name, DNS_STATUS_REFUSED);
-            return DNS_STATUS_REFUSED;
-        }
+    // Check cache first
+    if (result_reserve(list, 1) != 0) return DNS_STATUS_SERVFAIL;
+    uint64_t trace_start = query_trace_stage_start();
+    int cache_result = cache_lookup(resolver, name, query_type, list->arena, &list->records[list->count]);
+    query_trace_stage_end(TRACE_STAGE_CACHE_LOOKUP, trace_start);
+    if (cache_result > 0) {
+        list->count++;
+        return DNS_STATUS_SUCCESS;
     }
     
-    // Continue with local resolution for domains managed by local TLD manager
-    // Parse the query name to extract TLD
+    // Parse the name once: its TLD decides between local and external resolution
     char hostname[MAX_DOMAIN_NAME_LEN];
     char domain[MAX_DOMAIN_NAME_LEN];
     char tld[MAX_DOMAIN_NAME_LEN];
     
-    if (parse_fqdn(query_name, hostname, sizeof(hostname), domain, sizeof(domain), tld, sizeof(tld)) != 0) {
-        dlog("Failed to parse FQDN: %s", query_name);
+    if (parse_fqdn(name, hostname, sizeof(hostname), domain, sizeof(domain), tld, sizeof(tld)) != 0) {
+        dlog("Failed to parse FQDN: %s", name);
         return DNS_STATUS_FORMERR;
     }
     
     // Lock the TLD manager for reading
+    trace_start = query_trace_stage_start();
     pthread_rwlock_rdlock(&resolver->tld_manager->lock);
     
     // Find the TLD
@@ -642,9 +835,10 @@ dns_response_status_t resolve_dns_query(dns_resolver_t* resolver,
     }
     
     if (!found_tld) {
+        // Not managed by the local TLD manager
         pthread_rwlock_unlock(&resolver->tld_manager->lock);
-        dlog("TLD not found: %s", tld);
-        return DNS_STATUS_NXDOMAIN;
+        query_trace_stage_end(TRACE_STAGE_TLD_LOOKUP, trace_start);
+        return resolve_upstream(resolver, name, query_type, list);
     }
     
     // Construct the local part of the domain for matching
@@ -667,226 +861,202 @@ dns_response_status_t resolve_dns_query(dns_resolver_t* resolver,
         }
     }
     
-    // Search for matching records in the TLD
-    dns_record_t* result_records = NULL;
-    int result_count = 0;
+    // Name lookup goes through the TLD index (snapshot base + delta);
+    // the returned records are borrowed and valid while the lock is held
     dns_response_status_t status = DNS_STATUS_NXDOMAIN;  // Default to not found
+    dns_record_t match_buf[16];
+    dns_record_t* matches = match_buf;
+    size_t match_count = tld_lookup_records(found_tld, local_part, match_buf, 16);
+    query_trace_stage_end(TRACE_STAGE_TLD_LOOKUP, trace_start);
+    if (match_count > 16) {
+        matches = result_alloc(list->arena, match_count * sizeof(dns_record_t));
+        if (!matches) {
+            pthread_rwlock_unlock(&resolver->tld_manager->lock);
+            return DNS_STATUS_SERVFAIL;
+        }
+        tld_lookup_records(found_tld, local_part, matches, match_count);
+    }
     
-    // First, look for exact matches
-    for (size_t i = 0; i < found_tld->record_count; ++i) {
-        // Check if the record name matches what we're looking for
-        if (strcmp(found_tld->records[i].name, local_part) == 0) {
-            // Found a record with matching name
-            
-            if (found_tld->records[i].type == query_type) {
-                // Exact match for the requested type
-                
-                // Allocate/reallocate the result array
-                dns_record_t* temp = realloc(result_records, (result_count + 1) * sizeof(dns_record_t));
-                if (!temp) {
-                    status = DNS_STATUS_SERVFAIL;
-                    goto cleanup;
-                }
-                result_records = temp;
-                
-                // Copy the record
-                dns_record_t* new_record = &result_records[result_count];
-                
-                new_record->name = strdup(found_tld->records[i].name);
-                if (!new_record->name) {
-                    status = DNS_STATUS_SERVFAIL;
-                    goto cleanup;
-                }
-                
-                new_record->rdata = strdup(found_tld->records[i].rdata);
-                if (!new_record->rdata) {
-                    free(new_record->name);
-                    status = DNS_STATUS_SERVFAIL;
-                    goto cleanup;
-                }
-                
-                new_record->type = found_tld->records[i].type;
-                new_record->ttl = found_tld->records[i].ttl;
-                new_record->last_updated = found_tld->records[i].last_updated;
-                
-                result_count++;
-                status = DNS_STATUS_SUCCESS;
-                
-                // Cache the result
-                add_to_dns_cache(resolver, query_name, new_record);
+    // Each match adds at most one record
+    const dns_record_t* cname = NULL;
+    if (result_reserve(list, match_count) != 0) status = DNS_STATUS_SERVFAIL;
+    for (size_t i = 0; i < match_count && status != DNS_STATUS_SERVFAIL; ++i) {
+        if (matches[i].type == query_type) {
+            if (result_append(list, &matches[i]) != 0) {
+                status = DNS_STATUS_SERVFAIL;
+                break;
             }
-            else if (found_tld->records[i].type == DNS_RECORD_TYPE_CNAME && 
-                     query_type != DNS_RECORD_TYPE_CNAME) {
-                // CNAME found, need to follow it
-                
-                // Check if recursive resolution is enabled
-                if (resolver->config.enable_recursive_resolution) {
-                    // Save the CNAME record
-                    dns_record_t* cname_record = malloc(sizeof(dns_record_t));
-                    if (!cname_record) {
-                        status = DNS_STATUS_SERVFAIL;
-                        goto cleanup;
-                    }
-                    
-                    cname_record->name = strdup(found_tld->records[i].name);
-                    if (!cname_record->name) {
-                        free(cname_record);
-                        status = DNS_STATUS_SERVFAIL;
-                        goto cleanup;
-                    }
-                    
-                    cname_record->rdata = strdup(found_tld->records[i].rdata);
-                    if (!cname_record->rdata) {
-                        free(cname_record->name);
-                        free(cname_record);
-                        status = DNS_STATUS_SERVFAIL;
-                        goto cleanup;
-                    }
-                    
-                    cname_record->type = DNS_RECORD_TYPE_CNAME;
-                    cname_record->ttl = found_tld->records[i].ttl;
-                    cname_record->last_updated = found_tld->records[i].last_updated;
-                    
-                    // Add the CNAME record to the results
-                    dns_record_t* temp = realloc(result_records, (result_count + 1) * sizeof(dns_record_t));
-                    if (!temp) {
-                        free(cname_record->name);
-                        free(cname_record->rdata);
-                        free(cname_record);
-                        status = DNS_STATUS_SERVFAIL;
-                        goto cleanup;
-                    }
-                    result_records = temp;
-                    
-                    // Copy the record
-                    memcpy(&result_records[result_count], cname_record, sizeof(dns_record_t));
-                    result_count++;
-                    
-                    // Free the temporary record (strings are now owned by result_records)
-                    free(cname_record);
-                    
-                    // Cache the CNAME record
-                    add_to_dns_cache(resolver, query_name, &result_records[result_count - 1]);
-                    
-                    // Follow the CNAME
-                    dns_record_t* cname_target_records = NULL;
-                    int cname_target_count = 0;
-                    
-                    dns_response_status_t cname_status = resolve_cname(
-                        resolver,
-                        result_records[result_count - 1].rdata,  // CNAME target
-                        query_type,                              // Original query type
-                        &cname_target_records,
-                        &cname_target_count,
-                        1                                        // Initial recursion depth
-                    );
-                    
-                    if (cname_status == DNS_STATUS_SUCCESS && cname_target_records && cname_target_count > 0) {
-                        // Add the target records to the results
-                        temp = realloc(result_records, 
-                                      (result_count + cname_target_count) * sizeof(dns_record_t));
-                        if (!temp) {
-                            // Free the CNAME target records
-                            for (int j = 0; j < cname_target_count; j++) {
-                                free(cname_target_records[j].name);
-                                free(cname_target_records[j].rdata);
-                            }
-                            free(cname_target_records);
-                            
-                            status = DNS_STATUS_SERVFAIL;
-                            goto cleanup;
-                        }
-                        
-                        result_records = temp;
-                        
-                        // Copy the records
-                        for (int j = 0; j < cname_target_count; j++) {
-                            memcpy(&result_records[result_count + j], 
-                                   &cname_target_records[j], 
-                                   sizeof(dns_record_t));
-                        }
-                        
-                        result_count += cname_target_count;
-                        
-                        // Free the array but not the strings, as they're now owned by result_records
-                        free(cname_target_records);
-                        
-                        status = DNS_STATUS_SUCCESS;
-                    } else {
-                        // Failed to resolve CNAME target
-                        if (cname_target_records) {
-                            for (int j = 0; j < cname_target_count; j++) {
-                                free(cname_target_records[j].name);
-                                free(cname_target_records[j].rdata);
-                            }
-                            free(cname_target_records);
-                        }
-                        
-                        // We still return the CNAME record
-                        status = DNS_STATUS_SUCCESS;
-                    }
-                } else {
-                    // Recursive resolution disabled, just return the CNAME
-                    dns_record_t* temp = realloc(result_records, (result_count + 1) * sizeof(dns_record_t));
-                    if (!temp) {
-                        status = DNS_STATUS_SERVFAIL;
-                        goto cleanup;
-                    }
-                    result_records = temp;
-                    
-                    // Copy the record
-                    dns_record_t* new_record = &result_records[result_count];
-                    
-                    new_record->name = strdup(found_tld->records[i].name);
-                    if (!new_record->name) {
-                        status = DNS_STATUS_SERVFAIL;
-                        goto cleanup;
-                    }
-                    
-                    new_record->rdata = strdup(found_tld->records[i].rdata);
-                    if (!new_record->rdata) {
-                        free(new_record->name);
-                        status = DNS_STATUS_SERVFAIL;
-                        goto cleanup;
-                    }
-                    
-                    new_record->type = DNS_RECORD_TYPE_CNAME;
-                    new_record->ttl = found_tld->records[i].ttl;
-                    new_record->last_updated = found_tld->records[i].last_updated;
-                    
-                    result_count++;
-                    status = DNS_STATUS_SUCCESS;
-                    
-                    // Cache the result
-                    add_to_dns_cache(resolver, query_name, new_record);
-                }
+            add_to_dns_cache(resolver, name, &list->records[list->count - 1]);
+            status = DNS_STATUS_SUCCESS;
+        } else if (matches[i].type == DNS_RECORD_TYPE_CNAME && query_type != DNS_RECORD_TYPE_CNAME && !cname) {
+            cname = &matches[i];
+        }
+    }
+    
+    // An alias answers with its CNAME, followed unless recursion is off
+    if (status == DNS_STATUS_NXDOMAIN && cname) {
+        if (result_append(list, cname) != 0) {
+            status = DNS_STATUS_SERVFAIL;
+        } else {
+            add_to_dns_cache(resolver, name, &list->records[list->count - 1]);
+            status = DNS_STATUS_SUCCESS;
+            if (resolver->config.enable_recursive_resolution) {
+                *cname_target = list->records[list->count - 1].rdata;
             }
         }
     }
     
-    // If we found records, we're done
-    if (status == DNS_STATUS_SUCCESS && result_count > 0) {
-        *records = result_records;
-        *record_count = result_count;
-        pthread_rwlock_unlock(&resolver->tld_manager->lock);
-        return status;
+    if (matches != match_buf) result_free(list->arena, matches);
+    pthread_rwlock_unlock(&resolver->tld_manager->lock);
+    return status;
+}
+
+// Whether a chain starting at query_name has already been to target
+static int chain_visited(const result_list_t* list, const char* query_name, const char* target) {
+    if (strcasecmp(query_name, target) == 0) return 1;
+    // The last record is the CNAME pointing at target itself
+    for (int i = 0; i < list->count - 1; i++) {
+        if (list->records[i].type == DNS_RECORD_TYPE_CNAME && strcasecmp(list->records[i].rdata, target) == 0) {
+            return 1;
+        }
     }
+    return 0;
+}
+
+// Follows CNAMEs from query_name one hop at a time, at most max_hops of
+// them. A loop or a longer chain is a SERVFAIL; a target that does not
+// resolve leaves the CNAMEs found so far as the answer.
+static dns_response_status_t resolve_chain(dns_resolver_t* resolver, 
+                                           const char* query_name, 
+                                           dns_record_type_t query_type,
+                                           query_arena_t* arena,
+                                           dns_record_t** records,
+                                           int* record_count,
+                                           int max_hops) {
+    if (!resolver || !query_name || !records || !record_count) 
+        return DNS_STATUS_SERVFAIL;
+    
+    // Initialize output parameters
+    *records = NULL;
+    *record_count = 0;
+    
+    result_list_t list = { .arena = arena };
     
-cleanup:
-    // Clean up if we had an error or found no records
-    if (result_records) {
-        for (int i = 0; i < result_count; i++) {
-            free(result_records[i].name);
-            free(result_records[i].rdata);
+    // A flattened chain answers an alias in one lookup
+    if (chain_cache_lookup(resolver, query_name, query_type, &list) > 0) {
+        *records = list.records;
+        *record_count = list.count;
+        return DNS_STATUS_SUCCESS;
+    }
+    // Read before walking, so a chain resolved across a change is not cached
+    uint64_t generation = chain_cache_generation(resolver);
+    
+    const char* name = query_name;
+    int hops = 0;
+    dns_response_status_t status;
+    for (;;) {
+        const char* target = NULL;
+        uint64_t trace_start = hops > 0 ? query_trace_stage_start() : 0;
+        status = resolve_hop(resolver, name, query_type, &list, &target);
+        if (hops > 0) query_trace_stage_end(TRACE_STAGE_CNAME_FOLLOW, trace_start);
+        
+        if (status != DNS_STATUS_SUCCESS) {
+            if (hops > 0) {
+                // Failed to resolve CNAME target; we still return the CNAMEs
+                dlog("CNAME target %s did not resolve (%d)", name, status);
+                status = DNS_STATUS_SUCCESS;
+            }
+            break;
+        }
+        if (!target) break;
+        
+        if (chain_visited(&list, query_name, target)) {
+            log_warn("CNAME loop at %s while resolving %s", target, query_name);
+            status = DNS_STATUS_SERVFAIL;
+            break;
+        }
+        if (hops >= max_hops) {
+            dlog("Maximum CNAME chain length reached (%d) for %s", max_hops, query_name);
+            status = DNS_STATUS_SERVFAIL;
+            break;
         }
-        free(result_records);
+        hops++;
+        name = target;
     }
     
-    pthread_rwlock_unlock(&resolver->tld_manager->lock);
+    if (status != DNS_STATUS_SUCCESS) {
+        free_result_records(arena, list.records, list.count);
+        return status;
+    }
+    
+    // A chain that reached records of the queried type is cached whole
+    if (hops > 0 && list.records[list.count - 1].type == query_type) {
+        chain_cache_insert(resolver, generation, query_name, query_type, list.records, list.count);
+    }
+    
+    *records = list.records;
+    *record_count = list.count;
+    return status;
+}
+
+dns_response_status_t resolve_cname(dns_resolver_t* resolver,
+                                 const char* cname_target,
+                                 dns_record_type_t target_type,
+                                 dns_record_t** records,
+                                 int* record_count,
+                                 int recursion_depth) {
+    if (!resolver || !cname_target || !records || !record_count) 
+        return DNS_STATUS_SERVFAIL;
+    
+    // Check recursion depth
+    if (recursion_depth >= resolver->config.max_recursion_depth) {
+        dlog("Maximum CNAME recursion depth reached (%d)", recursion_depth);
+        return DNS_STATUS_SERVFAIL;
+    }
     
+    // The hops already taken count against the chain's budget
+    return resolve_chain(resolver, cname_target, target_type, NULL, records, record_count,
+                         resolver->config.max_recursion_depth - recursion_depth);
+}
+
+static dns_response_status_t resolve_and_count(dns_resolver_t* resolver, 
+                                               const char* query_name, 
+                                               dns_record_type_t query_type,
+                                               query_arena_t* arena,
+                                               dns_record_t** records,
+                                               int* record_count) {
+    uint64_t start = metrics_now_us();
+    dns_response_status_t status = resolve_chain(resolver, query_name, query_type, arena, records, record_count,
+                                                 resolver ? resolver->config.max_recursion_depth : 0);
+    
+    metrics_inc(METRIC_DNS_QUERIES);
+    if (status == DNS_STATUS_NXDOMAIN) {
+        metrics_inc(METRIC_DNS_NXDOMAIN);
+    } else if (status != DNS_STATUS_SUCCESS) {
+        metrics_inc(METRIC_DNS_FAILURES);
+    }
+    metrics_observe_us(METRIC_RESOLVE_LATENCY, metrics_now_us() - start);
     return status;
 }
 
+dns_response_status_t resolve_dns_query(dns_resolver_t* resolver, 
+                                     const char* query_name, 
+                                     dns_record_type_t query_type,
+                                     dns_record_t** records,
+                                     int* record_count) {
+    return resolve_and_count(resolver, query_name, query_type, NULL, records, record_count);
+}
+
+dns_response_status_t resolve_dns_query_in_arena(dns_resolver_t* resolver,
+                                                const char* query_name,
+                                                dns_record_type_t query_type,
+                                                query_arena_t* arena,
+                                                dns_record_t** records,
+                                                int* record_count) {
+    if (!arena) return DNS_STATUS_SERVFAIL;
+    return resolve_and_count(resolver, query_name, query_type, arena, records, record_count);
+}
+
 // Helper function to validate record data based on type
 static int validate_record_data(dns_record_type_t type, const char* rdata) {
     if (!rdata) return 0;
@@ -1006,25 +1176,15 @@ int add_record_to_tld(tld_manager_t* tld_manager, const char* tld_name,
         return -1;
     }
     
-    // Add to TLD records array
-    dns_record_t* temp = realloc(found_tld->records, 
-                                (found_tld->record_count + 1) * sizeof(dns_record_t));
-    if (!temp) {
-        free_dns_record(new_record);
+    // Go through the TLD manager so the record is reflected in the TLD's
+    // Merkle summary (and any other per-mutation bookkeeping).
+    int add_result = add_dns_record_to_tld(found_tld, new_record);
+    free_dns_record(new_record);
+    if (add_result != 0) {
         pthread_rwlock_unlock(&tld_manager->lock);
         return -1;
     }
     
-    found_tld->records = temp;
-    
-    // Copy the record data
-    memcpy(&found_tld->records[found_tld->record_count], new_record, sizeof(dns_record_t));
-    found_tld->record_count++;
-    found_tld->last_modified = time(NULL);
-    
-    // Free the temporary record structure (strings are now owned by TLD)
-    free(new_record);
-    
     pthread_rwlock_unlock(&tld_manager->lock);
     
     dlog("Added %s record '%s' -> '%s' to TLD '%s'", 
@@ -1033,33 +1193,6 @@ int add_record_to_tld(tld_manager_t* tld_manager, const char* tld_name,
     return 0;
 }
 
-// Check if a domain is external (not managed by local TLD manager)
-static int is_external_domain(const char* query_name, tld_manager_t* tld_manager) {
-    if (!query_name || !tld_manager) return 1; // Assume external if invalid input
-    
-    // Parse the query name to extract TLD
-    char hostname[MAX_DOMAIN_NAME_LEN];
-    char domain[MAX_DOMAIN_NAME_LEN];
-    char tld[MAX_DOMAIN_NAME_LEN];
-    
-    if (parse_fqdn(query_name, hostname, sizeof(hostname), domain, sizeof(domain), tld, sizeof(tld)) != 0) {
-        return 1; // Assume external if parsing fails
-    }
-    
-    // Check if the TLD is managed locally
-    pthread_rwlock_rdlock(&tld_manager->lock);
-    
-    for (size_t i = 0; i < tld_manager->tld_count; ++i) {
-        if (strcmp(tld_manager->tlds[i]->name, tld) == 0) {
-            pthread_rwlock_unlock(&tld_manager->lock);
-            return 0; // Local domain
-        }
-    }
-    
-    pthread_rwlock_unlock(&tld_manager->lock);
-    return 1; // External domain
-}
-
 // Resolve external DNS queries using system resolver
 static dns_response_status_t resolve_external_dns(const char* query_name, 
                                                  dns_record_type_t query_type,
@@ -1094,8 +1227,12 @@ static dns_response_status_t resolve_external_dns(const char* query_name,
     
     hints.ai_socktype = SOCK_STREAM;
     
+    metrics_inc(METRIC_UPSTREAM_QUERIES);
+    uint64_t start = metrics_now_us();
     int status = getaddrinfo(query_name, NULL, &hints, &result);
+    metrics_observe_us(METRIC_UPSTREAM_RTT, metrics_now_us() - start);
     if (status != 0) {
+        metrics_inc(METRIC_UPSTREAM_FAILURES);
         dlog("External DNS resolution failed for %s: %s", query_name, gai_strerror(status));
         return DNS_STATUS_NXDOMAIN;
     }
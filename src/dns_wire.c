@@ -0,0 +1,344 @@
+#include "../include/dns_wire.h"
+#include <string.h>
+#include <stdio.h>
+#include <arpa/inet.h>
+
+#define WIRE_NO_SPACE -2
+#define WIRE_MAX_NAME 255
+#define WIRE_MAX_LABEL 63
+#define WIRE_MAX_POINTER 0x3FFF
+#define WIRE_COMPRESSED_NAMES 8
+
+// Names already in the message that later owners can point at
+typedef struct {
+    const char* name;
+    size_t len;
+    uint16_t offset;
+} wire_name_t;
+
+typedef struct {
+    uint8_t* buf;
+    size_t pos;
+    size_t limit;                   // Space for the answer, the OPT record excluded
+    wire_name_t names[WIRE_COMPRESSED_NAMES];
+    int name_count;
+} wire_writer_t;
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Question names must be uncompressed; returns the offset after the name
+static int parse_question_name(const uint8_t* msg, size_t len, size_t off, char* out, size_t out_len) {
+    size_t n = 0;
+    size_t wire_len = 0;
+    for (;;) {
+        if (off >= len) return -1;
+        uint8_t label = msg[off++];
+        if (label == 0) break;
+        if (label > WIRE_MAX_LABEL || off + label > len) return -1;
+        wire_len += (size_t)label + 1;
+        if (wire_len + 1 > WIRE_MAX_NAME) return -1;
+        if (n > 0) out[n++] = '.';
+        for (uint8_t i = 0; i < label; i++) {
+            uint8_t c = msg[off++];
+            // Dots and control bytes inside a label have no string form here
+            if (c == '.' || c <= 0x20 || c >= 0x7F) return -1;
+            if (c >= 'A' && c <= 'Z') c = (uint8_t)(c - 'A' + 'a');
+            out[n++] = (char)c;
+        }
+    }
+    if (n >= out_len) return -1;
+    out[n] = '\0';
+    return (int)off;
+}
+
+// Skips a possibly compressed name in a resource record
+static int skip_name(const uint8_t* msg, size_t len, size_t off) {
+    for (;;) {
+        if (off >= len) return -1;
+        uint8_t label = msg[off];
+        if ((label & 0xC0) == 0xC0) return off + 2 <= len ? (int)(off + 2) : -1;
+        if (label > WIRE_MAX_LABEL) return -1;
+        off += (size_t)label + 1;
+        if (label == 0) return (int)off;
+    }
+}
+
+int dns_wire_parse_query(const uint8_t* msg, size_t len, dns_wire_query_t* query) {
+    if (!msg || !query || len < DNS_WIRE_HEADER_LEN) return -1;
+    memset(query, 0, sizeof(*query));
+    query->id = get16(msg);
+    query->flags = get16(msg + 2);
+    if (query->flags & DNS_WIRE_FLAG_QR) return -1;
+
+    uint16_t qdcount = get16(msg + 4);
+    uint16_t ancount = get16(msg + 6);
+    uint16_t nscount = get16(msg + 8);
+    uint16_t arcount = get16(msg + 10);
+    if (qdcount != 1) return DNS_STATUS_FORMERR;
+
+    int off = parse_question_name(msg, len, DNS_WIRE_HEADER_LEN, query->qname, sizeof(query->qname));
+    if (off < 0 || (size_t)off + 4 > len) return DNS_STATUS_FORMERR;
+    query->qtype = get16(msg + off);
+    query->qclass = get16(msg + off + 2);
+    off += 4;
+    query->question = msg + DNS_WIRE_HEADER_LEN;
+    query->question_len = (size_t)off - DNS_WIRE_HEADER_LEN;
+
+    if (DNS_WIRE_OPCODE(query->flags) != 0) return DNS_STATUS_NOTIMP;
+
+    // Queries carry no answers, but skip any rather than misread the OPT
+    for (uint32_t i = 0; i < (uint32_t)ancount + nscount + arcount; i++) {
+        int name_start = off;
+        off = skip_name(msg, len, (size_t)off);
+        if (off < 0 || (size_t)off + 10 > len) return DNS_STATUS_FORMERR;
+        uint16_t type = get16(msg + off);
+        uint16_t rr_class = get16(msg + off + 2);
+        uint32_t ttl = ((uint32_t)get16(msg + off + 4) << 16) | get16(msg + off + 6);
+        uint16_t rdlen = get16(msg + off + 8);
+        off += 10;
+        if ((size_t)off + rdlen > len) return DNS_STATUS_FORMERR;
+        off += rdlen;
+
+        if (i >= (uint32_t)ancount + nscount && type == DNS_WIRE_TYPE_OPT) {
+            // One OPT, owned by the root (RFC 6891 section 6.1.1)
+            if (query->has_edns || msg[name_start] != 0) return DNS_STATUS_FORMERR;
+            query->has_edns = 1;
+            query->edns_udp_size = rr_class < DNS_WIRE_CLASSIC_UDP_SIZE ? DNS_WIRE_CLASSIC_UDP_SIZE : rr_class;
+            query->edns_version = (uint8_t)(ttl >> 16);
+        }
+    }
+    if (query->has_edns && query->edns_version != 0) return DNS_WIRE_RCODE_BADVERS;
+    return 0;
+}
+
+int dns_wire_type_supported(uint16_t qtype) {
+    switch (qtype) {
+        case DNS_RECORD_TYPE_A:
+        case DNS_RECORD_TYPE_AAAA:
+        case DNS_RECORD_TYPE_TXT:
+        case DNS_RECORD_TYPE_MX:
+        case DNS_RECORD_TYPE_CNAME:
+        case DNS_RECORD_TYPE_SRV:
+        case DNS_RECORD_TYPE_PTR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Presentation-form length without a trailing dot
+static size_t name_length(const char* name, size_t len) {
+    return len > 0 && name[len - 1] == '.' ? len - 1 : len;
+}
+
+static int names_equal(const char* a, size_t a_len, const char* b, size_t b_len) {
+    if (a_len != b_len) return 0;
+    for (size_t i = 0; i < a_len; i++) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x = (char)(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z') y = (char)(y - 'A' + 'a');
+        if (x != y) return 0;
+    }
+    return 1;
+}
+
+static int write_bytes(wire_writer_t* w, const void* data, size_t len) {
+    if (w->pos + len > w->limit) return WIRE_NO_SPACE;
+    memcpy(w->buf + w->pos, data, len);
+    w->pos += len;
+    return 0;
+}
+
+static int write_u16(wire_writer_t* w, uint16_t v) {
+    if (w->pos + 2 > w->limit) return WIRE_NO_SPACE;
+    put16(w->buf + w->pos, v);
+    w->pos += 2;
+    return 0;
+}
+
+static void remember_name(wire_writer_t* w, const char* name, size_t len, size_t offset) {
+    if (w->name_count >= WIRE_COMPRESSED_NAMES || offset > WIRE_MAX_POINTER) return;
+    w->names[w->name_count].name = name;
+    w->names[w->name_count].len = len;
+    w->names[w->name_count].offset = (uint16_t)offset;
+    w->name_count++;
+}
+
+// Writes name as labels, or as a pointer to an identical earlier name.
+// Returns 0, -1 for a name that cannot be encoded or WIRE_NO_SPACE.
+static int write_name(wire_writer_t* w, const char* name, size_t len, int compress) {
+    len = name_length(name, len);
+    if (compress) {
+        for (int i = 0; i < w->name_count; i++) {
+            if (names_equal(w->names[i].name, w->names[i].len, name, len)) {
+                return write_u16(w, (uint16_t)(0xC000 | w->names[i].offset));
+            }
+        }
+    }
+    if (len > 0 && len + 2 > WIRE_MAX_NAME) return -1;
+
+    size_t start = w->pos;
+    size_t label_start = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (i < len && name[i] != '.') continue;
+        size_t label_len = i - label_start;
+        if (label_len == 0 && len > 0) return -1;
+        if (label_len > WIRE_MAX_LABEL) return -1;
+        if (label_len > 0) {
+            if (w->pos + 1 + label_len > w->limit) return WIRE_NO_SPACE;
+            w->buf[w->pos++] = (uint8_t)label_len;
+            memcpy(w->buf + w->pos, name + label_start, label_len);
+            w->pos += label_len;
+        }
+        label_start = i + 1;
+    }
+    if (w->pos + 1 > w->limit) return WIRE_NO_SPACE;
+    w->buf[w->pos++] = 0;
+    if (len > 0) remember_name(w, name, len, start);
+    return 0;
+}
+
+// Record data as the resolver stores it (see validate_record_data)
+static int write_rdata(wire_writer_t* w, const dns_record_t* record) {
+    const char* rdata = record->rdata;
+    switch (record->type) {
+        case DNS_RECORD_TYPE_A: {
+            uint8_t addr[4];
+            if (inet_pton(AF_INET, rdata, addr) != 1) return -1;
+            return write_bytes(w, addr, sizeof(addr));
+        }
+        case DNS_RECORD_TYPE_AAAA: {
+            uint8_t addr[16];
+            if (inet_pton(AF_INET6, rdata, addr) != 1) return -1;
+            return write_bytes(w, addr, sizeof(addr));
+        }
+        case DNS_RECORD_TYPE_CNAME:
+        case DNS_RECORD_TYPE_PTR:
+            return write_name(w, rdata, strlen(rdata), 0);
+        case DNS_RECORD_TYPE_MX: {
+            unsigned preference;
+            int host_off = 0;
+            if (sscanf(rdata, "%u %n", &preference, &host_off) != 1 || host_off == 0 || preference > 0xFFFF) return -1;
+            int rv = write_u16(w, (uint16_t)preference);
+            return rv != 0 ? rv : write_name(w, rdata + host_off, strcspn(rdata + host_off, " "), 0);
+        }
+        case DNS_RECORD_TYPE_SRV: {
+            unsigned priority, weight, port;
+            int target_off = 0;
+            if (sscanf(rdata, "%u %u %u %n", &priority, &weight, &port, &target_off) != 3 || target_off == 0 ||
+                priority > 0xFFFF || weight > 0xFFFF || port > 0xFFFF) {
+                return -1;
+            }
+            int rv = write_u16(w, (uint16_t)priority);
+            if (rv == 0) rv = write_u16(w, (uint16_t)weight);
+            if (rv == 0) rv = write_u16(w, (uint16_t)port);
+            return rv != 0 ? rv : write_name(w, rdata + target_off, strcspn(rdata + target_off, " "), 0);
+        }
+        case DNS_RECORD_TYPE_TXT: {
+            // One or more character-strings of at most 255 bytes
+            size_t len = strlen(rdata);
+            size_t off = 0;
+            do {
+                size_t chunk = len - off > 255 ? 255 : len - off;
+                if (w->pos + 1 + chunk > w->limit) return WIRE_NO_SPACE;
+                w->buf[w->pos++] = (uint8_t)chunk;
+                memcpy(w->buf + w->pos, rdata + off, chunk);
+                w->pos += chunk;
+                off += chunk;
+            } while (off < len);
+            return 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+static int write_record(wire_writer_t* w, const dns_record_t* record, const char* owner, size_t owner_len) {
+    int rv = write_name(w, owner, owner_len, 1);
+    if (rv != 0) return rv;
+    if (w->pos + 10 > w->limit) return WIRE_NO_SPACE;
+    put16(w->buf + w->pos, (uint16_t)record->type);
+    put16(w->buf + w->pos + 2, DNS_WIRE_CLASS_IN);
+    put32(w->buf + w->pos + 4, record->ttl);
+    size_t rdlen_pos = w->pos + 8;
+    w->pos += 10;
+
+    size_t rdata_start = w->pos;
+    rv = write_rdata(w, record);
+    if (rv != 0) return rv;
+    put16(w->buf + rdlen_pos, (uint16_t)(w->pos - rdata_start));
+    return 0;
+}
+
+ssize_t dns_wire_build_response(const dns_wire_query_t* query, int rcode, int recursion_available,
+                                const dns_record_t* records, int record_count,
+                                uint16_t edns_udp_size, uint8_t* buf, size_t max_len) {
+    if (!query || !buf || (record_count > 0 && !records)) return -1;
+    size_t reserve = query->has_edns ? DNS_WIRE_OPT_RR_LEN : 0;
+    size_t question_end = DNS_WIRE_HEADER_LEN + query->question_len;
+    if (max_len > DNS_WIRE_MAX_MESSAGE) max_len = DNS_WIRE_MAX_MESSAGE;
+    if (question_end + reserve > max_len) return -1;
+
+    wire_writer_t w = { .buf = buf, .pos = question_end, .limit = max_len - reserve };
+    if (query->question_len > 0) {
+        memcpy(buf + DNS_WIRE_HEADER_LEN, query->question, query->question_len);
+        remember_name(&w, query->qname, strlen(query->qname), DNS_WIRE_HEADER_LEN);
+    }
+
+    int truncated = 0;
+    uint16_t answers = 0;
+    const char* owner = query->qname;
+    size_t owner_len = strlen(query->qname);
+    for (int i = 0; i < record_count && rcode == 0; i++) {
+        const dns_record_t* record = &records[i];
+        if (!record->rdata) return -1;
+        int rv = write_record(&w, record, owner, owner_len);
+        if (rv == WIRE_NO_SPACE || answers == 0xFFFF) {
+            truncated = 1;
+            answers = 0;
+            w.pos = question_end;
+            break;
+        }
+        if (rv != 0) return -1;
+        answers++;
+        if (record->type == DNS_RECORD_TYPE_CNAME) {
+            owner = record->rdata;
+            owner_len = strlen(record->rdata);
+        }
+    }
+
+    uint16_t flags = DNS_WIRE_FLAG_QR | (query->flags & (0x7800 | DNS_WIRE_FLAG_RD)) | (rcode & 0x0F);
+    if (recursion_available) flags |= DNS_WIRE_FLAG_RA;
+    if (truncated) flags |= DNS_WIRE_FLAG_TC;
+    put16(buf, query->id);
+    put16(buf + 2, flags);
+    put16(buf + 4, query->question_len > 0 ? 1 : 0);
+    put16(buf + 6, answers);
+    put16(buf + 8, 0);
+    put16(buf + 10, query->has_edns ? 1 : 0);
+
+    if (query->has_edns) {
+        uint8_t* opt = buf + w.pos;
+        opt[0] = 0;                                         // Root owner
+        put16(opt + 1, DNS_WIRE_TYPE_OPT);
+        put16(opt + 3, edns_udp_size < DNS_WIRE_CLASSIC_UDP_SIZE ? DNS_WIRE_CLASSIC_UDP_SIZE : edns_udp_size);
+        put32(opt + 5, (uint32_t)((rcode >> 4) & 0xFF) << 24);  // Extended RCODE, version 0, no flags
+        put16(opt + 9, 0);
+        w.pos += DNS_WIRE_OPT_RR_LEN;
+    }
+    return (ssize_t)w.pos;
+}
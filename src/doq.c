@@ -0,0 +1,82 @@
+#include "../include/doq.h"
+#include "../include/dns_frontend.h"
+#include "../include/dns_wire.h"
+#include <stdlib.h>
+#include <string.h>
+
+int init_doq_stream(doq_stream_t** stream_out) {
+    if (!stream_out) return -1;
+    *stream_out = calloc(1, sizeof(doq_stream_t));
+    return *stream_out ? 0 : -1;
+}
+
+void cleanup_doq_stream(doq_stream_t* stream) {
+    if (!stream) return;
+    free(stream->request);
+    free(stream->response);
+    free(stream);
+}
+
+int doq_alpn_selected(const unsigned char* alpn, unsigned int alpn_len) {
+    return alpn && alpn_len == DOQ_ALPN_LEN && memcmp(alpn, DOQ_ALPN, DOQ_ALPN_LEN) == 0;
+}
+
+int doq_stream_receive(doq_stream_t* stream, const uint8_t* data, size_t len, int fin) {
+    if (!stream || (len > 0 && !data)) return -1;
+    // Only the client's FIN may follow its query
+    if (stream->answered) return len > 0 ? -1 : DOQ_STREAM_INCOMPLETE;
+
+    size_t off = 0;
+    while (stream->request_len < 2 && off < len) {
+        stream->length_prefix[stream->request_len++] = data[off++];
+    }
+    if (stream->request_len == 2 && !stream->request) {
+        size_t message_len = (size_t)stream->length_prefix[0] << 8 | stream->length_prefix[1];
+        if (message_len == 0) return -1;
+        stream->request_size = 2 + message_len;
+        stream->request = malloc(stream->request_size);
+        if (!stream->request) return -1;
+        memcpy(stream->request, stream->length_prefix, 2);
+    }
+
+    if (stream->request && len > off) {
+        // One message per stream (RFC 9250 section 4.2)
+        if (len - off > stream->request_size - stream->request_len) return -1;
+        memcpy(stream->request + stream->request_len, data + off, len - off);
+        stream->request_len += len - off;
+    }
+    if (stream->request && stream->request_len == stream->request_size) return DOQ_STREAM_READY;
+    return fin ? -1 : DOQ_STREAM_INCOMPLETE;
+}
+
+int doq_stream_answer(doq_stream_t* stream, dns_resolver_t* resolver) {
+    if (!stream || !stream->request || stream->request_len != stream->request_size || stream->answered) {
+        return DOQ_INTERNAL_ERROR;
+    }
+    const uint8_t* query = stream->request + 2;
+    size_t query_len = stream->request_size - 2;
+
+    // The Message ID must be 0 (RFC 9250 section 4.2.1)
+    if (query_len < 2 || query[0] != 0 || query[1] != 0) return DOQ_PROTOCOL_ERROR;
+
+    uint8_t* response = malloc(2 + DNS_WIRE_MAX_MESSAGE);
+    if (!response) return DOQ_INTERNAL_ERROR;
+    ssize_t len = dns_frontend_answer(resolver, query, query_len, 0, response + 2, DNS_WIRE_MAX_MESSAGE);
+    if (len < 0) {
+        free(response);
+        return DOQ_PROTOCOL_ERROR;
+    }
+    response[0] = (uint8_t)(len >> 8);
+    response[1] = (uint8_t)len;
+
+    // Keep only what the answer uses until the stream closes
+    uint8_t* shrunk = realloc(response, 2 + (size_t)len);
+    if (shrunk) response = shrunk;
+
+    stream->response = response;
+    stream->response_len = 2 + (size_t)len;
+    stream->answered = 1;
+    free(stream->request);
+    stream->request = NULL;
+    return 0;
+}
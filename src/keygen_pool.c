@@ -0,0 +1,263 @@
+#include "../include/keygen_pool.h"
+#include "../include/certificate_authority.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+typedef struct {
+    uint8_t public_key[FALCON_PUBKEY_SIZE_1024];
+    uint8_t private_key[FALCON_PRIVKEY_SIZE_1024];
+} falcon_keypair_t;
+
+struct keygen_pool_s {
+    falcon_keypair_t* falcon;
+    size_t falcon_count;
+    size_t falcon_pending;      // Being generated by a worker right now
+    size_t falcon_target;
+    EVP_PKEY** rsa;
+    size_t rsa_count;
+    size_t rsa_pending;
+    size_t rsa_target;
+    pthread_t* workers;
+    int worker_count;
+    int running;
+    uint64_t hits;
+    uint64_t misses;
+    pthread_mutex_t lock;
+    pthread_cond_t refill;      // Signalled when a key is taken
+    pthread_cond_t filled;      // Signalled when a key is added
+};
+
+static keygen_pool_t* default_pool = NULL;
+static pthread_mutex_t default_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static EVP_PKEY* generate_rsa_key(void) {
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    if (!ctx) {
+        return NULL;
+    }
+
+    EVP_PKEY *pkey = NULL;
+    if (EVP_PKEY_keygen_init(ctx) <= 0 ||
+        EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, KEYGEN_RSA_BITS) <= 0 ||
+        EVP_PKEY_keygen(ctx, &pkey) <= 0) {
+        pkey = NULL;
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return pkey;
+}
+
+// Refill whichever reserve is emptier; both are topped up concurrently by
+// different workers, never past their targets
+static void* keygen_worker(void* arg) {
+    keygen_pool_t* pool = (keygen_pool_t*)arg;
+
+#ifdef SCHED_IDLE
+    struct sched_param param = { .sched_priority = 0 };
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+        log_warn("keygen worker could not switch to SCHED_IDLE");
+    }
+#endif
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running) {
+        size_t falcon_missing = pool->falcon_target - pool->falcon_count - pool->falcon_pending;
+        size_t rsa_missing = pool->rsa_target - pool->rsa_count - pool->rsa_pending;
+        if (falcon_missing == 0 && rsa_missing == 0) {
+            pthread_cond_wait(&pool->refill, &pool->lock);
+            continue;
+        }
+
+        // Compare fill levels as fractions of each target
+        int make_falcon = falcon_missing > 0 &&
+                          (rsa_missing == 0 || falcon_missing * pool->rsa_target >= rsa_missing * pool->falcon_target);
+        if (make_falcon) {
+            pool->falcon_pending++;
+            pthread_mutex_unlock(&pool->lock);
+
+            falcon_keypair_t pair;
+            int ok = generate_falcon_keypair(pair.public_key, pair.private_key) == 0;
+
+            pthread_mutex_lock(&pool->lock);
+            pool->falcon_pending--;
+            if (ok && pool->running && pool->falcon_count < pool->falcon_target) {
+                pool->falcon[pool->falcon_count++] = pair;
+            }
+            memset(&pair, 0, sizeof(pair));
+        } else {
+            pool->rsa_pending++;
+            pthread_mutex_unlock(&pool->lock);
+
+            EVP_PKEY* key = generate_rsa_key();
+
+            pthread_mutex_lock(&pool->lock);
+            pool->rsa_pending--;
+            if (key && pool->running && pool->rsa_count < pool->rsa_target) {
+                pool->rsa[pool->rsa_count++] = key;
+                key = NULL;
+            }
+            EVP_PKEY_free(key);
+        }
+        pthread_cond_broadcast(&pool->filled);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int init_keygen_pool(size_t falcon_target, size_t rsa_target, int workers, keygen_pool_t** pool_out) {
+    if (!pool_out || workers <= 0) return -1;
+
+    keygen_pool_t* pool = calloc(1, sizeof(keygen_pool_t));
+    if (!pool) return -1;
+    pool->falcon_target = falcon_target;
+    pool->rsa_target = rsa_target;
+    pool->falcon = calloc(falcon_target ? falcon_target : 1, sizeof(falcon_keypair_t));
+    pool->rsa = calloc(rsa_target ? rsa_target : 1, sizeof(EVP_PKEY*));
+    pool->workers = calloc((size_t)workers, sizeof(pthread_t));
+    if (!pool->falcon || !pool->rsa || !pool->workers) {
+        free(pool->falcon);
+        free(pool->rsa);
+        free(pool->workers);
+        free(pool);
+        return -1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->refill, NULL);
+    pthread_cond_init(&pool->filled, NULL);
+    pool->running = 1;
+
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&pool->workers[i], NULL, keygen_worker, pool) != 0) {
+            log_error("Failed to start keygen worker %d", i);
+            break;
+        }
+        pool->worker_count++;
+    }
+    if (pool->worker_count == 0) {
+        cleanup_keygen_pool(pool);
+        return -1;
+    }
+
+    dlog("Keygen pool started: %zu Falcon, %zu RSA, %d workers", falcon_target, rsa_target, pool->worker_count);
+    *pool_out = pool;
+    return 0;
+}
+
+void cleanup_keygen_pool(keygen_pool_t* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&default_pool_lock);
+    if (default_pool == pool) default_pool = NULL;
+    pthread_mutex_unlock(&default_pool_lock);
+
+    // Workers finish the key they are generating, then exit
+    pthread_mutex_lock(&pool->lock);
+    pool->running = 0;
+    pthread_cond_broadcast(&pool->refill);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->worker_count; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    memset(pool->falcon, 0, pool->falcon_count * sizeof(falcon_keypair_t));
+    for (size_t i = 0; i < pool->rsa_count; i++) {
+        EVP_PKEY_free(pool->rsa[i]);
+    }
+    pthread_cond_destroy(&pool->filled);
+    pthread_cond_destroy(&pool->refill);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->falcon);
+    free(pool->rsa);
+    free(pool->workers);
+    free(pool);
+}
+
+int keygen_pool_take_falcon(keygen_pool_t* pool, uint8_t* public_key, uint8_t* private_key) {
+    if (!public_key || !private_key) return -1;
+
+    if (pool) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->falcon_count > 0) {
+            falcon_keypair_t* pair = &pool->falcon[--pool->falcon_count];
+            memcpy(public_key, pair->public_key, sizeof(pair->public_key));
+            memcpy(private_key, pair->private_key, sizeof(pair->private_key));
+            memset(pair, 0, sizeof(*pair));
+            pool->hits++;
+            pthread_cond_signal(&pool->refill);
+            pthread_mutex_unlock(&pool->lock);
+            return 0;
+        }
+        pool->misses++;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return generate_falcon_keypair(public_key, private_key);
+}
+
+EVP_PKEY* keygen_pool_take_rsa(keygen_pool_t* pool) {
+    if (pool) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->rsa_count > 0) {
+            EVP_PKEY* key = pool->rsa[--pool->rsa_count];
+            pool->rsa[pool->rsa_count] = NULL;
+            pool->hits++;
+            pthread_cond_signal(&pool->refill);
+            pthread_mutex_unlock(&pool->lock);
+            return key;
+        }
+        pool->misses++;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return generate_rsa_key();
+}
+
+int keygen_pool_wait_ready(keygen_pool_t* pool, int timeout_ms) {
+    if (!pool) return -1;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    int rc = 0;
+    while (pool->falcon_count < pool->falcon_target || pool->rsa_count < pool->rsa_target) {
+        if (pthread_cond_timedwait(&pool->filled, &pool->lock, &deadline) == ETIMEDOUT) {
+            rc = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return rc;
+}
+
+void keygen_pool_stats(keygen_pool_t* pool, size_t* falcon_ready, size_t* rsa_ready,
+                       uint64_t* hits, uint64_t* misses) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    if (falcon_ready) *falcon_ready = pool->falcon_count;
+    if (rsa_ready) *rsa_ready = pool->rsa_count;
+    if (hits) *hits = pool->hits;
+    if (misses) *misses = pool->misses;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void set_default_keygen_pool(keygen_pool_t* pool) {
+    pthread_mutex_lock(&default_pool_lock);
+    default_pool = pool;
+    pthread_mutex_unlock(&default_pool_lock);
+}
+
+keygen_pool_t* get_default_keygen_pool(void) {
+    pthread_mutex_lock(&default_pool_lock);
+    keygen_pool_t* pool = default_pool;
+    pthread_mutex_unlock(&default_pool_lock);
+    return pool;
+}
@@ -31,6 +31,10 @@
 #include "../include/cli_interface.h" // Added for CLI functionality
 #include "../include/utils.h"           // For utility functions like get_timestamp
 #include "../include/dns_resolver.h"    // For DNS resolver functions
+#include "../include/dns_frontend.h"
+#include "../include/keygen_pool.h"     // For pre-generated certificate keys
+#include "../include/metrics.h"         // For the metrics socket
+#include "../include/query_trace.h"     // For sampled query tracing
 
 // Add global variable for clean shutdown
 static volatile int global_running = 1;
@@ -71,6 +75,14 @@ void print_usage() {
     printf("  --register-tld <tld_name>              Register a new TLD with the connected server\n");
     printf("  --service                              Run as a service\n");
     printf("  --detect-network                       Auto-detect network settings\n");
+    printf("  --log-level <debug|info|warn|error>    Minimum level logged (default: from config, else info)\n");
+    printf("  --keygen-pool <n>                      Key pairs kept pre-generated for issuance (default: %d, 0 disables)\n", KEYGEN_POOL_DEFAULT_SIZE);
+    printf("  --trace-sample <n>                     Trace one query in n per thread, see `nexus_cli traces` (default: 0, off)\n");
+    printf("  --dns-port <port>                      Also serve classic DNS over UDP/TCP on this port (default: 0, off)\n");
+    printf("  --dns-bind <address>                   Address for --dns-port (default: all addresses)\n");
+    printf("  --db <path>                            Keep TLDs in this SQLite database across restarts (default: from profile, else off)\n");
+    printf("  --metrics-socket <path>                Serve metrics and traces on this Unix socket (default: $" NEXUS_METRICS_SOCKET_ENV ", else $XDG_RUNTIME_DIR/" NEXUS_METRICS_SOCKET_NAME ")\n");
+    printf("  --ct-log <dir>                         Keep the CT log in this directory and gossip it with peers (default: from profile, else off)\n");
     printf("  --test                                 Run unit tests\n");
     printf("  --help                                 Show this help message\n");
     printf("\n");
@@ -178,6 +190,18 @@ int add_network_to_multi_network(network_context_t *net_ctx, nexus_node_t *node)
     return 0;
 }
 
+// Restore TLDs saved by a previous run and keep saving them; open the CT
+// log and gossip its tree heads with peers
+static void enable_node_storage(network_context_t *net_ctx, const char *db_path,
+                                const char *ct_log_path, const char *name) {
+    if (db_path && enable_network_context_persistence(net_ctx, db_path) != 0) {
+        fprintf(stderr, "Warning: TLD persistence disabled for %s\n", name);
+    }
+    if (ct_log_path && enable_network_context_ct_log(net_ctx, ct_log_path) != 0) {
+        fprintf(stderr, "Warning: CT log disabled for %s\n", name);
+    }
+}
+
 // Start node from profile
 int start_node_from_profile(network_profile_t *profile) {
     if (!profile) {
@@ -193,6 +217,8 @@ int start_node_from_profile(network_profile_t *profile) {
         return -1;
     }
     
+    enable_node_storage(net_ctx, profile->db_path, profile->ct_log_path, profile->name);
+    
     // Initialize CA
     ca_context_t* ca_ctx = NULL;
     if (init_certificate_authority(net_ctx, &ca_ctx) != 0) {
@@ -265,7 +291,7 @@ int start_all_profiles(nexus_config_t *config) {
 }
 
 // Run as a service
-int run_as_service(void) {
+int run_as_service(const char *db_path, const char *ct_log_path) {
     dlog("Running as a service");
     
     // Initialize config manager
@@ -284,6 +310,17 @@ int run_as_service(void) {
     // Get global config (loaded by init_config_manager)
     nexus_config_t *config = create_default_config(); // In a real implementation, we would use the global config
     
+    // Command line storage paths apply to the default profile
+    network_profile_t *default_profile = config ? get_profile(config, config->default_profile) : NULL;
+    if (default_profile && db_path) {
+        free(default_profile->db_path);
+        default_profile->db_path = strdup(db_path);
+    }
+    if (default_profile && ct_log_path) {
+        free(default_profile->ct_log_path);
+        default_profile->ct_log_path = strdup(ct_log_path);
+    }
+    
     // Start all profiles
     if (start_all_profiles(config) != 0) {
         fprintf(stderr, "Failed to start any profiles\n");
@@ -320,6 +357,14 @@ int main(int argc, char *argv[]) {
     const char* profile_name = NULL;
     int run_as_service_flag = 0;
     int detect_network_flag = 0;
+    int keygen_pool_size = KEYGEN_POOL_DEFAULT_SIZE;
+    int log_level = -1;
+    int trace_sample = 0;
+    int dns_port = 0;
+    const char* dns_bind = NULL;
+    const char* db_path = NULL;
+    const char* ct_log_path = NULL;
+    const char* metrics_socket = NULL;
 
     // Define long options
     static struct option long_options[] = {
@@ -331,6 +376,14 @@ int main(int argc, char *argv[]) {
         {"register-tld",  required_argument, 0, 'r'},
         {"service",       no_argument,       0, 'd'},
         {"detect-network",no_argument,       0, 'n'},
+        {"keygen-pool",   required_argument, 0, 'k'},
+        {"log-level",     required_argument, 0, 'l'},
+        {"trace-sample",  required_argument, 0, 'q'},
+        {"dns-port",      required_argument, 0, 'D'},
+        {"dns-bind",      required_argument, 0, 'B'},
+        {"db",            required_argument, 0, 'b'},
+        {"ct-log",        required_argument, 0, 'L'},
+        {"metrics-socket",required_argument, 0, 'M'},
         {"test",          no_argument,       0, 't'},
         {"help",          no_argument,       0, '?'},
         {0, 0, 0, 0}
@@ -338,7 +391,7 @@ int main(int argc, char *argv[]) {
 
     // Parse command line arguments
     int opt;
-    while ((opt = getopt_long(argc, argv, "c:p:m:h:s:r:dnt", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "c:p:m:h:s:r:k:l:q:D:B:b:L:M:dnt", long_options, NULL)) != -1) {
         switch (opt) {
             case 'c':
                 config_file = optarg;
@@ -372,6 +425,50 @@ int main(int argc, char *argv[]) {
             case 'n':
                 detect_network_flag = 1;
                 break;
+            case 'k':
+                keygen_pool_size = atoi(optarg);
+                if (keygen_pool_size < 0) {
+                    fprintf(stderr, "Invalid keygen pool size: %s\n", optarg);
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case 'l':
+                log_level = parse_log_level(optarg);
+                if (log_level < 0) {
+                    fprintf(stderr, "Invalid log level: %s\n", optarg);
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case 'q':
+                trace_sample = atoi(optarg);
+                if (trace_sample < 0) {
+                    fprintf(stderr, "Invalid trace sample rate: %s\n", optarg);
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case 'D':
+                dns_port = atoi(optarg);
+                if (dns_port < 0 || dns_port > 65535) {
+                    fprintf(stderr, "Invalid DNS port: %s\n", optarg);
+                    print_usage();
+                    return 1;
+                }
+                break;
+            case 'B':
+                dns_bind = optarg;
+                break;
+            case 'b':
+                db_path = optarg;
+                break;
+            case 'L':
+                ct_log_path = optarg;
+                break;
+            case 'M':
+                metrics_socket = optarg;
+                break;
             case 't':
                 printf("Executing 'make test'...\n");
                 int test_status = system("make test");
@@ -401,9 +498,42 @@ int main(int argc, char *argv[]) {
     signal(SIGINT, handle_signal);
     signal(SIGTERM, handle_signal);
     
+    // Buffered logging from here on; a config file may lower or raise the level
+    init_logging(log_level >= 0 ? log_level : LOG_LEVEL_INFO, NULL);
+    
+    // Prometheus text for `nexus_cli metrics` and local scrapers
+    metrics_server_t *metrics_server = NULL;
+    char default_metrics_socket[108];
+    if (!metrics_socket && metrics_default_socket_path(default_metrics_socket, sizeof(default_metrics_socket)) == 0) {
+        metrics_socket = default_metrics_socket;
+    }
+    if (!metrics_socket || init_metrics_server(metrics_socket, &metrics_server) != 0) {
+        fprintf(stderr, "Warning: metrics will not be served\n");
+    }
+    
+    // Traces are served on the metrics socket
+    if (trace_sample > 0 && init_query_tracing((unsigned)trace_sample, QUERY_TRACE_DEFAULT_CAPACITY) != 0) {
+        fprintf(stderr, "Warning: query tracing disabled\n");
+    }
+    
+    // Keep key pairs ready so certificate issuance only pays for signing
+    keygen_pool_t *keygen_pool = NULL;
+    if (keygen_pool_size > 0) {
+        if (init_keygen_pool(keygen_pool_size, keygen_pool_size, KEYGEN_POOL_DEFAULT_WORKERS, &keygen_pool) == 0) {
+            set_default_keygen_pool(keygen_pool);
+        } else {
+            fprintf(stderr, "Warning: keygen pool disabled, keys will be generated on demand\n");
+        }
+    }
+    
     // Run as a service if requested
     if (run_as_service_flag) {
-        return run_as_service();
+        int service_status = run_as_service(db_path, ct_log_path);
+        cleanup_keygen_pool(keygen_pool);
+        cleanup_metrics_server(metrics_server);
+        cleanup_query_tracing();
+        cleanup_logging();
+        return service_status;
     }
     
     // Load configuration if specified or use default values
@@ -436,6 +566,11 @@ int main(int argc, char *argv[]) {
             }
         }
         
+        // The command line wins over the configured level
+        if (log_level < 0) {
+            set_log_level(config->log_level);
+        }
+        
         // Get profile
         network_profile_t *profile = NULL;
         if (profile_name) {
@@ -477,6 +612,16 @@ int main(int argc, char *argv[]) {
             profile->server = strdup(node_server);
         }
         
+        if (db_path) {
+            free(profile->db_path);
+            profile->db_path = strdup(db_path);
+        }
+        
+        if (ct_log_path) {
+            free(profile->ct_log_path);
+            profile->ct_log_path = strdup(ct_log_path);
+        }
+        
         // Detect network settings if requested
         if (detect_network_flag) {
             detect_network_settings(profile);
@@ -490,6 +635,8 @@ int main(int argc, char *argv[]) {
             return 1;
         }
         
+        enable_node_storage(net_ctx, profile->db_path, profile->ct_log_path, profile->name);
+        
         // Clean up config now that we have the network context
         free_config(config);
     } else {
@@ -516,6 +663,8 @@ int main(int argc, char *argv[]) {
             dlog("Failed to initialize network context with direct parameters");
             return 1;
         }
+        
+        enable_node_storage(net_ctx, db_path, ct_log_path, node_hostname);
     }
 
     printf("Initializing NEXUS node\n");
@@ -582,6 +731,18 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Classic DNS clients share the node's resolver and cache
+    dns_frontend_t *dns_frontend = NULL;
+    if (dns_port > 0) {
+        dns_frontend_config_t dns_config;
+        dns_frontend_default_config(&dns_config);
+        dns_config.bind_address = dns_bind;
+        dns_config.port = (uint16_t)dns_port;
+        if (init_dns_frontend(&dns_config, net_ctx->dns_resolver, &dns_frontend) != 0) {
+            fprintf(stderr, "Warning: classic DNS will not be served on port %d\n", dns_port);
+        }
+    }
+
     printf("Node running. Press Ctrl+C to stop.\n");
 
     // Keep main thread running until signal received
@@ -592,6 +753,7 @@ int main(int argc, char *argv[]) {
     printf("\nShutting down...\n");
     
     // Clean up
+    cleanup_dns_frontend(dns_frontend);
     cleanup_node(node);
     free(node);  // Now explicitly free the node structure
     cleanup_network_context(net_ctx);
@@ -599,6 +761,10 @@ int main(int argc, char *argv[]) {
     
     // Clean up config manager if it was initialized
     cleanup_config_manager();
+    cleanup_keygen_pool(keygen_pool);
+    cleanup_metrics_server(metrics_server);
+    cleanup_query_tracing();
+    cleanup_logging();
 
     return 0;
 }
@@ -0,0 +1,435 @@
+#include "../include/metrics.h"
+#include "../include/packet_protocol.h"
+#include "../include/debug.h"
+#include "../include/query_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define HISTOGRAM_SUB_COUNT (1 << METRICS_HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_VALUE ((1ULL << (METRICS_HISTOGRAM_MAX_EXPONENT + 1)) - 1)
+
+typedef struct {
+    atomic_uint_fast64_t slots[METRIC_COUNTER_SLOTS];
+} __attribute__((aligned(64))) counter_shard_t;
+
+typedef struct {
+    atomic_uint_fast64_t buckets[METRICS_HISTOGRAM_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t sum;
+} __attribute__((aligned(64))) histogram_shard_t;
+
+static counter_shard_t counter_shards[METRICS_SHARDS];
+static histogram_shard_t histogram_shards[METRIC_HISTOGRAM_COUNT][METRICS_SHARDS];
+
+static atomic_uint next_shard = 0;
+static __thread int thread_shard = -1;
+
+typedef struct {
+    const char* name;
+    const char* help;
+} metric_info_t;
+
+static const metric_info_t counter_info[METRIC_PACKETS_RECEIVED] = {
+    [METRIC_DNS_QUERIES] = { "nexus_dns_queries_total", "DNS queries resolved" },
+    [METRIC_DNS_NXDOMAIN] = { "nexus_dns_nxdomain_total", "DNS queries answered with NXDOMAIN" },
+    [METRIC_DNS_FAILURES] = { "nexus_dns_failures_total", "DNS queries that failed to resolve" },
+    [METRIC_DNS_CACHE_HITS] = { "nexus_dns_cache_hits_total", "DNS cache lookups answered from the cache" },
+    [METRIC_DNS_CACHE_MISSES] = { "nexus_dns_cache_misses_total", "DNS cache lookups not found in the cache" },
+    [METRIC_DNS_CACHE_INSERTS] = { "nexus_dns_cache_inserts_total", "Records added to the DNS cache" },
+    [METRIC_DNS_CACHE_EXPIRED] = { "nexus_dns_cache_expired_total", "Expired DNS cache entries removed" },
+    [METRIC_UPSTREAM_QUERIES] = { "nexus_upstream_queries_total", "Queries sent to external resolvers" },
+    [METRIC_UPSTREAM_FAILURES] = { "nexus_upstream_failures_total", "External resolver queries that failed" },
+    [METRIC_STREAM_BYTES_RECEIVED] = { "nexus_stream_received_bytes_total", "Bytes received on server streams" },
+    [METRIC_CONNECTIONS_ACCEPTED] = { "nexus_connections_accepted_total", "Server connections accepted" },
+    [METRIC_CONNECTIONS_CLOSED] = { "nexus_connections_closed_total", "Server connections closed" },
+    [METRIC_HANDSHAKES_COMPLETED] = { "nexus_handshakes_completed_total", "Server handshakes completed" },
+    [METRIC_DNS_UDP_QUERIES] = { "nexus_dns_udp_queries_total", "Queries answered by the DNS frontend over UDP" },
+    [METRIC_DNS_TCP_QUERIES] = { "nexus_dns_tcp_queries_total", "Queries answered by the DNS frontend over TCP" },
+    [METRIC_DNS_TRUNCATED] = { "nexus_dns_truncated_total", "DNS frontend answers truncated with TC set" },
+    [METRIC_DOQ_QUERIES] = { "nexus_doq_queries_total", "Queries answered over DNS over QUIC" },
+    [METRIC_ANSWER_CACHE_HITS] = { "nexus_answer_cache_hits_total", "DNS answers served from the serialized answer cache" },
+    [METRIC_ANSWER_CACHE_MISSES] = { "nexus_answer_cache_misses_total", "DNS queries not found in the serialized answer cache" },
+    [METRIC_DNS_CNAME_CHAIN_HITS] = { "nexus_dns_cname_chain_hits_total", "CNAME chains answered from the flattened chain cache" },
+};
+
+static const metric_info_t histogram_info[METRIC_HISTOGRAM_COUNT] = {
+    [METRIC_RESOLVE_LATENCY] = { "nexus_resolve_duration_seconds", "Time to resolve a DNS query" },
+    [METRIC_UPSTREAM_RTT] = { "nexus_upstream_rtt_seconds", "Round trip to an external resolver" },
+};
+
+static inline int current_shard(void) {
+    if (thread_shard < 0) {
+        thread_shard = (int)(atomic_fetch_add_explicit(&next_shard, 1, memory_order_relaxed) % METRICS_SHARDS);
+    }
+    return thread_shard;
+}
+
+static size_t bucket_index(uint64_t value) {
+    if (value > HISTOGRAM_MAX_VALUE) value = HISTOGRAM_MAX_VALUE;
+    if (value < HISTOGRAM_SUB_COUNT) return (size_t)value;
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - METRICS_HISTOGRAM_SUB_BITS;
+    return HISTOGRAM_SUB_COUNT + (size_t)shift * HISTOGRAM_SUB_COUNT +
+           (size_t)((value >> shift) & (HISTOGRAM_SUB_COUNT - 1));
+}
+
+// Smallest value that no longer falls in the bucket
+static uint64_t bucket_limit(size_t index) {
+    if (index < HISTOGRAM_SUB_COUNT) return index + 1;
+    size_t shift = (index - HISTOGRAM_SUB_COUNT) / HISTOGRAM_SUB_COUNT;
+    uint64_t sub = (index - HISTOGRAM_SUB_COUNT) % HISTOGRAM_SUB_COUNT;
+    return (HISTOGRAM_SUB_COUNT + sub + 1) << shift;
+}
+
+void metrics_add(metric_counter_t counter, uint64_t n) {
+    if ((unsigned)counter >= METRIC_COUNTER_SLOTS) return;
+    atomic_fetch_add_explicit(&counter_shards[current_shard()].slots[counter], n, memory_order_relaxed);
+}
+
+void metrics_count_packet(int packet_type) {
+    if (packet_type < 0 || packet_type >= METRICS_PACKET_TYPE_SLOTS - 1) {
+        packet_type = METRICS_PACKET_TYPE_SLOTS - 1;
+    }
+    metrics_add((metric_counter_t)(METRIC_PACKETS_RECEIVED + packet_type), 1);
+}
+
+void metrics_observe_us(metric_histogram_t histogram, uint64_t value_us) {
+    if ((unsigned)histogram >= METRIC_HISTOGRAM_COUNT) return;
+    histogram_shard_t* shard = &histogram_shards[histogram][current_shard()];
+    atomic_fetch_add_explicit(&shard->buckets[bucket_index(value_us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->sum, value_us, memory_order_relaxed);
+}
+
+uint64_t metrics_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+uint64_t metrics_counter_value(metric_counter_t counter) {
+    if ((unsigned)counter >= METRIC_COUNTER_SLOTS) return 0;
+    uint64_t total = 0;
+    for (int s = 0; s < METRICS_SHARDS; s++) {
+        total += atomic_load_explicit(&counter_shards[s].slots[counter], memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t metrics_packet_count(int packet_type) {
+    if (packet_type < 0 || packet_type >= METRICS_PACKET_TYPE_SLOTS - 1) {
+        packet_type = METRICS_PACKET_TYPE_SLOTS - 1;
+    }
+    return metrics_counter_value((metric_counter_t)(METRIC_PACKETS_RECEIVED + packet_type));
+}
+
+// Sum the shards into buckets (METRICS_HISTOGRAM_BUCKETS entries)
+static void collect_histogram(metric_histogram_t histogram, uint64_t* buckets, uint64_t* count, uint64_t* sum_us) {
+    memset(buckets, 0, METRICS_HISTOGRAM_BUCKETS * sizeof(uint64_t));
+    uint64_t total = 0, sum = 0;
+    for (int s = 0; s < METRICS_SHARDS; s++) {
+        histogram_shard_t* shard = &histogram_shards[histogram][s];
+        for (size_t b = 0; b < METRICS_HISTOGRAM_BUCKETS; b++) {
+            buckets[b] += atomic_load_explicit(&shard->buckets[b], memory_order_relaxed);
+        }
+        total += atomic_load_explicit(&shard->count, memory_order_relaxed);
+        sum += atomic_load_explicit(&shard->sum, memory_order_relaxed);
+    }
+    if (count) *count = total;
+    if (sum_us) *sum_us = sum;
+}
+
+void metrics_histogram_summary(metric_histogram_t histogram, uint64_t* count, uint64_t* sum_us) {
+    if ((unsigned)histogram >= METRIC_HISTOGRAM_COUNT) return;
+    uint64_t total = 0, sum = 0;
+    for (int s = 0; s < METRICS_SHARDS; s++) {
+        total += atomic_load_explicit(&histogram_shards[histogram][s].count, memory_order_relaxed);
+        sum += atomic_load_explicit(&histogram_shards[histogram][s].sum, memory_order_relaxed);
+    }
+    if (count) *count = total;
+    if (sum_us) *sum_us = sum;
+}
+
+uint64_t metrics_histogram_quantile(metric_histogram_t histogram, double q) {
+    if ((unsigned)histogram >= METRIC_HISTOGRAM_COUNT) return 0;
+    uint64_t buckets[METRICS_HISTOGRAM_BUCKETS];
+    collect_histogram(histogram, buckets, NULL, NULL);
+
+    uint64_t total = 0;
+    for (size_t b = 0; b < METRICS_HISTOGRAM_BUCKETS; b++) total += buckets[b];
+    if (total == 0) return 0;
+
+    if (q < 0) q = 0;
+    if (q > 1) q = 1;
+    uint64_t rank = (uint64_t)(q * (double)total + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < METRICS_HISTOGRAM_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank) return bucket_limit(b) - 1;
+    }
+    return HISTOGRAM_MAX_VALUE;
+}
+
+void metrics_reset(void) {
+    for (int s = 0; s < METRICS_SHARDS; s++) {
+        for (size_t c = 0; c < METRIC_COUNTER_SLOTS; c++) {
+            atomic_store_explicit(&counter_shards[s].slots[c], 0, memory_order_relaxed);
+        }
+        for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+            histogram_shard_t* shard = &histogram_shards[h][s];
+            for (size_t b = 0; b < METRICS_HISTOGRAM_BUCKETS; b++) {
+                atomic_store_explicit(&shard->buckets[b], 0, memory_order_relaxed);
+            }
+            atomic_store_explicit(&shard->count, 0, memory_order_relaxed);
+            atomic_store_explicit(&shard->sum, 0, memory_order_relaxed);
+        }
+    }
+}
+
+int metrics_render_prometheus(char** out, size_t* out_len) {
+    if (!out || !out_len) return -1;
+
+    FILE* f = open_memstream(out, out_len);
+    if (!f) return -1;
+
+    for (int c = 0; c < METRIC_PACKETS_RECEIVED; c++) {
+        fprintf(f, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                counter_info[c].name, counter_info[c].help, counter_info[c].name,
+                counter_info[c].name, (unsigned long long)metrics_counter_value((metric_counter_t)c));
+    }
+
+    fprintf(f, "# HELP nexus_packets_received_total NEXUS packets received by type\n");
+    fprintf(f, "# TYPE nexus_packets_received_total counter\n");
+    for (int t = 0; t < METRICS_PACKET_TYPE_SLOTS; t++) {
+        const char* name = get_packet_type_name(t);
+        if (strcmp(name, "unknown") == 0 && t != METRICS_PACKET_TYPE_SLOTS - 1) continue;
+        fprintf(f, "nexus_packets_received_total{type=\"%s\"} %llu\n", name,
+                (unsigned long long)metrics_packet_count(t));
+    }
+
+    uint64_t accepted = metrics_counter_value(METRIC_CONNECTIONS_ACCEPTED);
+    uint64_t closed = metrics_counter_value(METRIC_CONNECTIONS_CLOSED);
+    fprintf(f, "# HELP nexus_connections_open Server connections currently open\n");
+    fprintf(f, "# TYPE nexus_connections_open gauge\n");
+    fprintf(f, "nexus_connections_open %llu\n", (unsigned long long)(accepted > closed ? accepted - closed : 0));
+
+    uint64_t buckets[METRICS_HISTOGRAM_BUCKETS];
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++) {
+        const char* name = histogram_info[h].name;
+        uint64_t count = 0, sum = 0;
+        collect_histogram((metric_histogram_t)h, buckets, &count, &sum);
+
+        fprintf(f, "# HELP %s %s\n# TYPE %s histogram\n", name, histogram_info[h].help, name);
+        // Bucket edges fall on powers of two, so each bound counts whole buckets
+        size_t b = 0;
+        uint64_t cumulative = 0;
+        for (int e = 0; e <= METRICS_HISTOGRAM_MAX_EXPONENT + 1; e++) {
+            uint64_t bound = 1ULL << e;
+            while (b < METRICS_HISTOGRAM_BUCKETS && bucket_limit(b) <= bound) {
+                cumulative += buckets[b++];
+            }
+            fprintf(f, "%s_bucket{le=\"%.6g\"} %llu\n", name, (double)bound / 1e6, (unsigned long long)cumulative);
+        }
+        while (b < METRICS_HISTOGRAM_BUCKETS) cumulative += buckets[b++];
+        fprintf(f, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+        fprintf(f, "%s_sum %.6f\n", name, (double)sum / 1e6);
+        fprintf(f, "%s_count %llu\n", name, (unsigned long long)count);
+    }
+
+    if (fclose(f) != 0) {
+        free(*out);
+        *out = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+struct metrics_server_s {
+    int fd;
+    char* path;
+    pthread_t thread;
+    atomic_int running;
+};
+
+static int send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void serve_metrics_client(int client) {
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char request[512];
+    ssize_t n = recv(client, request, sizeof(request) - 1, 0);
+    if (n <= 0) return;
+    request[n] = '\0';
+
+    char* body = NULL;
+    size_t body_len = 0;
+    if (strncmp(request, "TRACES", 6) == 0) {
+        FILE* f = open_memstream(&body, &body_len);
+        if (!f) return;
+        int binary = strncmp(request, "TRACES BINARY", 13) == 0;
+        int rv = binary ? query_trace_dump_binary(f) : query_trace_dump_chrome(f);
+        if (fclose(f) != 0 || rv != 0) {
+            free(body);
+            return;
+        }
+        send_all(client, body, body_len);
+        free(body);
+        return;
+    }
+
+    if (metrics_render_prometheus(&body, &body_len) != 0) return;
+
+    if (strncmp(request, "GET ", 4) == 0) {
+        char header[160];
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.0 200 OK\r\n"
+                                  "Content-Type: text/plain; version=0.0.4\r\n"
+                                  "Content-Length: %zu\r\n\r\n", body_len);
+        if (send_all(client, header, (size_t)header_len) != 0) {
+            free(body);
+            return;
+        }
+    }
+    send_all(client, body, body_len);
+    free(body);
+}
+
+static void* metrics_server_loop(void* arg) {
+    metrics_server_t* server = (metrics_server_t*)arg;
+    struct pollfd pfd = { .fd = server->fd, .events = POLLIN };
+
+    while (atomic_load(&server->running)) {
+        int ready = poll(&pfd, 1, 200);
+        if (ready <= 0) continue;
+        int client = accept(server->fd, NULL, NULL);
+        if (client < 0) continue;
+        serve_metrics_client(client);
+        close(client);
+    }
+    return NULL;
+}
+
+int metrics_default_socket_path(char* buf, size_t len) {
+    if (!buf || len == 0) return -1;
+    const char* path = getenv(NEXUS_METRICS_SOCKET_ENV);
+    const char* run_dir = getenv("XDG_RUNTIME_DIR");
+    int n;
+    if (path && *path) {
+        n = snprintf(buf, len, "%s", path);
+    } else if (run_dir && *run_dir) {
+        n = snprintf(buf, len, "%s/%s", run_dir, NEXUS_METRICS_SOCKET_NAME);
+    } else {
+        n = snprintf(buf, len, "/tmp/nexus_metrics-%u.sock", (unsigned)getuid());
+    }
+    return n > 0 && (size_t)n < len ? 0 : -1;
+}
+
+// Clear the way for bind(): a leftover socket from a run that is gone is
+// removed, but not one that still accepts connections or any other file.
+static int claim_socket_path(const char* socket_path, const struct sockaddr_un* addr) {
+    struct stat st;
+    if (lstat(socket_path, &st) != 0) return errno == ENOENT ? 0 : -1;
+    if (!S_ISSOCK(st.st_mode)) {
+        log_error("Metrics socket path %s exists and is not a socket", socket_path);
+        return -1;
+    }
+
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) return -1;
+    int live = connect(probe, (const struct sockaddr*)addr, sizeof(*addr)) == 0 || errno != ECONNREFUSED;
+    close(probe);
+    if (live) {
+        log_error("Metrics socket %s is in use by another process", socket_path);
+        return -1;
+    }
+    return unlink(socket_path) == 0 || errno == ENOENT ? 0 : -1;
+}
+
+int init_metrics_server(const char* socket_path, metrics_server_t** server_out) {
+    if (!socket_path || !server_out) return -1;
+
+    struct sockaddr_un addr;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        log_error("Metrics socket path too long: %s", socket_path);
+        return -1;
+    }
+
+    metrics_server_t* server = calloc(1, sizeof(metrics_server_t));
+    if (!server) return -1;
+    server->path = strdup(socket_path);
+    server->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (!server->path || server->fd < 0) {
+        log_error("Failed to create metrics socket: %s", strerror(errno));
+        if (server->fd >= 0) close(server->fd);
+        free(server->path);
+        free(server);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (claim_socket_path(socket_path, &addr) != 0) {
+        close(server->fd);
+        free(server->path);
+        free(server);
+        return -1;
+    }
+
+    int bound = bind(server->fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    if (!bound || chmod(socket_path, 0600) != 0 || listen(server->fd, 8) != 0) {
+        log_error("Failed to listen on metrics socket %s: %s", socket_path, strerror(errno));
+        close(server->fd);
+        if (bound) unlink(socket_path);
+        free(server->path);
+        free(server);
+        return -1;
+    }
+
+    atomic_init(&server->running, 1);
+    if (pthread_create(&server->thread, NULL, metrics_server_loop, server) != 0) {
+        log_error("Failed to start metrics server thread");
+        close(server->fd);
+        unlink(socket_path);
+        free(server->path);
+        free(server);
+        return -1;
+    }
+
+    dlog("Serving metrics on %s", socket_path);
+    *server_out = server;
+    return 0;
+}
+
+void cleanup_metrics_server(metrics_server_t* server) {
+    if (!server) return;
+    atomic_store(&server->running, 0);
+    pthread_join(server->thread, NULL);
+    close(server->fd);
+    unlink(server->path);
+    free(server->path);
+    free(server);
+}
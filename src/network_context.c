@@ -2,6 +2,9 @@
 #include "../include/debug.h"
 #include "../include/tld_manager.h" // For init_tld_manager and cleanup_tld_manager
 #include "../include/certificate_authority.h" // For cleanup_certificate_authority
+#include "../include/certificate_transparency.h"
+#include "../include/ct_gossip.h"
+#include "../include/tld_sync.h"
 #include <string.h>
 #include <stdlib.h> // For malloc, free
 #include <stdio.h>  // For fprintf, stderr
@@ -9,17 +12,17 @@
 // Enhanced error handling for network context initialization
 static int validate_network_context(network_context_t* ctx) {
     if (!ctx) {
-        dlog("ERROR: Network context is NULL");
+        log_error("Network context is NULL");
         return -1;
     }
     
     if (!ctx->hostname || strlen(ctx->hostname) == 0) {
-        dlog("ERROR: Network context hostname is invalid");
+        log_error("Network context hostname is invalid");
         return -1;
     }
     
     if (ctx->mode < 0 || ctx->mode > 2) {
-        dlog("ERROR: Network context mode %d is invalid (must be 0-2)", ctx->mode);
+        log_error("Network context mode %d is invalid (must be 0-2)", ctx->mode);
         return -1;
     }
     
@@ -35,14 +38,14 @@ static int init_network_context_components_safe(network_context_t* net_ctx) {
     
     // Initialize mutex first
     if (pthread_mutex_init(&net_ctx->lock, NULL) != 0) {
-        dlog("ERROR: Failed to initialize network context mutex");
+        log_error("Failed to initialize network context mutex");
         return -1;
     }
     
     // Initialize DNS Cache with error handling
     net_ctx->dns_cache = malloc(sizeof(dns_cache_t));
     if (!net_ctx->dns_cache) {
-        dlog("ERROR: Failed to allocate DNS cache");
+        log_error("Failed to allocate DNS cache");
         pthread_mutex_destroy(&net_ctx->lock);
         return -1;
     }
@@ -53,7 +56,7 @@ static int init_network_context_components_safe(network_context_t* net_ctx) {
     net_ctx->dns_cache->max_size = 1000;
     
     if (pthread_mutex_init(&net_ctx->dns_cache->lock, NULL) != 0) {
-        dlog("ERROR: Failed to initialize DNS cache mutex");
+        log_error("Failed to initialize DNS cache mutex");
         free(net_ctx->dns_cache);
         net_ctx->dns_cache = NULL;
         pthread_mutex_destroy(&net_ctx->lock);
@@ -62,7 +65,7 @@ static int init_network_context_components_safe(network_context_t* net_ctx) {
     
     // Initialize TLD Manager with error handling
     if (init_tld_manager(&net_ctx->tld_manager) != 0) {
-        dlog("ERROR: Failed to initialize TLD manager");
+        log_error("Failed to initialize TLD manager");
         pthread_mutex_destroy(&net_ctx->dns_cache->lock);
         free(net_ctx->dns_cache);
         net_ctx->dns_cache = NULL;
@@ -70,6 +73,32 @@ static int init_network_context_components_safe(network_context_t* net_ctx) {
         return -1;
     }
     
+    // One resolver shared by the QUIC server and the classic DNS frontend
+    if (init_dns_resolver(&net_ctx->dns_resolver, net_ctx->tld_manager, net_ctx->dns_cache) != 0) {
+        log_error("Failed to initialize DNS resolver");
+        cleanup_tld_manager(net_ctx->tld_manager);
+        net_ctx->tld_manager = NULL;
+        pthread_mutex_destroy(&net_ctx->dns_cache->lock);
+        free(net_ctx->dns_cache);
+        net_ctx->dns_cache = NULL;
+        pthread_mutex_destroy(&net_ctx->lock);
+        return -1;
+    }
+    
+    // Optional: without it the QUIC server resolves every query
+    if (init_answer_cache(ANSWER_CACHE_DEFAULT_CAPACITY, &net_ctx->answer_cache) != 0 ||
+        attach_answer_cache(net_ctx->answer_cache, net_ctx->tld_manager) != 0) {
+        log_warn("Failed to set up the DNS answer cache, continuing without it");
+        cleanup_answer_cache(net_ctx->answer_cache);
+        net_ctx->answer_cache = NULL;
+    }
+    
+    // Peers are added once a node connects upstream
+    if (init_tld_sync(net_ctx->tld_manager, TLD_SYNC_DEFAULT_INTERVAL_MS, &net_ctx->tld_sync) != 0) {
+        log_warn("Failed to set up TLD sync, mirrors will not reconcile");
+        net_ctx->tld_sync = NULL;
+    }
+    
     dlog("Network context components initialized successfully");
     return 0;
 }
@@ -77,7 +106,7 @@ static int init_network_context_components_safe(network_context_t* net_ctx) {
 // Enhanced cleanup with safety checks
 static void cleanup_network_context_components_safe(network_context_t* net_ctx) {
     if (!net_ctx) {
-        dlog("WARNING: Attempted to cleanup NULL network context");
+        log_warn("Attempted to cleanup NULL network context");
         return;
     }
     
@@ -90,6 +119,47 @@ static void cleanup_network_context_components_safe(network_context_t* net_ctx)
         net_ctx->ca_ctx = NULL;
     }
     
+    if (net_ctx->ct_gossip) {
+        cleanup_ct_gossip(net_ctx->ct_gossip);
+        net_ctx->ct_gossip = NULL;
+    }
+    if (net_ctx->ct_log) {
+        dlog("Closing CT log");
+        cleanup_ct_log(net_ctx->ct_log);
+        net_ctx->ct_log = NULL;
+    }
+    
+    // Stops mutating the TLD manager before persistence is drained
+    if (net_ctx->tld_sync) {
+        cleanup_tld_sync(net_ctx->tld_sync);
+        net_ctx->tld_sync = NULL;
+    }
+    
+    // Drain pending writes before the TLD manager goes away
+    if (net_ctx->persistence) {
+        dlog("Flushing and closing persistence");
+        if (net_ctx->tld_manager &&
+            persistence_write_snapshot(net_ctx->persistence, net_ctx->tld_manager) != 0) {
+            log_warn("Failed to write TLD snapshot, next start restores from the database");
+        }
+        if (cleanup_persistence(net_ctx->persistence) != 0) {
+            log_error("Persistence lost TLD mutations that could not be committed");
+        }
+        net_ctx->persistence = NULL;
+    }
+    
+    // Detaches from the TLD manager
+    if (net_ctx->answer_cache) {
+        cleanup_answer_cache(net_ctx->answer_cache);
+        net_ctx->answer_cache = NULL;
+    }
+    
+    // The resolver refers to the TLD manager and cache, so it goes first
+    if (net_ctx->dns_resolver) {
+        cleanup_dns_resolver(net_ctx->dns_resolver);
+        net_ctx->dns_resolver = NULL;
+    }
+    
     // Cleanup TLD Manager with safety check
     if (net_ctx->tld_manager) {
         dlog("Cleaning up TLD manager");
@@ -104,7 +174,7 @@ static void cleanup_network_context_components_safe(network_context_t* net_ctx)
         // Safely destroy mutex if it was initialized
         int mutex_destroy_result = pthread_mutex_destroy(&net_ctx->dns_cache->lock);
         if (mutex_destroy_result != 0) {
-            dlog("WARNING: Failed to destroy DNS cache mutex (error %d)", mutex_destroy_result);
+            log_warn("Failed to destroy DNS cache mutex (error %d)", mutex_destroy_result);
         }
         
         // Safely clean up cache entries
@@ -133,7 +203,7 @@ static void cleanup_network_context_components_safe(network_context_t* net_ctx)
     // Safely destroy the main network context mutex
     int main_mutex_result = pthread_mutex_destroy(&net_ctx->lock);
     if (main_mutex_result != 0) {
-        dlog("WARNING: Failed to destroy main network context mutex (error %d)", main_mutex_result);
+        log_warn("Failed to destroy main network context mutex (error %d)", main_mutex_result);
     }
     
     dlog("Network context components cleanup completed");
@@ -142,7 +212,7 @@ static void cleanup_network_context_components_safe(network_context_t* net_ctx)
 // Initialize network context
 int init_network_context(network_context_t **out_ctx, int mode, const char *hostname) {
     if (!out_ctx || !hostname) {
-        dlog("ERROR: Invalid parameters for network context initialization");
+        log_error("Invalid parameters for network context initialization");
         return -1;
     }
     
@@ -150,7 +220,7 @@ int init_network_context(network_context_t **out_ctx, int mode, const char *host
     
     network_context_t *ctx = (network_context_t*)malloc(sizeof(network_context_t));
     if (!ctx) {
-        dlog("ERROR: Failed to allocate memory for network context");
+        log_error("Failed to allocate memory for network context");
         return -1;
     }
     
@@ -160,14 +230,14 @@ int init_network_context(network_context_t **out_ctx, int mode, const char *host
     ctx->mode = mode;
     ctx->hostname = strdup(hostname);
     if (!ctx->hostname) {
-        dlog("ERROR: Failed to duplicate hostname string");
+        log_error("Failed to duplicate hostname string");
         free(ctx);
         return -1;
     }
     
     // Validate the context before proceeding
     if (validate_network_context(ctx) != 0) {
-        dlog("ERROR: Network context validation failed");
+        log_error("Network context validation failed");
         free(ctx->hostname);
         free(ctx);
         return -1;
@@ -175,7 +245,7 @@ int init_network_context(network_context_t **out_ctx, int mode, const char *host
     
     // Initialize components with enhanced error handling
     if (init_network_context_components_safe(ctx) != 0) {
-        dlog("ERROR: Failed to initialize network context components");
+        log_error("Failed to initialize network context components");
         free(ctx->hostname);
         free(ctx);
         return -1;
@@ -257,6 +327,32 @@ int init_network_context_components(network_context_t* net_ctx) {
         return -1;
     }
 
+    // Initialize DNS Resolver
+    if (init_dns_resolver(&net_ctx->dns_resolver, net_ctx->tld_manager, net_ctx->dns_cache) != 0) {
+        fprintf(stderr, "Failed to initialize DNS resolver\n");
+        cleanup_tld_manager(net_ctx->tld_manager);
+        net_ctx->tld_manager = NULL;
+        pthread_mutex_destroy(&net_ctx->dns_cache->lock);
+        free(net_ctx->dns_cache);
+        net_ctx->dns_cache = NULL;
+        pthread_mutex_destroy(&net_ctx->lock);
+        return -1;
+    }
+
+    // Initialize DNS Answer Cache (optional)
+    if (init_answer_cache(ANSWER_CACHE_DEFAULT_CAPACITY, &net_ctx->answer_cache) != 0 ||
+        attach_answer_cache(net_ctx->answer_cache, net_ctx->tld_manager) != 0) {
+        fprintf(stderr, "Failed to initialize DNS answer cache, continuing without it\n");
+        cleanup_answer_cache(net_ctx->answer_cache);
+        net_ctx->answer_cache = NULL;
+    }
+
+    // Initialize TLD sync (optional, peers are added on connect)
+    if (init_tld_sync(net_ctx->tld_manager, TLD_SYNC_DEFAULT_INTERVAL_MS, &net_ctx->tld_sync) != 0) {
+        fprintf(stderr, "Failed to initialize TLD sync, continuing without it\n");
+        net_ctx->tld_sync = NULL;
+    }
+
     return 0;
 }
 
@@ -269,6 +365,42 @@ void cleanup_network_context_components(network_context_t* net_ctx) {
         net_ctx->ca_ctx = NULL;
     }
 
+    if (net_ctx->ct_gossip) {
+        cleanup_ct_gossip(net_ctx->ct_gossip);
+        net_ctx->ct_gossip = NULL;
+    }
+    if (net_ctx->ct_log) {
+        cleanup_ct_log(net_ctx->ct_log);
+        net_ctx->ct_log = NULL;
+    }
+
+    // Cleanup TLD sync before the manager it reconciles
+    if (net_ctx->tld_sync) {
+        cleanup_tld_sync(net_ctx->tld_sync);
+        net_ctx->tld_sync = NULL;
+    }
+
+    // Drain pending writes before the TLD manager goes away
+    if (net_ctx->persistence) {
+        if (net_ctx->tld_manager) persistence_write_snapshot(net_ctx->persistence, net_ctx->tld_manager);
+        if (cleanup_persistence(net_ctx->persistence) != 0) {
+            fprintf(stderr, "Persistence lost TLD mutations that could not be committed\n");
+        }
+        net_ctx->persistence = NULL;
+    }
+
+    // Cleanup DNS Answer Cache, detaching it from the TLD manager
+    if (net_ctx->answer_cache) {
+        cleanup_answer_cache(net_ctx->answer_cache);
+        net_ctx->answer_cache = NULL;
+    }
+
+    // Cleanup DNS Resolver before what it refers to
+    if (net_ctx->dns_resolver) {
+        cleanup_dns_resolver(net_ctx->dns_resolver);
+        net_ctx->dns_resolver = NULL;
+    }
+
     // Cleanup TLD Manager
     if (net_ctx->tld_manager) {
         cleanup_tld_manager(net_ctx->tld_manager);
@@ -295,4 +427,55 @@ void cleanup_network_context_components(network_context_t* net_ctx) {
 
     // Destroy the main network context mutex
     pthread_mutex_destroy(&net_ctx->lock);
-}
\ No newline at end of file
+}
+
+int enable_network_context_persistence(network_context_t* net_ctx, const char* db_path) {
+    if (!net_ctx || !net_ctx->tld_manager || !db_path || net_ctx->persistence) return -1;
+
+    persistence_config_t* config = create_default_persistence_config(db_path);
+    if (!config) return -1;
+    config->enable_journal = 1;
+
+    persistence_context_t* persistence = NULL;
+    int result = init_persistence(&persistence, config);
+    free_persistence_config(config);
+    if (result != 0) {
+        log_error("Failed to open persistence at %s", db_path);
+        return -1;
+    }
+
+    if (restore_tlds_from_persistence(persistence, net_ctx->tld_manager) != 0) {
+        log_warn("Some TLDs could not be restored from %s", db_path);
+    }
+
+    if (attach_persistence_to_tld_manager(persistence, net_ctx->tld_manager) != 0) {
+        log_error("Failed to attach persistence to TLD manager");
+        cleanup_persistence(persistence);
+        return -1;
+    }
+
+    net_ctx->persistence = persistence;
+    dlog("Persistence enabled: %s", db_path);
+    return 0;
+}
+
+int enable_network_context_ct_log(network_context_t* net_ctx, const char* dir) {
+    if (!net_ctx || !dir || net_ctx->ct_log) return -1;
+
+    ct_log_t* log = open_ct_log(net_ctx->hostname ? net_ctx->hostname : "nexus", "quic://ct", dir);
+    if (!log) {
+        log_error("Failed to open CT log at %s", dir);
+        return -1;
+    }
+
+    ct_gossip_t* gossip = NULL;
+    if (init_ct_gossip(log, CT_GOSSIP_DEFAULT_INTERVAL_MS, &gossip) != 0) {
+        cleanup_ct_log(log);
+        return -1;
+    }
+
+    net_ctx->ct_log = log;
+    net_ctx->ct_gossip = gossip;
+    dlog("CT log enabled: %s", dir);
+    return 0;
+}
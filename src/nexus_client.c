@@ -18,6 +18,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <inttypes.h>
 #include <stdarg.h>       // For va_list in log wrapper
 #include <unistd.h>       // For close() and usleep()
 
@@ -82,7 +83,7 @@ static void client_rand_callback_wrapper(uint8_t *dest, size_t destlen,
                                     const ngtcp2_rand_ctx *rand_ctx) {
     (void)rand_ctx;
     if (RAND_bytes(dest, destlen) != 1) {
-        dlog("CRITICAL: client_rand_callback_wrapper: RAND_bytes failed!");
+        log_error("CRITICAL: client_rand_callback_wrapper: RAND_bytes failed!");
         memset(dest, 0, destlen);
     }
 }
@@ -123,7 +124,7 @@ static int init_client_crypto_context(nexus_client_config_t *config) {
     
     config->crypto_ctx = malloc(sizeof(nexus_crypto_ctx));
     if (!config->crypto_ctx) {
-        dlog("ERROR: Failed to allocate crypto context");
+        log_error("Failed to allocate crypto context");
         return -1;
     }
     memset(config->crypto_ctx, 0, sizeof(nexus_crypto_ctx));
@@ -134,7 +135,7 @@ static int init_client_crypto_context(nexus_client_config_t *config) {
 
     config->crypto_ctx->ssl_ctx = SSL_CTX_new(TLS_client_method());
     if (!config->crypto_ctx->ssl_ctx) {
-        dlog("ERROR: Failed to create SSL context: %s", ERR_error_string(ERR_get_error(), NULL));
+        log_error("Failed to create SSL context: %s", ERR_error_string(ERR_get_error(), NULL));
         goto err_ssl_ctx_new;
     }
     
@@ -144,7 +145,7 @@ static int init_client_crypto_context(nexus_client_config_t *config) {
 
     config->crypto_ctx->ssl = SSL_new(config->crypto_ctx->ssl_ctx);
     if (!config->crypto_ctx->ssl) {
-        dlog("ERROR: Failed to create SSL object: %s", ERR_error_string(ERR_get_error(), NULL));
+        log_error("Failed to create SSL object: %s", ERR_error_string(ERR_get_error(), NULL));
         goto err_configure_ctx;
     }
     
@@ -155,7 +156,7 @@ static int init_client_crypto_context(nexus_client_config_t *config) {
     // Set correct ALPN for HTTP/3 over QUIC - this is critical for QUIC handshake
     const unsigned char alpn[] = "\x02h3"; // Length-prefixed "h3" for HTTP/3
     if (SSL_set_alpn_protos(config->crypto_ctx->ssl, alpn, sizeof(alpn) - 1) != 0) {
-        dlog("ERROR: Failed to set ALPN: %s", ERR_error_string(ERR_get_error(), NULL));
+        log_error("Failed to set ALPN: %s", ERR_error_string(ERR_get_error(), NULL));
         goto err_configure_ctx;
     }
 
@@ -181,13 +182,13 @@ err_ssl_ctx_new:
 // Complete the SSL configuration after ngtcp2 connection is created
 static int complete_client_crypto_setup(nexus_client_config_t *config) {
     if (!config || !config->crypto_ctx || !config->crypto_ctx->ssl || !config->conn) {
-        dlog("ERROR: Invalid state for completing crypto setup");
+        log_error("Invalid state for completing crypto setup");
         return -1;
     }
     
     // Configure SSL object for QUIC client session using ngtcp2 OSSL helper
     if (ngtcp2_crypto_ossl_configure_client_session(config->crypto_ctx->ssl) != 0) {
-        dlog("ERROR: ngtcp2_crypto_ossl_configure_client_session failed: %s", ERR_error_string(ERR_get_error(), NULL));
+        log_error("ngtcp2_crypto_ossl_configure_client_session failed: %s", ERR_error_string(ERR_get_error(), NULL));
         return -1;
     }
     
@@ -205,13 +206,13 @@ static int complete_client_crypto_setup(nexus_client_config_t *config) {
     
     ssize_t nwrite = ngtcp2_transport_params_encode(paramsbuf, sizeof(paramsbuf), &params);
     if (nwrite < 0) {
-        dlog("ERROR: Failed to encode transport parameters: %s", ngtcp2_strerror((int)nwrite));
+        log_error("Failed to encode transport parameters: %s", ngtcp2_strerror((int)nwrite));
         return -1;
     }
     
     // Use SSL_set_quic_tls_transport_params as indicated by ngtcp2's OpenSSL integration approach
     if (SSL_set_quic_tls_transport_params(config->crypto_ctx->ssl, paramsbuf, (size_t)nwrite) != 1) {
-        dlog("ERROR: Failed to set QUIC TLS transport parameters on SSL object: %s", ERR_error_string(ERR_get_error(), NULL));
+        log_error("Failed to set QUIC TLS transport parameters on SSL object: %s", ERR_error_string(ERR_get_error(), NULL));
         return -1;
     }
     
@@ -251,6 +252,8 @@ int init_nexus_client(network_context_t *ctx, const char *server_addr, uint16_t
     }
     config->bind_address = strdup(server_addr);
     config->port = server_port;
+    config->on_response = NULL;
+    config->response_user_data = NULL;
     
     // Create IPv6 UDP socket
     config->sock = socket(AF_INET6, SOCK_DGRAM, 0);
@@ -348,7 +351,7 @@ int init_nexus_client(network_context_t *ctx, const char *server_addr, uint16_t
             inet_pton(AF_INET6, "::1", &path_addr.sin6_addr);
             dlog("Using IPv6 ::1 for localhost");
         } else {
-            dlog("ERROR: Invalid IPv6 address: %s", server_addr);
+            log_error("Invalid IPv6 address: %s", server_addr);
             close(config->sock);
             return -1;
         }
@@ -367,7 +370,7 @@ int init_nexus_client(network_context_t *ctx, const char *server_addr, uint16_t
     
     // Initialize TLS context for client BEFORE creating the ngtcp2 connection
     if (init_client_crypto_context(config) != 0) {
-        dlog("ERROR: Failed to initialize client crypto context");
+        log_error("Failed to initialize client crypto context");
         close(config->sock);
         return -1;
     }
@@ -378,7 +381,7 @@ int init_nexus_client(network_context_t *ctx, const char *server_addr, uint16_t
                                     &config->settings, &params, NULL, config);
     
     if (ret != 0) {
-        dlog("ERROR: Failed to create QUIC client connection: %s", ngtcp2_strerror(ret));
+        log_error("Failed to create QUIC client connection: %s", ngtcp2_strerror(ret));
         cleanup_client_crypto_context(config);
         close(config->sock);
         return -1;
@@ -386,7 +389,7 @@ int init_nexus_client(network_context_t *ctx, const char *server_addr, uint16_t
 
     // Connect the SSL context to the ngtcp2 connection
     if (!config->crypto_ctx || !config->crypto_ctx->ssl) {
-        dlog("ERROR: Invalid SSL context before setting TLS native handle");
+        log_error("Invalid SSL context before setting TLS native handle");
         cleanup_client_crypto_context(config);
         ngtcp2_conn_del(config->conn);
         config->conn = NULL;
@@ -400,7 +403,7 @@ int init_nexus_client(network_context_t *ctx, const char *server_addr, uint16_t
     
     // Complete the SSL configuration now that the connection is created and linked
     if (complete_client_crypto_setup(config) != 0) {
-        dlog("ERROR: Failed to complete client crypto setup");
+        log_error("Failed to complete client crypto setup");
         cleanup_client_crypto_context(config);
         ngtcp2_conn_del(config->conn);
         config->conn = NULL;
@@ -419,7 +422,7 @@ int init_nexus_client(network_context_t *ctx, const char *server_addr, uint16_t
         if (strcmp(config->bind_address, "localhost") == 0 || strcmp(config->bind_address, "127.0.0.1") == 0) {
             inet_pton(AF_INET6, "::1", &peer_addr.sin6_addr);
         } else {
-            dlog("ERROR: Invalid IPv6 address for peer: %s", config->bind_address);
+            log_error("Invalid IPv6 address for peer: %s", config->bind_address);
             cleanup_client_crypto_context(config);
             ngtcp2_conn_del(config->conn);
             config->conn = NULL;
@@ -439,7 +442,7 @@ int init_nexus_client(network_context_t *ctx, const char *server_addr, uint16_t
     
     // Start the connection process
     if (nexus_client_connect(config) != 0) {
-        dlog("ERROR: Failed to start client connection");
+        log_error("Failed to start client connection");
         nexus_client_cleanup(config);
         return -1;
     }
@@ -492,7 +495,7 @@ int nexus_client_connect(nexus_client_config_t *config) {
                 inet_pton(AF_INET6, "::1", &server_addr.sin6_addr);
                 dlog("Using IPv6 ::1 for localhost");
             } else {
-                dlog("ERROR: Invalid IPv6 address: %s", config->bind_address);
+                log_error("Invalid IPv6 address: %s", config->bind_address);
                 return -1;
             }
         }
@@ -513,12 +516,12 @@ int nexus_client_connect(nexus_client_config_t *config) {
                              (struct sockaddr*)&server_addr, sizeof(server_addr));
         
         if (sent < 0) {
-            dlog("ERROR: Failed to send initial packet: %s", strerror(errno));
+            log_error("Failed to send initial packet: %s", strerror(errno));
             return -1;
         }
         dlog("Sent initial handshake packet (%zd bytes)", sent);
     } else if (n < 0) {
-        dlog("ERROR: Failed to generate initial packet: %s", ngtcp2_strerror((int)n));
+        log_error("Failed to generate initial packet: %s", ngtcp2_strerror((int)n));
         return -1;
     }
 
@@ -545,7 +548,7 @@ int nexus_client_process_events(nexus_client_config_t *config) {
         ngtcp2_pkt_info pi = {0};
         int rv = ngtcp2_conn_read_pkt(config->conn, &path, &pi, buf, nread, get_timestamp());
         if (rv != 0 && rv != NGTCP2_ERR_DECRYPT) { 
-            dlog("ERROR: ngtcp2_conn_read_pkt failed: %s", ngtcp2_strerror(rv));
+            log_error("ngtcp2_conn_read_pkt failed: %s", ngtcp2_strerror(rv));
         }
 
         uint8_t send_buf[65535];
@@ -558,42 +561,223 @@ int nexus_client_process_events(nexus_client_config_t *config) {
         if (n > 0) {
             sendto(config->sock, send_buf, n, 0, (struct sockaddr*)&server_addr_events, server_len);
         } else if (n < 0 && n != NGTCP2_ERR_NOBUF && n != NGTCP2_ERR_CALLBACK_FAILURE) {
-            dlog("ERROR: ngtcp2_conn_write_pkt after read failed: %s", ngtcp2_strerror((int)n));
+            log_error("ngtcp2_conn_write_pkt after read failed: %s", ngtcp2_strerror((int)n));
         }
+        return 1;
     } else if (nread < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-        dlog("ERROR: recvfrom failed: %s", strerror(errno));
+        log_error("recvfrom failed: %s", strerror(errno));
         return -1; 
     }
     return 0;
 }
 
+// Server address in the form sendto() wants, with the same localhost
+// fallback as nexus_client_connect()
+static int client_peer_addr(const nexus_client_config_t *config, struct sockaddr_in6 *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin6_family = AF_INET6;
+    addr->sin6_port = htons(config->port);
+    if (inet_pton(AF_INET6, config->bind_address, &addr->sin6_addr) == 1) {
+        return 0;
+    }
+    if (strcmp(config->bind_address, "localhost") == 0 || strcmp(config->bind_address, "127.0.0.1") == 0) {
+        inet_pton(AF_INET6, "::1", &addr->sin6_addr);
+        return 0;
+    }
+    log_error("Invalid IPv6 address: %s", config->bind_address);
+    return -1;
+}
+
+// Write packets until the connection has nothing more to send
+static int client_write_pending(nexus_client_config_t *config, const struct sockaddr_in6 *peer) {
+    uint8_t send_buf[65535];
+    for (;;) {
+        ngtcp2_path_storage ps;
+        ngtcp2_path_storage_zero(&ps);
+        ngtcp2_pkt_info pktinfo = {0};
+
+        ssize_t n = ngtcp2_conn_write_pkt(config->conn, &ps.path, &pktinfo,
+                                         send_buf, sizeof(send_buf), get_timestamp());
+        if (n == 0) {
+            return 0;
+        }
+        if (n < 0) {
+            if (n == NGTCP2_ERR_NOBUF) return 0;
+            log_error("ngtcp2_conn_write_pkt failed: %s", ngtcp2_strerror((int)n));
+            return -1;
+        }
+        if (sendto(config->sock, send_buf, (size_t)n, 0, (const struct sockaddr*)peer, sizeof(*peer)) < 0 &&
+            errno != EAGAIN && errno != EWOULDBLOCK) {
+            log_error("sendto failed: %s", strerror(errno));
+            return -1;
+        }
+    }
+}
+
+int nexus_client_flush(nexus_client_config_t *config) {
+    if (!config || !config->conn || config->sock < 0) {
+        return -1;
+    }
+
+    struct sockaddr_in6 peer;
+    if (client_peer_addr(config, &peer) != 0) {
+        return -1;
+    }
+
+    ngtcp2_tstamp now = get_timestamp();
+    if (ngtcp2_conn_get_expiry(config->conn) <= now) {
+        int rv = ngtcp2_conn_handle_expiry(config->conn, now);
+        if (rv != 0) {
+            // NGTCP2_ERR_IDLE_CLOSE lands here too; the connection is finished either way
+            log_debug("ngtcp2_conn_handle_expiry: %s", ngtcp2_strerror(rv));
+            return -1;
+        }
+    }
+    return client_write_pending(config, &peer);
+}
+
+void nexus_client_close(nexus_client_config_t *config) {
+    if (!config || !config->conn || config->sock < 0) {
+        return;
+    }
+    if (ngtcp2_conn_in_closing_period(config->conn) || ngtcp2_conn_in_draining_period(config->conn)) {
+        return;
+    }
+
+    struct sockaddr_in6 peer;
+    if (client_peer_addr(config, &peer) != 0) {
+        return;
+    }
+
+    uint8_t send_buf[65535];
+    ngtcp2_path_storage ps;
+    ngtcp2_path_storage_zero(&ps);
+    ngtcp2_pkt_info pktinfo = {0};
+    ngtcp2_ccerr ccerr;
+    ngtcp2_ccerr_default(&ccerr);
+
+    ssize_t n = ngtcp2_conn_write_connection_close(config->conn, &ps.path, &pktinfo,
+                                                  send_buf, sizeof(send_buf), &ccerr, get_timestamp());
+    if (n > 0) {
+        sendto(config->sock, send_buf, (size_t)n, 0, (struct sockaddr*)&peer, sizeof(peer));
+    } else if (n < 0) {
+        log_debug("ngtcp2_conn_write_connection_close: %s", ngtcp2_strerror((int)n));
+    }
+}
+
+int64_t nexus_client_send_packet(nexus_client_config_t *config, const nexus_packet_t *packet) {
+    if (!config || !config->conn || !packet) {
+        return -1;
+    }
+
+    uint8_t request_buf[2048];
+    ssize_t request_len = serialize_nexus_packet(packet, request_buf, sizeof(request_buf));
+    if (request_len < 0) {
+        log_error("Client: Failed to serialize NEXUS packet type %d.", packet->type);
+        return -3;
+    }
+
+    // Requests are small enough to go out in one packet, so only open the
+    // stream once there is room to send it
+    if (ngtcp2_conn_get_cwnd_left(config->conn) < (uint64_t)request_len + 64) {
+        return -5;
+    }
+
+    struct sockaddr_in6 peer;
+    if (client_peer_addr(config, &peer) != 0) {
+        return -1;
+    }
+
+    int64_t stream_id = -1;
+    int rv = ngtcp2_conn_open_bidi_stream(config->conn, &stream_id, NULL);
+    if (rv != 0) {
+        if (rv != NGTCP2_ERR_STREAM_ID_BLOCKED) {
+            log_error("Client: Failed to open bidirectional stream: %s", ngtcp2_strerror(rv));
+        }
+        return -4;
+    }
+
+    uint8_t send_buf[65535];
+    size_t offset = 0;
+    while (offset < (size_t)request_len) {
+        ngtcp2_path_storage ps;
+        ngtcp2_path_storage_zero(&ps);
+        ngtcp2_pkt_info pktinfo = {0};
+        ngtcp2_ssize consumed = -1;
+
+        ngtcp2_ssize n = ngtcp2_conn_write_stream(config->conn, &ps.path, &pktinfo,
+                                                  send_buf, sizeof(send_buf), &consumed,
+                                                  NGTCP2_WRITE_STREAM_FLAG_FIN, stream_id,
+                                                  request_buf + offset, (size_t)request_len - offset,
+                                                  get_timestamp());
+        if (n < 0) {
+            if (n == NGTCP2_ERR_STREAM_DATA_BLOCKED) {
+                log_warn("Client: Stream %" PRId64 " blocked by flow control with %zu of %zd bytes sent.",
+                         stream_id, offset, request_len);
+                return -5;
+            }
+            log_error("Client: Failed to write stream %" PRId64 ": %s", stream_id, ngtcp2_strerror((int)n));
+            return -6;
+        }
+        if (n == 0) {
+            log_warn("Client: Congestion limited with %zu of %zd bytes sent on stream %" PRId64 ".",
+                     offset, request_len, stream_id);
+            break;
+        }
+        if (consumed > 0) {
+            offset += (size_t)consumed;
+        }
+        if (sendto(config->sock, send_buf, (size_t)n, 0, (struct sockaddr*)&peer, sizeof(peer)) < 0 &&
+            errno != EAGAIN && errno != EWOULDBLOCK) {
+            log_error("Client: sendto failed: %s", strerror(errno));
+            return -6;
+        }
+    }
+    return stream_id;
+}
+
 static int client_on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
                                uint64_t offset, const uint8_t *data, size_t datalen, 
                                void *user_data, void *stream_user_data) {
-    (void)conn; (void)flags; (void)offset; (void)stream_user_data;
-    dlog("Client: Received %zu bytes on stream %ld", datalen, stream_id);
+    (void)flags; (void)offset; (void)stream_user_data;
+    log_debug("Client: Received %zu bytes on stream %ld", datalen, stream_id);
 
     if (!user_data) {
-        dlog("ERROR: Client: No user_data (client_config) in on_stream_data.");
+        log_error("Client: No user_data (client_config) in on_stream_data.");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
+    nexus_client_config_t *config = (nexus_client_config_t *)user_data;
+
+    // Hand the flow control credit straight back, or long-lived
+    // connections stall once initial_max_data has been received
+    ngtcp2_conn_extend_max_stream_offset(conn, stream_id, datalen);
+    ngtcp2_conn_extend_max_offset(conn, datalen);
 
     nexus_packet_t response_packet;
     memset(&response_packet, 0, sizeof(response_packet));
 
     ssize_t bytes_read = deserialize_nexus_packet(data, datalen, &response_packet);
     if (bytes_read < 0) {
-        dlog("ERROR: Client: Failed to deserialize NEXUS packet on stream %ld.", stream_id);
+        log_error("Client: Failed to deserialize NEXUS packet on stream %ld.", stream_id);
+        if (config->on_response) {
+            config->on_response(config->response_user_data, stream_id, NULL);
+        }
         return 0; 
     }
 
-    dlog("Client: Deserialized packet type %d from stream %ld", response_packet.type, stream_id);
+    if (config->on_response) {
+        config->on_response(config->response_user_data, stream_id, &response_packet);
+        free(response_packet.data);
+        return 0;
+    }
+
+    log_debug("Client: Deserialized packet type %d from stream %ld", response_packet.type, stream_id);
 
     switch (response_packet.type) {
         case PACKET_TYPE_TLD_REGISTER_RESP: {
             payload_tld_register_resp_t resp_payload;
             if (deserialize_payload_tld_register_resp(response_packet.data, response_packet.data_len, &resp_payload) < 0) {
-                dlog("ERROR: Client: Failed to deserialize TLD_REGISTER_RESP payload on stream %ld.", stream_id);
+                log_error("Client: Failed to deserialize TLD_REGISTER_RESP payload on stream %ld.", stream_id);
             } else {
                 dlog("Client: TLD Registration Response on stream %ld: Status %d, Message: '%s'", 
                         stream_id, resp_payload.status, resp_payload.message);
@@ -601,7 +785,7 @@ static int client_on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stre
             break;
         }
         default:
-            dlog("WARNING: Client: Received unhandled packet type %d on stream %ld.", response_packet.type, stream_id);
+            log_warn("Client: Received unhandled packet type %d on stream %ld.", response_packet.type, stream_id);
             break;
     }
     free(response_packet.data); 
@@ -610,7 +794,7 @@ static int client_on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stre
 
 int64_t nexus_client_send_tld_register_request(nexus_client_config_t* client_config, const char* tld_name) {
     if (!client_config || !client_config->conn || !tld_name) {
-        dlog("ERROR: Client: Invalid arguments for send_tld_register_request.");
+        log_error("Client: Invalid arguments for send_tld_register_request.");
         return -1;
     }
 
@@ -621,7 +805,7 @@ int64_t nexus_client_send_tld_register_request(nexus_client_config_t* client_con
     uint8_t payload_buf[sizeof(payload_tld_register_req_t) + 1]; 
     ssize_t payload_len = serialize_payload_tld_register_req(&req_payload, payload_buf, sizeof(payload_buf));
     if (payload_len < 0) {
-        dlog("ERROR: Client: Failed to serialize TLD_REGISTER_REQ payload.");
+        log_error("Client: Failed to serialize TLD_REGISTER_REQ payload.");
         return -2;
     }
 
@@ -633,50 +817,12 @@ int64_t nexus_client_send_tld_register_request(nexus_client_config_t* client_con
     request_packet.data = payload_buf;
     request_packet.data_len = payload_len;
 
-    uint8_t final_request_buf[1024]; 
-    ssize_t final_request_len = serialize_nexus_packet(&request_packet, final_request_buf, sizeof(final_request_buf));
-    if (final_request_len < 0) {
-        dlog("ERROR: Client: Failed to serialize final NEXUS packet for TLD registration.");
-        return -3;
-    }
-
-    int64_t stream_id = -1;
-    int rv = ngtcp2_conn_open_bidi_stream(client_config->conn, &stream_id, NULL);
-    if (rv != 0) {
-        dlog("ERROR: Client: Failed to open bidirectional stream: %s", ngtcp2_strerror(rv));
-        return -4;
-    }
-    dlog("Client: Opened bidirectional stream %ld for TLD registration.", stream_id);
-    
-    ssize_t bytes_written_or_code = 0; 
-    rv = ngtcp2_conn_write_stream(client_config->conn, NULL, NULL, 
-                                 NULL, 0, &bytes_written_or_code,
-                                 NGTCP2_STREAM_DATA_FLAG_FIN, stream_id, final_request_buf, final_request_len, 
-                                 get_timestamp());
-
-    if (rv == 0) { 
-        if (bytes_written_or_code < 0) { 
-            if (bytes_written_or_code == NGTCP2_ERR_STREAM_DATA_BLOCKED) {
-                 dlog("WARNING: Client: TLD_REGISTER_REQ for '%s' on stream %ld (%zd bytes) was blocked. Data not sent. Implement queueing.", 
-                     tld_name, stream_id, final_request_len);
-                 return -5; 
-            } else {
-                dlog("ERROR: Client: Stream error while writing TLD_REGISTER_REQ to stream %ld: %s (code %zd)", 
-                    stream_id, ngtcp2_strerror(bytes_written_or_code), bytes_written_or_code);
-                return -7; 
-            }
-        } else {
-            dlog("Client: TLD_REGISTER_REQ for '%s' on stream %ld: %zd bytes accepted by ngtcp2 (total %zd).", 
-                 tld_name, stream_id, bytes_written_or_code, final_request_len);
-            if ((size_t)bytes_written_or_code < (size_t)final_request_len) {
-                 dlog("WARNING: Client: Only %zd of %zd bytes were accepted by ngtcp2. Implement partial send handling.", 
-                      bytes_written_or_code, final_request_len);
-            }
-        }
-    } else { 
-        dlog("ERROR: Client: Failed to call ngtcp2_conn_write_stream for TLD_REGISTER_REQ: %s", ngtcp2_strerror(rv));
-        return -6;
+    int64_t stream_id = nexus_client_send_packet(client_config, &request_packet);
+    if (stream_id < 0) {
+        log_error("Client: Failed to send TLD_REGISTER_REQ for '%s' (%" PRId64 ").", tld_name, stream_id);
+        return stream_id;
     }
+    dlog("Client: Sent TLD_REGISTER_REQ for '%s' on stream %" PRId64 ".", tld_name, stream_id);
     return stream_id;
 }
 
@@ -708,25 +854,25 @@ ssize_t nexus_node_send_receive_packet(
 
     int rv = ngtcp2_conn_open_bidi_stream(node->client_config.conn, &stream_ctx.stream_id, NULL );
     if (rv != 0) {
-        dlog("ERROR: Failed to open bi-directional stream: %s", ngtcp2_strerror(rv));
+        log_error("Failed to open bi-directional stream: %s", ngtcp2_strerror(rv));
         return -1; 
     }
-    dlog("Client: Opened new bi-directional stream ID %lld for request/response", stream_ctx.stream_id);
+    log_debug("Client: Opened new bi-directional stream ID %" PRId64 " for request/response", stream_ctx.stream_id);
     
     ssize_t stream_data_consumed = 0; 
     rv = ngtcp2_conn_write_stream(node->client_config.conn, NULL, NULL, NULL, 0, &stream_data_consumed, NGTCP2_STREAM_DATA_FLAG_FIN, stream_ctx.stream_id, (uint8_t*)request_data, request_len, get_timestamp());
     if (rv != 0 && rv != NGTCP2_ERR_STREAM_DATA_BLOCKED) { 
-        dlog("ERROR: Failed to write initial stream data for request: %s (%d)", ngtcp2_strerror(rv), rv);
+        log_error("Failed to write initial stream data for request: %s (%d)", ngtcp2_strerror(rv), rv);
         return -1;
     }
      if (rv == NGTCP2_ERR_STREAM_DATA_BLOCKED || (stream_data_consumed >=0 && (size_t)stream_data_consumed < request_len)) {
-        dlog("WARNING: Stream %lld data send blocked or partial (%zd/%zu). Synchronous send incomplete.", stream_ctx.stream_id, stream_data_consumed, request_len);
+        log_warn("Stream %" PRId64 " data send blocked or partial (%zd/%zu). Synchronous send incomplete.", stream_ctx.stream_id, stream_data_consumed, request_len);
     }
     stream_ctx.request_sent = 1;
-    dlog("Client Stream %lld: Queued/Sent %zd of %zu bytes for sending.", stream_ctx.stream_id, stream_data_consumed > 0 ? stream_data_consumed : 0, request_len);
+    log_debug("Client Stream %" PRId64 ": Queued/Sent %zd of %zu bytes for sending.", stream_ctx.stream_id, stream_data_consumed > 0 ? stream_data_consumed : 0, request_len);
 
     if (nexus_client_process_events(&node->client_config) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-         dlog("ERROR: Client Stream %lld: Error in nexus_client_process_events after send.", stream_ctx.stream_id);
+         log_error("Client Stream %" PRId64 ": Error in nexus_client_process_events after send.", stream_ctx.stream_id);
     }
 
     struct timeval start_time, current_time;
@@ -735,7 +881,7 @@ ssize_t nexus_node_send_receive_packet(
 
     while (!stream_ctx.response_received && !stream_ctx.error_occurred && elapsed_ms < timeout_ms) {
         if (nexus_client_process_events(&node->client_config) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-             dlog("ERROR: Client Stream %lld: Error in nexus_client_process_events during wait.", stream_ctx.stream_id);
+             log_error("Client Stream %" PRId64 ": Error in nexus_client_process_events during wait.", stream_ctx.stream_id);
              stream_ctx.error_occurred = 1; 
              break;
         }
@@ -749,13 +895,13 @@ ssize_t nexus_node_send_receive_packet(
     }
 
     if (stream_ctx.error_occurred) {
-        dlog("Client Stream %lld: Error occurred during request/response.", stream_ctx.stream_id);
+        log_error("Client Stream %" PRId64 ": Error occurred during request/response.", stream_ctx.stream_id);
         if (stream_ctx.response_buffer) free(stream_ctx.response_buffer);
         return -1; 
     }
 
     if (!stream_ctx.response_received) { 
-        dlog("Client Stream %lld: Timeout waiting for response (%ld ms).", stream_ctx.stream_id, elapsed_ms);
+        dlog("Client Stream %" PRId64 ": Timeout waiting for response (%ld ms).", stream_ctx.stream_id, elapsed_ms);
         if (stream_ctx.response_buffer) free(stream_ctx.response_buffer);
         // TODO: Fix ngtcp2_conn_shutdown_stream API compatibility
         // ngtcp2_conn_shutdown_stream(node->client_config.conn, 0, stream_ctx.stream_id, NGTCP2_INTERNAL_ERROR);
@@ -765,7 +911,7 @@ ssize_t nexus_node_send_receive_packet(
     if (stream_ctx.response_data_len > 0 && stream_ctx.response_buffer) {
         *response_data_out = malloc(stream_ctx.response_data_len);
         if (!*response_data_out) {
-            dlog("Client Stream %lld: ERROR - Failed to allocate for final response_data_out.", stream_ctx.stream_id);
+            log_error("Client Stream %" PRId64 ": Failed to allocate for final response_data_out.", stream_ctx.stream_id);
             free(stream_ctx.response_buffer);
             return -3; 
         }
@@ -797,14 +943,14 @@ static int client_get_new_connection_id(ngtcp2_conn *conn, ngtcp2_cid *cid,
     (void)user_data;
     
     if (RAND_bytes(cid->data, cidlen) != 1) {
-        dlog("CRITICAL: client_get_new_connection_id: RAND_bytes failed!");
+        log_error("CRITICAL: client_get_new_connection_id: RAND_bytes failed!");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
     
     cid->datalen = cidlen;
     
     if (RAND_bytes(token, NGTCP2_STATELESS_RESET_TOKENLEN) != 1) {
-        dlog("CRITICAL: client_get_new_connection_id: RAND_bytes for token failed!");
+        log_error("CRITICAL: client_get_new_connection_id: RAND_bytes for token failed!");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
     
@@ -862,7 +1008,7 @@ static int client_get_path_challenge_data(ngtcp2_conn *conn, uint8_t *data, void
     
     // Generate random data for path challenge
     if (RAND_bytes(data, NGTCP2_PATH_CHALLENGE_DATALEN) != 1) {
-        dlog("ERROR: Failed to generate random data for path challenge");
+        log_error("Failed to generate random data for path challenge");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
     
@@ -4,6 +4,10 @@
 #include "../include/network_context.h"
 #include "../include/certificate_authority.h"
 #include "../include/debug.h"
+#include "../include/nexus_client_api.h"
+#include "../include/ct_gossip.h"
+#include "../include/tld_sync.h"
+#include "../include/metrics.h"
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -126,6 +130,15 @@ void* server_thread_func(void* arg) {
 }
 
 
+#define CT_GOSSIP_EXCHANGE_TIMEOUT_MS 5000
+
+// Carry a batch of CT gossip (or TLD sync) packets to the connected server
+// on one stream
+static ssize_t ct_gossip_exchange(void* ctx, const uint8_t* request, size_t request_len, uint8_t** response_out) {
+    return nexus_node_send_receive_packet((nexus_node_t*)ctx, request, request_len, response_out,
+                                          CT_GOSSIP_EXCHANGE_TIMEOUT_MS);
+}
+
 void* client_thread_func(void* arg) {
     nexus_node_t* node = (nexus_node_t*)arg;
     bool client_initialized = false;
@@ -173,6 +186,17 @@ void* client_thread_func(void* arg) {
                 if (!node->client_config.handshake_completed) {
                     dlog("QUIC handshake completed on client side!");
                     node->client_config.handshake_completed = 1;
+
+                    // Federated nodes keep their CT log in step with the server
+                    if (node->net_ctx->mode == 2 && node->net_ctx->ct_gossip) {
+                        ct_gossip_add_peer(node->net_ctx->ct_gossip, "upstream",
+                                           ct_gossip_exchange, node);
+                    }
+                    // ...and reconcile their TLD mirrors against it
+                    if (node->net_ctx->mode == 2 && node->net_ctx->tld_sync) {
+                        tld_sync_add_peer(node->net_ctx->tld_sync, "upstream",
+                                          ct_gossip_exchange, node);
+                    }
                 }
             }
             
@@ -186,7 +210,14 @@ void* client_thread_func(void* arg) {
         idle_count++;
         if (idle_count >= 10) {
             idle_count = 0;
-            // Optionally add some idle processing here
+            if (node->client_config.handshake_completed && node->net_ctx->ct_gossip &&
+                ct_gossip_tick(node->net_ctx->ct_gossip) != 0) {
+                log_warn("CT gossip detected a split view");
+            }
+            if (node->client_config.handshake_completed && node->net_ctx->tld_sync &&
+                tld_sync_tick(node->net_ctx->tld_sync) != 0) {
+                log_warn("TLD sync failed to reconcile a mirror");
+            }
         }
     }
     
@@ -208,11 +239,14 @@ void cleanup_node(nexus_node_t *node) {
     if (node->server_config.conn) {
         ngtcp2_conn_del(node->server_config.conn);
         node->server_config.conn = NULL;
+        metrics_inc(METRIC_CONNECTIONS_CLOSED);
     }
     if (node->server_config.sock > 0) {
         close(node->server_config.sock);
         node->server_config.sock = -1;
     }
+    cleanup_query_arena(node->server_config.query_arena);
+    node->server_config.query_arena = NULL;
 
     // Cleanup client
     free(node->client_config.bind_address); // Free strdup'd memory
@@ -24,6 +24,12 @@
 #include <ngtcp2/ngtcp2_crypto_ossl.h>      // For OpenSSL (vanilla) specific helpers
 #include "../include/network_context.h"
 #include "../include/tld_manager.h"     // For TLD management functions
+#include "../include/ct_gossip.h"       // For CT log gossip requests
+#include "../include/tld_sync.h"        // For TLD mirror anti-entropy requests
+#include "../include/metrics.h"         // For packet and connection counters
+#include "../include/query_trace.h"     // For sampled per-query stage timing
+#include "../include/doq.h"             // For DNS-over-QUIC streams
+#include "../include/answer_cache.h"    // For serialized DNS answers
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -65,41 +71,199 @@ static void ngtcp2_log_wrapper(void *user_data, const char *format, ...) {
 static int on_stream_open(ngtcp2_conn *conn, int64_t stream_id, void *user_data) {
     (void)conn;      // Suppress unused parameter warning
     (void)user_data; // Suppress unused parameter warning
-    dlog("New stream opened: %ld", stream_id);
+    log_debug("New stream opened: %ld", stream_id);
     return 0;  // Return success
 }
 
+// Answers one request packet of a pipelined stream
+typedef int (*pipelined_packet_fn)(void *ctx, const nexus_packet_t *request, uint8_t **response_out,
+                                   size_t *response_len_out);
+
+static int answer_ct_gossip_packet(void *ctx, const nexus_packet_t *request, uint8_t **response_out,
+                                   size_t *response_len_out) {
+    return ct_gossip_handle_packet((ct_log_t *)ctx, request, response_out, response_len_out);
+}
+
+static int answer_tld_sync_packet(void *ctx, const nexus_packet_t *request, uint8_t **response_out,
+                                  size_t *response_len_out) {
+    network_context_t *net_ctx = (network_context_t *)ctx;
+    return tld_sync_handle_packet(net_ctx->tld_manager, persistence_journal(net_ctx->persistence),
+                                  request, response_out, response_len_out);
+}
+
+// Answer pipelined CT gossip or TLD sync requests: every packet in data gets
+// a response, and the responses go back in order as one stream write.
+static int handle_pipelined_stream(ngtcp2_conn *conn, int64_t stream_id, const char *what,
+                                   pipelined_packet_fn answer, void *ctx,
+                                   const uint8_t *data, size_t datalen) {
+    uint8_t *out = NULL;
+    size_t out_len = 0;
+    size_t offset = 0;
+
+    while (offset < datalen) {
+        nexus_packet_t request;
+        memset(&request, 0, sizeof(request));
+        ssize_t consumed = deserialize_nexus_packet(data + offset, datalen - offset, &request);
+        if (consumed <= 0) break;
+        offset += (size_t)consumed;
+        metrics_count_packet(request.type);
+
+        uint8_t *resp = NULL;
+        size_t resp_len = 0;
+        int rc = answer(ctx, &request, &resp, &resp_len);
+        free(request.data);
+        if (rc != 0) {
+            log_error("Server: Failed to answer %s packet type %d", what, request.type);
+            break;
+        }
+
+        uint8_t *grown = realloc(out, out_len + resp_len);
+        if (!grown) {
+            free(resp);
+            break;
+        }
+        out = grown;
+        memcpy(out + out_len, resp, resp_len);
+        out_len += resp_len;
+        free(resp);
+    }
+
+    if (out_len > 0) {
+        int rv = ngtcp2_conn_write_stream(conn, NULL, NULL,
+                                        NULL, 0, NULL,
+                                        NGTCP2_STREAM_DATA_FLAG_NONE, stream_id, out, out_len,
+                                        get_timestamp());
+        if (rv != 0 && rv != NGTCP2_ERR_STREAM_DATA_BLOCKED && rv != NGTCP2_ERR_STREAM_SHUT_WR) {
+            log_error("Server: Failed to write %s response: %s (%d)", what, ngtcp2_strerror(rv), rv);
+        }
+        log_debug("Server: Sent %zu bytes of %s responses on stream %ld", out_len, what, stream_id);
+    }
+    free(out);
+    return 0;
+}
+
+// DNS over QUIC: collect the stream's query, then answer it and close our
+// side of the stream. The stream state lives until on_stream_close.
+static int handle_doq_stream(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
+                             const uint8_t *data, size_t datalen, dns_resolver_t *resolver,
+                             doq_stream_t *stream) {
+    if (!stream) {
+        if (init_doq_stream(&stream) != 0) {
+            ngtcp2_conn_shutdown_stream(conn, 0, stream_id, DOQ_INTERNAL_ERROR);
+            return 0;
+        }
+        ngtcp2_conn_set_stream_user_data(conn, stream_id, stream);
+    }
+
+    int rv = doq_stream_receive(stream, data, datalen, (flags & NGTCP2_STREAM_DATA_FLAG_FIN) != 0);
+    if (rv == DOQ_STREAM_INCOMPLETE) return 0;
+    if (rv < 0) {
+        log_debug("Server: Malformed DoQ request on stream %ld", stream_id);
+        ngtcp2_conn_shutdown_stream(conn, 0, stream_id, DOQ_PROTOCOL_ERROR);
+        return 0;
+    }
+
+    // The resolver records its own stages
+    query_trace_begin(PACKET_TYPE_DNS_QUERY);
+    int error = resolver ? doq_stream_answer(stream, resolver) : DOQ_INTERNAL_ERROR;
+    if (error != 0) {
+        log_debug("Server: DoQ request on stream %ld failed with error %d", stream_id, error);
+        ngtcp2_conn_shutdown_stream(conn, 0, stream_id, (uint64_t)error);
+        query_trace_end(-1);
+        return 0;
+    }
+    metrics_inc(METRIC_DOQ_QUERIES);
+
+    uint64_t trace_start = query_trace_stage_start();
+    rv = ngtcp2_conn_write_stream(conn, NULL, NULL,
+                                  NULL, 0, NULL,
+                                  NGTCP2_WRITE_STREAM_FLAG_FIN, stream_id, stream->response, stream->response_len,
+                                  get_timestamp());
+    query_trace_stage_end(TRACE_STAGE_STREAM_WRITE, trace_start);
+    if (rv != 0 && rv != NGTCP2_ERR_STREAM_DATA_BLOCKED && rv != NGTCP2_ERR_STREAM_SHUT_WR) {
+        log_error("Server: Failed to write DoQ answer: %s (%d)", ngtcp2_strerror(rv), rv);
+    }
+    query_trace_end(stream->response[2 + 3] & 0x0F);    // The answer's RCODE
+    return 0;
+}
+
+static int on_stream_close(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
+                           uint64_t app_error_code, void *user_data, void *stream_user_data) {
+    (void)conn; (void)flags; (void)app_error_code; (void)user_data;
+    // Only DoQ streams carry state
+    cleanup_doq_stream((doq_stream_t *)stream_user_data);
+    log_debug("Stream closed: %ld", stream_id);
+    return 0;
+}
+
 static int on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
                          uint64_t offset_stream_data, const uint8_t *data,
                          size_t datalen, void *user_data, void *stream_user_data) {
-    (void)flags;
     (void)offset_stream_data; // This offset is for the stream itself, not our buffer parsing.
-    (void)stream_user_data;
 
-    dlog("Server: Received %zu bytes on stream %ld", datalen, stream_id);
+    log_debug("Server: Received %zu bytes on stream %ld", datalen, stream_id);
+    metrics_add(METRIC_STREAM_BYTES_RECEIVED, datalen);
 
     if (!user_data) {
-        dlog("ERROR: Server: No user_data (server_config) in on_stream_data callback.");
+        log_error("Server: No user_data (server_config) in on_stream_data callback.");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
     nexus_server_config_t* server_config = (nexus_server_config_t*)user_data;
     if (!server_config->net_ctx || !server_config->net_ctx->tld_manager) {
-        dlog("ERROR: Server: Network context or TLD manager not initialized in server_config.");
+        log_error("Server: Network context or TLD manager not initialized in server_config.");
+        return NGTCP2_ERR_CALLBACK_FAILURE;
+    }
+    if (!server_config->query_arena) {
+        log_error("Server: Request arena not initialized in server_config.");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
 
+    // Clients that negotiated "doq" speak plain DNS messages
+    const unsigned char *alpn = NULL;
+    unsigned int alpn_len = 0;
+    if (server_config->crypto_ctx && server_config->crypto_ctx->ssl) {
+        SSL_get0_alpn_selected(server_config->crypto_ctx->ssl, &alpn, &alpn_len);
+    }
+    if (doq_alpn_selected(alpn, alpn_len)) {
+        return handle_doq_stream(conn, flags, stream_id, data, datalen, server_config->net_ctx->dns_resolver,
+                                 (doq_stream_t *)stream_user_data);
+    }
+
+    // CT gossip and TLD sync requests are pipelined, so they are parsed as a batch
+    if (server_config->net_ctx->ct_log && datalen > 1 &&
+        (data[1] == PACKET_TYPE_CT_STH_REQ || data[1] == PACKET_TYPE_CT_ENTRIES_REQ)) {
+        return handle_pipelined_stream(conn, stream_id, "CT gossip", answer_ct_gossip_packet,
+                                       server_config->net_ctx->ct_log, data, datalen);
+    }
+    if (server_config->net_ctx->tld_manager && datalen > 1 &&
+        (data[1] == PACKET_TYPE_TLD_MERKLE_REQ || data[1] == PACKET_TYPE_TLD_BUCKET_REQ ||
+         data[1] == PACKET_TYPE_TLD_JOURNAL_REQ)) {
+        return handle_pipelined_stream(conn, stream_id, "TLD sync", answer_tld_sync_packet,
+                                       server_config->net_ctx, data, datalen);
+    }
+
+    query_trace_begin(datalen > 1 ? data[1] : -1);
+    int trace_status = 0;
+
+    // Everything this request allocates is released together at the end
+    query_arena_t* arena = server_config->query_arena;
+
     nexus_packet_t received_packet;
     memset(&received_packet, 0, sizeof(nexus_packet_t));
 
-    ssize_t bytes_read = deserialize_nexus_packet(data, datalen, &received_packet);
+    uint64_t trace_start = query_trace_stage_start();
+    ssize_t bytes_read = deserialize_nexus_packet_in_arena(data, datalen, &received_packet, arena);
+    query_trace_stage_end(TRACE_STAGE_DESERIALIZE, trace_start);
     if (bytes_read < 0) {
-        dlog("ERROR: Server: Failed to deserialize NEXUS packet.");
-        // Not freeing received_packet.data as it would be NULL or invalid on error
+        log_error("Server: Failed to deserialize NEXUS packet.");
+        query_arena_reset(arena);
+        query_trace_end(-1);
         return 0; // Consume data, but log error
     }
     // TODO: Potentially loop if datalen > bytes_read, indicating multiple packets in one datagram (unlikely for QUIC streams but good to consider)
+    metrics_count_packet(received_packet.type);
 
-    dlog("Server: Deserialized packet type %d, data_len %u", received_packet.type, received_packet.data_len);
+    log_debug("Server: Deserialized packet type %d, data_len %u", received_packet.type, received_packet.data_len);
 
     nexus_packet_t response_packet; // To store any response we might send
     memset(&response_packet, 0, sizeof(nexus_packet_t));
@@ -108,13 +272,20 @@ static int on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
 
     uint8_t response_payload_buf[1024]; // Max estimated size for response payload
     ssize_t response_payload_len = 0;
+    uint8_t final_response_buf[2048]; // Larger buffer for full nexus packet with DNS records
+    ssize_t final_response_len = -1; // Set early by a DNS answer cache hit
+
+    // A resolved DNS answer is cached once serialized; 0 means not cacheable
+    answer_cache_t* answer_cache = server_config->net_ctx->answer_cache;
+    payload_dns_query_t answered_query;
+    uint64_t answer_generation = 0;
 
     switch (received_packet.type) {
         case PACKET_TYPE_TLD_REGISTER_REQ: {
-            dlog("Server: Received TLD_REGISTER_REQ");
+            log_debug("Server: Received TLD_REGISTER_REQ");
             payload_tld_register_req_t req_payload;
             if (deserialize_payload_tld_register_req(received_packet.data, received_packet.data_len, &req_payload) < 0) {
-                dlog("ERROR: Server: Failed to deserialize TLD_REGISTER_REQ payload.");
+                log_error("Server: Failed to deserialize TLD_REGISTER_REQ payload.");
                 break; // Out of switch case, will free received_packet.data later
             }
 
@@ -139,7 +310,7 @@ static int on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
 
             response_payload_len = serialize_payload_tld_register_resp(&resp_payload, response_payload_buf, sizeof(response_payload_buf));
             if (response_payload_len < 0) {
-                dlog("ERROR: Server: Failed to serialize TLD_REGISTER_RESP payload.");
+                log_error("Server: Failed to serialize TLD_REGISTER_RESP payload.");
                 // No specific cleanup for resp_payload needed as it's stack allocated and contains no pointers
                 break; 
             }
@@ -149,16 +320,32 @@ static int on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
         }
 
         case PACKET_TYPE_DNS_QUERY: {
-            dlog("Server: Received DNS_QUERY");
+            log_debug("Server: Received DNS_QUERY");
             payload_dns_query_t query_payload;
-            if (deserialize_payload_dns_query(received_packet.data, received_packet.data_len, &query_payload) < 0) {
-                dlog("ERROR: Server: Failed to deserialize DNS_QUERY payload.");
+            trace_start = query_trace_stage_start();
+            int query_rv = deserialize_payload_dns_query(received_packet.data, received_packet.data_len, &query_payload);
+            query_trace_stage_end(TRACE_STAGE_DESERIALIZE, trace_start);
+            if (query_rv < 0) {
+                log_error("Server: Failed to deserialize DNS_QUERY payload.");
+                trace_status = -1;
                 break;
             }
+            query_trace_set_name(query_payload.query_name);
 
-            dlog("Server: Query for Name: %s, Type: %d", query_payload.query_name, query_payload.type);
+            log_debug("Server: Query for Name: %s, Type: %d", query_payload.query_name, query_payload.type);
 
             response_packet.type = PACKET_TYPE_DNS_RESPONSE;
+
+            // A hot answer is already serialized; only the session ID and TTLs change
+            ssize_t cached_len = answer_cache_lookup(answer_cache, query_payload.query_name, (uint16_t)query_payload.type,
+                                                     received_packet.version, received_packet.session_id,
+                                                     final_response_buf, sizeof(final_response_buf));
+            if (cached_len > 0) {
+                final_response_len = cached_len;
+                trace_status = DNS_STATUS_SUCCESS;
+                break;
+            }
+
             payload_dns_response_t dns_resp_payload;
             memset(&dns_resp_payload, 0, sizeof(payload_dns_response_t)); // Initializes records to NULL and count to 0
 
@@ -170,44 +357,43 @@ static int on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
             dns_resolver_t* resolver = server_config->net_ctx->dns_resolver;
             
             if (!resolver) {
-                dlog("ERROR: Server: DNS resolver not initialized.");
+                log_error("Server: DNS resolver not initialized.");
                 dns_resp_payload.status = DNS_STATUS_SERVFAIL;
+                trace_status = DNS_STATUS_SERVFAIL;
                 goto serialize_dns_response;
             }
             
-            // Resolve the query
-            dns_response_status_t resolve_status = resolve_dns_query(
+            // Read before resolving so a concurrent change is not cached
+            answered_query = query_payload;
+            answer_generation = answer_cache_generation(answer_cache);
+
+            // Resolve the query; the records live in the request's arena
+            dns_response_status_t resolve_status = resolve_dns_query_in_arena(
                 resolver,
                 query_payload.query_name,
                 query_payload.type,
+                arena,
                 &result_records,
                 &result_count
             );
             
             // Set the response payload based on the resolver results
             dns_resp_payload.status = resolve_status;
+            trace_status = resolve_status;
             dns_resp_payload.record_count = result_count;
             dns_resp_payload.records = result_records;
             
-            dlog("Server: DNS query resolved with status %d, found %d records", resolve_status, result_count);
+            log_debug("Server: DNS query resolved with status %d, found %d records", resolve_status, result_count);
             
             // Label for goto in case of errors
             serialize_dns_response:;
 
+            trace_start = query_trace_stage_start();
             response_payload_len = serialize_payload_dns_response(&dns_resp_payload, response_payload_buf, sizeof(response_payload_buf));
-            
-            // IMPORTANT: Free records memory if it was allocated for the response payload (name and rdata were strdup'd)
-            if (dns_resp_payload.records) {
-                for (int i = 0; i < dns_resp_payload.record_count; ++i) {
-                    if (dns_resp_payload.records[i].name) free(dns_resp_payload.records[i].name);
-                    if (dns_resp_payload.records[i].rdata) free(dns_resp_payload.records[i].rdata);
-                }
-                free(dns_resp_payload.records); // Free the array of records itself
-                dns_resp_payload.records = NULL; // Avoid double free if error occurs after this
-            }
+            query_trace_stage_end(TRACE_STAGE_SERIALIZE, trace_start);
 
             if (response_payload_len < 0) {
-                dlog("ERROR: Server: Failed to serialize DNS_RESPONSE payload.");
+                log_error("Server: Failed to serialize DNS_RESPONSE payload.");
                 // response_packet.data will not be set, so no response sent
                 break; 
             }
@@ -218,39 +404,46 @@ static int on_stream_data(ngtcp2_conn *conn, uint32_t flags, int64_t stream_id,
 
         // TODO: Handle other packet types (..., TLD_MIRROR_REQ, etc.)
         default:
-            dlog("WARNING: Server: Received unhandled packet type %d on stream %ld", received_packet.type, stream_id);
+            log_warn("Server: Received unhandled packet type %d on stream %ld", received_packet.type, stream_id);
             // No response will be sent for unhandled types by default
             break;
     }
 
-    // Free data allocated by deserialize_nexus_packet for the received packet
-    if (received_packet.data) {
-        free(received_packet.data);
-        received_packet.data = NULL;
-    }
-
-    // Send the response packet if its data field is set (i.e., a response was prepared)
-    if (response_packet.data && response_packet.data_len > 0) {
-        uint8_t final_response_buf[2048]; // Larger buffer for full nexus packet with DNS records
-        ssize_t final_response_len = serialize_nexus_packet(&response_packet, final_response_buf, sizeof(final_response_buf));
+    // Serialize the response packet if its data field is set (i.e., a response was prepared)
+    if (final_response_len < 0 && response_packet.data && response_packet.data_len > 0) {
+        trace_start = query_trace_stage_start();
+        final_response_len = serialize_nexus_packet(&response_packet, final_response_buf, sizeof(final_response_buf));
+        query_trace_stage_end(TRACE_STAGE_SERIALIZE, trace_start);
         
         if (final_response_len < 0) {
-            dlog("ERROR: Server: Failed to serialize final response NEXUS packet for type %d.", response_packet.type);
-        } else {
-            // ngtcp2_conn_write_stream or ngtcp2_conn_writev_stream
-            // This requires knowing the stream ID is bidirectional and client is expecting a response on it.
-            // For QUIC, responses are often sent on the same stream the request came on if it's client-initiated bidi.
-            int rv = ngtcp2_conn_write_stream(conn, NULL, NULL, 
-                                            NULL, 0, NULL, // No fin, no early_data, no early_data_ctx, no pnum_written
-                                            NGTCP2_STREAM_DATA_FLAG_NONE, stream_id, final_response_buf, final_response_len, 
-                                            get_timestamp()); // Use current conn timestamp
-            if (rv != 0 && rv != NGTCP2_ERR_STREAM_DATA_BLOCKED && rv != NGTCP2_ERR_STREAM_SHUT_WR) { 
-                dlog("ERROR: Server: Failed to write stream data for response type %d: %s (%d)", response_packet.type, ngtcp2_strerror(rv), rv);
-            }
-            dlog("Server: Sent response type %d, %zd bytes on stream %ld", response_packet.type, final_response_len, stream_id);
+            log_error("Server: Failed to serialize final response NEXUS packet for type %d.", response_packet.type);
+        } else if (answer_generation != 0) {
+            // Rejects failures, zero TTLs and answers resolved before a change
+            answer_cache_insert(answer_cache, answer_generation, answered_query.query_name,
+                                (uint16_t)answered_query.type, response_packet.version,
+                                final_response_buf, (size_t)final_response_len);
         }
     }
 
+    if (final_response_len > 0) {
+        // ngtcp2_conn_write_stream or ngtcp2_conn_writev_stream
+        // This requires knowing the stream ID is bidirectional and client is expecting a response on it.
+        // For QUIC, responses are often sent on the same stream the request came on if it's client-initiated bidi.
+        trace_start = query_trace_stage_start();
+        int rv = ngtcp2_conn_write_stream(conn, NULL, NULL, 
+                                        NULL, 0, NULL, // No fin, no early_data, no early_data_ctx, no pnum_written
+                                        NGTCP2_STREAM_DATA_FLAG_NONE, stream_id, final_response_buf, final_response_len, 
+                                        get_timestamp()); // Use current conn timestamp
+        query_trace_stage_end(TRACE_STAGE_STREAM_WRITE, trace_start);
+        if (rv != 0 && rv != NGTCP2_ERR_STREAM_DATA_BLOCKED && rv != NGTCP2_ERR_STREAM_SHUT_WR) { 
+            log_error("Server: Failed to write stream data for response type %d: %s (%d)", response_packet.type, ngtcp2_strerror(rv), rv);
+        }
+        log_debug("Server: Sent response type %d, %zd bytes on stream %ld", response_packet.type, final_response_len, stream_id);
+    }
+
+    // Releases the received packet and any resolved records
+    query_arena_reset(arena);
+    query_trace_end(trace_status);
     return 0;  // Return success from callback
 }
 
@@ -258,24 +451,39 @@ static int on_handshake_completed(ngtcp2_conn *conn, void *user_data) {
     (void)conn;
     nexus_server_config_t *config = (nexus_server_config_t *)user_data;
     config->handshake_completed = 1;
+    metrics_inc(METRIC_HANDSHAKES_COMPLETED);
     dlog("Server handshake completed");
     return 0;
 }
 
+// Picks the client's protocol: NEXUS framing ("h3") when offered, else
+// DNS over QUIC. QUIC requires a match (RFC 9001 section 8.1).
+static int select_alpn(SSL *ssl, const unsigned char **out, unsigned char *outlen,
+                       const unsigned char *in, unsigned int inlen, void *arg) {
+    (void)ssl;
+    (void)arg;
+    static const unsigned char supported[] = "\x02h3\x03" DOQ_ALPN;
+    if (SSL_select_next_proto((unsigned char **)out, outlen, supported, sizeof(supported) - 1,
+                              in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_ALERT_FATAL;
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
 // Initialize the server's crypto context (TLS)
 static int init_server_crypto_context(nexus_server_config_t *config) {
     if (!config) return -1;
 
     config->crypto_ctx = malloc(sizeof(nexus_server_crypto_ctx));
     if (!config->crypto_ctx) {
-        dlog("ERROR: Server: Failed to allocate crypto context");
+        log_error("Server: Failed to allocate crypto context");
         return -1;
     }
     memset(config->crypto_ctx, 0, sizeof(nexus_server_crypto_ctx));
 
     config->crypto_ctx->ssl_ctx = SSL_CTX_new(TLS_server_method());
     if (!config->crypto_ctx->ssl_ctx) {
-        dlog("ERROR: Server: Failed to create SSL_CTX: %s", ERR_error_string(ERR_get_error(), NULL));
+        log_error("Server: Failed to create SSL_CTX: %s", ERR_error_string(ERR_get_error(), NULL));
         free(config->crypto_ctx);
         config->crypto_ctx = NULL;
         return -1;
@@ -290,7 +498,7 @@ static int init_server_crypto_context(nexus_server_config_t *config) {
         config->cert = config->net_ctx->ca_ctx->ca_cert;
         
         if (SSL_CTX_use_certificate(config->crypto_ctx->ssl_ctx, config->cert->x509) != 1) {
-            dlog("ERROR: Server: Failed to use certificate: %s", ERR_error_string(ERR_get_error(), NULL));
+            log_error("Server: Failed to use certificate: %s", ERR_error_string(ERR_get_error(), NULL));
             SSL_CTX_free(config->crypto_ctx->ssl_ctx);
             free(config->crypto_ctx);
             config->crypto_ctx = NULL;
@@ -299,7 +507,7 @@ static int init_server_crypto_context(nexus_server_config_t *config) {
 
         // Use the CA's private key (which matches the CA's certificate)
         if (SSL_CTX_use_PrivateKey(config->crypto_ctx->ssl_ctx, config->net_ctx->ca_ctx->falcon_pkey) != 1) {
-            dlog("ERROR: Server: Failed to use private key: %s", ERR_error_string(ERR_get_error(), NULL));
+            log_error("Server: Failed to use private key: %s", ERR_error_string(ERR_get_error(), NULL));
             SSL_CTX_free(config->crypto_ctx->ssl_ctx);
             free(config->crypto_ctx);
             config->crypto_ctx = NULL;
@@ -307,14 +515,14 @@ static int init_server_crypto_context(nexus_server_config_t *config) {
         }
 
         if (SSL_CTX_check_private_key(config->crypto_ctx->ssl_ctx) != 1) {
-            dlog("ERROR: Server: Private key does not match the public certificate: %s", ERR_error_string(ERR_get_error(), NULL));
+            log_error("Server: Private key does not match the public certificate: %s", ERR_error_string(ERR_get_error(), NULL));
             SSL_CTX_free(config->crypto_ctx->ssl_ctx);
             free(config->crypto_ctx);
             config->crypto_ctx = NULL;
             return -1;
         }
     } else {
-        dlog("ERROR: Server: CA context not available for certificate generation.");
+        log_error("Server: CA context not available for certificate generation.");
         SSL_CTX_free(config->crypto_ctx->ssl_ctx);
         free(config->crypto_ctx);
         config->crypto_ctx = NULL;
@@ -326,21 +534,14 @@ static int init_server_crypto_context(nexus_server_config_t *config) {
 
     // Comment out problematic ngtcp2 function for now
     // if (ngtcp2_crypto_ossl_configure_server_context(config->crypto_ctx->ssl_ctx) != 0) {
-    //     dlog("ERROR: Server: ngtcp2_crypto_ossl_configure_server_context failed: %s", ERR_error_string(ERR_get_error(), NULL));
+    //     log_error("Server: ngtcp2_crypto_ossl_configure_server_context failed: %s", ERR_error_string(ERR_get_error(), NULL));
     //     SSL_CTX_free(config->crypto_ctx->ssl_ctx);
     //     free(config->crypto_ctx);
     //     config->crypto_ctx = NULL;
     //     return -1;
     // }
 
-    const unsigned char alpn[] = "\x02h3";
-    if (SSL_CTX_set_alpn_protos(config->crypto_ctx->ssl_ctx, alpn, sizeof(alpn) - 1) != 0) {
-        dlog("ERROR: Failed to set ALPN: %s", ERR_error_string(ERR_get_error(), NULL));
-        SSL_CTX_free(config->crypto_ctx->ssl_ctx);
-        free(config->crypto_ctx);
-        config->crypto_ctx = NULL;
-        return -1;
-    }
+    SSL_CTX_set_alpn_select_cb(config->crypto_ctx->ssl_ctx, select_alpn, NULL);
 
     uint8_t paramsbuf[256];
     ngtcp2_transport_params params;
@@ -355,7 +556,7 @@ static int init_server_crypto_context(nexus_server_config_t *config) {
 
     ssize_t nwrite = ngtcp2_transport_params_encode(paramsbuf, sizeof(paramsbuf), &params);
     if (nwrite < 0) {
-        dlog("ERROR: Failed to encode transport parameters: %s", ngtcp2_strerror((int)nwrite));
+        log_error("Failed to encode transport parameters: %s", ngtcp2_strerror((int)nwrite));
         SSL_CTX_free(config->crypto_ctx->ssl_ctx);
         free(config->crypto_ctx);
         config->crypto_ctx = NULL;
@@ -364,7 +565,7 @@ static int init_server_crypto_context(nexus_server_config_t *config) {
 
     // Comment out problematic SSL function for now
     // if (SSL_CTX_set_quic_transport_params(config->crypto_ctx->ssl_ctx, paramsbuf, (size_t)nwrite) != 1) {
-    //     dlog("ERROR: Failed to set QUIC transport parameters on SSL_CTX: %s", ERR_error_string(ERR_get_error(), NULL));
+    //     log_error("Failed to set QUIC transport parameters on SSL_CTX: %s", ERR_error_string(ERR_get_error(), NULL));
     //     SSL_CTX_free(config->crypto_ctx->ssl_ctx);
     //     free(config->crypto_ctx);
     //     config->crypto_ctx = NULL;
@@ -402,14 +603,14 @@ static int server_get_new_connection_id(ngtcp2_conn *conn, ngtcp2_cid *cid,
     (void)user_data;
     
     if (RAND_bytes(cid->data, cidlen) != 1) {
-        dlog("CRITICAL: server_get_new_connection_id: RAND_bytes failed!");
+        log_error("CRITICAL: server_get_new_connection_id: RAND_bytes failed!");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
     
     cid->datalen = cidlen;
     
     if (RAND_bytes(token, NGTCP2_STATELESS_RESET_TOKENLEN) != 1) {
-        dlog("CRITICAL: server_get_new_connection_id: RAND_bytes for token failed!");
+        log_error("CRITICAL: server_get_new_connection_id: RAND_bytes for token failed!");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
     
@@ -467,7 +668,7 @@ static int server_get_path_challenge_data(ngtcp2_conn *conn, uint8_t *data, void
     
     // Generate random data for path challenge
     if (RAND_bytes(data, NGTCP2_PATH_CHALLENGE_DATALEN) != 1) {
-        dlog("ERROR: Failed to generate random data for path challenge");
+        log_error("Failed to generate random data for path challenge");
         return NGTCP2_ERR_CALLBACK_FAILURE;
     }
     
@@ -477,7 +678,7 @@ static int server_get_path_challenge_data(ngtcp2_conn *conn, uint8_t *data, void
 int init_nexus_server(network_context_t *net_ctx, const char *bind_address,
                      uint16_t port, nexus_server_config_t *config) {
     if (!net_ctx || !config) {
-        dlog("ERROR: Invalid parameters to init_nexus_server");
+        log_error("Invalid parameters to init_nexus_server");
         return -1;
     }
 
@@ -487,14 +688,24 @@ int init_nexus_server(network_context_t *net_ctx, const char *bind_address,
     config->bind_address = bind_address ? strdup(bind_address) : NULL;
 
     if (pthread_mutex_init(&config->lock, NULL) != 0) {
-        dlog("ERROR: Server: Failed to initialize mutex");
+        log_error("Server: Failed to initialize mutex");
+        if(config->bind_address) free((void*)config->bind_address);
+        return -1;
+    }
+
+    // Transient allocations of each request come from here
+    if (init_query_arena(QUERY_ARENA_DEFAULT_SIZE, &config->query_arena) != 0) {
+        log_error("Server: Failed to initialize request arena");
+        pthread_mutex_destroy(&config->lock);
         if(config->bind_address) free((void*)config->bind_address);
         return -1;
     }
 
     // Initialize server crypto context (SSL_CTX related parts)
     if (init_server_crypto_context(config) != 0) {
-        dlog("ERROR: Server: Failed to initialize server crypto context (SSL_CTX)");
+        log_error("Server: Failed to initialize server crypto context (SSL_CTX)");
+        cleanup_query_arena(config->query_arena);
+        config->query_arena = NULL;
         pthread_mutex_destroy(&config->lock);
         if(config->bind_address) free((void*)config->bind_address);
         return -1;
@@ -504,6 +715,7 @@ int init_nexus_server(network_context_t *net_ctx, const char *bind_address,
     callbacks.recv_stream_data = on_stream_data;
     callbacks.handshake_completed = on_handshake_completed;
     callbacks.stream_open = on_stream_open;
+    callbacks.stream_close = on_stream_close;
     callbacks.rand = server_rand;
     callbacks.get_new_connection_id = server_get_new_connection_id;
     callbacks.update_key = server_update_key;
@@ -523,7 +735,7 @@ int init_nexus_server(network_context_t *net_ctx, const char *bind_address,
     // Socket creation and binding
     int sock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
     if (sock < 0) {
-        dlog("ERROR: Failed to create server socket: %s", strerror(errno));
+        log_error("Failed to create server socket: %s", strerror(errno));
         return -1;
     }
 
@@ -532,39 +744,39 @@ int init_nexus_server(network_context_t *net_ctx, const char *bind_address,
     // Allow socket address reuse to avoid "address already in use" errors
     int reuse = 1;
     if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
-        dlog("WARNING: Failed to set SO_REUSEADDR: %s", strerror(errno));
+        log_warn("Failed to set SO_REUSEADDR: %s", strerror(errno));
         // Continue anyway as this is just an optimization
     }
     
     // Set receive and send buffer sizes for better performance
     int buffer_size = 1024 * 1024; // 1MB buffer
     if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size)) < 0) {
-        dlog("WARNING: Failed to set receive buffer size: %s", strerror(errno));
+        log_warn("Failed to set receive buffer size: %s", strerror(errno));
         // Continue anyway as this is just an optimization
     }
     
     if (setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size)) < 0) {
-        dlog("WARNING: Failed to set send buffer size: %s", strerror(errno));
+        log_warn("Failed to set send buffer size: %s", strerror(errno));
         // Continue anyway as this is just an optimization
     }
 
     // Enable IPv6 only if needed, otherwise allow dual stack
     int ipv6_only = 0; // Allow both IPv4 and IPv6 by default
     if (setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &ipv6_only, sizeof(ipv6_only)) < 0) {
-        dlog("WARNING: Failed to set IPV6_V6ONLY option: %s", strerror(errno));
+        log_warn("Failed to set IPV6_V6ONLY option: %s", strerror(errno));
         // Continue anyway as this is just an optimization
     }
 
     // Set socket to non-blocking mode
     int flags = fcntl(sock, F_GETFL, 0);
     if (flags == -1) {
-        dlog("ERROR: Failed to get socket flags: %s", strerror(errno));
+        log_error("Failed to get socket flags: %s", strerror(errno));
         close(sock);
         return -1;
     }
     
     if (fcntl(sock, F_SETFL, flags | O_NONBLOCK) == -1) {
-        dlog("ERROR: Failed to set socket to non-blocking mode: %s", strerror(errno));
+        log_error("Failed to set socket to non-blocking mode: %s", strerror(errno));
         close(sock);
         return -1;
     }
@@ -610,7 +822,7 @@ int init_nexus_server(network_context_t *net_ctx, const char *bind_address,
 
     // Bind the socket
     if (bind(sock, (struct sockaddr*)&addr_v6, sizeof(addr_v6)) < 0) {
-        dlog("ERROR: Failed to bind server socket: %s", strerror(errno));
+        log_error("Failed to bind server socket: %s", strerror(errno));
         close(sock);
         return -1;
     }
@@ -664,15 +876,16 @@ int nexus_server_process_events(nexus_server_config_t *config) {
                             (struct sockaddr*)&client_addr_v6, &client_len);
     
     if (nread > 0) {
+        query_trace_note_receive();
+
         // Convert client address to string for logging
         char client_ip[INET6_ADDRSTRLEN];
         inet_ntop(AF_INET6, &client_addr_v6.sin6_addr, client_ip, sizeof(client_ip));
-        dlog("Server received packet (%zd bytes) from [%s]:%d", 
+        log_debug("Server received packet (%zd bytes) from [%s]:%d", 
              nread, client_ip, ntohs(client_addr_v6.sin6_port));
         
-        // Print first few bytes of the packet for debugging
-        dlog("Packet header: %02X %02X %02X %02X %02X %02X %02X %02X", 
-             buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7]);
+        // First bytes of the packet, only formatted when debug logging is on
+        log_hex(LOG_LEVEL_DEBUG, "Packet header", buf, 8);
         
         ngtcp2_path path = {
             .local = {
@@ -731,6 +944,7 @@ int nexus_server_process_events(nexus_server_config_t *config) {
             }
             
             config->conn = conn;
+            metrics_inc(METRIC_CONNECTIONS_ACCEPTED);
             dlog("Server connection created successfully");
             
             // Create SSL object for TLS handshake
@@ -739,6 +953,7 @@ int nexus_server_process_events(nexus_server_config_t *config) {
                 dlog("Failed to create SSL object: %s", ERR_error_string(ERR_get_error(), NULL));
                 ngtcp2_conn_del(config->conn);
                 config->conn = NULL;
+                metrics_inc(METRIC_CONNECTIONS_CLOSED);
                 return -1;
             }
             
@@ -774,13 +989,9 @@ int nexus_server_process_events(nexus_server_config_t *config) {
             if (n > 0) {
                 ssize_t sent = sendto(config->sock, send_buf, n, 0,
                        (struct sockaddr*)&client_addr_v6, client_len);
-                dlog("Server sent %zd bytes in response to [%s]:%d", 
+                log_debug("Server sent %zd bytes in response to [%s]:%d", 
                      sent, client_ip, ntohs(client_addr_v6.sin6_port));
-                
-                // Print first few bytes of the response for debugging
-                dlog("Response header: %02X %02X %02X %02X %02X %02X %02X %02X",
-                     send_buf[0], send_buf[1], send_buf[2], send_buf[3],
-                     send_buf[4], send_buf[5], send_buf[6], send_buf[7]);
+                log_hex(LOG_LEVEL_DEBUG, "Response header", send_buf, 8);
             }
         }
     } else if (nread < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
@@ -817,7 +1028,7 @@ int nexus_server_process_events(nexus_server_config_t *config) {
             
             ssize_t sent = sendto(config->sock, send_buf, n, 0,
                    (struct sockaddr*)&client_addr_v6, client_len);
-            dlog("Server sent timeout packet (%zd bytes) to [%s]:%d", 
+            log_debug("Server sent timeout packet (%zd bytes) to [%s]:%d", 
                  sent, client_ip, ntohs(client_addr_v6.sin6_port));
         }
     }
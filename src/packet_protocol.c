@@ -10,16 +10,14 @@
 
 // Forward declarations for static helper functions
 static int write_uint8(uint8_t val, uint8_t* buf, size_t buf_len, size_t* offset);
-// Unused function - commented out to eliminate warning
-//static int write_uint16(uint16_t val, uint8_t* buf, size_t buf_len, size_t* offset);
+static int write_uint16(uint16_t val, uint8_t* buf, size_t buf_len, size_t* offset);
 static int write_uint32(uint32_t val, uint8_t* buf, size_t buf_len, size_t* offset);
 static int write_uint64(uint64_t val, uint8_t* buf, size_t buf_len, size_t* offset);
 static int write_fixed_string(const char* str, size_t str_fixed_len, uint8_t* buf, size_t buf_len, size_t* offset);
 static int write_bytes(const uint8_t* data, uint32_t data_len, uint8_t* buf, size_t buf_len, size_t* offset);
 
 static int read_uint8(const uint8_t* buf, size_t buf_len, size_t* offset, uint8_t* out_val);
-// Unused function - commented out to eliminate warning
-//static int read_uint16(const uint8_t* buf, size_t buf_len, size_t* offset, uint16_t* out_val);
+static int read_uint16(const uint8_t* buf, size_t buf_len, size_t* offset, uint16_t* out_val);
 static int read_uint32(const uint8_t* buf, size_t buf_len, size_t* offset, uint32_t* out_val);
 static int read_uint64(const uint8_t* buf, size_t buf_len, size_t* offset, uint64_t* out_val);
 static int read_fixed_string(const uint8_t* buf, size_t buf_len, size_t* offset, char* out_str, size_t str_fixed_len);
@@ -34,7 +32,6 @@ static int write_uint8(uint8_t val, uint8_t* buf, size_t buf_len, size_t* offset
     return 0;
 }
 
-/* Unused function - commented out to eliminate warning
 // Write a uint16_t to buffer (network byte order) and advance offset
 static int write_uint16(uint16_t val, uint8_t* buf, size_t buf_len, size_t* offset) {
     if (*offset + sizeof(uint16_t) > buf_len) return -1;
@@ -43,7 +40,6 @@ static int write_uint16(uint16_t val, uint8_t* buf, size_t buf_len, size_t* offs
     *offset += sizeof(uint16_t);
     return 0;
 }
-*/
 
 // Write a uint32_t to buffer (network byte order) and advance offset
 static int write_uint32(uint32_t val, uint8_t* buf, size_t buf_len, size_t* offset) {
@@ -106,7 +102,6 @@ static int read_uint8(const uint8_t* buf, size_t buf_len, size_t* offset, uint8_
     return 0;
 }
 
-/* Unused function - commented out to eliminate warning
 static int read_uint16(const uint8_t* buf, size_t buf_len, size_t* offset, uint16_t* out_val) {
     if (*offset + sizeof(uint16_t) > buf_len) return -1;
     uint16_t net_val;
@@ -115,7 +110,6 @@ static int read_uint16(const uint8_t* buf, size_t buf_len, size_t* offset, uint1
     *offset += sizeof(uint16_t);
     return 0;
 }
-*/
 
 static int read_uint32(const uint8_t* buf, size_t buf_len, size_t* offset, uint32_t* out_val) {
     if (*offset + sizeof(uint32_t) > buf_len) return -1;
@@ -154,12 +148,12 @@ static int read_fixed_string(const uint8_t* buf, size_t buf_len, size_t* offset,
 // Reads variable length data. Allocates memory for out_data which caller must free.
 static int read_bytes_alloc(const uint8_t* buf, size_t buf_len, size_t* offset, uint32_t data_len, uint8_t** out_data) {
     if (!buf || !offset || !out_data) {
-        dlog("ERROR: Invalid parameters to read_bytes_alloc");
+        log_error("Invalid parameters to read_bytes_alloc");
         if(out_data) *out_data = NULL;
         return -1;
     }
     if (*offset + data_len > buf_len) {
-        dlog("ERROR: Buffer too small in read_bytes_alloc. Offset: %zu, DataLen: %u, BufLen: %zu", *offset, data_len, buf_len);
+        log_error("Buffer too small in read_bytes_alloc. Offset: %zu, DataLen: %u, BufLen: %zu", *offset, data_len, buf_len);
         *out_data = NULL;
         return -1; 
     }
@@ -172,7 +166,7 @@ static int read_bytes_alloc(const uint8_t* buf, size_t buf_len, size_t* offset,
 
     *out_data = malloc(data_len);
     if (!*out_data) {
-        dlog("ERROR: Failed to allocate memory in read_bytes_alloc (%u bytes)", data_len);
+        log_error("Failed to allocate memory in read_bytes_alloc (%u bytes)", data_len);
         return -1; 
     }
     
@@ -202,13 +196,26 @@ ssize_t get_serialized_nexus_packet_size(const nexus_packet_t* packet) {
     return NEXUS_PACKET_HEADER_SIZE + packet->data_len;
 }
 
+const char* get_packet_type_name(int type) {
+    static const char* names[] = {
+        "reserved", "handshake_hello", "handshake_ack", "dns_query", "dns_response",
+        "tld_register_req", "tld_register_resp", "tld_mirror_req", "tld_mirror_resp",
+        "tld_sync_update", "tld_sync_ack", "peer_discovery", "heartbeat",
+        "ct_sth_req", "ct_sth_resp", "ct_entries_req", "ct_entries_resp",
+        "tld_merkle_req", "tld_merkle_resp", "tld_bucket_req", "tld_bucket_resp",
+        "tld_journal_req", "tld_journal_resp"
+    };
+    if (type < 0 || (size_t)type >= sizeof(names) / sizeof(names[0])) return "unknown";
+    return names[type];
+}
+
 ssize_t serialize_nexus_packet(const nexus_packet_t* packet, uint8_t* out_buf, size_t out_buf_len) {
     if (!packet || !out_buf) return -1;
     ssize_t required_size = get_serialized_nexus_packet_size(packet);
     if (required_size < 0 || (size_t)required_size > out_buf_len) return -1; // Not enough space
 
     size_t offset = 0;
-    dlog("Serializing packet: version=%d, type=%d, session_id=%lx, data_len=%u",
+    log_debug("Serializing packet: version=%d, type=%d, session_id=%lx, data_len=%u",
          packet->version, packet->type, packet->session_id, packet->data_len);
 
     if (write_uint8(packet->version, out_buf, out_buf_len, &offset) != 0) return -1;
@@ -222,50 +229,59 @@ ssize_t serialize_nexus_packet(const nexus_packet_t* packet, uint8_t* out_buf, s
         if (write_bytes(packet->data, packet->data_len, out_buf, out_buf_len, &offset) != 0) return -1;
     }
     
-    dlog("Serialized packet size: %zu", offset);
+    log_debug("Serialized packet size: %zu", offset);
     return offset;
 }
 
-ssize_t deserialize_nexus_packet(const uint8_t* buf, size_t buf_len, nexus_packet_t* packet) {
+static ssize_t deserialize_packet(const uint8_t* buf, size_t buf_len, nexus_packet_t* packet, query_arena_t* arena) {
     if (!buf || !packet) return -1;
     if (buf_len < NEXUS_PACKET_HEADER_SIZE) {
-        dlog("ERROR: Buffer too small for header: %zu < %zu", buf_len, NEXUS_PACKET_HEADER_SIZE);
+        log_error("Buffer too small for header: %zu < %zu", buf_len, NEXUS_PACKET_HEADER_SIZE);
         return -1; // Not enough data for header
     }
 
     size_t offset = 0;
     if (read_uint8(buf, buf_len, &offset, &packet->version) != 0) {
-        dlog("ERROR: Failed to read version");
+        log_error("Failed to read version");
         return -1;
     }
     uint8_t type_val_u8;
     if (read_uint8(buf, buf_len, &offset, &type_val_u8) != 0) {
-        dlog("ERROR: Failed to read type");
+        log_error("Failed to read type");
         return -1;
     }
     packet->type = (nexus_packet_type_t)type_val_u8;
     if (read_uint64(buf, buf_len, &offset, &packet->session_id) != 0) {
-        dlog("ERROR: Failed to read session_id");
+        log_error("Failed to read session_id");
         return -1;
     }
     if (read_uint32(buf, buf_len, &offset, &packet->data_len) != 0) {
-        dlog("ERROR: Failed to read data_len");
+        log_error("Failed to read data_len");
         return -1;
     }
 
     if (packet->data_len > 0) {
         // Validate that the data size is reasonable
         if (packet->data_len > buf_len - offset) {
-            dlog("ERROR: Data length too large: %u > %zu", packet->data_len, buf_len - offset);
+            log_error("Data length too large: %u > %zu", packet->data_len, buf_len - offset);
             packet->data = NULL;
             return -1;
         }
 
-        if (read_bytes_alloc(buf, buf_len, &offset, packet->data_len, &packet->data) != 0) {
+        if (arena) {
+            // The request's arena: freed with the request, not by the caller
+            packet->data = query_arena_alloc(arena, packet->data_len);
+            if (!packet->data) {
+                log_error("Failed to allocate %u bytes of packet data", packet->data_len);
+                return -1;
+            }
+            memcpy(packet->data, buf + offset, packet->data_len);
+            offset += packet->data_len;
+        } else if (read_bytes_alloc(buf, buf_len, &offset, packet->data_len, &packet->data) != 0) {
             // packet->data would be NULL if data_len is 0, or garbage on error.
             // If read_bytes_alloc failed after partially reading, offset is advanced but packet->data might be bad.
             // Ensure packet->data is NULL on error if it was to be allocated.
-            dlog("ERROR: Failed to read data bytes");
+            log_error("Failed to read data bytes");
             packet->data = NULL; 
             return -1;
         }
@@ -275,6 +291,16 @@ ssize_t deserialize_nexus_packet(const uint8_t* buf, size_t buf_len, nexus_packe
     return offset; // Total bytes read for this packet
 }
 
+ssize_t deserialize_nexus_packet(const uint8_t* buf, size_t buf_len, nexus_packet_t* packet) {
+    return deserialize_packet(buf, buf_len, packet, NULL);
+}
+
+ssize_t deserialize_nexus_packet_in_arena(const uint8_t* buf, size_t buf_len, nexus_packet_t* packet,
+                                          query_arena_t* arena) {
+    if (!arena) return -1;
+    return deserialize_packet(buf, buf_len, packet, arena);
+}
+
 // --- TLD Register Request --- (payload_tld_register_req_t)
 
 ssize_t get_serialized_payload_tld_register_req_size(const payload_tld_register_req_t* payload) {
@@ -576,4 +602,461 @@ ssize_t deserialize_payload_dns_response(const uint8_t* data, size_t data_len, p
         payload->records = NULL; // No records to deserialize
     }
     return offset;
-} 
\ No newline at end of file
+}
+
+// --- CT gossip ---
+
+static int write_ct_sth(const payload_ct_sth_t* sth, uint8_t* out_buf, size_t out_buf_len, size_t* offset) {
+    if (sth->signature_len > NEXUS_CT_MAX_SIGNATURE_LEN || sth->pubkey_len > NEXUS_CT_MAX_PUBKEY_LEN) return -1;
+    if (write_fixed_string(sth->log_id, sizeof(sth->log_id), out_buf, out_buf_len, offset) != 0) return -1;
+    if (write_uint64(sth->tree_size, out_buf, out_buf_len, offset) != 0) return -1;
+    if (write_uint64(sth->timestamp, out_buf, out_buf_len, offset) != 0) return -1;
+    if (write_bytes(sth->root_hash, 32, out_buf, out_buf_len, offset) != 0) return -1;
+    if (write_uint16(sth->signature_len, out_buf, out_buf_len, offset) != 0) return -1;
+    if (write_bytes(sth->signature, sth->signature_len, out_buf, out_buf_len, offset) != 0) return -1;
+    if (write_uint16(sth->pubkey_len, out_buf, out_buf_len, offset) != 0) return -1;
+    if (write_bytes(sth->pubkey, sth->pubkey_len, out_buf, out_buf_len, offset) != 0) return -1;
+    return 0;
+}
+
+static int read_ct_sth(const uint8_t* data, size_t data_len, size_t* offset, payload_ct_sth_t* sth) {
+    if (read_fixed_string(data, data_len, offset, sth->log_id, sizeof(sth->log_id)) != 0) return -1;
+    if (read_uint64(data, data_len, offset, &sth->tree_size) != 0) return -1;
+    if (read_uint64(data, data_len, offset, &sth->timestamp) != 0) return -1;
+    if (read_bytes(data, data_len, offset, sth->root_hash, 32) != 0) return -1;
+    if (read_uint16(data, data_len, offset, &sth->signature_len) != 0) return -1;
+    if (sth->signature_len > NEXUS_CT_MAX_SIGNATURE_LEN) return -1;
+    if (read_bytes(data, data_len, offset, sth->signature, sth->signature_len) != 0) return -1;
+    if (read_uint16(data, data_len, offset, &sth->pubkey_len) != 0) return -1;
+    if (sth->pubkey_len > NEXUS_CT_MAX_PUBKEY_LEN) return -1;
+    if (read_bytes(data, data_len, offset, sth->pubkey, sth->pubkey_len) != 0) return -1;
+    return 0;
+}
+
+static int write_ct_proof(const uint8_t (*proof)[32], uint16_t proof_len, uint8_t* out_buf, size_t out_buf_len, size_t* offset) {
+    if (proof_len > NEXUS_CT_MAX_PROOF_LEN) return -1;
+    if (write_uint16(proof_len, out_buf, out_buf_len, offset) != 0) return -1;
+    return write_bytes((const uint8_t*)proof, (uint32_t)proof_len * 32, out_buf, out_buf_len, offset);
+}
+
+static int read_ct_proof(const uint8_t* data, size_t data_len, size_t* offset, uint8_t (*proof)[32], uint16_t* proof_len) {
+    if (read_uint16(data, data_len, offset, proof_len) != 0) return -1;
+    if (*proof_len > NEXUS_CT_MAX_PROOF_LEN) return -1;
+    return read_bytes(data, data_len, offset, (uint8_t*)proof, (uint32_t)*proof_len * 32);
+}
+
+ssize_t serialize_payload_ct_sth(const payload_ct_sth_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf) return -1;
+    size_t offset = 0;
+    if (write_ct_sth(payload, out_buf, out_buf_len, &offset) != 0) return -1;
+    return offset;
+}
+
+ssize_t deserialize_payload_ct_sth(const uint8_t* data, size_t data_len, payload_ct_sth_t* payload) {
+    if (!data || !payload) return -1;
+    size_t offset = 0;
+    if (read_ct_sth(data, data_len, &offset, payload) != 0) return -1;
+    return offset;
+}
+
+ssize_t serialize_payload_ct_sth_resp(const payload_ct_sth_resp_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf) return -1;
+    size_t offset = 0;
+    if (write_ct_sth(&payload->sth, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint64(payload->proof_first_size, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_ct_proof((const uint8_t (*)[32])payload->proof, payload->proof_len, out_buf, out_buf_len, &offset) != 0) return -1;
+    return offset;
+}
+
+ssize_t deserialize_payload_ct_sth_resp(const uint8_t* data, size_t data_len, payload_ct_sth_resp_t* payload) {
+    if (!data || !payload) return -1;
+    size_t offset = 0;
+    if (read_ct_sth(data, data_len, &offset, &payload->sth) != 0) return -1;
+    if (read_uint64(data, data_len, &offset, &payload->proof_first_size) != 0) return -1;
+    if (read_ct_proof(data, data_len, &offset, payload->proof, &payload->proof_len) != 0) return -1;
+    return offset;
+}
+
+ssize_t serialize_payload_ct_entries_req(const payload_ct_entries_req_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf) return -1;
+    size_t offset = 0;
+    if (write_fixed_string(payload->log_id, sizeof(payload->log_id), out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint64(payload->start, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint32(payload->count, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint64(payload->tree_size, out_buf, out_buf_len, &offset) != 0) return -1;
+    return offset;
+}
+
+ssize_t deserialize_payload_ct_entries_req(const uint8_t* data, size_t data_len, payload_ct_entries_req_t* payload) {
+    if (!data || !payload) return -1;
+    size_t offset = 0;
+    if (read_fixed_string(data, data_len, &offset, payload->log_id, sizeof(payload->log_id)) != 0) return -1;
+    if (read_uint64(data, data_len, &offset, &payload->start) != 0) return -1;
+    if (read_uint32(data, data_len, &offset, &payload->count) != 0) return -1;
+    if (read_uint64(data, data_len, &offset, &payload->tree_size) != 0) return -1;
+    return offset;
+}
+
+static int write_ct_name(const char* name, uint8_t* out_buf, size_t out_buf_len, size_t* offset) {
+    size_t len = name ? strlen(name) : 0;
+    if (len > UINT16_MAX) return -1;
+    if (write_uint16((uint16_t)len, out_buf, out_buf_len, offset) != 0) return -1;
+    return write_bytes((const uint8_t*)name, (uint32_t)len, out_buf, out_buf_len, offset);
+}
+
+// Names are hashed up to their first NUL, so one inside is rejected
+static int read_ct_name(const uint8_t* data, size_t data_len, size_t* offset, char** name_out) {
+    uint16_t len;
+    if (read_uint16(data, data_len, offset, &len) != 0 || *offset + len > data_len) return -1;
+    if (memchr(data + *offset, '\0', len) != NULL) return -1;
+    *name_out = strndup((const char*)data + *offset, len);
+    if (!*name_out) return -1;
+    *offset += len;
+    return 0;
+}
+
+// start, count, tree_size, proof, then per leaf: timestamp, leaf_hash,
+// common_name_len, common_name, not_before, not_after, cert_type,
+// signature_len, signature, der_len, der
+#define CT_LEAF_FIXED_SIZE (8 + 32 + 2 + 8 + 8 + 1 + 4 + 4)
+
+ssize_t get_serialized_payload_ct_entries_resp_size(const payload_ct_entries_resp_t* payload) {
+    if (!payload || payload->proof_len > NEXUS_CT_MAX_PROOF_LEN) return -1;
+    size_t size = 8 + 4 + 8 + 2 + (size_t)payload->proof_len * 32;
+    for (uint32_t i = 0; i < payload->count; i++) {
+        const payload_ct_leaf_t* leaf = &payload->leaves[i];
+        size += CT_LEAF_FIXED_SIZE + (leaf->common_name ? strlen(leaf->common_name) : 0) +
+                leaf->signature_len + leaf->der_len;
+    }
+    return (ssize_t)size;
+}
+
+ssize_t serialize_payload_ct_entries_resp(const payload_ct_entries_resp_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf || (payload->count > 0 && !payload->leaves)) return -1;
+    size_t offset = 0;
+    if (write_uint64(payload->start, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint32(payload->count, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint64(payload->tree_size, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_ct_proof((const uint8_t (*)[32])payload->proof, payload->proof_len, out_buf, out_buf_len, &offset) != 0) return -1;
+    for (uint32_t i = 0; i < payload->count; i++) {
+        const payload_ct_leaf_t* leaf = &payload->leaves[i];
+        if (write_uint64(leaf->timestamp, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_bytes(leaf->leaf_hash, 32, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_ct_name(leaf->common_name, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_uint64((uint64_t)leaf->not_before, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_uint64((uint64_t)leaf->not_after, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_uint8(leaf->cert_type, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_uint32(leaf->signature_len, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_bytes(leaf->signature, leaf->signature_len, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_uint32(leaf->der_len, out_buf, out_buf_len, &offset) != 0) return -1;
+        if (write_bytes(leaf->der, leaf->der_len, out_buf, out_buf_len, &offset) != 0) return -1;
+    }
+    return offset;
+}
+
+ssize_t deserialize_payload_ct_entries_resp(const uint8_t* data, size_t data_len, payload_ct_entries_resp_t* payload) {
+    if (!data || !payload) return -1;
+    memset(payload, 0, sizeof(*payload));
+    size_t offset = 0;
+    if (read_uint64(data, data_len, &offset, &payload->start) != 0) return -1;
+    if (read_uint32(data, data_len, &offset, &payload->count) != 0) return -1;
+    if (read_uint64(data, data_len, &offset, &payload->tree_size) != 0) return -1;
+    if (read_ct_proof(data, data_len, &offset, payload->proof, &payload->proof_len) != 0) return -1;
+    if (payload->count > NEXUS_CT_MAX_ENTRIES_PER_REQ) return -1;
+    if (payload->count == 0) return offset;
+
+    payload->leaves = calloc(payload->count, sizeof(payload_ct_leaf_t));
+    if (!payload->leaves) return -1;
+    for (uint32_t i = 0; i < payload->count; i++) {
+        payload_ct_leaf_t* leaf = &payload->leaves[i];
+        uint64_t not_before, not_after;
+        if (read_uint64(data, data_len, &offset, &leaf->timestamp) != 0 ||
+            read_bytes(data, data_len, &offset, leaf->leaf_hash, 32) != 0 ||
+            read_ct_name(data, data_len, &offset, &leaf->common_name) != 0 ||
+            read_uint64(data, data_len, &offset, &not_before) != 0 ||
+            read_uint64(data, data_len, &offset, &not_after) != 0 ||
+            read_uint8(data, data_len, &offset, &leaf->cert_type) != 0 ||
+            read_uint32(data, data_len, &offset, &leaf->signature_len) != 0 ||
+            read_bytes_alloc(data, data_len, &offset, leaf->signature_len, &leaf->signature) != 0 ||
+            read_uint32(data, data_len, &offset, &leaf->der_len) != 0 ||
+            read_bytes_alloc(data, data_len, &offset, leaf->der_len, &leaf->der) != 0) {
+            free_payload_ct_entries_resp(payload);
+            return -1;
+        }
+        leaf->not_before = (int64_t)not_before;
+        leaf->not_after = (int64_t)not_after;
+    }
+    return offset;
+}
+
+void free_payload_ct_entries_resp(payload_ct_entries_resp_t* payload) {
+    if (!payload || !payload->leaves) return;
+    for (uint32_t i = 0; i < payload->count; i++) {
+        free(payload->leaves[i].common_name);
+        free(payload->leaves[i].signature);
+        free(payload->leaves[i].der);
+    }
+    free(payload->leaves);
+    payload->leaves = NULL;
+}
+
+// --- TLD anti-entropy ---
+
+static int write_u32_array(const uint32_t* values, uint16_t count, uint8_t* out_buf, size_t out_buf_len, size_t* offset) {
+    if (count > NEXUS_TLD_SYNC_MAX_NODES || (count > 0 && !values)) return -1;
+    if (write_uint16(count, out_buf, out_buf_len, offset) != 0) return -1;
+    for (uint16_t i = 0; i < count; i++) {
+        if (write_uint32(values[i], out_buf, out_buf_len, offset) != 0) return -1;
+    }
+    return 0;
+}
+
+static int read_u32_array(const uint8_t* data, size_t data_len, size_t* offset, uint32_t** values_out, uint16_t* count_out) {
+    if (read_uint16(data, data_len, offset, count_out) != 0) return -1;
+    if (*count_out > NEXUS_TLD_SYNC_MAX_NODES || *offset + (size_t)*count_out * 4 > data_len) return -1;
+    *values_out = NULL;
+    if (*count_out == 0) return 0;
+    *values_out = malloc((size_t)*count_out * sizeof(uint32_t));
+    if (!*values_out) return -1;
+    for (uint16_t i = 0; i < *count_out; i++) {
+        read_uint32(data, data_len, offset, &(*values_out)[i]);
+    }
+    return 0;
+}
+
+ssize_t get_serialized_payload_tld_merkle_req_size(const payload_tld_merkle_req_t* payload) {
+    if (!payload) return -1;
+    return 64 + 1 + 2 + (ssize_t)payload->count * 4;
+}
+
+ssize_t serialize_payload_tld_merkle_req(const payload_tld_merkle_req_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf) return -1;
+    size_t offset = 0;
+    if (write_fixed_string(payload->tld_name, sizeof(payload->tld_name), out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint8(payload->level, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_u32_array(payload->indices, payload->count, out_buf, out_buf_len, &offset) != 0) return -1;
+    return offset;
+}
+
+ssize_t deserialize_payload_tld_merkle_req(const uint8_t* data, size_t data_len, payload_tld_merkle_req_t* payload) {
+    if (!data || !payload) return -1;
+    memset(payload, 0, sizeof(*payload));
+    size_t offset = 0;
+    if (read_fixed_string(data, data_len, &offset, payload->tld_name, sizeof(payload->tld_name)) != 0) return -1;
+    if (read_uint8(data, data_len, &offset, &payload->level) != 0) return -1;
+    if (read_u32_array(data, data_len, &offset, &payload->indices, &payload->count) != 0) return -1;
+    return offset;
+}
+
+void free_payload_tld_merkle_req(payload_tld_merkle_req_t* payload) {
+    if (!payload) return;
+    free(payload->indices);
+    payload->indices = NULL;
+}
+
+ssize_t get_serialized_payload_tld_merkle_resp_size(const payload_tld_merkle_resp_t* payload) {
+    if (!payload) return -1;
+    return 64 + 1 + 1 + 2 + (ssize_t)payload->count * 32;
+}
+
+ssize_t serialize_payload_tld_merkle_resp(const payload_tld_merkle_resp_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf) return -1;
+    if (payload->count > NEXUS_TLD_SYNC_MAX_NODES || (payload->count > 0 && !payload->hashes)) return -1;
+    size_t offset = 0;
+    if (write_fixed_string(payload->tld_name, sizeof(payload->tld_name), out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint8(payload->status, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint8(payload->level, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint16(payload->count, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_bytes((const uint8_t*)payload->hashes, (uint32_t)payload->count * 32, out_buf, out_buf_len, &offset) != 0) return -1;
+    return offset;
+}
+
+ssize_t deserialize_payload_tld_merkle_resp(const uint8_t* data, size_t data_len, payload_tld_merkle_resp_t* payload) {
+    if (!data || !payload) return -1;
+    memset(payload, 0, sizeof(*payload));
+    size_t offset = 0;
+    if (read_fixed_string(data, data_len, &offset, payload->tld_name, sizeof(payload->tld_name)) != 0) return -1;
+    if (read_uint8(data, data_len, &offset, &payload->status) != 0) return -1;
+    if (read_uint8(data, data_len, &offset, &payload->level) != 0) return -1;
+    if (read_uint16(data, data_len, &offset, &payload->count) != 0) return -1;
+    if (payload->count > NEXUS_TLD_SYNC_MAX_NODES) return -1;
+    if (read_bytes_alloc(data, data_len, &offset, (uint32_t)payload->count * 32, (uint8_t**)&payload->hashes) != 0) return -1;
+    return offset;
+}
+
+void free_payload_tld_merkle_resp(payload_tld_merkle_resp_t* payload) {
+    if (!payload) return;
+    free(payload->hashes);
+    payload->hashes = NULL;
+}
+
+ssize_t get_serialized_payload_tld_bucket_req_size(const payload_tld_bucket_req_t* payload) {
+    if (!payload) return -1;
+    return 64 + 2 + (ssize_t)payload->count * 4;
+}
+
+ssize_t serialize_payload_tld_bucket_req(const payload_tld_bucket_req_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf) return -1;
+    size_t offset = 0;
+    if (write_fixed_string(payload->tld_name, sizeof(payload->tld_name), out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_u32_array(payload->buckets, payload->count, out_buf, out_buf_len, &offset) != 0) return -1;
+    return offset;
+}
+
+ssize_t deserialize_payload_tld_bucket_req(const uint8_t* data, size_t data_len, payload_tld_bucket_req_t* payload) {
+    if (!data || !payload) return -1;
+    memset(payload, 0, sizeof(*payload));
+    size_t offset = 0;
+    if (read_fixed_string(data, data_len, &offset, payload->tld_name, sizeof(payload->tld_name)) != 0) return -1;
+    if (read_u32_array(data, data_len, &offset, &payload->buckets, &payload->count) != 0) return -1;
+    return offset;
+}
+
+void free_payload_tld_bucket_req(payload_tld_bucket_req_t* payload) {
+    if (!payload) return;
+    free(payload->buckets);
+    payload->buckets = NULL;
+}
+
+ssize_t get_serialized_payload_tld_bucket_resp_size(const payload_tld_bucket_resp_t* payload) {
+    if (!payload || (payload->record_count > 0 && !payload->records)) return -1;
+    size_t size = 64 + 1 + 2 + (size_t)payload->bucket_count * 4 + 4;
+    for (uint32_t i = 0; i < payload->record_count; i++) {
+        ssize_t record_size = get_serialized_dns_record_size(&payload->records[i]);
+        if (record_size < 0) return -1;
+        size += (size_t)record_size;
+    }
+    return (ssize_t)size;
+}
+
+ssize_t serialize_payload_tld_bucket_resp(const payload_tld_bucket_resp_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf || (payload->record_count > 0 && !payload->records)) return -1;
+    size_t offset = 0;
+    if (write_fixed_string(payload->tld_name, sizeof(payload->tld_name), out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint8(payload->status, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_u32_array(payload->buckets, payload->bucket_count, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint32(payload->record_count, out_buf, out_buf_len, &offset) != 0) return -1;
+    for (uint32_t i = 0; i < payload->record_count; i++) {
+        size_t written = 0;
+        if (serialize_dns_record(&payload->records[i], out_buf + offset, out_buf_len - offset, &written) != 0) return -1;
+        offset += written;
+    }
+    return offset;
+}
+
+// A record's name and rdata are written with their NUL; a peer's record is
+// only taken if both still end in one (name length first, rdata last)
+static int dns_record_terminated(const uint8_t* data, size_t record_len, const dns_record_t* record) {
+    if (!record->name || !record->rdata) return 0;
+    uint32_t name_len;
+    memcpy(&name_len, data, sizeof(name_len));
+    name_len = ntohl(name_len);
+    return data[4 + name_len - 1] == '\0' && data[record_len - 1] == '\0';
+}
+
+ssize_t deserialize_payload_tld_bucket_resp(const uint8_t* data, size_t data_len, payload_tld_bucket_resp_t* payload) {
+    if (!data || !payload) return -1;
+    memset(payload, 0, sizeof(*payload));
+    size_t offset = 0;
+    if (read_fixed_string(data, data_len, &offset, payload->tld_name, sizeof(payload->tld_name)) != 0) return -1;
+    if (read_uint8(data, data_len, &offset, &payload->status) != 0) return -1;
+    if (read_u32_array(data, data_len, &offset, &payload->buckets, &payload->bucket_count) != 0) return -1;
+    uint32_t record_count;
+    if (read_uint32(data, data_len, &offset, &record_count) != 0) {
+        free_payload_tld_bucket_resp(payload);
+        return -1;
+    }
+    // Every serialized record takes at least 24 bytes
+    if (record_count > (data_len - offset) / 24) {
+        free_payload_tld_bucket_resp(payload);
+        return -1;
+    }
+    if (record_count > 0) {
+        payload->records = calloc(record_count, sizeof(dns_record_t));
+        if (!payload->records) {
+            free_payload_tld_bucket_resp(payload);
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < record_count; i++) {
+        size_t record_len = 0;
+        if (deserialize_dns_record(data + offset, data_len - offset, &payload->records[i], &record_len) != 0) {
+            free_payload_tld_bucket_resp(payload);
+            return -1;
+        }
+        payload->record_count = i + 1;
+        if (!dns_record_terminated(data + offset, record_len, &payload->records[i])) {
+            free_payload_tld_bucket_resp(payload);
+            return -1;
+        }
+        offset += record_len;
+    }
+    return offset;
+}
+
+void free_payload_tld_bucket_resp(payload_tld_bucket_resp_t* payload) {
+    if (!payload) return;
+    for (uint32_t i = 0; i < payload->record_count; i++) {
+        free(payload->records[i].name);
+        free(payload->records[i].rdata);
+    }
+    free(payload->records);
+    free(payload->buckets);
+    payload->records = NULL;
+    payload->buckets = NULL;
+    payload->record_count = 0;
+}
+
+ssize_t serialize_payload_tld_journal_req(const payload_tld_journal_req_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf) return -1;
+    size_t offset = 0;
+    if (write_uint64(payload->since_sequence, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint32(payload->max_entries, out_buf, out_buf_len, &offset) != 0) return -1;
+    return offset;
+}
+
+ssize_t deserialize_payload_tld_journal_req(const uint8_t* data, size_t data_len, payload_tld_journal_req_t* payload) {
+    if (!data || !payload) return -1;
+    memset(payload, 0, sizeof(*payload));
+    size_t offset = 0;
+    if (read_uint64(data, data_len, &offset, &payload->since_sequence) != 0) return -1;
+    if (read_uint32(data, data_len, &offset, &payload->max_entries) != 0) return -1;
+    return offset;
+}
+
+ssize_t get_serialized_payload_tld_journal_resp_size(const payload_tld_journal_resp_t* payload) {
+    if (!payload) return -1;
+    return 1 + 8 + 4 + 4 + (ssize_t)payload->data_len;
+}
+
+ssize_t serialize_payload_tld_journal_resp(const payload_tld_journal_resp_t* payload, uint8_t* out_buf, size_t out_buf_len) {
+    if (!payload || !out_buf || (payload->data_len > 0 && !payload->data)) return -1;
+    if (payload->data_len > NEXUS_TLD_JOURNAL_MAX_BYTES) return -1;
+    size_t offset = 0;
+    if (write_uint8(payload->status, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint64(payload->last_sequence, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint32(payload->entry_count, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_uint32(payload->data_len, out_buf, out_buf_len, &offset) != 0) return -1;
+    if (write_bytes(payload->data, payload->data_len, out_buf, out_buf_len, &offset) != 0) return -1;
+    return offset;
+}
+
+ssize_t deserialize_payload_tld_journal_resp(const uint8_t* data, size_t data_len, payload_tld_journal_resp_t* payload) {
+    if (!data || !payload) return -1;
+    memset(payload, 0, sizeof(*payload));
+    size_t offset = 0;
+    if (read_uint8(data, data_len, &offset, &payload->status) != 0) return -1;
+    if (read_uint64(data, data_len, &offset, &payload->last_sequence) != 0) return -1;
+    if (read_uint32(data, data_len, &offset, &payload->entry_count) != 0) return -1;
+    if (read_uint32(data, data_len, &offset, &payload->data_len) != 0) return -1;
+    if (payload->entry_count > NEXUS_TLD_JOURNAL_MAX_ENTRIES || payload->data_len > NEXUS_TLD_JOURNAL_MAX_BYTES) return -1;
+    if (payload->data_len > 0 &&
+        read_bytes_alloc(data, data_len, &offset, payload->data_len, &payload->data) != 0) return -1;
+    return offset;
+}
+
+void free_payload_tld_journal_resp(payload_tld_journal_resp_t* payload) {
+    if (!payload) return;
+    free(payload->data);
+    payload->data = NULL;
+}
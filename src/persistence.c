@@ -0,0 +1,1331 @@
+#include "../include/persistence.h"
+#include "../include/debug.h"
+#include "../include/tld_snapshot.h"
+#include "../include/tld_journal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sqlite3.h>
+
+#define DEFAULT_CACHE_SIZE_KB 2048
+#define DEFAULT_SYNC_MODE 1
+#define DEFAULT_FLUSH_INTERVAL_MS 50
+#define DEFAULT_MAX_BATCH_SIZE 1024
+#define COMMIT_ATTEMPTS 5               // Per batch, backing off from flush_interval_ms
+
+// Queued mutation owned by the write-behind queue
+typedef enum {
+    PERSIST_OP_UPSERT_TLD,
+    PERSIST_OP_INSERT_RECORD,
+    PERSIST_OP_DELETE_RECORD,
+    PERSIST_OP_INSERT_NODE,
+    PERSIST_OP_PRUNE_NODES
+} persist_op_type_t;
+
+typedef struct persist_op_s {
+    persist_op_type_t type;
+    char* tld_name;
+    time_t created_at;
+    time_t last_modified;
+    dns_record_t record;        // INSERT_RECORD / DELETE_RECORD (name, type, rdata)
+    tld_node_t node;            // INSERT_NODE
+    int is_authoritative;       // INSERT_NODE
+    time_t stale_threshold;     // PRUNE_NODES
+    uint64_t journal_seq;       // 0 when the mutation is not journaled
+    struct persist_op_s* next;
+} persist_op_t;
+
+struct persistence_context_s {
+    sqlite3* db;
+    persistence_config_t config;
+    pthread_mutex_t db_lock;    // Recursive; held across begin/commit_transaction
+
+    // Prepared statements used by the hot write path
+    sqlite3_stmt* stmt_upsert_tld;
+    sqlite3_stmt* stmt_touch_tld;
+    sqlite3_stmt* stmt_insert_record;
+    sqlite3_stmt* stmt_delete_record;
+    sqlite3_stmt* stmt_insert_node;
+    sqlite3_stmt* stmt_prune_nodes;
+
+    // Write-behind queue
+    pthread_mutex_t queue_lock;
+    pthread_cond_t queue_cond;
+    pthread_cond_t flushed_cond;
+    persist_op_t* queue_head;
+    persist_op_t* queue_tail;
+    size_t queue_len;
+    uint64_t enqueued_seq;
+    uint64_t committed_seq;
+    int flush_requested;
+    int write_error;            // Sticky: a batch was dropped after COMMIT_ATTEMPTS
+    int running;
+    pthread_t writer_thread;
+    tld_manager_t* attached_manager;
+
+    // <db_path>.journal: every mutation is appended here before it is
+    // queued, so whatever the write-behind queue loses can be replayed
+    tld_journal_t* journal;
+};
+
+static const char* schema_sql =
+    "CREATE TABLE IF NOT EXISTS schema_version (version INTEGER NOT NULL);"
+    "CREATE TABLE IF NOT EXISTS tlds ("
+    "  name TEXT PRIMARY KEY,"
+    "  created_at INTEGER NOT NULL,"
+    "  last_modified INTEGER NOT NULL);"
+    "CREATE TABLE IF NOT EXISTS dns_records ("
+    "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "  tld_name TEXT NOT NULL,"
+    "  name TEXT NOT NULL,"
+    "  type INTEGER NOT NULL,"
+    "  ttl INTEGER NOT NULL,"
+    "  last_updated INTEGER NOT NULL,"
+    "  rdata TEXT NOT NULL);"
+    "CREATE INDEX IF NOT EXISTS idx_dns_records_lookup ON dns_records (tld_name, name, type);"
+    "CREATE TABLE IF NOT EXISTS tld_nodes ("
+    "  tld_name TEXT NOT NULL,"
+    "  hostname TEXT NOT NULL,"
+    "  ip_address TEXT NOT NULL,"
+    "  last_seen INTEGER NOT NULL,"
+    "  is_authoritative INTEGER NOT NULL);"
+    "CREATE INDEX IF NOT EXISTS idx_tld_nodes_tld ON tld_nodes (tld_name);"
+    "CREATE TABLE IF NOT EXISTS network_configs ("
+    "  profile_name TEXT PRIMARY KEY,"
+    "  config_data TEXT NOT NULL);"
+    "CREATE TABLE IF NOT EXISTS meta ("
+    "  key TEXT PRIMARY KEY,"
+    "  value INTEGER NOT NULL);";
+
+static int exec_sql(persistence_context_t* ctx, const char* sql) {
+    char* err = NULL;
+    if (sqlite3_exec(ctx->db, sql, NULL, NULL, &err) != SQLITE_OK) {
+        dlog("Persistence: SQL failed (%s): %s", sql, err ? err : "unknown error");
+        sqlite3_free(err);
+        return -1;
+    }
+    return 0;
+}
+
+static int prepare(persistence_context_t* ctx, const char* sql, sqlite3_stmt** stmt) {
+    if (sqlite3_prepare_v2(ctx->db, sql, -1, stmt, NULL) != SQLITE_OK) {
+        dlog("Persistence: failed to prepare '%s': %s", sql, sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    return 0;
+}
+
+// Run a prepared statement to completion and reset it for reuse
+static int step_done(persistence_context_t* ctx, sqlite3_stmt* stmt) {
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (rc != SQLITE_DONE) {
+        dlog("Persistence: statement failed: %s", sqlite3_errmsg(ctx->db));
+        return -1;
+    }
+    return 0;
+}
+
+// Every transaction that changes TLDs or records bumps this counter, so a
+// snapshot tagged with it can tell whether the database moved on since.
+static int bump_mutation_seq(persistence_context_t* ctx) {
+    return exec_sql(ctx, "INSERT INTO meta (key, value) VALUES ('mutation_seq', 1) "
+                         "ON CONFLICT(key) DO UPDATE SET value = value + 1");
+}
+
+// The last journal sequence whose mutation is committed: restore replays
+// the journal from here. Set in the same transaction as the mutations.
+static int record_journal_seq(persistence_context_t* ctx, uint64_t seq) {
+    char sql[160];
+    snprintf(sql, sizeof(sql), "INSERT INTO meta (key, value) VALUES ('journal_seq', %llu) "
+             "ON CONFLICT(key) DO UPDATE SET value = excluded.value", (unsigned long long)seq);
+    return exec_sql(ctx, sql);
+}
+
+static uint64_t read_meta_value(persistence_context_t* ctx, const char* key) {
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_stmt* stmt = NULL;
+    uint64_t value = 0;
+    if (prepare(ctx, "SELECT value FROM meta WHERE key = ?1", &stmt) == 0) {
+        sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = (uint64_t)sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&ctx->db_lock);
+    return value;
+}
+
+static int init_schema(persistence_context_t* ctx) {
+    if (exec_sql(ctx, schema_sql) != 0) return -1;
+
+    sqlite3_stmt* stmt = NULL;
+    if (prepare(ctx, "SELECT version FROM schema_version LIMIT 1", &stmt) != 0) return -1;
+    int has_version = sqlite3_step(stmt) == SQLITE_ROW;
+    int version = has_version ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+
+    if (!has_version) {
+        char sql[64];
+        snprintf(sql, sizeof(sql), "INSERT INTO schema_version (version) VALUES (%d)", PERSISTENCE_SCHEMA_VERSION);
+        return exec_sql(ctx, sql);
+    }
+    if (version > PERSISTENCE_SCHEMA_VERSION) {
+        dlog("Persistence: database schema v%d is newer than supported v%d", version, PERSISTENCE_SCHEMA_VERSION);
+        return -1;
+    }
+    return 0;
+}
+
+static int apply_pragmas(persistence_context_t* ctx) {
+    char sql[96];
+
+    if (ctx->config.enable_wal_mode && exec_sql(ctx, "PRAGMA journal_mode=WAL") != 0) return -1;
+
+    // Negative cache_size is interpreted by SQLite as KiB
+    snprintf(sql, sizeof(sql), "PRAGMA cache_size=-%d", ctx->config.cache_size_kb);
+    if (exec_sql(ctx, sql) != 0) return -1;
+
+    int sync_mode = ctx->config.sync_mode;
+    if (sync_mode < 0 || sync_mode > 2) sync_mode = DEFAULT_SYNC_MODE;
+    snprintf(sql, sizeof(sql), "PRAGMA synchronous=%d", sync_mode);
+    return exec_sql(ctx, sql);
+}
+
+static int prepare_statements(persistence_context_t* ctx) {
+    return prepare(ctx, "INSERT INTO tlds (name, created_at, last_modified) VALUES (?1, ?2, ?3) "
+                        "ON CONFLICT(name) DO UPDATE SET last_modified = excluded.last_modified",
+                   &ctx->stmt_upsert_tld) ||
+           prepare(ctx, "UPDATE tlds SET last_modified = ?2 WHERE name = ?1", &ctx->stmt_touch_tld) ||
+           prepare(ctx, "INSERT INTO dns_records (tld_name, name, type, ttl, last_updated, rdata) "
+                        "VALUES (?1, ?2, ?3, ?4, ?5, ?6)",
+                   &ctx->stmt_insert_record) ||
+           // The TLD manager removes one matching record, so mirror that here
+           prepare(ctx, "DELETE FROM dns_records WHERE id = (SELECT id FROM dns_records "
+                        "WHERE tld_name = ?1 AND name = ?2 AND type = ?3 AND rdata = ?4 ORDER BY id LIMIT 1)",
+                   &ctx->stmt_delete_record) ||
+           prepare(ctx, "INSERT INTO tld_nodes (tld_name, hostname, ip_address, last_seen, is_authoritative) "
+                        "VALUES (?1, ?2, ?3, ?4, ?5)",
+                   &ctx->stmt_insert_node) ||
+           prepare(ctx, "DELETE FROM tld_nodes WHERE tld_name = ?1 AND last_seen < ?2", &ctx->stmt_prune_nodes)
+           ? -1 : 0;
+}
+
+static void finalize_statements(persistence_context_t* ctx) {
+    sqlite3_finalize(ctx->stmt_upsert_tld);
+    sqlite3_finalize(ctx->stmt_touch_tld);
+    sqlite3_finalize(ctx->stmt_insert_record);
+    sqlite3_finalize(ctx->stmt_delete_record);
+    sqlite3_finalize(ctx->stmt_insert_node);
+    sqlite3_finalize(ctx->stmt_prune_nodes);
+}
+
+static int write_tld_row(persistence_context_t* ctx, const char* name, time_t created_at, time_t last_modified) {
+    sqlite3_bind_text(ctx->stmt_upsert_tld, 1, name, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(ctx->stmt_upsert_tld, 2, (sqlite3_int64)created_at);
+    sqlite3_bind_int64(ctx->stmt_upsert_tld, 3, (sqlite3_int64)last_modified);
+    return step_done(ctx, ctx->stmt_upsert_tld);
+}
+
+static int write_record_row(persistence_context_t* ctx, const char* tld_name, const dns_record_t* record) {
+    sqlite3_bind_text(ctx->stmt_insert_record, 1, tld_name, -1, SQLITE_STATIC);
+    sqlite3_bind_text(ctx->stmt_insert_record, 2, record->name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(ctx->stmt_insert_record, 3, (int)record->type);
+    sqlite3_bind_int64(ctx->stmt_insert_record, 4, (sqlite3_int64)record->ttl);
+    sqlite3_bind_int64(ctx->stmt_insert_record, 5, (sqlite3_int64)record->last_updated);
+    sqlite3_bind_text(ctx->stmt_insert_record, 6, record->rdata, -1, SQLITE_STATIC);
+    return step_done(ctx, ctx->stmt_insert_record);
+}
+
+static int write_node_row(persistence_context_t* ctx, const char* tld_name, const tld_node_t* node, int is_authoritative) {
+    sqlite3_bind_text(ctx->stmt_insert_node, 1, tld_name, -1, SQLITE_STATIC);
+    sqlite3_bind_text(ctx->stmt_insert_node, 2, node->hostname, -1, SQLITE_STATIC);
+    sqlite3_bind_text(ctx->stmt_insert_node, 3, node->ip_address, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(ctx->stmt_insert_node, 4, (sqlite3_int64)node->last_seen);
+    sqlite3_bind_int(ctx->stmt_insert_node, 5, is_authoritative ? 1 : 0);
+    return step_done(ctx, ctx->stmt_insert_node);
+}
+
+static int touch_tld_row(persistence_context_t* ctx, const char* name, time_t last_modified) {
+    sqlite3_bind_text(ctx->stmt_touch_tld, 1, name, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(ctx->stmt_touch_tld, 2, (sqlite3_int64)last_modified);
+    return step_done(ctx, ctx->stmt_touch_tld);
+}
+
+// --- Write-behind queue ---
+
+static void free_persist_op(persist_op_t* op) {
+    if (!op) return;
+    free(op->tld_name);
+    free(op->record.name);
+    free(op->record.rdata);
+    free(op->node.hostname);
+    free(op->node.ip_address);
+    free(op);
+}
+
+static int apply_persist_op(persistence_context_t* ctx, const persist_op_t* op) {
+    switch (op->type) {
+        case PERSIST_OP_UPSERT_TLD:
+            return write_tld_row(ctx, op->tld_name, op->created_at, op->last_modified);
+        case PERSIST_OP_INSERT_RECORD:
+            if (write_record_row(ctx, op->tld_name, &op->record) != 0) return -1;
+            return touch_tld_row(ctx, op->tld_name, op->last_modified);
+        case PERSIST_OP_DELETE_RECORD:
+            sqlite3_bind_text(ctx->stmt_delete_record, 1, op->tld_name, -1, SQLITE_STATIC);
+            sqlite3_bind_text(ctx->stmt_delete_record, 2, op->record.name, -1, SQLITE_STATIC);
+            sqlite3_bind_int(ctx->stmt_delete_record, 3, (int)op->record.type);
+            sqlite3_bind_text(ctx->stmt_delete_record, 4, op->record.rdata, -1, SQLITE_STATIC);
+            if (step_done(ctx, ctx->stmt_delete_record) != 0) return -1;
+            return touch_tld_row(ctx, op->tld_name, op->last_modified);
+        case PERSIST_OP_INSERT_NODE:
+            return write_node_row(ctx, op->tld_name, &op->node, op->is_authoritative);
+        case PERSIST_OP_PRUNE_NODES:
+            sqlite3_bind_text(ctx->stmt_prune_nodes, 1, op->tld_name, -1, SQLITE_STATIC);
+            sqlite3_bind_int64(ctx->stmt_prune_nodes, 2, (sqlite3_int64)op->stale_threshold);
+            return step_done(ctx, ctx->stmt_prune_nodes);
+    }
+    return -1;
+}
+
+// Apply one batch in a single transaction: one fsync for the whole group.
+// A failed batch is rolled back whole, so it can be retried as is.
+static int commit_batch(persistence_context_t* ctx, persist_op_t* batch) {
+    pthread_mutex_lock(&ctx->db_lock);
+
+    int ok = exec_sql(ctx, "BEGIN") == 0 && bump_mutation_seq(ctx) == 0;
+    uint64_t journal_seq = 0;
+    for (persist_op_t* op = batch; ok && op; op = op->next) {
+        ok = apply_persist_op(ctx, op) == 0;
+        if (op->journal_seq > journal_seq) journal_seq = op->journal_seq;
+    }
+    if (ok && journal_seq) {
+        ok = record_journal_seq(ctx, journal_seq) == 0;
+    }
+    if (ok) {
+        ok = exec_sql(ctx, "COMMIT") == 0;
+    }
+    if (!ok) {
+        log_error("Persistence: write-behind commit failed: %s", sqlite3_errmsg(ctx->db));
+        exec_sql(ctx, "ROLLBACK");
+    }
+
+    pthread_mutex_unlock(&ctx->db_lock);
+    return ok ? 0 : -1;
+}
+
+// Commit a batch, retrying with backoff. Only when every attempt fails is
+// the batch dropped, and then write_error makes flush and cleanup fail.
+static void write_batch(persistence_context_t* ctx, persist_op_t* batch, size_t batch_len) {
+    long backoff_ms = ctx->config.flush_interval_ms;
+    for (int attempt = 1; commit_batch(ctx, batch) != 0; ++attempt) {
+        if (attempt == COMMIT_ATTEMPTS) {
+            log_error("Persistence: dropped write-behind batch of %zu mutations after %d attempts",
+                      batch_len, attempt);
+            pthread_mutex_lock(&ctx->queue_lock);
+            ctx->write_error = 1;
+            pthread_mutex_unlock(&ctx->queue_lock);
+            break;
+        }
+        log_warn("Persistence: retrying write-behind batch of %zu mutations in %ld ms", batch_len, backoff_ms);
+        struct timespec delay = { backoff_ms / 1000, (backoff_ms % 1000) * 1000000L };
+        nanosleep(&delay, NULL);
+        backoff_ms *= 2;
+    }
+
+    while (batch) {
+        persist_op_t* next = batch->next;
+        free_persist_op(batch);
+        batch = next;
+    }
+}
+
+static void* persistence_writer_thread(void* arg) {
+    persistence_context_t* ctx = (persistence_context_t*)arg;
+
+    pthread_mutex_lock(&ctx->queue_lock);
+    while (ctx->running || ctx->queue_head) {
+        while (ctx->running && !ctx->queue_head) {
+            pthread_cond_wait(&ctx->queue_cond, &ctx->queue_lock);
+        }
+
+        // Group commit window: let more mutations accumulate unless the batch
+        // is already full, a flush was requested, or we are shutting down.
+        if (ctx->running && !ctx->flush_requested &&
+            ctx->queue_len < (size_t)ctx->config.max_batch_size) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)ctx->config.flush_interval_ms * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            while (ctx->running && !ctx->flush_requested &&
+                   ctx->queue_len < (size_t)ctx->config.max_batch_size) {
+                if (pthread_cond_timedwait(&ctx->queue_cond, &ctx->queue_lock, &deadline) == ETIMEDOUT) break;
+            }
+        }
+
+        persist_op_t* batch = ctx->queue_head;
+        size_t batch_len = ctx->queue_len;
+        uint64_t batch_seq = ctx->enqueued_seq;
+        ctx->queue_head = ctx->queue_tail = NULL;
+        ctx->queue_len = 0;
+        ctx->flush_requested = 0;
+        pthread_mutex_unlock(&ctx->queue_lock);
+
+        if (batch) {
+            write_batch(ctx, batch, batch_len);
+        }
+
+        pthread_mutex_lock(&ctx->queue_lock);
+        ctx->committed_seq = batch_seq;
+        pthread_cond_broadcast(&ctx->flushed_cond);
+    }
+    pthread_mutex_unlock(&ctx->queue_lock);
+    return NULL;
+}
+
+static void enqueue_persist_op(persistence_context_t* ctx, persist_op_t* op) {
+    pthread_mutex_lock(&ctx->queue_lock);
+    if (ctx->queue_tail) {
+        ctx->queue_tail->next = op;
+    } else {
+        ctx->queue_head = op;
+    }
+    ctx->queue_tail = op;
+    ctx->queue_len++;
+    ctx->enqueued_seq++;
+    if (ctx->queue_len == 1 || ctx->queue_len >= (size_t)ctx->config.max_batch_size) {
+        pthread_cond_signal(&ctx->queue_cond);
+    }
+    pthread_mutex_unlock(&ctx->queue_lock);
+}
+
+// Copy a mutation into a queue entry, NULL if it cannot be copied
+static persist_op_t* persist_op_for(const tld_mutation_t* mutation) {
+    persist_op_t* op = calloc(1, sizeof(persist_op_t));
+    if (!op) return NULL;
+    op->tld_name = strdup(mutation->tld->name);
+    op->created_at = mutation->tld->created_at;
+    op->last_modified = mutation->tld->last_modified;
+
+    int ok = op->tld_name != NULL;
+    switch (mutation->type) {
+        case TLD_MUTATION_REGISTER:
+            op->type = PERSIST_OP_UPSERT_TLD;
+            break;
+        case TLD_MUTATION_ADD_RECORD:
+        case TLD_MUTATION_REMOVE_RECORD:
+            op->type = mutation->type == TLD_MUTATION_ADD_RECORD ? PERSIST_OP_INSERT_RECORD : PERSIST_OP_DELETE_RECORD;
+            op->record.name = strdup(mutation->record->name);
+            op->record.rdata = strdup(mutation->record->rdata);
+            op->record.type = mutation->record->type;
+            op->record.ttl = mutation->record->ttl;
+            op->record.last_updated = mutation->record->last_updated;
+            ok = ok && op->record.name && op->record.rdata;
+            break;
+        case TLD_MUTATION_ADD_AUTHORITATIVE_NODE:
+        case TLD_MUTATION_ADD_MIRROR_NODE:
+            op->type = PERSIST_OP_INSERT_NODE;
+            op->is_authoritative = mutation->type == TLD_MUTATION_ADD_AUTHORITATIVE_NODE;
+            op->node.hostname = strdup(mutation->node->hostname);
+            op->node.ip_address = strdup(mutation->node->ip_address);
+            op->node.last_seen = mutation->node->last_seen;
+            ok = ok && op->node.hostname && op->node.ip_address;
+            break;
+        case TLD_MUTATION_PRUNE_STALE_NODES:
+            op->type = PERSIST_OP_PRUNE_NODES;
+            op->stale_threshold = mutation->stale_threshold;
+            break;
+        default:
+            ok = 0;
+            break;
+    }
+
+    if (!ok) {
+        free_persist_op(op);
+        return NULL;
+    }
+    return op;
+}
+
+// TLD manager listener: journal the mutation and hand a copy to the writer thread
+static void on_tld_mutation(void* arg, const tld_mutation_t* mutation) {
+    persistence_context_t* ctx = (persistence_context_t*)arg;
+    if (!ctx || !mutation || !mutation->tld) return;
+
+    uint64_t journal_seq = 0;
+    if (ctx->journal && tld_journal_append(ctx->journal, mutation, &journal_seq) != 0) {
+        log_error("Persistence: failed to journal mutation %d for TLD %s", mutation->type, mutation->tld->name);
+    }
+
+    persist_op_t* op = persist_op_for(mutation);
+    if (!op) {
+        dlog("Persistence: failed to queue mutation %d for TLD %s", mutation->type, mutation->tld->name);
+        return;
+    }
+    op->journal_seq = journal_seq;
+    enqueue_persist_op(ctx, op);
+}
+
+// --- Initialization and cleanup ---
+
+static void journal_path_for(const persistence_context_t* ctx, char* buf, size_t len) {
+    snprintf(buf, len, "%s.journal", ctx->config.db_path);
+}
+
+static int open_journal(persistence_context_t* ctx) {
+    char path[1024];
+    journal_path_for(ctx, path, sizeof(path));
+    if (open_tld_journal(&ctx->journal, path, NULL) != 0) {
+        log_error("Persistence: failed to open journal %s", path);
+        return -1;
+    }
+
+    // A journal behind the database (e.g. deleted) must not reuse sequences
+    uint64_t committed = read_meta_value(ctx, "journal_seq");
+    if (tld_journal_last_sequence(ctx->journal) < committed &&
+        compact_tld_journal(ctx->journal, committed) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int init_persistence(persistence_context_t** ctx_out, const persistence_config_t* config) {
+    if (!ctx_out || !config || !config->db_path) return -1;
+    *ctx_out = NULL;
+
+    persistence_context_t* ctx = calloc(1, sizeof(persistence_context_t));
+    if (!ctx) return -1;
+
+    ctx->config = *config;
+    ctx->config.db_path = strdup(config->db_path);
+    if (ctx->config.cache_size_kb <= 0) ctx->config.cache_size_kb = DEFAULT_CACHE_SIZE_KB;
+    if (ctx->config.flush_interval_ms <= 0) ctx->config.flush_interval_ms = DEFAULT_FLUSH_INTERVAL_MS;
+    if (ctx->config.max_batch_size <= 0) ctx->config.max_batch_size = DEFAULT_MAX_BATCH_SIZE;
+    if (!ctx->config.db_path) {
+        free(ctx);
+        return -1;
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&ctx->db_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    pthread_mutex_init(&ctx->queue_lock, NULL);
+    pthread_cond_init(&ctx->queue_cond, NULL);
+    pthread_cond_init(&ctx->flushed_cond, NULL);
+
+    if (sqlite3_open_v2(ctx->config.db_path, &ctx->db,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        dlog("Persistence: failed to open %s: %s", ctx->config.db_path, ctx->db ? sqlite3_errmsg(ctx->db) : "out of memory");
+        goto fail;
+    }
+    if (apply_pragmas(ctx) != 0 || init_schema(ctx) != 0 || prepare_statements(ctx) != 0) {
+        goto fail;
+    }
+    if (ctx->config.enable_journal && open_journal(ctx) != 0) {
+        goto fail;
+    }
+
+    ctx->running = 1;
+    if (pthread_create(&ctx->writer_thread, NULL, persistence_writer_thread, ctx) != 0) {
+        dlog("Persistence: failed to start writer thread");
+        ctx->running = 0;
+        goto fail;
+    }
+
+    dlog("Persistence initialized: %s (WAL=%d, sync=%d)", ctx->config.db_path,
+         ctx->config.enable_wal_mode, ctx->config.sync_mode);
+    *ctx_out = ctx;
+    return 0;
+
+fail:
+    close_tld_journal(ctx->journal);
+    finalize_statements(ctx);
+    sqlite3_close(ctx->db);
+    pthread_cond_destroy(&ctx->flushed_cond);
+    pthread_cond_destroy(&ctx->queue_cond);
+    pthread_mutex_destroy(&ctx->queue_lock);
+    pthread_mutex_destroy(&ctx->db_lock);
+    free(ctx->config.db_path);
+    free(ctx);
+    return -1;
+}
+
+int cleanup_persistence(persistence_context_t* ctx) {
+    if (!ctx) return -1;
+
+    detach_persistence_from_tld_manager(ctx);
+
+    // The writer drains whatever is still queued before exiting
+    pthread_mutex_lock(&ctx->queue_lock);
+    ctx->running = 0;
+    pthread_cond_broadcast(&ctx->queue_cond);
+    pthread_mutex_unlock(&ctx->queue_lock);
+    pthread_join(ctx->writer_thread, NULL);
+    int result = ctx->write_error ? -1 : 0;
+    close_tld_journal(ctx->journal);
+
+    finalize_statements(ctx);
+    sqlite3_close(ctx->db);
+
+    pthread_cond_destroy(&ctx->flushed_cond);
+    pthread_cond_destroy(&ctx->queue_cond);
+    pthread_mutex_destroy(&ctx->queue_lock);
+    pthread_mutex_destroy(&ctx->db_lock);
+    free(ctx->config.db_path);
+    free(ctx);
+    return result;
+}
+
+// --- Write-behind control ---
+
+int attach_persistence_to_tld_manager(persistence_context_t* ctx, tld_manager_t* manager) {
+    if (!ctx || !manager || ctx->attached_manager) return -1;
+    if (add_tld_mutation_listener(manager, on_tld_mutation, ctx) != 0) return -1;
+    ctx->attached_manager = manager;
+    return 0;
+}
+
+void detach_persistence_from_tld_manager(persistence_context_t* ctx) {
+    if (!ctx || !ctx->attached_manager) return;
+    remove_tld_mutation_listener(ctx->attached_manager, on_tld_mutation, ctx);
+    ctx->attached_manager = NULL;
+}
+
+int persistence_flush(persistence_context_t* ctx) {
+    if (!ctx) return -1;
+
+    pthread_mutex_lock(&ctx->queue_lock);
+    uint64_t target = ctx->enqueued_seq;
+    if (ctx->committed_seq < target) {
+        ctx->flush_requested = 1;
+        pthread_cond_signal(&ctx->queue_cond);
+        while (ctx->committed_seq < target) {
+            pthread_cond_wait(&ctx->flushed_cond, &ctx->queue_lock);
+        }
+    }
+    int result = ctx->write_error ? -1 : 0;
+    pthread_mutex_unlock(&ctx->queue_lock);
+    return result;
+}
+
+tld_journal_t* persistence_journal(persistence_context_t* ctx) {
+    return ctx ? ctx->journal : NULL;
+}
+
+size_t persistence_pending_count(persistence_context_t* ctx) {
+    if (!ctx) return 0;
+    pthread_mutex_lock(&ctx->queue_lock);
+    size_t pending = (size_t)(ctx->enqueued_seq - ctx->committed_seq);
+    pthread_mutex_unlock(&ctx->queue_lock);
+    return pending;
+}
+
+// --- TLD persistence ---
+
+typedef struct {
+    persistence_context_t* ctx;
+    const char* tld_name;
+} persist_record_ctx_t;
+
+static int persist_record_visitor(void* arg, const dns_record_t* record) {
+    persist_record_ctx_t* rec_ctx = arg;
+    return write_record_row(rec_ctx->ctx, rec_ctx->tld_name, record);
+}
+
+int persist_tld(persistence_context_t* ctx, const tld_t* tld) {
+    if (!ctx || !tld || !tld->name) return -1;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    int ok = exec_sql(ctx, "SAVEPOINT persist_tld") == 0 && bump_mutation_seq(ctx) == 0;
+    if (ok) ok = write_tld_row(ctx, tld->name, tld->created_at, tld->last_modified) == 0;
+
+    if (ok) {
+        sqlite3_stmt* stmt = NULL;
+        ok = prepare(ctx, "DELETE FROM dns_records WHERE tld_name = ?1", &stmt) == 0;
+        if (ok) {
+            sqlite3_bind_text(stmt, 1, tld->name, -1, SQLITE_STATIC);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (ok) {
+        persist_record_ctx_t rec_ctx = { ctx, tld->name };
+        ok = tld_for_each_record(tld, persist_record_visitor, &rec_ctx) == 0;
+    }
+    // db_lock is recursive, so the nested savepoints below stay inside ours
+    if (ok) {
+        ok = persist_tld_nodes(ctx, tld->name, tld->authoritative_nodes, tld->authoritative_node_count, 1) == 0 &&
+             persist_tld_nodes(ctx, tld->name, tld->mirror_nodes, tld->mirror_node_count, 0) == 0;
+    }
+
+    if (ok) {
+        ok = exec_sql(ctx, "RELEASE persist_tld") == 0;
+    } else {
+        exec_sql(ctx, "ROLLBACK TO persist_tld");
+        exec_sql(ctx, "RELEASE persist_tld");
+    }
+    pthread_mutex_unlock(&ctx->db_lock);
+    return ok ? 0 : -1;
+}
+
+int load_tld(persistence_context_t* ctx, const char* tld_name, tld_t** tld_out) {
+    if (!ctx || !tld_name || !tld_out) return -1;
+    *tld_out = NULL;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_stmt* stmt = NULL;
+    if (prepare(ctx, "SELECT created_at, last_modified FROM tlds WHERE name = ?1", &stmt) != 0) {
+        pthread_mutex_unlock(&ctx->db_lock);
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, tld_name, -1, SQLITE_STATIC);
+    int found = sqlite3_step(stmt) == SQLITE_ROW;
+    time_t created_at = found ? (time_t)sqlite3_column_int64(stmt, 0) : 0;
+    time_t last_modified = found ? (time_t)sqlite3_column_int64(stmt, 1) : 0;
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&ctx->db_lock);
+
+    if (!found) return -1;
+
+    tld_t* tld = calloc(1, sizeof(tld_t));
+    if (!tld) return -1;
+    tld->name = strdup(tld_name);
+    tld->created_at = created_at;
+    tld->last_modified = last_modified;
+
+    if (!tld->name ||
+        load_dns_records(ctx, tld_name, &tld->records, &tld->record_count) != 0 ||
+        load_tld_nodes(ctx, tld_name, &tld->authoritative_nodes, &tld->authoritative_node_count,
+                       &tld->mirror_nodes, &tld->mirror_node_count) != 0) {
+        free_loaded_tld(tld);
+        return -1;
+    }
+
+    *tld_out = tld;
+    return 0;
+}
+
+void free_loaded_tld(tld_t* tld) {
+    if (!tld) return;
+    free(tld->name);
+    for (size_t i = 0; i < tld->record_count; ++i) {
+        free(tld->records[i].name);
+        free(tld->records[i].rdata);
+    }
+    free(tld->records);
+    for (size_t i = 0; i < tld->authoritative_node_count; ++i) {
+        free(tld->authoritative_nodes[i].hostname);
+        free(tld->authoritative_nodes[i].ip_address);
+    }
+    free(tld->authoritative_nodes);
+    for (size_t i = 0; i < tld->mirror_node_count; ++i) {
+        free(tld->mirror_nodes[i].hostname);
+        free(tld->mirror_nodes[i].ip_address);
+    }
+    free(tld->mirror_nodes);
+    free(tld);
+}
+
+int delete_tld(persistence_context_t* ctx, const char* tld_name) {
+    if (!ctx || !tld_name) return -1;
+
+    static const char* deletes[] = {
+        "DELETE FROM dns_records WHERE tld_name = ?1",
+        "DELETE FROM tld_nodes WHERE tld_name = ?1",
+        "DELETE FROM tlds WHERE name = ?1"
+    };
+
+    pthread_mutex_lock(&ctx->db_lock);
+    int ok = exec_sql(ctx, "SAVEPOINT delete_tld") == 0 && bump_mutation_seq(ctx) == 0;
+    for (size_t i = 0; ok && i < sizeof(deletes) / sizeof(deletes[0]); ++i) {
+        sqlite3_stmt* stmt = NULL;
+        ok = prepare(ctx, deletes[i], &stmt) == 0;
+        if (ok) {
+            sqlite3_bind_text(stmt, 1, tld_name, -1, SQLITE_STATIC);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (ok) {
+        ok = exec_sql(ctx, "RELEASE delete_tld") == 0;
+    } else {
+        exec_sql(ctx, "ROLLBACK TO delete_tld");
+        exec_sql(ctx, "RELEASE delete_tld");
+    }
+    pthread_mutex_unlock(&ctx->db_lock);
+    return ok ? 0 : -1;
+}
+
+int list_tlds(persistence_context_t* ctx, char*** tld_names, size_t* count) {
+    if (!ctx || !tld_names || !count) return -1;
+    *tld_names = NULL;
+    *count = 0;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_stmt* stmt = NULL;
+    if (prepare(ctx, "SELECT name FROM tlds ORDER BY created_at, name", &stmt) != 0) {
+        pthread_mutex_unlock(&ctx->db_lock);
+        return -1;
+    }
+
+    char** names = NULL;
+    size_t n = 0, capacity = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (n == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            char** grown = realloc(names, capacity * sizeof(char*));
+            if (!grown) break;
+            names = grown;
+        }
+        names[n] = strdup((const char*)sqlite3_column_text(stmt, 0));
+        if (!names[n]) break;
+        n++;
+    }
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&ctx->db_lock);
+
+    if (rc != SQLITE_DONE) {
+        for (size_t i = 0; i < n; ++i) free(names[i]);
+        free(names);
+        return -1;
+    }
+
+    *tld_names = names;
+    *count = n;
+    return 0;
+}
+
+// --- DNS record persistence ---
+
+int persist_dns_record(persistence_context_t* ctx, const char* tld_name, const dns_record_t* record) {
+    if (!ctx || !tld_name || !record || !record->name || !record->rdata) return -1;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    int result = write_record_row(ctx, tld_name, record);
+    if (result == 0) result = bump_mutation_seq(ctx);
+    pthread_mutex_unlock(&ctx->db_lock);
+    return result;
+}
+
+int load_dns_records(persistence_context_t* ctx, const char* tld_name, dns_record_t** records, size_t* count) {
+    if (!ctx || !tld_name || !records || !count) return -1;
+    *records = NULL;
+    *count = 0;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_stmt* stmt = NULL;
+    if (prepare(ctx, "SELECT name, type, ttl, last_updated, rdata FROM dns_records "
+                     "WHERE tld_name = ?1 ORDER BY id", &stmt) != 0) {
+        pthread_mutex_unlock(&ctx->db_lock);
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, tld_name, -1, SQLITE_STATIC);
+
+    dns_record_t* out = NULL;
+    size_t n = 0, capacity = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (n == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            dns_record_t* grown = realloc(out, capacity * sizeof(dns_record_t));
+            if (!grown) break;
+            out = grown;
+        }
+        dns_record_t* rec = &out[n];
+        rec->name = strdup((const char*)sqlite3_column_text(stmt, 0));
+        rec->type = (dns_record_type_t)sqlite3_column_int(stmt, 1);
+        rec->ttl = (uint32_t)sqlite3_column_int64(stmt, 2);
+        rec->last_updated = (time_t)sqlite3_column_int64(stmt, 3);
+        rec->rdata = strdup((const char*)sqlite3_column_text(stmt, 4));
+        if (!rec->name || !rec->rdata) {
+            free(rec->name);
+            free(rec->rdata);
+            break;
+        }
+        n++;
+    }
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&ctx->db_lock);
+
+    if (rc != SQLITE_DONE) {
+        for (size_t i = 0; i < n; ++i) {
+            free(out[i].name);
+            free(out[i].rdata);
+        }
+        free(out);
+        return -1;
+    }
+
+    *records = out;
+    *count = n;
+    return 0;
+}
+
+int delete_dns_record(persistence_context_t* ctx, const char* tld_name, const char* record_name, dns_record_type_t type) {
+    if (!ctx || !tld_name || !record_name) return -1;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_bind_text(ctx->stmt_delete_record, 1, tld_name, -1, SQLITE_STATIC);
+    sqlite3_bind_text(ctx->stmt_delete_record, 2, record_name, -1, SQLITE_STATIC);
+    sqlite3_bind_int(ctx->stmt_delete_record, 3, (int)type);
+    int result = step_done(ctx, ctx->stmt_delete_record);
+    if (result == 0 && sqlite3_changes(ctx->db) == 0) result = -1;
+    if (result == 0) result = bump_mutation_seq(ctx);
+    pthread_mutex_unlock(&ctx->db_lock);
+    return result;
+}
+
+// --- TLD node persistence ---
+
+int persist_tld_nodes(persistence_context_t* ctx, const char* tld_name, const tld_node_t* nodes, size_t count, int is_authoritative) {
+    if (!ctx || !tld_name || (count > 0 && !nodes)) return -1;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    int ok = exec_sql(ctx, "SAVEPOINT persist_nodes") == 0;
+    if (ok) {
+        sqlite3_stmt* stmt = NULL;
+        ok = prepare(ctx, "DELETE FROM tld_nodes WHERE tld_name = ?1 AND is_authoritative = ?2", &stmt) == 0;
+        if (ok) {
+            sqlite3_bind_text(stmt, 1, tld_name, -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 2, is_authoritative ? 1 : 0);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+        sqlite3_finalize(stmt);
+    }
+    for (size_t i = 0; ok && i < count; ++i) {
+        ok = write_node_row(ctx, tld_name, &nodes[i], is_authoritative) == 0;
+    }
+    if (ok) {
+        ok = exec_sql(ctx, "RELEASE persist_nodes") == 0;
+    } else {
+        exec_sql(ctx, "ROLLBACK TO persist_nodes");
+        exec_sql(ctx, "RELEASE persist_nodes");
+    }
+    pthread_mutex_unlock(&ctx->db_lock);
+    return ok ? 0 : -1;
+}
+
+static int append_node(tld_node_t** list, size_t* count, sqlite3_stmt* stmt) {
+    tld_node_t* grown = realloc(*list, (*count + 1) * sizeof(tld_node_t));
+    if (!grown) return -1;
+    *list = grown;
+
+    tld_node_t* node = &grown[*count];
+    node->hostname = strdup((const char*)sqlite3_column_text(stmt, 0));
+    node->ip_address = strdup((const char*)sqlite3_column_text(stmt, 1));
+    node->last_seen = (time_t)sqlite3_column_int64(stmt, 2);
+    if (!node->hostname || !node->ip_address) {
+        free(node->hostname);
+        free(node->ip_address);
+        return -1;
+    }
+    (*count)++;
+    return 0;
+}
+
+int load_tld_nodes(persistence_context_t* ctx, const char* tld_name, tld_node_t** auth_nodes, size_t* auth_count, tld_node_t** mirror_nodes, size_t* mirror_count) {
+    if (!ctx || !tld_name || !auth_nodes || !auth_count || !mirror_nodes || !mirror_count) return -1;
+    *auth_nodes = NULL;
+    *mirror_nodes = NULL;
+    *auth_count = 0;
+    *mirror_count = 0;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_stmt* stmt = NULL;
+    if (prepare(ctx, "SELECT hostname, ip_address, last_seen, is_authoritative FROM tld_nodes "
+                     "WHERE tld_name = ?1 ORDER BY rowid", &stmt) != 0) {
+        pthread_mutex_unlock(&ctx->db_lock);
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, tld_name, -1, SQLITE_STATIC);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int result = sqlite3_column_int(stmt, 3)
+            ? append_node(auth_nodes, auth_count, stmt)
+            : append_node(mirror_nodes, mirror_count, stmt);
+        if (result != 0) break;
+    }
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&ctx->db_lock);
+
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+// --- Configuration persistence ---
+
+int persist_network_config(persistence_context_t* ctx, const char* profile_name, const char* config_data) {
+    if (!ctx || !profile_name || !config_data) return -1;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_stmt* stmt = NULL;
+    int ok = prepare(ctx, "INSERT INTO network_configs (profile_name, config_data) VALUES (?1, ?2) "
+                          "ON CONFLICT(profile_name) DO UPDATE SET config_data = excluded.config_data",
+                     &stmt) == 0;
+    if (ok) {
+        sqlite3_bind_text(stmt, 1, profile_name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, config_data, -1, SQLITE_STATIC);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&ctx->db_lock);
+    return ok ? 0 : -1;
+}
+
+int load_network_config(persistence_context_t* ctx, const char* profile_name, char** config_data) {
+    if (!ctx || !profile_name || !config_data) return -1;
+    *config_data = NULL;
+
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_stmt* stmt = NULL;
+    int result = -1;
+    if (prepare(ctx, "SELECT config_data FROM network_configs WHERE profile_name = ?1", &stmt) == 0) {
+        sqlite3_bind_text(stmt, 1, profile_name, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            *config_data = strdup((const char*)sqlite3_column_text(stmt, 0));
+            result = *config_data ? 0 : -1;
+        }
+    }
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(&ctx->db_lock);
+    return result;
+}
+
+// --- Database maintenance ---
+
+int vacuum_database(persistence_context_t* ctx) {
+    if (!ctx) return -1;
+
+    persistence_flush(ctx);
+    pthread_mutex_lock(&ctx->db_lock);
+    int result = exec_sql(ctx, "VACUUM");
+    pthread_mutex_unlock(&ctx->db_lock);
+    return result;
+}
+
+int backup_database(persistence_context_t* ctx, const char* backup_path) {
+    if (!ctx || !backup_path) return -1;
+
+    persistence_flush(ctx);
+
+    sqlite3* dest = NULL;
+    if (sqlite3_open(backup_path, &dest) != SQLITE_OK) {
+        dlog("Persistence: failed to open backup target %s", backup_path);
+        sqlite3_close(dest);
+        return -1;
+    }
+
+    pthread_mutex_lock(&ctx->db_lock);
+    sqlite3_backup* backup = sqlite3_backup_init(dest, "main", ctx->db, "main");
+    int rc = SQLITE_ERROR;
+    if (backup) {
+        rc = sqlite3_backup_step(backup, -1);
+        sqlite3_backup_finish(backup);
+    }
+    pthread_mutex_unlock(&ctx->db_lock);
+
+    sqlite3_close(dest);
+    if (rc != SQLITE_DONE) {
+        dlog("Persistence: backup to %s failed (%d)", backup_path, rc);
+        return -1;
+    }
+    return 0;
+}
+
+static int query_count(persistence_context_t* ctx, const char* sql, sqlite3_int64* out) {
+    sqlite3_stmt* stmt = NULL;
+    if (prepare(ctx, sql, &stmt) != 0) return -1;
+    int ok = sqlite3_step(stmt) == SQLITE_ROW;
+    if (ok) *out = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    return ok ? 0 : -1;
+}
+
+int get_database_stats(persistence_context_t* ctx, size_t* total_records, size_t* total_tlds, size_t* db_size_bytes) {
+    if (!ctx) return -1;
+
+    sqlite3_int64 records = 0, tlds = 0, page_count = 0, page_size = 0;
+    pthread_mutex_lock(&ctx->db_lock);
+    int result = query_count(ctx, "SELECT COUNT(*) FROM dns_records", &records) |
+                 query_count(ctx, "SELECT COUNT(*) FROM tlds", &tlds) |
+                 query_count(ctx, "PRAGMA page_count", &page_count) |
+                 query_count(ctx, "PRAGMA page_size", &page_size);
+    pthread_mutex_unlock(&ctx->db_lock);
+    if (result != 0) return -1;
+
+    if (total_records) *total_records = (size_t)records;
+    if (total_tlds) *total_tlds = (size_t)tlds;
+    if (db_size_bytes) *db_size_bytes = (size_t)(page_count * page_size);
+    return 0;
+}
+
+// --- Transaction support ---
+// begin_transaction keeps db_lock held until commit/rollback, which keeps
+// the write-behind thread from interleaving its own batches. Both calls
+// must come from the same thread.
+
+int begin_transaction(persistence_context_t* ctx) {
+    if (!ctx) return -1;
+    pthread_mutex_lock(&ctx->db_lock);
+    if (exec_sql(ctx, "BEGIN") != 0) {
+        pthread_mutex_unlock(&ctx->db_lock);
+        return -1;
+    }
+    return 0;
+}
+
+int commit_transaction(persistence_context_t* ctx) {
+    if (!ctx) return -1;
+    int result = exec_sql(ctx, "COMMIT");
+    if (result != 0) exec_sql(ctx, "ROLLBACK");
+    pthread_mutex_unlock(&ctx->db_lock);
+    return result;
+}
+
+int rollback_transaction(persistence_context_t* ctx) {
+    if (!ctx) return -1;
+    int result = exec_sql(ctx, "ROLLBACK");
+    pthread_mutex_unlock(&ctx->db_lock);
+    return result;
+}
+
+// --- Snapshots ---
+
+uint64_t persistence_mutation_sequence(persistence_context_t* ctx) {
+    return ctx ? read_meta_value(ctx, "mutation_seq") : 0;
+}
+
+static void snapshot_path_for(const persistence_context_t* ctx, char* buf, size_t len) {
+    snprintf(buf, len, "%s.snap", ctx->config.db_path);
+}
+
+int persistence_write_snapshot(persistence_context_t* ctx, tld_manager_t* manager) {
+    if (!ctx || !manager) return -1;
+
+    // The snapshot is only trusted if it matches the committed state exactly,
+    // so no mutation may land between the flush and the snapshot. Mutators
+    // hold the write lock; write_tld_snapshot's read lock nests in this one
+    // (glibc rwlocks prefer readers, so a waiting writer cannot wedge it).
+    pthread_rwlock_rdlock(&manager->lock);
+    if (persistence_flush(ctx) != 0) {
+        pthread_rwlock_unlock(&manager->lock);
+        log_error("Persistence: not writing a snapshot, the database lost write-behind mutations");
+        return -1;
+    }
+
+    char path[1024];
+    snapshot_path_for(ctx, path, sizeof(path));
+    int result = write_tld_snapshot(manager, path, persistence_mutation_sequence(ctx));
+    uint64_t journal_seq = read_meta_value(ctx, "journal_seq");
+    pthread_rwlock_unlock(&manager->lock);
+
+    // Everything up to journal_seq is in the database and the snapshot now
+    if (result == 0 && ctx->journal && compact_tld_journal(ctx->journal, journal_seq) != 0) {
+        log_warn("Persistence: journal not compacted, it keeps growing until the next snapshot");
+    }
+    return result;
+}
+
+// Load records from <db_path>.snap when it is current. Nodes are not part of
+// the snapshot and are always read from the database.
+static int restore_from_snapshot(persistence_context_t* ctx, tld_manager_t* manager) {
+    if (manager->tld_count != 0 || manager->snapshot) return -1;
+
+    char path[1024];
+    snapshot_path_for(ctx, path, sizeof(path));
+
+    tld_snapshot_t* snapshot = NULL;
+    if (open_tld_snapshot(path, &snapshot) != 0) return -1;
+
+    uint64_t db_seq = persistence_mutation_sequence(ctx);
+    if (tld_snapshot_sequence(snapshot) != db_seq) {
+        dlog("Persistence: snapshot %s is stale (seq %llu, database %llu)", path,
+             (unsigned long long)tld_snapshot_sequence(snapshot), (unsigned long long)db_seq);
+        close_tld_snapshot(snapshot);
+        return -1;
+    }
+    return load_tld_snapshot_into_manager(snapshot, manager);
+}
+
+// --- Restore ---
+
+static int restore_tld_nodes(persistence_context_t* ctx, tld_t* tld) {
+    tld_node_t* auth = NULL;
+    tld_node_t* mirror = NULL;
+    size_t auth_count = 0, mirror_count = 0;
+    if (load_tld_nodes(ctx, tld->name, &auth, &auth_count, &mirror, &mirror_count) != 0) return -1;
+
+    time_t last_modified = tld->last_modified;
+    for (size_t n = 0; n < auth_count; ++n) {
+        if (add_authoritative_node_to_tld(tld, &auth[n]) == 0) {
+            tld->authoritative_nodes[tld->authoritative_node_count - 1].last_seen = auth[n].last_seen;
+        }
+        free(auth[n].hostname);
+        free(auth[n].ip_address);
+    }
+    for (size_t n = 0; n < mirror_count; ++n) {
+        if (add_mirror_node_to_tld(tld, &mirror[n]) == 0) {
+            tld->mirror_nodes[tld->mirror_node_count - 1].last_seen = mirror[n].last_seen;
+        }
+        free(mirror[n].hostname);
+        free(mirror[n].ip_address);
+    }
+    free(auth);
+    free(mirror);
+    tld->last_modified = last_modified;
+    return 0;
+}
+
+typedef struct {
+    persistence_context_t* ctx;
+    tld_manager_t* manager;
+    persist_op_t* head;
+    persist_op_t* tail;
+    size_t applied;
+    size_t skipped;
+} journal_replay_t;
+
+// Apply one journal entry the database missed and queue it for the database
+static int replay_journal_entry(void* arg, const tld_journal_entry_t* entry) {
+    journal_replay_t* replay = arg;
+    int rc = apply_tld_journal_entry(replay->manager, entry);
+    if (rc != 0) {
+        // Already reflected (snapshot) or no longer applicable: the database
+        // does not need it either
+        replay->skipped++;
+        return 0;
+    }
+
+    tld_t* tld = find_tld_by_name(replay->manager, entry->tld_name);
+    tld_mutation_t mutation = { .type = entry->type, .tld = tld, .record = &entry->record,
+                                .node = &entry->node, .stale_threshold = entry->timestamp };
+    persist_op_t* op = tld ? persist_op_for(&mutation) : NULL;
+    if (!op) return -1;
+    op->journal_seq = entry->sequence;
+    if (replay->tail) {
+        replay->tail->next = op;
+    } else {
+        replay->head = op;
+    }
+    replay->tail = op;
+    replay->applied++;
+    return 0;
+}
+
+// Roll the manager and the database forward over journal entries newer than
+// the last committed one: mutations the write-behind queue never committed.
+static int replay_journal(persistence_context_t* ctx, tld_manager_t* manager) {
+    uint64_t committed = read_meta_value(ctx, "journal_seq");
+    journal_replay_t replay = { ctx, manager, NULL, NULL, 0, 0 };
+    int rc = tld_journal_read_since(ctx->journal, committed, replay_journal_entry, &replay);
+    if (rc != 0) {
+        log_error("Persistence: cannot replay the journal after sequence %llu", (unsigned long long)committed);
+    }
+    if (replay.head) {
+        write_batch(ctx, replay.head, replay.applied);
+    }
+    if (replay.applied || replay.skipped) {
+        log_info("Persistence: replayed %zu journal entries after sequence %llu (%zu already applied)",
+                 replay.applied, (unsigned long long)committed, replay.skipped);
+    }
+    return rc == 0 && !ctx->write_error ? 0 : -1;
+}
+
+int restore_tlds_from_persistence(persistence_context_t* ctx, tld_manager_t* manager) {
+    if (!ctx || !manager) return -1;
+    if (ctx->attached_manager == manager) {
+        dlog("Persistence: restore must run before attaching write-behind");
+        return -1;
+    }
+
+    int from_snapshot = restore_from_snapshot(ctx, manager) == 0;
+
+    char** names = NULL;
+    size_t name_count = 0;
+    if (list_tlds(ctx, &names, &name_count) != 0) return -1;
+
+    int result = 0;
+    size_t restored_records = 0;
+    for (size_t i = 0; i < name_count; ++i) {
+        tld_t* tld = from_snapshot ? find_tld_by_name(manager, names[i]) : NULL;
+        if (tld) {
+            if (restore_tld_nodes(ctx, tld) != 0) result = -1;
+            continue;
+        }
+
+        tld_t* stored = NULL;
+        if (load_tld(ctx, names[i], &stored) != 0) {
+            result = -1;
+            continue;
+        }
+
+        tld = find_tld_by_name(manager, names[i]);
+        if (!tld) tld = register_new_tld(manager, names[i]);
+        if (!tld) {
+            free_loaded_tld(stored);
+            result = -1;
+            continue;
+        }
+
+        for (size_t r = 0; r < stored->record_count; ++r) {
+            if (add_dns_record_to_tld(tld, &stored->records[r]) == 0) {
+                tld->records[tld->record_count - 1].last_updated = stored->records[r].last_updated;
+                restored_records++;
+            }
+        }
+        for (size_t n = 0; n < stored->authoritative_node_count; ++n) {
+            if (add_authoritative_node_to_tld(tld, &stored->authoritative_nodes[n]) == 0) {
+                tld->authoritative_nodes[tld->authoritative_node_count - 1].last_seen = stored->authoritative_nodes[n].last_seen;
+            }
+        }
+        for (size_t n = 0; n < stored->mirror_node_count; ++n) {
+            if (add_mirror_node_to_tld(tld, &stored->mirror_nodes[n]) == 0) {
+                tld->mirror_nodes[tld->mirror_node_count - 1].last_seen = stored->mirror_nodes[n].last_seen;
+            }
+        }
+        tld->created_at = stored->created_at;
+        tld->last_modified = stored->last_modified;
+        free_loaded_tld(stored);
+    }
+
+    for (size_t i = 0; i < name_count; ++i) free(names[i]);
+    free(names);
+
+    dlog("Persistence: restored %zu TLDs, %zu records%s", name_count, restored_records,
+         from_snapshot ? " (records served from snapshot)" : "");
+    if (ctx->journal && replay_journal(ctx, manager) != 0) result = -1;
+    return result;
+}
+
+// --- Default configuration helper ---
+
+persistence_config_t* create_default_persistence_config(const char* db_path) {
+    if (!db_path) return NULL;
+
+    persistence_config_t* config = calloc(1, sizeof(persistence_config_t));
+    if (!config) return NULL;
+
+    config->db_path = strdup(db_path);
+    if (!config->db_path) {
+        free(config);
+        return NULL;
+    }
+    config->enable_wal_mode = 1;
+    config->cache_size_kb = DEFAULT_CACHE_SIZE_KB;
+    config->sync_mode = DEFAULT_SYNC_MODE;
+    config->flush_interval_ms = DEFAULT_FLUSH_INTERVAL_MS;
+    config->max_batch_size = DEFAULT_MAX_BATCH_SIZE;
+    return config;
+}
+
+void free_persistence_config(persistence_config_t* config) {
+    if (!config) return;
+    free(config->db_path);
+    free(config);
+}
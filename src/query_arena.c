@@ -0,0 +1,145 @@
+#include "../include/query_arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef struct query_arena_chunk_s {
+    struct query_arena_chunk_s* next;       // The chunk filled before this one
+    size_t size;
+    size_t used;
+    _Alignas(QUERY_ARENA_ALIGN) unsigned char data[];
+} query_arena_chunk_t;
+
+struct query_arena_s {
+    query_arena_chunk_t* current;           // Allocations come from here
+    query_arena_chunk_t* retained;          // The chunk kept across resets
+    size_t overflow_used;                   // Bytes handed out from full chunks
+    unsigned char* last;                    // Most recent allocation, for realloc
+};
+
+static size_t align_up(size_t size) {
+    return (size + QUERY_ARENA_ALIGN - 1) & ~(size_t)(QUERY_ARENA_ALIGN - 1);
+}
+
+static query_arena_chunk_t* new_chunk(size_t size) {
+    query_arena_chunk_t* chunk = malloc(sizeof(query_arena_chunk_t) + size);
+    if (!chunk) return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+int init_query_arena(size_t size, query_arena_t** arena_out) {
+    if (!arena_out) return -1;
+
+    query_arena_t* arena = calloc(1, sizeof(query_arena_t));
+    if (!arena) return -1;
+
+    arena->retained = new_chunk(align_up(size ? size : QUERY_ARENA_DEFAULT_SIZE));
+    if (!arena->retained) {
+        free(arena);
+        return -1;
+    }
+    arena->current = arena->retained;
+
+    *arena_out = arena;
+    return 0;
+}
+
+static void free_overflow_chunks(query_arena_t* arena) {
+    query_arena_chunk_t* chunk = arena->current;
+    while (chunk != arena->retained) {
+        query_arena_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+void cleanup_query_arena(query_arena_t* arena) {
+    if (!arena) return;
+    free_overflow_chunks(arena);
+    free(arena->retained);
+    free(arena);
+}
+
+void* query_arena_alloc(query_arena_t* arena, size_t size) {
+    if (!arena || size > SIZE_MAX / 2) return NULL;
+    size_t needed = align_up(size ? size : 1);
+
+    query_arena_chunk_t* chunk = arena->current;
+    if (chunk->size - chunk->used < needed) {
+        // Overflow chunks at least double, so a large request costs few mallocs
+        size_t chunk_size = chunk->size * 2;
+        if (chunk_size < needed) chunk_size = needed;
+        query_arena_chunk_t* overflow = new_chunk(chunk_size);
+        if (!overflow) return NULL;
+        arena->overflow_used += chunk->used;
+        overflow->next = chunk;
+        arena->current = chunk = overflow;
+    }
+
+    unsigned char* ptr = chunk->data + chunk->used;
+    chunk->used += needed;
+    arena->last = ptr;
+    return ptr;
+}
+
+void* query_arena_realloc(query_arena_t* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (!arena) return NULL;
+    if (!ptr) return query_arena_alloc(arena, new_size);
+
+    // The newest allocation can grow or shrink where it is
+    query_arena_chunk_t* chunk = arena->current;
+    if (ptr == arena->last) {
+        size_t start = (size_t)(arena->last - chunk->data);
+        size_t needed = align_up(new_size ? new_size : 1);
+        if (needed <= chunk->size - start) {
+            chunk->used = start + needed;
+            return ptr;
+        }
+    } else if (new_size <= old_size) {
+        return ptr;
+    }
+
+    void* moved = query_arena_alloc(arena, new_size);
+    if (moved) memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+    return moved;
+}
+
+char* query_arena_strdup(query_arena_t* arena, const char* s) {
+    if (!s) return NULL;
+    size_t len = strlen(s) + 1;
+    char* copy = query_arena_alloc(arena, len);
+    if (copy) memcpy(copy, s, len);
+    return copy;
+}
+
+void query_arena_reset(query_arena_t* arena) {
+    if (!arena) return;
+
+    // A request that overflowed sizes the chunk kept for the next ones
+    if (arena->current != arena->retained) {
+        size_t wanted = arena->overflow_used + arena->current->used;
+        size_t size = arena->retained->size;
+        while (size < wanted && size < QUERY_ARENA_MAX_RETAINED) size *= 2;
+        free_overflow_chunks(arena);
+        if (size > arena->retained->size) {
+            query_arena_chunk_t* bigger = new_chunk(size > QUERY_ARENA_MAX_RETAINED ? QUERY_ARENA_MAX_RETAINED : size);
+            if (bigger) {
+                free(arena->retained);
+                arena->retained = bigger;
+            }
+        }
+        arena->current = arena->retained;
+    }
+
+    arena->retained->used = 0;
+    arena->overflow_used = 0;
+    arena->last = NULL;
+}
+
+size_t query_arena_used(const query_arena_t* arena) {
+    if (!arena) return 0;
+    return arena->overflow_used + arena->current->used;
+}
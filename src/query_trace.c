@@ -0,0 +1,293 @@
+#include "../include/query_trace.h"
+#include "../include/packet_protocol.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define TRACE_BINARY_MAGIC "NXQT"
+#define TRACE_BINARY_VERSION 1
+
+static atomic_uint sample_rate = 0;
+static atomic_uint_fast64_t next_trace_id = 1;
+static atomic_uint next_thread_id = 1;
+
+// Completed traces; the oldest is overwritten once the ring is full
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static query_trace_t* ring = NULL;
+static size_t ring_capacity = 0;
+static size_t ring_next = 0;
+static size_t ring_count = 0;
+
+static __thread query_trace_t current;
+static __thread int current_active = 0;
+static __thread unsigned current_depth = 0;
+static __thread unsigned sample_counter = 0;
+static __thread uint64_t pending_receive_ns = 0;
+static __thread uint32_t thread_id = 0;
+
+static const char* stage_names[TRACE_STAGE_COUNT] = {
+    [TRACE_STAGE_RECEIVE] = "receive",
+    [TRACE_STAGE_DESERIALIZE] = "deserialize",
+    [TRACE_STAGE_CACHE_LOOKUP] = "cache_lookup",
+    [TRACE_STAGE_TLD_LOOKUP] = "tld_lookup",
+    [TRACE_STAGE_CNAME_FOLLOW] = "cname_follow",
+    [TRACE_STAGE_UPSTREAM_WAIT] = "upstream_wait",
+    [TRACE_STAGE_SERIALIZE] = "serialize",
+    [TRACE_STAGE_STREAM_WRITE] = "stream_write",
+};
+
+const char* get_trace_stage_name(trace_stage_t stage) {
+    if (stage < 0 || stage >= TRACE_STAGE_COUNT) return "unknown";
+    return stage_names[stage];
+}
+
+uint64_t query_trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int init_query_tracing(unsigned rate, size_t capacity) {
+    if (capacity == 0) capacity = QUERY_TRACE_DEFAULT_CAPACITY;
+
+    pthread_mutex_lock(&ring_lock);
+    if (capacity != ring_capacity) {
+        query_trace_t* resized = calloc(capacity, sizeof(query_trace_t));
+        if (!resized) {
+            pthread_mutex_unlock(&ring_lock);
+            log_error("Failed to allocate query trace ring (%zu traces)", capacity);
+            return -1;
+        }
+        free(ring);
+        ring = resized;
+        ring_capacity = capacity;
+        ring_next = 0;
+        ring_count = 0;
+    }
+    pthread_mutex_unlock(&ring_lock);
+
+    atomic_store(&sample_rate, rate);
+    if (rate > 0) {
+        dlog("Tracing 1 in %u queries (keeping the last %zu)", rate, capacity);
+    }
+    return 0;
+}
+
+void cleanup_query_tracing(void) {
+    atomic_store(&sample_rate, 0);
+    pthread_mutex_lock(&ring_lock);
+    free(ring);
+    ring = NULL;
+    ring_capacity = 0;
+    ring_next = 0;
+    ring_count = 0;
+    pthread_mutex_unlock(&ring_lock);
+}
+
+void query_trace_note_receive(void) {
+    if (atomic_load_explicit(&sample_rate, memory_order_relaxed) == 0) return;
+    pending_receive_ns = query_trace_now();
+}
+
+int query_trace_begin(int packet_type) {
+    unsigned rate = atomic_load_explicit(&sample_rate, memory_order_relaxed);
+    uint64_t received = pending_receive_ns;
+    pending_receive_ns = 0;
+    current_active = 0;
+    if (rate == 0 || ++sample_counter % rate != 0) return 0;
+
+    if (thread_id == 0) {
+        thread_id = atomic_fetch_add_explicit(&next_thread_id, 1, memory_order_relaxed);
+    }
+
+    uint64_t now = query_trace_now();
+    current.id = atomic_fetch_add_explicit(&next_trace_id, 1, memory_order_relaxed);
+    current.thread_id = thread_id;
+    current.packet_type = packet_type;
+    current.status = 0;
+    current.start_ns = received ? received : now;
+    current.end_ns = 0;
+    current.name[0] = '\0';
+    current.span_count = 0;
+    current.spans_dropped = 0;
+    current_depth = 0;
+    current_active = 1;
+
+    if (received) {
+        query_trace_stage_end(TRACE_STAGE_RECEIVE, received);
+    }
+    return 1;
+}
+
+void query_trace_set_name(const char* name) {
+    if (!current_active || !name) return;
+    strncpy(current.name, name, QUERY_TRACE_NAME_MAX - 1);
+    current.name[QUERY_TRACE_NAME_MAX - 1] = '\0';
+}
+
+uint64_t query_trace_stage_start(void) {
+    if (!current_active) return 0;
+    current_depth++;
+    return query_trace_now();
+}
+
+void query_trace_stage_end(trace_stage_t stage, uint64_t start) {
+    if (!current_active || start == 0) return;
+    // The receive span opens the trace and is not matched by a stage_start
+    if (stage != TRACE_STAGE_RECEIVE && current_depth > 0) current_depth--;
+
+    if (current.span_count >= QUERY_TRACE_MAX_SPANS) {
+        current.spans_dropped++;
+        return;
+    }
+    query_trace_span_t* span = &current.spans[current.span_count++];
+    span->stage = (uint8_t)stage;
+    span->depth = (uint8_t)current_depth;
+    span->start_ns = start;
+    span->end_ns = query_trace_now();
+}
+
+void query_trace_end(int status) {
+    if (!current_active) return;
+    current_active = 0;
+    current.status = status;
+    current.end_ns = query_trace_now();
+
+    pthread_mutex_lock(&ring_lock);
+    if (ring) {
+        ring[ring_next] = current;
+        ring_next = (ring_next + 1) % ring_capacity;
+        if (ring_count < ring_capacity) ring_count++;
+    }
+    pthread_mutex_unlock(&ring_lock);
+}
+
+// Caller holds ring_lock
+static size_t copy_ring(query_trace_t* out, size_t max) {
+    size_t n = ring_count < max ? ring_count : max;
+    // The newest n, so the oldest are skipped when out cannot hold everything
+    size_t first = (ring_next + ring_capacity - n) % ring_capacity;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ring[(first + i) % ring_capacity];
+    }
+    return n;
+}
+
+size_t query_trace_snapshot(query_trace_t* out, size_t max) {
+    if (!out || max == 0) return 0;
+    pthread_mutex_lock(&ring_lock);
+    size_t n = ring ? copy_ring(out, max) : 0;
+    pthread_mutex_unlock(&ring_lock);
+    return n;
+}
+
+// Copy the ring out so dumping does not hold the lock during I/O
+static size_t take_snapshot(query_trace_t** out) {
+    *out = NULL;
+    pthread_mutex_lock(&ring_lock);
+    size_t n = 0;
+    if (ring && ring_count > 0) {
+        *out = malloc(ring_count * sizeof(query_trace_t));
+        if (*out) n = copy_ring(*out, ring_count);
+    }
+    pthread_mutex_unlock(&ring_lock);
+    return n;
+}
+
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static void write_chrome_event(FILE* f, int* first, const char* name, const char* category,
+                               uint64_t start_ns, uint64_t end_ns, uint32_t tid) {
+    if (!*first) fputs(",\n", f);
+    *first = 0;
+    fputs("{\"name\":", f);
+    write_json_string(f, name);
+    fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+            category, start_ns / 1000.0, (end_ns - start_ns) / 1000.0, tid);
+}
+
+int query_trace_dump_chrome(FILE* f) {
+    if (!f) return -1;
+    query_trace_t* traces;
+    size_t n = take_snapshot(&traces);
+
+    int first = 1;
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+    for (size_t i = 0; i < n; i++) {
+        const query_trace_t* t = &traces[i];
+        const char* type = get_packet_type_name(t->packet_type);
+        write_chrome_event(f, &first, t->name[0] ? t->name : type, "query",
+                           t->start_ns, t->end_ns, t->thread_id);
+        fprintf(f, ",\"args\":{\"id\":%llu,\"type\":\"%s\",\"status\":%d,\"spans_dropped\":%u}}",
+                (unsigned long long)t->id, type, t->status, t->spans_dropped);
+        for (uint32_t s = 0; s < t->span_count; s++) {
+            const query_trace_span_t* span = &t->spans[s];
+            write_chrome_event(f, &first, get_trace_stage_name(span->stage), "stage",
+                               span->start_ns, span->end_ns, t->thread_id);
+            fprintf(f, ",\"args\":{\"id\":%llu}}", (unsigned long long)t->id);
+        }
+    }
+    fputs("\n]}\n", f);
+    free(traces);
+    return ferror(f) ? -1 : 0;
+}
+
+static void write_le(FILE* f, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        fputc((int)((value >> (8 * i)) & 0xFF), f);
+    }
+}
+
+// Deltas and durations beyond u32 nanoseconds (~4.3 s) are clamped
+static uint32_t clamp_u32(uint64_t value) {
+    return value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+}
+
+int query_trace_dump_binary(FILE* f) {
+    if (!f) return -1;
+    query_trace_t* traces;
+    size_t n = take_snapshot(&traces);
+
+    fwrite(TRACE_BINARY_MAGIC, 1, 4, f);
+    write_le(f, TRACE_BINARY_VERSION, 4);
+    write_le(f, n, 4);
+    for (size_t i = 0; i < n; i++) {
+        const query_trace_t* t = &traces[i];
+        size_t name_len = strlen(t->name);
+        write_le(f, t->id, 8);
+        write_le(f, t->thread_id, 4);
+        write_le(f, (uint32_t)t->packet_type, 4);
+        write_le(f, (uint32_t)t->status, 4);
+        write_le(f, t->start_ns, 8);
+        write_le(f, t->end_ns, 8);
+        write_le(f, name_len, 1);
+        fwrite(t->name, 1, name_len, f);
+        write_le(f, t->span_count, 1);
+        for (uint32_t s = 0; s < t->span_count; s++) {
+            const query_trace_span_t* span = &t->spans[s];
+            write_le(f, span->stage, 1);
+            write_le(f, span->depth, 1);
+            write_le(f, clamp_u32(span->start_ns - t->start_ns), 4);
+            write_le(f, clamp_u32(span->end_ns - span->start_ns), 4);
+        }
+    }
+    free(traces);
+    return ferror(f) ? -1 : 0;
+}
@@ -0,0 +1,832 @@
+#include "../include/tld_journal.h"
+#include "../include/tld_manager.h"
+#include "../include/checksum.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define JOURNAL_HEADER_SIZE 16
+#define ENTRY_HEADER_SIZE 20
+#define MAX_ENTRY_PAYLOAD (1u << 20)
+#define DEFAULT_FSYNC_INTERVAL_MS 10
+#define DEFAULT_MAX_PENDING_BYTES (256 * 1024)
+
+struct tld_journal_s {
+    char* path;
+    tld_journal_config_t config;
+    int fd;
+
+    // Producers encode into `pending` under append_lock; the writer thread
+    // swaps it out, writes and fsyncs the whole batch at once.
+    pthread_mutex_t append_lock;
+    pthread_cond_t append_cond;
+    pthread_cond_t durable_cond;
+    uint8_t* pending;
+    size_t pending_len;
+    size_t pending_capacity;
+    uint64_t last_seq;          // Last sequence handed out
+    uint64_t durable_seq;       // Last sequence known to be on disk
+    int flush_requested;
+    int running;
+    int write_failed;
+    pthread_t writer_thread;
+
+    // File contents: writer appends, readers scan, compaction rewrites
+    pthread_mutex_t io_lock;
+    uint64_t base_seq;
+    uint64_t file_size;
+
+    tld_manager_t* attached_manager;
+};
+
+// --- Encoding ---
+
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t capacity;
+} byte_buffer_t;
+
+static int buffer_reserve(byte_buffer_t* buf, size_t extra) {
+    if (buf->len + extra <= buf->capacity) return 0;
+    size_t capacity = buf->capacity ? buf->capacity : 256;
+    while (capacity < buf->len + extra) capacity *= 2;
+    uint8_t* grown = realloc(buf->data, capacity);
+    if (!grown) return -1;
+    buf->data = grown;
+    buf->capacity = capacity;
+    return 0;
+}
+
+// Strings are stored with their terminating NUL so readers can point at them
+static int buffer_put_string(byte_buffer_t* buf, const char* str) {
+    size_t len = strlen(str) + 1;
+    if (len > UINT16_MAX || buffer_reserve(buf, 2 + len) != 0) return -1;
+    put_u16(buf->data + buf->len, (uint16_t)len);
+    memcpy(buf->data + buf->len + 2, str, len);
+    buf->len += 2 + len;
+    return 0;
+}
+
+static int buffer_put_u32(byte_buffer_t* buf, uint32_t v) {
+    if (buffer_reserve(buf, 4) != 0) return -1;
+    put_u32(buf->data + buf->len, v);
+    buf->len += 4;
+    return 0;
+}
+
+static int buffer_put_i64(byte_buffer_t* buf, int64_t v) {
+    if (buffer_reserve(buf, 8) != 0) return -1;
+    put_u64(buf->data + buf->len, (uint64_t)v);
+    buf->len += 8;
+    return 0;
+}
+
+static int encode_payload(const tld_mutation_t* mutation, byte_buffer_t* buf) {
+    if (buffer_put_string(buf, mutation->tld->name) != 0) return -1;
+
+    switch (mutation->type) {
+        case TLD_MUTATION_REGISTER:
+            return buffer_put_i64(buf, (int64_t)mutation->tld->created_at);
+        case TLD_MUTATION_ADD_RECORD:
+        case TLD_MUTATION_REMOVE_RECORD:
+            if (!mutation->record) return -1;
+            return buffer_put_string(buf, mutation->record->name) |
+                   buffer_put_string(buf, mutation->record->rdata) |
+                   buffer_put_u32(buf, (uint32_t)mutation->record->type) |
+                   buffer_put_u32(buf, mutation->record->ttl) |
+                   buffer_put_i64(buf, (int64_t)mutation->record->last_updated);
+        case TLD_MUTATION_ADD_AUTHORITATIVE_NODE:
+        case TLD_MUTATION_ADD_MIRROR_NODE:
+            if (!mutation->node) return -1;
+            return buffer_put_string(buf, mutation->node->hostname) |
+                   buffer_put_string(buf, mutation->node->ip_address) |
+                   buffer_put_i64(buf, (int64_t)mutation->node->last_seen);
+        case TLD_MUTATION_PRUNE_STALE_NODES:
+            return buffer_put_i64(buf, (int64_t)mutation->stale_threshold);
+    }
+    return -1;
+}
+
+// --- Decoding ---
+
+typedef struct {
+    const uint8_t* p;
+    size_t remaining;
+} payload_reader_t;
+
+static int read_string(payload_reader_t* r, const char** out) {
+    if (r->remaining < 2) return -1;
+    uint16_t len = get_u16(r->p);
+    if (len == 0 || r->remaining - 2 < len || r->p[2 + len - 1] != '\0') return -1;
+    *out = (const char*)(r->p + 2);
+    r->p += 2 + len;
+    r->remaining -= 2 + (size_t)len;
+    return 0;
+}
+
+static int read_u32(payload_reader_t* r, uint32_t* out) {
+    if (r->remaining < 4) return -1;
+    *out = get_u32(r->p);
+    r->p += 4;
+    r->remaining -= 4;
+    return 0;
+}
+
+static int read_i64(payload_reader_t* r, int64_t* out) {
+    if (r->remaining < 8) return -1;
+    *out = (int64_t)get_u64(r->p);
+    r->p += 8;
+    r->remaining -= 8;
+    return 0;
+}
+
+static int decode_entry(uint64_t seq, uint16_t type, const uint8_t* payload, size_t len,
+                        tld_journal_entry_t* entry) {
+    memset(entry, 0, sizeof(*entry));
+    entry->sequence = seq;
+    entry->type = (tld_mutation_type_t)type;
+
+    payload_reader_t r = { payload, len };
+    if (read_string(&r, &entry->tld_name) != 0) return -1;
+
+    int64_t ts = 0;
+    uint32_t rtype = 0;
+    const char* a = NULL;
+    const char* b = NULL;
+    switch (entry->type) {
+        case TLD_MUTATION_REGISTER:
+        case TLD_MUTATION_PRUNE_STALE_NODES:
+            if (read_i64(&r, &ts) != 0) return -1;
+            entry->timestamp = (time_t)ts;
+            return 0;
+        case TLD_MUTATION_ADD_RECORD:
+        case TLD_MUTATION_REMOVE_RECORD:
+            if (read_string(&r, &a) != 0 || read_string(&r, &b) != 0 ||
+                read_u32(&r, &rtype) != 0 || read_u32(&r, &entry->record.ttl) != 0 ||
+                read_i64(&r, &ts) != 0) return -1;
+            entry->record.name = (char*)a;
+            entry->record.rdata = (char*)b;
+            entry->record.type = (dns_record_type_t)rtype;
+            entry->record.last_updated = (time_t)ts;
+            return 0;
+        case TLD_MUTATION_ADD_AUTHORITATIVE_NODE:
+        case TLD_MUTATION_ADD_MIRROR_NODE:
+            if (read_string(&r, &a) != 0 || read_string(&r, &b) != 0 || read_i64(&r, &ts) != 0) return -1;
+            entry->node.hostname = (char*)a;
+            entry->node.ip_address = (char*)b;
+            entry->node.last_seen = (time_t)ts;
+            return 0;
+    }
+    return -1;
+}
+
+// --- File scanning ---
+
+typedef int (*raw_entry_fn)(void* ctx, uint64_t seq, uint16_t type, const uint8_t* entry,
+                            size_t entry_len, const uint8_t* payload, size_t payload_len);
+
+static int pread_all(int fd, void* buf, size_t len, uint64_t offset) {
+    uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int write_all_fd(int fd, const void* buf, size_t len) {
+    const uint8_t* p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Walk valid entries in [JOURNAL_HEADER_SIZE, limit). Returns the offset just
+// past the last valid entry; stops early at the first torn or corrupt one.
+static uint64_t scan_entries(int fd, uint64_t limit, raw_entry_fn fn, void* ctx, int* visit_failed) {
+    uint64_t offset = JOURNAL_HEADER_SIZE;
+    uint8_t* buf = NULL;
+    size_t buf_capacity = 0;
+
+    while (offset + ENTRY_HEADER_SIZE <= limit) {
+        uint8_t head[ENTRY_HEADER_SIZE];
+        if (pread_all(fd, head, sizeof(head), offset) != 0) break;
+
+        uint32_t payload_len = get_u32(head);
+        if (payload_len > MAX_ENTRY_PAYLOAD || offset + ENTRY_HEADER_SIZE + payload_len > limit) break;
+
+        size_t entry_len = ENTRY_HEADER_SIZE + payload_len;
+        if (entry_len > buf_capacity) {
+            uint8_t* grown = realloc(buf, entry_len);
+            if (!grown) break;
+            buf = grown;
+            buf_capacity = entry_len;
+        }
+        memcpy(buf, head, sizeof(head));
+        if (payload_len && pread_all(fd, buf + ENTRY_HEADER_SIZE, payload_len, offset + ENTRY_HEADER_SIZE) != 0) break;
+
+        // CRC covers everything after itself: seq, type, reserved, payload
+        if (crc32_update(0, buf + 8, entry_len - 8) != get_u32(buf + 4)) break;
+
+        if (fn && fn(ctx, get_u64(buf + 8), get_u16(buf + 16), buf, entry_len,
+                     buf + ENTRY_HEADER_SIZE, payload_len) != 0) {
+            if (visit_failed) *visit_failed = 1;
+            break;
+        }
+        offset += entry_len;
+    }
+    free(buf);
+    return offset;
+}
+
+static int write_file_header(int fd, uint64_t base_seq) {
+    uint8_t header[JOURNAL_HEADER_SIZE];
+    memcpy(header, TLD_JOURNAL_MAGIC, 8);
+    put_u64(header + 8, base_seq);
+    return pwrite(fd, header, sizeof(header), 0) == (ssize_t)sizeof(header) ? 0 : -1;
+}
+
+static int read_file_header(int fd, uint64_t* base_seq) {
+    uint8_t header[JOURNAL_HEADER_SIZE];
+    if (pread_all(fd, header, sizeof(header), 0) != 0) return -1;
+    if (memcmp(header, TLD_JOURNAL_MAGIC, 8) != 0) return -1;
+    *base_seq = get_u64(header + 8);
+    return 0;
+}
+
+static int track_last_seq(void* ctx, uint64_t seq, uint16_t type, const uint8_t* entry,
+                          size_t entry_len, const uint8_t* payload, size_t payload_len) {
+    (void)type; (void)entry; (void)entry_len; (void)payload; (void)payload_len;
+    *(uint64_t*)ctx = seq;
+    return 0;
+}
+
+// --- Writer thread ---
+
+static void* journal_writer_thread(void* arg) {
+    tld_journal_t* journal = arg;
+    uint8_t* spare = NULL;
+    size_t spare_capacity = 0;
+
+    pthread_mutex_lock(&journal->append_lock);
+    while (journal->running || journal->pending_len) {
+        while (journal->running && !journal->pending_len) {
+            pthread_cond_wait(&journal->append_cond, &journal->append_lock);
+        }
+
+        // Group commit window, same shape as the persistence writer
+        if (journal->running && !journal->flush_requested &&
+            journal->pending_len < journal->config.max_pending_bytes) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)journal->config.fsync_interval_ms * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            while (journal->running && !journal->flush_requested &&
+                   journal->pending_len < journal->config.max_pending_bytes) {
+                if (pthread_cond_timedwait(&journal->append_cond, &journal->append_lock, &deadline) == ETIMEDOUT) break;
+            }
+        }
+
+        uint8_t* batch = journal->pending;
+        size_t batch_len = journal->pending_len;
+        size_t batch_capacity = journal->pending_capacity;
+        uint64_t batch_seq = journal->last_seq;
+        journal->pending = spare;
+        journal->pending_capacity = spare_capacity;
+        journal->pending_len = 0;
+        journal->flush_requested = 0;
+        pthread_mutex_unlock(&journal->append_lock);
+
+        int ok = 1;
+        if (batch_len) {
+            pthread_mutex_lock(&journal->io_lock);
+            ok = write_all_fd(journal->fd, batch, batch_len) == 0 && fdatasync(journal->fd) == 0;
+            if (ok) journal->file_size += batch_len;
+            pthread_mutex_unlock(&journal->io_lock);
+            if (!ok) log_error("Journal: failed to write %zu bytes to %s: %s", batch_len, journal->path, strerror(errno));
+        }
+        spare = batch;
+        spare_capacity = batch_capacity;
+
+        pthread_mutex_lock(&journal->append_lock);
+        if (ok) {
+            if (batch_seq > journal->durable_seq) journal->durable_seq = batch_seq;
+        } else {
+            journal->write_failed = 1;
+        }
+        pthread_cond_broadcast(&journal->durable_cond);
+    }
+    pthread_mutex_unlock(&journal->append_lock);
+    free(spare);
+    return NULL;
+}
+
+// --- Lifecycle ---
+
+int open_tld_journal(tld_journal_t** journal_out, const char* path, const tld_journal_config_t* config) {
+    if (!journal_out || !path) return -1;
+    *journal_out = NULL;
+
+    tld_journal_t* journal = calloc(1, sizeof(tld_journal_t));
+    if (!journal) return -1;
+
+    if (config) journal->config = *config;
+    if (journal->config.fsync_interval_ms <= 0) journal->config.fsync_interval_ms = DEFAULT_FSYNC_INTERVAL_MS;
+    if (journal->config.max_pending_bytes == 0) journal->config.max_pending_bytes = DEFAULT_MAX_PENDING_BYTES;
+    journal->path = strdup(path);
+    if (!journal->path) goto fail_alloc;
+
+    journal->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (journal->fd < 0) {
+        dlog("Journal: cannot open %s: %s", path, strerror(errno));
+        goto fail_alloc;
+    }
+
+    struct stat st;
+    if (fstat(journal->fd, &st) != 0) goto fail_fd;
+
+    if (st.st_size == 0) {
+        if (write_file_header(journal->fd, 0) != 0 || fsync(journal->fd) != 0) goto fail_fd;
+        journal->file_size = JOURNAL_HEADER_SIZE;
+    } else {
+        if (read_file_header(journal->fd, &journal->base_seq) != 0) {
+            dlog("Journal: %s has a bad header", path);
+            goto fail_fd;
+        }
+        uint64_t last = journal->base_seq;
+        uint64_t valid_end = scan_entries(journal->fd, (uint64_t)st.st_size, track_last_seq, &last, NULL);
+        if (valid_end < (uint64_t)st.st_size) {
+            // Torn write from a crash: drop the incomplete tail
+            dlog("Journal: truncating %llu bytes of torn tail in %s",
+                 (unsigned long long)((uint64_t)st.st_size - valid_end), path);
+            if (ftruncate(journal->fd, (off_t)valid_end) != 0 || fsync(journal->fd) != 0) goto fail_fd;
+        }
+        journal->file_size = valid_end;
+        journal->last_seq = journal->durable_seq = last;
+    }
+    if (lseek(journal->fd, (off_t)journal->file_size, SEEK_SET) < 0) goto fail_fd;
+    if (journal->last_seq < journal->base_seq) journal->last_seq = journal->durable_seq = journal->base_seq;
+
+    pthread_mutex_init(&journal->append_lock, NULL);
+    pthread_mutex_init(&journal->io_lock, NULL);
+    pthread_cond_init(&journal->append_cond, NULL);
+    pthread_cond_init(&journal->durable_cond, NULL);
+
+    journal->running = 1;
+    if (pthread_create(&journal->writer_thread, NULL, journal_writer_thread, journal) != 0) {
+        dlog("Journal: failed to start writer thread");
+        pthread_cond_destroy(&journal->durable_cond);
+        pthread_cond_destroy(&journal->append_cond);
+        pthread_mutex_destroy(&journal->io_lock);
+        pthread_mutex_destroy(&journal->append_lock);
+        goto fail_fd;
+    }
+
+    dlog("Journal opened: %s (base %llu, last %llu)", path,
+         (unsigned long long)journal->base_seq, (unsigned long long)journal->last_seq);
+    *journal_out = journal;
+    return 0;
+
+fail_fd:
+    close(journal->fd);
+fail_alloc:
+    free(journal->path);
+    free(journal);
+    return -1;
+}
+
+void close_tld_journal(tld_journal_t* journal) {
+    if (!journal) return;
+
+    detach_tld_journal(journal);
+
+    // The writer drains whatever is still pending before exiting
+    pthread_mutex_lock(&journal->append_lock);
+    journal->running = 0;
+    pthread_cond_broadcast(&journal->append_cond);
+    pthread_mutex_unlock(&journal->append_lock);
+    pthread_join(journal->writer_thread, NULL);
+
+    close(journal->fd);
+    pthread_cond_destroy(&journal->durable_cond);
+    pthread_cond_destroy(&journal->append_cond);
+    pthread_mutex_destroy(&journal->io_lock);
+    pthread_mutex_destroy(&journal->append_lock);
+    free(journal->pending);
+    free(journal->path);
+    free(journal);
+}
+
+// --- Appending ---
+
+int tld_journal_append(tld_journal_t* journal, const tld_mutation_t* mutation, uint64_t* sequence_out) {
+    if (!journal || !mutation || !mutation->tld || !mutation->tld->name) return -1;
+
+    // Encode outside the lock; only the sequence and the copy are serialized
+    byte_buffer_t payload = {0};
+    if (encode_payload(mutation, &payload) != 0) {
+        free(payload.data);
+        return -1;
+    }
+
+    pthread_mutex_lock(&journal->append_lock);
+    byte_buffer_t pending = { journal->pending, journal->pending_len, journal->pending_capacity };
+    if (buffer_reserve(&pending, ENTRY_HEADER_SIZE + payload.len) != 0) {
+        pthread_mutex_unlock(&journal->append_lock);
+        free(payload.data);
+        return -1;
+    }
+    journal->pending = pending.data;
+    journal->pending_capacity = pending.capacity;
+
+    uint64_t seq = ++journal->last_seq;
+    uint8_t* entry = journal->pending + journal->pending_len;
+    put_u32(entry, (uint32_t)payload.len);
+    put_u64(entry + 8, seq);
+    put_u16(entry + 16, (uint16_t)mutation->type);
+    put_u16(entry + 18, 0);
+    memcpy(entry + ENTRY_HEADER_SIZE, payload.data, payload.len);
+    put_u32(entry + 4, crc32_update(0, entry + 8, ENTRY_HEADER_SIZE - 8 + payload.len));
+    journal->pending_len += ENTRY_HEADER_SIZE + payload.len;
+
+    if (journal->pending_len == ENTRY_HEADER_SIZE + payload.len ||
+        journal->pending_len >= journal->config.max_pending_bytes) {
+        pthread_cond_signal(&journal->append_cond);
+    }
+    pthread_mutex_unlock(&journal->append_lock);
+
+    free(payload.data);
+    if (sequence_out) *sequence_out = seq;
+    return 0;
+}
+
+static void on_tld_mutation(void* ctx, const tld_mutation_t* mutation) {
+    tld_journal_t* journal = ctx;
+    if (tld_journal_append(journal, mutation, NULL) != 0) {
+        log_error("Journal: failed to append mutation %d for TLD %s", mutation->type,
+             mutation->tld ? mutation->tld->name : "(null)");
+    }
+}
+
+int attach_tld_journal(tld_journal_t* journal, tld_manager_t* manager) {
+    if (!journal || !manager || journal->attached_manager) return -1;
+    if (add_tld_mutation_listener(manager, on_tld_mutation, journal) != 0) return -1;
+    journal->attached_manager = manager;
+    return 0;
+}
+
+void detach_tld_journal(tld_journal_t* journal) {
+    if (!journal || !journal->attached_manager) return;
+    remove_tld_mutation_listener(journal->attached_manager, on_tld_mutation, journal);
+    journal->attached_manager = NULL;
+}
+
+int tld_journal_sync(tld_journal_t* journal) {
+    if (!journal) return -1;
+
+    pthread_mutex_lock(&journal->append_lock);
+    uint64_t target = journal->last_seq;
+    while (journal->durable_seq < target && !journal->write_failed) {
+        journal->flush_requested = 1;
+        pthread_cond_signal(&journal->append_cond);
+        pthread_cond_wait(&journal->durable_cond, &journal->append_lock);
+    }
+    int result = journal->write_failed ? -1 : 0;
+    pthread_mutex_unlock(&journal->append_lock);
+    return result;
+}
+
+uint64_t tld_journal_last_sequence(tld_journal_t* journal) {
+    if (!journal) return 0;
+    pthread_mutex_lock(&journal->append_lock);
+    uint64_t seq = journal->last_seq;
+    pthread_mutex_unlock(&journal->append_lock);
+    return seq;
+}
+
+uint64_t tld_journal_durable_sequence(tld_journal_t* journal) {
+    if (!journal) return 0;
+    pthread_mutex_lock(&journal->append_lock);
+    uint64_t seq = journal->durable_seq;
+    pthread_mutex_unlock(&journal->append_lock);
+    return seq;
+}
+
+uint64_t tld_journal_base_sequence(tld_journal_t* journal) {
+    if (!journal) return 0;
+    pthread_mutex_lock(&journal->io_lock);
+    uint64_t seq = journal->base_seq;
+    pthread_mutex_unlock(&journal->io_lock);
+    return seq;
+}
+
+// --- Reading ---
+
+typedef struct {
+    uint64_t since;
+    tld_journal_visitor_fn visit;
+    void* ctx;
+} read_since_ctx_t;
+
+static int visit_decoded(void* arg, uint64_t seq, uint16_t type, const uint8_t* entry,
+                         size_t entry_len, const uint8_t* payload, size_t payload_len) {
+    (void)entry; (void)entry_len;
+    read_since_ctx_t* rs = arg;
+    if (seq <= rs->since) return 0;
+
+    tld_journal_entry_t decoded;
+    if (decode_entry(seq, type, payload, payload_len, &decoded) != 0) {
+        dlog("Journal: undecodable entry %llu (type %u)", (unsigned long long)seq, type);
+        return -1;
+    }
+    return rs->visit(rs->ctx, &decoded);
+}
+
+int tld_journal_read_since(tld_journal_t* journal, uint64_t since_sequence,
+                           tld_journal_visitor_fn visit, void* ctx) {
+    if (!journal || !visit) return -1;
+
+    pthread_mutex_lock(&journal->io_lock);
+    if (since_sequence < journal->base_seq) {
+        pthread_mutex_unlock(&journal->io_lock);
+        return -1;
+    }
+
+    read_since_ctx_t rs = { since_sequence, visit, ctx };
+    int failed = 0;
+    scan_entries(journal->fd, journal->file_size, visit_decoded, &rs, &failed);
+    pthread_mutex_unlock(&journal->io_lock);
+    return failed ? -1 : 0;
+}
+
+// --- Mirror export ---
+
+typedef struct {
+    uint64_t since;
+    size_t max_entries;
+    byte_buffer_t out;
+    size_t count;
+    int failed;
+} export_ctx_t;
+
+static int copy_entry_out(void* arg, uint64_t seq, uint16_t type, const uint8_t* entry,
+                          size_t entry_len, const uint8_t* payload, size_t payload_len) {
+    (void)type; (void)payload; (void)payload_len;
+    export_ctx_t* export = arg;
+    if (seq <= export->since) return 0;
+    if (buffer_reserve(&export->out, entry_len) != 0) {
+        export->failed = 1;
+        return -1;
+    }
+    memcpy(export->out.data + export->out.len, entry, entry_len);
+    export->out.len += entry_len;
+    // Stopping the scan here is how a full batch ends, not an error
+    return ++export->count == export->max_entries ? -1 : 0;
+}
+
+int tld_journal_export_since(tld_journal_t* journal, uint64_t since_sequence, size_t max_entries,
+                             uint8_t** data_out, size_t* len_out, size_t* count_out) {
+    if (!journal || !data_out || !len_out || !count_out || max_entries == 0) return -1;
+
+    pthread_mutex_lock(&journal->io_lock);
+    if (since_sequence < journal->base_seq) {
+        pthread_mutex_unlock(&journal->io_lock);
+        return -1;
+    }
+    export_ctx_t export = { since_sequence, max_entries, {0}, 0, 0 };
+    scan_entries(journal->fd, journal->file_size, copy_entry_out, &export, NULL);
+    pthread_mutex_unlock(&journal->io_lock);
+
+    if (export.failed) {
+        free(export.out.data);
+        return -1;
+    }
+    *data_out = export.out.data;
+    *len_out = export.out.len;
+    *count_out = export.count;
+    return 0;
+}
+
+int tld_journal_decode_entries(const uint8_t* data, size_t len, tld_journal_visitor_fn visit, void* ctx) {
+    if ((len > 0 && !data) || !visit) return -1;
+
+    size_t offset = 0;
+    while (offset < len) {
+        const uint8_t* entry = data + offset;
+        if (len - offset < ENTRY_HEADER_SIZE) return -1;
+        uint32_t payload_len = get_u32(entry);
+        if (payload_len > MAX_ENTRY_PAYLOAD || len - offset - ENTRY_HEADER_SIZE < payload_len) return -1;
+        size_t entry_len = ENTRY_HEADER_SIZE + payload_len;
+        if (crc32_update(0, entry + 8, entry_len - 8) != get_u32(entry + 4)) return -1;
+
+        tld_journal_entry_t decoded;
+        if (decode_entry(get_u64(entry + 8), get_u16(entry + 16), entry + ENTRY_HEADER_SIZE,
+                         payload_len, &decoded) != 0) return -1;
+        if (visit(ctx, &decoded) != 0) return -1;
+        offset += entry_len;
+    }
+    return 0;
+}
+
+// --- Replay ---
+
+// Caller holds manager->lock (find_tld_by_name takes it itself)
+static tld_t* find_tld_locked(tld_manager_t* manager, const char* tld_name) {
+    for (size_t i = 0; i < manager->tld_count; ++i) {
+        if (manager->tlds[i] && strcmp(manager->tlds[i]->name, tld_name) == 0) return manager->tlds[i];
+    }
+    return NULL;
+}
+
+static int has_record(const tld_t* tld, const dns_record_t* record) {
+    dns_record_t stack[8];
+    dns_record_t* found = stack;
+    size_t total = tld_lookup_records(tld, record->name, stack, 8);
+    if (total > 8) {
+        found = malloc(total * sizeof(dns_record_t));
+        if (!found) return 0;
+        tld_lookup_records(tld, record->name, found, total);
+    }
+    int present = 0;
+    for (size_t i = 0; i < total && !present; ++i) {
+        present = found[i].type == record->type && found[i].ttl == record->ttl &&
+                  strcmp(found[i].rdata, record->rdata) == 0;
+    }
+    if (found != stack) free(found);
+    return present;
+}
+
+static int has_node(const tld_node_t* nodes, size_t count, const tld_node_t* node) {
+    for (size_t i = 0; i < count; ++i) {
+        if (strcmp(nodes[i].hostname, node->hostname) == 0 && strcmp(nodes[i].ip_address, node->ip_address) == 0) return 1;
+    }
+    return 0;
+}
+
+int apply_tld_journal_entry(tld_manager_t* manager, const tld_journal_entry_t* entry) {
+    if (!manager || !entry || !entry->tld_name) return -1;
+
+    if (entry->type == TLD_MUTATION_REGISTER) {
+        tld_t* tld = register_new_tld(manager, entry->tld_name);
+        if (!tld) return find_tld_by_name(manager, entry->tld_name) ? 1 : -1;
+        pthread_rwlock_wrlock(&manager->lock);
+        tld->created_at = entry->timestamp;
+        pthread_rwlock_unlock(&manager->lock);
+        return 0;
+    }
+
+    int rc = -1;
+    pthread_rwlock_wrlock(&manager->lock);
+    tld_t* tld = find_tld_locked(manager, entry->tld_name);
+    if (!tld) {
+        dlog("Journal: entry %llu targets unknown TLD %s", (unsigned long long)entry->sequence, entry->tld_name);
+    } else {
+        switch (entry->type) {
+            case TLD_MUTATION_ADD_RECORD:
+                if (has_record(tld, &entry->record)) {
+                    rc = 1;
+                } else if ((rc = add_dns_record_to_tld(tld, &entry->record)) == 0) {
+                    tld->records[tld->record_count - 1].last_updated = entry->record.last_updated;
+                }
+                break;
+            case TLD_MUTATION_REMOVE_RECORD:
+                rc = remove_exact_dns_record_from_tld(tld, &entry->record) == 0 ? 0 : 1;
+                break;
+            case TLD_MUTATION_ADD_AUTHORITATIVE_NODE:
+                if (has_node(tld->authoritative_nodes, tld->authoritative_node_count, &entry->node)) {
+                    rc = 1;
+                } else if ((rc = add_authoritative_node_to_tld(tld, &entry->node)) == 0) {
+                    tld->authoritative_nodes[tld->authoritative_node_count - 1].last_seen = entry->node.last_seen;
+                }
+                break;
+            case TLD_MUTATION_ADD_MIRROR_NODE:
+                if (has_node(tld->mirror_nodes, tld->mirror_node_count, &entry->node)) {
+                    rc = 1;
+                } else if ((rc = add_mirror_node_to_tld(tld, &entry->node)) == 0) {
+                    tld->mirror_nodes[tld->mirror_node_count - 1].last_seen = entry->node.last_seen;
+                }
+                break;
+            case TLD_MUTATION_PRUNE_STALE_NODES: {
+                int pruned = prune_stale_tld_nodes(tld, entry->timestamp);
+                rc = pruned < 0 ? -1 : pruned > 0 ? 0 : 1;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    pthread_rwlock_unlock(&manager->lock);
+    return rc;
+}
+
+// --- Compaction ---
+
+typedef struct {
+    uint64_t after;
+    int fd;
+    uint64_t written;
+    int failed;
+} compact_copy_ctx_t;
+
+static int copy_newer_entry(void* arg, uint64_t seq, uint16_t type, const uint8_t* entry,
+                            size_t entry_len, const uint8_t* payload, size_t payload_len) {
+    (void)type; (void)payload; (void)payload_len;
+    compact_copy_ctx_t* copy = arg;
+    if (seq <= copy->after) return 0;
+    if (write_all_fd(copy->fd, entry, entry_len) != 0) {
+        copy->failed = 1;
+        return -1;
+    }
+    copy->written += entry_len;
+    return 0;
+}
+
+int compact_tld_journal(tld_journal_t* journal, uint64_t covered_sequence) {
+    if (!journal) return -1;
+
+    char tmp_path[1024];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.compact", journal->path) >= (int)sizeof(tmp_path)) return -1;
+
+    // Entries past the covered point are carried over; the writer is
+    // blocked on io_lock meanwhile, which is short since the tail is small.
+    pthread_mutex_lock(&journal->io_lock);
+    if (covered_sequence <= journal->base_seq) {
+        pthread_mutex_unlock(&journal->io_lock);
+        return 0;
+    }
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    int ok = fd >= 0 && write_file_header(fd, covered_sequence) == 0 && lseek(fd, JOURNAL_HEADER_SIZE, SEEK_SET) >= 0;
+
+    compact_copy_ctx_t copy = { covered_sequence, fd, 0, 0 };
+    if (ok) {
+        scan_entries(journal->fd, journal->file_size, copy_newer_entry, &copy, NULL);
+        ok = !copy.failed && fsync(fd) == 0 && rename(tmp_path, journal->path) == 0;
+    }
+    if (ok) {
+        close(journal->fd);
+        journal->fd = fd;
+        journal->base_seq = covered_sequence;
+        journal->file_size = JOURNAL_HEADER_SIZE + copy.written;
+    } else {
+        log_error("Journal: compaction of %s failed", journal->path);
+        if (fd >= 0) close(fd);
+        unlink(tmp_path);
+    }
+    pthread_mutex_unlock(&journal->io_lock);
+    if (!ok) return -1;
+
+    // A journal that lost its file still hands out sequences past the cover
+    pthread_mutex_lock(&journal->append_lock);
+    if (journal->last_seq < covered_sequence) journal->last_seq = journal->durable_seq = covered_sequence;
+    pthread_mutex_unlock(&journal->append_lock);
+
+    dlog("Journal: compacted %s at sequence %llu (%llu bytes kept)", journal->path,
+         (unsigned long long)covered_sequence, (unsigned long long)copy.written);
+    return 0;
+}
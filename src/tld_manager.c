@@ -3,6 +3,8 @@
 #include <string.h>
 #include <stdio.h> // For dlog or printf if needed for errors
 #include "debug.h" // For dlog, if used
+#include "tld_merkle.h"
+#include "tld_snapshot.h"
 
 #define INITIAL_TLD_CAPACITY 10
 
@@ -31,11 +33,22 @@ static void free_single_tld(tld_t* tld) {
         // free(tld->mirror_nodes[i].public_key);
     }
     free(tld->mirror_nodes);
+
+    cleanup_tld_merkle(tld->merkle);
+    free(tld->base_tombstones);
     
     // free(tld->admin_contact); // If allocated
     free(tld);
 }
 
+// Publish a mutation to every registered listener
+static void notify_tld_mutation(tld_manager_t* manager, const tld_mutation_t* mutation) {
+    if (!manager) return;
+    for (size_t i = 0; i < manager->listener_count; ++i) {
+        manager->listeners[i].fn(manager->listeners[i].ctx, mutation);
+    }
+}
+
 int init_tld_manager(tld_manager_t** manager_ptr) {
     if (!manager_ptr) return -1;
 
@@ -56,6 +69,8 @@ int init_tld_manager(tld_manager_t** manager_ptr) {
 
     manager->tld_count = 0;
     manager->tld_capacity = INITIAL_TLD_CAPACITY;
+    manager->listener_count = 0;
+    manager->snapshot = NULL;
     if (pthread_rwlock_init(&manager->lock, NULL) != 0) {
         // dlog_error("Failed to initialize TLD manager rwlock");
         free(manager->tlds);
@@ -66,6 +81,19 @@ int init_tld_manager(tld_manager_t** manager_ptr) {
     return 0;
 }
 
+void clear_tld_manager(tld_manager_t* manager) {
+    if (!manager) return;
+
+    pthread_rwlock_wrlock(&manager->lock);
+    for (size_t i = 0; i < manager->tld_count; ++i) {
+        free_single_tld(manager->tlds[i]);
+    }
+    manager->tld_count = 0;
+    close_tld_snapshot(manager->snapshot);
+    manager->snapshot = NULL;
+    pthread_rwlock_unlock(&manager->lock);
+}
+
 void cleanup_tld_manager(tld_manager_t* manager) {
     if (!manager) return;
 
@@ -77,6 +105,8 @@ void cleanup_tld_manager(tld_manager_t* manager) {
     manager->tlds = NULL;
     manager->tld_count = 0;
     manager->tld_capacity = 0;
+    close_tld_snapshot(manager->snapshot);
+    manager->snapshot = NULL;
     pthread_rwlock_unlock(&manager->lock);
     pthread_rwlock_destroy(&manager->lock);
     free(manager);
@@ -134,8 +164,19 @@ tld_t* register_new_tld(tld_manager_t* manager, const char* tld_name) {
     new_tld->record_count = 0;
     new_tld->mirror_nodes = NULL;
     new_tld->mirror_node_count = 0;
+    if (init_tld_merkle(&new_tld->merkle) != 0) {
+        free(new_tld->name);
+        free(new_tld);
+        pthread_rwlock_unlock(&manager->lock);
+        return NULL;
+    }
+
+    new_tld->manager = manager;
 
     manager->tlds[manager->tld_count++] = new_tld;
+
+    tld_mutation_t mutation = { .type = TLD_MUTATION_REGISTER, .tld = new_tld };
+    notify_tld_mutation(manager, &mutation);
     
     pthread_rwlock_unlock(&manager->lock);
     // dlog_info("Registered new TLD: %s", tld_name);
@@ -196,19 +237,59 @@ int add_dns_record_to_tld(tld_t* tld, const dns_record_t* record_in) {
     new_record->type = record_in->type;
     new_record->ttl = record_in->ttl;
     new_record->last_updated = time(NULL);
+
+    if (tld->merkle && tld_merkle_add_record(tld->merkle, new_record) != 0) {
+        free(new_record->name);
+        free(new_record->rdata);
+        return -1;
+    }
     
-tld->record_count++;
+    tld->record_count++;
     tld->last_modified = time(NULL);
 
+    tld_mutation_t mutation = { .type = TLD_MUTATION_ADD_RECORD, .tld = tld, .record = new_record };
+    notify_tld_mutation(tld->manager, &mutation);
+
     return 0;
 }
 
-int remove_dns_record_from_tld(tld_t* tld, const char* record_name, dns_record_type_t type) {
-    if (!tld || !record_name) return -1;
+// Tombstone the first live snapshot record matching name/type (and rdata
+// unless it is NULL), if any
+static int remove_base_record(tld_t* tld, const char* record_name, dns_record_type_t type, const char* rdata) {
+    if (!tld->base || !tld->base_tombstones) return -1;
+
+    size_t first = 0;
+    size_t count = tld_snapshot_find_name(tld->base, record_name, &first);
+    for (size_t pos = first; pos < first + count; ++pos) {
+        if (tld->base_tombstones[pos / 8] & (1u << (pos % 8))) continue;
+        if (tld->base->records[pos].type != (uint32_t)type) continue;
+
+        dns_record_t view;
+        tld_snapshot_record_view(tld->base, pos, &view);
+        if (rdata && strcmp(view.rdata, rdata) != 0) continue;
+        if (tld->merkle) {
+            tld_merkle_remove_record(tld->merkle, &view);
+        }
+
+        tld_mutation_t mutation = { .type = TLD_MUTATION_REMOVE_RECORD, .tld = tld, .record = &view };
+        notify_tld_mutation(tld->manager, &mutation);
+
+        tld->base_tombstones[pos / 8] |= (uint8_t)(1u << (pos % 8));
+        tld->base_removed_count++;
+        tld->last_modified = time(NULL);
+        return 0;
+    }
+    return -1;
+}
+
+static int remove_matching_record(tld_t* tld, const char* record_name, dns_record_type_t type, const char* rdata) {
+    // Snapshot records come first in iteration order, so they match first
+    if (remove_base_record(tld, record_name, type, rdata) == 0) return 0;
 
     int found_idx = -1;
     for (size_t i = 0; i < tld->record_count; ++i) {
-        if (tld->records[i].type == type && strcmp(tld->records[i].name, record_name) == 0) {
+        if (tld->records[i].type == type && strcmp(tld->records[i].name, record_name) == 0 &&
+            (!rdata || strcmp(tld->records[i].rdata, rdata) == 0)) {
             found_idx = i;
             break;
         }
@@ -219,6 +300,13 @@ int remove_dns_record_from_tld(tld_t* tld, const char* record_name, dns_record_t
         return -1; // Not found
     }
 
+    if (tld->merkle) {
+        tld_merkle_remove_record(tld->merkle, &tld->records[found_idx]);
+    }
+
+    tld_mutation_t mutation = { .type = TLD_MUTATION_REMOVE_RECORD, .tld = tld, .record = &tld->records[found_idx] };
+    notify_tld_mutation(tld->manager, &mutation);
+
     // Free the found record's content
     free(tld->records[found_idx].name);
     free(tld->records[found_idx].rdata);
@@ -248,6 +336,16 @@ int remove_dns_record_from_tld(tld_t* tld, const char* record_name, dns_record_t
     return 0;
 }
 
+int remove_dns_record_from_tld(tld_t* tld, const char* record_name, dns_record_type_t type) {
+    if (!tld || !record_name) return -1;
+    return remove_matching_record(tld, record_name, type, NULL);
+}
+
+int remove_exact_dns_record_from_tld(tld_t* tld, const dns_record_t* record) {
+    if (!tld || !record || !record->name || !record->rdata) return -1;
+    return remove_matching_record(tld, record->name, record->type, record->rdata);
+}
+
 static int add_node_to_list(tld_node_t** list, size_t* count, const tld_node_t* node_info) {
     tld_node_t* new_list = realloc(*list, (*count + 1) * sizeof(tld_node_t));
     if (!new_list) {
@@ -283,6 +381,10 @@ int add_authoritative_node_to_tld(tld_t* tld, const tld_node_t* node_info) {
         return -1;
     }
     tld->last_modified = time(NULL);
+
+    tld_mutation_t mutation = { .type = TLD_MUTATION_ADD_AUTHORITATIVE_NODE, .tld = tld,
+                                .node = &tld->authoritative_nodes[tld->authoritative_node_count - 1] };
+    notify_tld_mutation(tld->manager, &mutation);
     // dlog_info("Added authoritative node '%s' to TLD '%s'.", node_info->hostname, tld->name);
     return 0;
 }
@@ -294,6 +396,10 @@ int add_mirror_node_to_tld(tld_t* tld, const tld_node_t* node_info) {
         return -1;
     }
     tld->last_modified = time(NULL);
+
+    tld_mutation_t mutation = { .type = TLD_MUTATION_ADD_MIRROR_NODE, .tld = tld,
+                                .node = &tld->mirror_nodes[tld->mirror_node_count - 1] };
+    notify_tld_mutation(tld->manager, &mutation);
     // dlog_info("Added mirror node '%s' to TLD '%s'.", node_info->hostname, tld->name);
     return 0;
 }
@@ -417,6 +523,57 @@ int discover_tld_peers(tld_manager_t* manager, const char* tld_name, tld_node_t*
     return 0;
 }
 
+int prune_stale_tld_nodes(tld_t* tld, time_t stale_threshold) {
+    if (!tld) return -1;
+
+    int cleaned_count = 0;
+
+    // Clean stale mirror nodes
+    size_t new_mirror_count = 0;
+    for (size_t i = 0; i < tld->mirror_node_count; i++) {
+        if (tld->mirror_nodes[i].last_seen >= stale_threshold) {
+            // Keep this node
+            if (new_mirror_count != i) {
+                tld->mirror_nodes[new_mirror_count] = tld->mirror_nodes[i];
+            }
+            new_mirror_count++;
+        } else {
+            // Remove stale node
+            free(tld->mirror_nodes[i].hostname);
+            free(tld->mirror_nodes[i].ip_address);
+            cleaned_count++;
+        }
+    }
+    tld->mirror_node_count = new_mirror_count;
+
+    // Clean stale authoritative nodes (more conservative)
+    size_t new_auth_count = 0;
+    for (size_t i = 0; i < tld->authoritative_node_count; i++) {
+        if (tld->authoritative_nodes[i].last_seen >= stale_threshold) {
+            // Keep this node
+            if (new_auth_count != i) {
+                tld->authoritative_nodes[new_auth_count] = tld->authoritative_nodes[i];
+            }
+            new_auth_count++;
+        } else {
+            // Remove stale authoritative node
+            free(tld->authoritative_nodes[i].hostname);
+            free(tld->authoritative_nodes[i].ip_address);
+            cleaned_count++;
+        }
+    }
+    tld->authoritative_node_count = new_auth_count;
+
+    if (cleaned_count > 0) {
+        tld->last_modified = time(NULL);
+
+        tld_mutation_t mutation = { .type = TLD_MUTATION_PRUNE_STALE_NODES, .tld = tld,
+                                    .stale_threshold = stale_threshold };
+        notify_tld_mutation(tld->manager, &mutation);
+    }
+    return cleaned_count;
+}
+
 int cleanup_stale_peers(tld_manager_t* manager, time_t stale_threshold) {
     if (!manager) return -1;
     
@@ -427,46 +584,7 @@ int cleanup_stale_peers(tld_manager_t* manager, time_t stale_threshold) {
     for (size_t tld_idx = 0; tld_idx < manager->tld_count; tld_idx++) {
         tld_t* tld = manager->tlds[tld_idx];
         if (!tld) continue;
-        
-        // Clean stale mirror nodes
-        size_t new_mirror_count = 0;
-        for (size_t i = 0; i < tld->mirror_node_count; i++) {
-            if (tld->mirror_nodes[i].last_seen >= stale_threshold) {
-                // Keep this node
-                if (new_mirror_count != i) {
-                    tld->mirror_nodes[new_mirror_count] = tld->mirror_nodes[i];
-                }
-                new_mirror_count++;
-            } else {
-                // Remove stale node
-                free(tld->mirror_nodes[i].hostname);
-                free(tld->mirror_nodes[i].ip_address);
-                cleaned_count++;
-            }
-        }
-        tld->mirror_node_count = new_mirror_count;
-        
-        // Clean stale authoritative nodes (more conservative)
-        size_t new_auth_count = 0;
-        for (size_t i = 0; i < tld->authoritative_node_count; i++) {
-            if (tld->authoritative_nodes[i].last_seen >= stale_threshold) {
-                // Keep this node
-                if (new_auth_count != i) {
-                    tld->authoritative_nodes[new_auth_count] = tld->authoritative_nodes[i];
-                }
-                new_auth_count++;
-            } else {
-                // Remove stale authoritative node
-                free(tld->authoritative_nodes[i].hostname);
-                free(tld->authoritative_nodes[i].ip_address);
-                cleaned_count++;
-            }
-        }
-        tld->authoritative_node_count = new_auth_count;
-        
-        if (cleaned_count > 0) {
-            tld->last_modified = time(NULL);
-        }
+        cleaned_count += prune_stale_tld_nodes(tld, stale_threshold);
     }
     
     pthread_rwlock_unlock(&manager->lock);
@@ -489,4 +607,207 @@ int get_tld_sync_status(tld_manager_t* manager, const char* tld_name, time_t* la
     }
     
     return 0;
-} 
\ No newline at end of file
+}
+
+int add_tld_mutation_listener(tld_manager_t* manager, tld_mutation_listener_fn fn, void* ctx) {
+    if (!manager || !fn) return -1;
+
+    pthread_rwlock_wrlock(&manager->lock);
+    if (manager->listener_count >= TLD_MAX_MUTATION_LISTENERS) {
+        pthread_rwlock_unlock(&manager->lock);
+        dlog("TLD manager: mutation listener table full");
+        return -1;
+    }
+    manager->listeners[manager->listener_count].fn = fn;
+    manager->listeners[manager->listener_count].ctx = ctx;
+    manager->listener_count++;
+    pthread_rwlock_unlock(&manager->lock);
+    return 0;
+}
+
+int remove_tld_mutation_listener(tld_manager_t* manager, tld_mutation_listener_fn fn, void* ctx) {
+    if (!manager || !fn) return -1;
+
+    pthread_rwlock_wrlock(&manager->lock);
+    for (size_t i = 0; i < manager->listener_count; ++i) {
+        if (manager->listeners[i].fn == fn && manager->listeners[i].ctx == ctx) {
+            memmove(&manager->listeners[i], &manager->listeners[i + 1],
+                    (manager->listener_count - i - 1) * sizeof(tld_mutation_listener_t));
+            manager->listener_count--;
+            pthread_rwlock_unlock(&manager->lock);
+            return 0;
+        }
+    }
+    pthread_rwlock_unlock(&manager->lock);
+    return -1;
+}
+
+int get_tld_merkle_root(tld_manager_t* manager, const char* tld_name, uint8_t root_out[32]) {
+    if (!manager || !tld_name || !root_out) return -1;
+
+    pthread_rwlock_rdlock(&manager->lock);
+    int result = -1;
+    for (size_t i = 0; i < manager->tld_count; ++i) {
+        tld_t* tld = manager->tlds[i];
+        if (tld && tld->merkle && strcmp(tld->name, tld_name) == 0) {
+            result = tld_merkle_get_root(tld->merkle, root_out);
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&manager->lock);
+    return result;
+}
+
+void free_tld_bucket_records(dns_record_t* records, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        free(records[i].name);
+        free(records[i].rdata);
+    }
+    free(records);
+}
+
+typedef struct {
+    uint32_t bucket;
+    dns_record_t* out;
+    size_t count;
+    size_t capacity;
+} bucket_collect_ctx_t;
+
+static int collect_bucket_visitor(void* arg, const dns_record_t* rec) {
+    bucket_collect_ctx_t* ctx = arg;
+    if (tld_merkle_bucket_for_name(rec->name) != ctx->bucket) return 0;
+
+    if (ctx->count == ctx->capacity) {
+        size_t capacity = ctx->capacity ? ctx->capacity * 2 : 8;
+        dns_record_t* grown = realloc(ctx->out, capacity * sizeof(dns_record_t));
+        if (!grown) return -1;
+        ctx->out = grown;
+        ctx->capacity = capacity;
+    }
+
+    dns_record_t* copy = &ctx->out[ctx->count];
+    copy->name = strdup(rec->name);
+    copy->rdata = strdup(rec->rdata);
+    copy->type = rec->type;
+    copy->ttl = rec->ttl;
+    copy->last_updated = rec->last_updated;
+    if (!copy->name || !copy->rdata) {
+        free(copy->name);
+        free(copy->rdata);
+        return -1;
+    }
+    ctx->count++;
+    return 0;
+}
+
+int collect_tld_bucket_records(tld_t* tld, uint32_t bucket, dns_record_t** records_out, size_t* count_out) {
+    if (!tld || !records_out || !count_out || bucket >= TLD_MERKLE_LEAVES) return -1;
+
+    *records_out = NULL;
+    *count_out = 0;
+
+    if (tld->merkle && tld->merkle->bucket_sizes[bucket] == 0) return 0;
+
+    bucket_collect_ctx_t ctx = { .bucket = bucket };
+    if (tld_for_each_record(tld, collect_bucket_visitor, &ctx) != 0) {
+        free_tld_bucket_records(ctx.out, ctx.count);
+        return -1;
+    }
+
+    *records_out = ctx.out;
+    *count_out = ctx.count;
+    return 0;
+}
+
+static int same_record(const dns_record_t* a, const dns_record_t* b) {
+    return a->type == b->type && a->ttl == b->ttl &&
+           strcmp(a->name, b->name) == 0 && strcmp(a->rdata, b->rdata) == 0;
+}
+
+int reconcile_tld_bucket(tld_t* tld, uint32_t bucket, const dns_record_t* remote_records, size_t remote_count) {
+    if (!tld || bucket >= TLD_MERKLE_LEAVES || (remote_count > 0 && !remote_records)) return -1;
+    for (size_t r = 0; r < remote_count; ++r) {
+        if (!remote_records[r].name || !remote_records[r].rdata) return -1;
+    }
+
+    // Only the difference is applied: local records the peer lacks are
+    // removed, then the peer's records we lack are added. Matching is a
+    // multiset match on name, type, ttl and rdata, the fields the Merkle
+    // digest covers.
+    dns_record_t* local = NULL;
+    size_t local_count = 0;
+    if (collect_tld_bucket_records(tld, bucket, &local, &local_count) != 0) return -1;
+
+    uint8_t* remote_matched = remote_count ? calloc(remote_count, 1) : NULL;
+    if (remote_count && !remote_matched) {
+        free_tld_bucket_records(local, local_count);
+        return -1;
+    }
+
+    int result = 0;
+    for (size_t l = 0; l < local_count && result == 0; ++l) {
+        size_t r = 0;
+        for (; r < remote_count; ++r) {
+            if (!remote_matched[r] && same_record(&local[l], &remote_records[r])) break;
+        }
+        if (r < remote_count) {
+            remote_matched[r] = 1;
+            continue;
+        }
+        result = remove_matching_record(tld, local[l].name, local[l].type, local[l].rdata);
+    }
+    for (size_t r = 0; r < remote_count && result == 0; ++r) {
+        if (remote_matched[r] || tld_merkle_bucket_for_name(remote_records[r].name) != bucket) continue;
+        result = add_dns_record_to_tld(tld, &remote_records[r]);
+    }
+
+    free(remote_matched);
+    free_tld_bucket_records(local, local_count);
+    return result;
+}
+
+// Base (snapshot) + delta record access
+
+size_t tld_record_count(const tld_t* tld) {
+    if (!tld) return 0;
+    size_t base_live = tld->base ? tld->base->record_count - tld->base_removed_count : 0;
+    return base_live + tld->record_count;
+}
+
+int tld_for_each_record(const tld_t* tld, tld_record_visitor_fn visit, void* ctx) {
+    if (!tld || !visit) return -1;
+
+    for (size_t pos = 0; tld->base && pos < tld->base->record_count; ++pos) {
+        if (tld->base_tombstones[pos / 8] & (1u << (pos % 8))) continue;
+        dns_record_t view;
+        tld_snapshot_record_view(tld->base, pos, &view);
+        int result = visit(ctx, &view);
+        if (result != 0) return result;
+    }
+    for (size_t i = 0; i < tld->record_count; ++i) {
+        int result = visit(ctx, &tld->records[i]);
+        if (result != 0) return result;
+    }
+    return 0;
+}
+
+size_t tld_lookup_records(const tld_t* tld, const char* name, dns_record_t* out, size_t max) {
+    if (!tld || !name) return 0;
+
+    size_t found = 0;
+    if (tld->base) {
+        size_t first = 0;
+        size_t count = tld_snapshot_find_name(tld->base, name, &first);
+        for (size_t pos = first; pos < first + count; ++pos) {
+            if (tld->base_tombstones[pos / 8] & (1u << (pos % 8))) continue;
+            if (out && found < max) tld_snapshot_record_view(tld->base, pos, &out[found]);
+            found++;
+        }
+    }
+    for (size_t i = 0; i < tld->record_count; ++i) {
+        if (strcmp(tld->records[i].name, name) != 0) continue;
+        if (out && found < max) out[found] = tld->records[i];
+        found++;
+    }
+    return found;
+}
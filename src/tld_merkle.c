@@ -0,0 +1,217 @@
+#include "tld_merkle.h"
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include "debug.h"
+
+static const uint8_t zero_hash[TLD_MERKLE_HASH_LEN] = {0};
+
+static int is_zero_hash(const uint8_t* hash) {
+    return memcmp(hash, zero_hash, TLD_MERKLE_HASH_LEN) == 0;
+}
+
+// Digest of one record: name, type, ttl and rdata. last_updated is left out
+// on purpose, it is local bookkeeping and differs between mirrors.
+static int digest_record(const dns_record_t* record, uint8_t out[TLD_MERKLE_HASH_LEN]) {
+    if (!record || !record->name || !record->rdata) return -1;
+
+    uint8_t fixed[8];
+    uint32_t type = (uint32_t)record->type;
+    fixed[0] = (uint8_t)(type >> 24);
+    fixed[1] = (uint8_t)(type >> 16);
+    fixed[2] = (uint8_t)(type >> 8);
+    fixed[3] = (uint8_t)type;
+    fixed[4] = (uint8_t)(record->ttl >> 24);
+    fixed[5] = (uint8_t)(record->ttl >> 16);
+    fixed[6] = (uint8_t)(record->ttl >> 8);
+    fixed[7] = (uint8_t)record->ttl;
+
+    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
+    if (!mdctx) return -1;
+
+    unsigned int len = 0;
+    int ok = EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) == 1 &&
+             EVP_DigestUpdate(mdctx, record->name, strlen(record->name) + 1) == 1 &&
+             EVP_DigestUpdate(mdctx, fixed, sizeof(fixed)) == 1 &&
+             EVP_DigestUpdate(mdctx, record->rdata, strlen(record->rdata) + 1) == 1 &&
+             EVP_DigestFinal_ex(mdctx, out, &len) == 1;
+    EVP_MD_CTX_free(mdctx);
+    return ok ? 0 : -1;
+}
+
+// Leaves accumulate digests as 256-bit big-endian integers mod 2^256.
+// Unlike XOR, a duplicated record does not cancel itself out.
+static void hash_add(uint8_t* acc, const uint8_t* value) {
+    unsigned int carry = 0;
+    for (int i = TLD_MERKLE_HASH_LEN - 1; i >= 0; --i) {
+        unsigned int sum = (unsigned int)acc[i] + value[i] + carry;
+        acc[i] = (uint8_t)sum;
+        carry = sum >> 8;
+    }
+}
+
+static void hash_sub(uint8_t* acc, const uint8_t* value) {
+    int borrow = 0;
+    for (int i = TLD_MERKLE_HASH_LEN - 1; i >= 0; --i) {
+        int diff = (int)acc[i] - value[i] - borrow;
+        borrow = diff < 0;
+        acc[i] = (uint8_t)(diff + (borrow ? 256 : 0));
+    }
+}
+
+// Empty subtrees hash to all zeros so an empty TLD has a zero root and
+// untouched regions of the tree never need hashing.
+static void recompute_parents(tld_merkle_t* tree, uint32_t node) {
+    uint8_t buf[2 * TLD_MERKLE_HASH_LEN];
+
+    for (node >>= 1; node >= 1; node >>= 1) {
+        const uint8_t* left = tree->nodes[2 * node];
+        const uint8_t* right = tree->nodes[2 * node + 1];
+        if (is_zero_hash(left) && is_zero_hash(right)) {
+            memset(tree->nodes[node], 0, TLD_MERKLE_HASH_LEN);
+        } else {
+            memcpy(buf, left, TLD_MERKLE_HASH_LEN);
+            memcpy(buf + TLD_MERKLE_HASH_LEN, right, TLD_MERKLE_HASH_LEN);
+            SHA256(buf, sizeof(buf), tree->nodes[node]);
+        }
+    }
+}
+
+int init_tld_merkle(tld_merkle_t** tree_ptr) {
+    if (!tree_ptr) return -1;
+
+    *tree_ptr = calloc(1, sizeof(tld_merkle_t));
+    if (!*tree_ptr) {
+        dlog("Failed to allocate TLD Merkle tree");
+        return -1;
+    }
+    return 0;
+}
+
+void cleanup_tld_merkle(tld_merkle_t* tree) {
+    free(tree);
+}
+
+void reset_tld_merkle(tld_merkle_t* tree) {
+    if (tree) memset(tree, 0, sizeof(tld_merkle_t));
+}
+
+uint32_t tld_merkle_bucket_for_name(const char* record_name) {
+    if (!record_name) return 0;
+
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char*)record_name, strlen(record_name), digest);
+    return (((uint32_t)digest[0] << 8) | digest[1]) & (TLD_MERKLE_LEAVES - 1);
+}
+
+int tld_merkle_add_record(tld_merkle_t* tree, const dns_record_t* record) {
+    if (!tree || !record) return -1;
+
+    uint8_t digest[TLD_MERKLE_HASH_LEN];
+    if (digest_record(record, digest) != 0) return -1;
+
+    uint32_t bucket = tld_merkle_bucket_for_name(record->name);
+    uint32_t node = TLD_MERKLE_LEAVES + bucket;
+    hash_add(tree->nodes[node], digest);
+    tree->bucket_sizes[bucket]++;
+    tree->record_count++;
+    recompute_parents(tree, node);
+    return 0;
+}
+
+int tld_merkle_remove_record(tld_merkle_t* tree, const dns_record_t* record) {
+    if (!tree || !record) return -1;
+
+    uint32_t bucket = tld_merkle_bucket_for_name(record->name);
+    if (tree->bucket_sizes[bucket] == 0) return -1;
+
+    uint8_t digest[TLD_MERKLE_HASH_LEN];
+    if (digest_record(record, digest) != 0) return -1;
+
+    uint32_t node = TLD_MERKLE_LEAVES + bucket;
+    hash_sub(tree->nodes[node], digest);
+    tree->bucket_sizes[bucket]--;
+    tree->record_count--;
+    recompute_parents(tree, node);
+    return 0;
+}
+
+int tld_merkle_get_root(const tld_merkle_t* tree, uint8_t root_out[TLD_MERKLE_HASH_LEN]) {
+    return tld_merkle_get_node(tree, 0, 0, root_out);
+}
+
+int tld_merkle_get_node(const tld_merkle_t* tree, uint32_t level, uint32_t index,
+                        uint8_t hash_out[TLD_MERKLE_HASH_LEN]) {
+    if (!tree || !hash_out || level > TLD_MERKLE_DEPTH) return -1;
+    if (index >= (1u << level)) return -1;
+
+    memcpy(hash_out, tree->nodes[(1u << level) + index], TLD_MERKLE_HASH_LEN);
+    return 0;
+}
+
+int tld_merkle_find_divergent_buckets(const tld_merkle_t* local,
+                                      tld_merkle_fetch_fn fetch, void* fetch_ctx,
+                                      uint32_t** buckets, size_t* bucket_count) {
+    if (!local || !fetch || !buckets || !bucket_count) return -1;
+
+    *buckets = NULL;
+    *bucket_count = 0;
+
+    // Frontier of divergent node indices at the current level. It can never
+    // hold more than one level's worth of nodes, i.e. TLD_MERKLE_LEAVES.
+    uint32_t* frontier = malloc(TLD_MERKLE_LEAVES * sizeof(uint32_t));
+    uint32_t* next = malloc(TLD_MERKLE_LEAVES * sizeof(uint32_t));
+    uint8_t (*remote)[TLD_MERKLE_HASH_LEN] = malloc(TLD_MERKLE_LEAVES * TLD_MERKLE_HASH_LEN);
+    if (!frontier || !next || !remote) {
+        free(frontier);
+        free(next);
+        free(remote);
+        return -1;
+    }
+
+    size_t frontier_len = 1;
+    frontier[0] = 0;
+    int result = 0;
+
+    for (uint32_t level = 0; level <= TLD_MERKLE_DEPTH && frontier_len > 0; ++level) {
+        if (fetch(fetch_ctx, level, frontier, frontier_len, remote) != 0) {
+            dlog("Merkle divergence walk: fetch failed at level %u", level);
+            result = -1;
+            break;
+        }
+
+        size_t next_len = 0;
+        for (size_t i = 0; i < frontier_len; ++i) {
+            uint32_t node = (1u << level) + frontier[i];
+            if (memcmp(local->nodes[node], remote[i], TLD_MERKLE_HASH_LEN) == 0) continue;
+
+            if (level == TLD_MERKLE_DEPTH) {
+                next[next_len++] = frontier[i];
+            } else {
+                next[next_len++] = 2 * frontier[i];
+                next[next_len++] = 2 * frontier[i] + 1;
+            }
+        }
+
+        uint32_t* tmp = frontier;
+        frontier = next;
+        next = tmp;
+        frontier_len = next_len;
+
+        if (level == TLD_MERKLE_DEPTH && frontier_len > 0) {
+            *buckets = malloc(frontier_len * sizeof(uint32_t));
+            if (!*buckets) {
+                result = -1;
+                break;
+            }
+            memcpy(*buckets, frontier, frontier_len * sizeof(uint32_t));
+            *bucket_count = frontier_len;
+        }
+    }
+
+    free(frontier);
+    free(next);
+    free(remote);
+    return result;
+}
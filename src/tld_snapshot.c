@@ -0,0 +1,533 @@
+#include "../include/tld_snapshot.h"
+#include "../include/tld_manager.h"
+#include "../include/tld_merkle.h"
+#include "../include/checksum.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ALIGN8(x) (((x) + 7u) & ~(uint64_t)7u)
+
+struct tld_snapshot_s {
+    void* map;
+    size_t map_size;
+    const tld_snapshot_header_t* header;
+    const tld_snapshot_tld_t* tlds;
+    tld_snapshot_view_t* views;     // One per TLD, referenced from tld_t.base
+};
+
+// FNV-1a; only used to place names in the per-TLD index
+static uint32_t hash_name(const char* name) {
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t header_checksum(const tld_snapshot_header_t* header) {
+    tld_snapshot_header_t copy = *header;
+    copy.header_checksum = 0;
+    return crc32_update(0, &copy, sizeof(copy));
+}
+
+// Everything after the header: tables, index, Merkle trees and strings
+static uint32_t body_checksum(const void* map, size_t file_size) {
+    return crc32_update(0, (const char*)map + sizeof(tld_snapshot_header_t),
+                        file_size - sizeof(tld_snapshot_header_t));
+}
+
+// --- Reading ---
+
+void tld_snapshot_record_view(const tld_snapshot_view_t* view, size_t position, dns_record_t* out) {
+    const tld_snapshot_record_t* rec = &view->records[position];
+    out->name = (char*)(view->strings + rec->name_offset);
+    out->rdata = (char*)(view->strings + rec->rdata_offset);
+    out->type = (dns_record_type_t)rec->type;
+    out->ttl = rec->ttl;
+    out->last_updated = (time_t)rec->last_updated;
+}
+
+size_t tld_snapshot_find_name(const tld_snapshot_view_t* view, const char* name, size_t* first_position) {
+    if (!view || !name || view->index_slots == 0) return 0;
+
+    uint32_t mask = view->index_slots - 1;
+    for (uint32_t slot = hash_name(name) & mask;; slot = (slot + 1) & mask) {
+        uint32_t entry = view->index[slot];
+        if (entry == 0) return 0;
+
+        size_t pos = entry - 1;
+        if (strcmp(view->strings + view->records[pos].name_offset, name) != 0) continue;
+
+        // Records are sorted by name, so all matches are contiguous
+        size_t end = pos + 1;
+        while (end < view->record_count &&
+               strcmp(view->strings + view->records[end].name_offset, name) == 0) {
+            end++;
+        }
+        if (first_position) *first_position = pos;
+        return end - pos;
+    }
+}
+
+// An 8-byte aligned array of count elements inside the file
+static int section_in_bounds(uint64_t offset, uint64_t count, size_t elem_size, uint64_t file_size) {
+    return offset % 8 == 0 && offset <= file_size && count <= (file_size - offset) / elem_size;
+}
+
+// Every string offset must land in the string table, and every index slot
+// must be empty or name one of its TLD's records. At least one slot must be
+// empty, or a probe for an absent name would never stop.
+static int validate_tld_contents(const tld_snapshot_t* snap, const tld_snapshot_tld_t* t) {
+    const tld_snapshot_header_t* h = snap->header;
+    const char* base = (const char*)snap->map;
+    const tld_snapshot_record_t* records = (const tld_snapshot_record_t*)(base + h->record_table_offset) + t->first_record;
+    const uint32_t* index = (const uint32_t*)(base + h->index_offset) + t->first_index_slot;
+
+    for (uint64_t r = 0; r < t->record_count; ++r) {
+        if (records[r].name_offset >= h->string_table_size || records[r].rdata_offset >= h->string_table_size) {
+            return -1;
+        }
+    }
+
+    if (t->record_count > 0 && t->index_slots == 0) return -1;
+    int has_empty = 0;
+    for (uint32_t s = 0; s < t->index_slots; ++s) {
+        if (index[s] == 0) {
+            has_empty = 1;
+        } else if (index[s] > t->record_count) {
+            return -1;
+        }
+    }
+    return t->index_slots == 0 || has_empty ? 0 : -1;
+}
+
+static int validate_snapshot(const tld_snapshot_t* snap) {
+    const tld_snapshot_header_t* h = snap->header;
+
+    if (memcmp(h->magic, TLD_SNAPSHOT_MAGIC, sizeof(h->magic)) != 0) return -1;
+    if (h->version != TLD_SNAPSHOT_VERSION) return -1;
+    if (h->header_checksum != header_checksum(h)) return -1;
+    if (h->file_size != snap->map_size) return -1;
+    // The Merkle trees are used as stored, so the body must be intact too
+    if (h->body_checksum != body_checksum(snap->map, snap->map_size)) return -1;
+
+    if (!section_in_bounds(h->tld_table_offset, h->tld_count, sizeof(tld_snapshot_tld_t), h->file_size) ||
+        !section_in_bounds(h->record_table_offset, h->record_count, sizeof(tld_snapshot_record_t), h->file_size) ||
+        !section_in_bounds(h->index_offset, h->index_slot_count, sizeof(uint32_t), h->file_size) ||
+        !section_in_bounds(h->merkle_offset, h->tld_count, sizeof(tld_merkle_t), h->file_size) ||
+        !section_in_bounds(h->string_table_offset, h->string_table_size, 1, h->file_size)) {
+        return -1;
+    }
+    if (h->string_table_size == 0 || ((const char*)snap->map)[h->string_table_offset + h->string_table_size - 1] != '\0') {
+        return -1;
+    }
+
+    // Per-TLD ranges must stay inside their sections, and their contents
+    // inside the TLD, so lookups never need to check again
+    for (uint32_t i = 0; i < h->tld_count; ++i) {
+        const tld_snapshot_tld_t* t = &snap->tlds[i];
+        if (t->name_offset >= h->string_table_size) return -1;
+        if (t->first_record > h->record_count || t->record_count > h->record_count - t->first_record) return -1;
+        if (t->first_index_slot > h->index_slot_count || t->index_slots > h->index_slot_count - t->first_index_slot) return -1;
+        if ((t->index_slots & (t->index_slots - 1)) != 0) return -1;
+        if (validate_tld_contents(snap, t) != 0) return -1;
+    }
+    return 0;
+}
+
+int open_tld_snapshot(const char* path, tld_snapshot_t** snapshot_out) {
+    if (!path || !snapshot_out) return -1;
+    *snapshot_out = NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(tld_snapshot_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        dlog("Snapshot: mmap of %s failed", path);
+        return -1;
+    }
+
+    tld_snapshot_t* snap = calloc(1, sizeof(tld_snapshot_t));
+    if (!snap) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    snap->map = map;
+    snap->map_size = (size_t)st.st_size;
+    snap->header = (const tld_snapshot_header_t*)map;
+    snap->tlds = (const tld_snapshot_tld_t*)((const char*)map + snap->header->tld_table_offset);
+
+    if (validate_snapshot(snap) != 0) {
+        dlog("Snapshot: %s is invalid or corrupt", path);
+        close_tld_snapshot(snap);
+        return -1;
+    }
+
+    const tld_snapshot_header_t* h = snap->header;
+    const char* base = (const char*)map;
+    snap->views = calloc(h->tld_count ? h->tld_count : 1, sizeof(tld_snapshot_view_t));
+    if (!snap->views) {
+        close_tld_snapshot(snap);
+        return -1;
+    }
+    for (uint32_t i = 0; i < h->tld_count; ++i) {
+        const tld_snapshot_tld_t* t = &snap->tlds[i];
+        tld_snapshot_view_t* v = &snap->views[i];
+        v->strings = base + h->string_table_offset;
+        v->records = (const tld_snapshot_record_t*)(base + h->record_table_offset) + t->first_record;
+        v->index = (const uint32_t*)(base + h->index_offset) + t->first_index_slot;
+        v->index_slots = t->index_slots;
+        v->record_count = (size_t)t->record_count;
+    }
+
+    // Hint sequential readahead for the index and record tables
+    madvise(map, snap->map_size, MADV_WILLNEED);
+
+    *snapshot_out = snap;
+    return 0;
+}
+
+void close_tld_snapshot(tld_snapshot_t* snapshot) {
+    if (!snapshot) return;
+    free(snapshot->views);
+    if (snapshot->map) munmap(snapshot->map, snapshot->map_size);
+    free(snapshot);
+}
+
+uint64_t tld_snapshot_sequence(const tld_snapshot_t* snapshot) {
+    return snapshot ? snapshot->header->sequence : 0;
+}
+
+int load_tld_snapshot_into_manager(tld_snapshot_t* snapshot, tld_manager_t* manager) {
+    if (!snapshot || !manager) return -1;
+    if (manager->snapshot || manager->tld_count != 0) {
+        dlog("Snapshot: manager must be empty before loading a snapshot");
+        return -1;
+    }
+
+    const tld_snapshot_header_t* h = snapshot->header;
+    const char* strings = (const char*)snapshot->map + h->string_table_offset;
+    const tld_merkle_t* merkles = (const tld_merkle_t*)((const char*)snapshot->map + h->merkle_offset);
+
+    // Owned from here on, so a failure below can unmap it with the TLDs
+    manager->snapshot = snapshot;
+    for (uint32_t i = 0; i < h->tld_count; ++i) {
+        const tld_snapshot_tld_t* t = &snapshot->tlds[i];
+        tld_t* tld = register_new_tld(manager, strings + t->name_offset);
+        if (tld) {
+            tld->base = &snapshot->views[i];
+            tld->base_tombstones = calloc((t->record_count + 7) / 8 + 1, 1);
+        }
+        if (!tld || !tld->base_tombstones) {
+            log_error("Snapshot: failed to load TLD %u of %u", i + 1, h->tld_count);
+            clear_tld_manager(manager);
+            return -1;
+        }
+        if (tld->merkle) memcpy(tld->merkle, &merkles[i], sizeof(tld_merkle_t));
+        tld->created_at = (time_t)t->created_at;
+        tld->last_modified = (time_t)t->last_modified;
+    }
+
+    dlog("Snapshot: loaded %u TLDs, %llu records (sequence %llu)", h->tld_count,
+         (unsigned long long)h->record_count, (unsigned long long)h->sequence);
+    return 0;
+}
+
+// --- Writing ---
+
+typedef struct {
+    const char* key;
+    uint32_t offset;
+} intern_slot_t;
+
+typedef struct {
+    intern_slot_t* slots;
+    size_t slot_count;
+    size_t used;
+    uint64_t size;              // Bytes of string table assigned so far
+    const char** order;         // Strings in offset order, for writing
+    size_t order_count;
+    size_t order_capacity;
+} string_interner_t;
+
+static int interner_grow(string_interner_t* in) {
+    size_t new_count = in->slot_count ? in->slot_count * 2 : 1024;
+    intern_slot_t* slots = calloc(new_count, sizeof(intern_slot_t));
+    if (!slots) return -1;
+    for (size_t i = 0; i < in->slot_count; ++i) {
+        if (!in->slots[i].key) continue;
+        size_t s = hash_name(in->slots[i].key) & (new_count - 1);
+        while (slots[s].key) s = (s + 1) & (new_count - 1);
+        slots[s] = in->slots[i];
+    }
+    free(in->slots);
+    in->slots = slots;
+    in->slot_count = new_count;
+    return 0;
+}
+
+static int intern_string(string_interner_t* in, const char* str, uint32_t* offset_out) {
+    if ((in->used + 1) * 2 > in->slot_count && interner_grow(in) != 0) return -1;
+
+    size_t s = hash_name(str) & (in->slot_count - 1);
+    while (in->slots[s].key) {
+        if (strcmp(in->slots[s].key, str) == 0) {
+            *offset_out = in->slots[s].offset;
+            return 0;
+        }
+        s = (s + 1) & (in->slot_count - 1);
+    }
+
+    size_t len = strlen(str) + 1;
+    if (in->size + len > UINT32_MAX) return -1;
+
+    if (in->order_count == in->order_capacity) {
+        size_t cap = in->order_capacity ? in->order_capacity * 2 : 1024;
+        const char** grown = realloc(in->order, cap * sizeof(char*));
+        if (!grown) return -1;
+        in->order = grown;
+        in->order_capacity = cap;
+    }
+    in->order[in->order_count++] = str;
+
+    in->slots[s].key = str;
+    in->slots[s].offset = (uint32_t)in->size;
+    in->used++;
+    *offset_out = (uint32_t)in->size;
+    in->size += len;
+    return 0;
+}
+
+typedef struct {
+    dns_record_t* items;        // Borrowed views of base + delta records
+    size_t count;
+    size_t capacity;
+} record_list_t;
+
+static int gather_record(void* arg, const dns_record_t* rec) {
+    record_list_t* list = arg;
+    if (list->count == list->capacity) {
+        size_t cap = list->capacity ? list->capacity * 2 : 64;
+        dns_record_t* grown = realloc(list->items, cap * sizeof(dns_record_t));
+        if (!grown) return -1;
+        list->items = grown;
+        list->capacity = cap;
+    }
+    list->items[list->count++] = *rec;
+    return 0;
+}
+
+// Sort key: name, then type, then original position (keeps the sort stable,
+// so "first match" semantics survive a snapshot round trip)
+typedef struct {
+    const dns_record_t* rec;
+    size_t position;
+} sort_entry_t;
+
+static int compare_sort_entries(const void* a, const void* b) {
+    const sort_entry_t* x = a;
+    const sort_entry_t* y = b;
+    int cmp = strcmp(x->rec->name, y->rec->name);
+    if (cmp != 0) return cmp;
+    if (x->rec->type != y->rec->type) return x->rec->type < y->rec->type ? -1 : 1;
+    return x->position < y->position ? -1 : (x->position > y->position);
+}
+
+static uint32_t index_slots_for(size_t record_count) {
+    if (record_count == 0) return 0;
+    uint32_t slots = 4;
+    while (slots < record_count * 2) slots <<= 1;
+    return slots;
+}
+
+static int write_all(FILE* f, const void* data, size_t len) {
+    return fwrite(data, 1, len, f) == len ? 0 : -1;
+}
+
+// Body sections also feed the running body checksum
+static int write_body(FILE* f, uint32_t* crc, const void* data, size_t len) {
+    *crc = crc32_update(*crc, data, len);
+    return write_all(f, data, len);
+}
+
+static int write_padding(FILE* f, uint32_t* crc, uint64_t from, uint64_t to) {
+    static const uint8_t zeros[8] = {0};
+    return to > from ? write_body(f, crc, zeros, (size_t)(to - from)) : 0;
+}
+
+int write_tld_snapshot(tld_manager_t* manager, const char* path, uint64_t sequence) {
+    if (!manager || !path) return -1;
+
+    char tmp_path[1024];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) return -1;
+
+    pthread_rwlock_rdlock(&manager->lock);
+
+    size_t tld_count = manager->tld_count;
+    tld_snapshot_tld_t* tld_table = calloc(tld_count ? tld_count : 1, sizeof(tld_snapshot_tld_t));
+    sort_entry_t** sorted = calloc(tld_count ? tld_count : 1, sizeof(sort_entry_t*));
+    record_list_t* lists = calloc(tld_count ? tld_count : 1, sizeof(record_list_t));
+    string_interner_t strings = {0};
+    FILE* f = NULL;
+    uint32_t body_crc = 0;
+    int result = -1;
+
+    if (!tld_table || !sorted || !lists) goto done;
+
+    // Pass 1: gather, sort and intern; compute the layout
+    uint64_t total_records = 0;
+    uint64_t total_slots = 0;
+    for (size_t i = 0; i < tld_count; ++i) {
+        tld_t* tld = manager->tlds[i];
+        if (tld_for_each_record(tld, gather_record, &lists[i]) != 0) goto done;
+
+        sorted[i] = malloc((lists[i].count ? lists[i].count : 1) * sizeof(sort_entry_t));
+        if (!sorted[i]) goto done;
+        for (size_t r = 0; r < lists[i].count; ++r) {
+            sorted[i][r].rec = &lists[i].items[r];
+            sorted[i][r].position = r;
+        }
+        qsort(sorted[i], lists[i].count, sizeof(sort_entry_t), compare_sort_entries);
+
+        tld_snapshot_tld_t* t = &tld_table[i];
+        if (intern_string(&strings, tld->name, &t->name_offset) != 0) goto done;
+        t->created_at = (int64_t)tld->created_at;
+        t->last_modified = (int64_t)tld->last_modified;
+        t->first_record = total_records;
+        t->record_count = lists[i].count;
+        t->first_index_slot = total_slots;
+        t->index_slots = index_slots_for(lists[i].count);
+        total_records += lists[i].count;
+        total_slots += t->index_slots;
+    }
+
+    tld_snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TLD_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = TLD_SNAPSHOT_VERSION;
+    header.tld_count = (uint32_t)tld_count;
+    header.record_count = total_records;
+    header.sequence = sequence;
+    header.tld_table_offset = ALIGN8(sizeof(header));
+    header.record_table_offset = ALIGN8(header.tld_table_offset + tld_count * sizeof(tld_snapshot_tld_t));
+    header.index_offset = ALIGN8(header.record_table_offset + total_records * sizeof(tld_snapshot_record_t));
+    header.index_slot_count = total_slots;
+    header.merkle_offset = ALIGN8(header.index_offset + total_slots * sizeof(uint32_t));
+    header.string_table_offset = header.merkle_offset + tld_count * sizeof(tld_merkle_t);
+
+    f = fopen(tmp_path, "wb");
+    if (!f) {
+        dlog("Snapshot: cannot create %s", tmp_path);
+        goto done;
+    }
+
+    // Header is rewritten at the end once the string table size is known
+    if (write_all(f, &header, sizeof(header)) != 0) goto done;
+    if (write_padding(f, &body_crc, sizeof(header), header.tld_table_offset) != 0) goto done;
+    if (tld_count && write_body(f, &body_crc, tld_table, tld_count * sizeof(tld_snapshot_tld_t)) != 0) goto done;
+    if (write_padding(f, &body_crc, header.tld_table_offset + tld_count * sizeof(tld_snapshot_tld_t), header.record_table_offset) != 0) goto done;
+
+    // Records
+    for (size_t i = 0; i < tld_count; ++i) {
+        for (size_t r = 0; r < lists[i].count; ++r) {
+            const dns_record_t* rec = sorted[i][r].rec;
+            tld_snapshot_record_t out;
+            if (intern_string(&strings, rec->name, &out.name_offset) != 0 ||
+                intern_string(&strings, rec->rdata, &out.rdata_offset) != 0) goto done;
+            out.type = (uint32_t)rec->type;
+            out.ttl = rec->ttl;
+            out.last_updated = (int64_t)rec->last_updated;
+            if (write_body(f, &body_crc, &out, sizeof(out)) != 0) goto done;
+        }
+    }
+    if (write_padding(f, &body_crc, header.record_table_offset + total_records * sizeof(tld_snapshot_record_t), header.index_offset) != 0) goto done;
+
+    // Name index: first position of each distinct name
+    for (size_t i = 0; i < tld_count; ++i) {
+        uint32_t slots = tld_table[i].index_slots;
+        if (slots == 0) continue;
+        uint32_t* index = calloc(slots, sizeof(uint32_t));
+        if (!index) goto done;
+        for (size_t r = 0; r < lists[i].count; ++r) {
+            const char* name = sorted[i][r].rec->name;
+            if (r > 0 && strcmp(sorted[i][r - 1].rec->name, name) == 0) continue;
+            uint32_t s = hash_name(name) & (slots - 1);
+            while (index[s]) s = (s + 1) & (slots - 1);
+            index[s] = (uint32_t)r + 1;
+        }
+        int wr = write_body(f, &body_crc, index, slots * sizeof(uint32_t));
+        free(index);
+        if (wr != 0) goto done;
+    }
+    if (write_padding(f, &body_crc, header.index_offset + total_slots * sizeof(uint32_t), header.merkle_offset) != 0) goto done;
+
+    // Merkle summaries
+    for (size_t i = 0; i < tld_count; ++i) {
+        tld_merkle_t empty;
+        const tld_merkle_t* m = manager->tlds[i]->merkle;
+        if (!m) {
+            memset(&empty, 0, sizeof(empty));
+            m = &empty;
+        }
+        if (write_body(f, &body_crc, m, sizeof(tld_merkle_t)) != 0) goto done;
+    }
+
+    // String table
+    for (size_t s = 0; s < strings.order_count; ++s) {
+        if (write_body(f, &body_crc, strings.order[s], strlen(strings.order[s]) + 1) != 0) goto done;
+    }
+    if (strings.size == 0 && write_body(f, &body_crc, "", 1) != 0) goto done;
+
+    header.string_table_size = strings.size ? strings.size : 1;
+    header.file_size = header.string_table_offset + header.string_table_size;
+    header.body_checksum = body_crc;
+    header.header_checksum = header_checksum(&header);
+    if (fseek(f, 0, SEEK_SET) != 0 || write_all(f, &header, sizeof(header)) != 0) goto done;
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) goto done;
+    if (fclose(f) != 0) {
+        f = NULL;
+        goto done;
+    }
+    f = NULL;
+
+    if (rename(tmp_path, path) != 0) {
+        dlog("Snapshot: failed to rename %s to %s", tmp_path, path);
+        goto done;
+    }
+    result = 0;
+    dlog("Snapshot: wrote %zu TLDs, %llu records to %s", tld_count, (unsigned long long)total_records, path);
+
+done:
+    pthread_rwlock_unlock(&manager->lock);
+    if (f) {
+        fclose(f);
+        unlink(tmp_path);
+    } else if (result != 0) {
+        unlink(tmp_path);
+    }
+    for (size_t i = 0; lists && sorted && i < tld_count; ++i) {
+        free(lists[i].items);
+        free(sorted[i]);
+    }
+    free(lists);
+    free(sorted);
+    free(tld_table);
+    free(strings.slots);
+    free(strings.order);
+    return result;
+}
@@ -0,0 +1,669 @@
+#include "../include/tld_sync.h"
+#include "../include/tld_manager.h"
+#include "../include/tld_merkle.h"
+#include "../include/tld_journal.h"
+#include "../include/debug.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// --- Packet framing ---
+
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    size_t capacity;
+} sync_buffer_t;
+
+// Wrap payload in a NEXUS packet and append it to buf
+static int append_packet(sync_buffer_t* buf, nexus_packet_type_t type, uint8_t* payload, size_t payload_len) {
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.version = 1;
+    packet.type = type;
+    packet.data = payload;
+    packet.data_len = (uint32_t)payload_len;
+
+    ssize_t size = get_serialized_nexus_packet_size(&packet);
+    if (size < 0) return -1;
+    size_t needed = (size_t)size;
+    if (buf->len + needed > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (capacity < buf->len + needed) capacity *= 2;
+        uint8_t* grown = realloc(buf->data, capacity);
+        if (!grown) return -1;
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    ssize_t written = serialize_nexus_packet(&packet, buf->data + buf->len, buf->capacity - buf->len);
+    if (written < 0) return -1;
+    buf->len += (size_t)written;
+    return 0;
+}
+
+// Caller holds manager->lock (find_tld_by_name takes it itself)
+static tld_t* find_tld_locked(tld_manager_t* manager, const char* tld_name) {
+    for (size_t i = 0; i < manager->tld_count; ++i) {
+        if (manager->tlds[i] && strcmp(manager->tlds[i]->name, tld_name) == 0) return manager->tlds[i];
+    }
+    return NULL;
+}
+
+// --- Server side ---
+
+static int handle_merkle_request(tld_manager_t* manager, const nexus_packet_t* request, sync_buffer_t* out) {
+    payload_tld_merkle_req_t req;
+    if (deserialize_payload_tld_merkle_req(request->data, request->data_len, &req) < 0) return -1;
+
+    int rc = -1;
+    payload_tld_merkle_resp_t resp;
+    memset(&resp, 0, sizeof(resp));
+    memcpy(resp.tld_name, req.tld_name, sizeof(resp.tld_name));
+    resp.level = req.level;
+    if (req.level > TLD_MERKLE_DEPTH) goto done;
+    for (uint16_t i = 0; i < req.count; i++) {
+        if (req.indices[i] >= (1u << req.level)) goto done;
+    }
+
+    resp.hashes = req.count ? malloc((size_t)req.count * TLD_MERKLE_HASH_LEN) : NULL;
+    if (req.count && !resp.hashes) goto done;
+
+    pthread_rwlock_rdlock(&manager->lock);
+    tld_t* tld = find_tld_locked(manager, req.tld_name);
+    if (!tld || !tld->merkle) {
+        resp.status = NEXUS_TLD_SYNC_STATUS_UNKNOWN_TLD;
+    } else {
+        resp.count = req.count;
+        for (uint16_t i = 0; i < req.count; i++) {
+            tld_merkle_get_node(tld->merkle, req.level, req.indices[i], resp.hashes[i]);
+        }
+    }
+    pthread_rwlock_unlock(&manager->lock);
+
+    ssize_t size = get_serialized_payload_tld_merkle_resp_size(&resp);
+    uint8_t* payload = size > 0 ? malloc((size_t)size) : NULL;
+    ssize_t payload_len = payload ? serialize_payload_tld_merkle_resp(&resp, payload, (size_t)size) : -1;
+    rc = payload_len < 0 ? -1 : append_packet(out, PACKET_TYPE_TLD_MERKLE_RESP, payload, (size_t)payload_len);
+    free(payload);
+
+done:
+    free_payload_tld_merkle_resp(&resp);
+    free_payload_tld_merkle_req(&req);
+    return rc;
+}
+
+static int handle_bucket_request(tld_manager_t* manager, const nexus_packet_t* request, sync_buffer_t* out) {
+    payload_tld_bucket_req_t req;
+    if (deserialize_payload_tld_bucket_req(request->data, request->data_len, &req) < 0) return -1;
+
+    int rc = -1;
+    payload_tld_bucket_resp_t resp;
+    memset(&resp, 0, sizeof(resp));
+    memcpy(resp.tld_name, req.tld_name, sizeof(resp.tld_name));
+    for (uint16_t i = 0; i < req.count; i++) {
+        if (req.buckets[i] >= TLD_MERKLE_LEAVES) {
+            free_payload_tld_bucket_req(&req);
+            return -1;
+        }
+    }
+
+    int ok = 1;
+    pthread_rwlock_rdlock(&manager->lock);
+    tld_t* tld = find_tld_locked(manager, req.tld_name);
+    if (!tld) {
+        resp.status = NEXUS_TLD_SYNC_STATUS_UNKNOWN_TLD;
+    } else {
+        // The response echoes the buckets it covers, so the requester can
+        // tell an emptied bucket from one that was never answered
+        resp.buckets = req.buckets;
+        resp.bucket_count = req.count;
+        for (uint16_t i = 0; ok && i < req.count; i++) {
+            dns_record_t* records = NULL;
+            size_t count = 0;
+            if (collect_tld_bucket_records(tld, req.buckets[i], &records, &count) != 0) {
+                ok = 0;
+                break;
+            }
+            if (count > 0) {
+                dns_record_t* grown = realloc(resp.records, (resp.record_count + count) * sizeof(dns_record_t));
+                if (!grown) {
+                    free_tld_bucket_records(records, count);
+                    ok = 0;
+                    break;
+                }
+                resp.records = grown;
+                // Take the strings over, then free only the array
+                memcpy(&resp.records[resp.record_count], records, count * sizeof(dns_record_t));
+                resp.record_count += (uint32_t)count;
+            }
+            free(records);
+        }
+    }
+    pthread_rwlock_unlock(&manager->lock);
+
+    if (ok) {
+        ssize_t size = get_serialized_payload_tld_bucket_resp_size(&resp);
+        uint8_t* payload = size > 0 ? malloc((size_t)size) : NULL;
+        ssize_t payload_len = payload ? serialize_payload_tld_bucket_resp(&resp, payload, (size_t)size) : -1;
+        rc = payload_len < 0 ? -1 : append_packet(out, PACKET_TYPE_TLD_BUCKET_RESP, payload, (size_t)payload_len);
+        free(payload);
+    }
+
+    resp.buckets = NULL;            // Still owned by req
+    free_payload_tld_bucket_resp(&resp);
+    free_payload_tld_bucket_req(&req);
+    return rc;
+}
+
+// Without a journal, or for a cursor it cannot serve (compacted, or ahead of
+// it after the journal was lost), the answer is COMPACTED: walk the trees.
+static int handle_journal_request(tld_journal_t* journal, const nexus_packet_t* request, sync_buffer_t* out) {
+    payload_tld_journal_req_t req;
+    if (deserialize_payload_tld_journal_req(request->data, request->data_len, &req) < 0) return -1;
+
+    payload_tld_journal_resp_t resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.status = NEXUS_TLD_SYNC_STATUS_COMPACTED;
+    if (journal) {
+        resp.last_sequence = tld_journal_durable_sequence(journal);
+        size_t max_entries = req.max_entries < NEXUS_TLD_JOURNAL_MAX_ENTRIES ? req.max_entries : NEXUS_TLD_JOURNAL_MAX_ENTRIES;
+        uint8_t* data = NULL;
+        size_t len = 0, count = 0;
+        if (req.since_sequence > resp.last_sequence) {
+            // Cursor from before the journal was lost
+        } else if (max_entries == 0) {
+            resp.status = NEXUS_TLD_SYNC_STATUS_OK;         // Probe for last_sequence only
+        } else if (tld_journal_export_since(journal, req.since_sequence, max_entries, &data, &len, &count) == 0) {
+            if (len <= NEXUS_TLD_JOURNAL_MAX_BYTES) {
+                resp.status = NEXUS_TLD_SYNC_STATUS_OK;
+                resp.entry_count = (uint32_t)count;
+                resp.data_len = (uint32_t)len;
+                resp.data = data;
+                data = NULL;
+            }
+            free(data);
+        }
+    }
+
+    ssize_t size = get_serialized_payload_tld_journal_resp_size(&resp);
+    uint8_t* payload = size > 0 ? malloc((size_t)size) : NULL;
+    ssize_t payload_len = payload ? serialize_payload_tld_journal_resp(&resp, payload, (size_t)size) : -1;
+    int rc = payload_len < 0 ? -1 : append_packet(out, PACKET_TYPE_TLD_JOURNAL_RESP, payload, (size_t)payload_len);
+    free(payload);
+    free_payload_tld_journal_resp(&resp);
+    return rc;
+}
+
+int tld_sync_handle_packet(tld_manager_t* manager, tld_journal_t* journal, const nexus_packet_t* request,
+                           uint8_t** response_out, size_t* response_len_out) {
+    if (!manager || !request || !response_out || !response_len_out) return -1;
+
+    sync_buffer_t out = {0};
+    int rc;
+    switch (request->type) {
+        case PACKET_TYPE_TLD_MERKLE_REQ:
+            rc = handle_merkle_request(manager, request, &out);
+            break;
+        case PACKET_TYPE_TLD_BUCKET_REQ:
+            rc = handle_bucket_request(manager, request, &out);
+            break;
+        case PACKET_TYPE_TLD_JOURNAL_REQ:
+            rc = handle_journal_request(journal, request, &out);
+            break;
+        default:
+            rc = -1;
+            break;
+    }
+    if (rc != 0) {
+        free(out.data);
+        return -1;
+    }
+    *response_out = out.data;
+    *response_len_out = out.len;
+    return 0;
+}
+
+// --- Client side ---
+
+typedef struct {
+    tld_sync_peer_t* peer;
+    const char* tld_name;
+    tld_sync_status_t status;       // Why a fetch failed
+    uint8_t remote_root[TLD_MERKLE_HASH_LEN];
+} merkle_fetch_ctx_t;
+
+// Exchange request and return the first packet of the response
+static int exchange_one(tld_sync_peer_t* peer, sync_buffer_t* request, nexus_packet_type_t expected, nexus_packet_t* packet) {
+    uint8_t* response = NULL;
+    ssize_t response_len = peer->exchange(peer->ctx, request->data, request->len, &response);
+    memset(packet, 0, sizeof(*packet));
+    int rc = (response_len > 0 && deserialize_nexus_packet(response, (size_t)response_len, packet) > 0 &&
+              packet->type == expected) ? 0 : -1;
+    free(response);
+    if (rc != 0) {
+        free(packet->data);
+        packet->data = NULL;
+    }
+    return rc;
+}
+
+// tld_merkle_fetch_fn: one TLD_MERKLE_REQ round trip per level
+static int fetch_remote_nodes(void* arg, uint32_t level, const uint32_t* indices, size_t count,
+                              uint8_t (*hashes_out)[TLD_MERKLE_HASH_LEN]) {
+    merkle_fetch_ctx_t* ctx = arg;
+    if (count > NEXUS_TLD_SYNC_MAX_NODES) return -1;
+
+    payload_tld_merkle_req_t req;
+    memset(&req, 0, sizeof(req));
+    strncpy(req.tld_name, ctx->tld_name, sizeof(req.tld_name) - 1);
+    req.level = (uint8_t)level;
+    req.count = (uint16_t)count;
+    req.indices = (uint32_t*)indices;
+
+    sync_buffer_t request = {0};
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    ssize_t size = get_serialized_payload_tld_merkle_req_size(&req);
+    uint8_t* payload = size > 0 ? malloc((size_t)size) : NULL;
+    ssize_t payload_len = payload ? serialize_payload_tld_merkle_req(&req, payload, (size_t)size) : -1;
+    int rc = -1;
+    ctx->status = TLD_SYNC_UNREACHABLE;
+    if (payload_len >= 0 &&
+        append_packet(&request, PACKET_TYPE_TLD_MERKLE_REQ, payload, (size_t)payload_len) == 0 &&
+        exchange_one(ctx->peer, &request, PACKET_TYPE_TLD_MERKLE_RESP, &packet) == 0) {
+        payload_tld_merkle_resp_t resp;
+        ctx->status = TLD_SYNC_FAILED;
+        if (deserialize_payload_tld_merkle_resp(packet.data, packet.data_len, &resp) >= 0) {
+            if (resp.status == NEXUS_TLD_SYNC_STATUS_UNKNOWN_TLD) {
+                ctx->status = TLD_SYNC_UNKNOWN_TLD;
+            } else if (resp.status == NEXUS_TLD_SYNC_STATUS_OK && resp.level == level && resp.count == count &&
+                       strcmp(resp.tld_name, req.tld_name) == 0) {
+                memcpy(hashes_out, resp.hashes, count * TLD_MERKLE_HASH_LEN);
+                if (level == 0) memcpy(ctx->remote_root, resp.hashes[0], TLD_MERKLE_HASH_LEN);
+                rc = 0;
+            }
+            free_payload_tld_merkle_resp(&resp);
+        }
+    }
+    free(packet.data);
+    free(request.data);
+    free(payload);
+    return rc;
+}
+
+// Fetch the records of every divergent bucket with pipelined requests.
+// Responses are returned in request order, one per chunk of buckets.
+static tld_sync_status_t fetch_buckets(tld_sync_peer_t* peer, const char* tld_name, const uint32_t* buckets,
+                                       size_t bucket_count, payload_tld_bucket_resp_t* responses, size_t* response_count) {
+    sync_buffer_t request = {0};
+    size_t chunks = 0;
+    for (size_t start = 0; start < bucket_count; start += TLD_SYNC_BUCKETS_PER_REQ) {
+        payload_tld_bucket_req_t req;
+        memset(&req, 0, sizeof(req));
+        strncpy(req.tld_name, tld_name, sizeof(req.tld_name) - 1);
+        req.count = (uint16_t)(bucket_count - start < TLD_SYNC_BUCKETS_PER_REQ ? bucket_count - start : TLD_SYNC_BUCKETS_PER_REQ);
+        req.buckets = (uint32_t*)&buckets[start];
+
+        uint8_t payload[64 + 2 + TLD_SYNC_BUCKETS_PER_REQ * 4];
+        ssize_t payload_len = serialize_payload_tld_bucket_req(&req, payload, sizeof(payload));
+        if (payload_len < 0 || append_packet(&request, PACKET_TYPE_TLD_BUCKET_REQ, payload, (size_t)payload_len) != 0) {
+            free(request.data);
+            return TLD_SYNC_FAILED;
+        }
+        chunks++;
+    }
+
+    uint8_t* response = NULL;
+    ssize_t response_len = peer->exchange(peer->ctx, request.data, request.len, &response);
+    free(request.data);
+    if (response_len <= 0) {
+        free(response);
+        return TLD_SYNC_UNREACHABLE;
+    }
+
+    tld_sync_status_t status = TLD_SYNC_RECONCILED;
+    size_t offset = 0;
+    *response_count = 0;
+    for (size_t chunk = 0; chunk < chunks && status == TLD_SYNC_RECONCILED; chunk++) {
+        nexus_packet_t packet;
+        memset(&packet, 0, sizeof(packet));
+        ssize_t consumed = offset < (size_t)response_len
+            ? deserialize_nexus_packet(response + offset, (size_t)response_len - offset, &packet) : -1;
+        if (consumed <= 0) {
+            status = TLD_SYNC_UNREACHABLE;
+            break;
+        }
+        offset += (size_t)consumed;
+
+        payload_tld_bucket_resp_t* resp = &responses[chunk];
+        if (packet.type != PACKET_TYPE_TLD_BUCKET_RESP ||
+            deserialize_payload_tld_bucket_resp(packet.data, packet.data_len, resp) < 0) {
+            status = TLD_SYNC_FAILED;
+        } else {
+            *response_count = chunk + 1;
+            const uint32_t* expected = &buckets[chunk * TLD_SYNC_BUCKETS_PER_REQ];
+            size_t expected_count = bucket_count - chunk * TLD_SYNC_BUCKETS_PER_REQ;
+            if (expected_count > TLD_SYNC_BUCKETS_PER_REQ) expected_count = TLD_SYNC_BUCKETS_PER_REQ;
+            if (resp->status == NEXUS_TLD_SYNC_STATUS_UNKNOWN_TLD) {
+                status = TLD_SYNC_UNKNOWN_TLD;
+            } else if (resp->status != NEXUS_TLD_SYNC_STATUS_OK || resp->bucket_count != expected_count ||
+                       memcmp(resp->buckets, expected, expected_count * sizeof(uint32_t)) != 0) {
+                status = TLD_SYNC_FAILED;
+            }
+        }
+        free(packet.data);
+    }
+    free(response);
+    return status;
+}
+
+// Apply one bucket response under the write lock. Records of other buckets
+// in the same response are skipped by reconcile_tld_bucket's bucket check
+// and by the per-bucket split here.
+static int apply_bucket_response(tld_t* tld, const payload_tld_bucket_resp_t* resp, size_t* reconciled) {
+    dns_record_t* bucket_records = resp->record_count ? malloc(resp->record_count * sizeof(dns_record_t)) : NULL;
+    if (resp->record_count && !bucket_records) return -1;
+
+    int rc = 0;
+    for (uint16_t b = 0; b < resp->bucket_count && rc == 0; b++) {
+        size_t count = 0;
+        for (uint32_t i = 0; i < resp->record_count; i++) {
+            if (tld_merkle_bucket_for_name(resp->records[i].name) == resp->buckets[b]) {
+                bucket_records[count++] = resp->records[i];
+            }
+        }
+        rc = reconcile_tld_bucket(tld, resp->buckets[b], bucket_records, count);
+        if (rc == 0) (*reconciled)++;
+    }
+    free(bucket_records);
+    return rc;
+}
+
+static tld_sync_status_t pull_tld_locked(tld_sync_t* sync, tld_sync_peer_t* peer, const char* tld_name, size_t* reconciled) {
+    tld_manager_t* manager = sync->manager;
+    *reconciled = 0;
+
+    // Walk against a copy so the manager is not locked across round trips
+    tld_merkle_t* local = malloc(sizeof(tld_merkle_t));
+    if (!local) return TLD_SYNC_FAILED;
+    pthread_rwlock_rdlock(&manager->lock);
+    tld_t* tld = find_tld_locked(manager, tld_name);
+    if (tld && tld->merkle) memcpy(local, tld->merkle, sizeof(tld_merkle_t));
+    pthread_rwlock_unlock(&manager->lock);
+    if (!tld) {
+        free(local);
+        return TLD_SYNC_UNKNOWN_TLD;
+    }
+
+    merkle_fetch_ctx_t fetch = { .peer = peer, .tld_name = tld_name, .status = TLD_SYNC_FAILED };
+    uint32_t* buckets = NULL;
+    size_t bucket_count = 0;
+    int walked = tld_merkle_find_divergent_buckets(local, fetch_remote_nodes, &fetch, &buckets, &bucket_count);
+    free(local);
+    if (walked != 0) return fetch.status;
+    if (bucket_count == 0) return TLD_SYNC_IN_SYNC;
+
+    size_t chunks = (bucket_count + TLD_SYNC_BUCKETS_PER_REQ - 1) / TLD_SYNC_BUCKETS_PER_REQ;
+    payload_tld_bucket_resp_t* responses = calloc(chunks, sizeof(payload_tld_bucket_resp_t));
+    size_t response_count = 0;
+    tld_sync_status_t status = responses
+        ? fetch_buckets(peer, tld_name, buckets, bucket_count, responses, &response_count)
+        : TLD_SYNC_FAILED;
+    free(buckets);
+
+    if (status == TLD_SYNC_RECONCILED) {
+        uint8_t root[TLD_MERKLE_HASH_LEN];
+        pthread_rwlock_wrlock(&manager->lock);
+        tld = find_tld_locked(manager, tld_name);
+        for (size_t i = 0; tld && i < response_count && status == TLD_SYNC_RECONCILED; i++) {
+            if (apply_bucket_response(tld, &responses[i], reconciled) != 0) status = TLD_SYNC_FAILED;
+        }
+        if (!tld) status = TLD_SYNC_UNKNOWN_TLD;
+        int matches = tld && tld_merkle_get_root(tld->merkle, root) == 0 &&
+                      memcmp(root, fetch.remote_root, TLD_MERKLE_HASH_LEN) == 0;
+        pthread_rwlock_unlock(&manager->lock);
+
+        // Either side may have changed since the walk; the next round converges
+        if (status == TLD_SYNC_RECONCILED && !matches) {
+            dlog("TLD sync: '%s' still differs from peer '%s' after reconciling %zu buckets",
+                 tld_name, peer->name, *reconciled);
+        }
+    }
+
+    for (size_t i = 0; i < response_count; i++) free_payload_tld_bucket_resp(&responses[i]);
+    free(responses);
+    if (status == TLD_SYNC_FAILED) {
+        log_error("TLD sync: failed to reconcile '%s' with peer '%s'", tld_name, peer->name);
+    }
+    return status;
+}
+
+// One TLD_JOURNAL_REQ round trip. max_entries 0 only asks for the peer's
+// last sequence. Returns the packet status, or -1 if the exchange failed.
+static int fetch_journal(tld_sync_peer_t* peer, uint64_t since, uint32_t max_entries, payload_tld_journal_resp_t* resp) {
+    payload_tld_journal_req_t req = { .since_sequence = since, .max_entries = max_entries };
+    uint8_t payload[16];
+    ssize_t payload_len = serialize_payload_tld_journal_req(&req, payload, sizeof(payload));
+
+    sync_buffer_t request = {0};
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    memset(resp, 0, sizeof(*resp));
+    int rc = -1;
+    if (payload_len >= 0 &&
+        append_packet(&request, PACKET_TYPE_TLD_JOURNAL_REQ, payload, (size_t)payload_len) == 0 &&
+        exchange_one(peer, &request, PACKET_TYPE_TLD_JOURNAL_RESP, &packet) == 0 &&
+        deserialize_payload_tld_journal_resp(packet.data, packet.data_len, resp) >= 0) {
+        rc = resp->status;
+    }
+    free(packet.data);
+    free(request.data);
+    return rc;
+}
+
+typedef struct {
+    tld_manager_t* manager;
+    tld_sync_peer_t* peer;
+    size_t applied;
+    size_t seen;
+    int failed;
+} journal_apply_ctx_t;
+
+static int apply_peer_entry(void* arg, const tld_journal_entry_t* entry) {
+    journal_apply_ctx_t* ctx = arg;
+    if (entry->sequence <= ctx->peer->journal_seq) return -1;      // Out of order
+
+    int rc = apply_tld_journal_entry(ctx->manager, entry);
+    // Entries for TLDs this node does not carry are not ours to apply
+    if (rc < 0 && (entry->type == TLD_MUTATION_REGISTER || find_tld_by_name(ctx->manager, entry->tld_name))) {
+        ctx->failed = 1;
+        return -1;
+    }
+    if (rc == 0) ctx->applied++;
+    ctx->seen++;
+    ctx->peer->journal_seq = entry->sequence;
+    return 0;
+}
+
+// Apply the peer's journal entries after peer->journal_seq. A peer that can
+// no longer serve them (or a failed apply) clears has_journal_cursor, and
+// the caller falls back to the Merkle walk.
+static tld_sync_status_t pull_journal_locked(tld_sync_t* sync, tld_sync_peer_t* peer, size_t* applied) {
+    journal_apply_ctx_t ctx = { .manager = sync->manager, .peer = peer };
+    tld_sync_status_t status = TLD_SYNC_IN_SYNC;
+
+    for (;;) {
+        payload_tld_journal_resp_t resp;
+        int rc = fetch_journal(peer, peer->journal_seq, TLD_SYNC_JOURNAL_ENTRIES_PER_REQ, &resp);
+        if (rc != NEXUS_TLD_SYNC_STATUS_OK) {
+            free_payload_tld_journal_resp(&resp);
+            if (rc < 0) return TLD_SYNC_UNREACHABLE;
+            peer->has_journal_cursor = 0;
+            break;
+        }
+
+        size_t seen_before = ctx.seen;
+        int decoded = tld_journal_decode_entries(resp.data, resp.data_len, apply_peer_entry, &ctx);
+        uint32_t entry_count = resp.entry_count;
+        free_payload_tld_journal_resp(&resp);
+        if (decoded != 0 || ctx.seen - seen_before != entry_count) {
+            log_error("TLD sync: bad journal delta from peer '%s' after sequence %llu", peer->name,
+                      (unsigned long long)peer->journal_seq);
+            peer->has_journal_cursor = 0;
+            status = TLD_SYNC_FAILED;
+            break;
+        }
+        if (entry_count < TLD_SYNC_JOURNAL_ENTRIES_PER_REQ) break;
+    }
+
+    *applied = ctx.applied;
+    if (status == TLD_SYNC_IN_SYNC && ctx.applied > 0) status = TLD_SYNC_RECONCILED;
+    return status;
+}
+
+// Merkle walk of every local TLD. The peer's journal position is taken
+// first, so entries after it are replayed next round even if the walk
+// already saw them (re-applying one is a no-op).
+static tld_sync_status_t walk_peer_locked(tld_sync_t* sync, tld_sync_peer_t* peer, char** names, size_t name_count) {
+    payload_tld_journal_resp_t probe;
+    int probed = fetch_journal(peer, 0, 0, &probe);
+    uint64_t peer_last = probe.last_sequence;
+    free_payload_tld_journal_resp(&probe);
+    if (probed < 0) return TLD_SYNC_UNREACHABLE;
+
+    tld_sync_status_t worst = TLD_SYNC_IN_SYNC;
+    for (size_t i = 0; i < name_count; i++) {
+        if (!names[i]) continue;
+        size_t reconciled = 0;
+        tld_sync_status_t status = pull_tld_locked(sync, peer, names[i], &reconciled);
+        if (status == TLD_SYNC_RECONCILED) {
+            log_info("TLD sync: reconciled %zu buckets of '%s' from peer '%s'", reconciled, names[i], peer->name);
+        }
+        if (status > worst) worst = status;
+        // No point asking for the other TLDs
+        if (status == TLD_SYNC_UNREACHABLE) break;
+    }
+
+    if (probed == NEXUS_TLD_SYNC_STATUS_OK && worst != TLD_SYNC_UNREACHABLE && worst != TLD_SYNC_FAILED) {
+        peer->journal_seq = peer_last;
+        peer->has_journal_cursor = 1;
+    }
+    return worst;
+}
+
+// --- Lifecycle ---
+
+int init_tld_sync(tld_manager_t* manager, int interval_ms, tld_sync_t** sync_out) {
+    if (!manager || !sync_out) return -1;
+
+    tld_sync_t* sync = calloc(1, sizeof(tld_sync_t));
+    if (!sync) return -1;
+    sync->manager = manager;
+    sync->interval_ms = interval_ms > 0 ? interval_ms : TLD_SYNC_DEFAULT_INTERVAL_MS;
+    if (pthread_mutex_init(&sync->lock, NULL) != 0) {
+        free(sync);
+        return -1;
+    }
+    *sync_out = sync;
+    return 0;
+}
+
+void cleanup_tld_sync(tld_sync_t* sync) {
+    if (!sync) return;
+    pthread_mutex_destroy(&sync->lock);
+    free(sync);
+}
+
+int tld_sync_add_peer(tld_sync_t* sync, const char* name, tld_sync_exchange_fn exchange, void* ctx) {
+    if (!sync || !name || !exchange) return -1;
+
+    pthread_mutex_lock(&sync->lock);
+    int rc = -1;
+    if (sync->peer_count < TLD_SYNC_MAX_PEERS) {
+        tld_sync_peer_t* peer = &sync->peers[sync->peer_count++];
+        memset(peer, 0, sizeof(*peer));
+        strncpy(peer->name, name, sizeof(peer->name) - 1);
+        peer->exchange = exchange;
+        peer->ctx = ctx;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&sync->lock);
+    return rc;
+}
+
+tld_sync_status_t tld_sync_pull_tld(tld_sync_t* sync, size_t peer_index, const char* tld_name, size_t* buckets_reconciled) {
+    if (!sync || !tld_name) return TLD_SYNC_FAILED;
+
+    size_t reconciled = 0;
+    pthread_mutex_lock(&sync->lock);
+    tld_sync_status_t status = TLD_SYNC_UNREACHABLE;
+    if (peer_index < sync->peer_count) {
+        tld_sync_peer_t* peer = &sync->peers[peer_index];
+        status = pull_tld_locked(sync, peer, tld_name, &reconciled);
+        peer->last_status = status;
+    }
+    pthread_mutex_unlock(&sync->lock);
+    if (buckets_reconciled) *buckets_reconciled = reconciled;
+    return status;
+}
+
+// Names of the local TLDs, copied so no manager lock is held while pulling
+static char** copy_tld_names(tld_manager_t* manager, size_t* count_out) {
+    pthread_rwlock_rdlock(&manager->lock);
+    size_t count = manager->tld_count;
+    char** names = count ? calloc(count, sizeof(char*)) : NULL;
+    for (size_t i = 0; names && i < count; i++) {
+        names[i] = strdup(manager->tlds[i]->name);
+    }
+    pthread_rwlock_unlock(&manager->lock);
+    *count_out = names ? count : 0;
+    return names;
+}
+
+int tld_sync_round(tld_sync_t* sync) {
+    if (!sync) return -1;
+
+    size_t name_count = 0;
+    char** names = copy_tld_names(sync->manager, &name_count);
+
+    int failed = 0;
+    pthread_mutex_lock(&sync->lock);
+    for (size_t p = 0; p < sync->peer_count; p++) {
+        tld_sync_peer_t* peer = &sync->peers[p];
+        tld_sync_status_t status = TLD_SYNC_IN_SYNC;
+        if (peer->has_journal_cursor) {
+            size_t applied = 0;
+            status = pull_journal_locked(sync, peer, &applied);
+            if (applied > 0) {
+                log_info("TLD sync: applied %zu journal entries from peer '%s'", applied, peer->name);
+            }
+        }
+        // The walk also repairs whatever a failed delta left behind
+        if (!peer->has_journal_cursor && status != TLD_SYNC_UNREACHABLE) {
+            status = walk_peer_locked(sync, peer, names, name_count);
+        }
+        if (status == TLD_SYNC_FAILED) failed = 1;
+        peer->last_status = status;
+    }
+    sync->last_round_ms = now_ms();
+    pthread_mutex_unlock(&sync->lock);
+
+    for (size_t i = 0; i < name_count; i++) free(names[i]);
+    free(names);
+    return failed ? -1 : 0;
+}
+
+int tld_sync_tick(tld_sync_t* sync) {
+    if (!sync) return -1;
+    pthread_mutex_lock(&sync->lock);
+    int due = sync->last_round_ms == 0 || now_ms() - sync->last_round_ms >= (uint64_t)sync->interval_ms;
+    pthread_mutex_unlock(&sync->lock);
+    return due ? tld_sync_round(sync) : 0;
+}
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "../include/answer_cache.h"
+#include "../include/packet_protocol.h"
+#include "../include/tld_manager.h"
+#include "test_answer_cache.h"
+
+#define RECORD(n, t, l, d) { .name = (n), .type = (t), .ttl = (l), .last_updated = 0, .rdata = (d) }
+
+// Serializes a DNS_RESPONSE packet the way the server does
+static size_t make_response(uint8_t* buf, size_t buf_len, uint64_t session_id, dns_response_status_t status,
+                            dns_record_t* records, int count) {
+    payload_dns_response_t payload = { .status = status, .record_count = count, .records = records };
+    uint8_t payload_buf[1024];
+    ssize_t payload_len = serialize_payload_dns_response(&payload, payload_buf, sizeof(payload_buf));
+    assert(payload_len > 0);
+
+    nexus_packet_t packet = {
+        .version = 1,
+        .type = PACKET_TYPE_DNS_RESPONSE,
+        .session_id = session_id,
+        .data_len = (uint32_t)payload_len,
+        .data = payload_buf,
+    };
+    ssize_t len = serialize_nexus_packet(&packet, buf, buf_len);
+    assert(len > 0);
+    return (size_t)len;
+}
+
+static payload_dns_response_t parse_response(const uint8_t* buf, size_t len, uint64_t* session_id) {
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    assert(deserialize_nexus_packet(buf, len, &packet) > 0);
+    assert(packet.type == PACKET_TYPE_DNS_RESPONSE);
+    *session_id = packet.session_id;
+
+    payload_dns_response_t payload;
+    memset(&payload, 0, sizeof(payload));
+    assert(deserialize_payload_dns_response(packet.data, packet.data_len, &payload) >= 0);
+    free(packet.data);
+    return payload;
+}
+
+static void free_response(payload_dns_response_t* payload) {
+    for (int i = 0; i < payload->record_count; i++) {
+        free(payload->records[i].name);
+        free(payload->records[i].rdata);
+    }
+    free(payload->records);
+}
+
+static void test_hit_and_keys(void) {
+    printf("Testing answer cache hits and keys...\n");
+    answer_cache_t* cache = NULL;
+    assert(init_answer_cache(64, &cache) == 0);
+
+    dns_record_t records[] = {
+        RECORD("www.test", DNS_RECORD_TYPE_CNAME, 600, "web.test"),
+        RECORD("web.test", DNS_RECORD_TYPE_A, 3600, "192.168.1.1"),
+    };
+    uint8_t packet[ANSWER_CACHE_MAX_PACKET];
+    size_t len = make_response(packet, sizeof(packet), 0x1111, DNS_STATUS_SUCCESS, records, 2);
+
+    uint8_t out[ANSWER_CACHE_MAX_PACKET];
+    assert(answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_A, 1, 0x2222, out, sizeof(out)) == 0);
+    uint64_t generation = answer_cache_generation(cache);
+    assert(answer_cache_insert(cache, generation, "www.test", DNS_RECORD_TYPE_A, 1, packet, len) == 0);
+
+    // Same bytes apart from the session ID
+    assert(answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_A, 1, 0x0102030405060708ULL, out, sizeof(out)) == (ssize_t)len);
+    uint64_t session_id = 0;
+    payload_dns_response_t payload = parse_response(out, len, &session_id);
+    assert(session_id == 0x0102030405060708ULL);
+    assert(payload.status == DNS_STATUS_SUCCESS && payload.record_count == 2);
+    assert(strcmp(payload.records[1].rdata, "192.168.1.1") == 0);
+    assert(payload.records[0].ttl <= 600 && payload.records[0].ttl >= 599);
+    free_response(&payload);
+
+    // Keyed by name, type and protocol version
+    assert(answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_AAAA, 1, 0, out, sizeof(out)) == 0);
+    assert(answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_A, 2, 0, out, sizeof(out)) == 0);
+    assert(answer_cache_lookup(cache, "WWW.test", DNS_RECORD_TYPE_A, 1, 0, out, sizeof(out)) == 0);
+
+    // Too small a buffer
+    assert(answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_A, 1, 0, out, len - 1) == -1);
+
+    uint64_t hits = 0, misses = 0;
+    answer_cache_stats(cache, &hits, &misses);
+    assert(hits == 1 && misses == 4);
+
+    cleanup_answer_cache(cache);
+    printf("Answer cache hit and key test passed\n");
+}
+
+static void test_not_cacheable(void) {
+    printf("Testing uncacheable answers...\n");
+    answer_cache_t* cache = NULL;
+    assert(init_answer_cache(64, &cache) == 0);
+    uint64_t generation = answer_cache_generation(cache);
+    uint8_t packet[ANSWER_CACHE_MAX_PACKET];
+
+    // NXDOMAIN, no records
+    size_t len = make_response(packet, sizeof(packet), 0, DNS_STATUS_NXDOMAIN, NULL, 0);
+    assert(answer_cache_insert(cache, generation, "none.test", DNS_RECORD_TYPE_A, 1, packet, len) == -1);
+
+    // Zero TTL anywhere in the answer
+    dns_record_t records[] = {
+        RECORD("a.test", DNS_RECORD_TYPE_CNAME, 0, "b.test"),
+        RECORD("b.test", DNS_RECORD_TYPE_A, 300, "10.0.0.1"),
+    };
+    len = make_response(packet, sizeof(packet), 0, DNS_STATUS_SUCCESS, records, 2);
+    assert(answer_cache_insert(cache, generation, "a.test", DNS_RECORD_TYPE_A, 1, packet, len) == -1);
+
+    // Truncated or inconsistent packets
+    records[0].ttl = 300;
+    len = make_response(packet, sizeof(packet), 0, DNS_STATUS_SUCCESS, records, 2);
+    assert(answer_cache_insert(cache, generation, "a.test", DNS_RECORD_TYPE_A, 1, packet, len - 1) == -1);
+    packet[1] = PACKET_TYPE_DNS_QUERY;
+    assert(answer_cache_insert(cache, generation, "a.test", DNS_RECORD_TYPE_A, 1, packet, len) == -1);
+    packet[1] = PACKET_TYPE_DNS_RESPONSE;
+
+    // Answers resolved before an invalidation
+    answer_cache_invalidate(cache);
+    assert(answer_cache_insert(cache, generation, "a.test", DNS_RECORD_TYPE_A, 1, packet, len) == -1);
+    assert(answer_cache_insert(cache, answer_cache_generation(cache), "a.test", DNS_RECORD_TYPE_A, 1, packet, len) == 0);
+
+    cleanup_answer_cache(cache);
+    printf("Uncacheable answer test passed\n");
+}
+
+static void test_invalidation(void) {
+    printf("Testing answer cache invalidation...\n");
+    tld_manager_t* manager = NULL;
+    assert(init_tld_manager(&manager) == 0);
+    answer_cache_t* cache = NULL;
+    assert(init_answer_cache(64, &cache) == 0);
+    assert(attach_answer_cache(cache, manager) == 0);
+    assert(attach_answer_cache(cache, manager) == -1);
+    tld_t* tld = register_new_tld(manager, "test");
+    assert(tld != NULL);
+
+    dns_record_t records[] = { RECORD("www.test", DNS_RECORD_TYPE_A, 3600, "192.168.1.1") };
+    uint8_t packet[ANSWER_CACHE_MAX_PACKET];
+    uint8_t out[ANSWER_CACHE_MAX_PACKET];
+    size_t len = make_response(packet, sizeof(packet), 0, DNS_STATUS_SUCCESS, records, 1);
+
+    // A record change anywhere drops every answer
+    assert(answer_cache_insert(cache, answer_cache_generation(cache), "www.test", DNS_RECORD_TYPE_A, 1, packet, len) == 0);
+    assert(add_dns_record_to_tld(tld, &(dns_record_t)RECORD("mail", DNS_RECORD_TYPE_A, 3600, "192.168.1.2")) == 0);
+    assert(answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_A, 1, 0, out, sizeof(out)) == 0);
+
+    // So does registering a TLD
+    assert(answer_cache_insert(cache, answer_cache_generation(cache), "www.test", DNS_RECORD_TYPE_A, 1, packet, len) == 0);
+    assert(register_new_tld(manager, "other") != NULL);
+    assert(answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_A, 1, 0, out, sizeof(out)) == 0);
+
+    // Detached, changes no longer reach it
+    detach_answer_cache(cache);
+    assert(answer_cache_insert(cache, answer_cache_generation(cache), "www.test", DNS_RECORD_TYPE_A, 1, packet, len) == 0);
+    assert(add_dns_record_to_tld(tld, &(dns_record_t)RECORD("ftp", DNS_RECORD_TYPE_A, 3600, "192.168.1.3")) == 0);
+    assert(answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_A, 1, 0, out, sizeof(out)) == (ssize_t)len);
+
+    // Attached again, cleanup detaches before the manager goes away
+    assert(attach_answer_cache(cache, manager) == 0);
+    cleanup_answer_cache(cache);
+    assert(add_dns_record_to_tld(tld, &(dns_record_t)RECORD("ns", DNS_RECORD_TYPE_A, 3600, "192.168.1.4")) == 0);
+    cleanup_tld_manager(manager);
+    printf("Answer cache invalidation test passed\n");
+}
+
+static void test_eviction(void) {
+    printf("Testing answer cache eviction...\n");
+    answer_cache_t* cache = NULL;
+    assert(init_answer_cache(ANSWER_CACHE_WAYS, &cache) == 0);   // A single set
+    uint64_t generation = answer_cache_generation(cache);
+    uint8_t packet[ANSWER_CACHE_MAX_PACKET];
+    uint8_t out[ANSWER_CACHE_MAX_PACKET];
+
+    char name[32];
+    for (int i = 0; i <= ANSWER_CACHE_WAYS; i++) {
+        snprintf(name, sizeof(name), "host%d.test", i);
+        dns_record_t record = RECORD(name, DNS_RECORD_TYPE_A, 100 + (uint32_t)i * 100, "10.0.0.1");
+        size_t len = make_response(packet, sizeof(packet), 0, DNS_STATUS_SUCCESS, &record, 1);
+        assert(answer_cache_insert(cache, generation, name, DNS_RECORD_TYPE_A, 1, packet, len) == 0);
+    }
+
+    // The entry closest to expiry made room
+    assert(answer_cache_lookup(cache, "host0.test", DNS_RECORD_TYPE_A, 1, 0, out, sizeof(out)) == 0);
+    for (int i = 1; i <= ANSWER_CACHE_WAYS; i++) {
+        snprintf(name, sizeof(name), "host%d.test", i);
+        assert(answer_cache_lookup(cache, name, DNS_RECORD_TYPE_A, 1, 0, out, sizeof(out)) > 0);
+    }
+
+    cleanup_answer_cache(cache);
+    printf("Answer cache eviction test passed\n");
+}
+
+static void test_aging(void) {
+    printf("Testing answer cache TTL aging...\n");
+    answer_cache_t* cache = NULL;
+    assert(init_answer_cache(64, &cache) == 0);
+    uint64_t generation = answer_cache_generation(cache);
+    uint8_t packet[ANSWER_CACHE_MAX_PACKET];
+    uint8_t out[ANSWER_CACHE_MAX_PACKET];
+
+    dns_record_t records[] = {
+        RECORD("www.test", DNS_RECORD_TYPE_CNAME, 600, "web.test"),
+        RECORD("web.test", DNS_RECORD_TYPE_A, 3600, "192.168.1.1"),
+    };
+    size_t len = make_response(packet, sizeof(packet), 0, DNS_STATUS_SUCCESS, records, 2);
+    assert(answer_cache_insert(cache, generation, "www.test", DNS_RECORD_TYPE_A, 1, packet, len) == 0);
+    dns_record_t short_lived = RECORD("tmp.test", DNS_RECORD_TYPE_A, 1, "10.0.0.1");
+    len = make_response(packet, sizeof(packet), 0, DNS_STATUS_SUCCESS, &short_lived, 1);
+    assert(answer_cache_insert(cache, generation, "tmp.test", DNS_RECORD_TYPE_A, 1, packet, len) == 0);
+
+    sleep(2);
+
+    // Every TTL counts down by the entry's age
+    ssize_t out_len = answer_cache_lookup(cache, "www.test", DNS_RECORD_TYPE_A, 1, 7, out, sizeof(out));
+    assert(out_len > 0);
+    uint64_t session_id = 0;
+    payload_dns_response_t payload = parse_response(out, (size_t)out_len, &session_id);
+    uint32_t age = 600 - payload.records[0].ttl;
+    assert(age >= 1 && age <= 3);
+    assert(payload.records[1].ttl == 3600 - age);
+    free_response(&payload);
+
+    // Expired with its shortest TTL
+    assert(answer_cache_lookup(cache, "tmp.test", DNS_RECORD_TYPE_A, 1, 7, out, sizeof(out)) == 0);
+
+    cleanup_answer_cache(cache);
+    printf("Answer cache TTL aging test passed\n");
+}
+
+void test_answer_cache_all(void) {
+    printf("Running all answer cache tests...\n");
+
+    test_hit_and_keys();
+    test_not_cacheable();
+    test_invalidation();
+    test_eviction();
+    test_aging();
+
+    printf("All answer cache tests passed!\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_ANSWER_CACHE_H
+#define TEST_ANSWER_CACHE_H
+
+void test_answer_cache_all(void);
+
+#endif // TEST_ANSWER_CACHE_H
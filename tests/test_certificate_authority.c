@@ -3,6 +3,7 @@
 #include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <pthread.h>
 #include "../include/certificate_authority.h"
 #include "../include/network_context.h"
 #include "test_certificate_authority.h"
@@ -195,6 +196,199 @@ static void test_falcon_sign_and_verify(void) {
     printf("Falcon sign and verify test passed\n");
 }
 
+typedef struct {
+    const uint8_t *expanded_key;
+    const uint8_t *public_key;
+    int failures;
+} signing_worker_t;
+
+static void *signing_worker(void *arg) {
+    signing_worker_t *worker = (signing_worker_t *)arg;
+    for (int i = 0; i < 64; i++) {
+        char message[64];
+        snprintf(message, sizeof(message), "message %d from %p", i, (void *)worker);
+        uint8_t signature[FALCON_SIG_LEN];
+        if (falcon_sign_expanded(worker->expanded_key, message, strlen(message), signature) != 0 ||
+            falcon_verify_sig(worker->public_key, message, strlen(message), signature) != 0) {
+            worker->failures++;
+        }
+    }
+    return NULL;
+}
+
+static void test_falcon_expanded_signing(void) {
+    printf("Testing Falcon signing with an expanded key...\n");
+    
+    uint8_t public_key[FALCON_PUBKEY_SIZE_1024];
+    uint8_t private_key[FALCON_PRIVKEY_SIZE_1024];
+    if (generate_falcon_keypair(public_key, private_key) != 0) {
+        printf("Falcon not implemented, skipping expanded key test\n");
+        return;
+    }
+    
+    uint8_t *expanded_key = falcon_expand_private_key(private_key);
+    assert(expanded_key != NULL);
+    
+    // Signatures from the expanded key verify against the compact public key
+    const char *test_data = "expanded key signature";
+    uint8_t signature[FALCON_SIG_LEN];
+    assert(falcon_sign_expanded(expanded_key, test_data, strlen(test_data), signature) == 0);
+    assert(falcon_verify_sig(public_key, test_data, strlen(test_data), signature) == 0);
+    assert(falcon_verify_sig(public_key, "other data", 10, signature) != 0);
+    
+    // Concurrent signers each use their own thread context
+    pthread_t threads[4];
+    signing_worker_t workers[4];
+    for (int i = 0; i < 4; i++) {
+        workers[i].expanded_key = expanded_key;
+        workers[i].public_key = public_key;
+        workers[i].failures = 0;
+        assert(pthread_create(&threads[i], NULL, signing_worker, &workers[i]) == 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        assert(workers[i].failures == 0);
+    }
+    free_falcon_expanded_key(expanded_key);
+    
+    // The CA keeps an expanded key and issues through it
+    network_context_t net_ctx;
+    memset(&net_ctx, 0, sizeof(network_context_t));
+    net_ctx.hostname = strdup("localhost");
+    ca_context_t *ca_ctx = NULL;
+    assert(init_certificate_authority(&net_ctx, &ca_ctx) == 0);
+    assert(ca_ctx->falcon_expanded_key != NULL);
+    assert(ca_falcon_sign(ca_ctx, test_data, strlen(test_data), signature) == 0);
+    assert(falcon_verify_sig(ca_ctx->falcon_public_key, test_data, strlen(test_data), signature) == 0);
+    cleanup_certificate_authority(ca_ctx);
+    free(net_ctx.hostname);
+    
+    printf("Falcon expanded key test passed\n");
+}
+
+static void test_verification_cache(void) {
+    printf("Testing certificate verification cache...\n");
+    
+    network_context_t net_ctx;
+    memset(&net_ctx, 0, sizeof(network_context_t));
+    net_ctx.hostname = strdup("localhost");
+    ca_context_t *ca_ctx = NULL;
+    assert(init_certificate_authority(&net_ctx, &ca_ctx) == 0);
+    assert(ca_ctx->verify_cache != NULL);
+    
+    nexus_cert_t *cert1 = NULL;
+    nexus_cert_t *cert2 = NULL;
+    assert(ca_issue_certificate(ca_ctx, "cached1.localhost", &cert1) == 0);
+    assert(ca_issue_certificate(ca_ctx, "cached2.localhost", &cert2) == 0);
+    
+    // The first verification runs in full, repeats are served from the cache
+    uint64_t hits = 0, misses = 0;
+    assert(verify_certificate(cert1, ca_ctx) == 0);
+    assert(verify_certificate(cert1, ca_ctx) == 0);
+    assert(verify_certificate(cert1, ca_ctx) == 0);
+    cert_verify_cache_stats(ca_ctx->verify_cache, &hits, &misses);
+    assert(hits == 2 && misses == 1);
+    
+    // Rotation drops cached results but the certificate still verifies
+    ca_invalidate_verification_cache(ca_ctx);
+    assert(verify_certificate(cert1, ca_ctx) == 0);
+    cert_verify_cache_stats(ca_ctx->verify_cache, &hits, &misses);
+    assert(hits == 2 && misses == 2);
+    
+    // Revocation overrides a cached success and survives invalidation
+    assert(ca_revoke_certificate(ca_ctx, cert1) == 0);
+    assert(verify_certificate(cert1, ca_ctx) != 0);
+    ca_invalidate_verification_cache(ca_ctx);
+    assert(verify_certificate(cert1, ca_ctx) != 0);
+    assert(verify_certificate(cert2, ca_ctx) == 0);
+    
+    free_certificate(cert1);
+    free_certificate(cert2);
+    cleanup_certificate_authority(ca_ctx);
+    free(net_ctx.hostname);
+    
+    // Keys include the CA, entries expire with the certificate and the
+    // table stays bounded
+    cert_verify_cache_t *cache = NULL;
+    assert(init_cert_verify_cache(CERT_VERIFY_CACHE_WAYS, 60, &cache) == 0);
+    uint8_t cert_fp[32], ca_fp[32], other_ca_fp[32];
+    memset(cert_fp, 0, sizeof(cert_fp));
+    memset(ca_fp, 0xaa, sizeof(ca_fp));
+    memset(other_ca_fp, 0xbb, sizeof(other_ca_fp));
+    cert_verify_cache_insert(cache, cert_fp, ca_fp, 0);
+    assert(cert_verify_cache_lookup(cache, cert_fp, ca_fp) == CERT_VERIFY_CACHE_VALID);
+    assert(cert_verify_cache_lookup(cache, cert_fp, other_ca_fp) == CERT_VERIFY_CACHE_MISS);
+    
+    cert_fp[31] = 1;
+    cert_verify_cache_insert(cache, cert_fp, ca_fp, time(NULL) - 1);
+    assert(cert_verify_cache_lookup(cache, cert_fp, ca_fp) == CERT_VERIFY_CACHE_MISS);
+    
+    int cached = 0;
+    for (int i = 0; i < 4 * CERT_VERIFY_CACHE_WAYS; i++) {
+        cert_fp[31] = (uint8_t)(i + 2);
+        cert_verify_cache_insert(cache, cert_fp, ca_fp, 0);
+    }
+    for (int i = 0; i < 4 * CERT_VERIFY_CACHE_WAYS; i++) {
+        cert_fp[31] = (uint8_t)(i + 2);
+        if (cert_verify_cache_lookup(cache, cert_fp, ca_fp) == CERT_VERIFY_CACHE_VALID) cached++;
+    }
+    assert(cached == CERT_VERIFY_CACHE_WAYS);
+    cleanup_cert_verify_cache(cache);
+    
+    printf("Certificate verification cache test passed\n");
+}
+
+#define BATCH_ISSUE_COUNT 32
+
+static void test_batch_issuance(void) {
+    printf("Testing parallel batch issuance...\n");
+    
+    network_context_t net_ctx;
+    memset(&net_ctx, 0, sizeof(network_context_t));
+    net_ctx.hostname = strdup("localhost");
+    ca_context_t *ca_ctx = NULL;
+    assert(init_certificate_authority(&net_ctx, &ca_ctx) == 0);
+    
+    char names[BATCH_ISSUE_COUNT][64];
+    const char *name_ptrs[BATCH_ISSUE_COUNT];
+    for (int i = 0; i < BATCH_ISSUE_COUNT; i++) {
+        snprintf(names[i], sizeof(names[i]), "batch%d.localhost", i);
+        name_ptrs[i] = names[i];
+    }
+    
+    // Certificates come back in input order with a contiguous serial block
+    nexus_cert_t *certs[BATCH_ISSUE_COUNT];
+    assert(ca_issue_certificates_batch(ca_ctx, name_ptrs, BATCH_ISSUE_COUNT, 4, certs) == 0);
+    long first_serial = ASN1_INTEGER_get(X509_get_serialNumber(certs[0]->x509));
+    for (int i = 0; i < BATCH_ISSUE_COUNT; i++) {
+        assert(certs[i] != NULL);
+        assert(strcmp(certs[i]->common_name, names[i]) == 0);
+        assert(ASN1_INTEGER_get(X509_get_serialNumber(certs[i]->x509)) == first_serial + i);
+        assert(verify_certificate(certs[i], ca_ctx) == 0);
+    }
+    
+    // Single issuance continues after the block
+    nexus_cert_t *single = NULL;
+    assert(ca_issue_certificate(ca_ctx, "after.localhost", &single) == 0);
+    assert(ASN1_INTEGER_get(X509_get_serialNumber(single->x509)) == first_serial + BATCH_ISSUE_COUNT);
+    free_certificate(single);
+    for (int i = 0; i < BATCH_ISSUE_COUNT; i++) {
+        free_certificate(certs[i]);
+    }
+    
+    // One bad name fails the whole batch and nothing is handed out
+    name_ptrs[5] = NULL;
+    assert(ca_issue_certificates_batch(ca_ctx, name_ptrs, 8, 0, certs) != 0);
+    for (int i = 0; i < 8; i++) {
+        assert(certs[i] == NULL);
+    }
+    
+    cleanup_certificate_authority(ca_ctx);
+    free(net_ctx.hostname);
+    
+    printf("Parallel batch issuance test passed\n");
+}
+
 static void test_certificate_chain(void) {
     printf("Testing certificate chain validation...\n");
     
@@ -250,6 +444,9 @@ void test_certificate_authority_all(void) {
     test_certificate_verification();
     test_falcon_keypair_generation();
     test_falcon_sign_and_verify();
+    test_falcon_expanded_signing();
+    test_verification_cache();
+    test_batch_issuance();
     test_certificate_chain();
     
     printf("All certificate authority tests passed!\n");
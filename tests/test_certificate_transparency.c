@@ -4,7 +4,10 @@
 #include <assert.h>
 #include <pthread.h>
 #include <time.h>
+#include <unistd.h>
+#include <openssl/sha.h>
 #include "../include/certificate_transparency.h"
+#include "../include/ct_log_store.h"
 #include "../include/network_context.h"
 #include "test_certificate_transparency.h"
 #include "../include/certificate_authority.h"
@@ -97,6 +100,21 @@ static void free_test_certificate(nexus_cert_t* cert) {
     }
 }
 
+// Reference MTH from RFC 6962 section 2.1, straight from the leaf hashes
+static void naive_tree_hash(ct_log_t* log, size_t start, size_t n, uint8_t out[32]) {
+    if (n == 1) {
+        memcpy(out, log->entries[start].leaf_hash, 32);
+        return;
+    }
+    size_t k = 1;
+    while (k * 2 < n) k *= 2;
+    uint8_t buf[65];
+    buf[0] = 0x01;
+    naive_tree_hash(log, start, k, buf + 1);
+    naive_tree_hash(log, start + k, n - k, buf + 33);
+    SHA256(buf, sizeof(buf), out);
+}
+
 static void test_ct_log_creation(void) {
     printf("Testing CT log creation...\n");
     
@@ -163,12 +181,309 @@ static void test_merkle_tree(void) {
     int result = add_certificate_to_ct_log(log, cert1);
     assert(result == 0);
 
+    // Grow to a size that is not a power of two so the ragged edge is exercised
+    for (int i = 5; i < 21; ++i) {
+        char cert_name[256];
+        snprintf(cert_name, sizeof(cert_name), "test%d.example.com", i);
+        nexus_cert_t* cert_loop = create_test_certificate(cert_name);
+        assert(cert_loop != NULL);
+        assert(add_certificate_to_ct_log(log, cert_loop) == 0);
+        free_test_certificate(cert_loop);
+    }
+    assert(log->entry_count == 22);
+
+    // Root matches the RFC 6962 definition computed naively over the leaves
+    uint8_t root[32], expected[32];
+    assert(ct_log_root_hash(log, log->entry_count, root) == 0);
+    naive_tree_hash(log, 0, log->entry_count, expected);
+    assert(memcmp(root, expected, 32) == 0);
+
+    // Inclusion proofs for every entry
+    for (size_t i = 0; i < log->entry_count; ++i) {
+        merkle_proof_t* proof = generate_merkle_proof(log, i);
+        assert(proof != NULL);
+        assert(proof->tree_size == 22 && proof->leaf_index == i);
+        assert(memcmp(proof->root_hash, root, 32) == 0);
+        assert(verify_merkle_proof(&log->entries[i], proof) == 0);
+
+        // The proof does not verify a different entry
+        assert(verify_merkle_proof(&log->entries[(i + 1) % log->entry_count], proof) != 0);
+        free_merkle_proof(proof);
+    }
+    assert(generate_merkle_proof(log, log->entry_count) == NULL);
+
+    // Consistency proofs between every earlier size and the current tree
+    for (uint64_t m = 1; m <= log->entry_count; ++m) {
+        uint8_t old_root[32];
+        assert(ct_log_root_hash(log, m, old_root) == 0);
+        ct_consistency_proof_t* consistency = generate_ct_consistency_proof(log, m, log->entry_count);
+        assert(consistency != NULL);
+        assert(verify_ct_consistency_proof(consistency, old_root, root) == 0);
+        if (m < log->entry_count) {
+            old_root[0] ^= 1;
+            assert(verify_ct_consistency_proof(consistency, old_root, root) != 0);
+        }
+        free_ct_consistency_proof(consistency);
+    }
+
+    // Signed tree head covers the current root
+    ct_signed_tree_head_t sth;
+    assert(ct_log_get_sth(log, &sth) == 0);
+    assert(sth.tree_size == 22 && memcmp(sth.root_hash, root, 32) == 0);
+    assert(verify_ct_sth(log, &sth) == 0);
+    sth.tree_size++;
+    assert(verify_ct_sth(log, &sth) != 0);
+
     free_test_certificate(cert1);
     cleanup_certificate_transparency(log);
     
     printf("Merkle tree test passed\n");
 }
 
+static void add_numbered_certificates(ct_log_t* log, int first, int last) {
+    for (int i = first; i < last; ++i) {
+        char cert_name[256];
+        snprintf(cert_name, sizeof(cert_name), "stored%d.example.com", i);
+        nexus_cert_t* cert = create_test_certificate(cert_name);
+        assert(cert != NULL);
+        assert(add_certificate_to_ct_log(log, cert) == 0);
+        free_test_certificate(cert);
+    }
+}
+
+static void test_persistent_log(void) {
+    printf("Testing segmented CT log storage...\n");
+    char dir[] = "/tmp/ct_store_testXXXXXX";
+    assert(mkdtemp(dir) != NULL);
+
+    ct_log_t* log = open_ct_log("test_store.ct", "store.node.com", dir);
+    assert(log != NULL && log->store != NULL);
+    add_numbered_certificates(log, 0, 40);
+
+    uint8_t root[32];
+    ct_signed_tree_head_t sth;
+    assert(ct_log_root_hash(log, 40, root) == 0);
+    assert(ct_log_get_sth(log, &sth) == 0);
+    cleanup_ct_log(log);
+
+    // A torn write past the last indexed record is dropped on reopen
+    char path[512];
+    snprintf(path, sizeof(path), "%s/segment-00000000.dat", dir);
+    FILE* fp = fopen(path, "ab");
+    assert(fp != NULL);
+    fputs("torn", fp);
+    fclose(fp);
+
+    // Reopen: same size, same root, same key; nothing is cached yet
+    log = open_ct_log("test_store.ct", "store.node.com", dir);
+    assert(log != NULL);
+    assert(log->entry_count == 40);
+    uint8_t reopened_root[32];
+    assert(ct_log_root_hash(log, 40, reopened_root) == 0);
+    assert(memcmp(root, reopened_root, 32) == 0);
+    assert(verify_ct_sth(log, &sth) == 0);
+
+    // Old entries are served from the segments and still prove inclusion
+    ct_entry_t entry;
+    assert(ct_log_get_entry(log, 7, &entry) == 0);
+    assert(entry.index == 7 && strcmp(entry.cert->common_name, "stored7.example.com") == 0);
+    assert(entry.cert->signature_len > 0 && entry.cert->signature != NULL);
+    merkle_proof_t* proof = generate_merkle_proof(log, 7);
+    assert(proof != NULL && proof->cert != NULL);
+    assert(verify_merkle_proof(&entry, proof) == 0);
+    free_merkle_proof(proof);
+    ct_free_entry(&entry);
+    assert(ct_log_get_entry(log, 40, &entry) != 0);
+
+    // Appends continue the same tree
+    add_numbered_certificates(log, 40, 45);
+    assert(log->entry_count == 45 && ct_log_store_count(log->store) == 45);
+    ct_consistency_proof_t* consistency = generate_ct_consistency_proof(log, 40, 45);
+    uint8_t grown_root[32];
+    assert(ct_log_root_hash(log, 45, grown_root) == 0);
+    assert(verify_ct_consistency_proof(consistency, root, grown_root) == 0);
+    free_ct_consistency_proof(consistency);
+    assert(ct_log_get_entry(log, 44, &entry) == 0);
+    assert(strcmp(entry.cert->common_name, "stored44.example.com") == 0);
+    ct_free_entry(&entry);
+    cleanup_ct_log(log);
+
+    const char* files[] = { "segment-00000000.dat", "index.dat", "log.key" };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+
+    printf("Segmented CT log storage test passed\n");
+}
+
+static void test_persistent_log_integrity(void) {
+    printf("Testing CT log store integrity...\n");
+    char dir[] = "/tmp/ct_store_testXXXXXX";
+    assert(mkdtemp(dir) != NULL);
+
+    network_context_t net_ctx;
+    memset(&net_ctx, 0, sizeof(network_context_t));
+    net_ctx.hostname = strdup("localhost");
+    ca_context_t *ca_ctx = NULL;
+    assert(init_certificate_authority(&net_ctx, &ca_ctx) == 0);
+
+    // An X.509 leaf survives a reopen: the reloaded certificate carries
+    // its DER and still hashes to the logged leaf
+    ct_log_t* log = open_ct_log("test_store.ct", "store.node.com", dir);
+    assert(log != NULL);
+    nexus_cert_t *cert = NULL;
+    ct_sct_t sct;
+    assert(ca_issue_certificate(ca_ctx, "der.example.com", &cert) == 0 && cert->x509 != NULL);
+    assert(ct_sign_certificate(log, cert, &sct) == 0);
+    add_numbered_certificates(log, 1, 4);
+    cleanup_ct_log(log);
+
+    log = open_ct_log("test_store.ct", "store.node.com", dir);
+    assert(log != NULL && log->entry_count == 4);
+    ct_entry_t entry;
+    assert(ct_log_get_entry(log, 0, &entry) == 0);
+    assert(entry.cert->x509 != NULL);
+    assert(memcmp(entry.leaf_hash, sct.leaf_hash, 32) == 0);
+    assert(verify_ct_sct(log, entry.cert, &sct) == 0);
+    ct_free_entry(&entry);
+    cleanup_ct_log(log);
+
+    // A bad record with good ones after it is corruption, not a torn tail
+    char path[512];
+    snprintf(path, sizeof(path), "%s/segment-00000000.dat", dir);
+    FILE* fp = fopen(path, "r+b");
+    assert(fp != NULL);
+    assert(fseek(fp, 20, SEEK_SET) == 0);
+    int byte = fgetc(fp);
+    assert(fseek(fp, 20, SEEK_SET) == 0);
+    fputc(byte ^ 0xFF, fp);
+    fclose(fp);
+    assert(open_ct_log("test_store.ct", "store.node.com", dir) == NULL);
+
+    free_certificate(cert);
+    cleanup_certificate_authority(ca_ctx);
+    free(net_ctx.hostname);
+    const char* files[] = { "segment-00000000.dat", "index.dat", "log.key" };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+
+    printf("CT log store integrity test passed\n");
+}
+
+#define BATCH_THREADS 4
+#define BATCH_PER_THREAD 6
+
+typedef struct {
+    ct_log_t* log;
+    int thread_id;
+    uint64_t tree_sizes[BATCH_PER_THREAD];
+} batch_submitter_t;
+
+static void* batch_submitter(void* arg) {
+    batch_submitter_t* submitter = arg;
+    for (int i = 0; i < BATCH_PER_THREAD; ++i) {
+        char cert_name[256];
+        snprintf(cert_name, sizeof(cert_name), "batch%d-%d.example.com", submitter->thread_id, i);
+        nexus_cert_t* cert = create_test_certificate(cert_name);
+        assert(cert != NULL);
+        ct_sct_t* sct = malloc(sizeof(ct_sct_t));
+        assert(sct != NULL);
+        assert(ct_sign_certificate(submitter->log, cert, sct) == 0);
+        assert(verify_ct_sct(submitter->log, cert, sct) == 0);
+        submitter->tree_sizes[i] = sct->sth.tree_size;
+        free(sct);
+        free_test_certificate(cert);
+    }
+    return NULL;
+}
+
+static void test_batched_submission(void) {
+    printf("Testing batched CT submission...\n");
+    ct_log_t* log = create_ct_log("test_batch.ct", "batch.node.com");
+    assert(log != NULL);
+
+    // Direct batch: one tree head shared by every promise, no per-entry signatures
+    nexus_cert_t* certs[5];
+    for (int i = 0; i < 5; ++i) {
+        char cert_name[256];
+        snprintf(cert_name, sizeof(cert_name), "direct%d.example.com", i);
+        certs[i] = create_test_certificate(cert_name);
+        assert(certs[i] != NULL);
+    }
+    ct_sct_t* scts = calloc(5, sizeof(ct_sct_t));
+    assert(scts != NULL);
+    assert(ct_log_submit_batch(log, certs, 5, scts) == 5);
+    assert(log->entry_count == 5);
+    for (int i = 0; i < 5; ++i) {
+        assert(scts[i].leaf_index == (uint64_t)i);
+        assert(scts[i].sth.tree_size == 5);
+        assert(memcmp(&scts[i].sth, &scts[0].sth, sizeof(ct_signed_tree_head_t)) == 0);
+        assert(log->entries[i].signature_len == 0);
+        assert(verify_ct_sct(log, certs[i], &scts[i]) == 0);
+    }
+
+    // Promises do not transfer to another certificate or position
+    assert(verify_ct_sct(log, certs[1], &scts[0]) != 0);
+    scts[2].leaf_index ^= 1;
+    assert(verify_ct_sct(log, certs[2], &scts[2]) != 0);
+    scts[3].sth.root_hash[0] ^= 1;
+    assert(verify_ct_sct(log, certs[3], &scts[3]) != 0);
+
+    // The batch tree head is the log's latest
+    ct_signed_tree_head_t sth;
+    assert(ct_log_get_sth(log, &sth) == 0);
+    assert(sth.tree_size == 5 && memcmp(sth.root_hash, scts[0].sth.root_hash, 32) == 0);
+    free(scts);
+    for (int i = 0; i < 5; ++i) free_test_certificate(certs[i]);
+
+    // Concurrent submitters through the queue share tree heads
+    ct_batch_config_t config = { .max_delay_ms = 50, .max_batch = 8 };
+    assert(start_ct_log_batching(log, &config) == 0);
+    pthread_t threads[BATCH_THREADS];
+    batch_submitter_t submitters[BATCH_THREADS];
+    for (int t = 0; t < BATCH_THREADS; ++t) {
+        submitters[t].log = log;
+        submitters[t].thread_id = t;
+        assert(pthread_create(&threads[t], NULL, batch_submitter, &submitters[t]) == 0);
+    }
+    for (int t = 0; t < BATCH_THREADS; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+    stop_ct_log_batching(log);
+    assert(log->entry_count == 5 + BATCH_THREADS * BATCH_PER_THREAD);
+
+    // Fewer tree heads than submissions
+    uint64_t distinct[BATCH_THREADS * BATCH_PER_THREAD];
+    size_t distinct_count = 0;
+    for (int t = 0; t < BATCH_THREADS; ++t) {
+        for (int i = 0; i < BATCH_PER_THREAD; ++i) {
+            uint64_t size = submitters[t].tree_sizes[i];
+            size_t k = 0;
+            while (k < distinct_count && distinct[k] != size) ++k;
+            if (k == distinct_count) distinct[distinct_count++] = size;
+        }
+    }
+    assert(distinct_count < BATCH_THREADS * BATCH_PER_THREAD);
+
+    // Without a queue a submission is a batch of one
+    nexus_cert_t* single = create_test_certificate("single.example.com");
+    ct_sct_t* sct = malloc(sizeof(ct_sct_t));
+    assert(single != NULL && sct != NULL);
+    assert(ct_sign_certificate(log, single, sct) == 0);
+    assert(sct->sth.tree_size == log->entry_count);
+    assert(verify_ct_sct(log, single, sct) == 0);
+    free(sct);
+    free_test_certificate(single);
+
+    cleanup_ct_log(log);
+    printf("Batched CT submission test passed\n");
+}
+
 static void test_signature_verification(void) {
     printf("Testing signature verification in CT context...\n");
     
@@ -274,15 +589,53 @@ static void test_ca_ct_integration(void) {
     printf("CA and CT integration test passed\n");
 }
 
+static void test_batch_issuance_logging(void) {
+    printf("Testing batch issuance into the CT log...\n");
+    
+    network_context_t net_ctx;
+    memset(&net_ctx, 0, sizeof(network_context_t));
+    net_ctx.hostname = strdup("localhost");
+    ca_context_t *ca_ctx = NULL;
+    assert(init_certificate_authority(&net_ctx, &ca_ctx) == 0);
+    ct_log_t *log = init_certificate_transparency(&net_ctx);
+    assert(log != NULL);
+    
+    const char *names[6] = { "a.batch.com", "b.batch.com", "c.batch.com",
+                             "d.batch.com", "e.batch.com", "f.batch.com" };
+    nexus_cert_t *certs[6];
+    ct_sct_t scts[6];
+    assert(ct_issue_certificates_batch(ca_ctx, log, names, 6, 3, certs, scts) == 6);
+    
+    // Every certificate is logged under the same tree head
+    assert(log->entry_count == 6);
+    for (int i = 0; i < 6; i++) {
+        assert(scts[i].leaf_index == (uint64_t)i);
+        assert(memcmp(&scts[i].sth, &scts[0].sth, sizeof(ct_signed_tree_head_t)) == 0);
+        assert(verify_ct_sct(log, certs[i], &scts[i]) == 0);
+        assert(verify_certificate(certs[i], ca_ctx) == 0);
+        free_certificate(certs[i]);
+    }
+    
+    cleanup_certificate_transparency(log);
+    cleanup_certificate_authority(ca_ctx);
+    free(net_ctx.hostname);
+    
+    printf("Batch issuance CT test passed\n");
+}
+
 void test_certificate_transparency_all(void) {
     printf("Running all certificate transparency tests...\n");
     
     test_ct_log_creation();
     test_certificate_operations();
     test_merkle_tree();
+    test_persistent_log();
+    test_persistent_log_integrity();
+    test_batched_submission();
     test_signature_verification();
     test_network_context_integration();
     test_ca_ct_integration();
+    test_batch_issuance_logging();
     
     printf("All certificate transparency tests passed!\n");
 } 
\ No newline at end of file
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "../include/certificate_transparency.h"
+#include "../include/certificate_authority.h"
+#include "../include/network_context.h"
+#include "../include/ct_gossip.h"
+#include "../include/packet_protocol.h"
+#include "test_ct_gossip.h"
+
+// Append certificates named <prefix><i> for i in [first, last)
+static void add_certificates(ct_log_t* log, const char* prefix, int first, int last) {
+    for (int i = first; i < last; ++i) {
+        char name[128];
+        snprintf(name, sizeof(name), "%s%d.example.com", prefix, i);
+
+        nexus_cert_t cert;
+        memset(&cert, 0, sizeof(cert));
+        cert.common_name = name;
+        cert.not_before = time(NULL);
+        cert.not_after = cert.not_before + 3600;
+        cert.cert_type = CERT_TYPE_FEDERATED;
+        uint8_t signature[64];
+        memset(signature, i & 0xff, sizeof(signature));
+        cert.signature = signature;
+        cert.signature_len = sizeof(signature);
+        assert(add_certificate_to_ct_log(log, &cert) == 0);
+    }
+}
+
+// In-process transport: answer each pipelined packet from the peer's log
+static ssize_t local_exchange(void* ctx, const uint8_t* request, size_t request_len, uint8_t** response_out) {
+    ct_log_t* peer_log = *(ct_log_t**)ctx;
+    uint8_t* out = NULL;
+    size_t out_len = 0;
+    size_t offset = 0;
+
+    while (offset < request_len) {
+        nexus_packet_t packet;
+        memset(&packet, 0, sizeof(packet));
+        ssize_t consumed = deserialize_nexus_packet(request + offset, request_len - offset, &packet);
+        assert(consumed > 0);
+        offset += (size_t)consumed;
+
+        uint8_t* resp = NULL;
+        size_t resp_len = 0;
+        int rc = ct_gossip_handle_packet(peer_log, &packet, &resp, &resp_len);
+        free(packet.data);
+        if (rc != 0) break;
+
+        out = realloc(out, out_len + resp_len);
+        assert(out != NULL);
+        memcpy(out + out_len, resp, resp_len);
+        out_len += resp_len;
+        free(resp);
+    }
+    *response_out = out;
+    return out ? (ssize_t)out_len : -1;
+}
+
+// Like local_exchange, but alters the root in the peer's signed head
+static ssize_t tampering_exchange(void* ctx, const uint8_t* request, size_t request_len, uint8_t** response_out) {
+    uint8_t* response = NULL;
+    ssize_t len = local_exchange(ctx, request, request_len, &response);
+    assert(len > 0);
+
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    assert(deserialize_nexus_packet(response, (size_t)len, &packet) > 0);
+    assert(packet.type == PACKET_TYPE_CT_STH_RESP);
+    payload_ct_sth_resp_t* resp = calloc(1, sizeof(payload_ct_sth_resp_t));
+    assert(resp != NULL);
+    assert(deserialize_payload_ct_sth_resp(packet.data, packet.data_len, resp) > 0);
+    resp->sth.root_hash[0] ^= 1;
+
+    uint8_t* payload = malloc(packet.data_len);
+    assert(serialize_payload_ct_sth_resp(resp, payload, packet.data_len) == (ssize_t)packet.data_len);
+    free(packet.data);
+    packet.data = payload;
+    assert(serialize_nexus_packet(&packet, response, (size_t)len) == len);
+    free(payload);
+    free(resp);
+
+    *response_out = response;
+    return len;
+}
+
+// Like local_exchange, but renames the first certificate of every entries
+// response while leaving its leaf hash alone
+static ssize_t forging_exchange(void* ctx, const uint8_t* request, size_t request_len, uint8_t** response_out) {
+    uint8_t* response = NULL;
+    ssize_t len = local_exchange(ctx, request, request_len, &response);
+    if (len <= 0) {
+        *response_out = response;
+        return len;
+    }
+
+    nexus_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    assert(deserialize_nexus_packet(response, (size_t)len, &packet) > 0);
+    if (packet.type == PACKET_TYPE_CT_ENTRIES_RESP) {
+        payload_ct_entries_resp_t resp;
+        assert(deserialize_payload_ct_entries_resp(packet.data, packet.data_len, &resp) > 0);
+        free(resp.leaves[0].common_name);
+        resp.leaves[0].common_name = strdup("forged.example.com");
+
+        ssize_t size = get_serialized_payload_ct_entries_resp_size(&resp);
+        uint8_t* payload = malloc((size_t)size);
+        assert(serialize_payload_ct_entries_resp(&resp, payload, (size_t)size) == size);
+        free_payload_ct_entries_resp(&resp);
+        free(packet.data);
+        packet.data = payload;
+        packet.data_len = (uint32_t)size;
+
+        free(response);
+        len = get_serialized_nexus_packet_size(&packet);
+        response = malloc((size_t)len);
+        assert(serialize_nexus_packet(&packet, response, (size_t)len) == len);
+    }
+    free(packet.data);
+
+    *response_out = response;
+    return len;
+}
+
+static int same_root(ct_log_t* a, ct_log_t* b) {
+    ct_signed_tree_head_t sth_a, sth_b;
+    assert(ct_log_get_sth(a, &sth_a) == 0);
+    assert(ct_log_get_sth(b, &sth_b) == 0);
+    return sth_a.tree_size == sth_b.tree_size && memcmp(sth_a.root_hash, sth_b.root_hash, 32) == 0;
+}
+
+static void test_packet_roundtrip(void) {
+    printf("Testing CT gossip payload encoding...\n");
+
+    payload_ct_entries_req_t req = { .start = 512, .count = 256, .tree_size = 900 };
+    strncpy(req.log_id, "gossip.ct", sizeof(req.log_id) - 1);
+    uint8_t buf[128];
+    ssize_t len = serialize_payload_ct_entries_req(&req, buf, sizeof(buf));
+    assert(len > 0);
+    payload_ct_entries_req_t decoded;
+    assert(deserialize_payload_ct_entries_req(buf, (size_t)len, &decoded) == len);
+    assert(decoded.start == 512 && decoded.count == 256 && decoded.tree_size == 900);
+    assert(strcmp(decoded.log_id, "gossip.ct") == 0);
+
+    // Truncated input is rejected
+    assert(deserialize_payload_ct_entries_req(buf, (size_t)len - 1, &decoded) < 0);
+
+    // Unknown packet types are not answered
+    ct_log_t* log = create_ct_log("gossip.ct", "gossip.node.com");
+    assert(log != NULL);
+    nexus_packet_t packet = { .version = 1, .type = PACKET_TYPE_DNS_QUERY };
+    uint8_t* resp = NULL;
+    size_t resp_len = 0;
+    assert(ct_gossip_handle_packet(log, &packet, &resp, &resp_len) != 0);
+    cleanup_ct_log(log);
+}
+
+static void test_catch_up(void) {
+    printf("Testing CT gossip catch-up...\n");
+    ct_log_t* upstream = create_ct_log("upstream.ct", "upstream.node.com");
+    ct_log_t* replica = create_ct_log("replica.ct", "replica.node.com");
+    assert(upstream != NULL && replica != NULL);
+
+    // More than one pipelined exchange worth of chunks
+    int total = NEXUS_CT_MAX_ENTRIES_PER_REQ * (CT_GOSSIP_PIPELINE_DEPTH + 1) + 17;
+    add_certificates(upstream, "upstream", 0, total);
+
+    ct_gossip_t* gossip = NULL;
+    assert(init_ct_gossip(replica, 1000, &gossip) == 0);
+    ct_log_t* peer_log = upstream;
+    assert(ct_gossip_add_peer(gossip, "upstream", local_exchange, &peer_log) == 0);
+
+    assert(ct_gossip_sync_peer(gossip, 0) == CT_GOSSIP_CAUGHT_UP);
+    assert(ct_log_size(replica) == (uint64_t)total);
+    assert(same_root(upstream, replica));
+
+    // Replicated entries are served like local ones
+    ct_entry_t entry;
+    assert(ct_log_get_entry(replica, 42, &entry) == 0);
+    assert(strcmp(entry.cert->common_name, "upstream42.example.com") == 0);
+    assert(entry.cert->signature_len == 64 && entry.cert->signature[0] == 42);
+    ct_free_entry(&entry);
+
+    assert(ct_gossip_sync_peer(gossip, 0) == CT_GOSSIP_IN_SYNC);
+
+    // Only the new suffix is fetched, proven against our previous head
+    add_certificates(upstream, "upstream", total, total + 10);
+    assert(ct_gossip_round(gossip) == 0);
+    assert(gossip->peers[0].last_status == CT_GOSSIP_CAUGHT_UP);
+    assert(ct_log_size(replica) == (uint64_t)total + 10);
+    assert(same_root(upstream, replica));
+
+    // From the upstream's side the replica is a consistent prefix
+    add_certificates(upstream, "upstream", total + 10, total + 12);
+    ct_gossip_t* reverse = NULL;
+    assert(init_ct_gossip(upstream, 1000, &reverse) == 0);
+    ct_log_t* replica_log = replica;
+    assert(ct_gossip_add_peer(reverse, "replica", local_exchange, &replica_log) == 0);
+    assert(ct_gossip_sync_peer(reverse, 0) == CT_GOSSIP_PEER_BEHIND);
+    assert(ct_log_size(upstream) == (uint64_t)total + 12);
+
+    // A tick right after a round does nothing
+    assert(ct_gossip_tick(gossip) == 0);
+    assert(ct_log_size(replica) == (uint64_t)total + 10);
+
+    cleanup_ct_gossip(reverse);
+    cleanup_ct_gossip(gossip);
+    cleanup_ct_log(replica);
+    cleanup_ct_log(upstream);
+}
+
+static void test_split_view(void) {
+    printf("Testing CT gossip split view detection...\n");
+    ct_log_t* a = create_ct_log("a.ct", "a.node.com");
+    ct_log_t* b = create_ct_log("b.ct", "b.node.com");
+    assert(a != NULL && b != NULL);
+
+    // Same size, different contents
+    add_certificates(a, "left", 0, 5);
+    add_certificates(b, "right", 0, 5);
+
+    ct_gossip_t* gossip = NULL;
+    assert(init_ct_gossip(a, 1000, &gossip) == 0);
+    ct_log_t* peer_log = b;
+    assert(ct_gossip_add_peer(gossip, "b", local_exchange, &peer_log) == 0);
+    assert(ct_gossip_sync_peer(gossip, 0) == CT_GOSSIP_SPLIT_VIEW);
+    assert(gossip->peers[0].split_view == 1);
+    assert(ct_log_size(a) == 5);
+
+    // Peer ahead on a forked history: the consistency proof fails
+    add_certificates(b, "right", 5, 9);
+    assert(ct_gossip_round(gossip) == -1);
+    assert(gossip->peers[0].last_status == CT_GOSSIP_SPLIT_VIEW);
+    assert(ct_log_size(a) == 5);
+    cleanup_ct_gossip(gossip);
+
+    // A peer whose key changes after first contact is rejected, even when
+    // the new key signs the same history
+    ct_log_t* replicas[2];
+    for (int i = 0; i < 2; ++i) {
+        replicas[i] = create_ct_log("replica.ct", "replica.node.com");
+        assert(replicas[i] != NULL);
+        ct_gossip_t* catch_up = NULL;
+        assert(init_ct_gossip(replicas[i], 1000, &catch_up) == 0);
+        ct_log_t* source = a;
+        assert(ct_gossip_add_peer(catch_up, "a", local_exchange, &source) == 0);
+        assert(ct_gossip_sync_peer(catch_up, 0) == CT_GOSSIP_CAUGHT_UP);
+        cleanup_ct_gossip(catch_up);
+    }
+    assert(init_ct_gossip(a, 1000, &gossip) == 0);
+    peer_log = replicas[0];
+    assert(ct_gossip_add_peer(gossip, "replica", local_exchange, &peer_log) == 0);
+    assert(ct_gossip_sync_peer(gossip, 0) == CT_GOSSIP_IN_SYNC);
+    peer_log = replicas[1];
+    assert(ct_gossip_sync_peer(gossip, 0) == CT_GOSSIP_SPLIT_VIEW);
+
+    cleanup_ct_gossip(gossip);
+    cleanup_ct_log(replicas[1]);
+    cleanup_ct_log(replicas[0]);
+    cleanup_ct_log(b);
+    cleanup_ct_log(a);
+}
+
+static void test_bad_signature(void) {
+    printf("Testing CT gossip signature checks...\n");
+    ct_log_t* upstream = create_ct_log("signed.ct", "signed.node.com");
+    ct_log_t* replica = create_ct_log("replica.ct", "replica.node.com");
+    assert(upstream != NULL && replica != NULL);
+    add_certificates(upstream, "signed", 0, 8);
+
+    ct_gossip_t* gossip = NULL;
+    assert(init_ct_gossip(replica, 1000, &gossip) == 0);
+    ct_log_t* peer_log = upstream;
+    assert(ct_gossip_add_peer(gossip, "tampered", tampering_exchange, &peer_log) == 0);
+    assert(ct_gossip_sync_peer(gossip, 0) == CT_GOSSIP_BAD_SIGNATURE);
+    assert(ct_log_size(replica) == 0);
+    assert(gossip->peers[0].pubkey_len == 0);
+
+    cleanup_ct_gossip(gossip);
+    cleanup_ct_log(replica);
+    cleanup_ct_log(upstream);
+}
+
+static void test_forged_entries(void) {
+    printf("Testing CT gossip leaf hash checks...\n");
+    ct_log_t* upstream = create_ct_log("forged.ct", "forged.node.com");
+    ct_log_t* replica = create_ct_log("replica.ct", "replica.node.com");
+    assert(upstream != NULL && replica != NULL);
+    add_certificates(upstream, "genuine", 0, 8);
+
+    // Certificates that do not hash to their leaves are refused as a batch,
+    // and the head they came with is not remembered
+    ct_gossip_t* gossip = NULL;
+    assert(init_ct_gossip(replica, 1000, &gossip) == 0);
+    ct_log_t* peer_log = upstream;
+    assert(ct_gossip_add_peer(gossip, "forger", forging_exchange, &peer_log) == 0);
+    assert(ct_gossip_sync_peer(gossip, 0) == CT_GOSSIP_SPLIT_VIEW);
+    assert(ct_log_size(replica) == 0);
+    assert(gossip->peers[0].last_sth.tree_size == 0);
+    cleanup_ct_gossip(gossip);
+
+    // X.509 leaves travel with their DER and replicate to the same tree
+    network_context_t net_ctx;
+    memset(&net_ctx, 0, sizeof(net_ctx));
+    net_ctx.hostname = strdup("localhost");
+    ca_context_t* ca_ctx = NULL;
+    assert(init_certificate_authority(&net_ctx, &ca_ctx) == 0);
+    nexus_cert_t* cert = NULL;
+    assert(ca_issue_certificate(ca_ctx, "x509.example.com", &cert) == 0 && cert->x509 != NULL);
+    assert(add_certificate_to_ct_log(upstream, cert) == 0);
+
+    assert(init_ct_gossip(replica, 1000, &gossip) == 0);
+    assert(ct_gossip_add_peer(gossip, "upstream", local_exchange, &peer_log) == 0);
+    assert(ct_gossip_sync_peer(gossip, 0) == CT_GOSSIP_CAUGHT_UP);
+    assert(same_root(upstream, replica));
+    ct_entry_t entry;
+    assert(ct_log_get_entry(replica, 8, &entry) == 0);
+    assert(entry.cert->x509 != NULL && X509_cmp(entry.cert->x509, cert->x509) == 0);
+    ct_free_entry(&entry);
+
+    cleanup_ct_gossip(gossip);
+    free_certificate(cert);
+    cleanup_certificate_authority(ca_ctx);
+    free(net_ctx.hostname);
+    cleanup_ct_log(replica);
+    cleanup_ct_log(upstream);
+}
+
+void test_ct_gossip_all(void) {
+    printf("Running all CT gossip tests...\n");
+
+    test_packet_roundtrip();
+    test_catch_up();
+    test_split_view();
+    test_bad_signature();
+    test_forged_entries();
+
+    printf("All CT gossip tests passed!\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_CT_GOSSIP_H
+#define TEST_CT_GOSSIP_H
+
+void test_ct_gossip_all(void);
+
+#endif // TEST_CT_GOSSIP_H
@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "../include/dns_frontend.h"
+#include "../include/dns_wire.h"
+#include "../include/dns_resolver.h"
+#include "../include/tld_manager.h"
+#include "test_dns_frontend.h"
+
+#define BIG_TXT_LEN 700     // Over the 512-byte classic UDP limit
+
+typedef struct {
+    tld_manager_t* tld_manager;
+    dns_cache_t* cache;
+    dns_resolver_t* resolver;
+} frontend_fixture_t;
+
+static void setup_fixture(frontend_fixture_t* fx) {
+    assert(init_tld_manager(&fx->tld_manager) == 0);
+    fx->cache = calloc(1, sizeof(dns_cache_t));
+    assert(fx->cache);
+    fx->cache->max_size = 100;
+    pthread_mutex_init(&fx->cache->lock, NULL);
+    assert(init_dns_resolver(&fx->resolver, fx->tld_manager, fx->cache) == 0);
+
+    assert(register_new_tld(fx->tld_manager, "test") != NULL);
+    assert(add_record_to_tld(fx->tld_manager, "test", "www", DNS_RECORD_TYPE_A, "192.168.1.1", 3600) == 0);
+    assert(add_record_to_tld(fx->tld_manager, "test", "alias", DNS_RECORD_TYPE_CNAME, "www.test", 3600) == 0);
+    char text[BIG_TXT_LEN + 1];
+    memset(text, 't', BIG_TXT_LEN);
+    text[BIG_TXT_LEN] = '\0';
+    assert(add_record_to_tld(fx->tld_manager, "test", "big", DNS_RECORD_TYPE_TXT, text, 3600) == 0);
+}
+
+static void teardown_fixture(frontend_fixture_t* fx) {
+    cleanup_dns_resolver(fx->resolver);
+    cleanup_tld_manager(fx->tld_manager);
+    while (fx->cache->head) {
+        dns_cache_node_t* node = fx->cache->head;
+        fx->cache->head = node->next;
+        free(node->entry.fqdn);
+        free(node->entry.record.name);
+        free(node->entry.record.rdata);
+        free(node);
+    }
+    pthread_mutex_destroy(&fx->cache->lock);
+    free(fx->cache);
+}
+
+static size_t make_query(uint8_t* buf, uint16_t id, const char* name, uint16_t qtype, uint16_t qclass) {
+    memset(buf, 0, DNS_WIRE_HEADER_LEN);
+    buf[0] = (uint8_t)(id >> 8);
+    buf[1] = (uint8_t)id;
+    buf[2] = 0x01;
+    buf[5] = 1;
+    size_t off = DNS_WIRE_HEADER_LEN;
+    const char* label = name;
+    while (*label) {
+        const char* dot = strchr(label, '.');
+        size_t len = dot ? (size_t)(dot - label) : strlen(label);
+        buf[off++] = (uint8_t)len;
+        memcpy(buf + off, label, len);
+        off += len;
+        label += len + (dot ? 1 : 0);
+    }
+    buf[off++] = 0;
+    buf[off++] = (uint8_t)(qtype >> 8);
+    buf[off++] = (uint8_t)qtype;
+    buf[off++] = (uint8_t)(qclass >> 8);
+    buf[off++] = (uint8_t)qclass;
+    return off;
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void test_answer(frontend_fixture_t* fx) {
+    printf("Testing DNS frontend answers...\n");
+    uint8_t query[512], resp[DNS_WIRE_MAX_MESSAGE];
+
+    size_t len = make_query(query, 1, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN);
+    ssize_t n = dns_frontend_answer(fx->resolver, query, len, DNS_WIRE_DEFAULT_EDNS_SIZE, resp, sizeof(resp));
+    assert(n > 0);
+    assert((get16(resp + 2) & 0x0F) == DNS_STATUS_SUCCESS && get16(resp + 6) == 1);
+
+    // CNAME chain: the alias, then the target's address
+    len = make_query(query, 2, "alias.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN);
+    n = dns_frontend_answer(fx->resolver, query, len, DNS_WIRE_DEFAULT_EDNS_SIZE, resp, sizeof(resp));
+    assert(n > 0 && get16(resp + 6) == 2);
+
+    len = make_query(query, 3, "missing.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN);
+    n = dns_frontend_answer(fx->resolver, query, len, DNS_WIRE_DEFAULT_EDNS_SIZE, resp, sizeof(resp));
+    assert(n > 0 && (get16(resp + 2) & 0x0F) == DNS_STATUS_NXDOMAIN);
+
+    // Class CH is refused; a type the resolver cannot hold has no data
+    len = make_query(query, 4, "www.test", DNS_RECORD_TYPE_A, 3);
+    n = dns_frontend_answer(fx->resolver, query, len, DNS_WIRE_DEFAULT_EDNS_SIZE, resp, sizeof(resp));
+    assert(n > 0 && (get16(resp + 2) & 0x0F) == DNS_STATUS_REFUSED);
+    len = make_query(query, 5, "www.test", 13, DNS_WIRE_CLASS_IN);
+    n = dns_frontend_answer(fx->resolver, query, len, DNS_WIRE_DEFAULT_EDNS_SIZE, resp, sizeof(resp));
+    assert(n > 0 && (get16(resp + 2) & 0x0F) == DNS_STATUS_SUCCESS && get16(resp + 6) == 0);
+
+    // Over UDP a large answer is truncated; over a stream it is not
+    len = make_query(query, 6, "big.test", DNS_RECORD_TYPE_TXT, DNS_WIRE_CLASS_IN);
+    n = dns_frontend_answer(fx->resolver, query, len, DNS_WIRE_DEFAULT_EDNS_SIZE, resp, sizeof(resp));
+    assert(n > 0 && n <= DNS_WIRE_CLASSIC_UDP_SIZE && (get16(resp + 2) & DNS_WIRE_FLAG_TC));
+    n = dns_frontend_answer(fx->resolver, query, len, 0, resp, sizeof(resp));
+    assert(n > BIG_TXT_LEN && !(get16(resp + 2) & DNS_WIRE_FLAG_TC));
+
+    // Responses get no answer
+    query[2] |= 0x80;
+    assert(dns_frontend_answer(fx->resolver, query, len, DNS_WIRE_DEFAULT_EDNS_SIZE, resp, sizeof(resp)) == -1);
+
+    printf("DNS frontend answer test passed\n");
+}
+
+static void loopback_address(struct sockaddr_in* addr, uint16_t port) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+static ssize_t udp_exchange(uint16_t port, const uint8_t* query, size_t len, uint8_t* resp, size_t cap) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(fd >= 0);
+    struct sockaddr_in addr;
+    loopback_address(&addr, port);
+    assert(sendto(fd, query, len, 0, (struct sockaddr*)&addr, sizeof(addr)) == (ssize_t)len);
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    ssize_t n = poll(&pfd, 1, 2000) == 1 ? recv(fd, resp, cap, 0) : -1;
+    close(fd);
+    return n;
+}
+
+static int tcp_connect(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    struct sockaddr_in addr;
+    loopback_address(&addr, port);
+    assert(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    return fd;
+}
+
+// Reads one length-prefixed message
+static ssize_t tcp_read_message(int fd, uint8_t* resp, size_t cap) {
+    uint8_t prefix[2];
+    size_t got = 0;
+    while (got < 2) {
+        ssize_t n = recv(fd, prefix + got, 2 - got, 0);
+        if (n <= 0) return -1;
+        got += (size_t)n;
+    }
+    size_t len = get16(prefix);
+    if (len > cap) return -1;
+    got = 0;
+    while (got < len) {
+        ssize_t n = recv(fd, resp + got, len - got, 0);
+        if (n <= 0) return -1;
+        got += (size_t)n;
+    }
+    return (ssize_t)len;
+}
+
+static void test_loopback(frontend_fixture_t* fx) {
+    printf("Testing DNS frontend over loopback UDP and TCP...\n");
+
+    dns_frontend_config_t config;
+    dns_frontend_default_config(&config);
+    assert(config.udp_workers >= 1 && config.udp_workers <= DNS_FRONTEND_MAX_WORKERS);
+    assert(config.tcp_workers >= 1 && config.tcp_workers <= DNS_FRONTEND_MAX_WORKERS);
+    config.bind_address = "127.0.0.1";
+    config.port = 0;
+    config.udp_workers = 2;
+    config.tcp_workers = 2;
+    dns_frontend_t* frontend = NULL;
+    assert(init_dns_frontend(&config, fx->resolver, &frontend) == 0);
+    uint16_t port = dns_frontend_port(frontend);
+    assert(port != 0);
+
+    uint8_t query[512], resp[DNS_WIRE_MAX_MESSAGE];
+    size_t len = make_query(query, 0x4242, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN);
+    ssize_t n = udp_exchange(port, query, len, resp, sizeof(resp));
+    assert(n > 0 && get16(resp) == 0x4242 && get16(resp + 6) == 1);
+    assert(memcmp(resp + n - 4, "\xc0\xa8\x01\x01", 4) == 0);
+
+    // Truncated over UDP, so retry over TCP like a stub resolver would
+    len = make_query(query, 0x4343, "big.test", DNS_RECORD_TYPE_TXT, DNS_WIRE_CLASS_IN);
+    n = udp_exchange(port, query, len, resp, sizeof(resp));
+    assert(n > 0 && n <= DNS_WIRE_CLASSIC_UDP_SIZE && (get16(resp + 2) & DNS_WIRE_FLAG_TC));
+
+    int fd = tcp_connect(port);
+    uint8_t framed[2 + 512];
+    framed[0] = (uint8_t)(len >> 8);
+    framed[1] = (uint8_t)len;
+    memcpy(framed + 2, query, len);
+    assert(send(fd, framed, len + 2, 0) == (ssize_t)(len + 2));
+    n = tcp_read_message(fd, resp, sizeof(resp));
+    assert(n > BIG_TXT_LEN && get16(resp) == 0x4343);
+    assert(!(get16(resp + 2) & DNS_WIRE_FLAG_TC) && get16(resp + 6) == 1);
+
+    // Two pipelined queries in one write, answered in order
+    uint8_t pipelined[2 * (2 + 512)];
+    size_t off = 0;
+    for (uint16_t id = 1; id <= 2; id++) {
+        size_t qlen = make_query(pipelined + off + 2, id, id == 1 ? "www.test" : "alias.test",
+                                 DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN);
+        pipelined[off] = (uint8_t)(qlen >> 8);
+        pipelined[off + 1] = (uint8_t)qlen;
+        off += qlen + 2;
+    }
+    assert(send(fd, pipelined, off, 0) == (ssize_t)off);
+    n = tcp_read_message(fd, resp, sizeof(resp));
+    assert(n > 0 && get16(resp) == 1 && get16(resp + 6) == 1);
+    n = tcp_read_message(fd, resp, sizeof(resp));
+    assert(n > 0 && get16(resp) == 2 && get16(resp + 6) == 2);
+
+    // A connection stalled mid-request does not hold up another one
+    assert(send(fd, framed, 3, 0) == 3);
+    int other = tcp_connect(port);
+    assert(send(other, framed, len + 2, 0) == (ssize_t)(len + 2));
+    n = tcp_read_message(other, resp, sizeof(resp));
+    assert(n > BIG_TXT_LEN && get16(resp) == 0x4343);
+    close(other);
+    close(fd);
+
+    cleanup_dns_frontend(frontend);
+    printf("DNS frontend loopback test passed\n");
+}
+
+void test_dns_frontend_all(void) {
+    printf("Running all DNS frontend tests...\n");
+
+    frontend_fixture_t fx;
+    memset(&fx, 0, sizeof(fx));
+    setup_fixture(&fx);
+
+    test_answer(&fx);
+    test_loopback(&fx);
+
+    teardown_fixture(&fx);
+    printf("All DNS frontend tests passed!\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_DNS_FRONTEND_H
+#define TEST_DNS_FRONTEND_H
+
+void test_dns_frontend_all(void);
+
+#endif // TEST_DNS_FRONTEND_H
@@ -5,6 +5,7 @@
 #include "../include/dns_resolver.h"
 #include "../include/tld_manager.h"
 #include "../include/debug.h"
+#include "../include/metrics.h"
 
 // Test helper function
 static void test_assert(int condition, const char* test_name) {
@@ -16,6 +17,14 @@ static void test_assert(int condition, const char* test_name) {
     }
 }
 
+static void free_records(dns_record_t* records, int record_count) {
+    for (int i = 0; i < record_count; i++) {
+        free(records[i].name);
+        free(records[i].rdata);
+    }
+    free(records);
+}
+
 int test_dns_resolver() {
     printf(">>> Testing DNS Resolver <<<\n");
     
@@ -148,6 +157,76 @@ int test_dns_resolver() {
     test_assert(status == DNS_STATUS_NXDOMAIN, "Non-existent record returns NXDOMAIN");
     test_assert(record_count == 0, "Non-existent record count is 0");
     
+    // Test resolution into a request arena: nothing to free per record
+    query_arena_t* arena = NULL;
+    test_assert(init_query_arena(256, &arena) == 0, "Initialize request arena");
+    status = resolve_dns_query_in_arena(resolver, "alias.test", DNS_RECORD_TYPE_A, arena, &records, &record_count);
+    test_assert(status == DNS_STATUS_SUCCESS && record_count == 2, "Arena CNAME resolution");
+    test_assert(records[0].type == DNS_RECORD_TYPE_CNAME && strcmp(records[1].rdata, "192.168.1.1") == 0,
+                "Arena CNAME chain contents");
+    test_assert(query_arena_used(arena) > 0, "Arena holds the records");
+    query_arena_reset(arena);
+    status = resolve_dns_query_in_arena(resolver, "www.test", DNS_RECORD_TYPE_AAAA, arena, &records, &record_count);
+    test_assert(status == DNS_STATUS_SUCCESS && record_count == 1 && strcmp(records[0].rdata, "2001:db8::1") == 0,
+                "Arena resolution after reset");
+    status = resolve_dns_query_in_arena(resolver, "missing.test", DNS_RECORD_TYPE_A, arena, &records, &record_count);
+    test_assert(status == DNS_STATUS_NXDOMAIN && record_count == 0, "Arena resolution of a missing name");
+    cleanup_query_arena(arena);
+    records = NULL;
+    record_count = 0;
+    
+    // Test a CNAME chain: c1 -> c2 -> c3 -> www
+    test_assert(add_record_to_tld(tld_manager, "test", "c1", DNS_RECORD_TYPE_CNAME, "c2.test", 3600) == 0 &&
+                add_record_to_tld(tld_manager, "test", "c2", DNS_RECORD_TYPE_CNAME, "c3.test", 600) == 0 &&
+                add_record_to_tld(tld_manager, "test", "c3", DNS_RECORD_TYPE_CNAME, "www.test", 3600) == 0,
+                "Add CNAME chain");
+    uint64_t chain_hits = metrics_counter_value(METRIC_DNS_CNAME_CHAIN_HITS);
+    status = resolve_dns_query(resolver, "c1.test", DNS_RECORD_TYPE_A, &records, &record_count);
+    test_assert(status == DNS_STATUS_SUCCESS && record_count == 4, "Resolve CNAME chain");
+    test_assert(strcmp(records[0].rdata, "c2.test") == 0 && strcmp(records[2].rdata, "www.test") == 0 &&
+                strcmp(records[3].rdata, "192.168.1.1") == 0, "CNAME chain in order");
+    free_records(records, record_count);
+    
+    // The second query is answered by the flattened chain
+    status = resolve_dns_query(resolver, "c1.test", DNS_RECORD_TYPE_A, &records, &record_count);
+    test_assert(status == DNS_STATUS_SUCCESS && record_count == 4 &&
+                strcmp(records[3].rdata, "192.168.1.1") == 0, "Resolve cached CNAME chain");
+    test_assert(metrics_counter_value(METRIC_DNS_CNAME_CHAIN_HITS) == chain_hits + 1, "CNAME chain cache hit");
+    for (int i = 0; i < record_count; i++) {
+        test_assert(records[i].ttl <= 600, "Cached chain TTLs within the shortest");
+    }
+    free_records(records, record_count);
+    
+    // A record change drops the flattened chain
+    test_assert(add_record_to_tld(tld_manager, "test", "www", DNS_RECORD_TYPE_A, "192.168.1.2", 3600) == 0,
+                "Add second A record");
+    status = resolve_dns_query(resolver, "c1.test", DNS_RECORD_TYPE_A, &records, &record_count);
+    test_assert(status == DNS_STATUS_SUCCESS && record_count >= 4, "CNAME chain resolved again after a change");
+    test_assert(metrics_counter_value(METRIC_DNS_CNAME_CHAIN_HITS) == chain_hits + 1, "Changed chain not served from cache");
+    free_records(records, record_count);
+    
+    // A CNAME loop fails instead of recursing forever
+    test_assert(add_record_to_tld(tld_manager, "test", "loopa", DNS_RECORD_TYPE_CNAME, "loopb.test", 3600) == 0 &&
+                add_record_to_tld(tld_manager, "test", "loopb", DNS_RECORD_TYPE_CNAME, "loopa.test", 3600) == 0,
+                "Add CNAME loop");
+    status = resolve_dns_query(resolver, "loopa.test", DNS_RECORD_TYPE_A, &records, &record_count);
+    test_assert(status == DNS_STATUS_SERVFAIL && record_count == 0, "CNAME loop returns SERVFAIL");
+    
+    // Chains longer than the configured depth fail, cached or not
+    dns_resolver_config_t config = resolver->config;
+    config.max_recursion_depth = 2;
+    test_assert(configure_dns_resolver(resolver, &config) == 0, "Limit CNAME chain length");
+    status = resolve_dns_query(resolver, "c1.test", DNS_RECORD_TYPE_A, &records, &record_count);
+    test_assert(status == DNS_STATUS_SERVFAIL && record_count == 0, "Overlong CNAME chain returns SERVFAIL");
+    status = resolve_cname(resolver, "c3.test", DNS_RECORD_TYPE_A, &records, &record_count, 1);
+    test_assert(status == DNS_STATUS_SUCCESS && record_count >= 2 && records[0].type == DNS_RECORD_TYPE_CNAME &&
+                records[record_count - 1].type == DNS_RECORD_TYPE_A, "CNAME target within the remaining depth");
+    free_records(records, record_count);
+    status = resolve_cname(resolver, "c3.test", DNS_RECORD_TYPE_A, &records, &record_count, 2);
+    test_assert(status == DNS_STATUS_SERVFAIL, "CNAME target beyond the remaining depth");
+    records = NULL;
+    record_count = 0;
+    
     // Test external DNS resolution (if enabled)
     if (resolver->config.enable_recursive_resolution) {
         printf("  Testing external DNS resolution...\n");
@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/dns_wire.h"
+#include "test_dns_wire.h"
+
+#define RECORD(n, t, l, d) { .name = (char*)(n), .type = (t), .ttl = (l), .rdata = (char*)(d) }
+
+// Builds a query for name; edns_size 0 leaves out the OPT record
+static size_t make_query(uint8_t* buf, uint16_t id, const char* name, uint16_t qtype, uint16_t qclass,
+                         uint16_t edns_size, uint8_t edns_version) {
+    memset(buf, 0, DNS_WIRE_HEADER_LEN);
+    buf[0] = (uint8_t)(id >> 8);
+    buf[1] = (uint8_t)id;
+    buf[2] = 0x01;                          // RD
+    buf[5] = 1;
+    buf[11] = edns_size ? 1 : 0;
+    size_t off = DNS_WIRE_HEADER_LEN;
+    const char* label = name;
+    while (*label) {
+        const char* dot = strchr(label, '.');
+        size_t len = dot ? (size_t)(dot - label) : strlen(label);
+        buf[off++] = (uint8_t)len;
+        memcpy(buf + off, label, len);
+        off += len;
+        label += len + (dot ? 1 : 0);
+    }
+    buf[off++] = 0;
+    buf[off++] = (uint8_t)(qtype >> 8);
+    buf[off++] = (uint8_t)qtype;
+    buf[off++] = (uint8_t)(qclass >> 8);
+    buf[off++] = (uint8_t)qclass;
+    if (edns_size) {
+        uint8_t opt[DNS_WIRE_OPT_RR_LEN] = { 0, 0, DNS_WIRE_TYPE_OPT, (uint8_t)(edns_size >> 8), (uint8_t)edns_size,
+                                             0, edns_version, 0, 0, 0, 0 };
+        memcpy(buf + off, opt, sizeof(opt));
+        off += sizeof(opt);
+    }
+    return off;
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Offset of the first answer record, right after the question
+static size_t answer_offset(const dns_wire_query_t* query) {
+    return DNS_WIRE_HEADER_LEN + query->question_len;
+}
+
+static void test_parse_query(void) {
+    printf("Testing DNS wire query parsing...\n");
+    uint8_t msg[512];
+    dns_wire_query_t query;
+
+    size_t len = make_query(msg, 0x1234, "WWW.Example.TEST", DNS_RECORD_TYPE_AAAA, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    assert(query.id == 0x1234);
+    assert(strcmp(query.qname, "www.example.test") == 0);
+    assert(query.qtype == DNS_RECORD_TYPE_AAAA);
+    assert(query.qclass == DNS_WIRE_CLASS_IN);
+    assert(query.question_len == len - DNS_WIRE_HEADER_LEN);
+    assert(!query.has_edns);
+
+    // EDNS0, with a too-small size raised to 512
+    len = make_query(msg, 1, "a.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 4096, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    assert(query.has_edns && query.edns_udp_size == 4096);
+    len = make_query(msg, 1, "a.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 100, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    assert(query.edns_udp_size == DNS_WIRE_CLASSIC_UDP_SIZE);
+
+    // Unknown EDNS version
+    len = make_query(msg, 1, "a.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 1232, 1);
+    assert(dns_wire_parse_query(msg, len, &query) == DNS_WIRE_RCODE_BADVERS);
+
+    // Root name
+    len = make_query(msg, 1, "", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    assert(query.qname[0] == '\0');
+
+    // Malformed requests get FORMERR, other opcodes NOTIMP
+    len = make_query(msg, 1, "a.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len - 1, &query) == DNS_STATUS_FORMERR);
+    msg[5] = 2;
+    assert(dns_wire_parse_query(msg, len, &query) == DNS_STATUS_FORMERR);
+    msg[5] = 1;
+    msg[DNS_WIRE_HEADER_LEN] = 0xC0;        // Compressed question name
+    assert(dns_wire_parse_query(msg, len, &query) == DNS_STATUS_FORMERR);
+    len = make_query(msg, 1, "a.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    msg[2] |= 0x10;                         // Opcode 2 (STATUS)
+    assert(dns_wire_parse_query(msg, len, &query) == DNS_STATUS_NOTIMP);
+
+    // Responses and runts are dropped
+    len = make_query(msg, 1, "a.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    msg[2] |= 0x80;
+    assert(dns_wire_parse_query(msg, len, &query) == -1);
+    assert(dns_wire_parse_query(msg, DNS_WIRE_HEADER_LEN - 1, &query) == -1);
+
+    printf("DNS wire query parsing test passed\n");
+}
+
+static void test_build_records(void) {
+    printf("Testing DNS wire record encoding...\n");
+    uint8_t msg[512], resp[1024];
+    dns_wire_query_t query;
+
+    dns_record_t a = RECORD("www", DNS_RECORD_TYPE_A, 300, "192.168.1.1");
+    size_t len = make_query(msg, 7, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    ssize_t n = dns_wire_build_response(&query, 0, 1, &a, 1, 1232, resp, sizeof(resp));
+    assert(n > 0);
+    assert(get16(resp) == 7);
+    uint16_t flags = get16(resp + 2);
+    assert(flags & DNS_WIRE_FLAG_QR);
+    assert(flags & DNS_WIRE_FLAG_RD);
+    assert(flags & DNS_WIRE_FLAG_RA);
+    assert(!(flags & DNS_WIRE_FLAG_TC));
+    assert((flags & 0x0F) == 0);
+    assert(get16(resp + 4) == 1 && get16(resp + 6) == 1 && get16(resp + 10) == 0);
+    assert(memcmp(resp + DNS_WIRE_HEADER_LEN, query.question, query.question_len) == 0);
+    const uint8_t* rr = resp + answer_offset(&query);
+    assert(get16(rr) == (0xC000 | DNS_WIRE_HEADER_LEN));   // Owner points at the question
+    assert(get16(rr + 2) == DNS_RECORD_TYPE_A && get16(rr + 4) == DNS_WIRE_CLASS_IN);
+    assert(get16(rr + 8) == 300);
+    assert(get16(rr + 10) == 4);
+    assert(rr[12] == 192 && rr[13] == 168 && rr[14] == 1 && rr[15] == 1);
+    assert(n == (ssize_t)(answer_offset(&query) + 16));
+
+    // AAAA
+    dns_record_t aaaa = RECORD("www", DNS_RECORD_TYPE_AAAA, 60, "2001:db8::1");
+    len = make_query(msg, 8, "www.test", DNS_RECORD_TYPE_AAAA, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    n = dns_wire_build_response(&query, 0, 0, &aaaa, 1, 1232, resp, sizeof(resp));
+    rr = resp + answer_offset(&query);
+    assert(get16(rr + 10) == 16 && rr[12] == 0x20 && rr[13] == 0x01 && rr[27] == 1);
+    assert(!(get16(resp + 2) & DNS_WIRE_FLAG_RA));
+
+    // MX: preference then the exchange name
+    dns_record_t mx = RECORD("mail", DNS_RECORD_TYPE_MX, 60, "10 mail.test");
+    len = make_query(msg, 9, "mail.test", DNS_RECORD_TYPE_MX, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    n = dns_wire_build_response(&query, 0, 0, &mx, 1, 1232, resp, sizeof(resp));
+    rr = resp + answer_offset(&query);
+    assert(get16(rr + 10) == 2 + 11);
+    assert(get16(rr + 12) == 10);
+    assert(memcmp(rr + 14, "\x04mail\x04test\x00", 11) == 0);
+
+    // SRV: priority, weight, port, target
+    dns_record_t srv = RECORD("_http._tcp", DNS_RECORD_TYPE_SRV, 60, "10 20 80 web.test");
+    len = make_query(msg, 10, "_http._tcp.test", DNS_RECORD_TYPE_SRV, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    n = dns_wire_build_response(&query, 0, 0, &srv, 1, 1232, resp, sizeof(resp));
+    rr = resp + answer_offset(&query);
+    assert(get16(rr + 12) == 10 && get16(rr + 14) == 20 && get16(rr + 16) == 80);
+    assert(memcmp(rr + 18, "\x03web\x04test\x00", 10) == 0);
+
+    // TXT longer than 255 bytes is split into character-strings
+    char text[301];
+    memset(text, 'x', 300);
+    text[300] = '\0';
+    dns_record_t txt = RECORD("info", DNS_RECORD_TYPE_TXT, 60, text);
+    len = make_query(msg, 11, "info.test", DNS_RECORD_TYPE_TXT, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    n = dns_wire_build_response(&query, 0, 0, &txt, 1, 1232, resp, sizeof(resp));
+    rr = resp + answer_offset(&query);
+    assert(get16(rr + 10) == 302);
+    assert(rr[12] == 255 && rr[12 + 256] == 45);
+
+    // Data that does not match its type cannot be encoded
+    dns_record_t bad = RECORD("www", DNS_RECORD_TYPE_A, 60, "not-an-address");
+    len = make_query(msg, 12, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    assert(dns_wire_build_response(&query, 0, 0, &bad, 1, 1232, resp, sizeof(resp)) == -1);
+
+    printf("DNS wire record encoding test passed\n");
+}
+
+static void test_build_cname_chain(void) {
+    printf("Testing DNS wire CNAME chains...\n");
+    uint8_t msg[512], resp[1024];
+    dns_wire_query_t query;
+
+    // Resolver order: the CNAME, then its target's records
+    dns_record_t chain[] = {
+        RECORD("alias", DNS_RECORD_TYPE_CNAME, 300, "www.test"),
+        RECORD("www", DNS_RECORD_TYPE_A, 300, "192.168.1.1"),
+        RECORD("www", DNS_RECORD_TYPE_A, 300, "192.168.1.2"),
+    };
+    size_t len = make_query(msg, 1, "Alias.Test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    ssize_t n = dns_wire_build_response(&query, 0, 0, chain, 3, 1232, resp, sizeof(resp));
+    assert(n > 0);
+    assert(get16(resp + 6) == 3);
+    // The question keeps the requestor's case
+    assert(memcmp(resp + DNS_WIRE_HEADER_LEN, "\x05" "Alias", 6) == 0);
+
+    const uint8_t* rr = resp + answer_offset(&query);
+    assert(get16(rr) == (0xC000 | DNS_WIRE_HEADER_LEN));
+    assert(get16(rr + 2) == DNS_RECORD_TYPE_CNAME);
+    size_t target_offset = (size_t)(rr + 12 - resp);
+    assert(memcmp(rr + 12, "\x03www\x04test\x00", 10) == 0);
+
+    // Both A records are owned by the CNAME target, pointing at its rdata
+    rr += 12 + get16(rr + 10);
+    assert(get16(rr) == (0xC000 | target_offset));
+    assert(get16(rr + 2) == DNS_RECORD_TYPE_A);
+    rr += 12 + get16(rr + 10);
+    assert(get16(rr) == (0xC000 | target_offset));
+    assert(rr[15] == 2);
+    assert(rr + 16 == resp + n);
+
+    printf("DNS wire CNAME chain test passed\n");
+}
+
+static void test_build_edns_and_errors(void) {
+    printf("Testing DNS wire EDNS0 and error answers...\n");
+    uint8_t msg[512], resp[1024];
+    dns_wire_query_t query;
+
+    dns_record_t a = RECORD("www", DNS_RECORD_TYPE_A, 300, "192.168.1.1");
+    size_t len = make_query(msg, 1, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 4096, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    ssize_t n = dns_wire_build_response(&query, 0, 0, &a, 1, 1232, resp, sizeof(resp));
+    assert(get16(resp + 10) == 1);
+    const uint8_t* opt = resp + n - DNS_WIRE_OPT_RR_LEN;
+    assert(opt[0] == 0 && get16(opt + 1) == DNS_WIRE_TYPE_OPT && get16(opt + 3) == 1232);
+
+    // BADVERS: the low bits in the header, the rest in the OPT TTL
+    len = make_query(msg, 1, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 4096, 3);
+    int rcode = dns_wire_parse_query(msg, len, &query);
+    assert(rcode == DNS_WIRE_RCODE_BADVERS);
+    n = dns_wire_build_response(&query, rcode, 0, NULL, 0, 1232, resp, sizeof(resp));
+    assert((get16(resp + 2) & 0x0F) == 0);
+    assert(get16(resp + 6) == 0);
+    opt = resp + n - DNS_WIRE_OPT_RR_LEN;
+    assert(opt[5] == 1);
+
+    // NXDOMAIN ignores any records
+    len = make_query(msg, 1, "nope.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    n = dns_wire_build_response(&query, DNS_STATUS_NXDOMAIN, 0, &a, 1, 1232, resp, sizeof(resp));
+    assert((get16(resp + 2) & 0x0F) == DNS_STATUS_NXDOMAIN && get16(resp + 6) == 0);
+    assert(n == (ssize_t)answer_offset(&query));
+
+    // FORMERR for an unreadable question echoes only the header
+    memset(msg, 0, DNS_WIRE_HEADER_LEN);
+    msg[1] = 5;
+    rcode = dns_wire_parse_query(msg, DNS_WIRE_HEADER_LEN, &query);
+    assert(rcode == DNS_STATUS_FORMERR);
+    n = dns_wire_build_response(&query, rcode, 0, NULL, 0, 1232, resp, sizeof(resp));
+    assert(n == DNS_WIRE_HEADER_LEN && get16(resp) == 5 && get16(resp + 4) == 0);
+
+    printf("DNS wire EDNS0 and error answer test passed\n");
+}
+
+static void test_build_truncation(void) {
+    printf("Testing DNS wire truncation...\n");
+    uint8_t msg[512], resp[DNS_WIRE_CLASSIC_UDP_SIZE];
+    dns_wire_query_t query;
+
+    // 40 A records need 40 * 16 bytes, more than 512
+    dns_record_t records[40];
+    for (int i = 0; i < 40; i++) {
+        records[i] = (dns_record_t)RECORD("www", DNS_RECORD_TYPE_A, 60, "10.0.0.1");
+    }
+    size_t len = make_query(msg, 1, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    ssize_t n = dns_wire_build_response(&query, 0, 0, records, 40, 1232, resp, sizeof(resp));
+    assert(n == (ssize_t)answer_offset(&query));
+    assert(get16(resp + 2) & DNS_WIRE_FLAG_TC);
+    assert(get16(resp + 6) == 0);
+
+    // The OPT record survives truncation
+    len = make_query(msg, 1, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 512, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    n = dns_wire_build_response(&query, 0, 0, records, 40, 1232, resp, sizeof(resp));
+    assert(get16(resp + 2) & DNS_WIRE_FLAG_TC);
+    assert(n == (ssize_t)(answer_offset(&query) + DNS_WIRE_OPT_RR_LEN) && get16(resp + 10) == 1);
+
+    // Exactly enough room: not truncated
+    len = make_query(msg, 1, "www.test", DNS_RECORD_TYPE_A, DNS_WIRE_CLASS_IN, 0, 0);
+    assert(dns_wire_parse_query(msg, len, &query) == 0);
+    size_t exact = answer_offset(&query) + 3 * 16;
+    n = dns_wire_build_response(&query, 0, 0, records, 3, 1232, resp, exact);
+    assert(n == (ssize_t)exact && !(get16(resp + 2) & DNS_WIRE_FLAG_TC));
+    n = dns_wire_build_response(&query, 0, 0, records, 3, 1232, resp, exact - 1);
+    assert(get16(resp + 2) & DNS_WIRE_FLAG_TC);
+
+    // No room for the question at all
+    assert(dns_wire_build_response(&query, 0, 0, NULL, 0, 1232, resp, DNS_WIRE_HEADER_LEN) == -1);
+
+    printf("DNS wire truncation test passed\n");
+}
+
+void test_dns_wire_all(void) {
+    printf("Running all DNS wire format tests...\n");
+
+    test_parse_query();
+    test_build_records();
+    test_build_cname_chain();
+    test_build_edns_and_errors();
+    test_build_truncation();
+
+    printf("All DNS wire format tests passed!\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_DNS_WIRE_H
+#define TEST_DNS_WIRE_H
+
+void test_dns_wire_all(void);
+
+#endif // TEST_DNS_WIRE_H
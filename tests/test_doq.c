@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/doq.h"
+#include "../include/dns_wire.h"
+#include "../include/dns_resolver.h"
+#include "../include/tld_manager.h"
+#include "test_doq.h"
+
+// A length-prefixed query for www.test A with the given message ID
+static size_t make_request(uint8_t* buf, uint16_t id) {
+    static const uint8_t question[] = "\x03www\x04test\x00\x00\x01\x00\x01";
+    size_t message_len = DNS_WIRE_HEADER_LEN + sizeof(question) - 1;
+    memset(buf, 0, 2 + DNS_WIRE_HEADER_LEN);
+    buf[0] = (uint8_t)(message_len >> 8);
+    buf[1] = (uint8_t)message_len;
+    buf[2] = (uint8_t)(id >> 8);
+    buf[3] = (uint8_t)id;
+    buf[4] = 0x01;                          // RD
+    buf[7] = 1;                             // QDCOUNT
+    memcpy(buf + 2 + DNS_WIRE_HEADER_LEN, question, sizeof(question) - 1);
+    return 2 + message_len;
+}
+
+static void test_alpn(void) {
+    printf("Testing DoQ ALPN selection...\n");
+    assert(doq_alpn_selected((const unsigned char*)"doq", 3));
+    assert(!doq_alpn_selected((const unsigned char*)"h3", 2));
+    assert(!doq_alpn_selected((const unsigned char*)"doq-i02", 7));
+    assert(!doq_alpn_selected(NULL, 0));
+    printf("DoQ ALPN selection test passed\n");
+}
+
+static void test_stream_framing(void) {
+    printf("Testing DoQ stream framing...\n");
+    uint8_t request[64];
+    size_t len = make_request(request, 0);
+    doq_stream_t* stream = NULL;
+
+    // Byte by byte, the length prefix split too
+    assert(init_doq_stream(&stream) == 0);
+    for (size_t i = 0; i + 1 < len; i++) {
+        assert(doq_stream_receive(stream, request + i, 1, 0) == DOQ_STREAM_INCOMPLETE);
+    }
+    assert(doq_stream_receive(stream, request + len - 1, 1, 1) == DOQ_STREAM_READY);
+    assert(memcmp(stream->request, request, len) == 0);
+    cleanup_doq_stream(stream);
+
+    // FIN before the query is complete
+    assert(init_doq_stream(&stream) == 0);
+    assert(doq_stream_receive(stream, request, len - 3, 1) == -1);
+    cleanup_doq_stream(stream);
+    assert(init_doq_stream(&stream) == 0);
+    assert(doq_stream_receive(stream, NULL, 0, 1) == -1);
+    cleanup_doq_stream(stream);
+
+    // Empty message
+    assert(init_doq_stream(&stream) == 0);
+    assert(doq_stream_receive(stream, (const uint8_t*)"\x00\x00", 2, 0) == -1);
+    cleanup_doq_stream(stream);
+
+    // A second message on the same stream
+    uint8_t twice[128];
+    memcpy(twice, request, len);
+    memcpy(twice + len, request, len);
+    assert(init_doq_stream(&stream) == 0);
+    assert(doq_stream_receive(stream, twice, 2 * len, 0) == -1);
+    cleanup_doq_stream(stream);
+
+    printf("DoQ stream framing test passed\n");
+}
+
+static void test_stream_answer(void) {
+    printf("Testing DoQ stream answers...\n");
+    tld_manager_t* tld_manager = NULL;
+    assert(init_tld_manager(&tld_manager) == 0);
+    dns_cache_t* cache = calloc(1, sizeof(dns_cache_t));
+    assert(cache);
+    cache->max_size = 100;
+    pthread_mutex_init(&cache->lock, NULL);
+    dns_resolver_t* resolver = NULL;
+    assert(init_dns_resolver(&resolver, tld_manager, cache) == 0);
+    assert(register_new_tld(tld_manager, "test") != NULL);
+    assert(add_record_to_tld(tld_manager, "test", "www", DNS_RECORD_TYPE_A, "192.168.1.1", 3600) == 0);
+
+    uint8_t request[64];
+    size_t len = make_request(request, 0);
+    doq_stream_t* stream = NULL;
+    assert(init_doq_stream(&stream) == 0);
+    assert(doq_stream_receive(stream, request, len, 0) == DOQ_STREAM_READY);
+    assert(doq_stream_answer(stream, resolver) == 0);
+    assert(stream->answered && !stream->request);
+
+    // Length-prefixed, ID 0, one A record, full size over a stream
+    const uint8_t* resp = stream->response;
+    assert(stream->response_len == 2 + (size_t)(resp[0] << 8 | resp[1]));
+    assert(resp[2] == 0 && resp[3] == 0);
+    assert(resp[4] & 0x80);
+    assert((resp[5] & 0x0F) == DNS_STATUS_SUCCESS);
+    assert(resp[8] == 0 && resp[9] == 1);
+    assert(memcmp(resp + stream->response_len - 4, "\xc0\xa8\x01\x01", 4) == 0);
+
+    // Only the client's FIN may follow
+    assert(doq_stream_receive(stream, NULL, 0, 1) == DOQ_STREAM_INCOMPLETE);
+    assert(doq_stream_receive(stream, request, 2, 0) == -1);
+    assert(doq_stream_answer(stream, resolver) == DOQ_INTERNAL_ERROR);
+    cleanup_doq_stream(stream);
+
+    // A non-zero message ID is a protocol error
+    len = make_request(request, 0x1234);
+    assert(init_doq_stream(&stream) == 0);
+    assert(doq_stream_receive(stream, request, len, 1) == DOQ_STREAM_READY);
+    assert(doq_stream_answer(stream, resolver) == DOQ_PROTOCOL_ERROR);
+    assert(!stream->answered);
+    cleanup_doq_stream(stream);
+
+    // So is something that is not a query
+    len = make_request(request, 0);
+    request[4] |= 0x80;
+    assert(init_doq_stream(&stream) == 0);
+    assert(doq_stream_receive(stream, request, len, 1) == DOQ_STREAM_READY);
+    assert(doq_stream_answer(stream, resolver) == DOQ_PROTOCOL_ERROR);
+    cleanup_doq_stream(stream);
+
+    cleanup_dns_resolver(resolver);
+    cleanup_tld_manager(tld_manager);
+    while (cache->head) {
+        dns_cache_node_t* node = cache->head;
+        cache->head = node->next;
+        free(node->entry.fqdn);
+        free(node->entry.record.name);
+        free(node->entry.record.rdata);
+        free(node);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+    printf("DoQ stream answer test passed\n");
+}
+
+void test_doq_all(void) {
+    printf("Running all DNS over QUIC tests...\n");
+
+    test_alpn();
+    test_stream_framing();
+    test_stream_answer();
+
+    printf("All DNS over QUIC tests passed!\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_DOQ_H
+#define TEST_DOQ_H
+
+void test_doq_all(void);
+
+#endif // TEST_DOQ_H
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/keygen_pool.h"
+#include "../include/certificate_authority.h"
+#include "../include/network_context.h"
+#include "test_keygen_pool.h"
+
+static void test_pool_refill(void) {
+    printf("Testing keygen pool refill...\n");
+    keygen_pool_t* pool = NULL;
+    assert(init_keygen_pool(4, 2, 2, &pool) == 0);
+    assert(keygen_pool_wait_ready(pool, 60000) == 0);
+
+    size_t falcon_ready = 0, rsa_ready = 0;
+    uint64_t hits = 0, misses = 0;
+    keygen_pool_stats(pool, &falcon_ready, &rsa_ready, &hits, &misses);
+    assert(falcon_ready == 4 && rsa_ready == 2);
+
+    // Pooled pairs are real key pairs
+    uint8_t public_key[FALCON_PUBKEY_SIZE_1024];
+    uint8_t private_key[FALCON_PRIVKEY_SIZE_1024];
+    assert(keygen_pool_take_falcon(pool, public_key, private_key) == 0);
+    const char* message = "pooled key";
+    uint8_t signature[FALCON_SIG_LEN];
+    assert(falcon_sign(private_key, message, strlen(message), signature) == 0);
+    assert(falcon_verify_sig(public_key, message, strlen(message), signature) == 0);
+
+    EVP_PKEY* rsa = keygen_pool_take_rsa(pool);
+    assert(rsa != NULL && EVP_PKEY_get_bits(rsa) == KEYGEN_RSA_BITS);
+    EVP_PKEY_free(rsa);
+
+    keygen_pool_stats(pool, NULL, NULL, &hits, &misses);
+    assert(hits == 2 && misses == 0);
+
+    // Workers top the reserves back up
+    assert(keygen_pool_wait_ready(pool, 60000) == 0);
+    keygen_pool_stats(pool, &falcon_ready, &rsa_ready, NULL, NULL);
+    assert(falcon_ready == 4 && rsa_ready == 2);
+    cleanup_keygen_pool(pool);
+
+    // Without a pool, or with an empty one, keys are generated inline
+    rsa = keygen_pool_take_rsa(NULL);
+    assert(rsa != NULL);
+    EVP_PKEY_free(rsa);
+    assert(init_keygen_pool(0, 0, 1, &pool) == 0);
+    assert(keygen_pool_take_falcon(pool, public_key, private_key) == 0);
+    keygen_pool_stats(pool, NULL, NULL, &hits, &misses);
+    assert(hits == 0 && misses == 1);
+    cleanup_keygen_pool(pool);
+}
+
+static void test_pooled_issuance(void) {
+    printf("Testing certificate issuance from the keygen pool...\n");
+    keygen_pool_t* pool = NULL;
+    assert(init_keygen_pool(4, 4, 2, &pool) == 0);
+    set_default_keygen_pool(pool);
+    assert(get_default_keygen_pool() == pool);
+
+    network_context_t net_ctx;
+    memset(&net_ctx, 0, sizeof(network_context_t));
+    net_ctx.hostname = strdup("localhost");
+    ca_context_t* ca_ctx = NULL;
+    assert(init_certificate_authority(&net_ctx, &ca_ctx) == 0);
+
+    assert(keygen_pool_wait_ready(pool, 60000) == 0);
+    uint64_t hits_before = 0, hits_after = 0;
+    keygen_pool_stats(pool, NULL, NULL, &hits_before, NULL);
+
+    nexus_cert_t* cert = NULL;
+    assert(ca_issue_certificate(ca_ctx, "pooled.localhost", &cert) == 0);
+    assert(verify_certificate(cert, ca_ctx) == 0);
+    keygen_pool_stats(pool, NULL, NULL, &hits_after, NULL);
+    assert(hits_after == hits_before + 2);   // One Falcon pair, one RSA key
+
+    free_certificate(cert);
+    cleanup_certificate_authority(ca_ctx);
+    free(net_ctx.hostname);
+
+    // Cleaning up the default pool uninstalls it
+    cleanup_keygen_pool(pool);
+    assert(get_default_keygen_pool() == NULL);
+}
+
+void test_keygen_pool_all(void) {
+    printf("Running all keygen pool tests...\n");
+
+    test_pool_refill();
+    test_pooled_issuance();
+
+    printf("All keygen pool tests passed!\n");
+}
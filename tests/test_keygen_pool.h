@@ -0,0 +1,6 @@
+#ifndef TEST_KEYGEN_POOL_H
+#define TEST_KEYGEN_POOL_H
+
+void test_keygen_pool_all(void);
+
+#endif // TEST_KEYGEN_POOL_H
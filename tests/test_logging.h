@@ -0,0 +1,6 @@
+#ifndef TEST_LOGGING_H
+#define TEST_LOGGING_H
+
+void test_logging_all(void);
+
+#endif // TEST_LOGGING_H
@@ -8,6 +8,20 @@
 #include "test_certificate_authority.h"
 #include "test_network_context.h"
 #include "test_dns_resolver.h"
+#include "test_persistence.h"
+#include "test_tld_snapshot.h"
+#include "test_tld_journal.h"
+#include "test_ct_gossip.h"
+#include "test_tld_sync.h"
+#include "test_keygen_pool.h"
+#include "test_logging.h"
+#include "test_metrics.h"
+#include "test_query_trace.h"
+#include "test_dns_wire.h"
+#include "test_dns_frontend.h"
+#include "test_doq.h"
+#include "test_answer_cache.h"
+#include "test_query_arena.h"
 
 // External function declarations for standalone tests
 int test_standalone_ca_main(int argc, char *argv[]);
@@ -37,6 +51,20 @@ void print_help(void) {
     printf("  nexus_tests ca               Run only Certificate Authority tests\n");
     printf("  nexus_tests network          Run only Network Context tests\n");
     printf("  nexus_tests dns              Run only DNS Resolver tests\n");
+    printf("  nexus_tests persistence      Run only Persistence tests\n");
+    printf("  nexus_tests snapshot         Run only TLD Snapshot tests\n");
+    printf("  nexus_tests journal          Run only TLD Journal tests\n");
+    printf("  nexus_tests ct_gossip        Run only CT Gossip tests\n");
+    printf("  nexus_tests tld_sync         Run only TLD sync tests\n");
+    printf("  nexus_tests keygen           Run only Keygen Pool tests\n");
+    printf("  nexus_tests logging          Run only Logging tests\n");
+    printf("  nexus_tests metrics          Run only Metrics tests\n");
+    printf("  nexus_tests query_trace      Run only Query Trace tests\n");
+    printf("  nexus_tests dns_wire         Run only DNS Wire Format tests\n");
+    printf("  nexus_tests dns_frontend     Run only DNS Frontend tests\n");
+    printf("  nexus_tests doq              Run only DNS over QUIC tests\n");
+    printf("  nexus_tests answer_cache     Run only DNS answer cache tests\n");
+    printf("  nexus_tests query_arena      Run only request arena tests\n");
     printf("  nexus_tests quic_dns_cert    Run QUIC handshake with DNS and certificate validation test\n");
     printf("  nexus_tests integration      Run all integration tests\n");
     printf("  nexus_tests help             Show this help message\n");
@@ -52,6 +80,20 @@ int main(int argc, char *argv[]) {
     int run_ca = 1;
     int run_network = 1;
     int run_dns_resolver = 1;
+    int run_persistence = 1;
+    int run_snapshot = 1;
+    int run_journal = 1;
+    int run_ct_gossip = 1;
+    int run_tld_sync = 1;
+    int run_keygen = 1;
+    int run_logging = 1;
+    int run_metrics = 1;
+    int run_query_trace = 1;
+    int run_dns_wire = 1;
+    int run_dns_frontend = 1;
+    int run_doq = 1;
+    int run_answer_cache = 1;
+    int run_query_arena = 1;
     int run_quic_dns_cert = 0;  // Off by default as it requires server setup
     int run_unit_tests_only = 0;
     int run_integration_tests_only = 0;
@@ -59,7 +101,7 @@ int main(int argc, char *argv[]) {
     // If a command-line argument is provided, only run the specified test
     if (argc > 1) {
         // Reset all flags to 0 first
-        run_tld = run_packet = run_config = run_cli = run_ct = run_ca = run_network = run_dns_resolver = 0;
+        run_tld = run_packet = run_config = run_cli = run_ct = run_ca = run_network = run_dns_resolver = run_persistence = run_snapshot = run_journal = run_ct_gossip = run_tld_sync = run_keygen = run_logging = run_metrics = run_query_trace = run_dns_wire = run_dns_frontend = run_doq = run_answer_cache = run_query_arena = 0;
         
         if (strcmp(argv[1], "tld") == 0) {
             run_tld = 1;
@@ -77,11 +119,39 @@ int main(int argc, char *argv[]) {
             run_network = 1;
         } else if (strcmp(argv[1], "dns") == 0) {
             run_dns_resolver = 1;
+        } else if (strcmp(argv[1], "persistence") == 0) {
+            run_persistence = 1;
+        } else if (strcmp(argv[1], "snapshot") == 0) {
+            run_snapshot = 1;
+        } else if (strcmp(argv[1], "journal") == 0) {
+            run_journal = 1;
+        } else if (strcmp(argv[1], "ct_gossip") == 0) {
+            run_ct_gossip = 1;
+        } else if (strcmp(argv[1], "tld_sync") == 0) {
+            run_tld_sync = 1;
+        } else if (strcmp(argv[1], "keygen") == 0) {
+            run_keygen = 1;
+        } else if (strcmp(argv[1], "logging") == 0) {
+            run_logging = 1;
+        } else if (strcmp(argv[1], "metrics") == 0) {
+            run_metrics = 1;
+        } else if (strcmp(argv[1], "query_trace") == 0) {
+            run_query_trace = 1;
+        } else if (strcmp(argv[1], "dns_wire") == 0) {
+            run_dns_wire = 1;
+        } else if (strcmp(argv[1], "dns_frontend") == 0) {
+            run_dns_frontend = 1;
+        } else if (strcmp(argv[1], "doq") == 0) {
+            run_doq = 1;
+        } else if (strcmp(argv[1], "answer_cache") == 0) {
+            run_answer_cache = 1;
+        } else if (strcmp(argv[1], "query_arena") == 0) {
+            run_query_arena = 1;
         } else if (strcmp(argv[1], "quic_dns_cert") == 0) {
             run_quic_dns_cert = 1;
         } else if (strcmp(argv[1], "unit") == 0) {
             run_unit_tests_only = 1;
-            run_tld = run_packet = run_config = run_cli = run_ct = run_ca = run_network = run_dns_resolver = 1;
+            run_tld = run_packet = run_config = run_cli = run_ct = run_ca = run_network = run_dns_resolver = run_persistence = run_snapshot = run_journal = run_ct_gossip = run_tld_sync = run_keygen = run_logging = run_metrics = run_query_trace = run_dns_wire = run_dns_frontend = run_doq = run_answer_cache = run_query_arena = 1;
         } else if (strcmp(argv[1], "integration") == 0) {
             run_integration_tests_only = 1;
             run_quic_dns_cert = 1;
@@ -151,6 +221,90 @@ int main(int argc, char *argv[]) {
             printf(COLOR_YELLOW "\n>>> Testing DNS Resolver <<<\n" COLOR_RESET);
             test_dns_resolver();
         }
+
+        // Run persistence tests
+        if (run_persistence) {
+            printf(COLOR_YELLOW "\n>>> Testing Persistence <<<\n" COLOR_RESET);
+            test_persistence_all();
+        }
+
+        // Run TLD snapshot tests
+        if (run_snapshot) {
+            printf(COLOR_YELLOW "\n>>> Testing TLD Snapshot <<<\n" COLOR_RESET);
+            test_tld_snapshot_all();
+        }
+
+        // Run TLD journal tests
+        if (run_journal) {
+            printf(COLOR_YELLOW "\n>>> Testing TLD Journal <<<\n" COLOR_RESET);
+            test_tld_journal_all();
+        }
+
+        // Run CT gossip tests
+        if (run_ct_gossip) {
+            printf(COLOR_YELLOW "\n>>> Testing CT Gossip <<<\n" COLOR_RESET);
+            test_ct_gossip_all();
+        }
+
+        // Run TLD sync tests
+        if (run_tld_sync) {
+            printf(COLOR_YELLOW "\n>>> Testing TLD Sync <<<\n" COLOR_RESET);
+            test_tld_sync_all();
+        }
+
+        // Run keygen pool tests
+        if (run_keygen) {
+            printf(COLOR_YELLOW "\n>>> Testing Keygen Pool <<<\n" COLOR_RESET);
+            test_keygen_pool_all();
+        }
+
+        // Run logging tests
+        if (run_logging) {
+            printf(COLOR_YELLOW "\n>>> Testing Logging <<<\n" COLOR_RESET);
+            test_logging_all();
+        }
+
+        // Run metrics tests
+        if (run_metrics) {
+            printf(COLOR_YELLOW "\n>>> Testing Metrics <<<\n" COLOR_RESET);
+            test_metrics_all();
+        }
+
+        // Run query trace tests
+        if (run_query_trace) {
+            printf(COLOR_YELLOW "\n>>> Testing Query Trace <<<\n" COLOR_RESET);
+            test_query_trace_all();
+        }
+
+        // Run DNS wire format tests
+        if (run_dns_wire) {
+            printf(COLOR_YELLOW "\n>>> Testing DNS Wire Format <<<\n" COLOR_RESET);
+            test_dns_wire_all();
+        }
+
+        // Run DNS frontend tests
+        if (run_dns_frontend) {
+            printf(COLOR_YELLOW "\n>>> Testing DNS Frontend <<<\n" COLOR_RESET);
+            test_dns_frontend_all();
+        }
+
+        // Run DNS over QUIC tests
+        if (run_doq) {
+            printf(COLOR_YELLOW "\n>>> Testing DNS over QUIC <<<\n" COLOR_RESET);
+            test_doq_all();
+        }
+
+        // Run DNS answer cache tests
+        if (run_answer_cache) {
+            printf(COLOR_YELLOW "\n>>> Testing DNS Answer Cache <<<\n" COLOR_RESET);
+            test_answer_cache_all();
+        }
+
+        // Run request arena tests
+        if (run_query_arena) {
+            printf(COLOR_YELLOW "\n>>> Testing Request Arena <<<\n" COLOR_RESET);
+            test_query_arena_all();
+        }
     }
     
     // Run integration tests
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../include/metrics.h"
+#include "../include/packet_protocol.h"
+#include "test_metrics.h"
+
+#define METRICS_TEST_THREADS 8
+#define METRICS_TEST_PER_THREAD 10000
+#define METRICS_TEST_SOCKET "test_metrics.sock"
+
+static void *counting_worker(void *arg) {
+    (void)arg;
+    for (int i = 0; i < METRICS_TEST_PER_THREAD; i++) {
+        metrics_inc(METRIC_DNS_QUERIES);
+        metrics_count_packet(PACKET_TYPE_DNS_QUERY);
+        metrics_observe_us(METRIC_RESOLVE_LATENCY, (uint64_t)(i % 100) + 1);
+    }
+    return NULL;
+}
+
+static void test_sharded_counters(void) {
+    printf("Testing sharded counters...\n");
+    metrics_reset();
+
+    pthread_t threads[METRICS_TEST_THREADS];
+    for (int t = 0; t < METRICS_TEST_THREADS; t++) {
+        assert(pthread_create(&threads[t], NULL, counting_worker, NULL) == 0);
+    }
+    for (int t = 0; t < METRICS_TEST_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    // No increment is lost across shards
+    uint64_t expected = (uint64_t)METRICS_TEST_THREADS * METRICS_TEST_PER_THREAD;
+    assert(metrics_counter_value(METRIC_DNS_QUERIES) == expected);
+    assert(metrics_packet_count(PACKET_TYPE_DNS_QUERY) == expected);
+    assert(metrics_packet_count(PACKET_TYPE_DNS_RESPONSE) == 0);
+    uint64_t count = 0, sum = 0;
+    metrics_histogram_summary(METRIC_RESOLVE_LATENCY, &count, &sum);
+    assert(count == expected);
+    assert(sum == (uint64_t)METRICS_TEST_THREADS * (METRICS_TEST_PER_THREAD / 100) * 5050);
+
+    // Unknown packet types share one slot
+    metrics_count_packet(-1);
+    metrics_count_packet(200);
+    assert(metrics_packet_count(METRICS_PACKET_TYPE_SLOTS - 1) == 2);
+    assert(metrics_packet_count(1000) == 2);
+
+    metrics_reset();
+    assert(metrics_counter_value(METRIC_DNS_QUERIES) == 0);
+    printf("Sharded counters test passed\n");
+}
+
+static void test_histogram_quantiles(void) {
+    printf("Testing latency histogram...\n");
+    metrics_reset();
+    assert(metrics_histogram_quantile(METRIC_UPSTREAM_RTT, 0.5) == 0);
+
+    // Small values are exact, large ones within one sub-bucket (1/16)
+    for (uint64_t v = 1; v <= 10; v++) metrics_observe_us(METRIC_UPSTREAM_RTT, v);
+    assert(metrics_histogram_quantile(METRIC_UPSTREAM_RTT, 0.5) == 5);
+    assert(metrics_histogram_quantile(METRIC_UPSTREAM_RTT, 1.0) == 10);
+
+    metrics_reset();
+    for (uint64_t v = 1; v <= 100000; v++) metrics_observe_us(METRIC_UPSTREAM_RTT, v);
+    uint64_t p50 = metrics_histogram_quantile(METRIC_UPSTREAM_RTT, 0.50);
+    uint64_t p99 = metrics_histogram_quantile(METRIC_UPSTREAM_RTT, 0.99);
+    assert(p50 >= 50000 && p50 <= 50000 + 50000 / 16);
+    assert(p99 >= 99000 && p99 <= 99000 + 99000 / 16);
+
+    // Huge values are clamped rather than dropped
+    metrics_observe_us(METRIC_UPSTREAM_RTT, UINT64_MAX);
+    uint64_t count = 0;
+    metrics_histogram_summary(METRIC_UPSTREAM_RTT, &count, NULL);
+    assert(count == 100001);
+    assert(metrics_histogram_quantile(METRIC_UPSTREAM_RTT, 1.0) > 100000);
+
+    metrics_reset();
+    printf("Latency histogram test passed\n");
+}
+
+static void test_prometheus_rendering(void) {
+    printf("Testing Prometheus rendering...\n");
+    metrics_reset();
+    metrics_add(METRIC_DNS_CACHE_HITS, 7);
+    metrics_inc(METRIC_CONNECTIONS_ACCEPTED);
+    metrics_inc(METRIC_CONNECTIONS_ACCEPTED);
+    metrics_inc(METRIC_CONNECTIONS_CLOSED);
+    metrics_count_packet(PACKET_TYPE_CT_STH_REQ);
+    metrics_observe_us(METRIC_RESOLVE_LATENCY, 3);
+    metrics_observe_us(METRIC_RESOLVE_LATENCY, 1500);
+
+    char *text = NULL;
+    size_t len = 0;
+    assert(metrics_render_prometheus(&text, &len) == 0);
+    assert(text != NULL && len == strlen(text));
+    assert(strstr(text, "# TYPE nexus_dns_cache_hits_total counter\n"));
+    assert(strstr(text, "\nnexus_dns_cache_hits_total 7\n"));
+    assert(strstr(text, "\nnexus_connections_open 1\n"));
+    assert(strstr(text, "nexus_packets_received_total{type=\"ct_sth_req\"} 1\n"));
+    assert(strstr(text, "nexus_packets_received_total{type=\"unknown\"} 0\n"));
+    assert(strstr(text, "# TYPE nexus_resolve_duration_seconds histogram\n"));
+    assert(strstr(text, "nexus_resolve_duration_seconds_bucket{le=\"4e-06\"} 1\n"));
+    assert(strstr(text, "nexus_resolve_duration_seconds_bucket{le=\"0.002048\"} 2\n"));
+    assert(strstr(text, "nexus_resolve_duration_seconds_bucket{le=\"+Inf\"} 2\n"));
+    assert(strstr(text, "nexus_resolve_duration_seconds_count 2\n"));
+    assert(strstr(text, "nexus_resolve_duration_seconds_sum 0.001503\n"));
+    free(text);
+
+    metrics_reset();
+    printf("Prometheus rendering test passed\n");
+}
+
+static char *fetch_metrics(const char *request) {
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(sock >= 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, METRICS_TEST_SOCKET, sizeof(addr.sun_path) - 1);
+    assert(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(send(sock, request, strlen(request), 0) == (ssize_t)strlen(request));
+
+    size_t cap = 4096, len = 0;
+    char *buf = malloc(cap);
+    assert(buf != NULL);
+    ssize_t n;
+    while ((n = recv(sock, buf + len, cap - len - 1, 0)) > 0) {
+        len += (size_t)n;
+        if (cap - len < 1024) {
+            cap *= 2;
+            buf = realloc(buf, cap);
+            assert(buf != NULL);
+        }
+    }
+    close(sock);
+    buf[len] = '\0';
+    return buf;
+}
+
+static void test_metrics_server(void) {
+    printf("Testing metrics socket...\n");
+    metrics_reset();
+    metrics_add(METRIC_UPSTREAM_QUERIES, 42);
+
+    metrics_server_t *server = NULL;
+    assert(init_metrics_server(METRICS_TEST_SOCKET, &server) == 0);
+
+    // The CLI gets the bare text, scrapers an HTTP response
+    char *plain = fetch_metrics("METRICS\n");
+    assert(strncmp(plain, "# HELP", 6) == 0);
+    assert(strstr(plain, "\nnexus_upstream_queries_total 42\n"));
+    free(plain);
+
+    char *http = fetch_metrics("GET /metrics HTTP/1.0\r\n\r\n");
+    assert(strncmp(http, "HTTP/1.0 200 OK\r\n", 17) == 0);
+    assert(strstr(http, "\r\n\r\n# HELP"));
+    assert(strstr(http, "\nnexus_upstream_queries_total 42\n"));
+    free(http);
+
+    // A second server must not take over a socket that is being served
+    metrics_server_t *rival = NULL;
+    assert(init_metrics_server(METRICS_TEST_SOCKET, &rival) != 0);
+    plain = fetch_metrics("METRICS\n");
+    assert(strncmp(plain, "# HELP", 6) == 0);
+    free(plain);
+
+    cleanup_metrics_server(server);
+    assert(access(METRICS_TEST_SOCKET, F_OK) != 0);
+
+    // A socket left behind by a dead server is replaced
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, METRICS_TEST_SOCKET, sizeof(addr.sun_path) - 1);
+    int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(stale >= 0 && bind(stale, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    close(stale);
+    assert(init_metrics_server(METRICS_TEST_SOCKET, &server) == 0);
+    cleanup_metrics_server(server);
+
+    // Other files are left alone
+    FILE *f = fopen(METRICS_TEST_SOCKET, "w");
+    assert(f != NULL);
+    fclose(f);
+    assert(init_metrics_server(METRICS_TEST_SOCKET, &server) != 0);
+    assert(access(METRICS_TEST_SOCKET, F_OK) == 0);
+    unlink(METRICS_TEST_SOCKET);
+
+    metrics_reset();
+    printf("Metrics socket test passed\n");
+}
+
+void test_metrics_all(void) {
+    printf("Running all metrics tests...\n");
+
+    test_sharded_counters();
+    test_histogram_quantiles();
+    test_prometheus_rendering();
+    test_metrics_server();
+
+    printf("All metrics tests passed!\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_METRICS_H
+#define TEST_METRICS_H
+
+void test_metrics_all(void);
+
+#endif // TEST_METRICS_H
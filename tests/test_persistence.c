@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sqlite3.h>
+#include "../include/persistence.h"
+#include "../include/tld_manager.h"
+#include "../include/tld_merkle.h"
+#include "../include/debug.h"
+#include "test_persistence.h"
+
+// Test helper function
+static void test_assert(int condition, const char* test_name) {
+    if (condition) {
+        printf("  Test: %-50s - PASSED\n", test_name);
+    } else {
+        printf("  Test: %-50s - FAILED\n", test_name);
+        exit(1);
+    }
+}
+
+static void remove_db_files(const char* path) {
+    char buf[512];
+    unlink(path);
+    snprintf(buf, sizeof(buf), "%s-wal", path);
+    unlink(buf);
+    snprintf(buf, sizeof(buf), "%s-shm", path);
+    unlink(buf);
+}
+
+// Mutations made through the TLD manager survive a restart
+static void test_write_behind_restart(const char* db_path) {
+    persistence_config_t* config = create_default_persistence_config(db_path);
+    test_assert(config != NULL, "Create default persistence config");
+
+    persistence_context_t* ctx = NULL;
+    test_assert(init_persistence(&ctx, config) == 0, "Initialize persistence");
+
+    tld_manager_t* manager = NULL;
+    init_tld_manager(&manager);
+    test_assert(attach_persistence_to_tld_manager(ctx, manager) == 0, "Attach write-behind to TLD manager");
+
+    tld_t* tld = register_new_tld(manager, "persist");
+    char name[32];
+    for (int i = 0; i < 100; ++i) {
+        snprintf(name, sizeof(name), "host%d", i);
+        dns_record_t rec = { .name = name, .type = DNS_RECORD_TYPE_A, .ttl = 120, .rdata = "10.1.1.1" };
+        add_dns_record_to_tld(tld, &rec);
+    }
+    remove_dns_record_from_tld(tld, "host5", DNS_RECORD_TYPE_A);
+    tld_node_t node = { .hostname = "mirror.persist", .ip_address = "10.9.9.9", .last_seen = 0 };
+    add_mirror_node_to_tld(tld, &node);
+
+    test_assert(persistence_flush(ctx) == 0, "Flush write-behind queue");
+    test_assert(persistence_pending_count(ctx) == 0, "No pending mutations after flush");
+
+    size_t records = 0, tlds = 0, bytes = 0;
+    test_assert(get_database_stats(ctx, &records, &tlds, &bytes) == 0, "Get database stats");
+    test_assert(records == 99 && tlds == 1 && bytes > 0, "Stats reflect group-committed mutations");
+
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+
+    // Restart
+    ctx = NULL;
+    manager = NULL;
+    test_assert(init_persistence(&ctx, config) == 0, "Reopen persistence");
+    init_tld_manager(&manager);
+    test_assert(restore_tlds_from_persistence(ctx, manager) == 0, "Restore TLDs");
+
+    tld = find_tld_by_name(manager, "persist");
+    test_assert(tld != NULL, "Restored TLD exists");
+    test_assert(tld && tld->record_count == 99, "Restored record count");
+    test_assert(tld && tld->mirror_node_count == 1, "Restored mirror node");
+    int found_removed = 0;
+    for (size_t i = 0; tld && i < tld->record_count; ++i) {
+        if (strcmp(tld->records[i].name, "host5") == 0) found_removed = 1;
+    }
+    test_assert(!found_removed, "Removed record stays removed");
+
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+    free_persistence_config(config);
+}
+
+// Removing one of several records with the same name and type deletes
+// that record's row, not the first one with the name and type
+static void test_delete_matches_rdata(const char* db_path) {
+    persistence_config_t* config = create_default_persistence_config(db_path);
+    persistence_context_t* ctx = NULL;
+    init_persistence(&ctx, config);
+    tld_manager_t* manager = NULL;
+    init_tld_manager(&manager);
+    attach_persistence_to_tld_manager(ctx, manager);
+
+    tld_t* tld = register_new_tld(manager, "multi");
+    dns_record_t first = { .name = "www", .type = DNS_RECORD_TYPE_A, .ttl = 60, .rdata = "10.0.0.1" };
+    dns_record_t second = { .name = "www", .type = DNS_RECORD_TYPE_A, .ttl = 60, .rdata = "10.0.0.2" };
+    add_dns_record_to_tld(tld, &first);
+    add_dns_record_to_tld(tld, &second);
+    // Reconciling to a bucket that only holds the first record removes the second
+    test_assert(reconcile_tld_bucket(tld, tld_merkle_bucket_for_name("www"), &first, 1) == 0,
+                "Reconcile away the second record");
+    test_assert(persistence_flush(ctx) == 0, "Flush record removal");
+
+    dns_record_t* records = NULL;
+    size_t count = 0;
+    load_dns_records(ctx, "multi", &records, &count);
+    test_assert(count == 1 && strcmp(records[0].rdata, "10.0.0.1") == 0, "Database kept the matching rdata");
+    for (size_t i = 0; i < count; ++i) {
+        free(records[i].name);
+        free(records[i].rdata);
+    }
+    free(records);
+
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+    free_persistence_config(config);
+}
+
+static void* release_lock_later(void* arg) {
+    usleep(20000);
+    sqlite3_exec((sqlite3*)arg, "COMMIT", NULL, NULL, NULL);
+    return NULL;
+}
+
+// A batch that cannot commit is retried; one that never commits is
+// reported by flush and cleanup instead of being dropped silently
+static void test_commit_failure(const char* db_path) {
+    persistence_config_t* config = create_default_persistence_config(db_path);
+    config->flush_interval_ms = 5;
+    persistence_context_t* ctx = NULL;
+    init_persistence(&ctx, config);
+    tld_manager_t* manager = NULL;
+    init_tld_manager(&manager);
+    attach_persistence_to_tld_manager(ctx, manager);
+    tld_t* tld = register_new_tld(manager, "busy");
+    test_assert(persistence_flush(ctx) == 0, "Flush before locking the database");
+
+    // Another connection holding the write lock makes every commit fail
+    sqlite3* blocker = NULL;
+    sqlite3_open(db_path, &blocker);
+    test_assert(sqlite3_exec(blocker, "BEGIN EXCLUSIVE", NULL, NULL, NULL) == SQLITE_OK, "Lock the database");
+
+    dns_record_t rec = { .name = "retry", .type = DNS_RECORD_TYPE_A, .ttl = 60, .rdata = "10.0.0.1" };
+    add_dns_record_to_tld(tld, &rec);
+    pthread_t releaser;
+    pthread_create(&releaser, NULL, release_lock_later, blocker);
+    test_assert(persistence_flush(ctx) == 0, "Batch commits once the lock is released");
+    pthread_join(releaser, NULL);
+
+    dns_record_t* records = NULL;
+    size_t count = 0;
+    load_dns_records(ctx, "busy", &records, &count);
+    test_assert(count == 1, "Retried batch is in the database");
+    free(records[0].name);
+    free(records[0].rdata);
+    free(records);
+
+    test_assert(sqlite3_exec(blocker, "BEGIN EXCLUSIVE", NULL, NULL, NULL) == SQLITE_OK, "Lock the database again");
+    rec.name = "lost";
+    add_dns_record_to_tld(tld, &rec);
+    test_assert(persistence_flush(ctx) == -1, "Flush reports a dropped batch");
+    test_assert(persistence_pending_count(ctx) == 0, "Dropped batch is not left pending");
+    sqlite3_exec(blocker, "COMMIT", NULL, NULL, NULL);
+    sqlite3_close(blocker);
+    test_assert(persistence_flush(ctx) == -1, "Write error is sticky");
+    test_assert(cleanup_persistence(ctx) == -1, "Cleanup reports the dropped batch");
+
+    cleanup_tld_manager(manager);
+    free_persistence_config(config);
+}
+
+// Direct API: persist/load round trip, transactions, backup
+static void test_direct_api(const char* db_path, const char* backup_path) {
+    persistence_config_t* config = create_default_persistence_config(db_path);
+    persistence_context_t* ctx = NULL;
+    init_persistence(&ctx, config);
+
+    tld_manager_t* manager = NULL;
+    init_tld_manager(&manager);
+    tld_t* tld = register_new_tld(manager, "direct");
+    dns_record_t rec = { .name = "www", .type = DNS_RECORD_TYPE_CNAME, .ttl = 60, .rdata = "web.direct" };
+    add_dns_record_to_tld(tld, &rec);
+    test_assert(persist_tld(ctx, tld) == 0, "persist_tld");
+
+    tld_t* loaded = NULL;
+    test_assert(load_tld(ctx, "direct", &loaded) == 0, "load_tld");
+    test_assert(loaded && loaded->record_count == 1 && strcmp(loaded->records[0].rdata, "web.direct") == 0,
+                "Loaded TLD matches persisted TLD");
+    free_loaded_tld(loaded);
+
+    test_assert(begin_transaction(ctx) == 0, "Begin transaction");
+    dns_record_t extra = { .name = "tmp", .type = DNS_RECORD_TYPE_TXT, .ttl = 60, .rdata = "x" };
+    persist_dns_record(ctx, "direct", &extra);
+    test_assert(rollback_transaction(ctx) == 0, "Rollback transaction");
+    dns_record_t* records = NULL;
+    size_t count = 0;
+    load_dns_records(ctx, "direct", &records, &count);
+    test_assert(count == 1, "Rolled back record is not visible");
+    for (size_t i = 0; i < count; ++i) {
+        free(records[i].name);
+        free(records[i].rdata);
+    }
+    free(records);
+
+    test_assert(persist_network_config(ctx, "default", "{\"mode\":\"private\"}") == 0, "Persist network config");
+    char* data = NULL;
+    test_assert(load_network_config(ctx, "default", &data) == 0 && strcmp(data, "{\"mode\":\"private\"}") == 0,
+                "Load network config");
+    free(data);
+
+    test_assert(backup_database(ctx, backup_path) == 0, "Backup database");
+    test_assert(vacuum_database(ctx) == 0, "Vacuum database");
+    test_assert(delete_tld(ctx, "direct") == 0, "Delete TLD");
+
+    char** names = NULL;
+    size_t name_count = 0;
+    list_tlds(ctx, &names, &name_count);
+    test_assert(name_count == 0, "No TLDs after delete");
+    free(names);
+
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+    free_persistence_config(config);
+}
+
+void test_persistence_all(void) {
+    char db_path[64];
+    char backup_path[64];
+    snprintf(db_path, sizeof(db_path), "/tmp/nexus_test_persist_%d.db", (int)getpid());
+    snprintf(backup_path, sizeof(backup_path), "/tmp/nexus_test_persist_%d.bak", (int)getpid());
+    remove_db_files(db_path);
+
+    test_write_behind_restart(db_path);
+    remove_db_files(db_path);
+    test_delete_matches_rdata(db_path);
+    remove_db_files(db_path);
+    test_commit_failure(db_path);
+    remove_db_files(db_path);
+    test_direct_api(db_path, backup_path);
+
+    remove_db_files(db_path);
+    remove_db_files(backup_path);
+    printf("Persistence Tests Finished.\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_PERSISTENCE_H
+#define TEST_PERSISTENCE_H
+
+void test_persistence_all(void);
+
+#endif // TEST_PERSISTENCE_H
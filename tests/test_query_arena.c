@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "../include/query_arena.h"
+#include "test_query_arena.h"
+
+static void test_alloc(void) {
+    printf("Testing request arena allocation...\n");
+    query_arena_t* arena = NULL;
+    assert(init_query_arena(256, &arena) == 0);
+    assert(query_arena_used(arena) == 0);
+
+    // Aligned, distinct and writable
+    uint8_t* a = query_arena_alloc(arena, 3);
+    uint8_t* b = query_arena_alloc(arena, 0);
+    uint64_t* c = query_arena_alloc(arena, sizeof(uint64_t) * 4);
+    assert(a && b && c && a != b && (uint8_t*)c != b);
+    assert((uintptr_t)a % QUERY_ARENA_ALIGN == 0);
+    assert((uintptr_t)b % QUERY_ARENA_ALIGN == 0);
+    assert((uintptr_t)c % QUERY_ARENA_ALIGN == 0);
+    memset(a, 0xAA, 3);
+    c[3] = 42;
+    assert(query_arena_used(arena) == 3 * QUERY_ARENA_ALIGN + 16);
+
+    char* s = query_arena_strdup(arena, "www.test");
+    assert(s && strcmp(s, "www.test") == 0);
+    assert(query_arena_strdup(arena, NULL) == NULL);
+
+    query_arena_reset(arena);
+    assert(query_arena_used(arena) == 0);
+    assert(query_arena_alloc(arena, 1) == a);   // The same memory again
+
+    cleanup_query_arena(arena);
+    printf("Request arena allocation test passed\n");
+}
+
+static void test_realloc(void) {
+    printf("Testing request arena realloc...\n");
+    query_arena_t* arena = NULL;
+    assert(init_query_arena(256, &arena) == 0);
+
+    // The newest allocation grows where it is
+    int* values = query_arena_realloc(arena, NULL, 0, sizeof(int));
+    assert(values);
+    for (int i = 1; i <= 16; i++) {
+        int* grown = query_arena_realloc(arena, values, (size_t)i * sizeof(int), (size_t)(i + 1) * sizeof(int));
+        assert(grown == values);
+        grown[i] = i;
+    }
+
+    // Anything older is copied
+    int* older = values;
+    assert(query_arena_alloc(arena, 8));
+    values = query_arena_realloc(arena, older, 17 * sizeof(int), 18 * sizeof(int));
+    assert(values && values != older);
+    for (int i = 1; i <= 16; i++) assert(values[i] == i);
+
+    // Past the end of the chunk, it moves with its contents
+    int* big = query_arena_realloc(arena, values, 18 * sizeof(int), 200 * sizeof(int));
+    assert(big && big != values);
+    for (int i = 1; i <= 16; i++) assert(big[i] == i);
+
+    cleanup_query_arena(arena);
+    printf("Request arena realloc test passed\n");
+}
+
+static void test_overflow(void) {
+    printf("Testing request arena overflow...\n");
+    query_arena_t* arena = NULL;
+    assert(init_query_arena(64, &arena) == 0);
+
+    // A request larger than the chunk spills into overflow chunks
+    char* parts[40];
+    for (int i = 0; i < 40; i++) {
+        parts[i] = query_arena_alloc(arena, 48);
+        assert(parts[i]);
+        memset(parts[i], i, 48);
+    }
+    for (int i = 0; i < 40; i++) {
+        assert(parts[i][0] == i && parts[i][47] == i);
+    }
+    size_t used = query_arena_used(arena);
+    assert(used == 40 * 48);
+
+    // One oversized allocation
+    assert(query_arena_alloc(arena, 100000));
+
+    // The next request of that size fits in the retained chunk
+    query_arena_reset(arena);
+    assert(query_arena_used(arena) == 0);
+    char* first = query_arena_alloc(arena, 48);
+    for (int i = 1; i < 40; i++) {
+        char* next = query_arena_alloc(arena, 48);
+        assert(next == first + i * 48);
+    }
+
+    cleanup_query_arena(arena);
+    printf("Request arena overflow test passed\n");
+}
+
+void test_query_arena_all(void) {
+    printf("Running all request arena tests...\n");
+
+    test_alloc();
+    test_realloc();
+    test_overflow();
+
+    printf("All request arena tests passed!\n");
+}
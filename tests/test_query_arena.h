@@ -0,0 +1,6 @@
+#ifndef TEST_QUERY_ARENA_H
+#define TEST_QUERY_ARENA_H
+
+void test_query_arena_all(void);
+
+#endif // TEST_QUERY_ARENA_H
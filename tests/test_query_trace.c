@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "../include/query_trace.h"
+#include "../include/packet_protocol.h"
+#include "../include/dns_resolver.h"
+#include "../include/tld_manager.h"
+#include "test_query_trace.h"
+
+#define TRACE_TEST_THREADS 4
+#define TRACE_TEST_PER_THREAD 1000
+
+static void trace_one(int status) {
+    if (query_trace_begin(PACKET_TYPE_DNS_QUERY)) {
+        uint64_t start = query_trace_stage_start();
+        query_trace_stage_end(TRACE_STAGE_CACHE_LOOKUP, start);
+        query_trace_end(status);
+    }
+}
+
+static void test_sampling(void) {
+    printf("Testing trace sampling...\n");
+
+    // Off by default and after cleanup
+    assert(query_trace_begin(PACKET_TYPE_DNS_QUERY) == 0);
+
+    assert(init_query_tracing(4, 64) == 0);
+    int sampled = 0;
+    for (int i = 0; i < 40; i++) {
+        if (query_trace_begin(PACKET_TYPE_DNS_QUERY)) sampled++;
+        query_trace_end(0);
+    }
+    assert(sampled == 10);
+
+    query_trace_t traces[64];
+    assert(query_trace_snapshot(traces, 64) == 10);
+    for (int i = 1; i < 10; i++) {
+        assert(traces[i].id > traces[i - 1].id);
+    }
+
+    // Stages outside a sampled query are ignored
+    assert(query_trace_stage_start() == 0);
+    query_trace_stage_end(TRACE_STAGE_SERIALIZE, 0);
+
+    cleanup_query_tracing();
+    assert(query_trace_begin(PACKET_TYPE_DNS_QUERY) == 0);
+    assert(query_trace_snapshot(traces, 64) == 0);
+
+    printf("Trace sampling test passed\n");
+}
+
+static void test_stage_spans(void) {
+    printf("Testing stage spans...\n");
+    assert(init_query_tracing(1, 8) == 0);
+
+    query_trace_note_receive();
+    assert(query_trace_begin(PACKET_TYPE_DNS_QUERY) == 1);
+    query_trace_set_name("www.example.test");
+
+    uint64_t outer = query_trace_stage_start();
+    uint64_t inner = query_trace_stage_start();
+    query_trace_stage_end(TRACE_STAGE_CACHE_LOOKUP, inner);
+    query_trace_stage_end(TRACE_STAGE_CNAME_FOLLOW, outer);
+    uint64_t write = query_trace_stage_start();
+    query_trace_stage_end(TRACE_STAGE_STREAM_WRITE, write);
+    query_trace_end(3);
+
+    query_trace_t trace;
+    assert(query_trace_snapshot(&trace, 1) == 1);
+    assert(trace.packet_type == PACKET_TYPE_DNS_QUERY);
+    assert(trace.status == 3);
+    assert(strcmp(trace.name, "www.example.test") == 0);
+    assert(trace.span_count == 4);
+
+    // The receive span starts the trace
+    assert(trace.spans[0].stage == TRACE_STAGE_RECEIVE);
+    assert(trace.spans[0].start_ns == trace.start_ns);
+
+    // Spans are recorded as they end, nested ones one level deeper
+    assert(trace.spans[1].stage == TRACE_STAGE_CACHE_LOOKUP && trace.spans[1].depth == 1);
+    assert(trace.spans[2].stage == TRACE_STAGE_CNAME_FOLLOW && trace.spans[2].depth == 0);
+    assert(trace.spans[3].stage == TRACE_STAGE_STREAM_WRITE && trace.spans[3].depth == 0);
+    assert(trace.spans[2].start_ns <= trace.spans[1].start_ns);
+    assert(trace.spans[2].end_ns >= trace.spans[1].end_ns);
+    for (uint32_t s = 0; s < trace.span_count; s++) {
+        assert(trace.spans[s].end_ns >= trace.spans[s].start_ns);
+        assert(trace.spans[s].end_ns <= trace.end_ns);
+    }
+
+    // A receive note is used by one trace only
+    assert(query_trace_begin(PACKET_TYPE_DNS_QUERY) == 1);
+    query_trace_end(0);
+    assert(query_trace_snapshot(&trace, 1) == 1);
+    assert(trace.span_count == 0);
+
+    // Extra stages are counted, not stored
+    assert(query_trace_begin(PACKET_TYPE_DNS_QUERY) == 1);
+    for (int i = 0; i < QUERY_TRACE_MAX_SPANS + 5; i++) {
+        query_trace_stage_end(TRACE_STAGE_TLD_LOOKUP, query_trace_stage_start());
+    }
+    query_trace_end(0);
+    assert(query_trace_snapshot(&trace, 1) == 1);
+    assert(trace.span_count == QUERY_TRACE_MAX_SPANS);
+    assert(trace.spans_dropped == 5);
+
+    cleanup_query_tracing();
+    printf("Stage spans test passed\n");
+}
+
+static void test_ring_overwrite(void) {
+    printf("Testing trace ring overwrite...\n");
+    assert(init_query_tracing(1, 4) == 0);
+
+    for (int i = 0; i < 10; i++) trace_one(i);
+
+    // Only the newest four survive, oldest first
+    query_trace_t traces[8];
+    assert(query_trace_snapshot(traces, 8) == 4);
+    for (int i = 0; i < 4; i++) {
+        assert(traces[i].status == 6 + i);
+    }
+
+    // A short buffer gets the newest
+    assert(query_trace_snapshot(traces, 2) == 2);
+    assert(traces[0].status == 8 && traces[1].status == 9);
+
+    cleanup_query_tracing();
+    printf("Trace ring overwrite test passed\n");
+}
+
+static void *tracing_worker(void *arg) {
+    (void)arg;
+    for (int i = 0; i < TRACE_TEST_PER_THREAD; i++) trace_one(0);
+    return NULL;
+}
+
+static void test_concurrent_tracing(void) {
+    printf("Testing concurrent tracing...\n");
+    assert(init_query_tracing(10, 1024) == 0);
+
+    pthread_t threads[TRACE_TEST_THREADS];
+    for (int t = 0; t < TRACE_TEST_THREADS; t++) {
+        assert(pthread_create(&threads[t], NULL, tracing_worker, NULL) == 0);
+    }
+    for (int t = 0; t < TRACE_TEST_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    // Sampling is per thread, so every thread contributes its share
+    query_trace_t* traces = malloc(1024 * sizeof(query_trace_t));
+    assert(traces);
+    size_t n = query_trace_snapshot(traces, 1024);
+    assert(n == TRACE_TEST_THREADS * TRACE_TEST_PER_THREAD / 10);
+    for (size_t i = 0; i < n; i++) {
+        assert(traces[i].span_count == 1);
+        assert(traces[i].spans[0].stage == TRACE_STAGE_CACHE_LOOKUP);
+    }
+    free(traces);
+
+    cleanup_query_tracing();
+    printf("Concurrent tracing test passed\n");
+}
+
+static uint64_t read_le(const unsigned char* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+static void test_dumps(void) {
+    printf("Testing trace dumps...\n");
+    assert(init_query_tracing(1, 8) == 0);
+
+    assert(query_trace_begin(PACKET_TYPE_DNS_QUERY) == 1);
+    query_trace_set_name("quote\"d.test");
+    query_trace_stage_end(TRACE_STAGE_UPSTREAM_WAIT, query_trace_stage_start());
+    query_trace_end(2);
+
+    char* text = NULL;
+    size_t text_len = 0;
+    FILE* f = open_memstream(&text, &text_len);
+    assert(f);
+    assert(query_trace_dump_chrome(f) == 0);
+    fclose(f);
+    assert(strstr(text, "\"traceEvents\":["));
+    assert(strstr(text, "\"name\":\"quote\\\"d.test\""));
+    assert(strstr(text, "\"name\":\"upstream_wait\""));
+    assert(strstr(text, "\"ph\":\"X\""));
+    assert(strstr(text, "\"status\":2"));
+    free(text);
+
+    unsigned char* bin = NULL;
+    size_t bin_len = 0;
+    f = open_memstream((char**)&bin, &bin_len);
+    assert(f);
+    assert(query_trace_dump_binary(f) == 0);
+    fclose(f);
+
+    query_trace_t trace;
+    assert(query_trace_snapshot(&trace, 1) == 1);
+    size_t name_len = strlen(trace.name);
+    assert(bin_len == 12 + 36 + 1 + name_len + 1 + 10);
+    assert(memcmp(bin, "NXQT", 4) == 0);
+    assert(read_le(bin + 4, 4) == 1);
+    assert(read_le(bin + 8, 4) == 1);
+    const unsigned char* p = bin + 12;
+    assert(read_le(p, 8) == trace.id);
+    assert(read_le(p + 12, 4) == PACKET_TYPE_DNS_QUERY);
+    assert(read_le(p + 16, 4) == 2);
+    assert(read_le(p + 20, 8) == trace.start_ns);
+    assert(read_le(p + 28, 8) == trace.end_ns);
+    assert(p[36] == name_len && memcmp(p + 37, trace.name, name_len) == 0);
+    p += 37 + name_len;
+    assert(p[0] == 1);
+    assert(p[1] == TRACE_STAGE_UPSTREAM_WAIT && p[2] == 0);
+    assert(read_le(p + 3, 4) == trace.spans[0].start_ns - trace.start_ns);
+    assert(read_le(p + 7, 4) == trace.spans[0].end_ns - trace.spans[0].start_ns);
+    free(bin);
+
+    cleanup_query_tracing();
+    printf("Trace dumps test passed\n");
+}
+
+static void test_resolver_stages(void) {
+    printf("Testing resolver stage tracing...\n");
+
+    tld_manager_t* tld_manager = NULL;
+    assert(init_tld_manager(&tld_manager) == 0);
+    dns_cache_t* cache = calloc(1, sizeof(dns_cache_t));
+    assert(cache);
+    cache->max_size = 100;
+    pthread_mutex_init(&cache->lock, NULL);
+    dns_resolver_t* resolver = NULL;
+    assert(init_dns_resolver(&resolver, tld_manager, cache) == 0);
+    resolver->config.enable_recursive_resolution = 1;
+
+    assert(register_new_tld(tld_manager, "trace") != NULL);
+    assert(add_record_to_tld(tld_manager, "trace", "www", DNS_RECORD_TYPE_A, "192.0.2.1", 300) == 0);
+    assert(add_record_to_tld(tld_manager, "trace", "alias", DNS_RECORD_TYPE_CNAME, "www.trace", 300) == 0);
+
+    assert(init_query_tracing(1, 8) == 0);
+    assert(query_trace_begin(PACKET_TYPE_DNS_QUERY) == 1);
+    dns_record_t* records = NULL;
+    int record_count = 0;
+    dns_response_status_t status = resolve_dns_query(resolver, "alias.trace", DNS_RECORD_TYPE_A,
+                                                     &records, &record_count);
+    query_trace_end(status);
+    assert(status == DNS_STATUS_SUCCESS);
+
+    // Cache miss, TLD lookup, then the CNAME target's own lookups nested inside
+    query_trace_t trace;
+    assert(query_trace_snapshot(&trace, 1) == 1);
+    int seen[TRACE_STAGE_COUNT] = {0};
+    int nested = 0;
+    for (uint32_t s = 0; s < trace.span_count; s++) {
+        seen[trace.spans[s].stage]++;
+        if (trace.spans[s].depth > 0) nested++;
+    }
+    assert(seen[TRACE_STAGE_CACHE_LOOKUP] == 2);
+    assert(seen[TRACE_STAGE_TLD_LOOKUP] == 2);
+    assert(seen[TRACE_STAGE_CNAME_FOLLOW] == 1);
+    assert(seen[TRACE_STAGE_UPSTREAM_WAIT] == 0);
+    assert(nested == 2);
+    cleanup_query_tracing();
+
+    for (int i = 0; i < record_count; i++) {
+        free(records[i].name);
+        free(records[i].rdata);
+    }
+    free(records);
+    cleanup_dns_resolver(resolver);
+    cleanup_tld_manager(tld_manager);
+    while (cache->head) {
+        dns_cache_node_t* node = cache->head;
+        cache->head = node->next;
+        free(node->entry.fqdn);
+        free(node->entry.record.name);
+        free(node->entry.record.rdata);
+        free(node);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+
+    printf("Resolver stage tracing test passed\n");
+}
+
+void test_query_trace_all(void) {
+    printf("Running all query trace tests...\n");
+
+    test_sampling();
+    test_stage_spans();
+    test_ring_overwrite();
+    test_concurrent_tracing();
+    test_dumps();
+    test_resolver_stages();
+
+    printf("All query trace tests passed!\n");
+}
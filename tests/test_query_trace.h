@@ -0,0 +1,6 @@
+#ifndef TEST_QUERY_TRACE_H
+#define TEST_QUERY_TRACE_H
+
+void test_query_trace_all(void);
+
+#endif // TEST_QUERY_TRACE_H
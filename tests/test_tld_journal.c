@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "../include/tld_journal.h"
+#include "../include/tld_manager.h"
+#include "../include/persistence.h"
+#include "test_tld_journal.h"
+
+// Test helper function
+static void test_assert(int condition, const char* test_name) {
+    if (condition) {
+        printf("  Test: %-50s - PASSED\n", test_name);
+    } else {
+        printf("  Test: %-50s - FAILED\n", test_name);
+        exit(1);
+    }
+}
+
+static void add_hosts(tld_t* tld, int from, int to) {
+    char name[32];
+    for (int i = from; i < to; ++i) {
+        snprintf(name, sizeof(name), "host%d", i);
+        dns_record_t rec = { .name = name, .type = DNS_RECORD_TYPE_A, .ttl = 60, .rdata = "10.3.3.3" };
+        add_dns_record_to_tld(tld, &rec);
+    }
+}
+
+static off_t file_size(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+typedef struct {
+    size_t count;
+    uint64_t first;
+    uint64_t last;
+    int saw_remove;
+} delta_ctx_t;
+
+static int collect_delta(void* arg, const tld_journal_entry_t* entry) {
+    delta_ctx_t* delta = arg;
+    if (delta->count == 0) delta->first = entry->sequence;
+    delta->last = entry->sequence;
+    delta->count++;
+    if (entry->type == TLD_MUTATION_REMOVE_RECORD && strcmp(entry->record.name, "host3") == 0) {
+        delta->saw_remove = 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    tld_manager_t* manager;
+    size_t applied;
+    size_t repeated;
+} apply_ctx_t;
+
+static int apply_entry(void* arg, const tld_journal_entry_t* entry) {
+    apply_ctx_t* apply = arg;
+    int rc = apply_tld_journal_entry(apply->manager, entry);
+    if (rc == 0) apply->applied++;
+    if (rc == 1) apply->repeated++;
+    return 0;
+}
+
+// Mutations are journaled, survive a torn tail and replay exactly once
+static void test_journal_replay(const char* path) {
+    tld_journal_t* journal = NULL;
+    test_assert(open_tld_journal(&journal, path, NULL) == 0, "Open journal");
+
+    tld_manager_t* manager = NULL;
+    init_tld_manager(&manager);
+    test_assert(attach_tld_journal(journal, manager) == 0, "Attach journal to TLD manager");
+
+    tld_t* tld = register_new_tld(manager, "wal");
+    add_hosts(tld, 0, 40);
+    dns_record_t second = { .name = "host3", .type = DNS_RECORD_TYPE_A, .ttl = 60, .rdata = "10.3.3.4" };
+    add_dns_record_to_tld(tld, &second);
+    remove_exact_dns_record_from_tld(tld, &second);
+    tld_node_t node = { .hostname = "mirror.wal", .ip_address = "10.4.4.4", .last_seen = 0 };
+    add_mirror_node_to_tld(tld, &node);
+    cleanup_stale_peers(manager, time(NULL) + 60);
+
+    test_assert(tld_journal_sync(journal) == 0, "Sync journal");
+    test_assert(tld_journal_durable_sequence(journal) == 45, "Every mutation has a durable sequence");
+
+    delta_ctx_t delta = {0};
+    test_assert(tld_journal_read_since(journal, 41, collect_delta, &delta) == 0, "Read journal since sequence");
+    test_assert(delta.count == 4 && delta.first == 42 && delta.last == 45 && delta.saw_remove,
+                "Delta holds only newer entries");
+
+    close_tld_journal(journal);
+    cleanup_tld_manager(manager);
+
+    // A torn write at the tail is dropped on open
+    FILE* f = fopen(path, "ab");
+    fwrite("\x30\x00\x00\x00garbage", 1, 11, f);
+    fclose(f);
+
+    test_assert(open_tld_journal(&journal, path, NULL) == 0, "Reopen journal with torn tail");
+    test_assert(tld_journal_last_sequence(journal) == 45, "Torn tail is truncated");
+
+    init_tld_manager(&manager);
+    apply_ctx_t apply = { manager, 0, 0 };
+    test_assert(tld_journal_read_since(journal, 0, apply_entry, &apply) == 0, "Replay journal into empty manager");
+    tld = find_tld_by_name(manager, "wal");
+    dns_record_t found[2];
+    test_assert(tld && tld_record_count(tld) == 40, "Replayed record count");
+    test_assert(tld_lookup_records(tld, "host3", found, 2) == 1 && strcmp(found[0].rdata, "10.3.3.3") == 0,
+                "Replayed removal takes only the matching rdata");
+    test_assert(tld->mirror_node_count == 0, "Replayed stale node pruning");
+
+    // Replaying the same entries again ends in the same state
+    apply_ctx_t again = { manager, 0, 0 };
+    tld_journal_read_since(journal, 0, apply_entry, &again);
+    test_assert(again.repeated == 41 && tld_record_count(tld) == 40 && tld->mirror_node_count == 0 &&
+                tld_lookup_records(tld, "host3", found, 2) == 1, "Replaying applied entries is harmless");
+
+    close_tld_journal(journal);
+    cleanup_tld_manager(manager);
+}
+
+// Compaction drops covered entries; mirrors get the rest as raw deltas
+static void test_journal_compaction(const char* path) {
+    tld_journal_t* journal = NULL;
+    tld_manager_t* manager = NULL;
+    open_tld_journal(&journal, path, NULL);
+    init_tld_manager(&manager);
+    attach_tld_journal(journal, manager);
+
+    tld_t* tld = register_new_tld(manager, "more");
+    add_hosts(tld, 100, 300);
+    tld_journal_sync(journal);
+    off_t before = file_size(path);
+
+    test_assert(compact_tld_journal(journal, 195) == 0, "Compact journal");
+    test_assert(file_size(path) < before, "Compaction shrinks the journal");
+    test_assert(tld_journal_base_sequence(journal) == 195, "Journal base moves to covered sequence");
+
+    delta_ctx_t delta = {0};
+    test_assert(tld_journal_read_since(journal, 10, collect_delta, &delta) != 0,
+                "Delta before the base requires a full resync");
+    test_assert(tld_journal_read_since(journal, 195, collect_delta, &delta) == 0 && delta.count == 6,
+                "Entries past the covered sequence are kept");
+
+    uint8_t* data = NULL;
+    size_t len = 0, count = 0;
+    test_assert(tld_journal_export_since(journal, 195, 4, &data, &len, &count) == 0 && count == 4,
+                "Export stops at max entries");
+    delta_ctx_t exported = {0};
+    test_assert(tld_journal_decode_entries(data, len, collect_delta, &exported) == 0 &&
+                exported.first == 196 && exported.last == 199, "Exported entries decode in order");
+    data[len - 1] ^= 0x01;
+    test_assert(tld_journal_decode_entries(data, len, collect_delta, &exported) != 0, "Corrupt export is rejected");
+    free(data);
+
+    // Covering more than was ever written keeps sequences moving forward
+    test_assert(compact_tld_journal(journal, 500) == 0 && tld_journal_last_sequence(journal) == 500,
+                "Sequences continue past a covered point");
+    close_tld_journal(journal);
+    cleanup_tld_manager(manager);
+}
+
+// Journaled mutations the database never committed are replayed on restore
+// and committed; a snapshot compacts the journal
+static void test_persistence_replays_journal(const char* db_path) {
+    char journal_path[128];
+    snprintf(journal_path, sizeof(journal_path), "%s.journal", db_path);
+
+    // Mutations that reached the journal but not the database
+    tld_journal_t* journal = NULL;
+    tld_manager_t* manager = NULL;
+    open_tld_journal(&journal, journal_path, NULL);
+    init_tld_manager(&manager);
+    attach_tld_journal(journal, manager);
+    add_hosts(register_new_tld(manager, "lost"), 0, 20);
+    close_tld_journal(journal);
+    cleanup_tld_manager(manager);
+
+    persistence_config_t* config = create_default_persistence_config(db_path);
+    config->enable_journal = 1;
+    persistence_context_t* ctx = NULL;
+    test_assert(init_persistence(&ctx, config) == 0, "Open persistence with journal");
+    init_tld_manager(&manager);
+    test_assert(restore_tlds_from_persistence(ctx, manager) == 0, "Restore replays the journal");
+    tld_t* tld = find_tld_by_name(manager, "lost");
+    test_assert(tld && tld_record_count(tld) == 20, "Journaled records restored");
+
+    attach_persistence_to_tld_manager(ctx, manager);
+    add_hosts(tld, 20, 25);
+    test_assert(persistence_write_snapshot(ctx, manager) == 0, "Write snapshot");
+    tld_journal_t* live = persistence_journal(ctx);
+    test_assert(live && tld_journal_base_sequence(live) == 26, "Snapshot compacts the journal");
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+
+    // The replayed mutations were committed, so the database has them alone
+    char snapshot_path[128];
+    snprintf(snapshot_path, sizeof(snapshot_path), "%s.snap", db_path);
+    unlink(journal_path);
+    unlink(snapshot_path);
+    config->enable_journal = 0;
+    init_persistence(&ctx, config);
+    init_tld_manager(&manager);
+    restore_tlds_from_persistence(ctx, manager);
+    tld = find_tld_by_name(manager, "lost");
+    test_assert(tld && tld_record_count(tld) == 25, "Replayed mutations committed to database");
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+    free_persistence_config(config);
+}
+
+void test_tld_journal_all(void) {
+    char path[64];
+    char db_path[64];
+    char buf[96];
+    snprintf(path, sizeof(path), "/tmp/nexus_test_journal_%d.wal", (int)getpid());
+    snprintf(db_path, sizeof(db_path), "/tmp/nexus_test_journal_%d.db", (int)getpid());
+    unlink(path);
+
+    test_journal_replay(path);
+    unlink(path);
+    test_journal_compaction(path);
+    unlink(path);
+
+    test_persistence_replays_journal(db_path);
+    const char* suffixes[] = { "", "-wal", "-shm", ".snap", ".journal" };
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
+        snprintf(buf, sizeof(buf), "%s%s", db_path, suffixes[i]);
+        unlink(buf);
+    }
+    printf("TLD Journal Tests Finished.\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_TLD_JOURNAL_H
+#define TEST_TLD_JOURNAL_H
+
+void test_tld_journal_all(void);
+
+#endif // TEST_TLD_JOURNAL_H
@@ -1,5 +1,6 @@
 #include "test_tld_manager.h"
 #include "tld_manager.h" // Access to tld_manager functions
+#include "tld_merkle.h"
 #include "debug.h"    // For dlog, if its usage is widespread or for consistency
 #include <stdio.h>
 #include <string.h>
@@ -70,8 +71,96 @@ static void test_register_and_find_tld(void) {
     cleanup_tld_manager(manager);
 }
 
+// Serves a peer's Merkle nodes to the divergence walk and counts round trips
+typedef struct {
+    const tld_merkle_t* remote;
+    int round_trips;
+} merkle_fetch_ctx_t;
+
+static int fetch_remote_nodes(void* ctx, uint32_t level, const uint32_t* indices, size_t count,
+                              uint8_t (*hashes_out)[TLD_MERKLE_HASH_LEN]) {
+    merkle_fetch_ctx_t* fetch_ctx = ctx;
+    fetch_ctx->round_trips++;
+    for (size_t i = 0; i < count; ++i) {
+        if (tld_merkle_get_node(fetch_ctx->remote, level, indices[i], hashes_out[i]) != 0) return -1;
+    }
+    return 0;
+}
+
+// Test Merkle summaries: order independence, removal and bucket reconciliation
+static void test_tld_merkle_reconciliation(void) {
+    tld_manager_t* manager = NULL;
+    init_tld_manager(&manager);
+    tld_t* primary = register_new_tld(manager, "alpha");
+    tld_t* mirror = register_new_tld(manager, "beta");
+    if (!primary || !mirror) {
+        test_case("Merkle reconciliation (setup failed)", 0);
+        cleanup_tld_manager(manager);
+        return;
+    }
+
+    uint8_t root[TLD_MERKLE_HASH_LEN];
+    uint8_t zero[TLD_MERKLE_HASH_LEN] = {0};
+    test_case("Empty TLD has zero Merkle root",
+              get_tld_merkle_root(manager, "alpha", root) == 0 && memcmp(root, zero, sizeof(root)) == 0);
+
+    char name[32];
+    char rdata[32];
+    for (int i = 0; i < 200; ++i) {
+        snprintf(name, sizeof(name), "host%d", i);
+        snprintf(rdata, sizeof(rdata), "10.0.%d.%d", i / 256, i % 256);
+        dns_record_t rec = { .name = name, .type = DNS_RECORD_TYPE_A, .ttl = 300, .rdata = rdata };
+        add_dns_record_to_tld(primary, &rec);
+    }
+    // Same records, reverse order
+    for (int i = 199; i >= 0; --i) {
+        snprintf(name, sizeof(name), "host%d", i);
+        snprintf(rdata, sizeof(rdata), "10.0.%d.%d", i / 256, i % 256);
+        dns_record_t rec = { .name = name, .type = DNS_RECORD_TYPE_A, .ttl = 300, .rdata = rdata };
+        add_dns_record_to_tld(mirror, &rec);
+    }
+
+    uint8_t mirror_root[TLD_MERKLE_HASH_LEN];
+    tld_merkle_get_root(primary->merkle, root);
+    tld_merkle_get_root(mirror->merkle, mirror_root);
+    test_case("Merkle root is independent of insertion order", memcmp(root, mirror_root, sizeof(root)) == 0);
+
+    // Diverge the mirror in two places
+    remove_dns_record_from_tld(mirror, "host7", DNS_RECORD_TYPE_A);
+    dns_record_t changed = { .name = "host42", .type = DNS_RECORD_TYPE_TXT, .ttl = 60, .rdata = "stale" };
+    add_dns_record_to_tld(mirror, &changed);
+    tld_merkle_get_root(mirror->merkle, mirror_root);
+    test_case("Merkle root changes on divergence", memcmp(root, mirror_root, sizeof(root)) != 0);
+
+    merkle_fetch_ctx_t ctx = { .remote = primary->merkle, .round_trips = 0 };
+    uint32_t* buckets = NULL;
+    size_t bucket_count = 0;
+    int result = tld_merkle_find_divergent_buckets(mirror->merkle, fetch_remote_nodes, &ctx, &buckets, &bucket_count);
+    test_case("Divergence walk succeeds", result == 0);
+    test_case("Divergence walk finds the changed buckets", bucket_count >= 1 && bucket_count <= 2);
+    test_case("Divergence walk is logarithmic", ctx.round_trips <= TLD_MERKLE_DEPTH + 1);
+
+    for (size_t i = 0; i < bucket_count; ++i) {
+        dns_record_t* remote = NULL;
+        size_t remote_count = 0;
+        collect_tld_bucket_records(primary, buckets[i], &remote, &remote_count);
+        reconcile_tld_bucket(mirror, buckets[i], remote, remote_count);
+        for (size_t j = 0; j < remote_count; ++j) {
+            free(remote[j].name);
+            free(remote[j].rdata);
+        }
+        free(remote);
+    }
+    free(buckets);
+
+    tld_merkle_get_root(mirror->merkle, mirror_root);
+    test_case("Merkle roots match after bucket reconciliation", memcmp(root, mirror_root, sizeof(root)) == 0);
+    test_case("Record counts match after reconciliation", mirror->record_count == primary->record_count);
+
+    cleanup_tld_manager(manager);
+}
+
 // TODO: Add more tests for other tld_manager.c functions
-// - test_add_remove_dns_record_to_tld
 // - test_add_authoritative_node_to_tld
 // - test_add_mirror_node_to_tld
 // - test_tld_list_expansion (when many TLDs are added)
@@ -80,6 +169,7 @@ void ts_tld_manager_init(void) {
     printf("Initializing TLD Manager Tests...\\n");
     test_init_cleanup_tld_manager();
     test_register_and_find_tld();
+    test_tld_merkle_reconciliation();
     // Call other test functions here
     printf("TLD Manager Tests Finished.\\n");
 } 
\ No newline at end of file
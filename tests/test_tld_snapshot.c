@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/tld_snapshot.h"
+#include "../include/tld_manager.h"
+#include "../include/tld_merkle.h"
+#include "../include/persistence.h"
+#include "../include/checksum.h"
+#include "test_tld_snapshot.h"
+
+// Test helper function
+static void test_assert(int condition, const char* test_name) {
+    if (condition) {
+        printf("  Test: %-50s - PASSED\n", test_name);
+    } else {
+        printf("  Test: %-50s - FAILED\n", test_name);
+        exit(1);
+    }
+}
+
+static void populate(tld_t* tld, int count) {
+    char name[32], rdata[32];
+    for (int i = 0; i < count; ++i) {
+        snprintf(name, sizeof(name), "host%d", i);
+        snprintf(rdata, sizeof(rdata), "10.0.%d.%d", i / 256, i % 256);
+        dns_record_t rec = { .name = name, .type = DNS_RECORD_TYPE_A, .ttl = 300, .rdata = rdata };
+        add_dns_record_to_tld(tld, &rec);
+    }
+    dns_record_t txt = { .name = "host7", .type = DNS_RECORD_TYPE_TXT, .ttl = 60, .rdata = "v=test" };
+    add_dns_record_to_tld(tld, &txt);
+}
+
+// Write, map and query a snapshot; then layer deltas on top of it
+static void test_snapshot_round_trip(const char* path) {
+    tld_manager_t* source = NULL;
+    init_tld_manager(&source);
+    populate(register_new_tld(source, "snap"), 500);
+    register_new_tld(source, "empty");
+
+    uint8_t source_root[TLD_MERKLE_HASH_LEN];
+    get_tld_merkle_root(source, "snap", source_root);
+
+    test_assert(write_tld_snapshot(source, path, 42) == 0, "Write snapshot");
+
+    tld_snapshot_t* snapshot = NULL;
+    test_assert(open_tld_snapshot(path, &snapshot) == 0, "Open snapshot");
+    test_assert(tld_snapshot_sequence(snapshot) == 42, "Snapshot keeps its sequence");
+
+    tld_manager_t* manager = NULL;
+    init_tld_manager(&manager);
+    test_assert(load_tld_snapshot_into_manager(snapshot, manager) == 0, "Load snapshot into manager");
+    test_assert(manager->tld_count == 2, "Both TLDs registered from snapshot");
+
+    tld_t* tld = find_tld_by_name(manager, "snap");
+    test_assert(tld && tld->record_count == 0 && tld_record_count(tld) == 501, "Records served from snapshot, no delta");
+
+    uint8_t root[TLD_MERKLE_HASH_LEN];
+    get_tld_merkle_root(manager, "snap", root);
+    test_assert(memcmp(root, source_root, sizeof(root)) == 0, "Merkle root loaded without rehashing");
+
+    dns_record_t found[4];
+    size_t n = tld_lookup_records(tld, "host7", found, 4);
+    test_assert(n == 2 && strcmp(found[0].name, "host7") == 0, "Lookup finds every record for a name");
+    test_assert(tld_lookup_records(tld, "host123", found, 4) == 1 && strcmp(found[0].rdata, "10.0.0.123") == 0,
+                "Lookup returns mapped rdata");
+    test_assert(tld_lookup_records(tld, "missing", found, 4) == 0, "Lookup of unknown name is empty");
+
+    // Removing a base record tombstones it and keeps the Merkle tree in step
+    test_assert(remove_dns_record_from_tld(tld, "host123", DNS_RECORD_TYPE_A) == 0, "Remove record from snapshot base");
+    test_assert(tld_lookup_records(tld, "host123", found, 4) == 0, "Removed base record is hidden");
+    test_assert(tld_record_count(tld) == 500, "Record count reflects tombstone");
+
+    dns_record_t rec = { .name = "host123", .type = DNS_RECORD_TYPE_A, .ttl = 300, .rdata = "10.0.0.123" };
+    test_assert(add_dns_record_to_tld(tld, &rec) == 0, "Add record to delta");
+    test_assert(tld->record_count == 1 && tld_lookup_records(tld, "host123", found, 4) == 1, "Delta record visible");
+    get_tld_merkle_root(manager, "snap", root);
+    test_assert(memcmp(root, source_root, sizeof(root)) == 0, "Merkle root matches after remove and re-add");
+
+    // A snapshot of base + delta round-trips again
+    test_assert(write_tld_snapshot(manager, path, 43) == 0, "Rewrite snapshot from layered manager");
+    cleanup_tld_manager(manager);
+
+    test_assert(open_tld_snapshot(path, &snapshot) == 0, "Reopen rewritten snapshot");
+    init_tld_manager(&manager);
+    load_tld_snapshot_into_manager(snapshot, manager);
+    tld = find_tld_by_name(manager, "snap");
+    test_assert(tld_record_count(tld) == 501, "Rewritten snapshot holds base and delta");
+    cleanup_tld_manager(manager);
+    cleanup_tld_manager(source);
+}
+
+static void test_snapshot_rejects_corruption(const char* path) {
+    FILE* f = fopen(path, "r+b");
+    test_assert(f != NULL, "Open snapshot for corruption");
+    fseek(f, 20, SEEK_SET);
+    fputc(0x7f, f);
+    fclose(f);
+
+    tld_snapshot_t* snapshot = NULL;
+    test_assert(open_tld_snapshot(path, &snapshot) != 0 && snapshot == NULL, "Corrupt header is rejected");
+    test_assert(open_tld_snapshot("/nonexistent/snapshot", &snapshot) != 0, "Missing snapshot is rejected");
+}
+
+enum { PATCH_STRING_OFFSET, PATCH_FULL_INDEX, PATCH_MERKLE, PATCH_DUPLICATE_TLD };
+
+// Recomputes both checksums so a structural patch reaches the section checks
+static void reseal(FILE* f, tld_snapshot_header_t* header) {
+    size_t body_len = (size_t)header->file_size - sizeof(*header);
+    uint8_t* body = malloc(body_len);
+    fseek(f, (long)sizeof(*header), SEEK_SET);
+    if (body && fread(body, 1, body_len, f) == body_len) {
+        header->body_checksum = crc32_update(0, body, body_len);
+        header->header_checksum = 0;
+        header->header_checksum = crc32_update(0, header, sizeof(*header));
+        fseek(f, 0, SEEK_SET);
+        fwrite(header, sizeof(*header), 1, f);
+    }
+    free(body);
+}
+
+// Rewrites part of a freshly written snapshot. Every patch but PATCH_MERKLE
+// is resealed, so only the checksum can catch a flipped Merkle hash.
+static void write_and_patch(const char* path, int patch) {
+    tld_manager_t* source = NULL;
+    init_tld_manager(&source);
+    populate(register_new_tld(source, "snap"), 50);
+    register_new_tld(source, "other");
+    write_tld_snapshot(source, path, 1);
+    cleanup_tld_manager(source);
+
+    FILE* f = fopen(path, "r+b");
+    tld_snapshot_header_t header;
+    if (!f || fread(&header, sizeof(header), 1, f) != 1) {
+        if (f) fclose(f);
+        return;
+    }
+    if (patch == PATCH_FULL_INDEX) {
+        // Every slot taken: a lookup for an absent name would never stop
+        uint32_t taken = 1;
+        fseek(f, (long)header.index_offset, SEEK_SET);
+        for (uint64_t i = 0; i < header.index_slot_count; ++i) fwrite(&taken, sizeof(taken), 1, f);
+    } else if (patch == PATCH_STRING_OFFSET) {
+        // A record name beyond the string table
+        uint32_t offset = (uint32_t)header.string_table_size + 4096;
+        fseek(f, (long)header.record_table_offset, SEEK_SET);
+        fwrite(&offset, sizeof(offset), 1, f);
+    } else if (patch == PATCH_MERKLE) {
+        fseek(f, (long)header.merkle_offset + 7, SEEK_SET);
+        int c = fgetc(f);
+        fseek(f, (long)header.merkle_offset + 7, SEEK_SET);
+        fputc(c ^ 0x01, f);
+    } else {
+        // Both TLDs named alike: the second registration fails mid-load
+        tld_snapshot_tld_t first;
+        fseek(f, (long)header.tld_table_offset, SEEK_SET);
+        if (fread(&first, sizeof(first), 1, f) == 1) {
+            fseek(f, (long)(header.tld_table_offset + sizeof(first)), SEEK_SET);
+            fwrite(&first.name_offset, sizeof(first.name_offset), 1, f);
+        }
+    }
+    if (patch != PATCH_MERKLE) reseal(f, &header);
+    fclose(f);
+}
+
+static void test_snapshot_rejects_corrupt_body(const char* path) {
+    tld_snapshot_t* snapshot = NULL;
+    write_and_patch(path, PATCH_STRING_OFFSET);
+    test_assert(open_tld_snapshot(path, &snapshot) != 0 && snapshot == NULL, "Out of range string offset is rejected");
+    write_and_patch(path, PATCH_FULL_INDEX);
+    test_assert(open_tld_snapshot(path, &snapshot) != 0 && snapshot == NULL, "Index without an empty slot is rejected");
+    write_and_patch(path, PATCH_MERKLE);
+    test_assert(open_tld_snapshot(path, &snapshot) != 0 && snapshot == NULL, "Flipped Merkle hash fails body checksum");
+}
+
+// A load that fails part way leaves the manager empty and the mapping closed
+static void test_snapshot_failed_load_unwinds(const char* path) {
+    tld_snapshot_t* snapshot = NULL;
+    write_and_patch(path, PATCH_DUPLICATE_TLD);
+    test_assert(open_tld_snapshot(path, &snapshot) == 0, "Open snapshot with duplicate TLD names");
+
+    tld_manager_t* manager = NULL;
+    init_tld_manager(&manager);
+    test_assert(load_tld_snapshot_into_manager(snapshot, manager) != 0, "Duplicate TLD fails the load");
+    test_assert(manager->tld_count == 0 && manager->snapshot == NULL, "Failed load drops TLDs and snapshot");
+    test_assert(register_new_tld(manager, "snap") != NULL, "Manager usable after failed load");
+    cleanup_tld_manager(manager);
+}
+
+// Persistence uses the snapshot at boot only while it matches the database
+static void test_persistence_snapshot_boot(const char* db_path) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s.snap", db_path);
+
+    persistence_config_t* config = create_default_persistence_config(db_path);
+    persistence_context_t* ctx = NULL;
+    tld_manager_t* manager = NULL;
+    init_persistence(&ctx, config);
+    init_tld_manager(&manager);
+    attach_persistence_to_tld_manager(ctx, manager);
+    populate(register_new_tld(manager, "boot"), 50);
+    tld_node_t node = { .hostname = "auth.boot", .ip_address = "10.2.2.2", .last_seen = 0 };
+    add_authoritative_node_to_tld(find_tld_by_name(manager, "boot"), &node);
+    test_assert(persistence_write_snapshot(ctx, manager) == 0, "Write snapshot through persistence");
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+
+    init_persistence(&ctx, config);
+    init_tld_manager(&manager);
+    test_assert(restore_tlds_from_persistence(ctx, manager) == 0, "Restore with current snapshot");
+    tld_t* tld = find_tld_by_name(manager, "boot");
+    test_assert(manager->snapshot != NULL && tld && tld->base != NULL, "Current snapshot is mapped at boot");
+    test_assert(tld_record_count(tld) == 51 && tld->authoritative_node_count == 1, "Records from snapshot, nodes from database");
+
+    // A committed change makes the snapshot stale
+    attach_persistence_to_tld_manager(ctx, manager);
+    remove_dns_record_from_tld(tld, "host1", DNS_RECORD_TYPE_A);
+    persistence_flush(ctx);
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+
+    init_persistence(&ctx, config);
+    init_tld_manager(&manager);
+    test_assert(restore_tlds_from_persistence(ctx, manager) == 0, "Restore with stale snapshot");
+    tld = find_tld_by_name(manager, "boot");
+    test_assert(manager->snapshot == NULL && tld_record_count(tld) == 50, "Stale snapshot falls back to database");
+    cleanup_persistence(ctx);
+    cleanup_tld_manager(manager);
+    free_persistence_config(config);
+    unlink(path);
+}
+
+void test_tld_snapshot_all(void) {
+    char path[64];
+    char db_path[64];
+    char buf[96];
+    snprintf(path, sizeof(path), "/tmp/nexus_test_snapshot_%d.snap", (int)getpid());
+    snprintf(db_path, sizeof(db_path), "/tmp/nexus_test_snapshot_%d.db", (int)getpid());
+
+    test_snapshot_round_trip(path);
+    test_snapshot_rejects_corruption(path);
+    test_snapshot_rejects_corrupt_body(path);
+    test_snapshot_failed_load_unwinds(path);
+    unlink(path);
+
+    test_persistence_snapshot_boot(db_path);
+    unlink(db_path);
+    snprintf(buf, sizeof(buf), "%s-wal", db_path);
+    unlink(buf);
+    snprintf(buf, sizeof(buf), "%s-shm", db_path);
+    unlink(buf);
+    printf("TLD Snapshot Tests Finished.\n");
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_TLD_SNAPSHOT_H
+#define TEST_TLD_SNAPSHOT_H
+
+void test_tld_snapshot_all(void);
+
+#endif // TEST_TLD_SNAPSHOT_H
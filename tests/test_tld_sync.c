@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "../include/tld_manager.h"
+#include "../include/tld_merkle.h"
+#include "../include/tld_sync.h"
+#include "../include/tld_journal.h"
+#include "../include/packet_protocol.h"
+#include "test_tld_sync.h"
+
+typedef struct {
+    tld_manager_t* peer;
+    tld_journal_t* journal;         // NULL: the peer has no journal
+    int exchanges;
+} local_peer_t;
+
+// In-process transport: answer each pipelined packet from the peer's manager
+static ssize_t local_exchange(void* ctx, const uint8_t* request, size_t request_len, uint8_t** response_out) {
+    local_peer_t* peer = ctx;
+    uint8_t* out = NULL;
+    size_t out_len = 0;
+    size_t offset = 0;
+    peer->exchanges++;
+
+    while (offset < request_len) {
+        nexus_packet_t packet;
+        memset(&packet, 0, sizeof(packet));
+        ssize_t consumed = deserialize_nexus_packet(request + offset, request_len - offset, &packet);
+        assert(consumed > 0);
+        offset += (size_t)consumed;
+
+        uint8_t* resp = NULL;
+        size_t resp_len = 0;
+        int rc = tld_sync_handle_packet(peer->peer, peer->journal, &packet, &resp, &resp_len);
+        free(packet.data);
+        if (rc != 0) break;
+
+        out = realloc(out, out_len + resp_len);
+        assert(out != NULL);
+        memcpy(out + out_len, resp, resp_len);
+        out_len += resp_len;
+        free(resp);
+    }
+    *response_out = out;
+    return out ? (ssize_t)out_len : -1;
+}
+
+static ssize_t unreachable_exchange(void* ctx, const uint8_t* request, size_t request_len, uint8_t** response_out) {
+    (void)ctx; (void)request; (void)request_len;
+    *response_out = NULL;
+    return -1;
+}
+
+static void add_record(tld_manager_t* manager, tld_t* tld, const char* name, dns_record_type_t type, const char* rdata) {
+    dns_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.name = (char*)name;
+    record.type = type;
+    record.ttl = 300;
+    record.rdata = (char*)rdata;
+    pthread_rwlock_wrlock(&manager->lock);
+    assert(add_dns_record_to_tld(tld, &record) == 0);
+    pthread_rwlock_unlock(&manager->lock);
+}
+
+static int same_root(tld_manager_t* a, tld_manager_t* b, const char* tld_name) {
+    uint8_t root_a[32], root_b[32];
+    assert(get_tld_merkle_root(a, tld_name, root_a) == 0);
+    assert(get_tld_merkle_root(b, tld_name, root_b) == 0);
+    return memcmp(root_a, root_b, 32) == 0;
+}
+
+static void test_packet_roundtrip(void) {
+    printf("Testing TLD sync payload round trip...\n");
+
+    uint32_t indices[3] = {0, 7, 1023};
+    payload_tld_merkle_req_t req = { .tld_name = "nexus", .level = 10, .count = 3, .indices = indices };
+    uint8_t buf[256];
+    ssize_t len = serialize_payload_tld_merkle_req(&req, buf, sizeof(buf));
+    assert(len == get_serialized_payload_tld_merkle_req_size(&req));
+    payload_tld_merkle_req_t req_out;
+    assert(deserialize_payload_tld_merkle_req(buf, (size_t)len, &req_out) == len);
+    assert(strcmp(req_out.tld_name, "nexus") == 0 && req_out.level == 10 && req_out.count == 3);
+    assert(memcmp(req_out.indices, indices, sizeof(indices)) == 0);
+    free_payload_tld_merkle_req(&req_out);
+    // Truncated index list
+    assert(deserialize_payload_tld_merkle_req(buf, (size_t)len - 1, &req_out) < 0);
+
+    char name[] = "www", rdata[] = "10.0.0.1";
+    uint32_t buckets[1] = {42};
+    dns_record_t record = { .name = name, .type = DNS_RECORD_TYPE_A, .ttl = 60, .rdata = rdata };
+    payload_tld_bucket_resp_t resp = { .tld_name = "nexus", .bucket_count = 1, .buckets = buckets,
+                                       .record_count = 1, .records = &record };
+    len = get_serialized_payload_tld_bucket_resp_size(&resp);
+    assert(len > 0 && (size_t)len <= sizeof(buf));
+    assert(serialize_payload_tld_bucket_resp(&resp, buf, sizeof(buf)) == len);
+    payload_tld_bucket_resp_t resp_out;
+    assert(deserialize_payload_tld_bucket_resp(buf, (size_t)len, &resp_out) == len);
+    assert(resp_out.bucket_count == 1 && resp_out.buckets[0] == 42 && resp_out.record_count == 1);
+    assert(strcmp(resp_out.records[0].name, "www") == 0 && strcmp(resp_out.records[0].rdata, "10.0.0.1") == 0);
+    free_payload_tld_bucket_resp(&resp_out);
+
+    // An rdata that lost its terminator is rejected
+    buf[len - 1] = 'x';
+    assert(deserialize_payload_tld_bucket_resp(buf, (size_t)len, &resp_out) < 0);
+
+    uint8_t entries[] = { 1, 2, 3, 4, 5 };
+    payload_tld_journal_resp_t journal = { .status = NEXUS_TLD_SYNC_STATUS_OK, .last_sequence = 77,
+                                           .entry_count = 1, .data_len = sizeof(entries), .data = entries };
+    len = get_serialized_payload_tld_journal_resp_size(&journal);
+    assert(serialize_payload_tld_journal_resp(&journal, buf, sizeof(buf)) == len);
+    payload_tld_journal_resp_t journal_out;
+    assert(deserialize_payload_tld_journal_resp(buf, (size_t)len, &journal_out) == len);
+    assert(journal_out.last_sequence == 77 && journal_out.data_len == sizeof(entries));
+    assert(memcmp(journal_out.data, entries, sizeof(entries)) == 0);
+    free_payload_tld_journal_resp(&journal_out);
+    // Entry data cut short
+    assert(deserialize_payload_tld_journal_resp(buf, (size_t)len - 1, &journal_out) < 0);
+
+    printf("TLD sync payload round trip test passed!\n");
+}
+
+static void test_reconcile_mirror(void) {
+    printf("Testing TLD sync reconciliation...\n");
+
+    tld_manager_t* upstream = NULL;
+    tld_manager_t* mirror = NULL;
+    assert(init_tld_manager(&upstream) == 0);
+    assert(init_tld_manager(&mirror) == 0);
+    tld_t* up = register_new_tld(upstream, "nexus");
+    tld_t* down = register_new_tld(mirror, "nexus");
+    assert(up && down);
+
+    char name[64], rdata[64];
+    for (int i = 0; i < 200; ++i) {
+        snprintf(name, sizeof(name), "host%d", i);
+        snprintf(rdata, sizeof(rdata), "10.0.%d.%d", i / 256, i % 256);
+        add_record(upstream, up, name, DNS_RECORD_TYPE_A, rdata);
+        if (i % 20 != 0) add_record(mirror, down, name, DNS_RECORD_TYPE_A, rdata);
+    }
+    // A record only the mirror has and one whose rdata differs
+    add_record(mirror, down, "stale", DNS_RECORD_TYPE_TXT, "gone upstream");
+    add_record(upstream, up, "multi", DNS_RECORD_TYPE_A, "10.1.0.1");
+    add_record(upstream, up, "multi", DNS_RECORD_TYPE_A, "10.1.0.2");
+    add_record(mirror, down, "multi", DNS_RECORD_TYPE_A, "10.1.0.1");
+    add_record(mirror, down, "multi", DNS_RECORD_TYPE_A, "10.1.0.9");
+    assert(!same_root(upstream, mirror, "nexus"));
+
+    tld_sync_t* sync = NULL;
+    local_peer_t peer = { .peer = upstream };
+    assert(init_tld_sync(mirror, 1000, &sync) == 0);
+    assert(tld_sync_add_peer(sync, "upstream", local_exchange, &peer) == 0);
+
+    size_t reconciled = 0;
+    assert(tld_sync_pull_tld(sync, 0, "nexus", &reconciled) == TLD_SYNC_RECONCILED);
+    assert(reconciled > 0 && reconciled <= 12);
+    assert(same_root(upstream, mirror, "nexus"));
+    assert(tld_record_count(down) == tld_record_count(up));
+    // Divergence walk per level plus one pipelined bucket exchange
+    assert(peer.exchanges <= TLD_MERKLE_DEPTH + 2);
+
+    dns_record_t found[4];
+    assert(tld_lookup_records(down, "stale", found, 4) == 0);
+    assert(tld_lookup_records(down, "multi", found, 4) == 2);
+
+    peer.exchanges = 0;
+    assert(tld_sync_pull_tld(sync, 0, "nexus", &reconciled) == TLD_SYNC_IN_SYNC);
+    assert(reconciled == 0 && peer.exchanges == 1);
+
+    // A TLD the peer does not serve, and a peer that cannot be reached
+    assert(register_new_tld(mirror, "other") != NULL);
+    assert(tld_sync_pull_tld(sync, 0, "other", NULL) == TLD_SYNC_UNKNOWN_TLD);
+    assert(tld_sync_add_peer(sync, "down", unreachable_exchange, NULL) == 0);
+    assert(tld_sync_pull_tld(sync, 1, "nexus", NULL) == TLD_SYNC_UNREACHABLE);
+    assert(tld_sync_round(sync) == 0);
+    assert(sync->peers[0].last_status == TLD_SYNC_UNKNOWN_TLD);
+    assert(sync->peers[1].last_status == TLD_SYNC_UNREACHABLE);
+
+    cleanup_tld_sync(sync);
+    cleanup_tld_manager(mirror);
+    cleanup_tld_manager(upstream);
+    printf("TLD sync reconciliation test passed!\n");
+}
+
+static void test_journal_deltas(void) {
+    printf("Testing TLD sync journal deltas...\n");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/nexus_test_sync_%d.wal", (int)getpid());
+    unlink(path);
+
+    tld_manager_t* upstream = NULL;
+    tld_manager_t* mirror = NULL;
+    tld_journal_t* journal = NULL;
+    assert(init_tld_manager(&upstream) == 0);
+    assert(init_tld_manager(&mirror) == 0);
+    assert(open_tld_journal(&journal, path, NULL) == 0);
+    assert(attach_tld_journal(journal, upstream) == 0);
+
+    tld_t* up = register_new_tld(upstream, "nexus");
+    assert(register_new_tld(mirror, "nexus") != NULL);
+    char name[64];
+    for (int i = 0; i < 50; ++i) {
+        snprintf(name, sizeof(name), "host%d", i);
+        add_record(upstream, up, name, DNS_RECORD_TYPE_A, "10.2.0.1");
+    }
+    assert(tld_journal_sync(journal) == 0);
+
+    tld_sync_t* sync = NULL;
+    local_peer_t peer = { .peer = upstream, .journal = journal };
+    assert(init_tld_sync(mirror, 1000, &sync) == 0);
+    assert(tld_sync_add_peer(sync, "upstream", local_exchange, &peer) == 0);
+
+    // First round has no cursor: the Merkle walk, then the cursor is set
+    assert(tld_sync_round(sync) == 0);
+    assert(same_root(upstream, mirror, "nexus"));
+    assert(sync->peers[0].has_journal_cursor && sync->peers[0].journal_seq == 51);
+
+    // Later changes, including a new TLD, arrive in one delta exchange
+    add_record(upstream, up, "late", DNS_RECORD_TYPE_TXT, "from the journal");
+    dns_record_t gone = { .name = "host7", .type = DNS_RECORD_TYPE_A, .ttl = 300, .rdata = "10.2.0.1" };
+    pthread_rwlock_wrlock(&upstream->lock);
+    assert(remove_exact_dns_record_from_tld(up, &gone) == 0);
+    pthread_rwlock_unlock(&upstream->lock);
+    tld_t* extra = register_new_tld(upstream, "extra");
+    add_record(upstream, extra, "www", DNS_RECORD_TYPE_A, "10.2.0.2");
+    assert(tld_journal_sync(journal) == 0);
+
+    peer.exchanges = 0;
+    assert(tld_sync_round(sync) == 0);
+    assert(peer.exchanges == 1);
+    assert(sync->peers[0].last_status == TLD_SYNC_RECONCILED && sync->peers[0].journal_seq == 55);
+    assert(same_root(upstream, mirror, "nexus"));
+    assert(same_root(upstream, mirror, "extra"));
+
+    // Nothing new: one empty delta
+    peer.exchanges = 0;
+    assert(tld_sync_round(sync) == 0);
+    assert(peer.exchanges == 1 && sync->peers[0].last_status == TLD_SYNC_IN_SYNC);
+
+    // Once the upstream compacts past the cursor the mirror walks again
+    add_record(upstream, up, "after", DNS_RECORD_TYPE_A, "10.2.0.3");
+    assert(tld_journal_sync(journal) == 0);
+    assert(compact_tld_journal(journal, tld_journal_last_sequence(journal)) == 0);
+    assert(tld_sync_round(sync) == 0);
+    assert(same_root(upstream, mirror, "nexus"));
+    assert(sync->peers[0].has_journal_cursor && sync->peers[0].journal_seq == 56);
+
+    cleanup_tld_sync(sync);
+    close_tld_journal(journal);
+    cleanup_tld_manager(mirror);
+    cleanup_tld_manager(upstream);
+    unlink(path);
+    printf("TLD sync journal deltas test passed!\n");
+}
+
+void test_tld_sync_all(void) {
+    printf("Running all TLD sync tests...\n");
+
+    test_packet_roundtrip();
+    test_reconcile_mirror();
+    test_journal_deltas();
+
+    printf("All TLD sync tests passed!\n");
+}
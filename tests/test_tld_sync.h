@@ -0,0 +1,6 @@
+#ifndef TEST_TLD_SYNC_H
+#define TEST_TLD_SYNC_H
+
+void test_tld_sync_all(void);
+
+#endif // TEST_TLD_SYNC_H